@@ -247,6 +247,10 @@ bool DNETcK::isInitialized(unsigned long msBlockMax, DNETcK::STATUS * pStatus)
 **
 **      This is a critical function and should be called often so incoming UDP/TCP 
 **      messages are not missed.
+**
+**      This is also where the event handlers set with TcpClient::setEventHandler and
+**      TcpServer::setEventHandler are called, once per socket with everything that
+**      happened since the last call.
 **      
 */
 void DNETcK::periodicTasks(void)
@@ -259,6 +263,9 @@ void DNETcK::periodicTasks(void)
     }
 
     EthernetPeriodicTasks();
+
+    // tell the event handlers what changed
+    TCPDispatchEvents();
 }
 
 /***	unsigned long DNETcK::setDefaultBlockTime(unsigned long msDefaultBlockTimeT)
@@ -55,6 +55,11 @@
 #define UNKNOWN_SOCKET (0xFFu)
 #define INVALID_UDP_SOCKET (0xFFu)
 
+// The deepest accept queue a TcpServer can be constructed with
+#ifndef DNETcK_MAX_PENDING_CLIENTS
+#define DNETcK_MAX_PENDING_CLIENTS 16
+#endif
+
 typedef union 
 {
     byte rgbIP[4];
@@ -72,6 +77,24 @@ typedef struct
     unsigned short  port;
 } IPEndPoint;
 
+class UdpClient;
+
+// one datagram of a batch for UdpClient::writeDatagrams
+typedef struct
+{
+    const byte *    rgbDatagram;
+    unsigned short  cbDatagram;
+    UdpClient *     pudpRemote;     // whose remote endpoint it goes to, NULL for the sending instance's
+} UdpDatagram;
+
+// the same, laid out like the MAL's UDP_DATAGRAM
+typedef struct
+{
+    const byte *    rgbDatagram;
+    unsigned short  cbDatagram;
+    byte            hUDPRemote;
+} MALUdpDatagram;
+
 // everything is static so this class does NOT have to be instantiated
 // you call things directly as DNETcK::begin();
 class DNETcK // : public DWIFIcK
@@ -262,6 +285,15 @@ public:
     friend class DWIFIcK;
 };
 
+class TcpClient;
+class TcpServer;
+
+// called from DNETcK::periodicTasks() with the TcpClient::ev* events that happened since the last call
+typedef void (* TcpClientEventHandler)(TcpClient * pTcpClient, unsigned int events, size_t cbReadable, size_t cbWritable, void * pvContext);
+
+// called from DNETcK::periodicTasks() when new clients connect
+typedef void (* TcpServerEventHandler)(TcpServer * pTcpServer, int cPending, void * pvContext);
+
 class TcpClient : public Print {
 private:
 
@@ -274,12 +306,17 @@ private:
     IPEndPoint      _remoteEP;
     MAC             _remoteMAC;
 
+    TcpClientEventHandler   _pfnEventHandler;
+    void *                  _pvEventContext;
+
     // to prevent copies
     TcpClient&  operator=(TcpClient& tcpClient);
     TcpClient(TcpClient& tcpClient);
 
     // private methods
     void construct(void);
+    void armEventHandler(void);
+    static void eventThunk(byte hTCP, byte events, void * pvContext);
 
     // This is implementing the virtual methods for Print
     // by making these private we are hiding write() from TcpClient
@@ -296,6 +333,13 @@ private:
     void write(const uint8_t *buffer, size_t size);
 
 public:
+    // events passed to a TcpClientEventHandler, several may be or'ed together
+    static const unsigned int evConnected   = 0x01;
+    static const unsigned int evReadable    = 0x02;
+    static const unsigned int evWritable    = 0x04;
+    static const unsigned int evClosed      = 0x08;
+    static const unsigned int evError       = 0x10;
+
     TcpClient();
     ~TcpClient();
 
@@ -324,6 +368,9 @@ public:
  
     int readByte(void);
     size_t readStream(byte *rgbRead, size_t cbReadMax);
+
+    size_t borrowStream(const byte **ppHead, size_t *pcbHead, const byte **ppWrap, size_t *pcbWrap);
+    size_t consume(size_t cbConsume);
  
     int writeByte(byte bData);                      
     int writeByte(byte bData, DNETcK::STATUS * pStatus);
@@ -332,26 +379,44 @@ public:
     size_t writeStream(const byte *rgbWrite, size_t cbWrite, DNETcK::STATUS * pStatus);
     size_t writeStream(const byte *rgbWrite, size_t cbWrite, unsigned long msBlockMax);
     size_t writeStream(const byte *rgbWrite, size_t cbWrite, unsigned long msBlockMax, DNETcK::STATUS * pStatus);
+
+    size_t writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers);
+    size_t writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, DNETcK::STATUS * pStatus);
+    size_t writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, unsigned long msBlockMax);
+    size_t writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, unsigned long msBlockMax, DNETcK::STATUS * pStatus);
+
+    void cork(void);
+    void uncork(void);
  
     bool getRemoteEndPoint(IPEndPoint *pRemoteEP);
     bool getLocalEndPoint(IPEndPoint *pLocalEP);
     bool getRemoteMAC(MAC *pRemoteMAC);
 
+    void setEventHandler(TcpClientEventHandler pfnEventHandler, void * pvContext);
+
     friend class TcpServer;
 };
 
 class TcpServer {
 private:
-    static const int       _cMaxPendingAllowed     = 10;
+    static const int       _cMaxPendingAllowed     = DNETcK_MAX_PENDING_CLIENTS;
     static const int       _cMaxPendingDefault     = 3;
+    static const int       _cMaxListening          = 2;
 
     bool            _fStarted;
     bool            _fListening;
     unsigned short  _localPort;
     int             _cPendingMax;
-    int             _cPending;
+    int             _cPending;      // connected clients waiting to be accepted
+    int             _iHead;         // oldest entry in _rghTCP
+    int             _cQueued;       // entries in _rghTCP, including removed ones not yet passed by _iHead
+    int             _cListening;
  
-    byte            _rghTCP[_cMaxPendingAllowed];
+    byte            _rghTCP[_cMaxPendingAllowed];       // accept queue, a ring
+    byte            _rghListening[_cMaxListening];
+
+    TcpServerEventHandler   _pfnEventHandler;
+    void *                  _pvEventContext;
     
     // to prevent copies
     TcpServer&  operator=(TcpServer& tcpServer);
@@ -359,6 +424,11 @@ private:
 
     void construct(int cMaxPendingClients);    
     void clear(void);
+    int  slotOfClient(int index);
+    void queueClient(byte hTCP);
+    void removeClient(int iSlot);
+    static void releaseSocket(byte hTCP);
+    static void eventThunk(byte hTCP, byte events, void * pvContext);
 
 public:
     TcpServer();    
@@ -388,6 +458,8 @@ public:
     bool getAvailableClientsRemoteEndPoint(IPEndPoint *pRemoteEP, MAC * pRemoteMAC, int index);
 
     bool getListeningEndPoint(IPEndPoint *pListeningEP);
+
+    void setEventHandler(TcpServerEventHandler pfnEventHandler, void * pvContext);
 };
 
 
@@ -396,6 +468,7 @@ class UdpClient {
 private:
 
     static const unsigned long cARPRetriesDefault = 3;
+    static const unsigned short cWriteDatagramsBatch = 8;
     static const unsigned long msARPWaitDefault  = 1000;
  
     unsigned long _cARPRetries;
@@ -463,7 +536,11 @@ public:
     size_t peekDatagram(byte *rgbPeek, size_t cbPeekMax, size_t index);
 
     size_t readDatagram(byte *rgbRead, size_t cbReadMax);
+    size_t borrowDatagram(const byte **ppbDatagram);
+    bool getDatagramRemoteEndPoint(IPEndPoint *pRemoteEP);
+    bool getDatagramAge(unsigned long *pmsAge);
     long int writeDatagram(const byte *rgbWrite, size_t cbWrite);
+    size_t writeDatagrams(const UdpDatagram *rgDatagrams, size_t cDatagrams);
  
     bool getRemoteEndPoint(IPEndPoint *pRemoteEP);
     bool getLocalEndPoint(IPEndPoint *pLocalEP);
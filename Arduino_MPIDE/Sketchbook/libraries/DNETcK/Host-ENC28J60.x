@@ -0,0 +1,44 @@
+/************************************************************************/
+/*																		*/
+/*	Host-ENC28J60.x                                                     */
+/*																		*/
+/*	Hardware profile of the simulated ENC28J60 of HostENC28J60.c, for	*/
+/*	HOST_MAC builds with HOST_ENC28J60 defined.  NetworkProfile.x		*/
+/*	includes it in place of a board's.									*/
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+
+#ifndef HOST_ENC28J60_X
+#define HOST_ENC28J60_X
+
+#include "GenericTypeDefs.h"
+#include "TCPIP Stack/HostENC28J60.h"
+
+// ENC28J60 I/O pins and SPI module, a PIC32's as far as ENC28J60.c
+// can tell; add ENC_SPI_DMA to the build for the DMA transfers
+#define ENC_CS_TRIS			(HostENCCSTris)
+#define ENC_CS_IO			(*HostENCChipSelect())
+#define ENC_SSPBUF			(*HostENCSPIBuffer())
+#define ENC_SPISTATbits		(*HostENCSPIStatus())
+#define ENC_SPICON1bits		(HostENCSPICON)
+#define ENC_SPIBRG			(HostENCSPIBRG)
+
+#endif  //  HOST_ENC28J60_X
@@ -0,0 +1,215 @@
+/************************************************************************/
+/*																		*/
+/*	Host-TCPIPConfig.x                                                  */
+/*																		*/
+/*	TCPIP config for HOST_MAC builds, the stack compiled with gcc on	*/
+/*	a Linux PC against HostMAC.c.  Selected by TCPIPConfig.x when		*/
+/*	HOST_MAC is defined; see tools/host/Makefile for the build.		*/
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	The same modules and socket sizes as MX7cK-SMSC-8720-TCPIPConfig.x	*/
+/*	so host measurements compare with the board.  DHCP starts out		*/
+/*	disabled in DNETcKAPI.c; host tests that call StackInit() directly	*/
+/*	call DHCPDisable(0) and set AppConfig themselves.  The HOST_TCP_*	*/
+/*	and HOST_UDP_SOCKETS settings below can be given on the gcc		*/
+/*	command line, as can the modules left out here,					*/
+/*	STACK_USE_TCP_PERFORMANCE_TEST say.									*/
+/*																		*/
+/************************************************************************/
+#ifndef __TCPIPCONFIG_H
+#define __TCPIPCONFIG_H
+
+#include "GenericTypeDefs.h"
+#include "Compiler.h"
+
+// =======================================================================
+//   Application Options
+// =======================================================================
+#define STACK_USE_ICMP_SERVER			// Ping query and response capability
+#define STACK_USE_ICMP_CLIENT			// Ping transmission capability
+#define STACK_USE_DHCP_CLIENT			// Dynamic Host Configuration Protocol client for obtaining IP address and other parameters
+#define STACK_USE_DNS					// Domain Name Service Client for resolving hostname strings to IP addresses
+#define STACK_USE_NBNS					// NetBIOS Name Service Server for repsonding to NBNS hostname broadcast queries
+#define STACK_USE_REBOOT_SERVER			// Module for resetting this PIC remotely; ends the program on a host
+#define STACK_USE_SNTP_CLIENT			// Simple Network Time Protocol for obtaining current date/time from Internet
+
+// =======================================================================
+//   Data Storage Options
+// =======================================================================
+#define MPFS_RESERVE_BLOCK				(137ul)
+#define MAX_MPFS_HANDLES				(7ul)
+
+// =======================================================================
+//   Network Addressing Options
+// =======================================================================
+#define MY_DEFAULT_HOST_NAME			"CHIPKIT"
+
+#define MY_DEFAULT_MAC_BYTE1            (0x00)
+#define MY_DEFAULT_MAC_BYTE2            (0x04)
+#define MY_DEFAULT_MAC_BYTE3            (0xA3)
+#define MY_DEFAULT_MAC_BYTE4            (0x00)
+#define MY_DEFAULT_MAC_BYTE5            (0x00)
+#define MY_DEFAULT_MAC_BYTE6            (0x00)
+
+#define MY_DEFAULT_IP_ADDR_BYTE1        (0ul)
+#define MY_DEFAULT_IP_ADDR_BYTE2        (0ul)
+#define MY_DEFAULT_IP_ADDR_BYTE3        (0ul)
+#define MY_DEFAULT_IP_ADDR_BYTE4        (0ul)
+
+#define MY_DEFAULT_MASK_BYTE1           (255ul)
+#define MY_DEFAULT_MASK_BYTE2           (255ul)
+#define MY_DEFAULT_MASK_BYTE3           (255ul)
+#define MY_DEFAULT_MASK_BYTE4           (0ul)
+
+#define MY_DEFAULT_GATE_BYTE1           (0ul)
+#define MY_DEFAULT_GATE_BYTE2           (0ul)
+#define MY_DEFAULT_GATE_BYTE3           (0ul)
+#define MY_DEFAULT_GATE_BYTE4           (0ul)
+
+#define MY_DEFAULT_PRIMARY_DNS_BYTE1	(8ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE2	(8ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE3	(8ul)
+#define MY_DEFAULT_PRIMARY_DNS_BYTE4	(8ul)
+
+#define MY_DEFAULT_SECONDARY_DNS_BYTE1	(8ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE2	(8ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE3	(4ul)
+#define MY_DEFAULT_SECONDARY_DNS_BYTE4	(4ul)
+
+// HostMAC.h sizes the RX queue, HOST_MAC_QUEUE_FRAMES frames, not EMAC_RX_BUFF_SIZE
+
+// =======================================================================
+//   Transport Layer Options
+// =======================================================================
+#define STACK_USE_TCP
+#define STACK_USE_UDP
+#define STACK_CLIENT_MODE
+
+// Number of TCP sockets: 8, 16, 32 or 64
+#ifndef HOST_TCP_SOCKETS
+	#define HOST_TCP_SOCKETS				(8u)
+#endif
+
+// TX and RX FIFO size of each socket
+#ifndef HOST_TCP_FIFO_SIZE
+	#define HOST_TCP_FIFO_SIZE				(1000u)
+#endif
+
+// Where the sockets live: TCP_PIC_RAM, or TCP_ETH_RAM to have the MAC
+// (and with HOST_ENCX24J600 its DMA engine) move the payload
+#ifndef HOST_TCP_MEDIUM
+	#define HOST_TCP_MEDIUM					TCP_PIC_RAM
+#endif
+
+// Room for the FIFOs plus a TCB in front of each, whichever RAM they are in
+#if defined(STACK_USE_TCP_PERFORMANCE_TEST)
+	#define HOST_TCP_RAM_SIZE			(HOST_TCP_SOCKETS * (2ul * HOST_TCP_FIFO_SIZE + 128ul) + 2ul * (2040ul + 128ul))
+#else
+	#define HOST_TCP_RAM_SIZE			(HOST_TCP_SOCKETS * (2ul * HOST_TCP_FIFO_SIZE + 128ul))
+#endif
+
+	#if HOST_TCP_MEDIUM == TCP_ETH_RAM
+		#define TCP_ETH_RAM_SIZE				HOST_TCP_RAM_SIZE
+		#define TCP_PIC_RAM_SIZE				(0ul)
+	#else
+		#define TCP_ETH_RAM_SIZE				(0ul)
+		#define TCP_PIC_RAM_SIZE				HOST_TCP_RAM_SIZE
+	#endif
+	#define TCP_SPI_RAM_SIZE					(0ul)
+	#define TCP_SPI_RAM_BASE_ADDRESS			(0x00)
+
+	// Off here so the board's setting can be compared both ways, add
+	// -DTCP_DIRECT_TCB to HOST_DEFS to turn it on
+	//#define TCP_DIRECT_TCB
+
+	// Define names of socket types
+	#define TCP_SOCKET_TYPES
+		#define TCP_PURPOSE_GENERIC_TCP_CLIENT 0
+		#define TCP_PURPOSE_GENERIC_TCP_SERVER 1
+		#define TCP_PURPOSE_TELNET 2
+		#define TCP_PURPOSE_FTP_COMMAND 3
+		#define TCP_PURPOSE_FTP_DATA 4
+		#define TCP_PURPOSE_TCP_PERFORMANCE_TX 5
+		#define TCP_PURPOSE_TCP_PERFORMANCE_RX 6
+		#define TCP_PURPOSE_UART_2_TCP_BRIDGE 7
+		#define TCP_PURPOSE_HTTP_SERVER 8
+		#define TCP_PURPOSE_DEFAULT 9
+		#define TCP_PURPOSE_BERKELEY_SERVER 10
+		#define TCP_PURPOSE_BERKELEY_CLIENT 11
+	#define END_OF_TCP_SOCKET_TYPES
+
+	#if defined(__TCP_C)
+		#define HOST_TCP_SOCKET		{TCP_PURPOSE_DEFAULT, HOST_TCP_MEDIUM, HOST_TCP_FIFO_SIZE, HOST_TCP_FIFO_SIZE}
+		#define HOST_TCP_SOCKET_8	HOST_TCP_SOCKET, HOST_TCP_SOCKET, HOST_TCP_SOCKET, HOST_TCP_SOCKET, \
+									HOST_TCP_SOCKET, HOST_TCP_SOCKET, HOST_TCP_SOCKET, HOST_TCP_SOCKET
+
+		#define TCP_CONFIGURATION
+		ROM struct
+		{
+			BYTE vSocketPurpose;
+			BYTE vMemoryMedium;
+			WORD wTXBufferSize;
+			WORD wRXBufferSize;
+		} TCPSocketInitializer[] = 
+		{
+			HOST_TCP_SOCKET_8,
+			#if HOST_TCP_SOCKETS > 8
+			HOST_TCP_SOCKET_8,
+			#endif
+			#if HOST_TCP_SOCKETS > 16
+			HOST_TCP_SOCKET_8,
+			HOST_TCP_SOCKET_8,
+			#endif
+			#if HOST_TCP_SOCKETS > 32
+			HOST_TCP_SOCKET_8,
+			HOST_TCP_SOCKET_8,
+			HOST_TCP_SOCKET_8,
+			HOST_TCP_SOCKET_8,
+			#endif
+			#if defined(STACK_USE_TCP_PERFORMANCE_TEST)
+			{TCP_PURPOSE_TCP_PERFORMANCE_TX, HOST_TCP_MEDIUM, 2000, 1},
+			{TCP_PURPOSE_TCP_PERFORMANCE_RX, HOST_TCP_MEDIUM, 40, 2000},
+			#endif
+		};
+		#define END_OF_TCP_CONFIGURATION
+	#endif
+
+// Number of UDP sockets, the stack's own included
+#ifndef HOST_UDP_SOCKETS
+	#define HOST_UDP_SOCKETS				(10u)
+#endif
+
+#define MAX_UDP_SOCKETS     HOST_UDP_SOCKETS
+#define UDP_USE_TX_CHECKSUM
+
+#define BSD_SOCKET_COUNT (5u)
+
+// =======================================================================
+//   Application-Specific Options
+// =======================================================================
+#define MAX_HTTP_CONNECTIONS	(2u)
+#define MAX_TELNET_CONNECTIONS	(1u)
+
+#define MDD_ROOT_DIR_PATH		"\\"
+
+#endif
@@ -91,12 +91,17 @@
 #define STACK_USE_NBNS					// NetBIOS Name Service Server for repsonding to NBNS hostname broadcast queries
 #define STACK_USE_REBOOT_SERVER			// Module for resetting this PIC remotely.  Primarily useful for a Bootloader.
 #define STACK_USE_SNTP_CLIENT			// Simple Network Time Protocol for obtaining current date/time from Internet
-//#define STACK_USE_UDP_PERFORMANCE_TEST	// Module for testing UDP TX performance characteristics.  NOTE: Enabling this will cause a huge amount of UDP broadcast packets to flood your network on the discard port.  Use care when enabling this on production networks, especially with VPNs (could tunnel broadcast traffic across a limited bandwidth connection).
-//#define STACK_USE_TCP_PERFORMANCE_TEST	// Module for testing TCP TX performance characteristics
+//#define STACK_USE_UDP_PERFORMANCE_TEST	// UDP blast test with loss accounting, driven by tools/dnetckperf.c.  NOTE: a blast goes out as fast as the MAC takes it, use care on production networks and VPNs.
+//#define STACK_USE_TCP_PERFORMANCE_TEST	// TCP bulk TX, RX and request/response tests, driven by tools/dnetckperf.c
 //#define STACK_USE_DYNAMICDNS_CLIENT		// Dynamic DNS client updater module
 //#define STACK_USE_BERKELEY_API			// Berekely Sockets APIs are available
 //#define STACK_USE_ZEROCONF_LINK_LOCAL	// Zeroconf IPv4 Link-Local Addressing
 //#define STACK_USE_ZEROCONF_MDNS_SD		// Zeroconf mDNS and mDNS service discovery
+//#define STACK_USE_PCAP_CAPTURE			// Record every frame the MAC sees into a pcap ring, see PcapCapture.h
+//#define STACK_USE_HANDLER_TIMING		// Time ARP, ICMP, TCP and UDP inside StackTask() on the core timer, see StackTsk.h
+//#define STACK_USE_RX_INTERRUPT			// StackTask() only goes to the MAC after its RX interrupt, see StackTsk.h
+//#define STACK_RX_FRAME_BUDGET	(8u)	// Frames StackTask() handles per call, 0 for all of them, see StackTsk.h
+//#define STACK_RX_TIME_BUDGET	(2ull*TICK_SECOND/1000ull)	// Ticks StackTask() spends on RX per call, 0 for no limit
 
 
 // =======================================================================
@@ -244,6 +249,11 @@
 	#define TCP_SPI_RAM_SIZE					(0ul)
 	#define TCP_SPI_RAM_BASE_ADDRESS			(0x00)
 
+	// Keep every socket's TCB in PIC RAM instead of copying the current 
+	// one in and out of TCP_*_RAM, see TCP.c.  Each socket then takes 
+	// sizeof(TCB) more PIC RAM and that much less of TCP_*_RAM_SIZE.
+	#define TCP_DIRECT_TCB
+
 	// Define names of socket types
 	#define TCP_SOCKET_TYPES
 		#define TCP_PURPOSE_GENERIC_TCP_CLIENT 0
@@ -291,6 +301,7 @@
 			//{TCP_PURPOSE_FTP_DATA, TCP_PIC_RAM, 0, 128},
 			//{TCP_PURPOSE_TCP_PERFORMANCE_TX, TCP_PIC_RAM, 2000, 1},
 			//{TCP_PURPOSE_TCP_PERFORMANCE_RX, TCP_PIC_RAM, 40, 2000},
+			//{TCP_PURPOSE_DEFAULT, TCP_PIC_RAM, 256, 256},	// TCP performance RR
 			//{TCP_PURPOSE_UART_2_TCP_BRIDGE, TCP_PIC_RAM, 256, 256},
 			//{TCP_PURPOSE_HTTP_SERVER, TCP_PIC_RAM, 1500, 1500},
 			//{TCP_PURPOSE_HTTP_SERVER, TCP_PIC_RAM, 1500, 1500},
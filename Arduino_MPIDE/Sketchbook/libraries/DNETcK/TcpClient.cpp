@@ -59,6 +59,8 @@ TcpClient::TcpClient(TcpClient& tcpClient){};
 */
 TcpClient::TcpClient()
 {
+    _pfnEventHandler = NULL;
+    _pvEventContext = NULL;
     construct();
 }
 void TcpClient::construct(void)
@@ -108,6 +110,9 @@ void TcpClient::close(void)
 {
     if(_hTCP < INVALID_SOCKET)
     {
+        // we don't want to hear about our own close
+        TCPSetEventHandler(_hTCP, NULL, NULL);
+
         // clean out the buffer
         TCPDiscard(_hTCP);
 
@@ -203,6 +208,7 @@ bool TcpClient::connect(const char *szRemoteHostName, unsigned short remotePort,
 
     if(_hTCP < INVALID_SOCKET)
     {
+        armEventHandler();
         _classState = DNETcK::WaitingConnect;
         if(pStatus != NULL) *pStatus = DNETcK::WaitingConnect;
         return(true);
@@ -227,6 +233,7 @@ bool TcpClient::connect(const IPEndPoint& remoteEP, DNETcK::STATUS * pStatus)
 
     if(_hTCP < INVALID_SOCKET)
     {
+        armEventHandler();
         _classState = DNETcK::WaitingConnect;
         if(pStatus != NULL) *pStatus = DNETcK::WaitingConnect;
         return(true);
@@ -600,6 +607,89 @@ size_t TcpClient::readStream(byte *rgbRead, size_t cbReadMax)
     return(0);
 }
 
+/***	size_t TcpClient::borrowStream(const byte **ppHead, size_t *pcbHead, const byte **ppWrap, size_t *pcbWrap)
+**
+**	Synopsis:   
+**      Gets pointers to the bytes in the socket buffer without copying or removing them.
+**
+**	Parameters:
+**      ppHead      Receives a pointer to the next byte to read.
+**
+**      pcbHead     Receives the number of bytes at *ppHead.
+**
+**      ppWrap      Receives a pointer to the rest of the bytes if the socket buffer wrapped, NULL otherwise.
+**
+**      pcbWrap     Receives the number of bytes at *ppWrap, 0 if the buffer did not wrap.
+**
+**	Return Values:
+**      The total number of bytes that can be looked at. 0 is returned if no bytes are ready,
+**      the socket buffer is not in PIC RAM, or an error occured.
+**
+**	Errors:
+**      Nothing to read, or a connection error.
+**
+**  Notes:
+**
+**      This call is safe to make without checking the connection status.
+**
+**      The socket buffer is circular, so the bytes come in up to two pieces.
+**      Parse them in place and then call consume() to remove the bytes used.
+**      The pointers are only good until the next call that reads from this
+**      socket or runs the stack (including available() and isConnected()).
+**
+*/
+size_t TcpClient::borrowStream(const byte **ppHead, size_t *pcbHead, const byte **ppWrap, size_t *pcbWrap)
+{
+    const byte * pHead = NULL;
+    const byte * pWrap = NULL;
+    unsigned short cbHead = 0;
+    unsigned short cbWrap = 0;
+    size_t cbReady = 0;
+
+    // this will run the stack tasks
+    if(available() > 0)
+    {
+        cbReady = GetTcpRxSpans(_hTCP, &pHead, &cbHead, &pWrap, &cbWrap);
+    }
+
+    if(ppHead != NULL) *ppHead = pHead;
+    if(pcbHead != NULL) *pcbHead = cbHead;
+    if(ppWrap != NULL) *ppWrap = pWrap;
+    if(pcbWrap != NULL) *pcbWrap = cbWrap;
+
+    return(cbReady);
+}
+
+/***	size_t TcpClient::consume(size_t cbConsume)
+**
+**	Synopsis:   
+**      Removes bytes from the socket buffer without copying them.
+**
+**	Parameters:
+**      cbConsume   The number of bytes to remove, usually after looking at them with borrowStream().
+**
+**	Return Values:
+**      The actual number of bytes removed.
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      This does not run the stack, so pointers from borrowStream() to bytes
+**      beyond the ones removed stay good.
+**
+*/
+size_t TcpClient::consume(size_t cbConsume)
+{
+    if(_hTCP < INVALID_SOCKET)
+    {
+        return(TCPConsume(_hTCP, cbConsume));
+    }
+
+    return(0);
+}
+
 /***	void TcpClient::writeStream(uint8_t bData)
 **
 **	Synopsis:   
@@ -704,6 +794,7 @@ int TcpClient::writeByte(byte bData, DNETcK::STATUS * pStatus)
 **
 **      Each write will flush the array as a whole to the network.
 **      Multiple write may occur if the array is larger than the socket buffer.
+**      If the connection is corked, only full segments are flushed; see cork().
 **
 */
 size_t TcpClient::writeStream(const byte *rgbWrite, size_t cbWrite)                           
@@ -759,6 +850,137 @@ size_t TcpClient::writeStream(const byte *rgbWrite, size_t cbWrite, unsigned lon
    return(cbWritten);
 }
 
+/***	int TcpClient::writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers)
+**      int TcpClient::writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, DNETcK::STATUS * pStatus)
+**      int TcpClient::writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, unsigned long msBlockMax)
+**      int TcpClient::writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, unsigned long msBlockMax, DNETcK::STATUS * pStatus)
+**
+**
+**	Synopsis:   
+**      Write several arrays of bytes out on the TcpIP connection as one message
+**
+**	Parameters:
+**      rgpbWrite   An array of pointers to the byte arrays to write out, in order.
+**
+**      rgcbWrite   The number of bytes to write out from each array.
+**
+**      cBuffers    The number of entries in rgpbWrite and rgcbWrite.
+**
+**      msBlockMax  The maximum amount of time that should be spent attempting to write out all of the arrays.
+**
+**      pStatus     A pointer to receive the status of the call, usually the connection status.
+**
+**	Return Values:
+**      The total number of bytes actually written. 0 is returned if no bytes were written or an error occured.
+**
+**	Errors:
+**      connection status or a write timeout.
+**
+**  Notes:
+**
+**      This call is safe to make without checking the connection status.
+**
+**      The connection is corked while the arrays are written, so a header, payload and trailer
+**      kept in separate buffers go out in full segments instead of one small segment each.
+**      If the connection was already corked it is left corked, otherwise it is uncorked
+**      and the rest of the message is flushed at the end.
+**
+*/
+size_t TcpClient::writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers)
+{
+    return(writeStreamV(rgpbWrite, rgcbWrite, cBuffers, DNETcK::_msDefaultTimeout, NULL));
+}
+size_t TcpClient::writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, DNETcK::STATUS * pStatus)
+{
+    return(writeStreamV(rgpbWrite, rgcbWrite, cBuffers, DNETcK::_msDefaultTimeout, pStatus));
+}
+size_t TcpClient::writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, unsigned long msBlockMax)
+{
+    return(writeStreamV(rgpbWrite, rgcbWrite, cBuffers, msBlockMax, NULL));
+}
+size_t TcpClient::writeStreamV(const byte * const *rgpbWrite, const size_t *rgcbWrite, int cBuffers, unsigned long msBlockMax, DNETcK::STATUS * pStatus)
+{
+    unsigned long tStart = 0;
+    unsigned long msElapsed = 0;
+    size_t cbWritten = 0;
+    size_t cbReady = 0;
+    bool fWasCorked = false;
+    int i = 0;
+
+    // make sure we are Connected
+    // this will also run the stack
+    if(!isConnected(DNETcK::msImmediate, pStatus))
+    {
+        return(0);
+    }
+
+    fWasCorked = TCPIsCorked(_hTCP);
+    TCPSetCork(_hTCP, true);
+
+    tStart = millis();
+    for(i = 0; i < cBuffers; i++)
+    {
+        // whatever time is left goes to this array
+        msElapsed = millis() - tStart;
+        cbReady = writeStream(rgpbWrite[i], rgcbWrite[i], msElapsed < msBlockMax ? msBlockMax - msElapsed : 0, pStatus);
+        cbWritten += cbReady;
+
+        if(cbReady < rgcbWrite[i])
+        {
+            break;
+        }
+    }
+
+    // flush out the tail of the message
+    if(!fWasCorked && _hTCP < INVALID_SOCKET)
+    {
+        TCPSetCork(_hTCP, false);
+        EthernetPeriodicTasks();
+    }
+
+    return(cbWritten);
+}
+
+/***	void TcpClient::cork(void)
+**      void TcpClient::uncork(void)
+**
+**	Synopsis:   
+**      Holds back partially filled segments while a message is written in pieces
+**
+**	Parameters:
+**      None
+**
+**	Return Values:
+**      None
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      While corked, writes only put full segments on the wire; a partial
+**      segment waits until more is written, uncork() is called, or about 200ms pass.
+**      uncork() flushes whatever is pending.
+**
+*/
+void TcpClient::cork(void)
+{
+    if(_hTCP < INVALID_SOCKET)
+    {
+        TCPSetCork(_hTCP, true);
+    }
+}
+void TcpClient::uncork(void)
+{
+    if(_hTCP < INVALID_SOCKET)
+    {
+        TCPSetCork(_hTCP, false);
+
+        // make sure the flush runs
+        EthernetPeriodicTasks();
+    }
+}
+
 /***	bool TcpClient::getRemoteMAC(MAC *pRemoteMAC)
 **
 **	Synopsis:   
@@ -789,6 +1011,93 @@ bool TcpClient::getRemoteMAC(MAC *pRemoteMAC)
     return(_fEndPointsSetUp);
 }
 
+/***	void TcpClient::setEventHandler(TcpClientEventHandler pfnEventHandler, void * pvContext)
+**
+**	Synopsis:   
+**      Registers a function to be called when something happens on the connection
+**
+**	Parameters:
+**      pfnEventHandler The function to call, or NULL to stop the calls.
+**
+**      pvContext       Passed back to pfnEventHandler unchanged.
+**
+**	Return Values:
+**      None
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      Instead of polling available() and isConnected(), a sketch can register a handler
+**      and call DNETcK::periodicTasks() from loop(). The handler is called from periodicTasks()
+**      with the events or'ed together:
+**
+**          evConnected     the connection was made (connect() or acceptClient())
+**          evReadable      new bytes arrived; cbReadable is how many bytes can now be read
+**          evWritable      sent bytes were acknowledged; cbWritable is the room now free to write
+**          evClosed        the remote end closed the connection, or it was closed
+**          evError         the connection was reset or refused
+**
+**      Only sockets with something new are visited, idle connections cost nothing.
+**      The handler stays with this instance across close() and connect(), and
+**      can be set before or after connecting or accepting.
+**
+*/
+void TcpClient::setEventHandler(TcpClientEventHandler pfnEventHandler, void * pvContext)
+{
+    _pfnEventHandler = pfnEventHandler;
+    _pvEventContext = pvContext;
+    armEventHandler();
+}
+
+/***	void TcpClient::armEventHandler(void)
+**
+**	Synopsis:   
+**      Hooks (or unhooks) our event thunk to the socket we currently own
+**
+*/
+void TcpClient::armEventHandler(void)
+{
+    if(_hTCP < INVALID_SOCKET)
+    {
+        TCPSetEventHandler(_hTCP, _pfnEventHandler != NULL ? eventThunk : NULL, this);
+    }
+}
+
+/***	void TcpClient::eventThunk(byte hTCP, byte events, void * pvContext)
+**
+**	Synopsis:   
+**      Called by the MAL from TCPDispatchEvents, turns the socket events
+**      into a call to the sketch's handler.
+**
+*/
+void TcpClient::eventThunk(byte hTCP, byte events, void * pvContext)
+{
+    TcpClient * pTcpClient = (TcpClient *) pvContext;
+    size_t cbReadable = 0;
+    size_t cbWritable = 0;
+
+    if(pTcpClient == NULL || pTcpClient->_pfnEventHandler == NULL || pTcpClient->_hTCP != hTCP)
+    {
+        return;
+    }
+
+    // finish setting up the endpoints, just as isConnected would
+    if((events & evConnected) && !pTcpClient->_fEndPointsSetUp)
+    {
+        GetTcpSocketEndPoints(hTCP, &pTcpClient->_remoteEP.ip, &pTcpClient->_remoteMAC, &pTcpClient->_remoteEP.port, &pTcpClient->_localEP.port);
+        DNETcK::getMyIP(&pTcpClient->_localEP.ip);
+        pTcpClient->_fEndPointsSetUp = true;
+        pTcpClient->_classState = DNETcK::Connected;
+    }
+
+    cbReadable = TCPIsGetReady(hTCP);
+    cbWritable = TCPIsPutReady(hTCP);
+
+    pTcpClient->_pfnEventHandler(pTcpClient, events, cbReadable, cbWritable, pTcpClient->_pvEventContext);
+}
+
 /***	bool TcpClient::getRemoteEndPoint(IPEndPoint *pRemoteEP)
 **
 **	Synopsis:   
@@ -55,11 +55,15 @@ TcpServer::TcpServer(TcpServer& tcpServer){};
 **      
 **      Initialize a new TcpServer Instance and specify
 **      maximum number of sockets that it will use.
-**      Only 1 socket is listening at a time on the port
-**      however there may be many sockets pending and accept.
-**      Once all sockets are consumed by unaccepted clients
-**      TcpServer will stop listening on the port until
-**      a client is accepted and a socket opens up.
+**      Up to 2 sockets listen on the port at a time so a
+**      second SYN does not have to wait for the first client
+**      to be moved to the pending list, and there may be many
+**      sockets pending and accept. Once all sockets are consumed
+**      by unaccepted clients TcpServer will stop listening on the
+**      port until a client is accepted and a socket opens up.
+**
+**      cMaxPendingClients is limited to DNETcK_MAX_PENDING_CLIENTS,
+**      which may be defined before DNETcK.h is included.
 **
 */
 TcpServer::TcpServer()
@@ -74,6 +78,10 @@ void TcpServer::construct(int cMaxPendingClients)
 {
     clear();
     _cPendingMax           = cMaxPendingClients;            
+    if(_cPendingMax > _cMaxPendingAllowed) _cPendingMax = _cMaxPendingAllowed;
+    if(_cPendingMax < 1) _cPendingMax = 1;
+    _pfnEventHandler       = NULL;
+    _pvEventContext        = NULL;
 
 }
 
@@ -101,14 +109,21 @@ void TcpServer::clear(void)
     _fListening             = false;
     _localPort              = 0;
     _cPending               = 0;
+    _iHead                  = 0;
+    _cQueued                = 0;
+    _cListening             = 0;
 
     // _cPendingMax;  Don't fill in, this is on the constructor
 
-    // init the array
+    // init the arrays
     for(int i = 0; i<_cMaxPendingAllowed; i++)
     {
         _rghTCP[i] = INVALID_SOCKET;
     }
+    for(int i = 0; i<_cMaxListening; i++)
+    {
+        _rghListening[i] = INVALID_SOCKET;
+    }
 }
 
 /***	TcpServer Destructor
@@ -155,11 +170,7 @@ void TcpServer::close(void)
     {
         if(_rghTCP[i] < INVALID_SOCKET)
         {
-            // clean out the buffer
-            TCPDiscard(_rghTCP[i]);
-
-            // release the resources back to the MAL
-            TCPClose(_rghTCP[i]);
+            releaseSocket(_rghTCP[i]);
 
             // invalidate the socket
             _rghTCP[i] = INVALID_SOCKET;
@@ -169,6 +180,24 @@ void TcpServer::close(void)
     clear();
 }
 
+/***	void TcpServer::releaseSocket(byte hTCP)
+**
+**	Synopsis:   
+**      Gives a listening or pending socket back to the MAL
+**
+*/
+void TcpServer::releaseSocket(byte hTCP)
+{
+    // we are done hearing about it
+    TCPSetEventHandler(hTCP, NULL, NULL);
+
+    // clean out the buffer
+    TCPDiscard(hTCP);
+
+    // release the resources back to the MAL
+    TCPClose(hTCP);
+}
+
 /***	bool TcpServer::startListening(unsigned short localPort)
 **      bool TcpServer::startListening(unsigned short localPort, DNETcK::STATUS * pStatus)
 **
@@ -222,7 +251,7 @@ bool TcpServer::startListening(unsigned short localPort, DNETcK::STATUS * pStatu
     resumeListening();
 
     // see if we are listening
-    if(_rghTCP[_cPending] >=  INVALID_SOCKET)
+    if(_cListening == 0)
     {
         _fStarted = false;
         if(pStatus != NULL) *pStatus = DNETcK::SocketError;
@@ -275,7 +304,7 @@ bool TcpServer::isListening(DNETcK::STATUS * pStatus)
         if(pStatus != NULL) *pStatus = DNETcK::NeedToResumeListening;
         return(false);
     }
-    else if(_rghTCP[_cPending] >= INVALID_UDP_SOCKET)
+    else if(_cListening == 0)
     {
         if(pStatus != NULL) *pStatus = DNETcK::SocketError;
         return(false);
@@ -317,16 +346,11 @@ void TcpServer::stopListening(void)
     // update the pending count so we have them all.
     availableClients();
 
-    if(_cPending < _cPendingMax && _rghTCP[_cPending] < INVALID_SOCKET)
+    while(_cListening > 0)
     {
-        // clean out the buffer
-        TCPDiscard(_rghTCP[_cPending]);
-
-        // release the resources back to the MAL
-        TCPClose(_rghTCP[_cPending]);
-
-        // only invalidate if this is the listening socket
-        _rghTCP[_cPending] = INVALID_SOCKET;
+        _cListening--;
+        releaseSocket(_rghListening[_cListening]);
+        _rghListening[_cListening] = INVALID_SOCKET;
     }
 
     // no longer listening
@@ -350,7 +374,8 @@ void TcpServer::stopListening(void)
 **  Notes:
 **
 **      If StartListening was never called, this does nothing
-**      If it is already listening, it does nothing
+**      If it is already listening, it tops up the listening sockets
+**      if pending clients or the socket pool allow more.
 */
 void TcpServer::resumeListening(void)
 {
@@ -362,18 +387,27 @@ void TcpServer::resumeListening(void)
     // say we want to listen, may fail, but we will pick it up when we can.
     _fListening = true;
 
-    // make sure we have room to to put our handle in
-    if(_cPending >= _cPendingMax)
-    {
-        return;
-    }
-
-    // if we are not currently listening, so attempt to
-    // start listening
-    if(_rghTCP[_cPending] >= INVALID_SOCKET)
+    // listen on as many sockets as we are allowed, leaving
+    // room for the pending clients we already have
+    while(_cListening < _cMaxListening && _cPending + _cListening < _cPendingMax)
     {
         // do not need to check to see if Ethernet is initialized because I can assign sockets before then
-        _rghTCP[_cPending] = TcpServerStartListening(_localPort);
+        byte hTCP = TcpServerStartListening(_localPort);
+
+        if(hTCP >= INVALID_SOCKET)
+        {
+            break;
+        }
+
+        // the stack tells us when the client finishes connecting
+        _rghListening[_cListening++] = hTCP;
+        TCPSetEventHandler(hTCP, eventThunk, this);
+
+        // in case the handshake finished before we were listening for the event
+        if(TCPIsConnected(hTCP))
+        {
+            eventThunk(hTCP, TcpClient::evConnected, this);
+        }
     }
 }
 
@@ -394,56 +428,114 @@ void TcpServer::resumeListening(void)
 **  Notes:
 **
 **      This is the workhorse of the TcpServer Class
-**      It will update pending clients if a connection is detected
+**      It runs the stack, and the stack events move connected clients
+**      to the pending list and remove disconnected clients (see eventThunk),
+**      so the pending sockets themselves are not polled.
 **      It will attempt to start listening if a socket comes avalialbe for listening
-**      It will clean up disconnected clients
 */
 int TcpServer::availableClients(void)
+{
+    EthernetPeriodicTasks();
+
+    // hear about clients connecting and disconnecting
+    TCPDispatchEvents();
+
+    // if we are supposed to be listening, then try to listening
+    if(_fListening)
+    {
+         resumeListening();
+    }
+
+    return(_cPending);
+}
+
+/***	int TcpServer::slotOfClient(int index)
+**
+**	Synopsis:   
+**      Finds where the index'th pending client is in the _rghTCP ring
+**
+**	Return Values:
+**      The slot in _rghTCP, or -1 if there is no such client
+**
+**  Notes:
+**
+**      Index 0, the oldest client, is always at _iHead as removed
+**      entries are never left at the head.
+*/
+int TcpServer::slotOfClient(int index)
 {
     int i = 0;
 
-    EthernetPeriodicTasks();
+    if(index < 0 || index >= _cPending)
+    {
+        return(-1);
+    }
 
-    if(isListening() && TCPIsConnected(_rghTCP[_cPending]))
+    for(i = 0; i < _cQueued; i++)
     {
-        _cPending++;      
+        int iSlot = (_iHead + i) % _cMaxPendingAllowed;
+
+        if(_rghTCP[iSlot] < INVALID_SOCKET && index-- == 0)
+        {
+            return(iSlot);
+        }
     }
 
-    // now look for not Connected ones and remove them out of the list
-    while(i < _cPending)
+    return(-1);
+}
+
+/***	void TcpServer::queueClient(byte hTCP)
+**
+**	Synopsis:   
+**      Adds a newly connected socket to the end of the pending ring
+**
+*/
+void TcpServer::queueClient(byte hTCP)
+{
+    // the ring is only full if it still holds removed entries;
+    // squeeze them out, pending clients never fill it
+    if(_cQueued >= _cMaxPendingAllowed)
     {
-        // see if we need to clear this one
-        if((_rghTCP[i] >= INVALID_SOCKET) || (!TCPIsConnected(_rghTCP[i]) && (TCPIsGetReady(_rghTCP[i]) == 0)) )
+        int iTo = 0;
+
+        for(int iFrom = 0; iFrom < _cQueued; iFrom++)
         {
-            int j = i;
+            byte hT = _rghTCP[(_iHead + iFrom) % _cMaxPendingAllowed];
 
-            // shift everyone from this location down.
-            // include everything possible (_cPendingMax), even things beyond _cPending
-            // because I want to shift the listening one at _rghUDP[_cPending] as well
-            for(; j < _cPendingMax-1; j++)
+            if(hT < INVALID_SOCKET)
             {
-                _rghTCP[j] = _rghTCP[j+1];
+                _rghTCP[(_iHead + iTo++) % _cMaxPendingAllowed] = hT;
             }
-
-            // make sure the last one in the list is made an invalid socket
-            _rghTCP[_cPendingMax-1] = INVALID_SOCKET;
-
-            // reduce the pending count
-            _cPending--;
         }
-        else
+
+        for(_cQueued = iTo; iTo < _cMaxPendingAllowed; iTo++)
         {
-            i++;
+            _rghTCP[(_iHead + iTo) % _cMaxPendingAllowed] = INVALID_SOCKET;
         }
     }
 
-    // if we are supposed to be listening, then try to listening
-    if(_fListening)
+    _rghTCP[(_iHead + _cQueued) % _cMaxPendingAllowed] = hTCP;
+    _cQueued++;
+    _cPending++;
+}
+
+/***	void TcpServer::removeClient(int iSlot)
+**
+**	Synopsis:   
+**      Takes a pending client out of the ring without moving the others
+**
+*/
+void TcpServer::removeClient(int iSlot)
+{
+    _rghTCP[iSlot] = INVALID_SOCKET;
+    _cPending--;
+
+    // move the head past anything removed
+    while(_cQueued > 0 && _rghTCP[_iHead] >= INVALID_SOCKET)
     {
-         resumeListening();
+        _iHead = (_iHead + 1) % _cMaxPendingAllowed;
+        _cQueued--;
     }
-
-    return(_cPending);
 }
 
 /***	bool TcpServer::acceptClient(TcpClient * pTcpClient)
@@ -492,6 +584,8 @@ bool TcpServer::acceptClient(TcpClient * pTcpClient, DNETcK::STATUS * pStatus)
 }
 bool TcpServer::acceptClient(TcpClient * pTcpClient, int index, DNETcK::STATUS * pStatus)
 {
+    int iSlot = 0;
+
     // careful not to run PendingClients or IsListening so that the index
     // doesn't move on us.
     if(pTcpClient == NULL)
@@ -521,12 +615,17 @@ bool TcpServer::acceptClient(TcpClient * pTcpClient, int index, DNETcK::STATUS *
     pTcpClient->construct();
  
     // okay, I think I can make a TcpClient.
-    pTcpClient->_hTCP = _rghTCP[index];
+    iSlot = slotOfClient(index);
+    pTcpClient->_hTCP = _rghTCP[iSlot];
     pTcpClient->_classState = DNETcK::WaitingConnect; // this will allow IsConnected to finish out the client
     pTcpClient->_fEndPointsSetUp = false;
 
+    // events on this socket now go to the client, if it wants them
+    TCPSetEventHandler(pTcpClient->_hTCP, NULL, NULL);
+    pTcpClient->armEventHandler();
+
     // this will readjust our list to the right size
-    _rghTCP[index] = INVALID_SOCKET;
+    removeClient(iSlot);
     availableClients();
 
     // Now fix up the remote endpoints and stuff
@@ -584,14 +683,15 @@ bool TcpServer::getAvailableClientsRemoteEndPoint(IPEndPoint *pRemoteEP, MAC * p
     IPEndPoint remoteEP;
     unsigned short localPort;
     MAC macRemote;
+    int iSlot = slotOfClient(index);
 
-    if(index >= _cPending)
+    if(iSlot < 0)
     {
         return(false);
     } 
 
     // careful not to run PendingClients or IsListening so index order does not change
-    GetTcpSocketEndPoints(_rghTCP[index], &remoteEP.ip, &macRemote, &remoteEP.port, &localPort);
+    GetTcpSocketEndPoints(_rghTCP[iSlot], &remoteEP.ip, &macRemote, &remoteEP.port, &localPort);
 
     if(pRemoteEP != 0)
     {
@@ -602,6 +702,8 @@ bool TcpServer::getAvailableClientsRemoteEndPoint(IPEndPoint *pRemoteEP, MAC * p
     {
         *pRemoteMAC = macRemote;
     }
+
+    return(true);
 }
 
 /***	bool TcpServer::getListeningEndPoint(IPEndPoint *pListeningEP)
@@ -632,5 +734,99 @@ bool TcpServer::getListeningEndPoint(IPEndPoint *pListeningEP)
     return(DNETcK::getMyIP(&pListeningEP->ip));
 }
 
+/***	void TcpServer::setEventHandler(TcpServerEventHandler pfnEventHandler, void * pvContext)
+**
+**	Synopsis:   
+**      Registers a function to be called when a client connects
+**
+**	Parameters:
+**      pfnEventHandler The function to call, or NULL to stop the calls.
+**
+**      pvContext       Passed back to pfnEventHandler unchanged.
+**
+**	Return Values:
+**      None
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      Instead of polling availableClients(), a sketch can register a handler and
+**      call DNETcK::periodicTasks() from loop(). When a client finishes connecting
+**      to the listening socket, the handler is called from periodicTasks() with the
+**      number of pending clients, and can call acceptClient() right there.
+**
+*/
+void TcpServer::setEventHandler(TcpServerEventHandler pfnEventHandler, void * pvContext)
+{
+    _pfnEventHandler = pfnEventHandler;
+    _pvEventContext = pvContext;
+}
+
+/***	void TcpServer::eventThunk(byte hTCP, byte events, void * pvContext)
+**
+**	Synopsis:   
+**      Called by the MAL from TCPDispatchEvents for the listening and pending sockets.
+**      Moves a socket that finished connecting to the pending list, calling the sketch's
+**      handler, and removes pending clients that disconnected before being accepted.
+**
+*/
+void TcpServer::eventThunk(byte hTCP, byte events, void * pvContext)
+{
+    TcpServer * pTcpServer = (TcpServer *) pvContext;
+    int i = 0;
+
+    if(pTcpServer == NULL)
+    {
+        return;
+    }
+
+    // a listening socket got a client
+    if(events & TcpClient::evConnected)
+    {
+        for(i = 0; i < pTcpServer->_cListening && pTcpServer->_rghListening[i] != hTCP; i++);
+
+        if(i < pTcpServer->_cListening)
+        {
+            pTcpServer->_cListening--;
+            pTcpServer->_rghListening[i] = pTcpServer->_rghListening[pTcpServer->_cListening];
+            pTcpServer->_rghListening[pTcpServer->_cListening] = INVALID_SOCKET;
+            pTcpServer->queueClient(hTCP);
+
+            // put another socket in its place
+            if(pTcpServer->_fListening)
+            {
+                pTcpServer->resumeListening();
+            }
+
+            if(pTcpServer->_pfnEventHandler != NULL)
+            {
+                pTcpServer->_pfnEventHandler(pTcpServer, pTcpServer->_cPending, pTcpServer->_pvEventContext);
+            }
+        }
+    }
+
+    // a pending client went away; keep it while there is still something to read
+    if((events & (TcpClient::evClosed | TcpClient::evError)) && !TCPIsConnected(hTCP) && TCPIsGetReady(hTCP) == 0)
+    {
+        for(i = 0; i < pTcpServer->_cQueued; i++)
+        {
+            int iSlot = (pTcpServer->_iHead + i) % _cMaxPendingAllowed;
+
+            if(pTcpServer->_rghTCP[iSlot] == hTCP)
+            {
+                releaseSocket(hTCP);
+                pTcpServer->removeClient(iSlot);
+                if(pTcpServer->_fListening)
+                {
+                    pTcpServer->resumeListening();
+                }
+                break;
+            }
+        }
+    }
+}
+
 
 
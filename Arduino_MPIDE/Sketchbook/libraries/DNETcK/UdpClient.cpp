@@ -659,6 +659,87 @@ size_t UdpClient::readDatagram(byte *rgbRead, size_t cbReadMax)
     return((unsigned int) cbPeek);
 }
 
+/***	size_t UdpClient::borrowDatagram(const byte **ppbDatagram)
+**
+**	Synopsis:   
+**      Gets a pointer to the unread bytes of the next datagram without copying them
+**
+**	Parameters:
+**      ppbDatagram     A pointer to receive the address of the datagram bytes in the cache.
+**
+**	Return Values:
+**      The number of bytes at *ppbDatagram. 0 is returned if no datagram is in the cache.
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      The bytes stay in the cache; call discardDatagram() when done with them.
+**      The pointer is only good until the datagram is discarded or read, or until the
+**      stack is run again (available(), periodicTasks()...) as new datagrams may push it out.
+**
+*/
+size_t UdpClient::borrowDatagram(const byte **ppbDatagram)
+{
+    unsigned short cbDatagram = 0;
+
+    *ppbDatagram = UdpClientBorrowDataGram(_hUDP, &cbDatagram);
+    return((unsigned int) cbDatagram);
+}
+
+/***	bool UdpClient::getDatagramRemoteEndPoint(IPEndPoint *pRemoteEP)
+**
+**	Synopsis:   
+**      Gets the endpoint that sent the next datagram in the cache
+**
+**	Parameters:
+**      pRemoteEP  A pointer to an IPEndPoint to receive the sender's IP and port.
+**
+**	Return Values:
+**      true    The sender was returned.
+**      false   There is no datagram in the cache.
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      This is useful on a broadcast socket where datagrams come in from many senders,
+**      getRemoteEndPoint() only returns who we are sending to.
+**
+*/
+bool UdpClient::getDatagramRemoteEndPoint(IPEndPoint *pRemoteEP)
+{
+    return(UdpClientGetDataGramSource(_hUDP, pRemoteEP->ip.rgbIP, &pRemoteEP->port));
+}
+
+/***	bool UdpClient::getDatagramAge(unsigned long *pmsAge)
+**
+**	Synopsis:   
+**      Gets how long ago the next datagram in the cache was received
+**
+**	Parameters:
+**      pmsAge  A pointer to receive the milliseconds since the datagram came in.
+**
+**	Return Values:
+**      true    The age was returned.
+**      false   There is no datagram in the cache.
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      The datagram is timestamped when the stack moves it into the cache, which
+**      happens whenever the stack is run (available(), periodicTasks()...).
+**
+*/
+bool UdpClient::getDatagramAge(unsigned long *pmsAge)
+{
+    return(UdpClientGetDataGramAge(_hUDP, pmsAge));
+}
+
 /***	int UdpClient::writeDatagram(const byte *rgbWrite, size_t cbWrite)
 **
 **
@@ -713,6 +794,75 @@ long int UdpClient::writeDatagram(const byte *rgbWrite, size_t cbWrite)
     EthernetPeriodicTasks();
 }
 
+/***	size_t UdpClient::writeDatagrams(const UdpDatagram *rgDatagrams, size_t cDatagrams)
+**
+**
+**	Synopsis:   
+**      Sends a batch of datagrams from this instance, back to back
+**
+**	Parameters:
+**      rgDatagrams     An array of datagrams, each a pointer to its bytes, its length
+**                          and the UdpClient whose remote endpoint it goes to, NULL for this one
+**
+**      cDatagrams      The number of datagrams in rgDatagrams
+**
+**	Return Values:
+**      The number of datagrams sent. 0 is returned if the endpoint is not resolved.
+**
+**	Errors:
+**      If a datagram is too big for the output buffer, or it goes to a UdpClient
+**      whose endpoint is not resolved, it and everything after it are not sent.
+**
+**  Notes:
+**
+**      The headers are built once for each run of datagrams to the same endpoint, and
+**      the datagrams are sent straight out of rgDatagrams, no copies are made.
+**      To fan out to several endpoints, keep a UdpClient per endpoint and point
+**      pudpRemote at it; the endpoints are only resolved once, in setEndPoint, and
+**      every datagram goes out from this instance's local port.
+**
+*/
+size_t UdpClient::writeDatagrams(const UdpDatagram *rgDatagrams, size_t cDatagrams)
+{
+    MALUdpDatagram rgBatch[cWriteDatagramsBatch];
+    size_t cSent = 0;
+
+    // isDNETcK::EndPointResolved will call periodic tasks
+    if(isEndPointResolved(DNETcK::msImmediate))
+    {
+        // the MAL wants the other endpoints as socket handles
+        while(cSent < cDatagrams)
+        {
+            unsigned short cBatch = 0;
+            unsigned short cBatchSent;
+
+            while(cBatch < cWriteDatagramsBatch && cSent + cBatch < cDatagrams)
+            {
+                const UdpDatagram * pDatagram = &rgDatagrams[cSent + cBatch];
+
+                if(pDatagram->pudpRemote != NULL && !pDatagram->pudpRemote->_fEndPointsSetUp)
+                {
+                    break;
+                }
+
+                rgBatch[cBatch].rgbDatagram = pDatagram->rgbDatagram;
+                rgBatch[cBatch].cbDatagram = pDatagram->cbDatagram;
+                rgBatch[cBatch].hUDPRemote = pDatagram->pudpRemote == NULL ? INVALID_UDP_SOCKET : pDatagram->pudpRemote->_hUDP;
+                cBatch++;
+            }
+
+            cBatchSent = UDPPutDatagrams(_hUDP, rgBatch, cBatch);
+            cSent += cBatchSent;
+            if(cBatchSent < cWriteDatagramsBatch)
+            {
+                break;
+            }
+        }
+    }
+
+    return(cSent);
+}
+
 /***	bool UdpClient::getRemoteEndPoint(IPEndPoint *pRemoteEP)
 **
 **	Synopsis:   
@@ -0,0 +1,500 @@
+/************************************************************************/
+/*																		*/
+/*	dnetckperf.c	--  PC side of the TCP and UDP performance tests    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Drives the test servers a sketch gets with                          */
+/*	STACK_USE_TCP_PERFORMANCE_TEST and STACK_USE_UDP_PERFORMANCE_TEST,  */
+/*	see TCPPerformanceTest.h and UDPPerformanceTest.h for the wire      */
+/*	formats.  This is a POSIX program for the PC, it is not part of     */
+/*	the library:                                                        */
+/*																		*/
+/*		cc -O2 -o dnetckperf dnetckperf.c                               */
+/*		./dnetckperf -t 10 -n 2 192.168.1.190 tcp-tx                    */
+/*																		*/
+/*	Each test prints what this end measured followed by the report      */
+/*	the board sent.  To separate the stack from the PIC32 and its MAC,  */
+/*	build the same stack on the PC with HOST_MAC and HOST_MAC_TAP,      */
+/*	give tap0 an address on the stack's subnet, and run the same tests  */
+/*	against it.                                                         */
+/*																		*/
+/************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Must match TCPPerformanceTest.h and UDPPerformanceTest.h
+#define TCP_PERF_TX_PORT		9762
+#define TCP_PERF_RX_PORT		9763
+#define TCP_PERF_RR_PORT		9764
+#define TCP_PERF_STATS_PORT		9765
+#define UDP_PERF_PORT			9766
+
+#define MAX_CONNECTIONS			64
+#define MAX_DATAGRAM			1472
+#define REPORT_WAIT_MS			2000
+
+typedef struct
+{
+	int			fd;
+	uint8_t		rgbBuff[65536];
+	size_t		cbHave;				// RR: bytes of the current echo received
+	uint64_t	qwSent;				// RR: when the current request went out
+	uint64_t	qwBytes;
+	uint64_t	qwExchanges;
+} CONNECTION;
+
+static int			_cSeconds = 10;
+static int			_cConnections = 1;
+static int			_cbSize = 0;
+static uint32_t		_cDatagrams = 10000;
+static uint32_t		_cRate = 0;
+
+static const char	*_szHost;
+static struct sockaddr_in	_saBoard;
+
+static CONNECTION	_rgConn[MAX_CONNECTIONS];
+static double		*_rgRtt;
+static size_t		_cRtt, _cRttMax;
+
+static uint64_t NowUs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000u;
+}
+
+static void Fail(const char *szWhat)
+{
+	perror(szWhat);
+	exit(1);
+}
+
+static void Usage(void)
+{
+	fprintf(stderr,
+		"usage: dnetckperf [options] board test\n"
+		"tests:\n"
+		"  tcp-tx   the board sends, we read\n"
+		"  tcp-rx   we send, the board reads\n"
+		"  tcp-rr   request/response latency, -s is the request size (2..256)\n"
+		"  udp-tx   the board blasts -c datagrams of -s bytes at us\n"
+		"  udp-rx   we blast -c datagrams of -s bytes at the board\n"
+		"options:\n"
+		"  -t sec   length of a TCP test (10)\n"
+		"  -n num   TCP connections at once (1), see TCP_PERF_SOCKETS\n"
+		"  -s size  bytes per write, request or datagram\n"
+		"  -c num   datagrams in a UDP blast (10000)\n"
+		"  -r pps   udp-rx datagrams per second, 0 for as fast as we can (0)\n");
+	exit(2);
+}
+
+static void SetNonBlocking(int fd)
+{
+	if(fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0)
+		Fail("fcntl");
+}
+
+static int Connect(int port)
+{
+	struct sockaddr_in sa = _saBoard;
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+
+	if(fd < 0)
+		Fail("socket");
+	sa.sin_port = htons(port);
+	if(connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		Fail("connect");
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	SetNonBlocking(fd);
+	return fd;
+}
+
+static int OpenUdp(int port)
+{
+	struct sockaddr_in sa;
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	int cb = 4 << 20;
+
+	if(fd < 0)
+		Fail("socket");
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &cb, sizeof(cb));
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_ANY);
+	sa.sin_port = htons(port);
+	if(bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		Fail("bind");
+	return fd;
+}
+
+// Waits for a report line starting with szTest on fd, prints it and the
+// time we measured against the board's
+static void PrintReport(int fd, const char *szTest)
+{
+	char szLine[256];
+	struct pollfd pfd = {fd, POLLIN, 0};
+	uint64_t qwEnd = NowUs() + REPORT_WAIT_MS * 1000u;
+	ssize_t cb;
+
+	while(NowUs() < qwEnd && poll(&pfd, 1, (int)((qwEnd - NowUs()) / 1000u)) > 0)
+	{
+		cb = recv(fd, szLine, sizeof(szLine) - 1, 0);
+		if(cb <= 0)
+			continue;
+		szLine[cb] = '\0';
+		if(strncmp(szLine, szTest, strlen(szTest)) != 0)
+			continue;
+		printf("board: %s", szLine);
+		return;
+	}
+	printf("board: no report\n");
+}
+
+static void PrintRate(const char *szWho, uint64_t qwBytes, uint64_t qwUs)
+{
+	printf("%s: %llu bytes in %.3f s, %.1f kbit/s\n", szWho,
+		(unsigned long long)qwBytes, qwUs / 1e6, qwUs ? qwBytes * 8000.0 / qwUs : 0.0);
+}
+
+static int CompareDouble(const void *a, const void *b)
+{
+	double d = *(const double *)a - *(const double *)b;
+
+	return d < 0 ? -1 : d > 0;
+}
+
+static void AddRtt(double dMs)
+{
+	if(_cRtt == _cRttMax)
+	{
+		_cRttMax = _cRttMax ? 2 * _cRttMax : 4096;
+		_rgRtt = realloc(_rgRtt, _cRttMax * sizeof(double));
+		if(_rgRtt == NULL)
+			Fail("realloc");
+	}
+	_rgRtt[_cRtt++] = dMs;
+}
+
+static void SendRequest(CONNECTION *pConn)
+{
+	ssize_t cb;
+
+	pConn->rgbBuff[0] = (uint8_t)(_cbSize >> 8);
+	pConn->rgbBuff[1] = (uint8_t)_cbSize;
+	pConn->cbHave = 0;
+	pConn->qwSent = NowUs();
+
+	// the request is far smaller than the socket buffer
+	cb = send(pConn->fd, pConn->rgbBuff, _cbSize, 0);
+	if(cb != _cbSize)
+		Fail("send");
+}
+
+static void RunTcp(const char *szTest)
+{
+	struct pollfd rgpfd[MAX_CONNECTIONS];
+	uint64_t qwStart, qwEnd, qwBytes = 0, qwExchanges = 0;
+	int fdStats = OpenUdp(TCP_PERF_STATS_PORT);
+	int port, i;
+	short events;
+	ssize_t cb;
+
+	if(strcmp(szTest, "tcp-tx") == 0)
+	{
+		port = TCP_PERF_TX_PORT;
+		events = POLLIN;
+		if(_cbSize == 0)
+			_cbSize = sizeof(_rgConn[0].rgbBuff);
+	}
+	else if(strcmp(szTest, "tcp-rx") == 0)
+	{
+		port = TCP_PERF_RX_PORT;
+		events = POLLOUT;
+		if(_cbSize == 0)
+			_cbSize = 1460;
+	}
+	else
+	{
+		port = TCP_PERF_RR_PORT;
+		events = POLLIN;
+		if(_cbSize == 0)
+			_cbSize = 32;
+		if(_cbSize < 2)
+			_cbSize = 2;
+		if(_cbSize > 256)
+			_cbSize = 256;
+	}
+	if(_cbSize > (int)sizeof(_rgConn[0].rgbBuff))
+		_cbSize = sizeof(_rgConn[0].rgbBuff);
+
+	for(i = 0; i < _cConnections; i++)
+	{
+		_rgConn[i].fd = Connect(port);
+		memset(_rgConn[i].rgbBuff, 0x55, sizeof(_rgConn[i].rgbBuff));
+		rgpfd[i].fd = _rgConn[i].fd;
+		rgpfd[i].events = events;
+	}
+
+	qwStart = NowUs();
+	qwEnd = qwStart + (uint64_t)_cSeconds * 1000000u;
+
+	if(port == TCP_PERF_RR_PORT)
+		for(i = 0; i < _cConnections; i++)
+			SendRequest(&_rgConn[i]);
+
+	while(NowUs() < qwEnd)
+	{
+		if(poll(rgpfd, _cConnections, 100) < 0 && errno != EINTR)
+			Fail("poll");
+
+		for(i = 0; i < _cConnections; i++)
+		{
+			CONNECTION *pConn = &_rgConn[i];
+
+			if(rgpfd[i].revents & (POLLERR | POLLHUP))
+			{
+				fprintf(stderr, "connection %d closed by the board\n", i);
+				exit(1);
+			}
+			if(rgpfd[i].revents == 0)
+				continue;
+
+			if(port == TCP_PERF_TX_PORT)
+				cb = recv(pConn->fd, pConn->rgbBuff, _cbSize, 0);
+			else if(port == TCP_PERF_RX_PORT)
+				cb = send(pConn->fd, pConn->rgbBuff, _cbSize, 0);
+			else
+				cb = recv(pConn->fd, pConn->rgbBuff + pConn->cbHave, _cbSize - pConn->cbHave, 0);
+
+			if(cb < 0 && (errno == EAGAIN || errno == EINTR))
+				continue;
+			if(cb <= 0)
+				Fail("connection");
+			pConn->qwBytes += cb;
+
+			if(port == TCP_PERF_RR_PORT && (pConn->cbHave += cb) == (size_t)_cbSize)
+			{
+				AddRtt((NowUs() - pConn->qwSent) / 1000.0);
+				pConn->qwExchanges++;
+				SendRequest(pConn);
+			}
+		}
+	}
+	qwEnd = NowUs();
+
+	for(i = 0; i < _cConnections; i++)
+	{
+		qwBytes += _rgConn[i].qwBytes;
+		qwExchanges += _rgConn[i].qwExchanges;
+		close(_rgConn[i].fd);
+	}
+
+	PrintRate("host", qwBytes, qwEnd - qwStart);
+	if(port == TCP_PERF_RR_PORT && _cRtt != 0)
+	{
+		double dSum = 0;
+		size_t j;
+
+		qsort(_rgRtt, _cRtt, sizeof(double), CompareDouble);
+		for(j = 0; j < _cRtt; j++)
+			dSum += _rgRtt[j];
+		printf("host: %llu exchanges, %.0f/s, rtt ms min %.3f avg %.3f p50 %.3f p99 %.3f max %.3f\n",
+			(unsigned long long)qwExchanges, qwExchanges * 1e6 / (qwEnd - qwStart),
+			_rgRtt[0], dSum / _cRtt, _rgRtt[_cRtt / 2], _rgRtt[_cRtt * 99 / 100], _rgRtt[_cRtt - 1]);
+	}
+
+	for(i = 0; i < _cConnections; i++)
+		PrintReport(fdStats, szTest);
+	close(fdStats);
+}
+
+static void RunUdpTx(void)
+{
+	uint8_t rgb[MAX_DATAGRAM + 1];
+	struct pollfd pfd;
+	uint64_t qwStart = 0, qwLast = 0, qwBytes = 0;
+	uint32_t cReceived = 0, cReordered = 0, dwNext = 0, dwSeq;
+	int fd = OpenUdp(0);
+	ssize_t cb;
+
+	if(_cbSize == 0)
+		_cbSize = 1024;
+	if(connect(fd, (struct sockaddr *)&_saBoard, sizeof(_saBoard)) < 0)
+		Fail("connect");
+
+	rgb[0] = 'T';
+	rgb[1] = 0;
+	rgb[2] = (uint8_t)(_cbSize >> 8);
+	rgb[3] = (uint8_t)_cbSize;
+	rgb[4] = (uint8_t)(_cDatagrams >> 24);
+	rgb[5] = (uint8_t)(_cDatagrams >> 16);
+	rgb[6] = (uint8_t)(_cDatagrams >> 8);
+	rgb[7] = (uint8_t)_cDatagrams;
+	if(send(fd, rgb, 8, 0) != 8)
+		Fail("send");
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while(poll(&pfd, 1, REPORT_WAIT_MS) > 0)
+	{
+		cb = recv(fd, rgb, MAX_DATAGRAM, 0);
+		if(cb < 8)
+			continue;
+
+		if(rgb[0] != 'D')
+		{
+			rgb[cb] = '\0';
+			if(strncmp((char *)rgb, "udp-tx", 6) != 0)
+				continue;
+			printf("host: %u datagrams, %u lost, %u reordered\n", cReceived,
+				_cDatagrams > cReceived ? _cDatagrams - cReceived : 0, cReordered);
+			PrintRate("host", qwBytes, qwLast - qwStart);
+			printf("board: %s", (char *)rgb);
+			close(fd);
+			return;
+		}
+
+		qwLast = NowUs();
+		if(cReceived++ == 0)
+			qwStart = qwLast;
+		qwBytes += cb;
+		dwSeq = ((uint32_t)rgb[4] << 24) | ((uint32_t)rgb[5] << 16) | ((uint32_t)rgb[6] << 8) | rgb[7];
+		if(dwSeq < dwNext)
+			cReordered++;
+		else
+			dwNext = dwSeq + 1;
+	}
+
+	printf("host: %u datagrams, board report lost\n", cReceived);
+	PrintRate("host", qwBytes, qwLast - qwStart);
+	close(fd);
+}
+
+static void RunUdpRx(void)
+{
+	uint8_t rgb[MAX_DATAGRAM];
+	uint64_t qwStart, qwNext;
+	uint32_t dwSeq;
+	int fd = OpenUdp(0);
+
+	if(_cbSize == 0)
+		_cbSize = 1024;
+	if(_cbSize < 8)
+		_cbSize = 8;
+	if(_cbSize > MAX_DATAGRAM)
+		_cbSize = MAX_DATAGRAM;
+	if(connect(fd, (struct sockaddr *)&_saBoard, sizeof(_saBoard)) < 0)
+		Fail("connect");
+
+	memset(rgb, 0x55, sizeof(rgb));
+	rgb[0] = 'D';
+	rgb[1] = rgb[2] = rgb[3] = 0;
+
+	qwStart = qwNext = NowUs();
+	for(dwSeq = 0; dwSeq < _cDatagrams; dwSeq++)
+	{
+		if(_cRate != 0)
+		{
+			while(NowUs() < qwNext)
+				;
+			qwNext += 1000000u / _cRate;
+		}
+		rgb[4] = (uint8_t)(dwSeq >> 24);
+		rgb[5] = (uint8_t)(dwSeq >> 16);
+		rgb[6] = (uint8_t)(dwSeq >> 8);
+		rgb[7] = (uint8_t)dwSeq;
+		while(send(fd, rgb, _cbSize, 0) < 0)
+			if(errno != ENOBUFS && errno != EAGAIN)
+				Fail("send");
+	}
+	PrintRate("host", (uint64_t)_cDatagrams * _cbSize, NowUs() - qwStart);
+
+	rgb[0] = 'F';
+	if(send(fd, rgb, 1, 0) != 1)
+		Fail("send");
+	PrintReport(fd, "udp-rx");
+	close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+	struct addrinfo hints, *pai;
+	const char *szTest;
+	int opt;
+
+	while((opt = getopt(argc, argv, "t:n:s:c:r:")) != -1)
+	{
+		switch(opt)
+		{
+			case 't': _cSeconds = atoi(optarg); break;
+			case 'n': _cConnections = atoi(optarg); break;
+			case 's': _cbSize = atoi(optarg); break;
+			case 'c': _cDatagrams = strtoul(optarg, NULL, 0); break;
+			case 'r': _cRate = strtoul(optarg, NULL, 0); break;
+			default: Usage();
+		}
+	}
+	if(argc - optind != 2 || _cConnections < 1 || _cConnections > MAX_CONNECTIONS)
+		Usage();
+	_szHost = argv[optind];
+	szTest = argv[optind + 1];
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	if(getaddrinfo(_szHost, NULL, &hints, &pai) != 0)
+	{
+		fprintf(stderr, "can't resolve %s\n", _szHost);
+		return 1;
+	}
+	_saBoard = *(struct sockaddr_in *)pai->ai_addr;
+	_saBoard.sin_port = htons(UDP_PERF_PORT);
+	freeaddrinfo(pai);
+
+	if(strcmp(szTest, "tcp-tx") == 0 || strcmp(szTest, "tcp-rx") == 0 || strcmp(szTest, "tcp-rr") == 0)
+		RunTcp(szTest);
+	else if(strcmp(szTest, "udp-tx") == 0)
+		RunUdpTx();
+	else if(strcmp(szTest, "udp-rx") == 0)
+		RunUdpRx();
+	else
+		Usage();
+
+	return 0;
+}
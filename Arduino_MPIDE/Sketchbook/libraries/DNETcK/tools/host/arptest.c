@@ -0,0 +1,483 @@
+/************************************************************************/
+/*																		*/
+/*	arptest.c	--  ARP.c's cache on a segment of many hosts            */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	One port on the switch plays ARP_TEST_HOSTS hosts and the gateway,	*/
+/*	each with its own MAC, answering the stack's ARP requests for them	*/
+/*	(unless told to keep quiet) and counting the requests and the TCP	*/
+/*	SYNs each is sent.  Only StackTask() is run, so the DNS and SNTP	*/
+/*	clients ask for nobody behind the test's back.						*/
+/*																		*/
+/*	Many ARPResolve() calls for one host must put one request on the	*/
+/*	wire per ARP_TEST_HOLDOFF_MS; ARP_CACHE_SIZE hosts must be			*/
+/*	resolved at once, and one more must push out the one looked up		*/
+/*	longest ago.  Responses nobody asked for add nothing, a request		*/
+/*	from a cached host updates its MAC, off subnet hosts resolve to		*/
+/*	the gateway and entries are forgotten after ARP_CACHE_TIMEOUT.		*/
+/*																		*/
+/*	ARP.c queues no packets on an incomplete entry: the modules poll	*/
+/*	ARPIsResolved() from their own state machines.  So several TCP		*/
+/*	sockets connecting to one silent host must share one request per	*/
+/*	holdoff, and each send its SYN once the host answers.				*/
+/*																		*/
+/*	Then the hosts are resolved at random, with the cache far smaller	*/
+/*	than the segment, and every lookup must give the right MAC.			*/
+/*																		*/
+/*		arptest [-n lookups]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define ARP_TEST_HOSTS			(40u)
+#define ARP_TEST_FIRST			(10u)		// hosts are 192.168.1.10 on
+#define ARP_TEST_GATEWAY		(ARP_TEST_HOSTS)
+#define ARP_TEST_HOLDOFF_MS		(250u)		// ARP.c's ARP_REQUEST_HOLDOFF
+#define ARP_TEST_ANSWER_MS		(50u)		// long enough for a request and its answer
+#define ARP_TEST_PORT			(8080u)
+
+#if !defined(ARP_CACHE_SIZE) || !defined(ARP_CACHE_TIMEOUT)
+	#error "arptest needs ARP_CACHE_SIZE and ARP_CACHE_TIMEOUT, see the Makefile"
+#endif
+
+typedef struct
+{
+	NODE_INFO	node;
+	BOOL		bSilent;					// records requests but does not answer
+	WORD		cRequests;					// ARP requests for it
+	WORD		cSyns;						// TCP SYNs sent to it
+} ARP_TEST_HOST;
+
+static ARP_TEST_HOST _rgHost[ARP_TEST_HOSTS + 1];		// the gateway last
+static BYTE _port;
+static BYTE _rgbFrame[HOST_MAC_FRAME_SIZE];
+
+static ARP_TEST_HOST *FindHost(DWORD dwIP)
+{
+	WORD i;
+
+	for(i = 0; i <= ARP_TEST_HOSTS; i++)
+		if(_rgHost[i].node.IPAddr.Val == dwIP)
+			return &_rgHost[i];
+	return NULL;
+}
+
+static ARP_TEST_HOST *FindHostByMAC(const MAC_ADDR *pMAC)
+{
+	WORD i;
+
+	for(i = 0; i <= ARP_TEST_HOSTS; i++)
+		if(memcmp(&_rgHost[i].node.MACAddr, pMAC, sizeof(MAC_ADDR)) == 0)
+			return &_rgHost[i];
+	return NULL;
+}
+
+// An ARP packet from pHost to the stack
+static void SendArp(ARP_TEST_HOST *pHost, WORD wOperation)
+{
+	ETHER_HEADER *pEther = (ETHER_HEADER*)_rgbFrame;
+	ARP_PACKET *pArp = (ARP_PACKET*)(pEther + 1);
+
+	pEther->DestMACAddr = AppConfig.MyMACAddr;
+	pEther->SourceMACAddr = pHost->node.MACAddr;
+	pEther->Type.Val = swaps(0x0806);
+
+	pArp->HardwareType = HW_ETHERNET;
+	pArp->Protocol = 0x0800;
+	pArp->MACAddrLen = sizeof(MAC_ADDR);
+	pArp->ProtocolLen = sizeof(IP_ADDR);
+	pArp->Operation = wOperation;
+	pArp->SenderMACAddr = pHost->node.MACAddr;
+	pArp->SenderIPAddr = pHost->node.IPAddr;
+	pArp->TargetMACAddr = AppConfig.MyMACAddr;
+	pArp->TargetIPAddr = AppConfig.MyIPAddr;
+	SwapARPPacket(pArp);
+
+	HostMACSend(_port, _rgbFrame, sizeof(ETHER_HEADER) + sizeof(ARP_PACKET));
+}
+
+/*****************************************************************************
+  Function:
+	static void Serve(void)
+
+  Summary:
+	Handles the frames that reached the hosts' port
+
+  Description:
+	ARP requests are counted against the host asked for, and answered
+	unless it is silent.  TCP segments with SYN set are counted against
+	the host whose MAC they were sent to.  Everything else is dropped.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void Serve(void)
+{
+	static BYTE rgbIn[HOST_MAC_FRAME_SIZE];
+	ETHER_HEADER *pEther = (ETHER_HEADER*)rgbIn;
+	ARP_PACKET *pArp = (ARP_PACKET*)(pEther + 1);
+	IP_HEADER *pIP = (IP_HEADER*)(pEther + 1);
+	ARP_TEST_HOST *pHost;
+	BYTE *pTCP;
+
+	while(HostMACReceive(_port, rgbIn, sizeof(rgbIn)) != 0u)
+	{
+		if(pEther->Type.Val == swaps(0x0806))
+		{
+			SwapARPPacket(pArp);
+			if(pArp->Operation != ARP_OPERATION_REQ || (pHost = FindHost(pArp->TargetIPAddr.Val)) == NULL)
+				continue;
+
+			pHost->cRequests++;
+			if(!pHost->bSilent)
+				SendArp(pHost, ARP_OPERATION_RESP);
+		}
+		else if(pEther->Type.Val == swaps(0x0800) && pIP->Protocol == IP_PROT_TCP)
+		{
+			pTCP = (BYTE*)pIP + ((pIP->VersionIHL & 0x0F) << 2);
+			if((pTCP[13] & HOST_TEST_TCP_SYN) && (pHost = FindHostByMAC(&pEther->DestMACAddr)) != NULL)
+				pHost->cSyns++;
+		}
+	}
+}
+
+static void Tasks(void)
+{
+	StackTask();
+	Serve();
+}
+
+static void RunFor(DWORD dwMs)
+{
+	QWORD qwEndNs = HostTestNowNs() + (QWORD)dwMs * 1000000ull;
+
+	while(HostTestNowNs() < qwEndNs)
+		Tasks();
+}
+
+// Forgets everything, on both sides
+static void Forget(void)
+{
+	WORD i;
+
+	ARPInit();
+	for(i = 0; i <= ARP_TEST_HOSTS; i++)
+	{
+		_rgHost[i].bSilent = FALSE;
+		_rgHost[i].cRequests = 0;
+		_rgHost[i].cSyns = 0;
+	}
+}
+
+// The stack has host i with its right MAC
+static BOOL IsResolved(WORD i)
+{
+	MAC_ADDR mac;
+
+	return ARPIsResolved(&_rgHost[i].node.IPAddr, &mac) &&
+			memcmp(&mac, &_rgHost[i].node.MACAddr, sizeof(mac)) == 0;
+}
+
+// Asks for host i and runs the stack until it is in the cache
+static BOOL Resolve(WORD i)
+{
+	QWORD qwEndNs = HostTestNowNs() + (QWORD)ARP_TEST_ANSWER_MS * 1000000ull;
+
+	ARPResolve(&_rgHost[i].node.IPAddr);
+	while(!IsResolved(i))
+	{
+		if(HostTestNowNs() > qwEndNs)
+			return FALSE;
+		Tasks();
+	}
+	return TRUE;
+}
+
+// One request per holdoff, however many ask, and none once resolved
+static void CheckDedup(void)
+{
+	WORD i;
+
+	Forget();
+	_rgHost[0].bSilent = TRUE;
+	for(i = 0; i < 5u; i++)
+	{
+		ARPResolve(&_rgHost[0].node.IPAddr);
+		RunFor(10);
+	}
+	HOST_TEST_CHECK(_rgHost[0].cRequests == 1u);
+	HOST_TEST_CHECK(!IsResolved(0));
+
+	RunFor(ARP_TEST_HOLDOFF_MS);
+	_rgHost[0].bSilent = FALSE;
+	HOST_TEST_CHECK(Resolve(0));
+	HOST_TEST_CHECK(_rgHost[0].cRequests == 2u);
+
+	for(i = 0; i < 5u; i++)
+		ARPResolve(&_rgHost[0].node.IPAddr);
+	RunFor(ARP_TEST_ANSWER_MS);
+	HOST_TEST_CHECK(_rgHost[0].cRequests == 2u);
+}
+
+// A full cache, then one more: the one looked up longest ago goes
+static void CheckLRU(void)
+{
+	WORD i;
+
+	Forget();
+	for(i = 0; i < ARP_CACHE_SIZE; i++)
+		HOST_TEST_CHECK(Resolve(i));
+	for(i = 0; i < ARP_CACHE_SIZE; i++)
+		HOST_TEST_CHECK(IsResolved(i));
+
+	// 0 was resolved first but is looked up last, so 1 is the oldest
+	RunFor(1);
+	HOST_TEST_CHECK(IsResolved(0));
+	RunFor(1);
+	for(i = 2; i < ARP_CACHE_SIZE; i++)
+		HOST_TEST_CHECK(IsResolved(i));
+
+	HOST_TEST_CHECK(Resolve(ARP_CACHE_SIZE));
+	HOST_TEST_CHECK(!IsResolved(1));
+	HOST_TEST_CHECK(IsResolved(0));
+	for(i = 2; i <= ARP_CACHE_SIZE; i++)
+		HOST_TEST_CHECK(IsResolved(i));
+}
+
+// Responses nobody asked for are not cached, and push nothing out
+static void CheckUnsolicited(void)
+{
+	WORD i;
+
+	Forget();
+	for(i = 0; i < ARP_CACHE_SIZE; i++)
+		HOST_TEST_CHECK(Resolve(i));
+
+	for(i = ARP_CACHE_SIZE; i < ARP_TEST_HOSTS; i++)
+		SendArp(&_rgHost[i], ARP_OPERATION_RESP);
+	RunFor(ARP_TEST_ANSWER_MS);
+
+	for(i = 0; i < ARP_CACHE_SIZE; i++)
+		HOST_TEST_CHECK(IsResolved(i));
+	for(i = ARP_CACHE_SIZE; i < ARP_TEST_HOSTS; i++)
+		HOST_TEST_CHECK(!IsResolved(i));
+}
+
+// A request from a cached host updates its MAC; from others it adds nothing
+static void CheckMerge(void)
+{
+	MAC_ADDR macOld = _rgHost[1].node.MACAddr;
+
+	Forget();
+	HOST_TEST_CHECK(Resolve(1));
+
+	_rgHost[1].node.MACAddr.v[4] = 0xEE;
+	SendArp(&_rgHost[1], ARP_OPERATION_REQ);
+	SendArp(&_rgHost[30], ARP_OPERATION_REQ);
+	RunFor(ARP_TEST_ANSWER_MS);
+
+	HOST_TEST_CHECK(IsResolved(1));
+	HOST_TEST_CHECK(!IsResolved(30));
+	HOST_TEST_CHECK(_rgHost[1].cRequests == 1u);
+
+	_rgHost[1].node.MACAddr = macOld;
+}
+
+// Hosts off the subnet are the gateway's MAC, which is asked for once
+static void CheckGateway(void)
+{
+	static const BYTE rgbFar[2][4] = {{10, 0, 0, 5}, {172, 16, 9, 1}};
+	IP_ADDR ip;
+	MAC_ADDR mac;
+	WORD i;
+
+	Forget();
+	for(i = 0; i < 2u; i++)
+	{
+		memcpy(&ip, rgbFar[i], sizeof(ip));
+		ARPResolve(&ip);
+		RunFor(ARP_TEST_ANSWER_MS);
+		HOST_TEST_CHECK(ARPIsResolved(&ip, &mac) &&
+						memcmp(&mac, &_rgHost[ARP_TEST_GATEWAY].node.MACAddr, sizeof(mac)) == 0);
+	}
+	HOST_TEST_CHECK(_rgHost[ARP_TEST_GATEWAY].cRequests == 1u);
+}
+
+// Resolved entries are forgotten after ARP_CACHE_TIMEOUT and asked for again
+static void CheckAging(void)
+{
+	Forget();
+	HOST_TEST_CHECK(Resolve(2));
+	RunFor((DWORD)(ARP_CACHE_TIMEOUT * 1000ull / TICK_SECOND) / 2u);
+	HOST_TEST_CHECK(IsResolved(2));
+	RunFor((DWORD)(ARP_CACHE_TIMEOUT * 1000ull / TICK_SECOND) / 2u + 50u);
+	HOST_TEST_CHECK(!IsResolved(2));
+
+	HOST_TEST_CHECK(Resolve(2));
+	HOST_TEST_CHECK(_rgHost[2].cRequests == 2u);
+}
+
+/*****************************************************************************
+  Function:
+	static void CheckWaiters(void)
+
+  Summary:
+	Several sockets waiting on one incomplete entry
+
+  Description:
+	Four TCP clients connect to a silent host.  Each asks ARP.c from
+	its own state machine, and asks again after a quarter of a second,
+	then half a second, and so on.  They all ask at once, so each round
+	must put one request on the wire, not four.  Once the host answers,
+	every one of them must send its SYN to the host's MAC.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void CheckWaiters(void)
+{
+	TCP_SOCKET rgh[4];
+	QWORD qwEndNs;
+	WORD i, cSilent;
+
+	Forget();
+	_rgHost[35].bSilent = TRUE;
+	for(i = 0; i < 4u; i++)
+	{
+		rgh[i] = TCPOpen(_rgHost[35].node.IPAddr.Val, TCP_OPEN_IP_ADDRESS, ARP_TEST_PORT + i, TCP_PURPOSE_DEFAULT);
+		HOST_TEST_CHECK(rgh[i] != INVALID_SOCKET);
+	}
+	RunFor(ARP_TEST_HOLDOFF_MS - 50u);
+	HOST_TEST_CHECK(_rgHost[35].cRequests == 1u);
+
+	// rounds at 0, 250 and 750 ms
+	RunFor(1000u - (ARP_TEST_HOLDOFF_MS - 50u));
+	cSilent = _rgHost[35].cRequests;
+	HOST_TEST_CHECK(cSilent >= 2u && cSilent <= 3u);
+	HOST_TEST_CHECK(_rgHost[35].cSyns == 0u);
+
+	_rgHost[35].bSilent = FALSE;
+	qwEndNs = HostTestNowNs() + 3000000000ull;
+	while(_rgHost[35].cSyns < 4u && HostTestNowNs() < qwEndNs)
+		Tasks();
+	HOST_TEST_CHECK(_rgHost[35].cSyns == 4u);
+	HOST_TEST_CHECK(_rgHost[35].cRequests == cSilent + 1u);
+
+	for(i = 0; i < 4u; i++)
+		if(rgh[i] != INVALID_SOCKET)
+			TCPClose(rgh[i]);
+	RunFor(10);
+}
+
+// Random lookups over the whole segment; each must give the right MAC
+static void Churn(DWORD cLookups)
+{
+	DWORD c, cHits = 0, cRequests = 0, cWrong = 0;
+	QWORD qwNs = 0, qwStartNs;
+	MAC_ADDR mac;
+	WORD i;
+
+	Forget();
+	srand(1);
+	for(c = 0; c < cLookups; c++)
+	{
+		// most traffic goes to a few hosts, the way it does on a LAN
+		i = (rand() & 3) ? rand() % (ARP_CACHE_SIZE / 2u) : rand() % ARP_TEST_HOSTS;
+
+		qwStartNs = HostTestNowNs();
+		if(ARPIsResolved(&_rgHost[i].node.IPAddr, &mac))
+		{
+			qwNs += HostTestNowNs() - qwStartNs;
+			cHits++;
+			cWrong += memcmp(&mac, &_rgHost[i].node.MACAddr, sizeof(mac)) != 0;
+			continue;
+		}
+		cWrong += !Resolve(i);
+	}
+
+	for(i = 0; i <= ARP_TEST_HOSTS; i++)
+		cRequests += _rgHost[i].cRequests;
+	printf("  churn: %lu lookups over %u hosts, %lu from the cache at %.0f ns, %lu requests\n",
+		(unsigned long)cLookups, ARP_TEST_HOSTS, (unsigned long)cHits,
+		cHits ? (double)qwNs / cHits : 0.0, (unsigned long)cRequests);
+	HOST_TEST_CHECK(cWrong == 0u);
+	HOST_TEST_CHECK(cRequests == cLookups - cHits);
+}
+
+int main(int argc, char *argv[])
+{
+	DWORD cLookups = 5000;
+	WORD i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			cLookups = strtoul(argv[++i], NULL, 0);
+		else
+		{
+			fprintf(stderr, "usage: %s [-n lookups]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	HostTestBegin();
+	_port = HostMACAttach();
+	if(!HOST_TEST_CHECK(_port != HOST_MAC_INVALID_PORT))
+		return HostTestEnd("arptest");
+
+	for(i = 0; i < ARP_TEST_HOSTS; i++)
+	{
+		_rgHost[i].node.IPAddr.Val = AppConfig.MyIPAddr.Val;
+		_rgHost[i].node.IPAddr.v[3] = ARP_TEST_FIRST + i;
+		memcpy(&_rgHost[i].node.MACAddr, (const BYTE[]){0x02, 0x00, 0x00, 0x00, 0x01, 0x00}, sizeof(MAC_ADDR));
+		_rgHost[i].node.MACAddr.v[5] = (BYTE)i;
+	}
+	_rgHost[ARP_TEST_GATEWAY].node.IPAddr = AppConfig.MyGateway;
+	memcpy(&_rgHost[ARP_TEST_GATEWAY].node.MACAddr, (const BYTE[]){0x02, 0x00, 0x00, 0x00, 0x02, 0x01}, sizeof(MAC_ADDR));
+
+	CheckDedup();
+	CheckLRU();
+	CheckUnsolicited();
+	CheckMerge();
+	CheckGateway();
+	CheckAging();
+	CheckWaiters();
+	Churn(cLookups);
+
+	return HostTestEnd("arptest");
+}
@@ -0,0 +1,169 @@
+/************************************************************************/
+/*																		*/
+/*	checksumtest.c	--  Helpers.c's IP checksums against RFC 1071       */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	A PC build sums 32 bits at a time in SumIPWords(), as PIC32 does.	*/
+/*	CalcIPChecksum() and CalcIPBufferChecksum(), which HostMAC.c		*/
+/*	reads through MACGetArray(), are compared with a byte at a time		*/
+/*	RFC 1071 sum over random data of random lengths at every			*/
+/*	alignment, and UpdateIPChecksum() and AddIPChecksum() with			*/
+/*	summing the changed or joined data again.  Then both sums and the	*/
+/*	reference are timed across sizes and alignments.					*/
+/*																		*/
+/*		checksumtest [rounds [seed]]									*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define CHECKSUM_MAX_LEN		(1600u)
+#define CHECKSUM_ALIGNMENTS		(8u)
+
+static DWORD _dwRandom;
+static BYTE _rgbData[CHECKSUM_MAX_LEN + CHECKSUM_ALIGNMENTS] __attribute__((aligned(8)));
+
+static DWORD Random(void)
+{
+	// xorshift32, so a failing seed can be run again
+	_dwRandom ^= _dwRandom << 13;
+	_dwRandom ^= _dwRandom >> 17;
+	_dwRandom ^= _dwRandom << 5;
+	return _dwRandom;
+}
+
+// RFC 1071, a byte at a time, so it does not care about alignment
+static WORD Reference(const BYTE *pData, WORD wLen)
+{
+	DWORD dwSum = 0;
+	WORD i;
+
+	for(i = 0; i + 1u < wLen; i += 2)
+		dwSum += ((WORD)pData[i + 1] << 8) | pData[i];
+	if(wLen & 1u)
+		dwSum += pData[wLen - 1];
+	while(dwSum >> 16)
+		dwSum = (dwSum & 0xFFFFu) + (dwSum >> 16);
+
+	return ~(WORD)dwSum;
+}
+
+static WORD BufferChecksum(BYTE *pData, WORD wLen)
+{
+	MACSetReadPtr((PTR_BASE)pData);
+	return CalcIPBufferChecksum(wLen);
+}
+
+// Short lengths most of the time, the tails are where the bugs are
+static WORD RandomLength(void)
+{
+	return Random() % 2u ? Random() % 64u : Random() % (CHECKSUM_MAX_LEN + 1u);
+}
+
+static void Check(void)
+{
+	WORD wLen = RandomLength(), wOffset = Random() % CHECKSUM_ALIGNMENTS, wSplit, i, wOld, wNew;
+	BYTE *pData = _rgbData + wOffset;
+	WORD wRef, wSum;
+
+	for(i = 0; i < wLen; i++)
+		pData[i] = (BYTE)Random();
+	// runs of 0xFF carry the most
+	if(wLen && Random() % 4u == 0u)
+		memset(pData, 0xFF, Random() % wLen);
+
+	wRef = Reference(pData, wLen);
+	if(!HOST_TEST_CHECK(CalcIPChecksum(pData, wLen) == wRef) || !HOST_TEST_CHECK(BufferChecksum(pData, wLen) == wRef))
+	{
+		fprintf(stderr, "  length %u, offset %u\n", wLen, wOffset);
+		return;
+	}
+
+	// rewrite a word of it
+	if(wLen >= 2u)
+	{
+		i = (Random() % (wLen / 2u)) * 2u;
+		memcpy(&wOld, pData + i, sizeof(wOld));
+		wNew = (WORD)Random();
+		memcpy(pData + i, &wNew, sizeof(wNew));
+		wSum = UpdateIPChecksum(wRef, wOld, wNew);
+		wRef = Reference(pData, wLen);
+		HOST_TEST_CHECK(wSum == wRef || (wSum ^ wRef) == 0xFFFFu);
+	}
+
+	// and sum it in two pieces
+	wSplit = wLen ? Random() % (wLen + 1u) : 0;
+	wSum = AddIPChecksum(CalcIPChecksum(pData, wSplit), CalcIPChecksum(pData + wSplit, wLen - wSplit), wSplit & 1u);
+	HOST_TEST_CHECK(wSum == wRef || (wSum ^ wRef) == 0xFFFFu);
+}
+
+static double NsPerCall(WORD (*pfn)(BYTE *pData, WORD wLen), BYTE *pData, WORD wLen)
+{
+	volatile WORD wSink;
+	QWORD qwStartNs;
+	DWORD i, c = 200000u / (wLen / 64u + 1u);
+
+	qwStartNs = HostTestNowNs();
+	for(i = 0; i < c; i++)
+		wSink = pfn(pData, wLen);
+	(void)wSink;
+
+	return (double)(HostTestNowNs() - qwStartNs) / c;
+}
+
+static WORD ReferenceCall(BYTE *pData, WORD wLen)
+{
+	return Reference(pData, wLen);
+}
+
+int main(int argc, char *argv[])
+{
+	static const WORD rgwLen[] = {20, 64, 576, 1460};
+	DWORD dwRounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 200000;
+	DWORD i;
+	WORD j, k;
+
+	_dwRandom = argc > 2 ? strtoul(argv[2], NULL, 0) : 0x2012u;
+	printf("checksumtest: %lu rounds, seed 0x%lX\n", (unsigned long)dwRounds, (unsigned long)_dwRandom);
+
+	for(i = 0; i < dwRounds && HostTestFailures < 10; i++)
+		Check();
+
+	for(i = 0; i < sizeof(_rgbData); i++)
+		_rgbData[i] = (BYTE)Random();
+	printf("  bytes offset  CalcIPChecksum  CalcIPBufferChecksum  byte at a time\n");
+	for(j = 0; j < sizeof(rgwLen) / sizeof(rgwLen[0]); j++)
+	{
+		for(k = 0; k < 4u; k++)
+		{
+			printf("  %5u %6u  %11.1f ns  %17.1f ns  %11.1f ns\n", rgwLen[j], k,
+				NsPerCall(CalcIPChecksum, _rgbData + k, rgwLen[j]),
+				NsPerCall(BufferChecksum, _rgbData + k, rgwLen[j]),
+				NsPerCall(ReferenceCall, _rgbData + k, rgwLen[j]));
+		}
+	}
+
+	return HostTestEnd("checksumtest");
+}
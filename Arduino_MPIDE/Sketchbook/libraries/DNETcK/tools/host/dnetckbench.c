@@ -0,0 +1,392 @@
+/************************************************************************/
+/*																		*/
+/*	dnetckbench.c	--  TCP and UDP benchmarks of the host build        */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Runs the stack against itself over the virtual switch:				*/
+/*																		*/
+/*		dnetckbench [-t seconds] [tcp-bulk | tcp-rr | tcp-sockets |		*/
+/*					tcp-find | udp-rx | udp-tx]...						*/
+/*																		*/
+/*	tcp-bulk moves data from a client socket to a server socket and		*/
+/*	tcp-rr exchanges 64 byte requests and echoes.  tcp-sockets does		*/
+/*	tcp-rr on every socket in turn; build it with HOST_TCP_SOCKETS and	*/
+/*	TCP_DIRECT_TCB set to see what changing sockets costs.  Both ends	*/
+/*	are this stack, so every segment is sent and received by the same	*/
+/*	code and the numbers are what one PC core does for both sides		*/
+/*	together.  tcp-find times TCPFindArrayEx() against a linear search	*/
+/*	of a FIFO full of HTTP headers; HOST_TCP_MEDIUM=TCP_ETH_RAM puts	*/
+/*	the FIFO behind the MAC.  udp-rx and udp-tx move 1024 byte			*/
+/*	datagrams between a socket and the peer of hosttest.h, which works	*/
+/*	on raw frames and costs next to nothing.  With no test named all of	*/
+/*	them run.															*/
+/*																		*/
+/*		dnetckbench serve												*/
+/*																		*/
+/*	runs the stack on tap0 with the performance test servers, for		*/
+/*	../dnetckperf.c; see the Makefile.									*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define BENCH_TCP_PORT			(9100u)
+#define BENCH_UDP_PORT			(9200u)
+#define BENCH_RR_SIZE			(64u)
+#define BENCH_UDP_SIZE			(1024u)
+
+static DWORD _dwSeconds = 2;
+
+static void BenchTcpBulk(void)
+{
+	static BYTE rgbBuff[1460];
+	TCP_SOCKET hClient, hServer;
+	TCP_SOCKET_STATS *pStats;
+	QWORD qwStartNs, qwEndNs, qwBytes = 0;
+	WORD w;
+
+	if(!HostTestConnect(BENCH_TCP_PORT, &hClient, &hServer))
+	{
+		printf("tcp-bulk: could not connect\n");
+		return;
+	}
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs)
+	{
+		if((w = TCPIsPutReady(hClient)) != 0u)
+			TCPPutArray(hClient, rgbBuff, w < sizeof(rgbBuff) ? w : sizeof(rgbBuff));
+
+		HostTestTasks();
+
+		while((w = TCPIsGetReady(hServer)) != 0u)
+			qwBytes += TCPGetArray(hServer, rgbBuff, w < sizeof(rgbBuff) ? w : sizeof(rgbBuff));
+	}
+	qwEndNs = HostTestNowNs();
+
+	pStats = TCPGetSocketStats(hClient);
+	printf("tcp-bulk: %llu bytes in %.2f s, %.2f MB/s, %u retransmits\n",
+		(unsigned long long)qwBytes, (qwEndNs - qwStartNs) / 1e9,
+		qwBytes * 1e3 / (qwEndNs - qwStartNs), pStats->wRetransmits + pStats->wFastRetransmits);
+
+	HostTestClose(hClient, hServer);
+}
+
+// One BENCH_RR_SIZE request from hClient echoed back by hServer
+static BOOL Exchange(TCP_SOCKET hClient, TCP_SOCKET hServer, QWORD qwEndNs)
+{
+	static BYTE rgbBuff[BENCH_RR_SIZE];
+	WORD w;
+
+	TCPPutArray(hClient, rgbBuff, sizeof(rgbBuff));
+	TCPFlush(hClient);
+
+	// the server echoes the request once all of it is in
+	while(TCPIsGetReady(hServer) < sizeof(rgbBuff) && HostTestNowNs() < qwEndNs)
+		HostTestTasks();
+	TCPGetArray(hServer, rgbBuff, sizeof(rgbBuff));
+	TCPPutArray(hServer, rgbBuff, sizeof(rgbBuff));
+	TCPFlush(hServer);
+
+	for(w = 0; w < sizeof(rgbBuff) && HostTestNowNs() < qwEndNs; )
+	{
+		HostTestTasks();
+		w += TCPGetArray(hClient, rgbBuff, sizeof(rgbBuff) - w);
+	}
+
+	return w == sizeof(rgbBuff);
+}
+
+static void BenchTcpRR(void)
+{
+	TCP_SOCKET hClient, hServer;
+	QWORD qwStartNs, qwEndNs, cExchanges = 0;
+
+	if(!HostTestConnect(BENCH_TCP_PORT + 1, &hClient, &hServer))
+	{
+		printf("tcp-rr: could not connect\n");
+		return;
+	}
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs)
+	{
+		if(Exchange(hClient, hServer, qwEndNs))
+			cExchanges++;
+	}
+	qwEndNs = HostTestNowNs();
+
+	printf("tcp-rr: %llu exchanges of %u bytes, %.0f/s, %.1f us each\n",
+		(unsigned long long)cExchanges, BENCH_RR_SIZE,
+		cExchanges * 1e9 / (qwEndNs - qwStartNs), (qwEndNs - qwStartNs) / 1e3 / cExchanges);
+
+	HostTestClose(hClient, hServer);
+}
+
+// tcp-rr over every socket there is, one connection after the other, so
+// the stack changes sockets on nearly every call
+static void BenchTcpSockets(void)
+{
+	static TCP_SOCKET rghClient[HOST_TCP_SOCKETS / 2], rghServer[HOST_TCP_SOCKETS / 2];
+	QWORD qwStartNs, qwEndNs, cExchanges = 0;
+	WORD i, cPairs;
+
+	for(cPairs = 0; cPairs < HOST_TCP_SOCKETS / 2; cPairs++)
+	{
+		if(!HostTestConnect(BENCH_TCP_PORT + 10 + cPairs, &rghClient[cPairs], &rghServer[cPairs]))
+			break;
+	}
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs)
+	{
+		for(i = 0; i < cPairs; i++)
+		{
+			if(Exchange(rghClient[i], rghServer[i], qwEndNs))
+				cExchanges++;
+		}
+	}
+	qwEndNs = HostTestNowNs();
+
+	printf("tcp-sockets: %u connections, %llu exchanges of %u bytes, %.0f/s, %.1f us each, TCBs %s\n",
+		cPairs, (unsigned long long)cExchanges, BENCH_RR_SIZE,
+		cExchanges * 1e9 / (qwEndNs - qwStartNs), (qwEndNs - qwStartNs) / 1e3 / cExchanges,
+		#if defined(TCP_DIRECT_TCB)
+		"direct");
+		#else
+		"copied");
+		#endif
+
+	for(i = 0; i < cPairs; i++)
+		HostTestClose(rghClient[i], rghServer[i]);
+}
+
+// A linear search of a copy of the RX FIFO, what finding a string cost
+// before TCPFindArrayEx() skipped
+static WORD LinearFind(TCP_SOCKET hTCP, const BYTE *pbFind, WORD wLen)
+{
+	static BYTE rgbData[HOST_TCP_FIFO_SIZE];
+	WORD wDataLen, wPos;
+
+	wDataLen = TCPPeekArray(hTCP, rgbData, sizeof(rgbData), 0);
+	for(wPos = 0; wPos + wLen <= wDataLen; wPos++)
+	{
+		if(memcmp(&rgbData[wPos], pbFind, wLen) == 0)
+			return wPos;
+	}
+
+	return 0xFFFF;
+}
+
+// Searches a FIFO full of HTTP headers for strings at its far end
+static void BenchTcpFind(void)
+{
+	static const char *rgszFind[] = {"\r\n\r\n", "Content-Type: multipart/form-data", "--------------------------7d93b2a1f0e4c"};
+	BYTE rgbBuff[HOST_TCP_FIFO_SIZE];
+	TCP_SOCKET hClient, hServer;
+	QWORD qwStartNs, qwFindNs, qwLinearNs;
+	DWORD i, cSearches = 20000;
+	WORD w, wLen, wDataLen = 0, wFound = 0, wLinear = 0;
+
+	if(!HostTestConnect(BENCH_TCP_PORT + 2, &hClient, &hServer))
+	{
+		printf("tcp-find: could not connect\n");
+		return;
+	}
+
+	while(wDataLen + 120u < sizeof(rgbBuff))
+		wDataLen += sprintf((char*)&rgbBuff[wDataLen], "X-Header-%u: some value or other\r\n", wDataLen);
+	wDataLen += sprintf((char*)&rgbBuff[wDataLen], "%s\r\n%s\r\n", rgszFind[1], rgszFind[2]);
+	wDataLen += sprintf((char*)&rgbBuff[wDataLen], "\r\n");
+	TCPPutArray(hClient, rgbBuff, wDataLen);
+	TCPFlush(hClient);
+	for(w = 0; w < 1000u && TCPIsGetReady(hServer) < wDataLen; w++)
+		HostTestRunFor(1);
+
+	for(w = 0; w < sizeof(rgszFind) / sizeof(rgszFind[0]); w++)
+	{
+		wLen = strlen(rgszFind[w]);
+
+		qwStartNs = HostTestNowNs();
+		for(i = 0; i < cSearches; i++)
+			wFound = TCPFindArrayEx(hServer, (BYTE*)rgszFind[w], wLen, 0, 0, FALSE);
+		qwFindNs = HostTestNowNs() - qwStartNs;
+
+		qwStartNs = HostTestNowNs();
+		for(i = 0; i < cSearches; i++)
+			wLinear = LinearFind(hServer, (BYTE*)rgszFind[w], wLen);
+		qwLinearNs = HostTestNowNs() - qwStartNs;
+
+		printf("tcp-find: %u byte pattern at %u of %u: %.0f ns, linear %.0f ns%s\n",
+			wLen, wFound, wDataLen, (double)qwFindNs / cSearches, (double)qwLinearNs / cSearches,
+			wFound == wLinear ? "" : ", MISMATCH");
+	}
+
+	HostTestClose(hClient, hServer);
+}
+
+// Datagrams from the peer to a socket of this stack
+static void BenchUdpRx(void)
+{
+	static BYTE rgbBuff[BENCH_UDP_SIZE];
+	UDP_SOCKET hRx;
+	BYTE port;
+	QWORD qwStartNs, qwEndNs, cReceived = 0;
+	WORD w;
+
+	port = HostTestPeerAttach();
+	hRx = UDPOpen(BENCH_UDP_PORT, NULL, 0);
+	if(port == HOST_MAC_INVALID_PORT || hRx == INVALID_UDP_SOCKET)
+	{
+		printf("udp-rx: no socket\n");
+		return;
+	}
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs)
+	{
+		// keep the stack's RX queue topped up
+		while(MACGetFreeRxSize() >= HOST_MAC_FRAME_SIZE)
+			HostTestPeerSendUdp(port, BENCH_UDP_PORT + 1, BENCH_UDP_PORT, rgbBuff, sizeof(rgbBuff));
+
+		HostTestTasks();
+
+		if((w = UDPIsGetReady(hRx)) != 0u)
+		{
+			UDPGetArray(rgbBuff, w);
+			UDPDiscard();
+			cReceived++;
+		}
+	}
+	qwEndNs = HostTestNowNs();
+
+	printf("udp-rx: %llu datagrams of %u bytes, %.0f/s, %.2f MB/s\n",
+		(unsigned long long)cReceived, BENCH_UDP_SIZE,
+		cReceived * 1e9 / (qwEndNs - qwStartNs), cReceived * BENCH_UDP_SIZE * 1e3 / (qwEndNs - qwStartNs));
+
+	UDPClose(hRx);
+	HostTestRunFor(10);
+	HostMACDetach(port);
+}
+
+// Datagrams from a socket of this stack to the peer
+static void BenchUdpTx(void)
+{
+	static BYTE rgbBuff[BENCH_UDP_SIZE];
+	NODE_INFO peer;
+	UDP_SOCKET hTx;
+	BYTE port;
+	QWORD qwStartNs, qwEndNs, cSent = 0, cReceived = 0;
+	WORD wSrc, wDst, wLen;
+
+	port = HostTestPeerAttach();
+	HostTestPeer(&peer);
+	hTx = UDPOpen(BENCH_UDP_PORT + 2, &peer, BENCH_UDP_PORT + 3);
+	if(port == HOST_MAC_INVALID_PORT || hTx == INVALID_UDP_SOCKET)
+	{
+		printf("udp-tx: no socket\n");
+		return;
+	}
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs)
+	{
+		if(UDPIsPutReady(hTx) >= sizeof(rgbBuff))
+		{
+			UDPPutArray(rgbBuff, sizeof(rgbBuff));
+			UDPFlush();
+			cSent++;
+		}
+
+		HostTestTasks();
+
+		wLen = sizeof(rgbBuff);
+		while(HostTestPeerReceiveUdp(port, &wSrc, &wDst, NULL, &wLen))
+			cReceived++;
+	}
+	qwEndNs = HostTestNowNs();
+
+	printf("udp-tx: %llu of %llu datagrams of %u bytes arrived, %.0f/s, %.2f MB/s\n",
+		(unsigned long long)cReceived, (unsigned long long)cSent, BENCH_UDP_SIZE,
+		cReceived * 1e9 / (qwEndNs - qwStartNs), cReceived * BENCH_UDP_SIZE * 1e3 / (qwEndNs - qwStartNs));
+
+	UDPClose(hTx);
+	HostMACDetach(port);
+}
+
+int main(int argc, char *argv[])
+{
+	BOOL fRan = FALSE;
+	int i;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	HostTestBegin();
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			_dwSeconds = atoi(argv[++i]);
+		else if(strcmp(argv[i], "serve") == 0)
+		{
+			printf("serving the performance tests, ^C to stop\n");
+			for(;;)
+				HostTestTasks();
+		}
+		else if(strcmp(argv[i], "tcp-bulk") == 0)
+			BenchTcpBulk(), fRan = TRUE;
+		else if(strcmp(argv[i], "tcp-rr") == 0)
+			BenchTcpRR(), fRan = TRUE;
+		else if(strcmp(argv[i], "tcp-sockets") == 0)
+			BenchTcpSockets(), fRan = TRUE;
+		else if(strcmp(argv[i], "tcp-find") == 0)
+			BenchTcpFind(), fRan = TRUE;
+		else if(strcmp(argv[i], "udp-rx") == 0)
+			BenchUdpRx(), fRan = TRUE;
+		else if(strcmp(argv[i], "udp-tx") == 0)
+			BenchUdpTx(), fRan = TRUE;
+		else
+		{
+			fprintf(stderr, "usage: %s [-t seconds] [tcp-bulk | tcp-rr | tcp-sockets | tcp-find | udp-rx | udp-tx | serve]...\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if(!fRan)
+	{
+		BenchTcpBulk();
+		BenchTcpRR();
+		BenchTcpSockets();
+		BenchTcpFind();
+		BenchUdpRx();
+		BenchUdpTx();
+	}
+
+	return 0;
+}
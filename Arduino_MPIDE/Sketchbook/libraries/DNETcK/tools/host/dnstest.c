@@ -0,0 +1,424 @@
+/************************************************************************/
+/*																		*/
+/*	dnstest.c	--  Concurrent DNS queries and server failover          */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Two ports on the switch play the primary and the secondary DNS		*/
+/*	server, answering ARP for their addresses and recording the			*/
+/*	queries DNS.c sends them.  Three resolutions, two from				*/
+/*	DNSQueryBegin() and one through DNSBeginUsage(), must all be		*/
+/*	out at once and each get its own answer when they are answered		*/
+/*	in reverse order.  A silent primary must fail the query over to		*/
+/*	the secondary, which is then asked first; with no secondary the		*/
+/*	primary is asked again and an answer to the first try ignored;		*/
+/*	with no answer at all the query ends in 0.0.0.0.  Answers come		*/
+/*	from the cache after that.											*/
+/*																		*/
+/*	The stack's SNTP client looks its server up too; names not			*/
+/*	ending in DNS_TEST_DOMAIN are told they do not exist.				*/
+/*																		*/
+/************************************************************************/
+
+#include "hosttest.h"
+
+#define DNS_TEST_DOMAIN			".test"
+#define DNS_TEST_MAX_QUERIES	(8u)		// recorded per server
+#define DNS_TEST_TIMEOUT_MS		(1000u)		// DNS.c's DNS_TIMEOUT
+
+typedef struct
+{
+	BYTE		port;
+	NODE_INFO	node;
+	BOOL		bSilent;						// records queries but does not answer
+	BYTE		cQueries;
+	WORD		rgwID[DNS_TEST_MAX_QUERIES];
+	char		rgszName[DNS_TEST_MAX_QUERIES][32];
+} DNS_TEST_SERVER;
+
+static DNS_TEST_SERVER _rgServer[2] =
+{
+	{0, {{.v = {192, 168, 1, 191}}, {{0x02, 0x00, 0x00, 0x00, 0x00, 0x01}}}},
+	{0, {{.v = {192, 168, 1, 192}}, {{0x02, 0x00, 0x00, 0x00, 0x00, 0x02}}}},
+};
+
+static BYTE _rgbFrame[HOST_MAC_FRAME_SIZE];
+static WORD _wStackPort;						// the DNS socket's, from the last query
+
+// The address each test name resolves to
+static DWORD NameAddress(const char *szName)
+{
+	DWORD dw = 0;
+
+	while(*szName)
+		dw = dw * 31u + (BYTE)*szName++;
+	return 10u | (dw & 0x00FFFF00ul);
+}
+
+// A datagram from port 53 of pServer to the stack's DNS socket
+static void Reply(DNS_TEST_SERVER *pServer, const BYTE *pPayload, WORD wLen)
+{
+	ETHER_HEADER *pEther = (ETHER_HEADER*)_rgbFrame;
+	IP_HEADER *pIP = (IP_HEADER*)(pEther + 1);
+	UDP_HEADER *pUDP = (UDP_HEADER*)(pIP + 1);
+	PSEUDO_HEADER pseudo;
+	DWORD_VAL sum;
+
+	pEther->DestMACAddr = AppConfig.MyMACAddr;
+	pEther->SourceMACAddr = pServer->node.MACAddr;
+	pEther->Type.Val = swaps(0x0800);
+
+	memset(pIP, 0, sizeof(*pIP));
+	pIP->VersionIHL = 0x45;
+	pIP->TotalLength = swaps(sizeof(IP_HEADER) + sizeof(UDP_HEADER) + wLen);
+	pIP->TimeToLive = 64;
+	pIP->Protocol = IP_PROT_UDP;
+	pIP->SourceAddress = pServer->node.IPAddr;
+	pIP->DestAddress = AppConfig.MyIPAddr;
+	pIP->HeaderChecksum = CalcIPChecksum((BYTE*)pIP, sizeof(*pIP));
+
+	pUDP->SourcePort = swaps(53);
+	pUDP->DestinationPort = swaps(_wStackPort);
+	pUDP->Length = swaps(sizeof(UDP_HEADER) + wLen);
+	pUDP->Checksum = 0;
+	memcpy(pUDP + 1, pPayload, wLen);
+
+	pseudo.SourceAddress = pIP->SourceAddress;
+	pseudo.DestAddress = pIP->DestAddress;
+	pseudo.Zero = 0;
+	pseudo.Protocol = IP_PROT_UDP;
+	pseudo.Length = pUDP->Length;
+	sum.Val = (WORD)~CalcIPChecksum((BYTE*)&pseudo, sizeof(pseudo));
+	sum.Val += (WORD)~CalcIPChecksum((BYTE*)pUDP, sizeof(UDP_HEADER) + wLen);
+	sum.Val = sum.w[0] + sum.w[1];
+	sum.Val = sum.w[0] + sum.w[1];
+	pUDP->Checksum = ~sum.w[0];
+	if(pUDP->Checksum == 0u)
+		pUDP->Checksum = 0xFFFF;
+
+	HostMACSend(pServer->port, _rgbFrame, sizeof(ETHER_HEADER) + sizeof(IP_HEADER) + sizeof(UDP_HEADER) + wLen);
+}
+
+/*****************************************************************************
+  Function:
+	static void Answer(DNS_TEST_SERVER *pServer, WORD wID, const char *szName,
+						DWORD dwIP)
+
+  Summary:
+	Sends the stack an answer to a query
+
+  Description:
+	One A record, or RCODE 3 (no such name) if dwIP is 0.
+
+  Precondition:
+	The stack's DNS port was seen in a query, see Serve()
+
+  Parameters:
+	pServer - the server that answers
+	wID - the transaction ID answered
+	szName - the name asked for
+	dwIP - its address
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void Answer(DNS_TEST_SERVER *pServer, WORD wID, const char *szName, DWORD dwIP)
+{
+	BYTE rgbDNS[128], *p = rgbDNS;
+	const char *pLabel = szName, *pDot;
+
+	*p++ = (BYTE)(wID >> 8);
+	*p++ = (BYTE)wID;
+	*p++ = 0x81;								// response, recursion desired
+	*p++ = dwIP ? 0x80 : 0x83;					// recursion available, RCODE
+	*p++ = 0; *p++ = 1;							// 1 question
+	*p++ = 0; *p++ = dwIP ? 1 : 0;				// 1 answer
+	*p++ = 0; *p++ = 0;
+	*p++ = 0; *p++ = 0;
+
+	do
+	{
+		pDot = strchr(pLabel, '.');
+		*p = pDot ? pDot - pLabel : strlen(pLabel);
+		memcpy(p + 1, pLabel, *p);
+		p += *p + 1;
+		pLabel = pDot + 1;
+	} while(pDot);
+	*p++ = 0;
+	*p++ = 0; *p++ = DNS_TYPE_A;
+	*p++ = 0; *p++ = 1;							// IN
+
+	if(dwIP)
+	{
+		*p++ = 0xC0; *p++ = 12;					// the name in the question
+		*p++ = 0; *p++ = DNS_TYPE_A;
+		*p++ = 0; *p++ = 1;
+		*p++ = 0; *p++ = 0; *p++ = 0; *p++ = 60;	// TTL
+		*p++ = 0; *p++ = 4;
+		memcpy(p, &dwIP, 4);
+		p += 4;
+	}
+
+	Reply(pServer, rgbDNS, p - rgbDNS);
+}
+
+/*****************************************************************************
+  Function:
+	static void Serve(DNS_TEST_SERVER *pServer)
+
+  Summary:
+	Handles the frames that reached a server's port
+
+  Description:
+	ARP requests for the server's address are answered.  Queries for
+	test names are recorded, other names are told they do not exist.
+
+  Precondition:
+	None
+
+  Parameters:
+	pServer - the server
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void Serve(DNS_TEST_SERVER *pServer)
+{
+	static BYTE rgbIn[HOST_MAC_FRAME_SIZE];
+	ETHER_HEADER *pEther = (ETHER_HEADER*)rgbIn;
+	ARP_PACKET *pArp = (ARP_PACKET*)(pEther + 1);
+	IP_HEADER *pIP = (IP_HEADER*)(pEther + 1);
+	UDP_HEADER *pUDP = (UDP_HEADER*)(pIP + 1);
+	BYTE *pDNS = (BYTE*)(pUDP + 1), *p;
+	char szName[32];
+	WORD wLen, wID, i;
+
+	while((wLen = HostMACReceive(pServer->port, rgbIn, sizeof(rgbIn))) != 0u)
+	{
+		if(pEther->Type.Val == swaps(0x0806) && pArp->Operation == swaps(1) &&
+			pArp->TargetIPAddr.Val == pServer->node.IPAddr.Val)
+		{
+			ETHER_HEADER *pOut = (ETHER_HEADER*)_rgbFrame;
+			ARP_PACKET *pReply = (ARP_PACKET*)(pOut + 1);
+
+			pOut->DestMACAddr = pArp->SenderMACAddr;
+			pOut->SourceMACAddr = pServer->node.MACAddr;
+			pOut->Type.Val = swaps(0x0806);
+			*pReply = *pArp;
+			pReply->Operation = swaps(2);
+			pReply->SenderMACAddr = pServer->node.MACAddr;
+			pReply->SenderIPAddr = pServer->node.IPAddr;
+			pReply->TargetMACAddr = pArp->SenderMACAddr;
+			pReply->TargetIPAddr = pArp->SenderIPAddr;
+			HostMACSend(pServer->port, _rgbFrame, sizeof(ETHER_HEADER) + sizeof(ARP_PACKET));
+			continue;
+		}
+
+		if(pEther->Type.Val != swaps(0x0800) || pIP->Protocol != IP_PROT_UDP ||
+			pIP->DestAddress.Val != pServer->node.IPAddr.Val || pUDP->DestinationPort != swaps(53))
+			continue;
+
+		_wStackPort = swaps(pUDP->SourcePort);
+		wID = ((WORD)pDNS[0] << 8) | pDNS[1];
+		for(p = pDNS + 12, i = 0; *p && i + *p + 1u < sizeof(szName); p += *p + 1)
+		{
+			if(i)
+				szName[i++] = '.';
+			memcpy(szName + i, p + 1, *p);
+			i += *p;
+		}
+		szName[i] = '\0';
+
+		if(i < sizeof(DNS_TEST_DOMAIN) || strcmp(szName + i - (sizeof(DNS_TEST_DOMAIN) - 1), DNS_TEST_DOMAIN) != 0)
+		{
+			Answer(pServer, wID, szName, 0);
+			continue;
+		}
+
+		if(pServer->cQueries < DNS_TEST_MAX_QUERIES)
+		{
+			pServer->rgwID[pServer->cQueries] = wID;
+			strcpy(pServer->rgszName[pServer->cQueries], szName);
+			pServer->cQueries++;
+		}
+		if(!pServer->bSilent)
+			Answer(pServer, wID, szName, NameAddress(szName));
+	}
+}
+
+static void Tasks(void)
+{
+	HostTestTasks();
+	Serve(&_rgServer[0]);
+	Serve(&_rgServer[1]);
+}
+
+static void Servers(BOOL bSilent1, BOOL bSilent2)
+{
+	_rgServer[0].bSilent = bSilent1;
+	_rgServer[0].cQueries = 0;
+	_rgServer[1].bSilent = bSilent2;
+	_rgServer[1].cQueries = 0;
+}
+
+// Runs one query to the end, returns the address and how long it took
+static DWORD Resolve(char *szName, DWORD *pdwMs)
+{
+	DNS_HANDLE h = DNSQueryBegin((BYTE*)szName, DNS_TYPE_A);
+	QWORD qwStartNs = HostTestNowNs();
+	IP_ADDR ip;
+
+	if(!HOST_TEST_CHECK(h != INVALID_DNS_HANDLE))
+		return 0;
+
+	while(!DNSQueryIsResolved(h, &ip) && HostTestNowNs() - qwStartNs < 10000000000ull)
+		Tasks();
+	HOST_TEST_CHECK(DNSQueryEnd(h) == (ip.Val != 0u));
+	*pdwMs = (HostTestNowNs() - qwStartNs) / 1000000u;
+
+	return ip.Val;
+}
+
+// Three queries out at once, answered last first
+static void Concurrent(void)
+{
+	static char rgszName[3][16] = {"alpha.test", "beta.test", "gamma.test"};
+	DNS_HANDLE rgh[2];
+	IP_ADDR rgIP[3];
+	BOOL rgbDone[3] = {FALSE, FALSE, FALSE};
+	QWORD qwStartNs;
+	BYTE i, j;
+
+	Servers(TRUE, TRUE);
+
+	// the SNTP client may be using DNSBeginUsage()'s query
+	for(qwStartNs = HostTestNowNs(); !DNSBeginUsage() && HostTestNowNs() - qwStartNs < 5000000000ull; )
+		Tasks();
+	DNSResolve((BYTE*)rgszName[2], DNS_TYPE_A);
+	rgh[0] = DNSQueryBegin((BYTE*)rgszName[0], DNS_TYPE_A);
+	rgh[1] = DNSQueryBegin((BYTE*)rgszName[1], DNS_TYPE_A);
+	if(!HOST_TEST_CHECK(rgh[0] != INVALID_DNS_HANDLE && rgh[1] != INVALID_DNS_HANDLE))
+		return;
+
+	// all three must be sent before any is answered
+	for(qwStartNs = HostTestNowNs(); _rgServer[0].cQueries < 3u && HostTestNowNs() - qwStartNs < 500000000ull; )
+	{
+		Tasks();
+		DNSQueryIsResolved(rgh[0], &rgIP[0]);
+		DNSQueryIsResolved(rgh[1], &rgIP[1]);
+		DNSIsResolved(&rgIP[2]);
+	}
+	if(!HOST_TEST_CHECK(_rgServer[0].cQueries == 3u))
+		return;
+	HOST_TEST_CHECK(_rgServer[1].cQueries == 0u);
+	HOST_TEST_CHECK(_rgServer[0].rgwID[0] != _rgServer[0].rgwID[1] &&
+		_rgServer[0].rgwID[1] != _rgServer[0].rgwID[2] && _rgServer[0].rgwID[0] != _rgServer[0].rgwID[2]);
+
+	for(i = 3; i-- > 0; )
+		Answer(&_rgServer[0], _rgServer[0].rgwID[i], _rgServer[0].rgszName[i], NameAddress(_rgServer[0].rgszName[i]));
+
+	for(qwStartNs = HostTestNowNs(); !(rgbDone[0] && rgbDone[1] && rgbDone[2]) && HostTestNowNs() - qwStartNs < 500000000ull; )
+	{
+		Tasks();
+		for(j = 0; j < 2u; j++)
+		{
+			if(!rgbDone[j])
+				rgbDone[j] = DNSQueryIsResolved(rgh[j], &rgIP[j]);
+		}
+		if(!rgbDone[2])
+			rgbDone[2] = DNSIsResolved(&rgIP[2]);
+	}
+
+	for(i = 0; i < 3u; i++)
+	{
+		printf("  %-14s %u.%u.%u.%u\n", rgszName[i], rgIP[i].v[0], rgIP[i].v[1], rgIP[i].v[2], rgIP[i].v[3]);
+		HOST_TEST_CHECK(rgbDone[i] && rgIP[i].Val == NameAddress(rgszName[i]));
+	}
+	HOST_TEST_CHECK(DNSQueryEnd(rgh[0]) && DNSQueryEnd(rgh[1]) && DNSEndUsage());
+	HOST_TEST_CHECK(_rgServer[0].cQueries == 3u);
+}
+
+int main(int argc, char *argv[])
+{
+	static char szFailover[] = "failover.test", szSecondary[] = "secondary.test";
+	static char szRetry[] = "retry.test", szNone[] = "nobody.test";
+	IP_ADDR ip;
+	DNS_HANDLE h;
+	DWORD dwMs;
+
+	HostTestBegin();
+	_rgServer[0].port = HostMACAttach();
+	_rgServer[1].port = HostMACAttach();
+	if(!HOST_TEST_CHECK(_rgServer[0].port != HOST_MAC_INVALID_PORT && _rgServer[1].port != HOST_MAC_INVALID_PORT))
+		return HostTestEnd("dnstest");
+	AppConfig.PrimaryDNSServer = _rgServer[0].node.IPAddr;
+	AppConfig.SecondaryDNSServer = _rgServer[1].node.IPAddr;
+
+	Concurrent();
+
+	// a silent primary fails over to the secondary
+	Servers(TRUE, FALSE);
+	HOST_TEST_CHECK(Resolve(szFailover, &dwMs) == NameAddress(szFailover));
+	printf("  %-14s failed over in %lu ms\n", szFailover, (unsigned long)dwMs);
+	HOST_TEST_CHECK(dwMs >= DNS_TEST_TIMEOUT_MS && dwMs < 2u * DNS_TEST_TIMEOUT_MS);
+	HOST_TEST_CHECK(_rgServer[0].cQueries == 1u && _rgServer[1].cQueries == 1u);
+
+	// which is asked first from now on
+	Servers(TRUE, FALSE);
+	HOST_TEST_CHECK(Resolve(szSecondary, &dwMs) == NameAddress(szSecondary));
+	HOST_TEST_CHECK(dwMs < DNS_TEST_TIMEOUT_MS);
+	HOST_TEST_CHECK(_rgServer[0].cQueries == 0u && _rgServer[1].cQueries == 1u);
+
+	// with no secondary the primary is asked again; a late answer to the 
+	// first try must not be taken for the second
+	AppConfig.SecondaryDNSServer.Val = 0;
+	Servers(TRUE, FALSE);
+	h = DNSQueryBegin((BYTE*)szRetry, DNS_TYPE_A);
+	while(_rgServer[0].cQueries < 2u && !DNSQueryIsResolved(h, &ip))
+		Tasks();
+	if(HOST_TEST_CHECK(_rgServer[0].cQueries == 2u && _rgServer[1].cQueries == 0u))
+	{
+		HOST_TEST_CHECK(_rgServer[0].rgwID[0] != _rgServer[0].rgwID[1]);
+		Answer(&_rgServer[0], _rgServer[0].rgwID[0], szRetry, NameAddress(szFailover));
+		Answer(&_rgServer[0], _rgServer[0].rgwID[1], szRetry, NameAddress(szRetry));
+		while(!DNSQueryIsResolved(h, &ip))
+			Tasks();
+		HOST_TEST_CHECK(ip.Val == NameAddress(szRetry));
+	}
+	DNSQueryEnd(h);
+
+	// nobody answers, 0.0.0.0 after every try
+	Servers(TRUE, TRUE);
+	HOST_TEST_CHECK(Resolve(szNone, &dwMs) == 0u);
+	printf("  %-14s gave up in %lu ms\n", szNone, (unsigned long)dwMs);
+	HOST_TEST_CHECK(_rgServer[0].cQueries == 3u);
+
+	// the answers are cached
+	Servers(TRUE, TRUE);
+	HOST_TEST_CHECK(Resolve(szFailover, &dwMs) == NameAddress(szFailover));
+	HOST_TEST_CHECK(DNSCacheLookup((BYTE*)"ALPHA.test", DNS_TYPE_A, &ip) && ip.Val == NameAddress("alpha.test"));
+	HOST_TEST_CHECK(_rgServer[0].cQueries == 0u && _rgServer[1].cQueries == 0u);
+
+	HostMACDetach(_rgServer[0].port);
+	HostMACDetach(_rgServer[1].port);
+	return HostTestEnd("dnstest");
+}
@@ -0,0 +1,310 @@
+/************************************************************************/
+/*																		*/
+/*	dsctest.c	--  Reparses a sketch's USB descriptors                 */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	An example sketch's usb_descriptors.c, laid out with				*/
+/*	usb_dsc_builder.h, is built with the sketch's own usb_config.h		*/
+/*	and read back the way a host would: dsctest_generic has				*/
+/*	GenericUSB's, dsctest_hid CustomHID's.  Each descriptor is looked	*/
+/*	up as USBStdGetDscHandler() does, the device descriptor, the		*/
+/*	wTotalLength bytes at USB_CD_Ptr[index] and the bLength bytes at	*/
+/*	USB_SD_Ptr[index], and an index past USB_NUM_CONFIG_DESCRIPTORS		*/
+/*	or USB_NUM_STRING_DESCRIPTORS must stall.							*/
+/*																		*/
+/*	The configuration is walked one descriptor at a time.  The			*/
+/*	lengths must add up to wTotalLength, every interface must be		*/
+/*	followed by the endpoints it counts, and every endpoint must be		*/
+/*	used once, backed by the BDT and of a full speed packet size.  A	*/
+/*	HID descriptor must give its report descriptor's length, and the	*/
+/*	reports that descriptor defines must fit the endpoints.  Every		*/
+/*	string index must be served, every string be whole UTF-16 units.	*/
+/*																		*/
+/*	The builder's macros are checked at compile time as well, with		*/
+/*	its own USB_DSC_STATIC_ASSERT: a macro emitting the wrong number	*/
+/*	of bytes stops the build of this program.							*/
+/*																		*/
+/************************************************************************/
+
+#include "hosttest.h"
+#include "USB/usb.h"
+#include "USB/usb_dsc_builder.h"
+
+#if defined(USB_USE_HID)
+#include "USB/usb_function_hid.h"
+#define DSC_TEST_NAME			"dsctest_hid"
+#else
+#define DSC_TEST_NAME			"dsctest_generic"
+#endif
+
+#define DSC_TEST_HID			(0x21u)		// HID class descriptor type
+#define DSC_TEST_REPORT			(0x22u)		// HID report descriptor type
+
+extern ROM USB_DEVICE_DESCRIPTOR device_dsc;
+extern ROM BYTE *ROM USB_CD_Ptr[];
+extern ROM BYTE *ROM USB_SD_Ptr[];
+
+// The builder's layouts, byte for byte
+USB_DSC_STATIC_ASSERT(sizeof((BYTE[]){USB_DSC_CONFIGURATION(0, 1, 1, 0, _DEFAULT, 100)}) == USB_DSC_CONFIG_LEN, configuration_length);
+USB_DSC_STATIC_ASSERT(sizeof((BYTE[]){USB_DSC_INTERFACE(0, 0, 2, 0xFF, 0xFF, 0xFF, 0)}) == USB_DSC_INTERFACE_LEN, interface_length);
+USB_DSC_STATIC_ASSERT(sizeof((BYTE[]){USB_DSC_ENDPOINT(_EP01_IN, _BULK, 64, 1)}) == USB_DSC_ENDPOINT_LEN, endpoint_length);
+USB_DSC_STATIC_ASSERT(sizeof((BYTE[]){USB_DSC_HID(0x0111, 0, 28)}) == USB_DSC_HID_LEN, hid_length);
+USB_DSC_STATIC_ASSERT(USB_DSC_CONFIG_LENGTH(1, 2, USB_DSC_HID_LEN) == 9 + 9 + 9 + 2 * 7, config_length);
+USB_DSC_STATIC_ASSERT(USB_DSC_EP_SIZE_OK(_BULK, 64) && !USB_DSC_EP_SIZE_OK(_BULK, 63) && !USB_DSC_EP_SIZE_OK(_BULK, 128), bulk_sizes);
+USB_DSC_STATIC_ASSERT(USB_DSC_EP_SIZE_OK(_INTERRUPT, 3) && !USB_DSC_EP_SIZE_OK(_INTERRUPT, 65), interrupt_sizes);
+USB_DSC_STATIC_ASSERT(USB_DSC_EP_SIZE_OK(_ISO, 1023) && !USB_DSC_EP_SIZE_OK(_ISO, 1024), iso_sizes);
+USB_DSC_STATIC_ASSERT(USB_DSC_EP_NUMBER_OK(USB_MAX_EP_NUMBER | _EP_IN) && !USB_DSC_EP_NUMBER_OK(USB_MAX_EP_NUMBER + 1), ep_numbers);
+
+USB_DSC_STRING(sdProbe, 'U','S','B');
+USB_DSC_STATIC_ASSERT(sizeof(sdProbe) == 2 + 3 * sizeof(WORD), string_length);
+
+// The endpoints the configuration declares, for the HID reports
+static WORD _rgwEPSize[2][USB_MAX_EP_NUMBER + 1];		// [dir][ep]
+
+// What USBStdGetDscHandler() would send; FALSE where it stalls
+static BOOL GetDescriptor(BYTE bType, BYTE bIndex, ROM BYTE **pp, WORD *pcb)
+{
+	switch(bType)
+	{
+		case USB_DESCRIPTOR_DEVICE:
+			*pp = (ROM BYTE *)&device_dsc;
+			*pcb = sizeof(device_dsc);
+			return TRUE;
+
+		case USB_DESCRIPTOR_CONFIGURATION:
+			if(bIndex >= USB_NUM_CONFIG_DESCRIPTORS)
+				return FALSE;
+			*pp = USB_CD_Ptr[bIndex];
+			*pcb = (*pp)[2] | ((WORD)(*pp)[3] << 8);
+			return TRUE;
+
+		case USB_DESCRIPTOR_STRING:
+			if(bIndex >= USB_NUM_STRING_DESCRIPTORS)
+				return FALSE;
+			*pp = USB_SD_Ptr[bIndex];
+			*pcb = (*pp)[0];
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+// A string index in a descriptor; 0 is none
+static BOOL StringIndexOK(BYTE iString)
+{
+	ROM BYTE *p;
+	WORD cb;
+
+	return iString == 0 || GetDescriptor(USB_DESCRIPTOR_STRING, iString, &p, &cb);
+}
+
+static void CheckDevice(void)
+{
+	ROM BYTE *p;
+	WORD cb;
+
+	if(!HOST_TEST_CHECK(GetDescriptor(USB_DESCRIPTOR_DEVICE, 0, &p, &cb)))
+		return;
+
+	HOST_TEST_CHECK(cb == USB_DSC_DEVICE_LEN && p[0] == USB_DSC_DEVICE_LEN);
+	HOST_TEST_CHECK(p[1] == USB_DESCRIPTOR_DEVICE);
+	HOST_TEST_CHECK(p[7] == USB_EP0_BUFF_SIZE && USB_DSC_EP_SIZE_OK(0, p[7]));
+	HOST_TEST_CHECK(p[17] == USB_NUM_CONFIG_DESCRIPTORS);
+	HOST_TEST_CHECK(StringIndexOK(p[14]) && StringIndexOK(p[15]) && StringIndexOK(p[16]));
+}
+
+#if defined(USB_USE_HID)
+// Bytes in the input and output reports of a report descriptor
+static BOOL ParseReport(ROM BYTE *p, WORD cb, DWORD *pcbInput, DWORD *pcbOutput)
+{
+	DWORD dwSize = 0;
+	DWORD dwCount = 0;
+	DWORD dwBits[2] = {0, 0};
+	int cCollections = 0;
+	WORD i = 0;
+
+	while(i < cb)
+	{
+		BYTE bPrefix = p[i];
+		BYTE cbData = (bPrefix & 0x03) == 3 ? 4 : (bPrefix & 0x03);
+		DWORD dwData = 0;
+		BYTE j;
+
+		if(bPrefix == 0xFE || i + 1u + cbData > cb)
+			return FALSE;				// long items have no place here
+		for(j = 0; j < cbData; j++)
+			dwData |= (DWORD)p[i + 1 + j] << (8 * j);
+
+		switch(bPrefix & 0xFC)
+		{
+			case 0x74:	dwSize = dwData;					break;	// Report Size
+			case 0x94:	dwCount = dwData;					break;	// Report Count
+			case 0x80:	dwBits[0] += dwSize * dwCount;		break;	// Input
+			case 0x90:	dwBits[1] += dwSize * dwCount;		break;	// Output
+			case 0xA0:	cCollections++;						break;	// Collection
+			case 0xC0:	cCollections--;						break;	// End Collection
+		}
+		if(cCollections < 0)
+			return FALSE;
+
+		i += 1 + cbData;
+	}
+
+	*pcbInput = (dwBits[0] + 7) / 8;
+	*pcbOutput = (dwBits[1] + 7) / 8;
+
+	return cCollections == 0;
+}
+
+static void CheckReport(WORD cbReport)
+{
+	DWORD cbInput = 0;
+	DWORD cbOutput = 0;
+
+	HOST_TEST_CHECK(cbReport == HID_RPT01_SIZE && cbReport == sizeof(hid_rpt01));
+	if(!HOST_TEST_CHECK(ParseReport(hid_rpt01.report, sizeof(hid_rpt01), &cbInput, &cbOutput)))
+		return;
+
+	// a report must go in one packet of its endpoint
+	HOST_TEST_CHECK(cbInput <= _rgwEPSize[IN_TO_HOST][HID_EP]);
+	HOST_TEST_CHECK(cbOutput <= _rgwEPSize[OUT_FROM_HOST][HID_EP]);
+}
+#endif
+
+static void CheckConfiguration(BYTE bIndex)
+{
+	BOOL rgfUsed[2][USB_MAX_EP_NUMBER + 1];
+	ROM BYTE *p;
+	WORD cb;
+	WORD i;
+	BYTE cInterfaces = 0;
+	BYTE cEPExpected = 0;
+	BYTE cEP = 0;
+	BOOL fHID = FALSE;
+
+	if(!HOST_TEST_CHECK(GetDescriptor(USB_DESCRIPTOR_CONFIGURATION, bIndex, &p, &cb)))
+		return;
+
+	HOST_TEST_CHECK(p[0] == USB_DSC_CONFIG_LEN && p[1] == USB_DESCRIPTOR_CONFIGURATION);
+	HOST_TEST_CHECK(p[5] == bIndex + 1);	// SET_CONFIGURATION(n) selects USB_CD_Ptr[n - 1]
+	HOST_TEST_CHECK(StringIndexOK(p[6]));
+	HOST_TEST_CHECK((p[7] & _DEFAULT) != 0);
+
+	memset(rgfUsed, 0, sizeof(rgfUsed));
+	memset(_rgwEPSize, 0, sizeof(_rgwEPSize));
+
+	for(i = p[0]; i < cb; i += p[i])
+	{
+		// a descriptor running past wTotalLength, or one that is empty
+		if(!HOST_TEST_CHECK(p[i] >= 2 && i + p[i] <= cb))
+			return;
+
+		switch(p[i + 1])
+		{
+			case USB_DESCRIPTOR_INTERFACE:
+				HOST_TEST_CHECK(p[i] == USB_DSC_INTERFACE_LEN);
+				HOST_TEST_CHECK(cEP == cEPExpected);
+				HOST_TEST_CHECK(StringIndexOK(p[i + 8]));
+				if(p[i + 3] == 0)
+					cInterfaces++;
+				cEPExpected = p[i + 4];
+				cEP = 0;
+				break;
+
+			case USB_DESCRIPTOR_ENDPOINT:
+			{
+				BYTE bEP = p[i + 2] & 0x0F;
+				BYTE bDir = (p[i + 2] & _EP_IN) ? IN_TO_HOST : OUT_FROM_HOST;
+				WORD wSize = p[i + 4] | ((WORD)p[i + 5] << 8);
+
+				HOST_TEST_CHECK(p[i] == USB_DSC_ENDPOINT_LEN);
+				cEP++;
+				if(!HOST_TEST_CHECK(bEP != 0 && USB_DSC_EP_NUMBER_OK(bEP)))
+					break;
+				HOST_TEST_CHECK(USB_DSC_EP_SIZE_OK(p[i + 3], wSize));
+				HOST_TEST_CHECK(!rgfUsed[bDir][bEP]);
+				rgfUsed[bDir][bEP] = TRUE;
+				_rgwEPSize[bDir][bEP] = wSize;
+				break;
+			}
+
+			case DSC_TEST_HID:
+				HOST_TEST_CHECK(p[i] == 6 + 3 * p[i + 5]);
+				HOST_TEST_CHECK(p[i + 6] == DSC_TEST_REPORT);
+				fHID = TRUE;
+				break;
+		}
+	}
+
+	HOST_TEST_CHECK(i == cb);
+	HOST_TEST_CHECK(cEP == cEPExpected);
+	HOST_TEST_CHECK(cInterfaces == p[4]);
+
+#if defined(USB_USE_HID)
+	if(HOST_TEST_CHECK(fHID))
+	{
+		for(i = p[0]; i < cb && p[i + 1] != DSC_TEST_HID; i += p[i]);
+		CheckReport(p[i + 7] | ((WORD)p[i + 8] << 8));
+	}
+#else
+	HOST_TEST_CHECK(!fHID);
+#endif
+
+	printf("  configuration %u: %u bytes, %u interface(s)\n", bIndex + 1, cb, p[4]);
+}
+
+static void CheckStrings(void)
+{
+	ROM BYTE *p;
+	WORD cb;
+	BYTE i;
+
+	// the language IDs, US English
+	if(HOST_TEST_CHECK(GetDescriptor(USB_DESCRIPTOR_STRING, 0, &p, &cb)))
+		HOST_TEST_CHECK(cb == 4 && p[1] == USB_DESCRIPTOR_STRING && p[2] == 0x09 && p[3] == 0x04);
+
+	for(i = 1; i < USB_NUM_STRING_DESCRIPTORS; i++)
+	{
+		if(!HOST_TEST_CHECK(GetDescriptor(USB_DESCRIPTOR_STRING, i, &p, &cb)))
+			continue;
+		HOST_TEST_CHECK(cb >= 2 && (cb & 1) == 0 && p[1] == USB_DESCRIPTOR_STRING);
+	}
+
+	HOST_TEST_CHECK(!GetDescriptor(USB_DESCRIPTOR_STRING, USB_NUM_STRING_DESCRIPTORS, &p, &cb));
+	printf("  %u strings\n", USB_NUM_STRING_DESCRIPTORS);
+}
+
+int main(int argc, char *argv[])
+{
+	ROM BYTE *p;
+	WORD cb;
+	BYTE i;
+
+	CheckDevice();
+	for(i = 0; i < USB_NUM_CONFIG_DESCRIPTORS; i++)
+		CheckConfiguration(i);
+	HOST_TEST_CHECK(!GetDescriptor(USB_DESCRIPTOR_CONFIGURATION, USB_NUM_CONFIG_DESCRIPTORS, &p, &cb));
+	CheckStrings();
+
+	return HostTestEnd(DSC_TEST_NAME);
+}
@@ -0,0 +1,257 @@
+/************************************************************************/
+/*																		*/
+/*	enc28j60test.c	--  ENC28J60.c on the simulated chip                */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Runs ENC28J60.c against HostENC28J60.c's chip and compares what		*/
+/*	MACPutArray(), MACGetArray() and MACMemCopyAsync() move with the	*/
+/*	chip's buffer memory, at random addresses and lengths on both sides	*/
+/*	of ENC_SPI_DMA_THRESHOLD.  Frames are received across the end of	*/
+/*	the RX ring and read, checksummed and copied out of it, and sent	*/
+/*	with MACPutHeader() and MACFlush().  The Makefile builds it once	*/
+/*	with the CPU moving every byte and once with ENC_SPI_DMA; the DMA	*/
+/*	build must use the DMA transfers and never select the chip while a	*/
+/*	write is still going out.  enc28j60test [rounds [seed]]				*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+#include "TCPIP Stack/ENC28J60SPI.h"
+
+#define ENC_TEST_FRAMES			(200u)		// per round
+
+APP_CONFIG AppConfig;
+
+static const MAC_ADDR _PeerMAC = {{0x02, 0x00, 0x00, 0x00, 0x00, 0x01}};
+
+static DWORD _dwRandom;
+
+static DWORD Random(void)
+{
+	// xorshift32, so a failing seed can be run again
+	_dwRandom ^= _dwRandom << 13;
+	_dwRandom ^= _dwRandom >> 17;
+	_dwRandom ^= _dwRandom << 5;
+	return _dwRandom;
+}
+
+// Mostly short, so MACGetArray() and MACPutArray() go both ways
+static WORD RandomLength(WORD wMax)
+{
+	if(Random() % 2u)
+		return 1 + Random() % (wMax < 2u * ENC_SPI_DMA_THRESHOLD ? wMax : 2u * ENC_SPI_DMA_THRESHOLD);
+	return 1 + Random() % wMax;
+}
+
+static void RandomFill(BYTE *pData, WORD wLen)
+{
+	while(wLen--)
+		*pData++ = (BYTE)Random();
+}
+
+// RFC 1071, what CalcIPBufferChecksum() should get
+static WORD Checksum(const BYTE *pData, WORD wLen)
+{
+	DWORD dwSum = 0;
+	WORD i;
+
+	for(i = 0; i + 1u < wLen; i += 2)
+		dwSum += ((WORD)pData[i + 1] << 8) | pData[i];
+	if(wLen & 1u)
+		dwSum += pData[wLen - 1];
+	while(dwSum >> 16)
+		dwSum = (dwSum & 0xFFFFu) + (dwSum >> 16);
+
+	return ~(WORD)dwSum;
+}
+
+// MACPutArray() and MACGetArray() in the TX half of the chip
+static void PutGet(void)
+{
+	BYTE rgbData[1518], rgbRead[sizeof(rgbData)];
+	WORD wAddress, wLen;
+
+	wLen = RandomLength(sizeof(rgbData));
+	wAddress = BASE_TX_ADDR + Random() % (RAMSIZE - BASE_TX_ADDR - wLen + 1);
+	RandomFill(rgbData, wLen);
+
+	MACSetWritePtr(wAddress);
+	if(Random() % 4u)
+	{
+		MACPutArray(rgbData, wLen);
+	}
+	else
+	{
+		MACPut(rgbData[0]);
+		MACPutArray(rgbData + 1, wLen - 1u);
+	}
+	HOST_TEST_CHECK(MACSetWritePtr(BASE_TX_ADDR) == (wAddress + wLen) % RAMSIZE);
+	HOST_TEST_CHECK(memcmp(HostENCMemory() + wAddress, rgbData, wLen) == 0);
+
+	MACSetReadPtr(wAddress);
+	HOST_TEST_CHECK(MACGetArray(rgbRead, wLen) == wLen);
+	HOST_TEST_CHECK(memcmp(rgbRead, rgbData, wLen) == 0);
+	HOST_TEST_CHECK(MACSetReadPtr(wAddress) == (wAddress + wLen) % RAMSIZE);
+
+	// skipping moves the pointer just the same
+	HOST_TEST_CHECK(MACGetArray(NULL, wLen) == wLen);
+	HOST_TEST_CHECK(MACSetReadPtr(wAddress) == (wAddress + wLen) % RAMSIZE);
+	HOST_TEST_CHECK(MACGet() == rgbData[0]);
+}
+
+// MACMemCopyAsync() inside the TX half, with and without the pointers
+static void MemCopy(void)
+{
+	BYTE rgbData[600];
+	WORD wSrc, wDst, wLen;
+	BOOL bPointers = Random() % 2u;
+
+	wLen = 1 + Random() % sizeof(rgbData);
+	wSrc = BASE_TX_ADDR + Random() % (RAMSIZE - BASE_TX_ADDR - 2u * wLen + 1);
+	wDst = wSrc + wLen + Random() % (RAMSIZE - wSrc - 2u * wLen + 1);
+	if(Random() % 2u)
+	{
+		WORD w = wSrc;
+
+		wSrc = wDst;
+		wDst = w;
+	}
+	RandomFill(rgbData, wLen);
+	memcpy(HostENCMemory() + wSrc, rgbData, wLen);
+
+	if(bPointers)
+	{
+		MACSetReadPtr(wSrc);
+		MACSetWritePtr(wDst);
+		MACMemCopyAsync((PTR_BASE)-1, (PTR_BASE)-1, wLen);
+	}
+	else
+	{
+		MACMemCopyAsync(wDst, wSrc, wLen);
+	}
+	while(!MACIsMemCopyDone());
+
+	HOST_TEST_CHECK(memcmp(HostENCMemory() + wDst, rgbData, wLen) == 0);
+	if(bPointers)
+	{
+		HOST_TEST_CHECK(MACSetReadPtr(BASE_TX_ADDR) == (wSrc + wLen) % RAMSIZE);
+		HOST_TEST_CHECK(MACSetWritePtr(BASE_TX_ADDR) == (wDst + wLen) % RAMSIZE);
+	}
+}
+
+// A frame through the RX ring, which it may wrap, then sent back
+static void Frame(void)
+{
+	BYTE rgbFrame[1514], rgbRead[sizeof(rgbFrame)];
+	ETHER_HEADER *pHeader = (ETHER_HEADER*)rgbFrame;
+	MAC_ADDR Remote;
+	BYTE bType;
+	WORD wLen, wData, wOffset, wPart;
+
+	wLen = sizeof(ETHER_HEADER) + 46 + Random() % (sizeof(rgbFrame) - sizeof(ETHER_HEADER) - 46 + 1);
+	wData = wLen - sizeof(ETHER_HEADER);
+	RandomFill(rgbFrame, wLen);
+	pHeader->DestMACAddr = AppConfig.MyMACAddr;
+	pHeader->SourceMACAddr = _PeerMAC;
+	pHeader->Type.v[0] = 0x08;
+	pHeader->Type.v[1] = 0x00;
+
+	if(!HOST_TEST_CHECK(HostENCReceive(rgbFrame, wLen)))
+		return;
+	if(!HOST_TEST_CHECK(MACGetHeader(&Remote, &bType)))
+		return;
+	HOST_TEST_CHECK(memcmp(&Remote, &_PeerMAC, sizeof(Remote)) == 0);
+	HOST_TEST_CHECK(bType == MAC_IP);
+
+	HOST_TEST_CHECK(MACGetArray(rgbRead, wData) == wData);
+	HOST_TEST_CHECK(memcmp(rgbRead, rgbFrame + sizeof(ETHER_HEADER), wData) == 0);
+
+	wOffset = Random() % wData;
+	wPart = RandomLength(wData - wOffset);
+	MACSetReadPtrInRx(wOffset);
+	HOST_TEST_CHECK(MACGetArray(rgbRead, wPart) == wPart);
+	HOST_TEST_CHECK(memcmp(rgbRead, rgbFrame + sizeof(ETHER_HEADER) + wOffset, wPart) == 0);
+	HOST_TEST_CHECK(MACCalcRxChecksum(wOffset, wPart) == Checksum(rgbFrame + sizeof(ETHER_HEADER) + wOffset, wPart));
+
+	// the payload goes back out the way TCP and UDP copy it, by DMA
+	MACSetReadPtrInRx(0);
+	MACSetWritePtr(BASE_TX_ADDR + sizeof(ETHER_HEADER));
+	MACMemCopyAsync((PTR_BASE)-1, (PTR_BASE)-1, wData);
+	while(!MACIsMemCopyDone());
+	MACDiscardRx();
+	HOST_TEST_CHECK(MACGetFreeRxSize() == RXSIZE - 2u);
+
+	HOST_TEST_CHECK(MACIsTxReady());
+	MACPutHeader(&Remote, MAC_IP, wData);
+	MACFlush();
+	HOST_TEST_CHECK(HostENCGetTxFrame(rgbRead, sizeof(rgbRead)) == wLen);
+	HOST_TEST_CHECK(memcmp(rgbRead, &_PeerMAC, sizeof(MAC_ADDR)) == 0);
+	HOST_TEST_CHECK(memcmp(rgbRead + sizeof(MAC_ADDR), &AppConfig.MyMACAddr, sizeof(MAC_ADDR)) == 0);
+	HOST_TEST_CHECK(memcmp(rgbRead + sizeof(ETHER_HEADER) - 2, rgbFrame + sizeof(ETHER_HEADER) - 2, wData + 2) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+	static const MAC_ADDR MyMAC = {{0x00, 0x04, 0xA3, 0x12, 0x34, 0x56}};
+	HOST_ENC_STATS Stats;
+	DWORD dwRounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 20;
+	DWORD i, j;
+
+	_dwRandom = argc > 2 ? strtoul(argv[2], NULL, 0) : 0x2012u;
+	#if defined(ENC_SPI_DMA)
+	printf("enc28j60test: %lu rounds, seed 0x%lX, ENC_SPI_DMA\n", (unsigned long)dwRounds, (unsigned long)_dwRandom);
+	#else
+	printf("enc28j60test: %lu rounds, seed 0x%lX\n", (unsigned long)dwRounds, (unsigned long)_dwRandom);
+	#endif
+
+	AppConfig.MyMACAddr = MyMAC;
+	MACInit();
+	HOST_TEST_CHECK(MACIsLinked());
+	HOST_TEST_CHECK(ReadPHYReg(PHCON2).Val == PHCON2_HDLDIS);
+	HostENCGetStats(&Stats, TRUE);
+
+	for(i = 0; i < dwRounds && HostTestFailures < 10; i++)
+	{
+		for(j = 0; j < ENC_TEST_FRAMES; j++)
+		{
+			PutGet();
+			MemCopy();
+			Frame();
+		}
+	}
+
+	HostENCGetStats(&Stats, FALSE);
+	printf("  %lu bytes, %lu DMA reads, %lu DMA writes, CPU waited %lu%% of the wire time\n",
+		(unsigned long)Stats.dwBytes, (unsigned long)Stats.cReads, (unsigned long)Stats.cWrites,
+		(unsigned long)(Stats.qwWireNs ? Stats.qwWaitNs * 100u / Stats.qwWireNs : 0u));
+	HOST_TEST_CHECK(Stats.cOverlaps == 0u);
+	#if defined(ENC_SPI_DMA)
+	HOST_TEST_CHECK(Stats.cReads != 0u && Stats.cWrites != 0u);
+	#else
+	HOST_TEST_CHECK(Stats.cReads == 0u && Stats.cWrites == 0u);
+	#endif
+
+	return HostTestEnd("enc28j60test");
+}
@@ -0,0 +1,192 @@
+/************************************************************************/
+/*																		*/
+/*	findtest.c	--  TCPFindArrayEx() against a linear search            */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Fills a server socket's RX FIFO with random data over loopback,		*/
+/*	wrapping it at a different place every round, and checks			*/
+/*	TCPFindArrayEx() and TCPFindEx() against a plain linear search of	*/
+/*	the same bytes read with TCPPeekArray().  Patterns are mostly cut	*/
+/*	from the data, so there are plenty of partial matches, and run		*/
+/*	past TCP_FIND_CACHE_LEN; start, search length and case folding are	*/
+/*	random too.  The Makefile builds it twice, once with the FIFOs in	*/
+/*	TCP_PIC_RAM and once in TCP_ETH_RAM, which reads through the		*/
+/*	search's block cache.  findtest [rounds [seed]]						*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define FIND_PORT				(9400u)
+#define FIND_SEARCHES			(50u)		// per round
+
+static DWORD _dwRandom;
+
+static DWORD Random(void)
+{
+	// xorshift32, so a failing seed can be run again
+	_dwRandom ^= _dwRandom << 13;
+	_dwRandom ^= _dwRandom >> 17;
+	_dwRandom ^= _dwRandom << 5;
+	return _dwRandom;
+}
+
+static BYTE RandomByte(void)
+{
+	// mostly a few letters in both cases, so matches and near misses are common
+	static const BYTE rgbAlphabet[] = "aAbBcC\r\n";
+
+	if(Random() % 4u)
+		return rgbAlphabet[Random() % (sizeof(rgbAlphabet) - 1)];
+	return (BYTE)Random();
+}
+
+static BYTE Fold(BYTE c, BOOL bTextCompare)
+{
+	return (bTextCompare && c >= 'a' && c <= 'z') ? c + 'A' - 'a' : c;
+}
+
+// What TCPFindArrayEx() should return for pbData[0..wDataLen)
+static WORD LinearFind(const BYTE *pbData, WORD wDataLen, const BYTE *pbFind, WORD wLen,
+						WORD wStart, WORD wSearchLen, BOOL bTextCompare)
+{
+	WORD wEnd, wPos, k;
+
+	if(wLen == 0u)
+		return 0;
+	if(wStart >= wDataLen)
+		return 0xFFFF;
+
+	wEnd = wDataLen;
+	if(wSearchLen && wStart + wSearchLen < wEnd)
+		wEnd = wStart + wSearchLen;
+
+	for(wPos = wStart; wPos + wLen <= wEnd; wPos++)
+	{
+		for(k = 0; k < wLen; k++)
+		{
+			if(Fold(pbData[wPos + k], bTextCompare) != Fold(pbFind[k], bTextCompare))
+				break;
+		}
+		if(k == wLen)
+			return wPos;
+	}
+
+	return 0xFFFF;
+}
+
+static TCP_SOCKET _hClient, _hServer;
+static WORD _wDataLen;
+
+static BOOL DataAcked(void *pContext)
+{
+	return TCPGetTxFIFOFull(_hClient) == 0u;
+}
+
+static BOOL DataIn(void *pContext)
+{
+	return TCPIsGetReady(_hServer) >= _wDataLen;
+}
+
+static void Round(TCP_SOCKET hClient, TCP_SOCKET hServer)
+{
+	BYTE rgbData[HOST_TCP_FIFO_SIZE], rgbFind[100];
+	WORD wDataLen, wLen, wStart, wSearchLen, wGot, wWant, i;
+	BOOL bText;
+
+	// the discard ACKs the last round's data at once, which empties the
+	// client's TX FIFO without waiting for a delayed ACK
+	_hClient = hClient;
+	_hServer = hServer;
+	TCPDiscard(hServer);
+	if(!HOST_TEST_CHECK(HostTestRunUntil(DataAcked, NULL, 1000)))
+		return;
+
+	// a random amount, so the data wraps the FIFO at a different place
+	wDataLen = 1 + Random() % (sizeof(rgbData) - 1);
+	for(i = 0; i < wDataLen; i++)
+		rgbData[i] = RandomByte();
+	TCPPutArray(hClient, rgbData, wDataLen);
+	TCPFlush(hClient);
+	_wDataLen = wDataLen;
+	if(!HOST_TEST_CHECK(HostTestRunUntil(DataIn, NULL, 1000)) ||
+	   !HOST_TEST_CHECK(TCPIsGetReady(hServer) == wDataLen))
+		return;
+	HOST_TEST_CHECK(TCPPeekArray(hServer, rgbData, wDataLen, 0) == wDataLen);
+
+	for(i = 0; i < FIND_SEARCHES; i++)
+	{
+		wLen = 1 + Random() % (Random() % 4u ? 8u : sizeof(rgbFind));
+		if(wLen <= wDataLen && Random() % 8u)
+		{
+			// from the data, the case of some letters flipped
+			memcpy(rgbFind, &rgbData[Random() % (wDataLen - wLen + 1)], wLen);
+			if(Random() % 2u)
+				rgbFind[Random() % wLen] ^= 0x20;
+		}
+		else
+		{
+			for(wWant = 0; wWant < wLen; wWant++)
+				rgbFind[wWant] = RandomByte();
+		}
+
+		wStart = Random() % 4u ? 0 : Random() % (wDataLen + 2);
+		wSearchLen = Random() % 2u ? 0 : Random() % (wDataLen + 2);
+		bText = Random() % 2u;
+
+		wWant = LinearFind(rgbData, wDataLen, rgbFind, wLen, wStart, wSearchLen, bText);
+		wGot = TCPFindArrayEx(hServer, rgbFind, wLen, wStart, wSearchLen, bText);
+		if(!HOST_TEST_CHECK(wGot == wWant))
+			fprintf(stderr, "  array: data %u, pattern %u, start %u, search %u, text %u: got %u, want %u\n",
+				wDataLen, wLen, wStart, wSearchLen, bText, wGot, wWant);
+
+		wWant = LinearFind(rgbData, wDataLen, rgbFind, 1, wStart, wSearchLen, bText);
+		wGot = TCPFindEx(hServer, rgbFind[0], wStart, wSearchLen, bText);
+		if(!HOST_TEST_CHECK(wGot == wWant))
+			fprintf(stderr, "  byte: data %u, start %u, search %u, text %u: got %u, want %u\n",
+				wDataLen, wStart, wSearchLen, bText, wGot, wWant);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	TCP_SOCKET hClient, hServer;
+	DWORD dwRounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 10000;
+	DWORD i;
+
+	_dwRandom = argc > 2 ? strtoul(argv[2], NULL, 0) : 0x2012u;
+	printf("findtest: %lu rounds, seed 0x%lX, FIFOs in %s\n", (unsigned long)dwRounds,
+		(unsigned long)_dwRandom, HOST_TCP_MEDIUM == TCP_ETH_RAM ? "TCP_ETH_RAM" : "TCP_PIC_RAM");
+
+	HostTestBegin();
+	if(HOST_TEST_CHECK(HostTestConnect(FIND_PORT, &hClient, &hServer)))
+	{
+		for(i = 0; i < dwRounds && HostTestFailures < 10; i++)
+			Round(hClient, hServer);
+		HostTestClose(hClient, hServer);
+	}
+
+	return HostTestEnd("findtest");
+}
@@ -0,0 +1,99 @@
+/************************************************************************/
+/*																		*/
+/*	hostdisk.cpp	--  A RAM disk for MDDFS on host builds             */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	See include/chipKITUSBMSDHost.h.									*/
+/*																		*/
+/************************************************************************/
+
+#include "chipKITUSBHost.h"
+#include "chipKITUSBMSDHost.h"
+
+static BYTE *_pbDisk;
+static DWORD _dwSectors;
+static HOST_DISK_STATS _Stats;
+static MEDIA_INFORMATION _Info;
+
+// A blank disk of dwSectors, replacing any there was
+BOOL HostDiskBegin(DWORD dwSectors)
+{
+	free(_pbDisk);
+	_pbDisk = (BYTE*)calloc(dwSectors, MEDIA_SECTOR_SIZE);
+	_dwSectors = _pbDisk ? dwSectors : 0;
+	memset(&_Stats, 0, sizeof(_Stats));
+
+	return _pbDisk != NULL ? TRUE : FALSE;
+}
+
+void HostDiskGetStats(HOST_DISK_STATS *pStats, BOOL bReset)
+{
+	*pStats = _Stats;
+	if(bReset)
+		memset(&_Stats, 0, sizeof(_Stats));
+}
+
+MEDIA_INFORMATION *HostDiskMediaInitialize(void)
+{
+	_Info.errorCode = _pbDisk ? MEDIA_NO_ERROR : MEDIA_DEVICE_NOT_PRESENT;
+	_Info.validityFlags.value = 0;
+	_Info.validityFlags.bits.sectorSize = TRUE;
+	_Info.sectorSize = MEDIA_SECTOR_SIZE;
+
+	return &_Info;
+}
+
+BYTE HostDiskMediaDetect(void)
+{
+	return _pbDisk != NULL;
+}
+
+BYTE HostDiskSectorRead(DWORD dwSector, BYTE *pBuffer)
+{
+	if(dwSector >= _dwSectors)
+		return FALSE;
+
+	memcpy(pBuffer, _pbDisk + (size_t)dwSector * MEDIA_SECTOR_SIZE, MEDIA_SECTOR_SIZE);
+	_Stats.cReads++;
+	return TRUE;
+}
+
+BYTE HostDiskSectorWrite(DWORD dwSector, BYTE *pBuffer, BYTE bAllowWriteToZero)
+{
+	if(dwSector >= _dwSectors || (dwSector == 0u && !bAllowWriteToZero))
+		return FALSE;
+
+	memcpy(_pbDisk + (size_t)dwSector * MEDIA_SECTOR_SIZE, pBuffer, MEDIA_SECTOR_SIZE);
+	_Stats.cWrites++;
+	return TRUE;
+}
+
+BYTE HostDiskWriteProtectState(void)
+{
+	return FALSE;
+}
+
+BYTE HostDiskShutdownMedia(void)
+{
+	return TRUE;
+}
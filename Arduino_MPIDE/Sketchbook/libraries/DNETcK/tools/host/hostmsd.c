@@ -0,0 +1,342 @@
+/************************************************************************/
+/*																		*/
+/*	hostmsd.c	--  Mass storage devices on a simulated bus             */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	usb_host_msd.c's interface, as usb_host_msd_scsi.c and the thunks	*/
+/*	of chipKITUSBMSDHost.cpp call it, over devices in RAM rather than	*/
+/*	the USB host stack.  HostMsdAttach() stands for an enumeration		*/
+/*	that got as far as GET MAX LUN and tells the SCSI layer what		*/
+/*	usb_host_msd.c would, through the functions the sketch's			*/
+/*	usbMediaInterfaceTable names; HostMsdDetach() is the cable pulled.	*/
+/*																		*/
+/*	Every LUN of a device is a slot a medium of any sector size can		*/
+/*	be put in.  A transfer is carried out whole when it starts and		*/
+/*	completes on the next USBHostMSDTasks(), so the SCSI layer has to	*/
+/*	poll as it does on the board.  The devices check what a real one	*/
+/*	would: the LUN against the max LUN, the direction, the LBA range	*/
+/*	and that the data phase is as long as the blocks the command asks	*/
+/*	for, which is a phase error otherwise.								*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "USB/usb.h"
+#include "USB/usb_host_msd.h"
+#include "USB/usb_host_msd_scsi.h"
+
+#define HOST_MSD_DEVICES		(4u)
+#define HOST_MSD_LUNS			(4u)		// max LUN + 1 a device can have
+
+#define SCSI_TEST_UNIT_READY	(0x00u)
+#define SCSI_REQUEST_SENSE		(0x03u)
+#define SCSI_READ_CAPACITY_10	(0x25u)
+#define SCSI_READ_10			(0x28u)
+#define SCSI_WRITE_10			(0x2Au)
+
+typedef struct
+{
+	BYTE	*pbImage;			// NULL when the slot is empty
+	DWORD	dwSectors;
+	WORD	wSectorSize;
+} HOST_MSD_MEDIUM;
+
+typedef struct
+{
+	BYTE			address;	// 0 when not attached
+	BYTE			maxLUN;
+	BOOL			fBusy;		// a transfer is under way
+	BOOL			fDone;		// and USBHostMSDTasks() completed it
+	BYTE			bError;
+	DWORD			cbMoved;
+	HOST_MSD_MEDIUM	rgMedium[HOST_MSD_LUNS];
+	HOST_MSD_STATS	stats;
+} HOST_MSD_DEVICE;
+
+static HOST_MSD_DEVICE _rgDevice[HOST_MSD_DEVICES];
+
+static HOST_MSD_DEVICE *FindDevice(BYTE address)
+{
+	BYTE i;
+
+	for(i = 0; address != 0 && i < HOST_MSD_DEVICES; i++)
+	{
+		if(_rgDevice[i].address == address)
+			return &_rgDevice[i];
+	}
+
+	return NULL;
+}
+
+static DWORD BigEndian32(const BYTE *pb)
+{
+	return ((DWORD)pb[0] << 24) | ((DWORD)pb[1] << 16) | ((DWORD)pb[2] << 8) | pb[3];
+}
+
+// The command's data and status phases; the error code the transfer ends with
+static BYTE Execute(HOST_MSD_DEVICE *pDevice, BYTE LUN, BYTE direction, const BYTE *pbCB,
+					BYTE *pbData, DWORD cbData)
+{
+	HOST_MSD_MEDIUM *pMedium = &pDevice->rgMedium[LUN];
+	DWORD dwLBA;
+	DWORD cbBlocks;
+	WORD cBlocks;
+
+	pDevice->stats.cCommands++;
+	pDevice->stats.bLastLUN = LUN;
+	pDevice->cbMoved = 0;
+
+	switch(pbCB[0])
+	{
+		case SCSI_TEST_UNIT_READY:
+			return pMedium->pbImage != NULL ? USB_MSD_COMMAND_PASSED : USB_MSD_COMMAND_FAILED;
+
+		case SCSI_REQUEST_SENSE:
+			// the sense data is not kept, the SCSI layer only reads it to clear the condition
+			pDevice->cbMoved = cbData < 18 ? cbData : 18;
+			memset(pbData, 0, pDevice->cbMoved);
+			return USB_MSD_COMMAND_PASSED;
+
+		case SCSI_READ_CAPACITY_10:
+			if(pMedium->pbImage == NULL)
+				return USB_MSD_COMMAND_FAILED;
+			if(direction != 1 || cbData < 8)
+				return USB_MSD_PHASE_ERROR;
+
+			// the last LBA, then the block length, both big endian
+			pbData[0] = (BYTE)((pMedium->dwSectors - 1) >> 24);
+			pbData[1] = (BYTE)((pMedium->dwSectors - 1) >> 16);
+			pbData[2] = (BYTE)((pMedium->dwSectors - 1) >> 8);
+			pbData[3] = (BYTE)(pMedium->dwSectors - 1);
+			pbData[4] = 0;
+			pbData[5] = 0;
+			pbData[6] = (BYTE)(pMedium->wSectorSize >> 8);
+			pbData[7] = (BYTE)pMedium->wSectorSize;
+			pDevice->cbMoved = 8;
+			return USB_MSD_COMMAND_PASSED;
+
+		case SCSI_READ_10:
+		case SCSI_WRITE_10:
+			if(pMedium->pbImage == NULL)
+				return USB_MSD_COMMAND_FAILED;
+
+			dwLBA = BigEndian32(&pbCB[2]);
+			cBlocks = ((WORD)pbCB[7] << 8) | pbCB[8];
+			cbBlocks = (DWORD)cBlocks * pMedium->wSectorSize;
+			if(direction != (pbCB[0] == SCSI_READ_10 ? 1 : 0) || cbData != cbBlocks)
+				return USB_MSD_PHASE_ERROR;
+			if(dwLBA >= pMedium->dwSectors || cBlocks > pMedium->dwSectors - dwLBA)
+				return USB_MSD_COMMAND_FAILED;
+
+			if(pbCB[0] == SCSI_READ_10)
+			{
+				memcpy(pbData, pMedium->pbImage + dwLBA * pMedium->wSectorSize, cbBlocks);
+				pDevice->stats.cReads++;
+				pDevice->stats.cSectorsRead += cBlocks;
+			}
+			else
+			{
+				memcpy(pMedium->pbImage + dwLBA * pMedium->wSectorSize, pbData, cbBlocks);
+				pDevice->stats.cWrites++;
+				pDevice->stats.cSectorsWritten += cBlocks;
+			}
+			if(cBlocks > pDevice->stats.cMaxSectors)
+				pDevice->stats.cMaxSectors = cBlocks;
+			pDevice->cbMoved = cbBlocks;
+			return USB_MSD_COMMAND_PASSED;
+
+		default:
+			return USB_MSD_COMMAND_FAILED;
+	}
+}
+
+// A device with LUNs 0 to maxLUN, all empty; FALSE if the SCSI layer had no room for it
+BOOL HostMsdAttach(BYTE address, BYTE maxLUN)
+{
+	HOST_MSD_DEVICE *pDevice = FindDevice(address);
+	BYTE i;
+
+	if(address == 0 || pDevice != NULL || maxLUN >= HOST_MSD_LUNS)
+		return FALSE;
+
+	for(i = 0; i < HOST_MSD_DEVICES && pDevice == NULL; i++)
+	{
+		if(_rgDevice[i].address == 0)
+			pDevice = &_rgDevice[i];
+	}
+	if(pDevice == NULL)
+		return FALSE;
+
+	memset(pDevice, 0, sizeof(HOST_MSD_DEVICE));
+	pDevice->address = address;
+	pDevice->maxLUN = maxLUN;
+
+	if(!USBHostMSDSCSIInitialize(address, 0, 0))
+	{
+		pDevice->address = 0;
+		return FALSE;
+	}
+	USBHostMSDSCSIEventHandler(address, EVENT_MSD_MAX_LUN, &pDevice->maxLUN, 1);
+
+	return TRUE;
+}
+
+void HostMsdDetach(BYTE address)
+{
+	HOST_MSD_DEVICE *pDevice = FindDevice(address);
+	BYTE i;
+
+	if(pDevice == NULL)
+		return;
+
+	USBHostMSDSCSIEventHandler(address, EVENT_DETACH, NULL, 0);
+
+	for(i = 0; i < HOST_MSD_LUNS; i++)
+		free(pDevice->rgMedium[i].pbImage);
+	memset(pDevice, 0, sizeof(HOST_MSD_DEVICE));
+}
+
+// A blank medium of dwSectors in a LUN, replacing any there was; its image
+BYTE *HostMsdInsert(BYTE address, BYTE LUN, DWORD dwSectors, WORD wSectorSize)
+{
+	HOST_MSD_DEVICE *pDevice = FindDevice(address);
+	HOST_MSD_MEDIUM *pMedium;
+
+	if(pDevice == NULL || LUN > pDevice->maxLUN || dwSectors == 0 || wSectorSize == 0)
+		return NULL;
+
+	pMedium = &pDevice->rgMedium[LUN];
+	free(pMedium->pbImage);
+	pMedium->pbImage = (BYTE *)calloc(dwSectors, wSectorSize);
+	pMedium->dwSectors = pMedium->pbImage ? dwSectors : 0;
+	pMedium->wSectorSize = wSectorSize;
+
+	return pMedium->pbImage;
+}
+
+void HostMsdGetStats(BYTE address, HOST_MSD_STATS *pStats, BOOL bReset)
+{
+	HOST_MSD_DEVICE *pDevice = FindDevice(address);
+
+	if(pDevice == NULL)
+	{
+		memset(pStats, 0, sizeof(HOST_MSD_STATS));
+		return;
+	}
+
+	*pStats = pDevice->stats;
+	if(bReset)
+		memset(&pDevice->stats, 0, sizeof(HOST_MSD_STATS));
+}
+
+// usb_host_msd.c's interface
+BYTE USBHostMSDDeviceStatus(BYTE deviceAddress)
+{
+	return FindDevice(deviceAddress) != NULL ? USB_MSD_NORMAL_RUNNING : USB_MSD_DEVICE_NOT_FOUND;
+}
+
+BYTE USBHostMSDResetDevice(BYTE deviceAddress)
+{
+	HOST_MSD_DEVICE *pDevice = FindDevice(deviceAddress);
+
+	if(pDevice == NULL)
+		return USB_MSD_DEVICE_NOT_FOUND;
+
+	pDevice->fBusy = FALSE;
+	pDevice->bError = USB_SUCCESS;
+	pDevice->cbMoved = 0;
+	return USB_SUCCESS;
+}
+
+void USBHostMSDTasks(void)
+{
+	BYTE i;
+
+	for(i = 0; i < HOST_MSD_DEVICES; i++)
+	{
+		if(_rgDevice[i].fBusy)
+			_rgDevice[i].fDone = TRUE;
+	}
+}
+
+void USBHostMSDTerminateTransfer(BYTE deviceAddress)
+{
+	HOST_MSD_DEVICE *pDevice = FindDevice(deviceAddress);
+
+	if(pDevice != NULL)
+		pDevice->fBusy = FALSE;
+}
+
+BYTE USBHostMSDTransfer(BYTE deviceAddress, BYTE deviceLUN, BYTE direction, BYTE *commandBlock,
+						BYTE commandBlockLength, BYTE *data, DWORD dataLength)
+{
+	HOST_MSD_DEVICE *pDevice = FindDevice(deviceAddress);
+
+	if(pDevice == NULL)
+		return USB_MSD_DEVICE_NOT_FOUND;
+	if(pDevice->fBusy)
+		return USB_MSD_DEVICE_BUSY;
+	if(deviceLUN > pDevice->maxLUN)
+		return USB_MSD_INVALID_LUN;
+
+	pDevice->bError = Execute(pDevice, deviceLUN, direction, commandBlock, data, dataLength);
+	pDevice->fBusy = TRUE;
+	pDevice->fDone = FALSE;
+
+	return USB_SUCCESS;
+}
+
+BOOL USBHostMSDTransferIsComplete(BYTE deviceAddress, BYTE *errorCode, DWORD *byteCount)
+{
+	HOST_MSD_DEVICE *pDevice = FindDevice(deviceAddress);
+
+	if(pDevice == NULL)
+	{
+		*errorCode = USB_MSD_DEVICE_NOT_FOUND;
+		*byteCount = 0;
+		return TRUE;
+	}
+	if(pDevice->fBusy && !pDevice->fDone)
+		return FALSE;
+
+	pDevice->fBusy = FALSE;
+	*errorCode = pDevice->bError;
+	*byteCount = pDevice->cbMoved;
+	return TRUE;
+}
+
+// Enumeration is HostMsdAttach()'s; chipKITUSBMSDHost.cpp still links these
+BOOL USBHostMSDInitialize(BYTE address, DWORD flags, BYTE clientDriverID)
+{
+	return FALSE;
+}
+
+BOOL USBHostMSDEventHandler(BYTE address, USB_EVENT event, void *data, DWORD size)
+{
+	return FALSE;
+}
+
+void USBHostTasks(void)
+{
+}
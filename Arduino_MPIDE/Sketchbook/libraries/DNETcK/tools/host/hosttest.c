@@ -0,0 +1,426 @@
+/************************************************************************/
+/*																		*/
+/*	hosttest.c	--  Helpers for the host build's tests and benchmarks   */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	See hosttest.h.														*/
+/*																		*/
+/************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "hosttest.h"
+#include "DNETcK.h"
+#include "DNETcKAPI.h"
+
+int HostTestFailures = 0;
+
+// A program on HostENC28J60.c's chip or on hostusb.c has no stack to run,
+// only the checks
+#if !defined(HOST_ENC28J60) && !defined(HOST_TEST_USB)
+
+void HostTestBegin(void)
+{
+	static const BYTE rgbIP[4] = HOST_TEST_IP;
+	static const BYTE rgbGateway[4] = {192, 168, 1, 1};
+	static const BYTE rgbMask[4] = {255, 255, 255, 0};
+	static const BYTE rgbDNS1[4] = {192, 168, 1, 1};
+	static const BYTE rgbDNS2[4] = {192, 168, 1, 2};
+
+	EthernetBegin(rgbIP, rgbGateway, rgbMask, rgbDNS1, rgbDNS2);
+	HostTestTasks();
+}
+
+// This stack as the remote node of a loopback connection
+void HostTestSelf(NODE_INFO *pNode)
+{
+	pNode->IPAddr = AppConfig.MyIPAddr;
+	pNode->MACAddr = AppConfig.MyMACAddr;
+}
+
+void HostTestTasks(void)
+{
+	EthernetPeriodicTasks();
+}
+
+// Runs the stack until pfnDone returns TRUE or dwMs have gone by
+BOOL HostTestRunUntil(BOOL (*pfnDone)(void *pContext), void *pContext, DWORD dwMs)
+{
+	QWORD qwEndNs = HostTestNowNs() + (QWORD)dwMs * 1000000ull;
+
+	do
+	{
+		HostTestTasks();
+		if(pfnDone(pContext))
+			return TRUE;
+	} while(HostTestNowNs() < qwEndNs);
+
+	return FALSE;
+}
+
+void HostTestRunFor(DWORD dwMs)
+{
+	QWORD qwEndNs = HostTestNowNs() + (QWORD)dwMs * 1000000ull;
+
+	while(HostTestNowNs() < qwEndNs)
+		HostTestTasks();
+}
+
+static BOOL BothConnected(void *pContext)
+{
+	TCP_SOCKET *rgh = (TCP_SOCKET*)pContext;
+
+	return TCPIsConnected(rgh[0]) && TCPIsConnected(rgh[1]);
+}
+
+// Opens a listening socket on wPort and connects a client socket to it
+BOOL HostTestConnect(WORD wPort, TCP_SOCKET *phClient, TCP_SOCKET *phServer)
+{
+	static NODE_INFO self;
+	TCP_SOCKET rgh[2];
+
+	HostTestSelf(&self);
+	rgh[1] = TCPOpen(0, TCP_OPEN_SERVER, wPort, TCP_PURPOSE_DEFAULT);
+	rgh[0] = TCPOpen((PTR_BASE)&self, TCP_OPEN_NODE_INFO, wPort, TCP_PURPOSE_DEFAULT);
+	if(rgh[0] == INVALID_SOCKET || rgh[1] == INVALID_SOCKET)
+		return FALSE;
+
+	*phClient = rgh[0];
+	*phServer = rgh[1];
+	return HostTestRunUntil(BothConnected, rgh, 2000);
+}
+
+// Closes both ends of a HostTestConnect() connection and frees the sockets.
+// One end goes first: closed at the same time both sit in TCP_CLOSING until
+// the FIN retransmissions run out.
+void HostTestClose(TCP_SOCKET hClient, TCP_SOCKET hServer)
+{
+	TCPClose(hClient);
+	HostTestRunFor(5);
+	TCPClose(hServer);
+	HostTestRunFor(5);
+}
+
+// Puts the peer on the switch, returns its port
+BYTE HostTestPeerAttach(void)
+{
+	return HostMACAttach();
+}
+
+// The peer as the remote node of a UDP socket, no ARP needed
+void HostTestPeer(NODE_INFO *pNode)
+{
+	static const BYTE rgbIP[4] = HOST_TEST_PEER_IP;
+	static const BYTE rgbMAC[6] = HOST_TEST_PEER_MAC;
+
+	memcpy(&pNode->IPAddr, rgbIP, sizeof(rgbIP));
+	memcpy(&pNode->MACAddr, rgbMAC, sizeof(rgbMAC));
+}
+
+/*****************************************************************************
+  Function:
+	WORD HostTestPeerUdpFrame(BYTE *pFrame, WORD wSrcPort, WORD wDstPort,
+								const BYTE *pData, WORD wLen)
+
+  Summary:
+	Builds a UDP frame from the peer to this stack
+
+  Description:
+	The IP and UDP checksums are filled in.
+
+  Precondition:
+	HostTestBegin() has been called
+
+  Parameters:
+	pFrame - room for the frame, HOST_MAC_FRAME_SIZE bytes
+	wSrcPort - the peer's UDP port
+	wDstPort - this stack's UDP port
+	pData - the payload
+	wLen - its length, up to 1472 bytes
+
+  Returns:
+  	The length of the frame
+  ***************************************************************************/
+WORD HostTestPeerUdpFrame(BYTE *pFrame, WORD wSrcPort, WORD wDstPort, const BYTE *pData, WORD wLen)
+{
+	ETHER_HEADER *pEther = (ETHER_HEADER*)pFrame;
+	IP_HEADER *pIP = (IP_HEADER*)(pEther + 1);
+	UDP_HEADER *pUDP = (UDP_HEADER*)(pIP + 1);
+	PSEUDO_HEADER pseudo;
+	NODE_INFO peer;
+	DWORD_VAL sum;
+
+	HostTestPeer(&peer);
+	pEther->DestMACAddr = AppConfig.MyMACAddr;
+	pEther->SourceMACAddr = peer.MACAddr;
+	pEther->Type.Val = swaps(0x0800);
+
+	memset(pIP, 0, sizeof(*pIP));
+	pIP->VersionIHL = 0x45;
+	pIP->TotalLength = swaps(sizeof(IP_HEADER) + sizeof(UDP_HEADER) + wLen);
+	pIP->TimeToLive = 64;
+	pIP->Protocol = IP_PROT_UDP;
+	pIP->SourceAddress = peer.IPAddr;
+	pIP->DestAddress = AppConfig.MyIPAddr;
+	pIP->HeaderChecksum = CalcIPChecksum((BYTE*)pIP, sizeof(*pIP));
+
+	pUDP->SourcePort = swaps(wSrcPort);
+	pUDP->DestinationPort = swaps(wDstPort);
+	pUDP->Length = swaps(sizeof(UDP_HEADER) + wLen);
+	pUDP->Checksum = 0;
+	memcpy(pUDP + 1, pData, wLen);
+
+	// pseudo header, then the datagram, summed as one's complement words
+	pseudo.SourceAddress = pIP->SourceAddress;
+	pseudo.DestAddress = pIP->DestAddress;
+	pseudo.Zero = 0;
+	pseudo.Protocol = IP_PROT_UDP;
+	pseudo.Length = pUDP->Length;
+	sum.Val = (WORD)~CalcIPChecksum((BYTE*)&pseudo, sizeof(pseudo));
+	sum.Val += (WORD)~CalcIPChecksum((BYTE*)pUDP, sizeof(UDP_HEADER) + wLen);
+	sum.Val = sum.w[0] + sum.w[1];
+	sum.Val = sum.w[0] + sum.w[1];
+	pUDP->Checksum = ~sum.w[0];
+	if(pUDP->Checksum == 0u)
+		pUDP->Checksum = 0xFFFF;
+
+	return sizeof(ETHER_HEADER) + sizeof(IP_HEADER) + sizeof(UDP_HEADER) + wLen;
+}
+
+// Sends a UDP datagram from the peer; the switch drops it if the stack's queue is full
+BOOL HostTestPeerSendUdp(BYTE port, WORD wSrcPort, WORD wDstPort, const BYTE *pData, WORD wLen)
+{
+	static BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+
+	return HostMACSend(port, rgbFrame, HostTestPeerUdpFrame(rgbFrame, wSrcPort, wDstPort, pData, wLen));
+}
+
+/*****************************************************************************
+  Function:
+	BOOL HostTestPeerReceiveUdp(BYTE port, WORD *pwSrcPort, WORD *pwDstPort,
+								BYTE *pData, WORD *pwLen)
+
+  Summary:
+	Takes the next UDP datagram off the peer's port
+
+  Description:
+	Frames that are not IPv4 UDP are thrown away.
+
+  Precondition:
+	None
+
+  Parameters:
+	port - the peer's port
+	pwSrcPort - receives this stack's UDP port
+	pwDstPort - receives the peer's UDP port
+	pData - receives the payload, NULL to skip it
+	pwLen - in, the room in pData; out, the payload length
+
+  Returns:
+  	TRUE if a datagram was taken, FALSE if the queue ran empty
+  ***************************************************************************/
+BOOL HostTestPeerReceiveUdp(BYTE port, WORD *pwSrcPort, WORD *pwDstPort, BYTE *pData, WORD *pwLen)
+{
+	static BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+	ETHER_HEADER *pEther = (ETHER_HEADER*)rgbFrame;
+	IP_HEADER *pIP = (IP_HEADER*)(pEther + 1);
+	UDP_HEADER *pUDP;
+	WORD wFrame, wLen;
+
+	while((wFrame = HostMACReceive(port, rgbFrame, sizeof(rgbFrame))) != 0u)
+	{
+		if(wFrame < sizeof(ETHER_HEADER) + sizeof(IP_HEADER) + sizeof(UDP_HEADER) ||
+			pEther->Type.Val != swaps(0x0800) || pIP->Protocol != IP_PROT_UDP)
+			continue;
+
+		pUDP = (UDP_HEADER*)((BYTE*)pIP + (pIP->VersionIHL & 0x0F) * 4);
+		wLen = swaps(pUDP->Length) - sizeof(UDP_HEADER);
+		*pwSrcPort = swaps(pUDP->SourcePort);
+		*pwDstPort = swaps(pUDP->DestinationPort);
+		if(pData)
+			memcpy(pData, pUDP + 1, wLen < *pwLen ? wLen : *pwLen);
+		*pwLen = wLen;
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*****************************************************************************
+  Function:
+	void HostTestPeerAnswerArp(BYTE port)
+
+  Summary:
+	Answers this stack's ARP requests for its own address
+
+  Description:
+	The switch floods a broadcast to every port but its sender's, so a
+	stack never hears itself ask, and a TcpClient connecting to its own
+	IP would wait on ARP for good.  The peer hears the request instead
+	and answers it on the stack's behalf; after that the frames go to the
+	stack's own MAC and the switch loops them back.  Every other frame
+	waiting on port is dropped.
+
+  Precondition:
+	HostTestPeerAttach() gave port
+
+  Parameters:
+	port - the peer's switch port
+
+  Returns:
+  	None
+  ***************************************************************************/
+void HostTestPeerAnswerArp(BYTE port)
+{
+	static const BYTE rgbMAC[6] = HOST_TEST_PEER_MAC;
+	static BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+	ETHER_HEADER *pEther = (ETHER_HEADER*)rgbFrame;
+	ARP_PACKET *pARP = (ARP_PACKET*)(pEther + 1);
+
+	while(HostMACReceive(port, rgbFrame, sizeof(rgbFrame)) >= sizeof(ETHER_HEADER) + sizeof(ARP_PACKET))
+	{
+		if(pEther->Type.Val != swaps(0x0806))
+			continue;
+
+		SwapARPPacket(pARP);
+		if(pARP->Operation != ARP_OPERATION_REQ || pARP->TargetIPAddr.Val != AppConfig.MyIPAddr.Val ||
+			pARP->SenderIPAddr.Val != AppConfig.MyIPAddr.Val)
+			continue;
+
+		// the Ethernet source is the peer's, or the switch would learn the stack's MAC on this port
+		pEther->DestMACAddr = AppConfig.MyMACAddr;
+		memcpy(&pEther->SourceMACAddr, rgbMAC, sizeof(rgbMAC));
+		pARP->Operation = ARP_OPERATION_RESP;
+		pARP->TargetMACAddr = AppConfig.MyMACAddr;
+		pARP->SenderMACAddr = AppConfig.MyMACAddr;
+		SwapARPPacket(pARP);
+		HostMACSend(port, rgbFrame, sizeof(ETHER_HEADER) + sizeof(ARP_PACKET));
+	}
+}
+
+/*****************************************************************************
+  Function:
+	WORD HostTestPeerTcpFrame(BYTE *pFrame, WORD wSrcPort, WORD wDstPort,
+								DWORD dwSeq, DWORD dwAck, BYTE bFlags,
+								const BYTE *pData, WORD wLen)
+
+  Summary:
+	Builds a TCP segment from the peer to this stack
+
+  Description:
+	The segment has a 20 byte header, no options and a 4 KB window.  The
+	IP and TCP checksums are filled in.
+
+  Precondition:
+	HostTestBegin() has been called
+
+  Parameters:
+	pFrame - room for the frame, HOST_MAC_FRAME_SIZE bytes
+	wSrcPort - the peer's TCP port
+	wDstPort - this stack's TCP port
+	dwSeq - the sequence number
+	dwAck - the acknowledgement number
+	bFlags - the header's flags byte, HOST_TEST_TCP_SYN and so on
+	pData - the payload
+	wLen - its length, up to 1460 bytes
+
+  Returns:
+  	The length of the frame
+  ***************************************************************************/
+WORD HostTestPeerTcpFrame(BYTE *pFrame, WORD wSrcPort, WORD wDstPort, DWORD dwSeq, DWORD dwAck,
+							BYTE bFlags, const BYTE *pData, WORD wLen)
+{
+	IP_HEADER *pIP = (IP_HEADER*)(pFrame + sizeof(ETHER_HEADER));
+	BYTE *pTCP = (BYTE*)(pIP + 1);
+	PSEUDO_HEADER pseudo;
+	DWORD_VAL sum;
+
+	// the UDP frame's Ethernet and IP headers, with TCP in place of UDP
+	HostTestPeerUdpFrame(pFrame, 0, 0, NULL, 0);
+	pIP->Protocol = IP_PROT_TCP;
+	pIP->TotalLength = swaps(sizeof(IP_HEADER) + 20u + wLen);
+	pIP->HeaderChecksum = 0;
+	pIP->HeaderChecksum = CalcIPChecksum((BYTE*)pIP, sizeof(*pIP));
+
+	memset(pTCP, 0, 20);
+	pTCP[0] = (BYTE)(wSrcPort >> 8);
+	pTCP[1] = (BYTE)wSrcPort;
+	pTCP[2] = (BYTE)(wDstPort >> 8);
+	pTCP[3] = (BYTE)wDstPort;
+	pTCP[4] = (BYTE)(dwSeq >> 24);
+	pTCP[5] = (BYTE)(dwSeq >> 16);
+	pTCP[6] = (BYTE)(dwSeq >> 8);
+	pTCP[7] = (BYTE)dwSeq;
+	pTCP[8] = (BYTE)(dwAck >> 24);
+	pTCP[9] = (BYTE)(dwAck >> 16);
+	pTCP[10] = (BYTE)(dwAck >> 8);
+	pTCP[11] = (BYTE)dwAck;
+	pTCP[12] = 0x50;					// 20 byte header
+	pTCP[13] = bFlags;
+	pTCP[14] = 0x10;					// window
+	memcpy(pTCP + 20, pData, wLen);
+
+	pseudo.SourceAddress = pIP->SourceAddress;
+	pseudo.DestAddress = pIP->DestAddress;
+	pseudo.Zero = 0;
+	pseudo.Protocol = IP_PROT_TCP;
+	pseudo.Length = swaps(20u + wLen);
+	sum.Val = (WORD)~CalcIPChecksum((BYTE*)&pseudo, sizeof(pseudo));
+	sum.Val += (WORD)~CalcIPChecksum(pTCP, 20u + wLen);
+	sum.Val = sum.w[0] + sum.w[1];
+	sum.Val = sum.w[0] + sum.w[1];
+	sum.w[0] = ~sum.w[0];
+	memcpy(pTCP + 16, &sum.w[0], sizeof(WORD));
+
+	return sizeof(ETHER_HEADER) + sizeof(IP_HEADER) + 20u + wLen;
+}
+
+#endif //#if !defined(HOST_ENC28J60) && !defined(HOST_TEST_USB)
+
+QWORD HostTestNowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (QWORD)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+BOOL HostTestCheck(BOOL fPassed, const char *szCond, const char *szFile, int iLine)
+{
+	if(!fPassed)
+	{
+		fprintf(stderr, "%s:%d: check failed: %s\n", szFile, iLine, szCond);
+		HostTestFailures++;
+	}
+
+	return fPassed;
+}
+
+// Prints the verdict, returns the exit code for main()
+int HostTestEnd(const char *szName)
+{
+	printf("%s: %s\n", szName, HostTestFailures ? "FAIL" : "PASS");
+	return HostTestFailures ? 1 : 0;
+}
@@ -0,0 +1,114 @@
+/************************************************************************/
+/*																		*/
+/*	hosttest.h	--  Helpers for the host build's tests and benchmarks   */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	The stack is brought up with DNETcK's own EthernetBegin() on a		*/
+/*	static address and kept running with EthernetPeriodicTasks(), the	*/
+/*	way a sketch does.  HostTestSelf() gives this stack as a NODE_INFO	*/
+/*	so TCPOpen() and UDPOpen() can connect it to itself: the virtual	*/
+/*	switch loops a frame addressed to its sender back to it, and no		*/
+/*	ARP is needed.														*/
+/*																		*/
+/*	The stack drops UDP from its own address, so UDP is driven by a		*/
+/*	peer instead: HostTestPeerAttach() puts host code on the switch as	*/
+/*	HOST_TEST_PEER_IP, which sends and receives raw UDP frames and		*/
+/*	builds raw TCP segments, for the stack's demultiplexer and SYN		*/
+/*	handling; there is no TCP behind them on the peer's side.			*/
+/*																		*/
+/*	A program built with HOST_ENC28J60 tests ENC28J60.c alone and gets	*/
+/*	only HostTestNowNs(), HostTestCheck() and HostTestEnd().			*/
+/*																		*/
+/*	So does a C++ program built with HOST_TEST_SKETCH.  It runs as a	*/
+/*	sketch does, through DNETcK.h and the other libraries' classes,		*/
+/*	and sees none of the stack's headers; that is what lets it include	*/
+/*	chipKITMDDFS.h, which needs MDD_DEFS, see the Makefile.  To let		*/
+/*	its TcpClients connect to its own TcpServer, it attaches a peer		*/
+/*	and has HostTestPeerAnswerArp() answer the stack's ARP requests		*/
+/*	for itself.															*/
+/*																		*/
+/*	A program built with HOST_TEST_USB, msdtest, has no stack either:	*/
+/*	it drives a USB function driver through hostusb.c and gets the		*/
+/*	same three.  So does msdhosttest, which runs the USB host's mass	*/
+/*	storage layers on hostmsd.c's devices.								*/
+/*																		*/
+/************************************************************************/
+
+#ifndef __HOSTTEST_H
+#define __HOSTTEST_H
+
+#if defined(HOST_TEST_SKETCH) || defined(HOST_TEST_USB)
+#undef BYTE						// Print.h's print format, not the type
+#include "GenericTypeDefs.h"
+#else
+#include "TCPIP Stack/TCPIP.h"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define HOST_TEST_IP			{192, 168, 1, 190}
+#define HOST_TEST_PEER_IP		{192, 168, 1, 191}		// for host code acting as a node on the switch
+#define HOST_TEST_PEER_MAC		{0x02, 0x00, 0x00, 0x00, 0x00, 0x01}
+
+// TCP header flags for HostTestPeerTcpFrame(); TCP.c keeps its own to itself
+#define HOST_TEST_TCP_FIN		(0x01u)
+#define HOST_TEST_TCP_SYN		(0x02u)
+#define HOST_TEST_TCP_RST		(0x04u)
+#define HOST_TEST_TCP_PSH		(0x08u)
+#define HOST_TEST_TCP_ACK		(0x10u)
+
+extern int HostTestFailures;
+
+// Counts and reports a failed check, the test goes on
+#define HOST_TEST_CHECK(cond)	HostTestCheck((cond) ? TRUE : FALSE, #cond, __FILE__, __LINE__)
+
+#if !defined(HOST_TEST_SKETCH) && !defined(HOST_TEST_USB)
+void HostTestBegin(void);
+void HostTestSelf(NODE_INFO *pNode);
+void HostTestTasks(void);
+BOOL HostTestRunUntil(BOOL (*pfnDone)(void *pContext), void *pContext, DWORD dwMs);
+void HostTestRunFor(DWORD dwMs);
+BOOL HostTestConnect(WORD wPort, TCP_SOCKET *phClient, TCP_SOCKET *phServer);
+void HostTestClose(TCP_SOCKET hClient, TCP_SOCKET hServer);
+void HostTestPeer(NODE_INFO *pNode);
+WORD HostTestPeerUdpFrame(BYTE *pFrame, WORD wSrcPort, WORD wDstPort, const BYTE *pData, WORD wLen);
+BOOL HostTestPeerSendUdp(BYTE port, WORD wSrcPort, WORD wDstPort, const BYTE *pData, WORD wLen);
+BOOL HostTestPeerReceiveUdp(BYTE port, WORD *pwSrcPort, WORD *pwDstPort, BYTE *pData, WORD *pwLen);
+WORD HostTestPeerTcpFrame(BYTE *pFrame, WORD wSrcPort, WORD wDstPort, DWORD dwSeq, DWORD dwAck,
+							BYTE bFlags, const BYTE *pData, WORD wLen);
+#endif
+
+BYTE HostTestPeerAttach(void);
+void HostTestPeerAnswerArp(BYTE port);
+QWORD HostTestNowNs(void);
+BOOL HostTestCheck(BOOL fPassed, const char *szCond, const char *szFile, int iLine);
+int HostTestEnd(const char *szName);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
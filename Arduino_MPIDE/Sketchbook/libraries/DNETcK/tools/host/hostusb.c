@@ -0,0 +1,245 @@
+/************************************************************************/
+/*																		*/
+/*	hostusb.c	--  A simulated USB device controller for host builds   */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	The PIC32's SIE as the function drivers see it, see include/USB/    */
+/*	usb.h.  Every endpoint has an even and an odd BDT entry for each    */
+/*	direction.  The firmware arms them in turn through pBDTEntryIn[]    */
+/*	and pBDTEntryOut[], the SIE takes them in turn for the tokens the   */
+/*	host sends and only moves on when a packet was ACKed; an entry it   */
+/*	does not own is a NAK, a stalled one a STALL.  Stalls and clearing  */
+/*	them follow usb_device.c: USBStallEndpoint() stalls both entries,   */
+/*	CLEAR_FEATURE(ENDPOINT_HALT) takes both back, cancelling whatever   */
+/*	was armed, and points the firmware at the entry the SIE uses next.  */
+/*																		*/
+/*	EP0 is only modelled as far as the class requests: HostUsbSetup()   */
+/*	hands CLEAR_FEATURE(ENDPOINT_HALT) to the stack's handling above    */
+/*	and anything else to the function driver's request handler, as      */
+/*	EVENT_EP0_REQUEST would.                                            */
+/*																		*/
+/************************************************************************/
+
+#include "USB/usb.h"
+
+#if defined(USB_USE_MSD)
+#include "USB/usb_function_msd.h"
+#endif
+
+USB_DEVICE_STATE USBDeviceState;
+BYTE USBSuspendControl;
+volatile CTRL_TRF_SETUP SetupPkt;
+volatile BDT_ENTRY *pBDTEntryIn[USB_MAX_EP_NUMBER+1];
+volatile BDT_ENTRY *pBDTEntryOut[USB_MAX_EP_NUMBER+1];
+
+// usb_device.c has the MSD buffers on the board
+#if defined(USB_USE_MSD)
+volatile USB_MSD_CBW msd_cbw;
+volatile USB_MSD_CSW msd_csw;
+volatile char msd_buffer[512];
+#endif
+
+static BDT_ENTRY _BDT[USB_MAX_EP_NUMBER+1][2][2];			// [ep][dir][even/odd]
+static BYTE _iSIE[USB_MAX_EP_NUMBER+1][2];					// entry the SIE uses next
+static HOST_USB_EP_STATS _Stats[USB_MAX_EP_NUMBER+1][2];
+
+static BYTE _rgbEP0[64];
+static WORD _cbEP0;
+static BOOL _fEP0Handled;
+
+static volatile BDT_ENTRY **FirmwareEntry(BYTE ep, BYTE dir)
+{
+	return dir == IN_TO_HOST ? &pBDTEntryIn[ep] : &pBDTEntryOut[ep];
+}
+
+void HostUsbBegin(void)
+{
+	BYTE ep;
+
+	memset(_BDT, 0, sizeof(_BDT));
+	memset(_iSIE, 0, sizeof(_iSIE));
+	memset(_Stats, 0, sizeof(_Stats));
+
+	for(ep = 0; ep <= USB_MAX_EP_NUMBER; ep++)
+	{
+		pBDTEntryOut[ep] = &_BDT[ep][OUT_FROM_HOST][0];
+		pBDTEntryIn[ep] = &_BDT[ep][IN_TO_HOST][0];
+	}
+
+	USBDeviceState = CONFIGURED_STATE;
+	USBSuspendControl = 0;
+}
+
+USB_HANDLE USBTransferOnePacket(BYTE ep, BYTE dir, BYTE *data, BYTE len)
+{
+	volatile BDT_ENTRY **pp = FirmwareEntry(ep, dir);
+	volatile BDT_ENTRY *handle = *pp;
+	BYTE cArmed = 0;
+	BYTE i;
+
+	if(handle == 0)
+		return 0;
+
+	handle->ADR = data;
+	handle->CNT = len;
+	handle->STAT.BSTALL = 0;
+	handle->STAT.UOWN = 1;
+
+	// on to the other entry of the pair
+	*pp = &_BDT[ep][dir][(handle - &_BDT[ep][dir][0]) ^ 1];
+
+	for(i = 0; i < 2; i++)
+	{
+		if(_BDT[ep][dir][i].STAT.UOWN && !_BDT[ep][dir][i].STAT.BSTALL)
+			cArmed++;
+	}
+	if(cArmed > _Stats[ep][dir].cMaxArmed)
+		_Stats[ep][dir].cMaxArmed = cArmed;
+
+	return (USB_HANDLE)handle;
+}
+
+void USBStallEndpoint(BYTE ep, BYTE dir)
+{
+	BYTE i;
+
+	for(i = 0; i < 2; i++)
+	{
+		_BDT[ep][dir][i].STAT.BSTALL = 1;
+		_BDT[ep][dir][i].STAT.UOWN = 1;
+	}
+}
+
+void USBEP0Transmit(BYTE options)
+{
+	_cbEP0 = 0;
+	_fEP0Handled = TRUE;
+}
+
+void USBEP0SendRAMPtr(BYTE *src, WORD size, BYTE options)
+{
+	_cbEP0 = size < sizeof(_rgbEP0) ? size : sizeof(_rgbEP0);
+	memcpy(_rgbEP0, src, _cbEP0);
+	_fEP0Handled = TRUE;
+}
+
+// An IN token; on an ACK pData gets the packet
+HOST_USB_HANDSHAKE HostUsbIn(BYTE ep, BYTE *pData, WORD *pwLen)
+{
+	BDT_ENTRY *p = &_BDT[ep][IN_TO_HOST][_iSIE[ep][IN_TO_HOST]];
+
+	if(!p->STAT.UOWN)
+	{
+		_Stats[ep][IN_TO_HOST].cNaks++;
+		return HOST_USB_NAK;
+	}
+	if(p->STAT.BSTALL)
+		return HOST_USB_STALL;
+
+	memcpy(pData, p->ADR, p->CNT);
+	*pwLen = p->CNT;
+	p->STAT.UOWN = 0;
+	_iSIE[ep][IN_TO_HOST] ^= 1;
+	_Stats[ep][IN_TO_HOST].cPackets++;
+
+	return HOST_USB_ACK;
+}
+
+// An OUT token and its data; what does not fit the armed buffer is lost
+HOST_USB_HANDSHAKE HostUsbOut(BYTE ep, const BYTE *pData, WORD wLen)
+{
+	BDT_ENTRY *p = &_BDT[ep][OUT_FROM_HOST][_iSIE[ep][OUT_FROM_HOST]];
+
+	if(!p->STAT.UOWN)
+	{
+		_Stats[ep][OUT_FROM_HOST].cNaks++;
+		return HOST_USB_NAK;
+	}
+	if(p->STAT.BSTALL)
+		return HOST_USB_STALL;
+
+	if(wLen < p->CNT)
+		p->CNT = wLen;
+	memcpy(p->ADR, pData, p->CNT);
+	p->STAT.UOWN = 0;
+	_iSIE[ep][OUT_FROM_HOST] ^= 1;
+	_Stats[ep][OUT_FROM_HOST].cPackets++;
+
+	return HOST_USB_ACK;
+}
+
+// usb_device.c's CLEAR_FEATURE(ENDPOINT_HALT)
+void HostUsbClearHalt(BYTE ep, BYTE dir)
+{
+	BYTE i;
+
+	for(i = 0; i < 2; i++)
+	{
+		_BDT[ep][dir][i].STAT.BSTALL = 0;
+		_BDT[ep][dir][i].STAT.UOWN = 0;
+	}
+
+	*FirmwareEntry(ep, dir) = &_BDT[ep][dir][_iSIE[ep][dir]];
+}
+
+// A control transfer; FALSE if nobody took the request and EP0 stalled
+BOOL HostUsbSetup(BYTE bmRequestType, BYTE bRequest, WORD wValue, WORD wIndex, WORD wLength,
+					void (*pfnClass)(void), BYTE *pData, WORD *pwLen)
+{
+	SetupPkt.bmRequestType = bmRequestType;
+	SetupPkt.bRequest = bRequest;
+	SetupPkt.wValue = wValue;
+	SetupPkt.wIndex = wIndex;
+	SetupPkt.wLength = wLength;
+
+	_cbEP0 = 0;
+	_fEP0Handled = FALSE;
+
+	if(bmRequestType == USB_SETUP_RECIPIENT_ENDPOINT && bRequest == USB_REQUEST_CLEAR_FEATURE &&
+		wValue == USB_FEATURE_ENDPOINT_HALT && (wIndex & 0x0F) != 0 && (wIndex & 0x0F) <= USB_MAX_EP_NUMBER)
+	{
+		HostUsbClearHalt(wIndex & 0x0F, (wIndex & 0x80) ? IN_TO_HOST : OUT_FROM_HOST);
+		_fEP0Handled = TRUE;
+	}
+	else if(pfnClass != NULL)
+	{
+		pfnClass();
+	}
+
+	if(pwLen != NULL)
+	{
+		if(_cbEP0 > wLength)
+			_cbEP0 = wLength;
+		memcpy(pData, _rgbEP0, _cbEP0);
+		*pwLen = _cbEP0;
+	}
+
+	return _fEP0Handled;
+}
+
+void HostUsbGetStats(BYTE ep, BYTE dir, HOST_USB_EP_STATS *pStats, BOOL bReset)
+{
+	*pStats = _Stats[ep][dir];
+	if(bReset)
+		memset(&_Stats[ep][dir], 0, sizeof(_Stats[ep][dir]));
+}
@@ -0,0 +1,388 @@
+/************************************************************************/
+/*																		*/
+/*	httpbench.cpp	--  HttpFileServer from a RAM disk, over loopback   */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	A sketch serving files with HttpFileServer, and its own clients.    */
+/*	MDDFS formats hostdisk.cpp's RAM disk and writes an index page, a   */
+/*	page in a directory and DATA.BIN; TcpClients on the same stack      */
+/*	then check GET, HEAD, ranges, 404, pipelining and Connection:       */
+/*	close, comparing every body byte with what was written.             */
+/*																		*/
+/*	The timed part fetches DATA.BIN over and over with keep-alive,      */
+/*	first with one client and then with HTTP_MAX_CLIENTS at once.  It   */
+/*	gives the rate, the time spent in HttpFileServer::periodicTasks()   */
+/*	per byte served, which is the file system and the copy into the     */
+/*	TX FIFO, and the sectors read per sector served.  One client must   */
+/*	read each sector once: fborrow() hands TCPPutArray() the sector     */
+/*	buffer and nothing is read twice.  Several clients share FSIO's     */
+/*	one data buffer, so a client whose TX FIFO filled part way through  */
+/*	a sector may find another's sector there and read its own again.   */
+/*																		*/
+/*		httpbench [-n fetches] [-k kbytes]								*/
+/*																		*/
+/************************************************************************/
+
+#include <stdio.h>
+
+#include "chipKITUSBHost.h"
+#include "chipKITUSBMSDHost.h"
+#include "chipKITMDDFS.h"
+#include "DNETcK.h"
+#include "HttpFileServer.h"
+#include "hosttest.h"
+
+#define HTTP_BENCH_PORT			(8080u)
+#define HTTP_BENCH_SECTORS		(16384ul)		// 8 MB, FAT16
+#define HTTP_BENCH_TIMEOUT_MS	(5000ul)
+
+static const char _szIndex[] = "<html><body>httpbench</body></html>\r\n";
+static const char _szPage[] = "A page in a directory.\r\n";
+
+static HttpFileServer _httpServer;
+static IPv4 _ip = {{192, 168, 1, 190}};
+static byte *_pbData;
+static unsigned long _cbData = 1024ul * 1024ul;
+static unsigned long long _qwServerNs;
+static BYTE _peerPort;
+
+typedef enum
+{
+	cstIdle = 0,
+	cstSend,
+	cstHeader,
+	cstBody,
+	cstDone,
+	cstFailed
+} CSTATE;
+
+typedef struct
+{
+	TcpClient		tcpClient;
+	CSTATE			state;
+	const char *	szRequest;		// what is left to send
+	size_t			cbRequest;
+	bool			fHead;
+	const byte *	pbExpect;		// the body that should come back, NULL not to look
+	int				status;
+	unsigned long	cbContent;		// Content-Length
+	unsigned long	cbBody;			// body bytes read so far
+	bool			fBodyMatches;
+	char			szHeader[512];
+} CLIENT;
+
+static CLIENT _rgClient[HTTP_MAX_CLIENTS];
+
+// The sketch's loop(), with the server's share timed
+static void Loop(void)
+{
+	unsigned long long qwStartNs;
+
+	DNETcK::periodicTasks();
+	HostTestPeerAnswerArp(_peerPort);
+	qwStartNs = HostTestNowNs();
+	_httpServer.periodicTasks();
+	_qwServerNs += HostTestNowNs() - qwStartNs;
+}
+
+static bool WriteFile(const char *szName, const byte *pbData, size_t cbData)
+{
+	FSFILE *pFile = MDDFS.fopen(szName, "w");
+	size_t cbWritten;
+
+	if(pFile == NULL)
+		return false;
+	cbWritten = MDDFS.fwrite(pbData, 1, cbData, pFile);
+	return MDDFS.fclose(pFile) == 0 && cbWritten == cbData;
+}
+
+static bool MakeVolume(void)
+{
+	unsigned long i;
+
+	if(!HostDiskBegin(HTTP_BENCH_SECTORS) ||
+		MDDFS.CreateMBR(1, HTTP_BENCH_SECTORS) != 0 ||
+		MDDFS.format(1, 0x20120101l, (char *)"HTTPBENCH") != 0 ||
+		!MDDFS.Init())
+		return false;
+
+	// not a multiple of the sector size, so the last sector is partly used
+	_pbData = (byte *)malloc(_cbData);
+	for(i = 0; i < _cbData; i++)
+		_pbData[i] = (byte)(i * 31u + (i >> 9));
+
+	return WriteFile("INDEX.HTM", (const byte *)_szIndex, strlen(_szIndex)) &&
+		WriteFile("DATA.BIN", _pbData, _cbData) &&
+		MDDFS.mkdir((char *)"SUB") == 0 &&
+		MDDFS.chdir((char *)"SUB") == 0 &&
+		WriteFile("PAGE.TXT", (const byte *)_szPage, strlen(_szPage)) &&
+		MDDFS.chdir((char *)"\\") == 0;
+}
+
+static bool Connect(CLIENT *pClient)
+{
+	unsigned long tStart = millis();
+
+	pClient->state = cstIdle;
+	if(!pClient->tcpClient.connect(_ip, HTTP_BENCH_PORT))
+		return false;
+	while(!pClient->tcpClient.isConnected(DNETcK::msImmediate))
+	{
+		if(millis() - tStart > HTTP_BENCH_TIMEOUT_MS)
+			return false;
+		Loop();
+	}
+	return true;
+}
+
+// Sets pClient up to send szRequest, NULL if it went out with an earlier one, and read one response
+static void Request(CLIENT *pClient, const char *szRequest, bool fHead, const byte *pbExpect)
+{
+	pClient->szRequest = szRequest;
+	pClient->cbRequest = szRequest ? strlen(szRequest) : 0;
+	pClient->fHead = fHead;
+	pClient->pbExpect = pbExpect;
+	pClient->status = 0;
+	pClient->cbContent = 0;
+	pClient->cbBody = 0;
+	pClient->fBodyMatches = true;
+	pClient->state = cstSend;
+}
+
+static void Step(CLIENT *pClient)
+{
+	byte rgbRead[2048];
+	char *pch;
+	size_t cb;
+
+	switch(pClient->state)
+	{
+		case cstSend:
+			cb = pClient->tcpClient.writeStream((const byte *)pClient->szRequest, pClient->cbRequest, DNETcK::msImmediate);
+			pClient->szRequest += cb;
+			pClient->cbRequest -= cb;
+			if(pClient->cbRequest == 0)
+				pClient->state = cstHeader;
+			break;
+
+		case cstHeader:
+			cb = pClient->tcpClient.peekStream((byte *)pClient->szHeader, sizeof(pClient->szHeader) - 1);
+			pClient->szHeader[cb] = '\0';
+			if((pch = strstr(pClient->szHeader, "\r\n\r\n")) == NULL)
+			{
+				if(cb == sizeof(pClient->szHeader) - 1)
+					pClient->state = cstFailed;
+				break;
+			}
+			pch[2] = '\0';
+			pClient->tcpClient.consume(pch + 4 - pClient->szHeader);
+
+			if(strncmp(pClient->szHeader, "HTTP/1.1 ", 9) == 0)
+				pClient->status = atoi(pClient->szHeader + 9);
+			if((pch = strstr(pClient->szHeader, "Content-Length: ")) != NULL)
+				pClient->cbContent = strtoul(pch + 16, NULL, 10);
+			pClient->state = pClient->fHead || pClient->cbContent == 0 ? cstDone : cstBody;
+			break;
+
+		case cstBody:
+			cb = pClient->cbContent - pClient->cbBody;
+			cb = pClient->tcpClient.readStream(rgbRead, cb < sizeof(rgbRead) ? cb : sizeof(rgbRead));
+			if(pClient->pbExpect != NULL && memcmp(rgbRead, pClient->pbExpect + pClient->cbBody, cb) != 0)
+				pClient->fBodyMatches = false;
+			pClient->cbBody += cb;
+			if(pClient->cbBody == pClient->cbContent)
+				pClient->state = cstDone;
+			break;
+
+		default:
+			break;
+	}
+}
+
+static bool Wait(CLIENT *pClient)
+{
+	unsigned long tStart = millis();
+
+	while(pClient->state != cstDone && pClient->state != cstFailed && millis() - tStart < HTTP_BENCH_TIMEOUT_MS)
+	{
+		Loop();
+		Step(pClient);
+	}
+	return pClient->state == cstDone;
+}
+
+static bool Fetch(CLIENT *pClient, const char *szRequest, int status, const byte *pbExpect, unsigned long cbExpect)
+{
+	Request(pClient, szRequest, strncmp(szRequest, "HEAD", 4) == 0, pbExpect);
+	return HOST_TEST_CHECK(Wait(pClient)) &&
+		HOST_TEST_CHECK(pClient->status == status) &&
+		HOST_TEST_CHECK(pClient->cbContent == cbExpect) &&
+		HOST_TEST_CHECK(pClient->fBodyMatches);
+}
+
+static void Checks(void)
+{
+	static const char szPipelined[] =
+		"GET /INDEX.HTM HTTP/1.1\r\nHost: x\r\n\r\n"
+		"GET /SUB/PAGE.TXT HTTP/1.1\r\nHost: x\r\n\r\n";
+	CLIENT *pClient = &_rgClient[0];
+	char szRequest[128];
+	unsigned long tStart;
+
+	if(!HOST_TEST_CHECK(Connect(pClient)))
+		return;
+
+	Fetch(pClient, "GET / HTTP/1.1\r\nHost: x\r\n\r\n", 200, (const byte *)_szIndex, strlen(_szIndex));
+	HOST_TEST_CHECK(strstr(pClient->szHeader, "Content-Type: text/html\r\n") != NULL);
+	Fetch(pClient, "GET /SUB/PAGE.TXT HTTP/1.1\r\n\r\n", 200, (const byte *)_szPage, strlen(_szPage));
+	HOST_TEST_CHECK(strstr(pClient->szHeader, "Content-Type: text/plain\r\n") != NULL);
+
+	// no body, or the next response would not parse
+	Fetch(pClient, "HEAD /DATA.BIN HTTP/1.1\r\n\r\n", 200, NULL, _cbData);
+	Fetch(pClient, "GET /NOPE.TXT HTTP/1.1\r\n\r\n", 404, NULL, strlen("Not Found\r\n"));
+
+	Fetch(pClient, "GET /DATA.BIN HTTP/1.1\r\nRange: bytes=1000-1999\r\n\r\n", 206, _pbData + 1000, 1000);
+	HOST_TEST_CHECK(strstr(pClient->szHeader, "Content-Range: bytes 1000-1999/") != NULL);
+	Fetch(pClient, "GET /DATA.BIN HTTP/1.1\r\nRange: bytes=-100\r\n\r\n", 206, _pbData + _cbData - 100, 100);
+	sprintf(szRequest, "GET /DATA.BIN HTTP/1.1\r\nRange: bytes=%lu-\r\n\r\n", _cbData);
+	Fetch(pClient, szRequest, 416, NULL, 0);
+	sprintf(szRequest, "GET /DATA.BIN HTTP/1.1\r\nRange: bytes=%lu-\r\n\r\n", _cbData - 513);
+	Fetch(pClient, szRequest, 206, _pbData + _cbData - 513, 513);
+
+	// two requests in one segment, answered in order
+	Fetch(pClient, szPipelined, 200, (const byte *)_szIndex, strlen(_szIndex));
+	Request(pClient, NULL, false, (const byte *)_szPage);
+	HOST_TEST_CHECK(Wait(pClient) && pClient->status == 200 && pClient->fBodyMatches);
+
+	// the whole file, then the server hangs up
+	Fetch(pClient, "GET /DATA.BIN HTTP/1.1\r\nConnection: close\r\n\r\n", 200, _pbData, _cbData);
+	HOST_TEST_CHECK(strstr(pClient->szHeader, "Connection: close\r\n") != NULL);
+	for(tStart = millis(); pClient->tcpClient.isConnected(DNETcK::msImmediate) && millis() - tStart < HTTP_BENCH_TIMEOUT_MS; )
+		Loop();
+	HOST_TEST_CHECK(!pClient->tcpClient.isConnected(DNETcK::msImmediate));
+	pClient->tcpClient.close();
+
+	for(tStart = millis(); _httpServer.activeClients() != 0 && millis() - tStart < HTTP_BENCH_TIMEOUT_MS; )
+		Loop();
+	HOST_TEST_CHECK(_httpServer.activeClients() == 0);
+}
+
+// cClients fetch DATA.BIN cFetches times each, all at once
+static void Phase(int cClients, unsigned long cFetches)
+{
+	static const char szRequest[] = "GET /DATA.BIN HTTP/1.1\r\nHost: x\r\n\r\n";
+	unsigned long rgcLeft[HTTP_MAX_CLIENTS];
+	unsigned long long qwStartNs, qwNs, qwBytes = 0;
+	HOST_DISK_STATS Stats;
+	int i, cBusy, cMismatched = 0;
+
+	for(i = 0; i < cClients; i++)
+	{
+		if(!HOST_TEST_CHECK(Connect(&_rgClient[i])))
+			return;
+		Request(&_rgClient[i], szRequest, false, _pbData);
+		rgcLeft[i] = cFetches;
+	}
+
+	HostDiskGetStats(&Stats, TRUE);
+	_qwServerNs = 0;
+	qwStartNs = HostTestNowNs();
+	do
+	{
+		Loop();
+		for(i = 0, cBusy = 0; i < cClients; i++)
+		{
+			CLIENT *pClient = &_rgClient[i];
+
+			Step(pClient);
+			if(pClient->state == cstDone)
+			{
+				qwBytes += pClient->cbBody;
+				if(pClient->status != 200 || pClient->cbBody != _cbData || !pClient->fBodyMatches)
+					cMismatched++;
+				if(--rgcLeft[i] != 0)
+					Request(pClient, szRequest, false, _pbData);
+			}
+			if(pClient->state != cstDone && pClient->state != cstFailed)
+				cBusy++;
+		}
+	} while(cBusy != 0 && HostTestNowNs() - qwStartNs < 60000000000ull);
+	qwNs = HostTestNowNs() - qwStartNs;
+	HostDiskGetStats(&Stats, FALSE);
+
+	printf("  %d client%s %6.1f MB/s, server %5.2f ns/byte, %.3f sector reads per sector served\n",
+		cClients, cClients == 1 ? ", " : "s,", qwBytes * 1e3 / qwNs, (double)_qwServerNs / qwBytes,
+		Stats.cReads * (double)MEDIA_SECTOR_SIZE / qwBytes);
+
+	HOST_TEST_CHECK(cBusy == 0);
+	HOST_TEST_CHECK(cMismatched == 0);
+	HOST_TEST_CHECK(qwBytes == (unsigned long long)cClients * cFetches * _cbData);
+	if(cClients == 1)
+		HOST_TEST_CHECK(Stats.cReads * (unsigned long long)MEDIA_SECTOR_SIZE <= qwBytes + qwBytes / 50u);
+
+	for(i = 0; i < cClients; i++)
+		_rgClient[i].tcpClient.close();
+	for(qwStartNs = HostTestNowNs(); _httpServer.activeClients() != 0 && HostTestNowNs() - qwStartNs < 1000000000ull; )
+		Loop();
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned long cFetches = 8;
+	unsigned long tStart;
+	int i;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			cFetches = strtoul(argv[++i], NULL, 0);
+		else if(strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+			_cbData = strtoul(argv[++i], NULL, 0) * 1024ul + 123u;
+		else
+		{
+			fprintf(stderr, "usage: %s [-n fetches] [-k kbytes]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(_cbData == 1024ul * 1024ul)
+		_cbData += 123u;
+	printf("httpbench: %lu bytes, %lu fetches per client, HTTP_MAX_CLIENTS %d\n", _cbData, cFetches, HTTP_MAX_CLIENTS);
+
+	if(!HOST_TEST_CHECK(MakeVolume()))
+		return HostTestEnd("httpbench");
+
+	DNETcK::begin(_ip);
+	_peerPort = HostTestPeerAttach();
+	for(tStart = millis(); !DNETcK::isInitialized(DNETcK::msImmediate) && millis() - tStart < HTTP_BENCH_TIMEOUT_MS; )
+		DNETcK::periodicTasks();
+	if(!HOST_TEST_CHECK(_httpServer.begin(HTTP_BENCH_PORT)))
+		return HostTestEnd("httpbench");
+
+	Checks();
+	Phase(1, cFetches);
+	Phase(HTTP_MAX_CLIENTS, cFetches);
+
+	_httpServer.end();
+	return HostTestEnd("httpbench");
+}
@@ -0,0 +1,65 @@
+/************************************************************************/
+/*																		*/
+/*	FSconfig.h	--  MDD File System configuration for host builds       */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	On the board every sketch brings its own FSconfig.h; this is the    */
+/*	one the C++ programs of tools/host/Makefile share.  It has what     */
+/*	HttpFileServer's example enables, on the RAM disk of                */
+/*	chipKITUSBMSDHost.h, with the timestamps counted up rather than     */
+/*	taken from a clock.                                                 */
+/*																		*/
+/************************************************************************/
+
+#ifndef _FS_DEF_
+#define _FS_DEF_
+
+// Files open at once, one per HttpFileServer client
+#ifndef FS_MAX_FILES_OPEN
+	#define FS_MAX_FILES_OPEN		4
+#endif
+
+#define MEDIA_SECTOR_SIZE			512
+
+#ifndef FS_MAX_VOLUMES
+	#define FS_MAX_VOLUMES			1
+#endif
+
+#define ALLOW_FILESEARCH
+#define ALLOW_WRITES
+#define ALLOW_FORMATS
+#define ALLOW_DIRS
+#define SUPPORT_FAT32
+#define ALLOW_GET_DISK_PROPERTIES
+
+#define INCREMENTTIMESTAMP
+
+#define MDD_MediaInitialize			HostDiskMediaInitialize
+#define MDD_MediaDetect				HostDiskMediaDetect
+#define MDD_SectorRead				HostDiskSectorRead
+#define MDD_SectorWrite				HostDiskSectorWrite
+#define MDD_InitIO()
+#define MDD_ShutdownMedia			HostDiskShutdownMedia
+#define MDD_WriteProtectState		HostDiskWriteProtectState
+
+#endif
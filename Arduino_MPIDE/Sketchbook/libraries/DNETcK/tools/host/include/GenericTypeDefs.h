@@ -0,0 +1,197 @@
+/************************************************************************/
+/*																		*/
+/*	GenericTypeDefs.h	--  Microchip generic types for host builds     */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	On the board GenericTypeDefs.h comes with the PIC32 compiler.  This */
+/*	is the same set of types for a HOST_MAC build with gcc, see         */
+/*	tools/host/Makefile.  The sizes are those of PIC32, which are not   */
+/*	gcc's on x86_64: DWORD, LONG, UINT32 and INT32 are 32 bits here     */
+/*	even though long is 64.  A pointer does not fit in a DWORD on       */
+/*	x86_64, keep pointers in a PTR_BASE.                                */
+/*																		*/
+/************************************************************************/
+
+#ifndef __GENERIC_TYPE_DEFS_H_
+#define __GENERIC_TYPE_DEFS_H_
+
+#include <stdint.h>
+
+typedef enum _BOOL { FALSE = 0, TRUE } BOOL;	// Undefined size
+typedef enum _BIT { CLEAR = 0, SET } BIT;
+
+#define PUBLIC									// Function attributes
+#define PROTECTED
+#define PRIVATE   static
+
+typedef signed int			INT;
+typedef int8_t				INT8;
+typedef int16_t				INT16;
+typedef int32_t				INT32;
+typedef int64_t				INT64;
+
+typedef unsigned int		UINT;
+typedef uint8_t				UINT8;
+typedef uint16_t			UINT16;
+typedef uint32_t			UINT32;
+typedef uint64_t			UINT64;
+
+typedef void				VOID;
+typedef char				CHAR8;
+typedef unsigned char		UCHAR8;
+
+typedef uint8_t				BYTE;				// 8-bit unsigned
+typedef uint16_t			WORD;				// 16-bit unsigned
+typedef uint32_t			DWORD;				// 32-bit unsigned
+typedef uint64_t			QWORD;				// 64-bit unsigned
+typedef int8_t				CHAR;				// 8-bit signed
+typedef int16_t				SHORT;				// 16-bit signed
+typedef int32_t				LONG;				// 32-bit signed
+typedef int64_t				LONGLONG;			// 64-bit signed
+
+typedef union
+{
+	BYTE Val;
+	struct __attribute__((packed))
+	{
+		unsigned char b0:1;
+		unsigned char b1:1;
+		unsigned char b2:1;
+		unsigned char b3:1;
+		unsigned char b4:1;
+		unsigned char b5:1;
+		unsigned char b6:1;
+		unsigned char b7:1;
+	} bits;
+} BYTE_VAL, BYTE_BITS, UINT8_VAL, UINT8_BITS;
+
+typedef union
+{
+	WORD Val;
+	BYTE v[2];
+	struct __attribute__((packed))
+	{
+		BYTE LB;
+		BYTE HB;
+	} byte;
+	struct __attribute__((packed))
+	{
+		unsigned short b0:1;
+		unsigned short b1:1;
+		unsigned short b2:1;
+		unsigned short b3:1;
+		unsigned short b4:1;
+		unsigned short b5:1;
+		unsigned short b6:1;
+		unsigned short b7:1;
+		unsigned short b8:1;
+		unsigned short b9:1;
+		unsigned short b10:1;
+		unsigned short b11:1;
+		unsigned short b12:1;
+		unsigned short b13:1;
+		unsigned short b14:1;
+		unsigned short b15:1;
+	} bits;
+} WORD_VAL, WORD_BITS, UINT16_VAL, UINT16_BITS;
+
+typedef union
+{
+	DWORD Val;
+	WORD w[2];
+	BYTE v[4];
+	struct __attribute__((packed))
+	{
+		WORD LW;
+		WORD HW;
+	} word;
+	struct __attribute__((packed))
+	{
+		BYTE LB;
+		BYTE HB;
+		BYTE UB;
+		BYTE MB;
+	} byte;
+	struct __attribute__((packed))
+	{
+		WORD_VAL low;
+		WORD_VAL high;
+	} wordUnion;
+	struct __attribute__((packed))
+	{
+		unsigned int b0:1;
+		unsigned int b1:1;
+		unsigned int b2:1;
+		unsigned int b3:1;
+		unsigned int b4:1;
+		unsigned int b5:1;
+		unsigned int b6:1;
+		unsigned int b7:1;
+		unsigned int b8:1;
+		unsigned int b9:1;
+		unsigned int b10:1;
+		unsigned int b11:1;
+		unsigned int b12:1;
+		unsigned int b13:1;
+		unsigned int b14:1;
+		unsigned int b15:1;
+		unsigned int b16:1;
+		unsigned int b17:1;
+		unsigned int b18:1;
+		unsigned int b19:1;
+		unsigned int b20:1;
+		unsigned int b21:1;
+		unsigned int b22:1;
+		unsigned int b23:1;
+		unsigned int b24:1;
+		unsigned int b25:1;
+		unsigned int b26:1;
+		unsigned int b27:1;
+		unsigned int b28:1;
+		unsigned int b29:1;
+		unsigned int b30:1;
+		unsigned int b31:1;
+	} bits;
+} DWORD_VAL, UINT32_VAL;
+
+typedef union
+{
+	QWORD Val;
+	DWORD d[2];
+	WORD w[4];
+	BYTE v[8];
+	struct __attribute__((packed))
+	{
+		DWORD LD;
+		DWORD HD;
+	} dword;
+	struct __attribute__((packed))
+	{
+		WORD LW;
+		WORD HW;
+		WORD UW;
+		WORD MW;
+	} word;
+} QWORD_VAL, UINT64_VAL;
+
+#endif //__GENERIC_TYPE_DEFS_H_
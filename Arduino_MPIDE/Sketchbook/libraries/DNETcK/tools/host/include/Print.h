@@ -0,0 +1,70 @@
+/************************************************************************/
+/*																		*/
+/*	Print.h		--  The Arduino Print class for host builds             */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	TcpClient is a Print, so a host build needs one; see WProgram.h.    */
+/*	The write() methods are the core's, print() and println() only      */
+/*	take strings.  BYTE is 0 as it is in the core, which is why the     */
+/*	libraries #undef it around the MAL includes.                        */
+/*																		*/
+/************************************************************************/
+
+#ifndef Print_h
+#define Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define BYTE 0
+
+class Print
+{
+public:
+	virtual void write(uint8_t bData) = 0;
+
+	virtual void write(const char *str)
+	{
+		write((const uint8_t *)str, strlen(str));
+	}
+
+	virtual void write(const uint8_t *buffer, size_t size)
+	{
+		while(size--)
+			write(*buffer++);
+	}
+
+	void print(const char *str)
+	{
+		write(str);
+	}
+
+	void println(const char *str)
+	{
+		write(str);
+		write("\r\n");
+	}
+};
+
+#endif
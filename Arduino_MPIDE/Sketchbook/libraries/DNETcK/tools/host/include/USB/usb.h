@@ -0,0 +1,162 @@
+/************************************************************************/
+/*																		*/
+/*	usb.h	--  The USB device stack's interface for host builds        */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	chipKITUSBDevice's function drivers include this first.  On the     */
+/*	board it brings in usb_device.c's interface and the PIC32 HAL; on   */
+/*	a host build the endpoints are hostusb.c's simulated SIE instead,   */
+/*	behind the same names: the BDT entries, USBTransferOnePacket(),     */
+/*	USBStallEndpoint() and the handle macros, with usb_common.h and     */
+/*	usb_ch9.h taken from the library as they are.                       */
+/*																		*/
+/*	The host side of the bus is hostusb.c's HostUsb*() functions, see   */
+/*	msdtest.c.                                                          */
+/*																		*/
+/*	usb_host_msd_scsi.c includes it as well.  When the sketch's         */
+/*	usb_config.h says USB_SUPPORT_HOST there is no SIE: the devices     */
+/*	are hostmsd.c's, behind usb_host_msd.c's interface, and its         */
+/*	HostMsd*() functions plug them in and out, see msdhosttest.cpp.     */
+/*	Compiler.h is left to device builds, since the chipKITMDDFS files   */
+/*	that include this are built as for a PIC32, see the Makefile.       */
+/*																		*/
+/************************************************************************/
+
+#ifndef _HOST_USB_H
+#define _HOST_USB_H
+
+#include <string.h>
+#include "GenericTypeDefs.h"
+
+#include "usb_config.h"
+
+#if defined(USB_SUPPORT_DEVICE)
+#include "Compiler.h"
+#endif
+
+#include "USB/usb_common.h"
+#include "USB/usb_ch9.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if defined(USB_SUPPORT_DEVICE)
+
+// A buffer descriptor with the bits the function drivers look at
+typedef struct
+{
+	struct
+	{
+		BYTE	UOWN;			// armed, the SIE owns the entry
+		BYTE	BSTALL;			// the SIE answers with a STALL
+	} STAT;
+	WORD		CNT;			// bytes armed for, bytes moved once UOWN clears
+	BYTE		*ADR;
+} BDT_ENTRY;
+
+typedef void* USB_HANDLE;
+
+typedef enum
+{
+	DETACHED_STATE		= 0x00,
+	ATTACHED_STATE		= 0x01,
+	POWERED_STATE		= 0x02,
+	DEFAULT_STATE		= 0x04,
+	ADR_PENDING_STATE	= 0x08,
+	ADDRESS_STATE		= 0x10,
+	CONFIGURED_STATE	= 0x20
+} USB_DEVICE_STATE;
+
+#define USB_EP0_NO_DATA			0x00
+#define USB_EP0_INCLUDE_ZERO	0x40
+
+#define USBHandleBusy(handle)		(handle==0?0:((volatile BDT_ENTRY*)handle)->STAT.UOWN)
+#define USBHandleGetLength(handle)	(((volatile BDT_ENTRY*)handle)->CNT)
+#define USBTxOnePacket(ep,data,len)	USBTransferOnePacket(ep,IN_TO_HOST,data,len)
+#define USBRxOnePacket(ep,data,len)	USBTransferOnePacket(ep,OUT_FROM_HOST,data,len)
+
+extern USB_DEVICE_STATE USBDeviceState;
+extern BYTE USBSuspendControl;
+extern volatile BDT_ENTRY *pBDTEntryIn[USB_MAX_EP_NUMBER+1];
+extern volatile BDT_ENTRY *pBDTEntryOut[USB_MAX_EP_NUMBER+1];
+
+USB_HANDLE USBTransferOnePacket(BYTE ep, BYTE dir, BYTE *data, BYTE len);
+void USBStallEndpoint(BYTE ep, BYTE dir);
+void USBEP0Transmit(BYTE options);
+void USBEP0SendRAMPtr(BYTE *src, WORD size, BYTE options);
+
+// The host's side of the bus
+typedef enum
+{
+	HOST_USB_ACK = 0,
+	HOST_USB_NAK,
+	HOST_USB_STALL
+} HOST_USB_HANDSHAKE;
+
+typedef struct
+{
+	DWORD	cPackets;			// packets moved
+	DWORD	cNaks;				// tokens the device was not ready for
+	BYTE	cMaxArmed;			// most entries armed at once
+} HOST_USB_EP_STATS;
+
+void HostUsbBegin(void);
+HOST_USB_HANDSHAKE HostUsbIn(BYTE ep, BYTE *pData, WORD *pwLen);
+HOST_USB_HANDSHAKE HostUsbOut(BYTE ep, const BYTE *pData, WORD wLen);
+void HostUsbClearHalt(BYTE ep, BYTE dir);
+BOOL HostUsbSetup(BYTE bmRequestType, BYTE bRequest, WORD wValue, WORD wIndex, WORD wLength,
+					void (*pfnClass)(void), BYTE *pData, WORD *pwLen);
+void HostUsbGetStats(BYTE ep, BYTE dir, HOST_USB_EP_STATS *pStats, BOOL bReset);
+
+#endif	// USB_SUPPORT_DEVICE
+
+#if defined(USB_SUPPORT_HOST)
+
+void USBHostTasks(void);
+
+// The devices plugged into the simulated bus
+typedef struct
+{
+	DWORD	cCommands;			// CBWs, whatever the command
+	DWORD	cReads;				// READ(10)s
+	DWORD	cWrites;			// WRITE(10)s
+	DWORD	cSectorsRead;
+	DWORD	cSectorsWritten;
+	WORD	cMaxSectors;		// most sectors one READ(10) or WRITE(10) moved
+	BYTE	bLastLUN;			// LUN of the last CBW
+} HOST_MSD_STATS;
+
+BOOL HostMsdAttach(BYTE address, BYTE maxLUN);
+void HostMsdDetach(BYTE address);
+BYTE *HostMsdInsert(BYTE address, BYTE LUN, DWORD dwSectors, WORD wSectorSize);
+void HostMsdGetStats(BYTE address, HOST_MSD_STATS *pStats, BOOL bReset);
+
+#endif	// USB_SUPPORT_HOST
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/************************************************************************/
+/*																		*/
+/*	WProgram.h	--  The Arduino core functions for host builds          */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	On the board WProgram.h comes with the MPIDE core.  The C++ side    */
+/*	of DNETcK and the libraries built on it only take millis() and the  */
+/*	Arduino types from it, so that is all there is here; the C++        */
+/*	programs of tools/host/Makefile run as sketches with it.            */
+/*																		*/
+/************************************************************************/
+
+#ifndef WProgram_h
+#define WProgram_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef uint8_t				byte;
+typedef bool				boolean;
+
+static inline unsigned long micros(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long)ts.tv_sec * 1000000ul + ts.tv_nsec / 1000;
+}
+
+static inline unsigned long millis(void)
+{
+	return micros() / 1000ul;
+}
+
+#endif
@@ -0,0 +1,53 @@
+/************************************************************************/
+/*																		*/
+/*	chipKITUSBHost.h	--  No USB host controller on a host build      */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	chipKITMDDFS and HttpFileServer include this first, as they do      */
+/*	on the board.  There is no USB here: the volume is the RAM disk     */
+/*	of chipKITUSBMSDHost.h, so only the types are left.                 */
+/*																		*/
+/*	A program built with HOST_TEST_USB has a usb_config.h of its own,   */
+/*	msdhosttest's is for a USB host, and gets USB/usb.h from here as    */
+/*	a sketch does on the board.                                         */
+/*																		*/
+/************************************************************************/
+
+#ifndef _CHIPKITUSBHOSTCLASS_H
+#define _CHIPKITUSBHOSTCLASS_H
+
+#ifdef __cplusplus
+	#include "WProgram.h"
+	#undef BYTE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "GenericTypeDefs.h"
+
+#if defined(HOST_TEST_USB)
+	#include "USB/usb.h"
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+/************************************************************************/
+/*																		*/
+/*	chipKITUSBMSDHost.h	--  A RAM disk for MDDFS on host builds         */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	On the board this is the USB mass storage class driver FSIO.cpp     */
+/*	reads sectors through.  On a host build FSconfig.h points the       */
+/*	MDD_* functions at hostdisk.cpp instead, a volume of 512 byte       */
+/*	sectors in RAM, which counts the sectors it moves so a program can  */
+/*	see what a file operation cost the media.                           */
+/*																		*/
+/*	HostDiskBegin() makes a blank disk; MDDFS.CreateMBR() and           */
+/*	MDDFS.format(1, ...) then put a FAT on it.                          */
+/*																		*/
+/************************************************************************/
+
+#ifndef _CHIPKITUSBMSDHOSTCLASS_H
+#define _CHIPKITUSBMSDHOSTCLASS_H
+
+#ifdef __cplusplus
+	#undef BYTE
+#endif
+
+#include "GenericTypeDefs.h"
+#include "FSconfig.h"
+#include "MDD File System/FSDefs.h"
+
+typedef struct
+{
+	DWORD	cReads;			// sectors read
+	DWORD	cWrites;		// sectors written
+} HOST_DISK_STATS;
+
+BOOL HostDiskBegin(DWORD dwSectors);
+void HostDiskGetStats(HOST_DISK_STATS *pStats, BOOL bReset);
+
+MEDIA_INFORMATION *HostDiskMediaInitialize(void);
+BYTE HostDiskMediaDetect(void);
+BYTE HostDiskSectorRead(DWORD dwSector, BYTE *pBuffer);
+BYTE HostDiskSectorWrite(DWORD dwSector, BYTE *pBuffer, BYTE bAllowWriteToZero);
+BYTE HostDiskWriteProtectState(void);
+BYTE HostDiskShutdownMedia(void);
+
+#endif
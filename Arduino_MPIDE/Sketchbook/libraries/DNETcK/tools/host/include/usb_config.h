@@ -0,0 +1,50 @@
+/************************************************************************/
+/*																		*/
+/*	usb_config.h	--  USB device configuration for host builds        */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	On the board every sketch brings its own usb_config.h; this is the  */
+/*	one msdtest.c builds usb_function_msd.c with: a mass storage        */
+/*	interface on endpoint 1 with two LUNs, full ping-pong.              */
+/*																		*/
+/************************************************************************/
+
+#ifndef USBCFG_H
+#define USBCFG_H
+
+#define USB_SUPPORT_DEVICE
+
+#define USB_EP0_BUFF_SIZE		8
+#define USB_MAX_EP_NUMBER		1
+#define USB_PING_PONG_MODE		USB_PING_PONG__FULL_PING_PONG
+
+#define USB_USE_MSD
+
+#define MSD_INTF_ID				0x00
+#define MSD_IN_EP_SIZE			64
+#define MSD_OUT_EP_SIZE			64
+#define MAX_LUN					1
+#define MSD_DATA_IN_EP			1
+#define MSD_DATA_OUT_EP			1
+
+#endif
@@ -0,0 +1,73 @@
+/************************************************************************/
+/*																		*/
+/*	FSconfig.h	--  File system configuration of msdhosttest            */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	include/FSconfig.h with two volumes, and the MDD_* functions on     */
+/*	the USB host MSD library the way the USBMSDHost example's           */
+/*	FSconfig.h maps them with USE_USB_INTERFACE, the multi-sector       */
+/*	transfers and the volume selection included.                        */
+/*																		*/
+/************************************************************************/
+
+#ifndef _FS_DEF_
+#define _FS_DEF_
+
+#define FS_MAX_FILES_OPEN			3
+#define MEDIA_SECTOR_SIZE			512
+#define FS_MAX_VOLUMES				2
+
+#define ALLOW_FILESEARCH
+#define ALLOW_WRITES
+#define ALLOW_FORMATS
+#define ALLOW_DIRS
+#define SUPPORT_FAT32
+#define ALLOW_GET_DISK_PROPERTIES
+
+#define INCREMENTTIMESTAMP
+
+#ifdef __cplusplus
+	#define MDD_MediaInitialize		USBMSDHost.SCSIMediaInitialize
+	#define MDD_MediaDetect			USBMSDHost.SCSIMediaDetect
+	#define MDD_SectorRead			USBMSDHost.SCSISectorRead
+	#define MDD_SectorWrite			USBMSDHost.SCSISectorWrite
+	#define MDD_InitIO()
+	#define MDD_ShutdownMedia		USBMSDHost.SCSIMediaReset
+	#define MDD_WriteProtectState	USBMSDHost.SCSIWriteProtectState
+	#define MDD_SectorReadMulti		USBMSDHost.SCSISectorReadMulti
+	#define MDD_SectorWriteMulti	USBMSDHost.SCSISectorWriteMulti
+	#define MDD_SelectVolume		USBMSDHost.SCSISelectVolume
+#else
+	#define MDD_MediaInitialize		USBHostMSDSCSIMediaInitialize
+	#define MDD_MediaDetect			USBHostMSDSCSIMediaDetect
+	#define MDD_SectorRead			USBHostMSDSCSISectorRead
+	#define MDD_SectorWrite			USBHostMSDSCSISectorWrite
+	#define MDD_InitIO()
+	#define MDD_ShutdownMedia		USBHostMSDSCSIMediaReset
+	#define MDD_WriteProtectState	USBHostMSDSCSIWriteProtectState
+	#define MDD_SectorReadMulti		USBHostMSDSCSISectorReadMulti
+	#define MDD_SectorWriteMulti	USBHostMSDSCSISectorWriteMulti
+	#define MDD_SelectVolume		USBHostMSDSCSISelectVolume
+#endif
+
+#endif
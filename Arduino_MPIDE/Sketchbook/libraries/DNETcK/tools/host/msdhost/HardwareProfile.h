@@ -0,0 +1,36 @@
+/************************************************************************/
+/*																		*/
+/*	HardwareProfile.h	--  msdhosttest's board                         */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	usb_host_msd_scsi.c includes this; on a host build it only says     */
+/*	the file system is on the USB host MSD library.                     */
+/*																		*/
+/************************************************************************/
+
+#ifndef _HARDWARE_PROFILE_H_
+#define _HARDWARE_PROFILE_H_
+
+#define USE_USB_INTERFACE
+
+#endif
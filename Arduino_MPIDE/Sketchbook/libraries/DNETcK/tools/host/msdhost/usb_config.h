@@ -0,0 +1,48 @@
+/************************************************************************/
+/*																		*/
+/*	usb_config.h	--  USB host configuration of msdhosttest           */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	chipKITUSBMSDHost's USBMSDHost example's configuration without the  */
+/*	part's headers, for two devices and a volume for each of up to      */
+/*	five LUNs.  -iquote puts this directory in front of include/.       */
+/*																		*/
+/************************************************************************/
+
+#ifndef _usb_config_h_
+#define _usb_config_h_
+
+#define USB_SUPPORT_HOST
+
+#define USB_PING_PONG_MODE				USB_PING_PONG__FULL_PING_PONG
+
+#define USB_MAX_MASS_STORAGE_DEVICES	2
+#define USB_MAX_MSD_SCSI_VOLUMES		5
+
+#define USBTasks()					\
+	{								\
+		USBHostTasks();				\
+		USBHostMSDTasks();			\
+	}
+
+#endif
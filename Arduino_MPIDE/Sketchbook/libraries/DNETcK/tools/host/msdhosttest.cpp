@@ -0,0 +1,340 @@
+/************************************************************************/
+/*																		*/
+/*	msdhosttest.cpp	--  Two MSD devices mounted at once through FSIO    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	A sketch on chipKITUSBMSDHost and chipKITMDDFS with msdhost/ as		*/
+/*	its configuration: the real FSIO.cpp, the USBMSDHost thunks and		*/
+/*	usb_host_msd_scsi.c, over hostmsd.c's devices in place of the USB	*/
+/*	host stack.  A thumb drive at address 1 and a four slot card		*/
+/*	reader at address 2 fill the SCSI layer's five volumes, so a third	*/
+/*	device finds no room.												*/
+/*																		*/
+/*	Each volume's READ CAPACITY must give the sector size of its		*/
+/*	medium, 520 and 2048 byte sectors included, and the empty slot		*/
+/*	none; the sector functions must then move that many bytes per		*/
+/*	sector on that device and LUN.										*/
+/*																		*/
+/*	FSIO's two volumes are the drive and the reader's first slot, each	*/
+/*	formatted and mounted.  A file written on the drive is copied to a	*/
+/*	directory on the reader with both files open at once, and the copy	*/
+/*	must go through READ(10)s and WRITE(10)s of several sectors, must	*/
+/*	read back the same on both, and must leave the drive's working		*/
+/*	directory where it was.  Pulling the drive out must not disturb		*/
+/*	the reader, and another device then takes the drive's volume.		*/
+/*																		*/
+/*		msdhosttest [-k kbytes]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdio.h>
+
+#include "chipKITUSBHost.h"
+#include "chipKITUSBMSDHost.h"
+#include "chipKITMDDFS.h"
+#include "hosttest.h"
+
+#define MSD_HOST_TEST_SECTORS	(140000ul)		// 70 MB, FAT16 with 4 sector clusters
+#define MSD_HOST_TEST_SLOT		(64ul)			// sectors on the reader's odd media
+#define MSD_HOST_TEST_COPY		(4096u)			// bytes the copy loop moves at a time
+
+#define ADDRESS_DRIVE			(1u)
+#define ADDRESS_READER			(2u)
+#define ADDRESS_SPARE			(3u)
+
+typedef struct
+{
+	BYTE	address;
+	BYTE	LUN;
+	WORD	wSectorSize;		// 0 for an empty slot
+} VOLUME;
+
+// In the order the SCSI layer gives out its volumes
+static const VOLUME _rgVolume[] =
+{
+	{ADDRESS_DRIVE,		0,	512},
+	{ADDRESS_READER,	0,	512},
+	{ADDRESS_READER,	1,	520},
+	{ADDRESS_READER,	2,	2048},
+	{ADDRESS_READER,	3,	0},
+};
+
+static BYTE *_rgpbImage[sizeof(_rgVolume) / sizeof(_rgVolume[0])];
+static BYTE *_pbData;
+static size_t _cbData = 256ul * 1024ul;
+
+static void Fill(BYTE *pb, size_t cb, DWORD dwSeed)
+{
+	size_t i;
+
+	for(i = 0; i < cb; i++)
+		pb[i] = (BYTE)(dwSeed + i * 13u + (i >> 9));
+}
+
+static bool WriteFile(const char *szName, const BYTE *pbData, size_t cbData)
+{
+	FSFILE *pFile = MDDFS.fopen(szName, "w");
+	size_t cbWritten;
+
+	if(pFile == NULL)
+		return false;
+	cbWritten = MDDFS.fwrite(pbData, 1, cbData, pFile);
+	return MDDFS.fclose(pFile) == 0 && cbWritten == cbData;
+}
+
+static bool FileMatches(const char *szName, const BYTE *pbData, size_t cbData)
+{
+	FSFILE *pFile = MDDFS.fopen(szName, "r");
+	BYTE *pbRead = (BYTE *)malloc(cbData + 1);
+	size_t cbRead;
+	bool fMatches;
+
+	if(pFile == NULL || pbRead == NULL)
+	{
+		if(pFile != NULL)
+			MDDFS.fclose(pFile);
+		free(pbRead);
+		return false;
+	}
+
+	// one byte more than there is, to see the end
+	cbRead = MDDFS.fread(pbRead, 1, cbData + 1, pFile);
+	fMatches = cbRead == cbData && memcmp(pbRead, pbData, cbData) == 0;
+	MDDFS.fclose(pFile);
+	free(pbRead);
+
+	return fMatches;
+}
+
+// szSource on volume 0 to szDest on volume 1, both open all along
+static bool CopyFile(const char *szSource, const char *szDest)
+{
+	static BYTE rgb[MSD_HOST_TEST_COPY];
+	FSFILE *pSource;
+	FSFILE *pDest;
+	size_t cb;
+	bool fCopied = true;
+
+	MDDFS.SelectVolume(0);
+	pSource = MDDFS.fopen(szSource, "r");
+	MDDFS.SelectVolume(1);
+	pDest = MDDFS.fopen(szDest, "w");
+	if(pSource == NULL || pDest == NULL)
+		return false;
+
+	while((cb = MDDFS.fread(rgb, 1, sizeof(rgb), pSource)) != 0)
+	{
+		if(MDDFS.fwrite(rgb, 1, cb, pDest) != cb)
+		{
+			fCopied = false;
+			break;
+		}
+	}
+
+	return MDDFS.fclose(pSource) == 0 && MDDFS.fclose(pDest) == 0 && fCopied;
+}
+
+static void CheckVolumes(void)
+{
+	BYTE rgb[2 * 2048];
+	HOST_MSD_STATS stats;
+	MEDIA_INFORMATION *pInfo;
+	BYTE i;
+
+	HOST_TEST_CHECK(HostMsdAttach(ADDRESS_DRIVE, 0));
+	HOST_TEST_CHECK(HostMsdAttach(ADDRESS_READER, 3));
+	for(i = 0; i < sizeof(_rgVolume) / sizeof(_rgVolume[0]); i++)
+	{
+		if(_rgVolume[i].wSectorSize == 0)
+			continue;
+		_rgpbImage[i] = HostMsdInsert(_rgVolume[i].address, _rgVolume[i].LUN,
+						_rgVolume[i].wSectorSize == 512 ? MSD_HOST_TEST_SECTORS : MSD_HOST_TEST_SLOT,
+						_rgVolume[i].wSectorSize);
+		HOST_TEST_CHECK(_rgpbImage[i] != NULL);
+	}
+
+	// all the volumes are taken
+	HOST_TEST_CHECK(!HostMsdAttach(ADDRESS_SPARE, 0));
+	HOST_TEST_CHECK(!USBMSDHost.SCSISelectVolume(sizeof(_rgVolume) / sizeof(_rgVolume[0])));
+
+	// READ CAPACITY on each, sent to its own device and LUN
+	for(i = 0; i < sizeof(_rgVolume) / sizeof(_rgVolume[0]); i++)
+	{
+		HOST_TEST_CHECK(USBMSDHost.SCSISelectVolume(i) && USBMSDHost.SCSICurrentVolume() == i);
+		HOST_TEST_CHECK(USBMSDHost.SCSIMediaDetect());
+		HostMsdGetStats(_rgVolume[i].address, &stats, TRUE);
+
+		pInfo = USBMSDHost.SCSIMediaInitialize();
+		HostMsdGetStats(_rgVolume[i].address, &stats, TRUE);
+		HOST_TEST_CHECK(stats.cCommands != 0 && stats.bLastLUN == _rgVolume[i].LUN);
+		if(_rgVolume[i].wSectorSize == 0)
+		{
+			HOST_TEST_CHECK(pInfo->errorCode == MEDIA_CANNOT_INITIALIZE);
+			continue;
+		}
+		HOST_TEST_CHECK(pInfo->errorCode == MEDIA_NO_ERROR);
+		HOST_TEST_CHECK(pInfo->validityFlags.bits.sectorSize && pInfo->sectorSize == _rgVolume[i].wSectorSize);
+	}
+
+	// whole sectors of 520 bytes, one and several at a time
+	HOST_TEST_CHECK(USBMSDHost.SCSISelectVolume(2));
+	Fill(_rgpbImage[2], MSD_HOST_TEST_SLOT * 520u, 2);
+	memset(rgb, 0, sizeof(rgb));
+	HOST_TEST_CHECK(USBMSDHost.SCSISectorRead(3, rgb) && memcmp(rgb, _rgpbImage[2] + 3 * 520u, 520) == 0);
+	HOST_TEST_CHECK(rgb[520] == 0);
+	HOST_TEST_CHECK(USBMSDHost.SCSISectorReadMulti(5, rgb, 2) && memcmp(rgb, _rgpbImage[2] + 5 * 520u, 2 * 520) == 0);
+	Fill(rgb, 2 * 520, 77);
+	HOST_TEST_CHECK(USBMSDHost.SCSISectorWriteMulti(10, rgb, 2, FALSE) && memcmp(rgb, _rgpbImage[2] + 10 * 520u, 2 * 520) == 0);
+	HOST_TEST_CHECK(!USBMSDHost.SCSISectorReadMulti(MSD_HOST_TEST_SLOT - 1, rgb, 2));
+
+	// and 2048 on the next slot
+	HOST_TEST_CHECK(USBMSDHost.SCSISelectVolume(3));
+	HostMsdGetStats(ADDRESS_READER, &stats, TRUE);
+	Fill(_rgpbImage[3], MSD_HOST_TEST_SLOT * 2048u, 3);
+	HOST_TEST_CHECK(USBMSDHost.SCSISectorReadMulti(7, rgb, 2) && memcmp(rgb, _rgpbImage[3] + 7 * 2048u, 2 * 2048) == 0);
+	HostMsdGetStats(ADDRESS_READER, &stats, TRUE);
+	HOST_TEST_CHECK(stats.cReads == 1 && stats.cSectorsRead == 2 && stats.bLastLUN == 2);
+
+	// sector 0 only when it is asked for
+	HOST_TEST_CHECK(!USBMSDHost.SCSISectorWrite(0, rgb, FALSE));
+	HOST_TEST_CHECK(!USBMSDHost.SCSISectorWriteMulti(0, rgb, 1, FALSE));
+
+	// the empty slot
+	HOST_TEST_CHECK(USBMSDHost.SCSISelectVolume(4));
+	HOST_TEST_CHECK(!USBMSDHost.SCSISectorRead(0, rgb));
+}
+
+static void CheckFileSystems(void)
+{
+	static const char * const rgszLabel[] = {"DRIVE", "READER"};
+	HOST_MSD_STATS statsDrive;
+	HOST_MSD_STATS statsReader;
+	DWORD cSectors = (_cbData + 511u) / 512u;
+	char szCwd[32];
+	BYTE i;
+
+	// FSIO's volume i is the SCSI layer's
+	for(i = 0; i < 2; i++)
+	{
+		HOST_TEST_CHECK(MDDFS.SelectVolume(i) && MDDFS.CurrentVolume() == i);
+		HOST_TEST_CHECK(USBMSDHost.SCSICurrentVolume() == i);
+		HOST_TEST_CHECK(MDDFS.CreateMBR(1, MSD_HOST_TEST_SECTORS) == 0);
+		HOST_TEST_CHECK(MDDFS.format(1, 0x20120101l + i, (char *)rgszLabel[i]) == 0);
+		HOST_TEST_CHECK(MDDFS.Init());
+	}
+	HOST_TEST_CHECK(!MDDFS.SelectVolume(2));
+
+	HOST_TEST_CHECK(MDDFS.SelectVolume(0));
+	HOST_TEST_CHECK(WriteFile("SOURCE.BIN", _pbData, _cbData));
+	HOST_TEST_CHECK(MDDFS.SelectVolume(1));
+	HOST_TEST_CHECK(MDDFS.mkdir((char *)"COPIES") == 0 && MDDFS.chdir((char *)"COPIES") == 0);
+
+	HostMsdGetStats(ADDRESS_DRIVE, &statsDrive, TRUE);
+	HostMsdGetStats(ADDRESS_READER, &statsReader, TRUE);
+	HOST_TEST_CHECK(CopyFile("SOURCE.BIN", "COPY.BIN"));
+	HostMsdGetStats(ADDRESS_DRIVE, &statsDrive, TRUE);
+	HostMsdGetStats(ADDRESS_READER, &statsReader, TRUE);
+
+	printf("msdhosttest: %lu byte copy, drive %lu READ(10)s for %lu sectors, reader %lu WRITE(10)s for %lu sectors\n",
+		(unsigned long)_cbData, (unsigned long)statsDrive.cReads, (unsigned long)statsDrive.cSectorsRead,
+		(unsigned long)statsReader.cWrites, (unsigned long)statsReader.cSectorsWritten);
+
+	// the file's sectors in runs, only the drive read and only the reader written
+	HOST_TEST_CHECK(statsDrive.cSectorsRead >= cSectors && statsDrive.cMaxSectors > 1);
+	HOST_TEST_CHECK(statsDrive.cReads * 2 < statsDrive.cSectorsRead);
+	HOST_TEST_CHECK(statsDrive.cWrites == 0);
+	HOST_TEST_CHECK(statsReader.cSectorsWritten >= cSectors && statsReader.cMaxSectors > 1);
+	HOST_TEST_CHECK(statsReader.cWrites * 2 < statsReader.cSectorsWritten);
+
+	// each volume keeps its own working directory and files
+	HOST_TEST_CHECK(MDDFS.SelectVolume(0));
+	HOST_TEST_CHECK(MDDFS.getcwd(szCwd, sizeof(szCwd)) != NULL && strcmp(szCwd, "\\") == 0);
+	HOST_TEST_CHECK(FileMatches("SOURCE.BIN", _pbData, _cbData));
+	HOST_TEST_CHECK(MDDFS.fopen("COPY.BIN", "r") == NULL);
+	HOST_TEST_CHECK(MDDFS.SelectVolume(1));
+	HOST_TEST_CHECK(MDDFS.getcwd(szCwd, sizeof(szCwd)) != NULL && strcmp(szCwd, "\\COPIES") == 0);
+	HOST_TEST_CHECK(FileMatches("COPY.BIN", _pbData, _cbData));
+	HOST_TEST_CHECK(MDDFS.fopen("SOURCE.BIN", "r") == NULL);
+}
+
+static void CheckDetach(void)
+{
+	HOST_MSD_STATS stats;
+	MEDIA_INFORMATION *pInfo;
+
+	HostMsdDetach(ADDRESS_DRIVE);
+	HOST_TEST_CHECK(USBMSDHost.SCSISelectVolume(0));
+	HOST_TEST_CHECK(!USBMSDHost.SCSIMediaDetect());
+	HOST_TEST_CHECK(USBMSDHost.SCSIMediaInitialize()->errorCode == MEDIA_DEVICE_NOT_PRESENT);
+
+	// the reader goes on as it was
+	HOST_TEST_CHECK(MDDFS.SelectVolume(1));
+	HOST_TEST_CHECK(FileMatches("COPY.BIN", _pbData, _cbData));
+
+	// and the freed volume goes to the next device
+	HOST_TEST_CHECK(HostMsdAttach(ADDRESS_SPARE, 0));
+	HOST_TEST_CHECK(HostMsdInsert(ADDRESS_SPARE, 0, MSD_HOST_TEST_SLOT, 1024) != NULL);
+	HOST_TEST_CHECK(USBMSDHost.SCSISelectVolume(0));
+	HOST_TEST_CHECK(USBMSDHost.SCSIMediaDetect());
+	pInfo = USBMSDHost.SCSIMediaInitialize();
+	HOST_TEST_CHECK(pInfo->errorCode == MEDIA_NO_ERROR && pInfo->sectorSize == 1024);
+	HostMsdGetStats(ADDRESS_SPARE, &stats, FALSE);
+	HOST_TEST_CHECK(stats.cCommands != 0);
+
+	HostMsdDetach(ADDRESS_SPARE);
+	HostMsdDetach(ADDRESS_READER);
+}
+
+int main(int argc, char *argv[])
+{
+	int i;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+			_cbData = strtoul(argv[++i], NULL, 0) * 1024ul;
+		else
+		{
+			fprintf(stderr, "usage: %s [-k kbytes]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(_cbData == 0 || _cbData > 2048ul * 1024ul)
+	{
+		fprintf(stderr, "%s: 1 to 2048 kbytes\n", argv[0]);
+		return 2;
+	}
+
+	// not a multiple of the sector size, so the last sector is partly used
+	_cbData += 123u;
+	_pbData = (BYTE *)malloc(_cbData);
+	Fill(_pbData, _cbData, 0);
+
+	CheckVolumes();
+	CheckFileSystems();
+	CheckDetach();
+
+	free(_pbData);
+	return HostTestEnd("msdhosttest");
+}
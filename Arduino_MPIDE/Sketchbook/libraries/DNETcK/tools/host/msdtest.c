@@ -0,0 +1,590 @@
+/************************************************************************/
+/*																		*/
+/*	msdtest.c	--  Bulk-Only Transport conformance of the MSD function */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	chipKITUSBDevice's usb_function_msd.c on hostusb.c's simulated		*/
+/*	SIE, LUN 0 a disk image of MSD_TEST_SECTORS in RAM and LUN 1 an		*/
+/*	empty card socket.  The host side is a Bulk-Only Transport host		*/
+/*	as the spec describes it: a CBW, the data phase, which ends on a	*/
+/*	short packet or a STALL, then the CSW, read again once after a		*/
+/*	STALL; every halt is cleared and a phase error or a CBW that got	*/
+/*	no CSW ends in a Reset Recovery.  MSDTasks() runs before every		*/
+/*	token, the way the sketch loop would between the host's tries.		*/
+/*																		*/
+/*	The thirteen cases of the spec's section 6.7 (Hn, Hi, Ho: what the	*/
+/*	host expects; Dn, Di, Do: what the device means to do) are checked	*/
+/*	for the CSW's status and residue and for which endpoint stalled,	*/
+/*	and a TEST UNIT READY after each must find the device in step.		*/
+/*	A CBW that is not valid must stall both endpoints until a Reset		*/
+/*	Recovery, even when the host clears a halt before its reset.		*/
+/*																		*/
+/*	Then multi-sector READ(10) and WRITE(10) go through the streaming	*/
+/*	path against the image with both ping-pong buffers armed, and the	*/
+/*	failing commands leave the sense data REQUEST SENSE should find.	*/
+/*																		*/
+/*		msdtest [-n sectors]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+#include "USB/usb.h"
+#include "USB/usb_function_msd.h"
+
+#define MSD_TEST_SECTORS		(2048u)
+#define MSD_TEST_TRIES			(10000u)	// tokens NAKed before the device counts as hung
+#define MSD_TEST_NO_CSW			(0xFFu)		// BOT_RESULT.bStatus when no valid CSW came
+
+// Expected stalls; the spec leaves some to the device
+#define STALL_NO				(0u)
+#define STALL_YES				(1u)
+#define STALL_MAY				(2u)
+
+typedef struct
+{
+	BYTE	bStatus;			// the CSW's, or MSD_TEST_NO_CSW
+	DWORD	dwResidue;
+	DWORD	cbData;				// bytes moved in the data phase
+	BOOL	fStallIn;			// the IN endpoint stalled, in the data or the status phase
+	BOOL	fStallOut;
+} BOT_RESULT;
+
+typedef struct
+{
+	const char	*szCase;
+	BYTE		rgbCB[10];
+	BYTE		cbCB;
+	BYTE		bFlags;
+	DWORD		dwLen;
+	BYTE		bStatus;
+	DWORD		dwResidue;		// not checked on a phase error
+	BYTE		bStallIn;
+	BYTE		bStallOut;
+} BOT_CASE;
+
+#define CB_TUR			{MSD_TEST_UNIT_READY, 0, 0, 0, 0, 0}, 6
+#define CB_INQUIRY		{MSD_INQUIRY, 0, 0, 0, 36, 0}, 6
+#define CB_READ(n)		{MSD_READ_10, 0, 0, 0, 0, 1, 0, 0, (n), 0}, 10
+#define CB_WRITE(n)		{MSD_WRITE_10, 0, 0, 0, 0, 1, 0, 0, (n), 0}, 10
+
+static const BOT_CASE _rgCases[] =
+{
+	{"1 Hn=Dn",				CB_TUR,			0x00,	0,		MSD_CSW_COMMAND_PASSED,	0,		STALL_NO,	STALL_NO},
+	{"2 Hn<Di",				CB_INQUIRY,		0x00,	0,		MSD_CSW_PHASE_ERROR,	0,		STALL_NO,	STALL_NO},
+	{"3 Hn<Do",				CB_WRITE(1),	0x00,	0,		MSD_CSW_PHASE_ERROR,	0,		STALL_NO,	STALL_NO},
+	{"4 Hi>Dn",				CB_TUR,			0x80,	36,		MSD_CSW_COMMAND_PASSED,	36,		STALL_YES,	STALL_NO},
+	{"5 Hi>Di",				CB_INQUIRY,		0x80,	64,		MSD_CSW_COMMAND_PASSED,	28,		STALL_MAY,	STALL_NO},
+	{"5 Hi>Di READ(10)",	CB_READ(1),		0x80,	1024,	MSD_CSW_COMMAND_PASSED,	512,	STALL_YES,	STALL_NO},
+	{"6 Hi=Di",				CB_INQUIRY,		0x80,	36,		MSD_CSW_COMMAND_PASSED,	0,		STALL_NO,	STALL_NO},
+	{"6 Hi=Di READ(10)",	CB_READ(2),		0x80,	1024,	MSD_CSW_COMMAND_PASSED,	0,		STALL_NO,	STALL_NO},
+	{"7 Hi<Di",				CB_READ(2),		0x80,	512,	MSD_CSW_PHASE_ERROR,	0,		STALL_MAY,	STALL_NO},
+	{"8 Hi<>Do",			CB_WRITE(1),	0x80,	512,	MSD_CSW_PHASE_ERROR,	0,		STALL_MAY,	STALL_NO},
+	{"9 Ho>Dn",				CB_TUR,			0x00,	512,	MSD_CSW_COMMAND_PASSED,	512,	STALL_NO,	STALL_YES},
+	{"10 Ho<>Di",			CB_INQUIRY,		0x00,	36,		MSD_CSW_PHASE_ERROR,	0,		STALL_NO,	STALL_MAY},
+	{"11 Ho>Do",			CB_WRITE(1),	0x00,	1024,	MSD_CSW_COMMAND_PASSED,	512,	STALL_NO,	STALL_MAY},
+	{"12 Ho=Do",			CB_WRITE(2),	0x00,	1024,	MSD_CSW_COMMAND_PASSED,	0,		STALL_NO,	STALL_NO},
+	{"13 Ho<Do",			CB_WRITE(2),	0x00,	512,	MSD_CSW_PHASE_ERROR,	0,		STALL_NO,	STALL_MAY},
+};
+
+static BYTE *_pbDisk;
+static BOOL _fWriteProtect;
+static MEDIA_INFORMATION _Info;
+static DWORD _dwTag;
+static int _cClaimed;
+static int _cReleased;
+
+static MEDIA_INFORMATION *DiskMediaInitialize(void)
+{
+	_Info.errorCode = MEDIA_NO_ERROR;
+	_Info.validityFlags.value = 0;
+	return &_Info;
+}
+
+static DWORD DiskReadCapacity(void)
+{
+	return MSD_TEST_SECTORS - 1;
+}
+
+static WORD DiskReadSectorSize(void)
+{
+	return 512;
+}
+
+static BYTE DiskMediaDetect(void)
+{
+	return TRUE;
+}
+
+static BYTE DiskSectorRead(DWORD dwSector, BYTE *pBuffer)
+{
+	if(dwSector >= MSD_TEST_SECTORS)
+		return FALSE;
+
+	memcpy(pBuffer, _pbDisk + dwSector * 512u, 512);
+	return TRUE;
+}
+
+static BYTE DiskWriteProtectState(void)
+{
+	return _fWriteProtect;
+}
+
+static BYTE DiskSectorWrite(DWORD dwSector, BYTE *pBuffer, BYTE bAllowWriteToZero)
+{
+	if(dwSector >= MSD_TEST_SECTORS || (dwSector == 0 && !bAllowWriteToZero))
+		return FALSE;
+
+	memcpy(_pbDisk + dwSector * 512u, pBuffer, 512);
+	return TRUE;
+}
+
+// An empty card socket
+static BYTE SocketMediaDetect(void)
+{
+	return FALSE;
+}
+
+LUN_FUNCTIONS LUN[MAX_LUN + 1] =
+{
+	{
+		DiskMediaInitialize, DiskReadCapacity, DiskReadSectorSize, DiskMediaDetect,
+		DiskSectorRead, DiskWriteProtectState, DiskSectorWrite
+	},
+	{
+		DiskMediaInitialize, DiskReadCapacity, DiskReadSectorSize, SocketMediaDetect,
+		DiskSectorRead, DiskWriteProtectState, DiskSectorWrite
+	}
+};
+
+// What the sketch's handler gets from the MSD function
+BOOL USER_USB_CALLBACK_EVENT_HANDLER(USB_EVENT event, void *pdata, WORD size)
+{
+	if(event == EVENT_MSD_MEDIA_CLAIMED)
+		_cClaimed++;
+	else if(event == EVENT_MSD_MEDIA_RELEASED)
+		_cReleased++;
+
+	return TRUE;
+}
+
+// One packet each way, with the device's tasks run before each try
+static HOST_USB_HANDSHAKE PacketIn(BYTE *pData, WORD *pwLen)
+{
+	HOST_USB_HANDSHAKE hs = HOST_USB_NAK;
+	DWORD cTries;
+
+	for(cTries = 0; cTries < MSD_TEST_TRIES && hs == HOST_USB_NAK; cTries++)
+	{
+		MSDTasks();
+		hs = HostUsbIn(MSD_DATA_IN_EP, pData, pwLen);
+	}
+
+	return hs;
+}
+
+static HOST_USB_HANDSHAKE PacketOut(const BYTE *pData, WORD wLen)
+{
+	HOST_USB_HANDSHAKE hs = HOST_USB_NAK;
+	DWORD cTries;
+
+	for(cTries = 0; cTries < MSD_TEST_TRIES && hs == HOST_USB_NAK; cTries++)
+	{
+		MSDTasks();
+		hs = HostUsbOut(MSD_DATA_OUT_EP, pData, wLen);
+	}
+
+	return hs;
+}
+
+// Reads until cbMax bytes, a short packet or a STALL
+static HOST_USB_HANDSHAKE BulkIn(BYTE *pData, DWORD cbMax, DWORD *pcb)
+{
+	BYTE rgbPacket[MSD_IN_EP_SIZE];
+	HOST_USB_HANDSHAKE hs;
+	WORD cb;
+
+	for(*pcb = 0; *pcb < cbMax; )
+	{
+		if((hs = PacketIn(rgbPacket, &cb)) != HOST_USB_ACK)
+			return hs;
+
+		// a device sending more than asked for is babbling
+		if(!HOST_TEST_CHECK(cb <= cbMax - *pcb))
+			cb = cbMax - *pcb;
+		memcpy(pData + *pcb, rgbPacket, cb);
+		*pcb += cb;
+
+		if(cb < MSD_IN_EP_SIZE)
+			break;
+	}
+
+	return HOST_USB_ACK;
+}
+
+static HOST_USB_HANDSHAKE BulkOut(const BYTE *pData, DWORD cb, DWORD *pcb)
+{
+	HOST_USB_HANDSHAKE hs;
+	WORD cbPacket;
+
+	for(*pcb = 0; *pcb < cb; *pcb += cbPacket)
+	{
+		cbPacket = cb - *pcb < MSD_OUT_EP_SIZE ? cb - *pcb : MSD_OUT_EP_SIZE;
+		if((hs = PacketOut(pData + *pcb, cbPacket)) != HOST_USB_ACK)
+			return hs;
+	}
+
+	return HOST_USB_ACK;
+}
+
+static BOOL ClearHalt(BYTE bEndpoint)
+{
+	return HostUsbSetup(USB_SETUP_RECIPIENT_ENDPOINT, USB_REQUEST_CLEAR_FEATURE, USB_FEATURE_ENDPOINT_HALT,
+						bEndpoint, 0, NULL, NULL, NULL);
+}
+
+static BOOL ResetRecovery(void)
+{
+	BOOL fReset;
+
+	fReset = HostUsbSetup(USB_SETUP_TYPE_CLASS | USB_SETUP_RECIPIENT_INTERFACE, MSD_RESET, 0, MSD_INTF_ID, 0,
+							USBCheckMSDRequest, NULL, NULL);
+	ClearHalt(0x80 | MSD_DATA_IN_EP);
+	ClearHalt(MSD_DATA_OUT_EP);
+
+	return fReset;
+}
+
+// One command through the three phases; FALSE if there was no valid CSW
+static BOOL Transport(BYTE bLUN, const BYTE *pCB, BYTE cbCB, BYTE bFlags, DWORD dwLen, BYTE *pData, BOT_RESULT *pResult)
+{
+	USB_MSD_CBW cbw;
+	USB_MSD_CSW csw;
+	BYTE rgbCSW[MSD_CSW_SIZE];
+	HOST_USB_HANDSHAKE hs;
+	DWORD cb;
+
+	memset(pResult, 0, sizeof(BOT_RESULT));
+	pResult->bStatus = MSD_TEST_NO_CSW;
+
+	memset(&cbw, 0, sizeof(cbw));
+	cbw.dCBWSignature = MSD_CBW_SIGNATURE;
+	cbw.dCBWTag = ++_dwTag;
+	cbw.dCBWDataTransferLength = dwLen;
+	cbw.bCBWFlags = bFlags;
+	cbw.bCBWLUN = bLUN;
+	cbw.bCBWCBLength = cbCB;
+	memcpy(cbw.CBWCB, pCB, cbCB);
+
+	if(PacketOut((const BYTE *)&cbw, MSD_CBW_SIZE) != HOST_USB_ACK)
+		return FALSE;
+
+	if(dwLen != 0)
+	{
+		if(bFlags & 0x80)
+		{
+			hs = BulkIn(pData, dwLen, &pResult->cbData);
+			pResult->fStallIn = (hs == HOST_USB_STALL);
+		}
+		else
+		{
+			hs = BulkOut(pData, dwLen, &pResult->cbData);
+			pResult->fStallOut = (hs == HOST_USB_STALL);
+		}
+
+		if(hs == HOST_USB_STALL)
+			ClearHalt((bFlags & 0x80) ? (0x80 | MSD_DATA_IN_EP) : MSD_DATA_OUT_EP);
+		else if(hs == HOST_USB_NAK)
+			return FALSE;
+	}
+
+	if((hs = BulkIn(rgbCSW, sizeof(rgbCSW), &cb)) == HOST_USB_STALL)
+	{
+		pResult->fStallIn = TRUE;
+		ClearHalt(0x80 | MSD_DATA_IN_EP);
+		hs = BulkIn(rgbCSW, sizeof(rgbCSW), &cb);
+	}
+
+	memcpy(&csw, rgbCSW, sizeof(rgbCSW));
+	if(hs != HOST_USB_ACK || cb != MSD_CSW_SIZE || csw.dCSWSignature != MSD_CSW_SIGNATURE || csw.dCSWTag != cbw.dCBWTag)
+		return FALSE;
+
+	pResult->bStatus = csw.bCSWStatus;
+	pResult->dwResidue = csw.dCSWDataResidue;
+
+	return TRUE;
+}
+
+// A command as the host's driver issues it, with Reset Recovery after a phase error
+static BYTE Command(BYTE bLUN, const BYTE *pCB, BYTE cbCB, BYTE bFlags, DWORD dwLen, BYTE *pData, BOT_RESULT *pResult)
+{
+	if(!Transport(bLUN, pCB, cbCB, bFlags, dwLen, pData, pResult) || pResult->bStatus == MSD_CSW_PHASE_ERROR)
+		ResetRecovery();
+
+	return pResult->bStatus;
+}
+
+static BOOL StallMatches(BYTE bExpected, BOOL fStalled)
+{
+	return bExpected == STALL_MAY || (bExpected == STALL_YES) == fStalled;
+}
+
+static BOOL UnitReady(BYTE bLUN)
+{
+	static const BYTE rgbTUR[] = {MSD_TEST_UNIT_READY, 0, 0, 0, 0, 0};
+	BOT_RESULT result;
+
+	return Command(bLUN, rgbTUR, sizeof(rgbTUR), 0x00, 0, NULL, &result) == MSD_CSW_COMMAND_PASSED;
+}
+
+// Sense key and ASC, key << 8 | ASC
+static WORD Sense(BYTE bLUN)
+{
+	static const BYTE rgbRequestSense[] = {MSD_REQUEST_SENSE, 0, 0, 0, 18, 0};
+	BYTE rgbSense[18];
+	BOT_RESULT result;
+
+	if(Command(bLUN, rgbRequestSense, sizeof(rgbRequestSense), 0x80, sizeof(rgbSense), rgbSense, &result) != MSD_CSW_COMMAND_PASSED ||
+		result.cbData != sizeof(rgbSense))
+		return 0xFFFF;
+
+	return ((WORD)(rgbSense[2] & 0x0F) << 8) | rgbSense[12];
+}
+
+static void CheckCases(void)
+{
+	BYTE rgbData[1024];
+	BOT_RESULT result;
+	BOOL fPassed;
+	BYTE i;
+
+	for(i = 0; i < sizeof(_rgCases) / sizeof(_rgCases[0]); i++)
+	{
+		const BOT_CASE *pCase = &_rgCases[i];
+
+		memset(rgbData, 0xA5, sizeof(rgbData));
+		Command(0, pCase->rgbCB, pCase->cbCB, pCase->bFlags, pCase->dwLen, rgbData, &result);
+
+		fPassed = HOST_TEST_CHECK(result.bStatus == pCase->bStatus);
+		if(pCase->bStatus != MSD_CSW_PHASE_ERROR)
+			fPassed &= HOST_TEST_CHECK(result.dwResidue == pCase->dwResidue);
+		fPassed &= HOST_TEST_CHECK(StallMatches(pCase->bStallIn, result.fStallIn));
+		fPassed &= HOST_TEST_CHECK(StallMatches(pCase->bStallOut, result.fStallOut));
+
+		// whatever happened, the device must be ready for the next command
+		fPassed &= HOST_TEST_CHECK(UnitReady(0));
+
+		if(!fPassed)
+			fprintf(stderr, "  case %s: status %u residue %lu, IN %s, OUT %s\n", pCase->szCase, result.bStatus,
+					(unsigned long)result.dwResidue, result.fStallIn ? "stalled" : "not stalled",
+					result.fStallOut ? "stalled" : "not stalled");
+	}
+}
+
+static void CheckInvalidCBW(void)
+{
+	static const BYTE rgbTUR[] = {MSD_TEST_UNIT_READY, 0, 0, 0, 0, 0};
+	USB_MSD_CBW cbw;
+	BYTE rgbPacket[MSD_IN_EP_SIZE];
+	WORD cb;
+	BYTE i;
+
+	for(i = 0; i < 2; i++)
+	{
+		memset(&cbw, 0, sizeof(cbw));
+		cbw.dCBWSignature = i == 0 ? 0x12345678ul : MSD_CBW_SIGNATURE;
+		cbw.dCBWTag = ++_dwTag;
+		cbw.bCBWCBLength = sizeof(rgbTUR);
+		memcpy(cbw.CBWCB, rgbTUR, sizeof(rgbTUR));
+
+		// a bad signature, then a good CBW one byte short
+		HOST_TEST_CHECK(PacketOut((const BYTE *)&cbw, i == 0 ? MSD_CBW_SIZE : MSD_CBW_SIZE - 1) == HOST_USB_ACK);
+
+		HOST_TEST_CHECK(PacketIn(rgbPacket, &cb) == HOST_USB_STALL);
+		HOST_TEST_CHECK(PacketOut((const BYTE *)&cbw, MSD_CBW_SIZE) == HOST_USB_STALL);
+
+		// clearing the halts is not enough, it takes the reset
+		ClearHalt(0x80 | MSD_DATA_IN_EP);
+		ClearHalt(MSD_DATA_OUT_EP);
+		HOST_TEST_CHECK(PacketIn(rgbPacket, &cb) == HOST_USB_STALL);
+		HOST_TEST_CHECK(PacketOut((const BYTE *)&cbw, MSD_CBW_SIZE) == HOST_USB_STALL);
+
+		HOST_TEST_CHECK(ResetRecovery());
+		HOST_TEST_CHECK(UnitReady(0));
+	}
+
+	// a LUN the device does not have fails, and nothing more
+	{
+		BOT_RESULT result;
+
+		HOST_TEST_CHECK(Command(MAX_LUN + 1, rgbTUR, sizeof(rgbTUR), 0x00, 0, NULL, &result) == MSD_CSW_COMMAND_FAILED);
+		HOST_TEST_CHECK(UnitReady(0));
+	}
+}
+
+static void CheckClassRequests(void)
+{
+	BYTE bMaxLUN = 0xFF;
+	WORD cb = 0;
+
+	HOST_TEST_CHECK(HostUsbSetup(0x80 | USB_SETUP_TYPE_CLASS | USB_SETUP_RECIPIENT_INTERFACE, GET_MAX_LUN, 0, MSD_INTF_ID, 1,
+					USBCheckMSDRequest, &bMaxLUN, &cb));
+	HOST_TEST_CHECK(cb == 1 && bMaxLUN == MAX_LUN);
+
+	// another interface's requests are left alone
+	HOST_TEST_CHECK(!HostUsbSetup(0x80 | USB_SETUP_TYPE_CLASS | USB_SETUP_RECIPIENT_INTERFACE, GET_MAX_LUN, 0, MSD_INTF_ID + 1, 1,
+					USBCheckMSDRequest, &bMaxLUN, &cb));
+}
+
+// Multi-sector transfers through the sector stream
+static void CheckStreams(DWORD cSectors)
+{
+	BYTE rgbCB[10] = {0};
+	BYTE *pbData = malloc(cSectors * 512u);
+	HOST_USB_EP_STATS stats;
+	BOT_RESULT result;
+	DWORD lba = 100;
+	DWORD i;
+
+	for(i = 0; i < cSectors * 512u; i++)
+		pbData[i] = (BYTE)rand();
+
+	rgbCB[0] = MSD_WRITE_10;
+	rgbCB[2] = (BYTE)(lba >> 24);
+	rgbCB[3] = (BYTE)(lba >> 16);
+	rgbCB[4] = (BYTE)(lba >> 8);
+	rgbCB[5] = (BYTE)lba;
+	rgbCB[7] = (BYTE)(cSectors >> 8);
+	rgbCB[8] = (BYTE)cSectors;
+
+	HostUsbGetStats(MSD_DATA_OUT_EP, OUT_FROM_HOST, &stats, TRUE);
+	HOST_TEST_CHECK(Command(0, rgbCB, 10, 0x00, cSectors * 512u, pbData, &result) == MSD_CSW_COMMAND_PASSED);
+	HOST_TEST_CHECK(result.dwResidue == 0 && !result.fStallOut);
+	HOST_TEST_CHECK(memcmp(_pbDisk + lba * 512u, pbData, cSectors * 512u) == 0);
+	HostUsbGetStats(MSD_DATA_OUT_EP, OUT_FROM_HOST, &stats, TRUE);
+	HOST_TEST_CHECK(stats.cMaxArmed == 2);
+
+	// read back around what was written
+	lba -= 2;
+	rgbCB[0] = MSD_READ_10;
+	rgbCB[5] = (BYTE)lba;
+	memset(pbData, 0, cSectors * 512u);
+
+	HostUsbGetStats(MSD_DATA_IN_EP, IN_TO_HOST, &stats, TRUE);
+	HOST_TEST_CHECK(Command(0, rgbCB, 10, 0x80, cSectors * 512u, pbData, &result) == MSD_CSW_COMMAND_PASSED);
+	HOST_TEST_CHECK(result.dwResidue == 0 && !result.fStallIn && result.cbData == cSectors * 512u);
+	HOST_TEST_CHECK(memcmp(_pbDisk + lba * 512u, pbData, cSectors * 512u) == 0);
+	HostUsbGetStats(MSD_DATA_IN_EP, IN_TO_HOST, &stats, TRUE);
+	HOST_TEST_CHECK(stats.cMaxArmed == 2);
+	HOST_TEST_CHECK(stats.cPackets == cSectors * 512u / MSD_IN_EP_SIZE + 1);
+
+	printf("  %lu sector READ(10): %lu packets, %lu NAKs\n", (unsigned long)cSectors,
+			(unsigned long)stats.cPackets, (unsigned long)stats.cNaks);
+
+	free(pbData);
+}
+
+static void CheckSense(void)
+{
+	static const BYTE rgbReadCapacity[] = {MSD_READ_CAPACITY, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+	static const BYTE rgbPastEnd[] = {MSD_READ_10, 0, 0, 0, (BYTE)((MSD_TEST_SECTORS - 1) >> 8), (BYTE)(MSD_TEST_SECTORS - 1), 0, 0, 2, 0};
+	static const BYTE rgbWrite[] = {MSD_WRITE_10, 0, 0, 0, 0, 8, 0, 0, 1, 0};
+	static const BYTE rgbUnknown[] = {0xC5, 0, 0, 0, 0, 0};
+	static const BYTE rgbEject[] = {MSD_STOP_START, 0, 0, 0, 0x02, 0};
+	BYTE rgbData[1024];
+	BOT_RESULT result;
+
+	HOST_TEST_CHECK(Command(0, rgbReadCapacity, sizeof(rgbReadCapacity), 0x80, 8, rgbData, &result) == MSD_CSW_COMMAND_PASSED);
+	HOST_TEST_CHECK(result.cbData == 8 && result.dwResidue == 0);
+	HOST_TEST_CHECK(rgbData[0] == 0 && rgbData[1] == 0 && rgbData[2] == (BYTE)((MSD_TEST_SECTORS - 1) >> 8) &&
+					rgbData[3] == (BYTE)(MSD_TEST_SECTORS - 1));
+	HOST_TEST_CHECK(rgbData[4] == 0 && rgbData[5] == 0 && rgbData[6] == 0x02 && rgbData[7] == 0x00);
+
+	// past the end of the image
+	HOST_TEST_CHECK(Command(0, rgbPastEnd, sizeof(rgbPastEnd), 0x80, 1024, rgbData, &result) == MSD_CSW_COMMAND_FAILED);
+	HOST_TEST_CHECK(result.dwResidue == 1024 && result.fStallIn);
+	HOST_TEST_CHECK(Sense(0) == ((S_ILLEGAL_REQUEST << 8) | ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE));
+	HOST_TEST_CHECK(Sense(0) == ((S_NO_SENSE << 8) | ASC_NO_ADDITIONAL_SENSE_INFORMATION));
+
+	HOST_TEST_CHECK(Command(0, rgbUnknown, sizeof(rgbUnknown), 0x00, 0, NULL, &result) == MSD_CSW_COMMAND_FAILED);
+	HOST_TEST_CHECK(Sense(0) == ((S_ILLEGAL_REQUEST << 8) | ASC_INVALID_COMMAND_OPCODE));
+
+	// the sector stays as it was and the data the host sends is refused
+	_fWriteProtect = TRUE;
+	memset(rgbData, 0x5A, 512);
+	HOST_TEST_CHECK(Command(0, rgbWrite, sizeof(rgbWrite), 0x00, 512, rgbData, &result) == MSD_CSW_COMMAND_FAILED);
+	HOST_TEST_CHECK(result.dwResidue == 512 && result.fStallOut);
+	HOST_TEST_CHECK(Sense(0) == ((S_DATA_PROTECT << 8) | ASC_WRITE_PROTECTED));
+	HOST_TEST_CHECK(_pbDisk[8 * 512] != 0x5A);
+	_fWriteProtect = FALSE;
+
+	// the empty socket
+	HOST_TEST_CHECK(!UnitReady(1));
+	HOST_TEST_CHECK(Sense(1) == ((S_NOT_READY << 8) | ASC_MEDIUM_NOT_PRESENT));
+
+	// the image was claimed once, ejecting it gives it back
+	HOST_TEST_CHECK(_cClaimed == 1 && _cReleased == 0 && MSDIsMediaClaimed(0));
+	HOST_TEST_CHECK(Command(0, rgbEject, sizeof(rgbEject), 0x00, 0, NULL, &result) == MSD_CSW_COMMAND_PASSED);
+	HOST_TEST_CHECK(_cReleased == 1 && !MSDIsMediaClaimed(0));
+	HOST_TEST_CHECK(!UnitReady(0));
+	HOST_TEST_CHECK(Sense(0) == ((S_NOT_READY << 8) | ASC_MEDIUM_NOT_PRESENT));
+}
+
+int main(int argc, char *argv[])
+{
+	DWORD cSectors = 128;
+	DWORD i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			cSectors = strtoul(argv[++i], NULL, 0);
+		else
+		{
+			fprintf(stderr, "usage: %s [-n sectors]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(cSectors == 0 || cSectors > MSD_TEST_SECTORS - 100)
+	{
+		fprintf(stderr, "%s: 1 to %u sectors\n", argv[0], MSD_TEST_SECTORS - 100);
+		return 2;
+	}
+
+	_pbDisk = malloc(MSD_TEST_SECTORS * 512u);
+	for(i = 0; i < MSD_TEST_SECTORS * 512u; i++)
+		_pbDisk[i] = (BYTE)(i / 512u + i);
+
+	HostUsbBegin();
+	USBMSDInit();
+
+	CheckClassRequests();
+	CheckCases();
+	CheckInvalidCBW();
+	CheckStreams(cSectors);
+	CheckSense();
+
+	free(_pbDisk);
+	return HostTestEnd("msdtest");
+}
@@ -0,0 +1,234 @@
+/************************************************************************/
+/*																		*/
+/*	pcaptest.c	--  Capture, replay and the handler times               */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	The peer of hosttest.h sends an ARP request, an ICMP echo, a TCP	*/
+/*	SYN to a closed port, a UDP datagram to a closed port, an IP		*/
+/*	protocol the stack does not know and a frame that is not IP or		*/
+/*	ARP, round after round, while STACK_USE_PCAP_CAPTURE records what	*/
+/*	the MAC sees to a file.  StackGetHandlerStats() must have charged	*/
+/*	each frame to its handler, and HostPcapReplay() of the file must	*/
+/*	hand the same frames to the same handlers again.					*/
+/*																		*/
+/*		pcaptest [rounds [file]]										*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "hosttest.h"
+#include "TCPIP Stack/HostPcap.h"
+
+#define PCAP_TEST_TCP_PORT		(9400u)		// nothing listens on them
+#define PCAP_TEST_UDP_PORT		(9401u)
+#define PCAP_TEST_PROTOCOL		(47u)		// GRE
+#define PCAP_TEST_ETHER_TYPE	(0x88B5u)	// local experimental
+
+static BYTE _rgbFrame[HOST_MAC_FRAME_SIZE];
+
+// A frame from the peer with pPayload after the IP header
+static WORD IPFrame(BYTE bProtocol, const BYTE *pPayload, WORD wLen)
+{
+	IP_HEADER *pIP = (IP_HEADER*)(_rgbFrame + sizeof(ETHER_HEADER));
+
+	HostTestPeerUdpFrame(_rgbFrame, 0, 0, pPayload, 0);
+	pIP->Protocol = bProtocol;
+	pIP->TotalLength = swaps(sizeof(IP_HEADER) + wLen);
+	pIP->HeaderChecksum = 0;
+	pIP->HeaderChecksum = CalcIPChecksum((BYTE*)pIP, sizeof(*pIP));
+	memcpy(pIP + 1, pPayload, wLen);
+
+	return sizeof(ETHER_HEADER) + sizeof(IP_HEADER) + wLen;
+}
+
+static void SendArp(BYTE port)
+{
+	ETHER_HEADER *pEther = (ETHER_HEADER*)_rgbFrame;
+	ARP_PACKET *pArp = (ARP_PACKET*)(pEther + 1);
+	NODE_INFO peer;
+
+	HostTestPeer(&peer);
+	memset(&pEther->DestMACAddr, 0xFF, sizeof(MAC_ADDR));
+	pEther->SourceMACAddr = peer.MACAddr;
+	pEther->Type.Val = swaps(0x0806);
+
+	pArp->HardwareType = swaps(1);
+	pArp->Protocol = swaps(0x0800);
+	pArp->MACAddrLen = sizeof(MAC_ADDR);
+	pArp->ProtocolLen = sizeof(IP_ADDR);
+	pArp->Operation = swaps(1);
+	pArp->SenderMACAddr = peer.MACAddr;
+	pArp->SenderIPAddr = peer.IPAddr;
+	memset(&pArp->TargetMACAddr, 0, sizeof(MAC_ADDR));
+	pArp->TargetIPAddr = AppConfig.MyIPAddr;
+
+	HostMACSend(port, _rgbFrame, sizeof(ETHER_HEADER) + sizeof(ARP_PACKET));
+}
+
+static void SendIcmpEcho(BYTE port, WORD wSequence)
+{
+	BYTE rgbEcho[24] = {8, 0, 0, 0, 0x12, 0x34};
+	WORD wChecksum;
+
+	rgbEcho[6] = (BYTE)(wSequence >> 8);
+	rgbEcho[7] = (BYTE)wSequence;
+	wChecksum = CalcIPChecksum(rgbEcho, sizeof(rgbEcho));
+	memcpy(rgbEcho + 2, &wChecksum, sizeof(wChecksum));
+
+	HostMACSend(port, _rgbFrame, IPFrame(IP_PROT_ICMP, rgbEcho, sizeof(rgbEcho)));
+}
+
+static void SendTcpSyn(BYTE port, WORD wSrcPort)
+{
+	BYTE rgbSyn[20] = {0};
+	IP_HEADER *pIP = (IP_HEADER*)(_rgbFrame + sizeof(ETHER_HEADER));
+	PSEUDO_HEADER pseudo;
+	DWORD_VAL sum;
+	WORD wLen;
+
+	rgbSyn[0] = (BYTE)(wSrcPort >> 8);
+	rgbSyn[1] = (BYTE)wSrcPort;
+	rgbSyn[2] = (BYTE)(PCAP_TEST_TCP_PORT >> 8);
+	rgbSyn[3] = (BYTE)PCAP_TEST_TCP_PORT;
+	rgbSyn[7] = 1;						// sequence number
+	rgbSyn[12] = 0x50;					// 20 byte header
+	rgbSyn[13] = 0x02;					// SYN
+	rgbSyn[14] = 0x05;					// window
+	wLen = IPFrame(IP_PROT_TCP, rgbSyn, sizeof(rgbSyn));
+
+	pseudo.SourceAddress = pIP->SourceAddress;
+	pseudo.DestAddress = pIP->DestAddress;
+	pseudo.Zero = 0;
+	pseudo.Protocol = IP_PROT_TCP;
+	pseudo.Length = swaps(sizeof(rgbSyn));
+	sum.Val = (WORD)~CalcIPChecksum((BYTE*)&pseudo, sizeof(pseudo));
+	sum.Val += (WORD)~CalcIPChecksum((BYTE*)(pIP + 1), sizeof(rgbSyn));
+	sum.Val = sum.w[0] + sum.w[1];
+	sum.Val = sum.w[0] + sum.w[1];
+	sum.w[0] = ~sum.w[0];
+	memcpy((BYTE*)(pIP + 1) + 16, &sum.w[0], sizeof(WORD));
+
+	HostMACSend(port, _rgbFrame, wLen);
+}
+
+static void SendOther(BYTE port)
+{
+	ETHER_HEADER *pEther = (ETHER_HEADER*)_rgbFrame;
+	static const BYTE rgbData[46];
+
+	HostMACSend(port, _rgbFrame, IPFrame(PCAP_TEST_PROTOCOL, rgbData, sizeof(rgbData)));
+	HostTestTasks();
+
+	memcpy(pEther + 1, rgbData, sizeof(rgbData));
+	pEther->Type.Val = swaps(PCAP_TEST_ETHER_TYPE);
+	HostMACSend(port, _rgbFrame, sizeof(ETHER_HEADER) + sizeof(rgbData));
+}
+
+static void CheckHandlers(const char *szName, const STACK_HANDLER_STATS rgStats[STACK_HANDLERS], DWORD dwRounds)
+{
+	static const char * const rgszHandler[STACK_HANDLERS] = {"ARP", "ICMP", "TCP", "UDP", "other"};
+	BYTE i;
+
+	for(i = 0; i < STACK_HANDLERS; i++)
+	{
+		printf("  %-7s %-6s %6lu frames, %6llu ns average, %6lu ns at most\n", szName, rgszHandler[i],
+			(unsigned long)rgStats[i].cFrames,
+			(unsigned long long)(rgStats[i].cFrames ? rgStats[i].qwTotalNs / rgStats[i].cFrames : 0u),
+			(unsigned long)rgStats[i].dwMaxNs);
+		HOST_TEST_CHECK(rgStats[i].cFrames == (i == STACK_HANDLER_OTHER ? 2u * dwRounds : dwRounds));
+		HOST_TEST_CHECK(rgStats[i].qwTotalNs != 0u && rgStats[i].dwMaxNs != 0u);
+		HOST_TEST_CHECK(rgStats[i].dwMaxNs <= rgStats[i].qwTotalNs);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	static char szTemp[] = "/tmp/pcaptestXXXXXX";
+	STACK_HANDLER_STATS rgLive[STACK_HANDLERS];
+	HOST_PCAP_STATS Replay;
+	DWORD dwRounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 50;
+	const char *szFile = argc > 2 ? argv[2] : NULL;
+	BYTE port;
+	DWORD i, cArp, cEcho;
+	int fd;
+
+	if(szFile == NULL)
+	{
+		if((fd = mkstemp(szTemp)) < 0)
+		{
+			perror(szTemp);
+			return 1;
+		}
+		close(fd);
+		szFile = szTemp;
+	}
+	printf("pcaptest: %lu rounds through %s\n", (unsigned long)dwRounds, szFile);
+
+	HostTestBegin();
+	port = HostTestPeerAttach();
+	if(!HOST_TEST_CHECK(port != HOST_MAC_INVALID_PORT) || !HOST_TEST_CHECK(HostPcapRecordStart(szFile)))
+		return HostTestEnd("pcaptest");
+	StackGetHandlerStats(rgLive, TRUE);
+
+	for(i = 0; i < dwRounds; i++)
+	{
+		SendArp(port);
+		HostTestTasks();
+		SendIcmpEcho(port, (WORD)i);
+		HostTestTasks();
+		SendTcpSyn(port, (WORD)(1024u + i));
+		HostTestTasks();
+		HostTestPeerSendUdp(port, PCAP_TEST_UDP_PORT, PCAP_TEST_UDP_PORT, _rgbFrame, 18);
+		HostTestTasks();
+		SendOther(port);
+		HostTestTasks();
+
+		// the stack must have answered the ARP request and the echo
+		for(cArp = cEcho = 0; HostMACReceive(port, _rgbFrame, sizeof(_rgbFrame)); )
+		{
+			if(_rgbFrame[12] == 0x08u && _rgbFrame[13] == 0x06u && _rgbFrame[21] == 2u)
+				cArp++;
+			else if(_rgbFrame[12] == 0x08u && _rgbFrame[13] == 0x00u && _rgbFrame[23] == IP_PROT_ICMP)
+				cEcho++;
+		}
+		HOST_TEST_CHECK(cArp == 1u && cEcho == 1u);
+		HostPcapRecordFlush();
+	}
+
+	HostPcapRecordStop();
+	HostMACDetach(port);
+	StackGetHandlerStats(rgLive, TRUE);
+	CheckHandlers("live", rgLive, dwRounds);
+
+	if(HOST_TEST_CHECK(HostPcapReplay(szFile, FALSE, &Replay)))
+	{
+		HOST_TEST_CHECK(Replay.cFrames == 6u * dwRounds);
+		CheckHandlers("replay", Replay.rgHandler, dwRounds);
+	}
+
+	if(szFile == szTemp)
+		unlink(szTemp);
+	return HostTestEnd("pcaptest");
+}
@@ -0,0 +1,148 @@
+/************************************************************************/
+/*																		*/
+/*	rxstorm.c	--  The application loop under a flood of frames        */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Times each pass of a sketch's loop, EthernetPeriodicTasks() and		*/
+/*	all, first on a quiet link and then while the peer of hosttest.h	*/
+/*	keeps the stack's RX queue full of datagrams for a closed port,		*/
+/*	which the stack reads and drops, as it does a broadcast storm.		*/
+/*	The slowest passes are how long the application is kept waiting;	*/
+/*	the 99.9th percentile is given with the longest, which on a PC is	*/
+/*	mostly the scheduler's doing.										*/
+/*																		*/
+/*		rxstorm [-t seconds]											*/
+/*																		*/
+/*	The Makefile builds it with the stack's defaults, which handle		*/
+/*	every queued frame in one call; as rxstorm_budget with				*/
+/*	STACK_RX_FRAME_BUDGET; and as rxstorm_int with the budget and		*/
+/*	STACK_USE_RX_INTERRUPT, where HostMAC.c signals each frame it		*/
+/*	queues as the PIC32 MAC's RX interrupt does.						*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define STORM_PORT				(9300u)		// nothing listens on it
+#define STORM_PAYLOAD			(18u)		// a minimum size frame
+#define STORM_BUCKET_NS			(100u)		// pass time histogram
+#define STORM_BUCKETS			(1000u)
+
+static DWORD _dwSeconds = 1;
+
+static void Phase(const char *szName, BYTE port, BOOL bStorm)
+{
+	static const BYTE rgbPayload[STORM_PAYLOAD];
+	static BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+	static QWORD rgcPasses[STORM_BUCKETS];
+	STACK_RX_STATS Stats;
+	QWORD qwStartNs, qwEndNs, qwPassNs, qwMaxNs = 0, cPasses = 0, c;
+	WORD wLen, wDepth, i;
+
+	wLen = HostTestPeerUdpFrame(rgbFrame, STORM_PORT + 1, STORM_PORT, rgbPayload, sizeof(rgbPayload));
+	HostTestRunFor(10);
+	StackGetRxStats(&Stats, TRUE);
+	memset(rgcPasses, 0, sizeof(rgcPasses));
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while((qwPassNs = HostTestNowNs()) < qwEndNs)
+	{
+		if(bStorm)
+		{
+			while(MACGetFreeRxSize() >= HOST_MAC_FRAME_SIZE)
+				HostMACSend(port, rgbFrame, wLen);
+		}
+
+		HostTestTasks();
+
+		qwPassNs = HostTestNowNs() - qwPassNs;
+		if(qwPassNs > qwMaxNs)
+			qwMaxNs = qwPassNs;
+		rgcPasses[qwPassNs / STORM_BUCKET_NS < STORM_BUCKETS ? qwPassNs / STORM_BUCKET_NS : STORM_BUCKETS - 1]++;
+		cPasses++;
+	}
+	qwEndNs = HostTestNowNs();
+	StackGetRxStats(&Stats, FALSE);
+
+	for(i = 0, c = 0; i < STORM_BUCKETS - 1u && (c += rgcPasses[i]) < cPasses - cPasses / 1000u; i++);
+	wDepth = Stats.wMinFreeRx == 0xFFFFu ? 0 : HOST_MAC_QUEUE_FRAMES - Stats.wMinFreeRx / HOST_MAC_FRAME_SIZE;
+
+	printf("  %-6s %.0f passes/s, 99.9%% under %.1f us, longest %.1f us\n",
+		szName, cPasses * 1e9 / (qwEndNs - qwStartNs), (i + 1u) * STORM_BUCKET_NS / 1e3, qwMaxNs / 1e3);
+	printf("         %.0f frames/s, most %u in a call, queue %u deep\n",
+		Stats.dwFrames * 1e9 / (qwEndNs - qwStartNs), Stats.wMaxBurst, wDepth);
+	printf("         %lu calls, %lu frame budget hits, %lu time budget hits, %lu left the MAC alone\n",
+		(unsigned long)Stats.dwCalls, (unsigned long)Stats.dwFrameBudgetHits,
+		(unsigned long)Stats.dwTimeBudgetHits, (unsigned long)Stats.dwIdleCalls);
+
+	if(STACK_RX_FRAME_BUDGET != 0u)
+		HOST_TEST_CHECK(Stats.wMaxBurst <= STACK_RX_FRAME_BUDGET);
+	if(bStorm)
+	{
+		HOST_TEST_CHECK(Stats.dwFrames != 0u);
+	}
+	else
+	{
+		#if defined(STACK_USE_RX_INTERRUPT)
+		HOST_TEST_CHECK(Stats.dwIdleCalls != 0u);
+		#endif
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	BYTE port;
+	int i;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			_dwSeconds = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-t seconds]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	#if defined(STACK_USE_RX_INTERRUPT)
+	printf("rxstorm: STACK_RX_FRAME_BUDGET %u, STACK_USE_RX_INTERRUPT\n", STACK_RX_FRAME_BUDGET);
+	#else
+	printf("rxstorm: STACK_RX_FRAME_BUDGET %u\n", STACK_RX_FRAME_BUDGET);
+	#endif
+
+	HostTestBegin();
+	port = HostTestPeerAttach();
+	if(!HOST_TEST_CHECK(port != HOST_MAC_INVALID_PORT))
+		return HostTestEnd("rxstorm");
+
+	Phase("quiet", port, FALSE);
+	Phase("storm", port, TRUE);
+
+	HostMACDetach(port);
+	return HostTestEnd("rxstorm");
+}
@@ -0,0 +1,155 @@
+/************************************************************************/
+/*																		*/
+/*	tcpcork.c	--  Segments per message with writev and cork           */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	A loopback client sends requests of a header, a payload and a		*/
+/*	trailer, and the server answers each with a short reply.  The		*/
+/*	request is written three ways: each part with TCPPutArray() and		*/
+/*	TCPFlush(), as TcpClient::writeStream() does; all of them with one	*/
+/*	TCPPutArrayV(); and each part flushed while the socket is corked	*/
+/*	with TCPSetCork(), as TcpClient::writeStreamV() does.  The TCP		*/
+/*	segments per exchange, both ways, come from StackGetHandlerStats();	*/
+/*	the gathered writes must send fewer of them.						*/
+/*																		*/
+/*		tcpcork [-t seconds]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define CORK_PORT				(9800u)
+#define CORK_HEADER_SIZE		(32u)
+#define CORK_PAYLOAD_SIZE		(256u)
+#define CORK_TRAILER_SIZE		(16u)
+#define CORK_REQUEST_SIZE		(CORK_HEADER_SIZE + CORK_PAYLOAD_SIZE + CORK_TRAILER_SIZE)
+#define CORK_REPLY_SIZE			(8u)
+
+static BYTE _rgbHeader[CORK_HEADER_SIZE];
+static BYTE _rgbPayload[CORK_PAYLOAD_SIZE];
+static BYTE _rgbTrailer[CORK_TRAILER_SIZE];
+static DWORD _dwSeconds = 1;
+
+static void WriteFlushed(TCP_SOCKET hTCP)
+{
+	TCPPutArray(hTCP, _rgbHeader, sizeof(_rgbHeader));
+	TCPFlush(hTCP);
+	TCPPutArray(hTCP, _rgbPayload, sizeof(_rgbPayload));
+	TCPFlush(hTCP);
+	TCPPutArray(hTCP, _rgbTrailer, sizeof(_rgbTrailer));
+	TCPFlush(hTCP);
+}
+
+static void WriteV(TCP_SOCKET hTCP)
+{
+	TCP_IOVEC rgiov[3] = {{_rgbHeader, sizeof(_rgbHeader)}, {_rgbPayload, sizeof(_rgbPayload)},
+							{_rgbTrailer, sizeof(_rgbTrailer)}};
+
+	TCPPutArrayV(hTCP, rgiov, 3);
+	TCPFlush(hTCP);
+}
+
+static void WriteCorked(TCP_SOCKET hTCP)
+{
+	TCPSetCork(hTCP, TRUE);
+	WriteFlushed(hTCP);
+	TCPSetCork(hTCP, FALSE);
+}
+
+// Segments per exchange
+static double Run(const char *szName, WORD wPort, void (*pfnWrite)(TCP_SOCKET))
+{
+	static BYTE rgbBuff[CORK_REQUEST_SIZE];
+	STACK_HANDLER_STATS rgStats[STACK_HANDLERS];
+	TCP_SOCKET hClient, hServer;
+	QWORD qwStartNs, qwEndNs, cExchanges = 0;
+	double dSegments;
+
+	if(!HOST_TEST_CHECK(HostTestConnect(wPort, &hClient, &hServer)))
+		return 0;
+	HostTestRunFor(5);
+	StackGetHandlerStats(rgStats, TRUE);
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs)
+	{
+		pfnWrite(hClient);
+		while(TCPIsGetReady(hServer) < CORK_REQUEST_SIZE)
+			HostTestTasks();
+		TCPGetArray(hServer, rgbBuff, CORK_REQUEST_SIZE);
+		HOST_TEST_CHECK(memcmp(rgbBuff + CORK_HEADER_SIZE, _rgbPayload, CORK_PAYLOAD_SIZE) == 0);
+
+		TCPPutArray(hServer, rgbBuff, CORK_REPLY_SIZE);
+		TCPFlush(hServer);
+		while(TCPIsGetReady(hClient) < CORK_REPLY_SIZE)
+			HostTestTasks();
+		TCPGetArray(hClient, rgbBuff, CORK_REPLY_SIZE);
+		cExchanges++;
+	}
+	qwEndNs = HostTestNowNs();
+	StackGetHandlerStats(rgStats, TRUE);
+
+	dSegments = (double)rgStats[STACK_HANDLER_TCP].cFrames / cExchanges;
+	printf("  %-8s %.2f segments an exchange, %.0f exchanges/s, %.2f MB/s of requests\n", szName, dSegments,
+		cExchanges * 1e9 / (qwEndNs - qwStartNs), cExchanges * CORK_REQUEST_SIZE * 1e3 / (qwEndNs - qwStartNs));
+
+	HostTestClose(hClient, hServer);
+	return dSegments;
+}
+
+int main(int argc, char *argv[])
+{
+	double dFlushed, dWriteV, dCorked;
+	WORD i;
+	int j;
+
+	for(j = 1; j < argc; j++)
+	{
+		if(strcmp(argv[j], "-t") == 0 && j + 1 < argc)
+			_dwSeconds = atoi(argv[++j]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-t seconds]\n", argv[0]);
+			return 2;
+		}
+	}
+	printf("tcpcork: %u byte header, %u byte payload, %u byte trailer, %u byte reply\n",
+		CORK_HEADER_SIZE, CORK_PAYLOAD_SIZE, CORK_TRAILER_SIZE, CORK_REPLY_SIZE);
+
+	for(i = 0; i < sizeof(_rgbPayload); i++)
+		_rgbPayload[i] = (BYTE)i;
+
+	HostTestBegin();
+	dFlushed = Run("flushed", CORK_PORT, WriteFlushed);
+	dWriteV = Run("writev", CORK_PORT + 1, WriteV);
+	dCorked = Run("corked", CORK_PORT + 2, WriteCorked);
+
+	// the request goes in one segment instead of three
+	HOST_TEST_CHECK(dWriteV <= dFlushed - 1.5);
+	HOST_TEST_CHECK(dCorked <= dFlushed - 1.5);
+
+	return HostTestEnd("tcpcork");
+}
@@ -0,0 +1,161 @@
+/************************************************************************/
+/*																		*/
+/*	tcpdemux.c	--  Finding a segment's socket among 64                 */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Times TCPProcess() with StackGetHandlerStats() while more and more	*/
+/*	idle loopback connections hold the stack's 64 sockets.  The peer	*/
+/*	of hosttest.h sends RST segments to a port nothing listens on, the	*/
+/*	miss FindMatchingSocket() has to make sure of, and one connection	*/
+/*	exchanges 64 byte requests and echoes, the hit.  With the sockets	*/
+/*	chained on hash buckets neither should grow with the number of		*/
+/*	connections the way a scan of every socket does.					*/
+/*																		*/
+/*		tcpdemux [-n frames]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define DEMUX_RR_PORT			(9500u)
+#define DEMUX_IDLE_PORT			(9510u)		// and up, one per idle connection
+#define DEMUX_CLOSED_PORT		(9490u)		// nothing listens on it
+#define DEMUX_RR_SIZE			(64u)
+
+static DWORD _dwFrames = 20000;
+
+static STACK_HANDLER_STATS _rgStats[STACK_HANDLERS];
+
+// TCP handler time per frame since the last call, in ns
+static double HandlerNs(void)
+{
+	StackGetHandlerStats(_rgStats, TRUE);
+	if(!HOST_TEST_CHECK(_rgStats[STACK_HANDLER_TCP].cFrames != 0u))
+		return 0;
+	return (double)_rgStats[STACK_HANDLER_TCP].qwTotalNs / _rgStats[STACK_HANDLER_TCP].cFrames;
+}
+
+static double Misses(BYTE port)
+{
+	static BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+	DWORD i;
+	WORD wLen;
+
+	HostTestRunFor(5);
+	StackGetHandlerStats(_rgStats, TRUE);
+	for(i = 0; i < _dwFrames; i++)
+	{
+		// a new source port each time, so the segments spread over the buckets
+		wLen = HostTestPeerTcpFrame(rgbFrame, (WORD)(1024u + i % 60000u), DEMUX_CLOSED_PORT, i, 0, HOST_TEST_TCP_RST, NULL, 0);
+		if(!HostMACSend(port, rgbFrame, wLen))
+		{
+			HostTestTasks();
+			HostMACSend(port, rgbFrame, wLen);
+		}
+	}
+	HostTestTasks();
+
+	return HandlerNs();
+}
+
+static double Hits(TCP_SOCKET hClient, TCP_SOCKET hServer)
+{
+	static BYTE rgbBuff[DEMUX_RR_SIZE];
+	DWORD i;
+	WORD w;
+
+	HostTestRunFor(5);
+	StackGetHandlerStats(_rgStats, TRUE);
+	for(i = 0; i < _dwFrames / 4u; i++)
+	{
+		TCPPutArray(hClient, rgbBuff, sizeof(rgbBuff));
+		TCPFlush(hClient);
+		while(TCPIsGetReady(hServer) < sizeof(rgbBuff))
+			HostTestTasks();
+		TCPGetArray(hServer, rgbBuff, sizeof(rgbBuff));
+		TCPPutArray(hServer, rgbBuff, sizeof(rgbBuff));
+		TCPFlush(hServer);
+		for(w = 0; w < sizeof(rgbBuff); )
+		{
+			HostTestTasks();
+			w += TCPGetArray(hClient, rgbBuff, sizeof(rgbBuff) - w);
+		}
+	}
+
+	return HandlerNs();
+}
+
+int main(int argc, char *argv[])
+{
+	static const WORD rgwIdle[] = {0, 8, 16, HOST_TCP_SOCKETS / 2 - 1};
+	static TCP_SOCKET rghClient[HOST_TCP_SOCKETS / 2], rghServer[HOST_TCP_SOCKETS / 2];
+	TCP_SOCKET hClient, hServer;
+	double rgMiss[sizeof(rgwIdle) / sizeof(rgwIdle[0])], rgHit[sizeof(rgMiss) / sizeof(rgMiss[0])];
+	BYTE port;
+	WORD cIdle, i;
+	int j;
+
+	for(j = 1; j < argc; j++)
+	{
+		if(strcmp(argv[j], "-n") == 0 && j + 1 < argc)
+			_dwFrames = strtoul(argv[++j], NULL, 0);
+		else
+		{
+			fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+			return 2;
+		}
+	}
+	printf("tcpdemux: %u sockets, %lu frames a run\n", HOST_TCP_SOCKETS, (unsigned long)_dwFrames);
+
+	HostTestBegin();
+	port = HostTestPeerAttach();
+	if(!HOST_TEST_CHECK(port != HOST_MAC_INVALID_PORT) ||
+		!HOST_TEST_CHECK(HostTestConnect(DEMUX_RR_PORT, &hClient, &hServer)))
+		return HostTestEnd("tcpdemux");
+
+	for(i = 0, cIdle = 0; i < sizeof(rgwIdle) / sizeof(rgwIdle[0]); i++)
+	{
+		for(; cIdle < rgwIdle[i]; cIdle++)
+		{
+			if(!HOST_TEST_CHECK(HostTestConnect(DEMUX_IDLE_PORT + cIdle, &rghClient[cIdle], &rghServer[cIdle])))
+				return HostTestEnd("tcpdemux");
+		}
+
+		rgMiss[i] = Misses(port);
+		rgHit[i] = Hits(hClient, hServer);
+		printf("  %2u idle connections, %2u sockets in use: miss %6.0f ns, hit %6.0f ns\n",
+			cIdle, 2u * cIdle + 2u, rgMiss[i], rgHit[i]);
+	}
+
+	// loose, a PC's timings wander; a scan of 64 sockets is well past it
+	HOST_TEST_CHECK(rgMiss[i - 1] < 2.0 * rgMiss[0]);
+	HOST_TEST_CHECK(rgHit[i - 1] < 2.0 * rgHit[0]);
+
+	for(i = 0; i < cIdle; i++)
+		HostTestClose(rghClient[i], rghServer[i]);
+	HostTestClose(hClient, hServer);
+	HostMACDetach(port);
+	return HostTestEnd("tcpdemux");
+}
@@ -0,0 +1,130 @@
+/************************************************************************/
+/*																		*/
+/*	tcpdma.c	--  TCP checksums from the ENCX24J600 DMA engine        */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Built with HOST_ENCX24J600 and the sockets in TCP_ETH_RAM, so		*/
+/*	SendTCP() has the modeled DMA engine copy and sum each payload		*/
+/*	(MAC_COPY_CHECKSUM) and adds the headers to the engine's sum.		*/
+/*	Random writes and reads move a counting pattern both ways over a	*/
+/*	loopback connection whose odd sized FIFOs make payloads wrap, in	*/
+/*	two pieces, at odd and even offsets.  HostMAC.c sums every frame	*/
+/*	over again in software: none may differ, and some must have been	*/
+/*	split.  A wrong sum loses the same segment every time it is sent,	*/
+/*	and with both FIFOs full the two sockets end up answering each		*/
+/*	other's ACKs; STACK_RX_FRAME_BUDGET keeps StackTask() returning		*/
+/*	then, so a broken build fails instead of hanging.					*/
+/*																		*/
+/*		tcpdma [bytes [seed]]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define TCP_DMA_PORT			(9320u)
+
+#if !defined(HOST_ENCX24J600) || !defined(MAC_COPY_CHECKSUM)
+	#error tcpdma needs HOST_ENCX24J600
+#endif
+
+static DWORD _dwRandom;
+
+static DWORD Random(void)
+{
+	// xorshift32, so a failing seed can be run again
+	_dwRandom ^= _dwRandom << 13;
+	_dwRandom ^= _dwRandom >> 17;
+	_dwRandom ^= _dwRandom << 5;
+	return _dwRandom;
+}
+
+// Sends dwBytes from hFrom to hTo in random pieces, FALSE if a byte was wrong or it stalled
+static BOOL Move(TCP_SOCKET hFrom, TCP_SOCKET hTo, DWORD dwBytes)
+{
+	BYTE rgbBuff[HOST_TCP_FIFO_SIZE];
+	DWORD dwSent = 0, dwReceived = 0;
+	QWORD qwEndNs = HostTestNowNs() + 10000000000ull;
+	WORD w, i;
+
+	while(dwReceived < dwBytes && HostTestNowNs() < qwEndNs)
+	{
+		w = TCPIsPutReady(hFrom);
+		if(w)
+			w = 1 + Random() % w;
+		if(w > dwBytes - dwSent)
+			w = dwBytes - dwSent;
+		for(i = 0; i < w; i++)
+			rgbBuff[i] = (BYTE)(dwSent + i);
+		dwSent += TCPPutArray(hFrom, rgbBuff, w);
+		if(w && Random() % 2u)
+			TCPFlush(hFrom);
+
+		HostTestTasks();
+
+		w = TCPGetArray(hTo, rgbBuff, 1 + Random() % sizeof(rgbBuff));
+		for(i = 0; i < w; i++)
+		{
+			if(rgbBuff[i] != (BYTE)(dwReceived + i))
+				return FALSE;
+		}
+		dwReceived += w;
+	}
+
+	return dwReceived == dwBytes;
+}
+
+int main(int argc, char *argv[])
+{
+	DWORD dwBytes = argc > 1 ? strtoul(argv[1], NULL, 0) : 200000;
+	TCP_SOCKET hClient, hServer;
+	HOST_MAC_DMA_STATS Stats;
+
+	_dwRandom = argc > 2 ? strtoul(argv[2], NULL, 0) : 0x2012u;
+	printf("tcpdma: %lu bytes each way, seed 0x%lX, %u byte FIFOs\n", (unsigned long)dwBytes,
+		(unsigned long)_dwRandom, HOST_TCP_FIFO_SIZE);
+
+	HostTestBegin();
+	HostMACGetDmaStats(&Stats, TRUE);
+	if(HOST_TEST_CHECK(HostTestConnect(TCP_DMA_PORT, &hClient, &hServer)))
+	{
+		HOST_TEST_CHECK(Move(hClient, hServer, dwBytes));
+		HOST_TEST_CHECK(Move(hServer, hClient, dwBytes));
+		HostTestClose(hClient, hServer);
+	}
+
+	HostMACGetDmaStats(&Stats, FALSE);
+	printf("  %lu frames, %lu TCP and UDP summed again, %lu split, %lu wrong\n",
+		(unsigned long)Stats.cFrames, (unsigned long)Stats.cSummedFrames,
+		(unsigned long)Stats.cSplitFrames, (unsigned long)Stats.cBadChecksums);
+	printf("  %lu copies, %lu checksums, waited %llu us of %llu us the engine was busy\n",
+		(unsigned long)Stats.cCopies, (unsigned long)Stats.cChecksums,
+		(unsigned long long)(Stats.qwWaitNs / 1000u), (unsigned long long)(Stats.qwBusyNs / 1000u));
+
+	HOST_TEST_CHECK(Stats.cSummedFrames != 0u);
+	HOST_TEST_CHECK(Stats.cSplitFrames != 0u);
+	HOST_TEST_CHECK(Stats.cBadChecksums == 0u);
+
+	return HostTestEnd("tcpdma");
+}
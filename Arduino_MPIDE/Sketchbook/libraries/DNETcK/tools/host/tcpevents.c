@@ -0,0 +1,216 @@
+/************************************************************************/
+/*																		*/
+/*	tcpevents.c	--  A 20 client echo server, polled and event driven    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	20 loopback clients send 64 byte messages to an echo server and		*/
+/*	wait for each one to come back.  The server is written twice: as	*/
+/*	the polling examples are, asking every one of its sockets for data	*/
+/*	on every pass, and with a TCPSetEventHandler() handler on each		*/
+/*	socket, run by TCPDispatchEvents() only for the sockets that got	*/
+/*	data.  The time the server's code takes, and the time of the whole	*/
+/*	loop with the stack's, is given per byte echoed, with the number	*/
+/*	of times the server looked at a socket with nothing for it.  Only	*/
+/*	a few clients talk at once, as on a board whose clients mostly		*/
+/*	wait; -a sets how many.  The echoes must all arrive intact.			*/
+/*																		*/
+/*		tcpevents [-t seconds] [-a active clients]						*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define EVENTS_PORT				(9900u)		// and up, one per client
+#define EVENTS_CLIENTS			(20u)
+#define EVENTS_MESSAGE_SIZE		(64u)
+
+typedef struct
+{
+	QWORD	cBytes;				// echoed
+	QWORD	cLooks;				// sockets the server looked at
+	QWORD	cEmptyLooks;		// of them, ones with nothing to echo
+	QWORD	qwServerNs;
+} EVENTS_STATS;
+
+static TCP_SOCKET _rghClient[EVENTS_CLIENTS], _rghServer[EVENTS_CLIENTS];
+static WORD _rgwOutstanding[EVENTS_CLIENTS];	// bytes a client waits for
+static BYTE _rgbMessage[EVENTS_MESSAGE_SIZE];
+static DWORD _dwSeconds = 1;
+static WORD _cActive = 4;
+static EVENTS_STATS _Stats;
+
+// Echoes what it can, the server's work for one socket
+static void Echo(TCP_SOCKET hTCP)
+{
+	BYTE rgbBuff[EVENTS_MESSAGE_SIZE * 4];
+	WORD w, wPut;
+
+	_Stats.cLooks++;
+	w = TCPIsGetReady(hTCP);
+	if(w == 0u)
+	{
+		_Stats.cEmptyLooks++;
+		return;
+	}
+
+	wPut = TCPIsPutReady(hTCP);
+	if(w > wPut)
+		w = wPut;
+	if(w > sizeof(rgbBuff))
+		w = sizeof(rgbBuff);
+	w = TCPGetArray(hTCP, rgbBuff, w);
+	TCPPutArray(hTCP, rgbBuff, w);
+	TCPFlush(hTCP);
+	_Stats.cBytes += w;
+}
+
+static void ServePolled(void)
+{
+	WORD i;
+
+	for(i = 0; i < EVENTS_CLIENTS; i++)
+		Echo(_rghServer[i]);
+}
+
+static void EventHandler(TCP_SOCKET hTCP, BYTE vEvents, void *pContext)
+{
+	if(vEvents & (TCP_EVENT_RX | TCP_EVENT_TX))
+		Echo(hTCP);
+}
+
+static void ServeEvents(void)
+{
+	TCPDispatchEvents();
+}
+
+// The active clients send a message when the last one is back
+static BOOL Clients(void)
+{
+	BYTE rgbBuff[EVENTS_MESSAGE_SIZE];
+	BOOL bIntact = TRUE;
+	WORD i, w;
+
+	for(i = 0; i < _cActive; i++)
+	{
+		while(_rgwOutstanding[i] != 0u && (w = TCPGetArray(_rghClient[i], rgbBuff,
+			EVENTS_MESSAGE_SIZE - (EVENTS_MESSAGE_SIZE - _rgwOutstanding[i]) % EVENTS_MESSAGE_SIZE)) != 0u)
+		{
+			bIntact &= memcmp(rgbBuff, _rgbMessage + EVENTS_MESSAGE_SIZE - _rgwOutstanding[i], w) == 0;
+			_rgwOutstanding[i] -= w;
+		}
+
+		if(_rgwOutstanding[i] == 0u && TCPIsPutReady(_rghClient[i]) >= EVENTS_MESSAGE_SIZE)
+		{
+			TCPPutArray(_rghClient[i], _rgbMessage, EVENTS_MESSAGE_SIZE);
+			TCPFlush(_rghClient[i]);
+			_rgwOutstanding[i] = EVENTS_MESSAGE_SIZE;
+		}
+	}
+
+	return bIntact;
+}
+
+static void Run(const char *szName, void (*pfnServe)(void), EVENTS_STATS *pStats)
+{
+	QWORD qwStartNs, qwEndNs, qwServeNs;
+	BOOL bIntact = TRUE;
+
+	memset(&_Stats, 0, sizeof(_Stats));
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs)
+	{
+		bIntact &= Clients();
+		HostTestTasks();
+
+		qwServeNs = HostTestNowNs();
+		pfnServe();
+		_Stats.qwServerNs += HostTestNowNs() - qwServeNs;
+	}
+	qwEndNs = HostTestNowNs();
+
+	// let the last echoes come back, so the next run starts even
+	while(HostTestNowNs() < qwEndNs + 50000000ull)
+	{
+		HostTestTasks();
+		pfnServe();
+		bIntact &= Clients();
+	}
+
+	*pStats = _Stats;
+	printf("  %-7s %.2f MB/s echoed, server %.2f ns a byte, loop %.2f ns a byte, %llu of %llu looks empty\n",
+		szName, pStats->cBytes * 1e3 / (qwEndNs - qwStartNs), (double)pStats->qwServerNs / pStats->cBytes,
+		(double)(qwEndNs - qwStartNs) / pStats->cBytes,
+		(unsigned long long)pStats->cEmptyLooks, (unsigned long long)pStats->cLooks);
+	HOST_TEST_CHECK(bIntact);
+	HOST_TEST_CHECK(pStats->cBytes != 0u);
+}
+
+int main(int argc, char *argv[])
+{
+	EVENTS_STATS Polled, Events;
+	WORD i;
+	int j;
+
+	for(j = 1; j < argc; j++)
+	{
+		if(strcmp(argv[j], "-t") == 0 && j + 1 < argc)
+			_dwSeconds = atoi(argv[++j]);
+		else if(strcmp(argv[j], "-a") == 0 && j + 1 < argc)
+			_cActive = atoi(argv[++j]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-t seconds] [-a active clients]\n", argv[0]);
+			return 2;
+		}
+	}
+	if(_cActive > EVENTS_CLIENTS)
+		_cActive = EVENTS_CLIENTS;
+	printf("tcpevents: %u clients, %u of them active, %u byte messages\n", EVENTS_CLIENTS, _cActive, EVENTS_MESSAGE_SIZE);
+
+	for(i = 0; i < sizeof(_rgbMessage); i++)
+		_rgbMessage[i] = (BYTE)('a' + i % 26u);
+
+	HostTestBegin();
+	for(i = 0; i < EVENTS_CLIENTS; i++)
+	{
+		if(!HOST_TEST_CHECK(HostTestConnect(EVENTS_PORT + i, &_rghClient[i], &_rghServer[i])))
+			return HostTestEnd("tcpevents");
+	}
+
+	Run("polled", ServePolled, &Polled);
+
+	for(i = 0; i < EVENTS_CLIENTS; i++)
+		TCPSetEventHandler(_rghServer[i], EventHandler, NULL);
+	Run("events", ServeEvents, &Events);
+
+	// the handlers are only run for sockets that had something
+	HOST_TEST_CHECK(Events.cEmptyLooks < Events.cLooks / 2u);
+	HOST_TEST_CHECK(Events.cEmptyLooks < Polled.cEmptyLooks);
+
+	for(i = 0; i < EVENTS_CLIENTS; i++)
+		HostTestClose(_rghClient[i], _rghServer[i]);
+	return HostTestEnd("tcpevents");
+}
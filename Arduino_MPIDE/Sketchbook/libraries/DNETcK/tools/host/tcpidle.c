@@ -0,0 +1,115 @@
+/************************************************************************/
+/*																		*/
+/*	tcpidle.c	--  StackTask() with 64 idle sockets                    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Times StackTask() on a quiet link with no sockets open, then with	*/
+/*	all 64 of them in idle loopback connections.  TCPTick() only looks	*/
+/*	at the sockets that were woken or whose timers are due, so the		*/
+/*	idle ones should cost next to nothing.  The Makefile also builds	*/
+/*	it as tcpidle_scan with TCP_FULL_SCAN_INTERVAL 0, which makes		*/
+/*	every call look at every socket, as TCPTick() used to.				*/
+/*																		*/
+/*		tcpidle [-t seconds]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define IDLE_PORT				(9600u)		// and up, one per connection
+
+static DWORD _dwSeconds = 1;
+
+// Average StackTask() time, in ns
+static double Phase(const char *szName)
+{
+	QWORD qwStartNs, qwEndNs, qwTaskNs = 0, qwMaxNs = 0, qwPassNs, cPasses = 0;
+
+	HostTestRunFor(10);
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while((qwPassNs = HostTestNowNs()) < qwEndNs)
+	{
+		StackTask();
+		qwPassNs = HostTestNowNs() - qwPassNs;
+		qwTaskNs += qwPassNs;
+		if(qwPassNs > qwMaxNs)
+			qwMaxNs = qwPassNs;
+		cPasses++;
+	}
+
+	printf("  %-9s %llu passes, %.0f ns each, longest %.1f us\n",
+		szName, (unsigned long long)cPasses, (double)qwTaskNs / cPasses, qwMaxNs / 1e3);
+	return (double)qwTaskNs / cPasses;
+}
+
+int main(int argc, char *argv[])
+{
+	static TCP_SOCKET rghClient[HOST_TCP_SOCKETS / 2], rghServer[HOST_TCP_SOCKETS / 2];
+	double dNone, dIdle;
+	WORD i;
+	int j;
+
+	for(j = 1; j < argc; j++)
+	{
+		if(strcmp(argv[j], "-t") == 0 && j + 1 < argc)
+			_dwSeconds = atoi(argv[++j]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-t seconds]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	#if defined(TCP_FULL_SCAN_INTERVAL)
+	printf("tcpidle: %u sockets, TCP_FULL_SCAN_INTERVAL %lu\n", HOST_TCP_SOCKETS, (unsigned long)TCP_FULL_SCAN_INTERVAL);
+	#else
+	printf("tcpidle: %u sockets\n", HOST_TCP_SOCKETS);
+	#endif
+
+	HostTestBegin();
+	dNone = Phase("none open");
+
+	for(i = 0; i < HOST_TCP_SOCKETS / 2; i++)
+	{
+		if(!HOST_TEST_CHECK(HostTestConnect(IDLE_PORT + i, &rghClient[i], &rghServer[i])))
+			return HostTestEnd("tcpidle");
+	}
+	dIdle = Phase("64 idle");
+	printf("  the idle sockets cost %.0f ns a call\n", dIdle - dNone);
+
+	// loose, a PC's timings wander; looking at 64 sockets a call is well past it
+	#if !defined(TCP_FULL_SCAN_INTERVAL)
+	HOST_TEST_CHECK(dIdle < 2.0 * dNone);
+	#endif
+
+	for(i = 0; i < HOST_TCP_SOCKETS / 2; i++)
+	{
+		HOST_TEST_CHECK(TCPIsConnected(rghClient[i]) && TCPIsConnected(rghServer[i]));
+		HostTestClose(rghClient[i], rghServer[i]);
+	}
+	return HostTestEnd("tcpidle");
+}
@@ -0,0 +1,95 @@
+/************************************************************************/
+/*																		*/
+/*	tcploop.c	--  TCP loopback test of the host build                 */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Moves TCP_LOOP_BYTES of a counting pattern from a client socket		*/
+/*	to a server socket and back, and checks every byte.  The virtual	*/
+/*	MAC's RX queue is far over 32 KB, which used to close the window	*/
+/*	TCP.c advertises.  As tcploop_eth the sockets' FIFOs are in the	*/
+/*	MAC's memory, where TCP.c copies what wraps around them with		*/
+/*	MACMemCopyAsync().													*/
+/*																		*/
+/************************************************************************/
+
+#include "hosttest.h"
+
+#define TCP_LOOP_PORT			(9300u)
+#define TCP_LOOP_BYTES			(1000000ul)
+
+// Sends TCP_LOOP_BYTES from hFrom to hTo, FALSE if a byte was wrong or it stalled
+static BOOL Move(TCP_SOCKET hFrom, TCP_SOCKET hTo)
+{
+	BYTE rgbBuff[1460];
+	DWORD dwSent = 0, dwReceived = 0;
+	QWORD qwEndNs = HostTestNowNs() + 5000000000ull;
+	WORD w, i;
+
+	while(dwReceived < TCP_LOOP_BYTES && HostTestNowNs() < qwEndNs)
+	{
+		w = TCPIsPutReady(hFrom);
+		if(w > sizeof(rgbBuff))
+			w = sizeof(rgbBuff);
+		if(w > TCP_LOOP_BYTES - dwSent)
+			w = TCP_LOOP_BYTES - dwSent;
+		for(i = 0; i < w; i++)
+			rgbBuff[i] = (BYTE)(dwSent + i);
+		dwSent += TCPPutArray(hFrom, rgbBuff, w);
+		if(dwSent == TCP_LOOP_BYTES)
+			TCPFlush(hFrom);
+
+		HostTestTasks();
+
+		w = TCPGetArray(hTo, rgbBuff, sizeof(rgbBuff));
+		for(i = 0; i < w; i++)
+		{
+			if(rgbBuff[i] != (BYTE)(dwReceived + i))
+				return FALSE;
+		}
+		dwReceived += w;
+	}
+
+	return dwReceived == TCP_LOOP_BYTES;
+}
+
+int main(void)
+{
+	TCP_SOCKET hClient, hServer;
+
+	HostTestBegin();
+
+	if(HOST_TEST_CHECK(HostTestConnect(TCP_LOOP_PORT, &hClient, &hServer)))
+	{
+		HOST_TEST_CHECK(MACGetFreeRxSize() > 0x8000u);
+		HOST_TEST_CHECK(Move(hClient, hServer));
+		HOST_TEST_CHECK(Move(hServer, hClient));
+
+		TCPDisconnect(hClient);
+		HostTestRunFor(100);
+		HOST_TEST_CHECK(!TCPIsConnected(hServer));
+		TCPClose(hClient);
+		TCPClose(hServer);
+	}
+
+	return HostTestEnd("tcploop");
+}
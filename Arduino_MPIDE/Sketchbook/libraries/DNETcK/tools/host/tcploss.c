@@ -0,0 +1,198 @@
+/************************************************************************/
+/*																		*/
+/*	tcploss.c	--  TCP over a lossy link                               */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Moves TCP_LOSS_BYTES over a loopback connection on a clean link,	*/
+/*	then with HostMACSetLoss() losing every TCP_LOSS_EVERY-th frame		*/
+/*	in either direction.  Three duplicate ACKs must resend a lost		*/
+/*	segment long before the retransmission timer would, so the lossy	*/
+/*	transfer has to finish in a fraction of the time one timeout per	*/
+/*	lost frame would take.  Then the link goes dead with data in		*/
+/*	flight: the timer must start from the measured RTO and double on	*/
+/*	each retransmission, and the transfer must finish once the link		*/
+/*	is back.															*/
+/*																		*/
+/*		tcploss [every]													*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define TCP_LOSS_PORT			(9310u)
+#define TCP_LOSS_BYTES			(1000000ul)
+#define TCP_LOSS_EVERY			(49u)		// odd, or only the ACKs of a steady stream are lost
+#define TCP_LOSS_DEAD_MS		(1500u)		// three retransmissions from a 200 ms RTO
+#define TCP_LOSS_RETRANSMITS	(4u)
+
+static DWORD _dwSent, _dwReceived;
+static BOOL _fCorrupt;
+
+// Writes what hFrom has room for and reads what hTo got, checking every byte
+static void Pump(TCP_SOCKET hFrom, TCP_SOCKET hTo, DWORD dwBytes)
+{
+	BYTE rgbBuff[1460];
+	WORD w, i;
+
+	w = TCPIsPutReady(hFrom);
+	if(w > sizeof(rgbBuff))
+		w = sizeof(rgbBuff);
+	if(w > dwBytes - _dwSent)
+		w = dwBytes - _dwSent;
+	for(i = 0; i < w; i++)
+		rgbBuff[i] = (BYTE)(_dwSent + i);
+	_dwSent += TCPPutArray(hFrom, rgbBuff, w);
+	if(w != 0u && _dwSent == dwBytes)
+		TCPFlush(hFrom);
+
+	HostTestTasks();
+
+	w = TCPGetArray(hTo, rgbBuff, sizeof(rgbBuff));
+	for(i = 0; i < w; i++)
+	{
+		if(rgbBuff[i] != (BYTE)(_dwReceived + i))
+			_fCorrupt = TRUE;
+	}
+	_dwReceived += w;
+}
+
+// Sends dwBytes from hFrom to hTo, returns how many ms it took, 0 if it failed
+static DWORD Move(TCP_SOCKET hFrom, TCP_SOCKET hTo, DWORD dwBytes)
+{
+	QWORD qwStartNs = HostTestNowNs(), qwEndNs = qwStartNs + 30000000000ull;
+
+	_dwSent = _dwReceived = 0;
+	_fCorrupt = FALSE;
+	while(_dwReceived < dwBytes && !_fCorrupt && HostTestNowNs() < qwEndNs)
+		Pump(hFrom, hTo, dwBytes);
+
+	if(_dwReceived != dwBytes || _fCorrupt)
+		return 0;
+	return (DWORD)((HostTestNowNs() - qwStartNs) / 1000000ull) + 1u;
+}
+
+static DWORD TicksToMs(DWORD dwTicks)
+{
+	return (DWORD)(dwTicks * 1000ull / TICK_SECOND);
+}
+
+// The link goes dead with data in flight, the retransmissions must back off
+static void Dead(TCP_SOCKET hClient, TCP_SOCKET hServer)
+{
+	QWORD rgqwRetransmitNs[TCP_LOSS_RETRANSMITS];
+	QWORD qwStartNs, qwEndNs;
+	WORD wRetransmits, cRetransmits = 0, i;
+	DWORD dwRTOMs;
+
+	wRetransmits = TCPGetSocketStats(hClient)->wRetransmits;
+	dwRTOMs = TicksToMs(TCPGetSocketStats(hClient)->dwRTO);
+
+	_dwSent = _dwReceived = 0;
+	_fCorrupt = FALSE;
+	HostMACSetLoss(HOST_MAC_STACK_PORT, 1);
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + TCP_LOSS_DEAD_MS * 1000000ull;
+	while(HostTestNowNs() < qwEndNs)
+	{
+		Pump(hClient, hServer, 4000u);
+		if(TCPGetSocketStats(hClient)->wRetransmits != wRetransmits && cRetransmits < TCP_LOSS_RETRANSMITS)
+		{
+			wRetransmits = TCPGetSocketStats(hClient)->wRetransmits;
+			rgqwRetransmitNs[cRetransmits++] = HostTestNowNs();
+		}
+	}
+	HostMACSetLoss(HOST_MAC_STACK_PORT, 0);
+
+	printf("  dead    %u ms: RTO %lu ms, retransmitted after", TCP_LOSS_DEAD_MS, (unsigned long)dwRTOMs);
+	for(i = 0; i < cRetransmits; i++)
+		printf(" %llu", (unsigned long long)((rgqwRetransmitNs[i] - qwStartNs) / 1000000ull));
+	printf(" ms\n");
+
+	// 200, 600 and 1400 ms with the 200 ms floor of a LAN's RTO
+	if(HOST_TEST_CHECK(cRetransmits == 3u))
+	{
+		HOST_TEST_CHECK((rgqwRetransmitNs[0] - qwStartNs) / 1000000ull + 20u >= dwRTOMs);
+		for(i = 1; i < cRetransmits; i++)
+		{
+			QWORD qwGap = rgqwRetransmitNs[i] - rgqwRetransmitNs[i - 1];
+			QWORD qwLastGap = i == 1u ? rgqwRetransmitNs[0] - qwStartNs : rgqwRetransmitNs[i - 1] - rgqwRetransmitNs[i - 2];
+
+			HOST_TEST_CHECK(qwGap * 10u >= qwLastGap * 17u && qwGap * 10u <= qwLastGap * 23u);
+		}
+	}
+
+	// the next retransmission gets through
+	qwEndNs = HostTestNowNs() + 5000000000ull;
+	while(_dwReceived < 4000u && !_fCorrupt && HostTestNowNs() < qwEndNs)
+		Pump(hClient, hServer, 4000u);
+	HOST_TEST_CHECK(_dwReceived == 4000u && !_fCorrupt);
+	HOST_TEST_CHECK(TCPIsConnected(hClient) && TCPIsConnected(hServer));
+}
+
+int main(int argc, char *argv[])
+{
+	DWORD dwEvery = argc > 1 ? strtoul(argv[1], NULL, 0) : TCP_LOSS_EVERY;
+	TCP_SOCKET hClient, hServer;
+	TCP_SOCKET_STATS Stats;
+	DWORD dwCleanMs, dwLossyMs, dwLost;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	printf("tcploss: %lu bytes, every %luth frame lost\n", TCP_LOSS_BYTES, (unsigned long)dwEvery);
+
+	HostTestBegin();
+	if(!HOST_TEST_CHECK(HostTestConnect(TCP_LOSS_PORT, &hClient, &hServer)))
+		return HostTestEnd("tcploss");
+
+	dwCleanMs = Move(hClient, hServer, TCP_LOSS_BYTES);
+	HOST_TEST_CHECK(dwCleanMs != 0u);
+	Stats = *TCPGetSocketStats(hClient);
+	printf("  clean   %lu ms, SRTT %lu ms, RTO %lu ms\n", (unsigned long)dwCleanMs,
+		(unsigned long)TicksToMs(Stats.dwSRTT), (unsigned long)TicksToMs(Stats.dwRTO));
+	HOST_TEST_CHECK(Stats.wRetransmits == 0u && Stats.wFastRetransmits == 0u);
+
+	dwLost = HostMACLost(HOST_MAC_STACK_PORT);
+	HostMACSetLoss(HOST_MAC_STACK_PORT, dwEvery);
+	dwLossyMs = Move(hClient, hServer, TCP_LOSS_BYTES);
+	HostMACSetLoss(HOST_MAC_STACK_PORT, 0);
+	dwLost = HostMACLost(HOST_MAC_STACK_PORT) - dwLost;
+	Stats = *TCPGetSocketStats(hClient);
+	printf("  lossy   %lu ms, %lu frames lost, %u fast retransmits, %u timeouts, RTO %lu ms\n",
+		(unsigned long)dwLossyMs, (unsigned long)dwLost, Stats.wFastRetransmits, Stats.wRetransmits,
+		(unsigned long)TicksToMs(Stats.dwRTO));
+	printf("          a %lu ms timeout for each would have taken %lu ms\n",
+		(unsigned long)TicksToMs(TICK_SECOND), (unsigned long)(dwLost * TicksToMs(TICK_SECOND)));
+
+	if(HOST_TEST_CHECK(dwLossyMs != 0u) && HOST_TEST_CHECK(dwLost != 0u))
+	{
+		HOST_TEST_CHECK(Stats.wFastRetransmits != 0u);
+		HOST_TEST_CHECK(Stats.wFastRetransmits >= Stats.wRetransmits);
+		HOST_TEST_CHECK(dwLossyMs * 4u < dwLost * TicksToMs(TICK_SECOND));
+	}
+
+	Dead(hClient, hServer);
+
+	HostTestClose(hClient, hServer);
+	return HostTestEnd("tcploss");
+}
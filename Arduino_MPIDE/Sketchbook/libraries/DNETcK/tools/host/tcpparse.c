@@ -0,0 +1,203 @@
+/************************************************************************/
+/*																		*/
+/*	tcpparse.c	--  Parsing in the RX FIFO against copying out of it    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	A loopback connection carries lines of text of random length, and	*/
+/*	the server side counts the lines and sums the bytes, a parser that	*/
+/*	only has to look at them.  It does so once with TCPGetArray() into	*/
+/*	a buffer, and once with TCPBorrowRx() and TCPConsume() on the FIFO	*/
+/*	itself.  Both must see every byte; the time the parser spends,		*/
+/*	reading included, is given per byte with the bytes it copied.  A	*/
+/*	PC's memcpy() is quick enough to hide in the noise, so the copies	*/
+/*	saved are the number to carry over to a board.  Built with			*/
+/*	HOST_TCP_MEDIUM=TCP_ETH_RAM, as tcpparse_eth, TCPBorrowRx() must	*/
+/*	decline and the parser falls back to copying.						*/
+/*																		*/
+/*		tcpparse [-n kilobytes]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define PARSE_PORT				(9700u)
+#define PARSE_TEXT_SIZE			(8192u)
+#define PARSE_COPY_SIZE			(256u)		// a typical sketch's buffer
+
+typedef struct
+{
+	QWORD	cBytes;
+	QWORD	cLines;
+	QWORD	cCopied;			// bytes copied out of the FIFO
+	DWORD	cMisplaced;			// pieces that did not start where they should
+	QWORD	qwNs;				// spent in the parser
+	DWORD	cBorrowed;			// calls TCPBorrowRx() gave data to
+} PARSE_STATE;
+
+static BYTE _rgbText[PARSE_TEXT_SIZE];
+static DWORD _dwKilobytes = 4096;
+
+// Counts the line ends with memchr(), as quick a look at the bytes as a
+// parser gets, so what it costs to copy them first shows.  Each piece's
+// first byte is checked against the text, which catches bytes lost or
+// repeated on the way.
+static void Scan(PARSE_STATE *pState, const BYTE *pData, WORD wLen)
+{
+	const BYTE *p = pData, *pEnd = pData + wLen;
+
+	if(wLen == 0u)
+		return;
+	while((p = memchr(p, '\n', pEnd - p)) != NULL)
+	{
+		pState->cLines++;
+		p++;
+	}
+	if(pData[0] != _rgbText[pState->cBytes % PARSE_TEXT_SIZE])
+		pState->cMisplaced++;
+	pState->cBytes += wLen;
+}
+
+static void ParseCopy(TCP_SOCKET hTCP, PARSE_STATE *pState)
+{
+	static BYTE rgbBuff[PARSE_COPY_SIZE];
+	WORD w;
+
+	while((w = TCPGetArray(hTCP, rgbBuff, sizeof(rgbBuff))) != 0u)
+	{
+		Scan(pState, rgbBuff, w);
+		pState->cCopied += w;
+	}
+}
+
+static void ParseBorrow(TCP_SOCKET hTCP, PARSE_STATE *pState)
+{
+	TCP_RX_SPANS spans;
+
+	if(TCPBorrowRx(hTCP, &spans) == 0u)
+	{
+		ParseCopy(hTCP, pState);
+		return;
+	}
+
+	Scan(pState, spans.pHead, spans.wHeadLen);
+	Scan(pState, spans.pWrap, spans.wWrapLen);
+	TCPConsume(hTCP, spans.wHeadLen + spans.wWrapLen);
+	pState->cBorrowed++;
+}
+
+static void Run(const char *szName, WORD wPort, void (*pfnParse)(TCP_SOCKET, PARSE_STATE*), const PARSE_STATE *pExpect)
+{
+	TCP_SOCKET hClient, hServer;
+	PARSE_STATE State;
+	QWORD qwTotal = (QWORD)_dwKilobytes * 1024u, qwSent = 0, qwStartNs;
+	WORD w, wOffset = 0;
+
+	if(!HOST_TEST_CHECK(HostTestConnect(wPort, &hClient, &hServer)))
+		return;
+
+	memset(&State, 0, sizeof(State));
+	while(State.cBytes < qwTotal)
+	{
+		w = TCPIsPutReady(hClient);
+		if(w > qwTotal - qwSent)
+			w = qwTotal - qwSent;
+		if(w > PARSE_TEXT_SIZE - wOffset)
+			w = PARSE_TEXT_SIZE - wOffset;
+		if(w != 0u)
+		{
+			w = TCPPutArray(hClient, _rgbText + wOffset, w);
+			wOffset = (wOffset + w) % PARSE_TEXT_SIZE;
+			qwSent += w;
+			TCPFlush(hClient);
+		}
+
+		HostTestTasks();
+
+		qwStartNs = HostTestNowNs();
+		pfnParse(hServer, &State);
+		State.qwNs += HostTestNowNs() - qwStartNs;
+	}
+
+	printf("  %-7s %llu lines, %.2f ns a byte, %llu bytes copied, %lu borrows\n", szName,
+		(unsigned long long)State.cLines, (double)State.qwNs / State.cBytes,
+		(unsigned long long)State.cCopied, (unsigned long)State.cBorrowed);
+	HOST_TEST_CHECK(State.cBytes == pExpect->cBytes);
+	HOST_TEST_CHECK(State.cLines == pExpect->cLines);
+	HOST_TEST_CHECK(State.cMisplaced == 0u);
+	if(pfnParse == ParseBorrow)
+	{
+		#if HOST_TCP_MEDIUM == TCP_PIC_RAM
+		HOST_TEST_CHECK(State.cBorrowed != 0u && State.cCopied == 0u);
+		#else
+		HOST_TEST_CHECK(State.cBorrowed == 0u);
+		#endif
+	}
+
+	HostTestClose(hClient, hServer);
+}
+
+int main(int argc, char *argv[])
+{
+	PARSE_STATE Expect;
+	DWORD dwRandom = 0x2012u;
+	WORD i, wLine;
+	int j;
+
+	for(j = 1; j < argc; j++)
+	{
+		if(strcmp(argv[j], "-n") == 0 && j + 1 < argc)
+			_dwKilobytes = strtoul(argv[++j], NULL, 0);
+		else
+		{
+			fprintf(stderr, "usage: %s [-n kilobytes]\n", argv[0]);
+			return 2;
+		}
+	}
+	printf("tcpparse: %lu KB of lines, %s\n", (unsigned long)_dwKilobytes,
+		HOST_TCP_MEDIUM == TCP_PIC_RAM ? "FIFOs in PIC RAM" : "FIFOs in Ethernet RAM");
+
+	// header-like lines of 1 to 80 characters; the text repeats every
+	// PARSE_TEXT_SIZE bytes, which _dwKilobytes is a multiple of
+	for(i = 0, wLine = 0; i < PARSE_TEXT_SIZE; i++)
+	{
+		dwRandom ^= dwRandom << 13;
+		dwRandom ^= dwRandom >> 17;
+		dwRandom ^= dwRandom << 5;
+		if(wLine == 0u)
+			wLine = 1 + dwRandom % 80u;
+		_rgbText[i] = --wLine == 0u ? '\n' : ' ' + dwRandom % 95u;
+	}
+	_dwKilobytes = (_dwKilobytes + PARSE_TEXT_SIZE / 1024u - 1u) / (PARSE_TEXT_SIZE / 1024u) * (PARSE_TEXT_SIZE / 1024u);
+	memset(&Expect, 0, sizeof(Expect));
+	Scan(&Expect, _rgbText, PARSE_TEXT_SIZE);
+	Expect.cBytes *= _dwKilobytes / (PARSE_TEXT_SIZE / 1024u);
+	Expect.cLines *= _dwKilobytes / (PARSE_TEXT_SIZE / 1024u);
+
+	HostTestBegin();
+	Run("copy", PARSE_PORT, ParseCopy, &Expect);
+	Run("borrow", PARSE_PORT + 1, ParseBorrow, &Expect);
+
+	return HostTestEnd("tcpparse");
+}
@@ -0,0 +1,180 @@
+/************************************************************************/
+/*																		*/
+/*	tcpperftest.c	--  Test of the TCP performance test servers        */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Plays tools/dnetckperf.c against TCPPerformanceTest.c over			*/
+/*	loopback: a TX session ended by a reset, then RX and RR sessions	*/
+/*	closed normally.  Each session's TCPPerformanceGetResult() is		*/
+/*	checked against what the client counted and printed, so the run	*/
+/*	doubles as a measurement.  The client pauses between reads in the	*/
+/*	TX session so the server has a round trip time worth reporting;		*/
+/*	a reset clears the socket's statistics, which the result must not	*/
+/*	lose.																*/
+/*																		*/
+/************************************************************************/
+
+#include <time.h>
+
+#include "hosttest.h"
+
+#define RX_BYTES				(20000000ul)
+#define RR_EXCHANGES			(20000ul)
+#define RR_SIZE					(64u)
+
+static TCP_SOCKET Connect(WORD wPort)
+{
+	static NODE_INFO self;
+	TCP_SOCKET h;
+	QWORD qwEndNs = HostTestNowNs() + 2000000000ull;
+
+	HostTestSelf(&self);
+	h = TCPOpen((PTR_BASE)&self, TCP_OPEN_NODE_INFO, wPort, TCP_PURPOSE_DEFAULT);
+	while(h != INVALID_SOCKET && !TCPIsConnected(h) && HostTestNowNs() < qwEndNs)
+		HostTestTasks();
+
+	return h;
+}
+
+static void Print(const char *szName, const TCP_PERF_RESULT *pResult)
+{
+	printf("%s: bytes=%lu ms=%lu kbps=%lu exchanges=%lu srtt_ms=%lu rexmit=%u\n", szName,
+		(unsigned long)pResult->dwBytes, (unsigned long)pResult->dwMs,
+		pResult->dwMs ? (unsigned long)((QWORD)pResult->dwBytes * 8ull / pResult->dwMs) : 0ul,
+		(unsigned long)pResult->dwExchanges, (unsigned long)pResult->dwSRTTMs,
+		(unsigned int)pResult->wRetransmits);
+}
+
+// Reads slowly for a while, then resets the connection
+static void TestTxReset(void)
+{
+	static const struct timespec tsPause = {0, 20000000};
+	BYTE rgbBuff[1460];
+	TCP_SOCKET h;
+	TCP_PERF_RESULT result;
+	DWORD dwReceived = 0;
+	int i;
+
+	h = Connect(TCP_PERF_TX_PORT);
+	if(!HOST_TEST_CHECK(h != INVALID_SOCKET && TCPIsConnected(h)))
+		return;
+
+	for(i = 0; i < 25; i++)
+	{
+		nanosleep(&tsPause, NULL);
+		HostTestTasks();
+		dwReceived += TCPGetArray(h, rgbBuff, sizeof(rgbBuff));
+	}
+
+	TCPDisconnect(h);
+	TCPDisconnect(h);
+	HostTestRunFor(50);
+
+	if(HOST_TEST_CHECK(TCPPerformanceGetResult(TCP_PERF_TEST_TX, &result)))
+	{
+		Print("tcp-tx", &result);
+		HOST_TEST_CHECK(result.dwSessions == 1u);
+		HOST_TEST_CHECK(result.dwBytes >= dwReceived);
+		HOST_TEST_CHECK(result.dwSRTTMs >= 10u);
+	}
+}
+
+static void TestRx(void)
+{
+	BYTE rgbBuff[1460] = {0};
+	TCP_SOCKET h;
+	TCP_PERF_RESULT result;
+	DWORD dwSent = 0;
+	QWORD qwEndNs = HostTestNowNs() + 5000000000ull;
+	WORD w;
+
+	h = Connect(TCP_PERF_RX_PORT);
+	if(!HOST_TEST_CHECK(h != INVALID_SOCKET && TCPIsConnected(h)))
+		return;
+
+	while(dwSent < RX_BYTES && HostTestNowNs() < qwEndNs)
+	{
+		w = RX_BYTES - dwSent < sizeof(rgbBuff) ? RX_BYTES - dwSent : sizeof(rgbBuff);
+		dwSent += TCPPutArray(h, rgbBuff, w);
+		TCPFlush(h);
+		HostTestTasks();
+	}
+	while(TCPGetTxFIFOFull(h) && HostTestNowNs() < qwEndNs)
+		HostTestTasks();
+
+	TCPDisconnect(h);
+	HostTestRunFor(50);
+
+	if(HOST_TEST_CHECK(TCPPerformanceGetResult(TCP_PERF_TEST_RX, &result)))
+	{
+		Print("tcp-rx", &result);
+		HOST_TEST_CHECK(result.dwBytes == RX_BYTES);
+	}
+}
+
+static void TestRR(void)
+{
+	BYTE rgbBuff[RR_SIZE] = {RR_SIZE >> 8, RR_SIZE & 0xFF};
+	TCP_SOCKET h;
+	TCP_PERF_RESULT result;
+	DWORD i;
+	WORD w;
+	QWORD qwEndNs = HostTestNowNs() + 5000000000ull;
+
+	h = Connect(TCP_PERF_RR_PORT);
+	if(!HOST_TEST_CHECK(h != INVALID_SOCKET && TCPIsConnected(h)))
+		return;
+
+	for(i = 0; i < RR_EXCHANGES && HostTestNowNs() < qwEndNs; i++)
+	{
+		TCPPutArray(h, rgbBuff, sizeof(rgbBuff));
+		TCPFlush(h);
+		for(w = 0; w < sizeof(rgbBuff) && HostTestNowNs() < qwEndNs; )
+		{
+			HostTestTasks();
+			w += TCPGetArray(h, rgbBuff + w, sizeof(rgbBuff) - w);
+		}
+	}
+
+	TCPDisconnect(h);
+	HostTestRunFor(50);
+
+	if(HOST_TEST_CHECK(TCPPerformanceGetResult(TCP_PERF_TEST_RR, &result)))
+	{
+		Print("tcp-rr", &result);
+		HOST_TEST_CHECK(result.dwExchanges == RR_EXCHANGES);
+		HOST_TEST_CHECK(result.dwBytes == RR_EXCHANGES * RR_SIZE);
+	}
+}
+
+int main(void)
+{
+	HostTestBegin();
+	HostTestRunFor(10);		// let the servers open their sockets
+
+	TestTxReset();
+	TestRx();
+	TestRR();
+
+	return HostTestEnd("tcpperftest");
+}
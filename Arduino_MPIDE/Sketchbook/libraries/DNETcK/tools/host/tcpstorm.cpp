@@ -0,0 +1,328 @@
+/************************************************************************/
+/*																		*/
+/*	tcpstorm.cpp	--  TcpServer's accept ring under connection storms */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	A sketch with a TcpServer and the TcpClients that connect to it,    */
+/*	all on the one stack.  It checks the accept ring: clients come out  */
+/*	of acceptClient() in the order they connected, one that hangs up    */
+/*	while pending drops out of availableClients() without being        */
+/*	accepted, and a full backlog takes no more clients until one is     */
+/*	accepted, after which the waiting ones get in on their SYN retry.   */
+/*																		*/
+/*	Then the storm: STORM_CLIENTS clients connect at once, round after  */
+/*	round, to a server that accepts only two per pass of loop(), so     */
+/*	the backlog fills.  Each client sends a byte and waits for its      */
+/*	echo.  With a SYN queue as deep as the storm (the tcpstorm build)   */
+/*	every client of every round must get its echo.  With TCP.c's own   */
+/*	three entry queue (tcpstorm_synq) most of a burst finds no          */
+/*	listening socket and no room in the queue, and has to wait for its  */
+/*	retry; that build only reports how many did.  It also gives         */
+/*	the cost of availableClients() with an empty and a full backlog,    */
+/*	which no longer polls the pending sockets and so should not grow.   */
+/*																		*/
+/*		tcpstorm [-r rounds]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdio.h>
+
+#include "DNETcK.h"
+#include "hosttest.h"
+
+#define STORM_CLIENTS			(24)
+#define STORM_PORT				(7000u)
+#define STORM_TIMEOUT_MS		(8000ul)
+#define STORM_ACCEPTS_PER_PASS	(2)
+
+static IPv4 _ip = {{192, 168, 1, 190}};
+static BYTE _peerPort;
+
+static TcpClient _rgClient[STORM_CLIENTS];			// the connecting side
+static TcpClient _rgAccepted[STORM_CLIENTS];		// the server's side
+
+static void Loop(void)
+{
+	DNETcK::periodicTasks();
+	HostTestPeerAnswerArp(_peerPort);
+}
+
+static void RunFor(unsigned long ms)
+{
+	unsigned long tStart = millis();
+
+	while(millis() - tStart < ms)
+		Loop();
+}
+
+static unsigned short LocalPort(TcpClient *pClient)
+{
+	IPEndPoint ep;
+
+	return pClient->getLocalEndPoint(&ep) ? ep.port : 0;
+}
+
+static bool ConnectAndWait(TcpClient *pClient, unsigned short port)
+{
+	unsigned long tStart = millis();
+
+	if(!pClient->connect(_ip, port))
+		return false;
+	while(!pClient->isConnected(DNETcK::msImmediate))
+	{
+		if(millis() - tStart > STORM_TIMEOUT_MS)
+			return false;
+		Loop();
+	}
+	return true;
+}
+
+// Runs the stack until tcpServer has cPending clients waiting
+static bool WaitPending(TcpServer *pServer, int cPending, unsigned long ms)
+{
+	unsigned long tStart = millis();
+
+	while(pServer->availableClients() != cPending)
+	{
+		if(millis() - tStart > ms)
+			return false;
+		Loop();
+	}
+	return true;
+}
+
+static void CloseAll(void)
+{
+	int i;
+
+	for(i = 0; i < STORM_CLIENTS; i++)
+	{
+		_rgClient[i].close();
+		_rgAccepted[i].close();
+	}
+	RunFor(50);
+}
+
+// Clients come out in the order they connected, less the ones that left
+static void CheckOrder(void)
+{
+	static const int rgiLeave[] = {1, 4};
+	static const int rgiStay[] = {0, 2, 3, 5};
+	TcpServer tcpServer(16);
+	IPEndPoint ep;
+	unsigned short rgPort[6];
+	int i;
+
+	HOST_TEST_CHECK(tcpServer.startListening(STORM_PORT));
+	for(i = 0; i < 6; i++)
+	{
+		if(!HOST_TEST_CHECK(ConnectAndWait(&_rgClient[i], STORM_PORT)))
+			return;
+		rgPort[i] = LocalPort(&_rgClient[i]);
+	}
+	HOST_TEST_CHECK(WaitPending(&tcpServer, 6, 1000));
+
+	// hang up before being accepted; the server sees the FIN and lets them go
+	for(i = 0; i < 2; i++)
+		_rgClient[rgiLeave[i]].close();
+	HOST_TEST_CHECK(WaitPending(&tcpServer, 4, 2000));
+
+	for(i = 0; i < 4; i++)
+		HOST_TEST_CHECK(tcpServer.getAvailableClientsRemoteEndPoint(&ep, i) && ep.port == rgPort[rgiStay[i]]);
+	for(i = 0; i < 4; i++)
+	{
+		HOST_TEST_CHECK(tcpServer.acceptClient(&_rgAccepted[i]));
+		HOST_TEST_CHECK(_rgAccepted[i].getRemoteEndPoint(&ep) && ep.port == rgPort[rgiStay[i]]);
+	}
+	HOST_TEST_CHECK(tcpServer.availableClients() == 0);
+	HOST_TEST_CHECK(tcpServer.isListening());
+
+	tcpServer.close();
+	CloseAll();
+}
+
+// A full backlog stops listening; each accept lets a waiting client in
+static void CheckBacklog(void)
+{
+	TcpServer tcpServer(3);
+	unsigned long tStart;
+	int i, cConnected;
+
+	HOST_TEST_CHECK(tcpServer.startListening(STORM_PORT + 1));
+	for(i = 0; i < 5; i++)
+		HOST_TEST_CHECK(_rgClient[i].connect(_ip, STORM_PORT + 1));
+	RunFor(300);
+
+	for(i = 0, cConnected = 0; i < 5; i++)
+		cConnected += _rgClient[i].isConnected(DNETcK::msImmediate);
+	HOST_TEST_CHECK(tcpServer.availableClients() == 3);
+	HOST_TEST_CHECK(cConnected == 3);
+
+	// the others are waiting on their SYN retry
+	HOST_TEST_CHECK(tcpServer.acceptClient(&_rgAccepted[0]));
+	HOST_TEST_CHECK(tcpServer.acceptClient(&_rgAccepted[1]));
+	HOST_TEST_CHECK(WaitPending(&tcpServer, 3, 4000));
+
+	for(tStart = millis(), cConnected = 0; cConnected < 5 && millis() - tStart < 1000; Loop())
+		for(i = 0, cConnected = 0; i < 5; i++)
+			cConnected += _rgClient[i].isConnected(DNETcK::msImmediate);
+	HOST_TEST_CHECK(cConnected == 5);
+
+	tcpServer.close();
+	CloseAll();
+}
+
+// Nanoseconds per availableClients() call
+static double AvailableCost(TcpServer *pServer)
+{
+	unsigned long long qwStartNs = HostTestNowNs();
+	int i;
+
+	for(i = 0; i < 20000; i++)
+		pServer->availableClients();
+	return (double)(HostTestNowNs() - qwStartNs) / 20000;
+}
+
+static void CheckCost(void)
+{
+	TcpServer tcpServer(16);
+	double nsEmpty, nsFull;
+	int i;
+
+	HOST_TEST_CHECK(tcpServer.startListening(STORM_PORT + 2));
+	RunFor(10);
+	nsEmpty = AvailableCost(&tcpServer);
+
+	for(i = 0; i < 16; i++)
+		HOST_TEST_CHECK(ConnectAndWait(&_rgClient[i], STORM_PORT + 2));
+	HOST_TEST_CHECK(WaitPending(&tcpServer, 16, 1000));
+	nsFull = AvailableCost(&tcpServer);
+
+	printf("  availableClients(): %.0f ns with none pending, %.0f ns with 16\n", nsEmpty, nsFull);
+
+	tcpServer.close();
+	CloseAll();
+}
+
+// One round of the storm, false if a client never got its echo
+static bool Storm(TcpServer *pServer, int *pcRetried, int *pcMaxPending)
+{
+	unsigned long rgtStart[STORM_CLIENTS];
+	bool rgfEchoed[STORM_CLIENTS], rgfSent[STORM_CLIENTS];
+	unsigned long tStart = millis();
+	int i, cEchoed = 0, cAccepted = 0, cPending;
+	byte b;
+
+	for(i = 0; i < STORM_CLIENTS; i++)
+	{
+		rgfEchoed[i] = rgfSent[i] = false;
+		rgtStart[i] = millis();
+		if(!_rgClient[i].connect(_ip, STORM_PORT))
+			return false;
+	}
+
+	while(cEchoed < STORM_CLIENTS && millis() - tStart < STORM_TIMEOUT_MS)
+	{
+		Loop();
+
+		// the server takes a couple at a time and echoes what they send
+		if((cPending = pServer->availableClients()) > *pcMaxPending)
+			*pcMaxPending = cPending;
+		for(i = 0; i < STORM_ACCEPTS_PER_PASS && cAccepted < STORM_CLIENTS && pServer->availableClients() > 0; i++)
+			pServer->acceptClient(&_rgAccepted[cAccepted++]);
+		for(i = 0; i < cAccepted; i++)
+			if(_rgAccepted[i].available() > 0 && _rgAccepted[i].readStream(&b, 1) == 1)
+				_rgAccepted[i].writeStream(&b, 1, DNETcK::msImmediate);
+
+		for(i = 0; i < STORM_CLIENTS; i++)
+		{
+			if(!rgfSent[i] && _rgClient[i].isConnected(DNETcK::msImmediate))
+			{
+				b = (byte)i;
+				rgfSent[i] = _rgClient[i].writeStream(&b, 1, DNETcK::msImmediate) == 1;
+
+				// it took a SYN retry to get in
+				if(millis() - rgtStart[i] > 500)
+					(*pcRetried)++;
+			}
+			else if(rgfSent[i] && !rgfEchoed[i] && _rgClient[i].available() > 0)
+			{
+				rgfEchoed[i] = _rgClient[i].readStream(&b, 1) == 1 && b == (byte)i;
+				cEchoed += rgfEchoed[i];
+			}
+		}
+	}
+
+	CloseAll();
+	return cEchoed == STORM_CLIENTS;
+}
+
+int main(int argc, char *argv[])
+{
+	int cRounds = 5, cRetried = 0, cMaxPending = 0, cFailed = 0;
+	unsigned long long qwStartNs, qwNs;
+	unsigned long tStart;
+	int i;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			cRounds = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: %s [-r rounds]\n", argv[0]);
+			return 2;
+		}
+	}
+	printf("tcpstorm: %d clients, %d rounds, DNETcK_MAX_PENDING_CLIENTS %d\n", STORM_CLIENTS, cRounds, DNETcK_MAX_PENDING_CLIENTS);
+
+	DNETcK::begin(_ip);
+	_peerPort = HostTestPeerAttach();
+	for(tStart = millis(); !DNETcK::isInitialized(DNETcK::msImmediate) && millis() - tStart < STORM_TIMEOUT_MS; )
+		Loop();
+
+	CheckOrder();
+	CheckBacklog();
+	CheckCost();
+
+	{
+		TcpServer tcpServer(16);
+
+		HOST_TEST_CHECK(tcpServer.startListening(STORM_PORT));
+		qwStartNs = HostTestNowNs();
+		for(i = 0; i < cRounds; i++)
+			cFailed += !Storm(&tcpServer, &cRetried, &cMaxPending);
+		qwNs = HostTestNowNs() - qwStartNs;
+		tcpServer.close();
+	}
+
+	printf("  storm: %.0f connections/s, %d of %d needed a SYN retry, backlog up to %d, %d rounds failed\n",
+		(double)cRounds * STORM_CLIENTS * 1e9 / qwNs, cRetried, cRounds * STORM_CLIENTS, cMaxPending, cFailed);
+#if defined(TCP_SYN_QUEUE_MAX_ENTRIES) && (TCP_SYN_QUEUE_MAX_ENTRIES >= STORM_CLIENTS)
+	HOST_TEST_CHECK(cFailed == 0);
+#endif
+	HOST_TEST_CHECK(cMaxPending <= 16);
+
+	return HostTestEnd("tcpstorm");
+}
@@ -0,0 +1,186 @@
+/************************************************************************/
+/*																		*/
+/*	udpbatch.c	--  Datagrams per second, one by one and batched        */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Sends small datagrams from the stack to the peer of hosttest.h,		*/
+/*	as a 1 kHz sample fan-out does, and counts how many go out a		*/
+/*	second: with UDPIsPutReady(), UDPPutArray() and UDPFlush() for		*/
+/*	each, with UDPPutDatagrams() to one endpoint, and with				*/
+/*	UDPPutDatagrams() alternating between two endpoints, the second		*/
+/*	given by another socket's sRemote.  The peer takes every frame		*/
+/*	off the switch and checks its port, payload and UDP checksum.		*/
+/*																		*/
+/*		udpbatch [-t seconds] [-s size]									*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define BATCH_LOCAL_PORT		(9500u)
+#define BATCH_REMOTE_PORT		(9501u)		// first endpoint, the second is the next port
+#define BATCH_DATAGRAMS			(16u)		// per call, half the peer's queue
+
+enum
+{
+	BATCH_FLUSH = 0,						// UDPPutArray() and UDPFlush() each
+	BATCH_ONE,								// UDPPutDatagrams() to one endpoint
+	BATCH_TWO								// UDPPutDatagrams() to two endpoints
+};
+
+static DWORD _dwSeconds = 1;
+static WORD _wSize = 16;
+static BYTE _port;
+
+// RFC 1071 over the pseudo header and the UDP header and payload
+static BOOL UdpChecksumOK(const BYTE *pFrame)
+{
+	const IP_HEADER *pIP = (const IP_HEADER*)(pFrame + sizeof(ETHER_HEADER));
+	const BYTE *pUDP = (const BYTE*)(pIP + 1);
+	WORD wLen = swaps(((const UDP_HEADER*)pUDP)->Length), i;
+	DWORD dwSum = 0;
+
+	for(i = 0; i < 8u; i += 2)
+		dwSum += ((WORD)((const BYTE*)&pIP->SourceAddress)[i] << 8) | ((const BYTE*)&pIP->SourceAddress)[i + 1];
+	dwSum += IP_PROT_UDP + wLen;
+	for(i = 0; i + 1u < wLen; i += 2)
+		dwSum += ((WORD)pUDP[i] << 8) | pUDP[i + 1];
+	if(wLen & 1u)
+		dwSum += (WORD)pUDP[wLen - 1] << 8;
+	while(dwSum >> 16)
+		dwSum = (dwSum & 0xFFFFu) + (dwSum >> 16);
+
+	return dwSum == 0xFFFFu;
+}
+
+// Takes the frames off the peer's port, checks each against what was sent
+static DWORD Drain(DWORD dwFirst, BYTE vMode)
+{
+	static BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+	const UDP_HEADER *pUDP = (const UDP_HEADER*)(rgbFrame + sizeof(ETHER_HEADER) + sizeof(IP_HEADER));
+	const BYTE *pData = (const BYTE*)(pUDP + 1);
+	DWORD c = 0, dwSeq;
+
+	while(HostMACReceive(_port, rgbFrame, sizeof(rgbFrame)))
+	{
+		dwSeq = dwFirst + c++;
+		HOST_TEST_CHECK(swaps(pUDP->SourcePort) == BATCH_LOCAL_PORT);
+		HOST_TEST_CHECK(swaps(pUDP->DestinationPort) == BATCH_REMOTE_PORT + (vMode == BATCH_TWO ? dwSeq % 2u : 0u));
+		HOST_TEST_CHECK(swaps(pUDP->Length) == sizeof(UDP_HEADER) + _wSize);
+		HOST_TEST_CHECK(memcmp(pData, &dwSeq, sizeof(dwSeq)) == 0);
+		HOST_TEST_CHECK(UdpChecksumOK(rgbFrame));
+	}
+
+	return c;
+}
+
+static void Run(const char *szName, BYTE vMode, UDP_SOCKET rgs[2])
+{
+	static BYTE rgbData[BATCH_DATAGRAMS][1024];
+	UDP_DATAGRAM rgDatagrams[BATCH_DATAGRAMS];
+	QWORD qwStartNs, qwEndNs;
+	DWORD dwSeq = 0, cReceived = 0;
+	WORD i;
+
+	for(i = 0; i < BATCH_DATAGRAMS; i++)
+	{
+		rgDatagrams[i].pData = rgbData[i];
+		rgDatagrams[i].wLength = _wSize;
+		rgDatagrams[i].sRemote = (vMode == BATCH_TWO && (i % 2u)) ? rgs[1] : INVALID_UDP_SOCKET;
+	}
+	HostTestTasks();
+	while(HostMACReceive(_port, rgbData[0], sizeof(rgbData[0])));
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs && HostTestFailures < 10)
+	{
+		for(i = 0; i < BATCH_DATAGRAMS; i++)
+			memcpy(rgbData[i], &(DWORD){dwSeq + i}, sizeof(DWORD));
+
+		if(vMode == BATCH_FLUSH)
+		{
+			for(i = 0; i < BATCH_DATAGRAMS && UDPIsPutReady(rgs[0]) >= _wSize; i++)
+			{
+				UDPPutArray(rgbData[i], _wSize);
+				UDPFlush();
+			}
+		}
+		else
+		{
+			i = UDPPutDatagrams(rgs[0], rgDatagrams, BATCH_DATAGRAMS);
+		}
+		HOST_TEST_CHECK(i == BATCH_DATAGRAMS);
+
+		cReceived += Drain(dwSeq, vMode);
+		dwSeq += i;
+	}
+	qwEndNs = HostTestNowNs();
+
+	printf("  %-13s %9.0f datagrams/s, %6.1f MB/s of payload\n", szName,
+		dwSeq * 1e9 / (qwEndNs - qwStartNs), (double)dwSeq * _wSize * 1e3 / (qwEndNs - qwStartNs));
+	HOST_TEST_CHECK(cReceived == dwSeq);
+}
+
+int main(int argc, char *argv[])
+{
+	NODE_INFO peer;
+	UDP_SOCKET rgs[2];
+	int i;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			_dwSeconds = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			_wSize = atoi(argv[++i]);
+		else
+			break;
+	}
+	if(i < argc || _wSize < sizeof(DWORD) || _wSize > 1024u)
+	{
+		fprintf(stderr, "usage: %s [-t seconds] [-s size, 4 to 1024]\n", argv[0]);
+		return 2;
+	}
+	printf("udpbatch: %u byte datagrams, %u a call\n", _wSize, BATCH_DATAGRAMS);
+
+	HostTestBegin();
+	_port = HostTestPeerAttach();
+	HostTestPeer(&peer);
+	rgs[0] = UDPOpen(BATCH_LOCAL_PORT, &peer, BATCH_REMOTE_PORT);
+	rgs[1] = UDPOpen(BATCH_LOCAL_PORT + 2u, &peer, BATCH_REMOTE_PORT + 1u);
+	if(!HOST_TEST_CHECK(_port != HOST_MAC_INVALID_PORT && rgs[0] != INVALID_UDP_SOCKET && rgs[1] != INVALID_UDP_SOCKET))
+		return HostTestEnd("udpbatch");
+
+	Run("flush each", BATCH_FLUSH, rgs);
+	Run("batch", BATCH_ONE, rgs);
+	Run("batch, two", BATCH_TWO, rgs);
+
+	UDPClose(rgs[0]);
+	UDPClose(rgs[1]);
+	HostMACDetach(_port);
+	return HostTestEnd("udpbatch");
+}
@@ -0,0 +1,208 @@
+/************************************************************************/
+/*																		*/
+/*	udpcache.c	--  Small datagrams through a UdpClient's cache         */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	The peer of hosttest.h keeps the stack's RX queue full of small		*/
+/*	numbered datagrams for a socket with a DNETcKAPI.c cache, the way	*/
+/*	UdpClient sets one up, and the loop reads them out as a sketch		*/
+/*	does: copied out with UdpClientPeek(), as readDatagram() does, or	*/
+/*	borrowed in place with UdpClientBorrowDataGram().  Datagrams per	*/
+/*	second are counted with the time spent in the read calls alone.		*/
+/*	Then the cache is left to overflow, and what is left must be the	*/
+/*	newest datagrams in order, each with an age.						*/
+/*																		*/
+/*		udpcache [-t seconds] [-s size]									*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+#include "DNETcK.h"
+#include "DNETcKAPI.h"
+
+#define CACHE_LOCAL_PORT		(9600u)
+#define CACHE_REMOTE_PORT		(9601u)
+#define CACHE_SIZE				(1024u)		// UdpClient's default is 1024 too
+
+static DWORD _dwSeconds = 1;
+static WORD _wSize = 16;
+static BYTE _port, _hUDP;
+static BYTE _rgbFrame[HOST_MAC_FRAME_SIZE];
+static DWORD _dwSent;
+
+// Fills the stack's RX queue with numbered datagrams
+static void Send(void)
+{
+	static BYTE rgbData[1024];
+
+	while(MACGetFreeRxSize() >= HOST_MAC_FRAME_SIZE)
+	{
+		memcpy(rgbData, &_dwSent, sizeof(_dwSent));
+		HostMACSend(_port, _rgbFrame, HostTestPeerUdpFrame(_rgbFrame, CACHE_REMOTE_PORT, CACHE_LOCAL_PORT, rgbData, _wSize));
+		_dwSent++;
+	}
+}
+
+// Reads what is cached, returns how many datagrams
+static DWORD Read(BOOL bBorrow, DWORD *pdwNext)
+{
+	static BYTE rgbRead[1024];
+	const BYTE *pbDatagram;
+	WORD cb;
+	DWORD c = 0, dwSeq;
+
+	for(;;)
+	{
+		if(bBorrow)
+		{
+			if((pbDatagram = UdpClientBorrowDataGram(_hUDP, &cb)) == NULL)
+				break;
+			memcpy(&dwSeq, pbDatagram, sizeof(dwSeq));
+			UdpClientEmptyNextDataGram(_hUDP);
+		}
+		else
+		{
+			if((cb = UdpClientPeek(_hUDP, rgbRead, sizeof(rgbRead), 0)) == 0u)
+				break;
+			memcpy(&dwSeq, rgbRead, sizeof(dwSeq));
+			UdpClientRemoveBytesFromDataGram(_hUDP, cb);
+		}
+
+		HOST_TEST_CHECK(cb == _wSize && dwSeq >= *pdwNext);
+		*pdwNext = dwSeq + 1;
+		c++;
+	}
+
+	return c;
+}
+
+static void Run(const char *szName, BOOL bBorrow)
+{
+	QWORD qwStartNs, qwEndNs, qwReadNs = 0, qwNs;
+	DWORD c = 0, dwNext = 0;
+
+	_dwSent = 0;
+	HostTestRunFor(10);
+	UdpClientEmptyNextDataGram(_hUDP);
+	while(UdpClientAvailable(_hUDP))
+		UdpClientEmptyNextDataGram(_hUDP);
+
+	qwStartNs = HostTestNowNs();
+	qwEndNs = qwStartNs + _dwSeconds * 1000000000ull;
+	while(HostTestNowNs() < qwEndNs && HostTestFailures < 10)
+	{
+		Send();
+		HostTestTasks();
+
+		qwNs = HostTestNowNs();
+		c += Read(bBorrow, &dwNext);
+		qwReadNs += HostTestNowNs() - qwNs;
+	}
+	qwEndNs = HostTestNowNs();
+
+	printf("  %-7s %9.0f datagrams/s, %5.1f ns a datagram to read, %lu of %lu sent\n", szName,
+		c * 1e9 / (qwEndNs - qwStartNs), c ? (double)qwReadNs / c : 0.0, (unsigned long)c, (unsigned long)_dwSent);
+	HOST_TEST_CHECK(c != 0u);
+}
+
+// Lets the cache overflow; the oldest datagrams go first
+static void Overflow(void)
+{
+	WORD cbMax = CACHE_SIZE / _wSize;
+	DWORD c, dwNext, dwFirst;
+	unsigned long msAge;
+	const BYTE *pbDatagram;
+	WORD cb;
+
+	while(UdpClientAvailable(_hUDP))
+		UdpClientEmptyNextDataGram(_hUDP);
+	HostTestRunFor(5);
+	while(UdpClientAvailable(_hUDP))
+		UdpClientEmptyNextDataGram(_hUDP);
+
+	// more datagrams than the cache has room or descriptors for
+	for(c = 0; c < 4u * (cbMax > 32u ? cbMax : 32u); c++)
+	{
+		Send();
+		HostTestTasks();
+	}
+	HostTestRunFor(20);
+
+	if(!HOST_TEST_CHECK((pbDatagram = UdpClientBorrowDataGram(_hUDP, &cb)) != NULL))
+		return;
+	memcpy(&dwFirst, pbDatagram, sizeof(dwFirst));
+	HOST_TEST_CHECK(UdpClientGetDataGramAge(_hUDP, &msAge) && msAge >= 10u && msAge < 1000u);
+	HOST_TEST_CHECK(dwFirst != 0u);
+
+	for(c = 0, dwNext = dwFirst; (pbDatagram = UdpClientBorrowDataGram(_hUDP, &cb)) != NULL; c++, dwNext++)
+	{
+		HOST_TEST_CHECK(memcmp(pbDatagram, &dwNext, sizeof(dwNext)) == 0);
+		UdpClientEmptyNextDataGram(_hUDP);
+	}
+	printf("  overflow kept the last %lu of %lu, aged %lu ms\n", (unsigned long)c, (unsigned long)_dwSent, msAge);
+	HOST_TEST_CHECK(dwNext == _dwSent);
+	HOST_TEST_CHECK(!UdpClientGetDataGramAge(_hUDP, &msAge));
+}
+
+int main(int argc, char *argv[])
+{
+	static byte rgbCache[CACHE_SIZE];
+	NODE_INFO peer;
+	int i;
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			_dwSeconds = atoi(argv[++i]);
+		else if(strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			_wSize = atoi(argv[++i]);
+		else
+			break;
+	}
+	if(i < argc || _wSize < sizeof(DWORD) || _wSize > CACHE_SIZE / 4u)
+	{
+		fprintf(stderr, "usage: %s [-t seconds] [-s size, 4 to %u]\n", argv[0], CACHE_SIZE / 4u);
+		return 2;
+	}
+	printf("udpcache: %u byte datagrams, %u byte cache\n", _wSize, CACHE_SIZE);
+
+	HostTestBegin();
+	_port = HostTestPeerAttach();
+	HostTestPeer(&peer);
+	_hUDP = UdpClientSetEndPoint(peer.IPAddr.v, peer.MACAddr.v, CACHE_REMOTE_PORT, CACHE_LOCAL_PORT);
+	if(!HOST_TEST_CHECK(_port != HOST_MAC_INVALID_PORT && _hUDP != INVALID_UDP_SOCKET))
+		return HostTestEnd("udpcache");
+	ExchangeCacheBuffer(_hUDP, rgbCache, sizeof(rgbCache));
+
+	Run("copy", FALSE);
+	Run("borrow", TRUE);
+	Overflow();
+
+	ExchangeCacheBuffer(_hUDP, NULL, 0);
+	UDPClose(_hUDP);
+	HostMACDetach(_port);
+	return HostTestEnd("udpcache");
+}
@@ -0,0 +1,155 @@
+/************************************************************************/
+/*																		*/
+/*	udpdemux.c	--  Finding a datagram's socket among 64                */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Opens 1, 16 and then 64 UDP sockets on distinct ports and has the	*/
+/*	peer of hosttest.h send datagrams to them at random, and to a port	*/
+/*	none of them has.  StackGetHandlerStats() times UDPProcess() for	*/
+/*	each, and every datagram to an open port must have reached its		*/
+/*	socket.  The sockets are chained by local port, so the time should	*/
+/*	hardly grow with their number; udpdemux_scan, built with			*/
+/*	UDP_PORT_HASH_BUCKETS 1, puts them all on one chain and shows what	*/
+/*	the scan of every socket cost.										*/
+/*																		*/
+/*		udpdemux [-n datagrams]											*/
+/*																		*/
+/************************************************************************/
+
+#include <stdlib.h>
+
+#include "hosttest.h"
+
+#define DEMUX_SOCKETS			(64u)
+#define DEMUX_PORT				(10000u)	// and up, one per socket
+#define DEMUX_CLOSED_PORT		(9990u)		// nothing listens on it
+#define DEMUX_PAYLOAD			(18u)
+#define DEMUX_REPEATS			(5u)		// the quickest run counts
+
+static UDP_SOCKET _rghUDP[DEMUX_SOCKETS];
+static DWORD _dwDatagrams = 20000;
+static DWORD _dwRandom = 0x2012u;
+
+static DWORD Random(void)
+{
+	_dwRandom ^= _dwRandom << 13;
+	_dwRandom ^= _dwRandom >> 17;
+	_dwRandom ^= _dwRandom << 5;
+	return _dwRandom;
+}
+
+// UDP handler time per datagram, in ns; FALSE for bHits sends to the closed port
+static double Run(BYTE port, WORD cOpen, BOOL bHits)
+{
+	static BYTE rgbPayload[DEMUX_PAYLOAD];
+	STACK_HANDLER_STATS rgStats[STACK_HANDLERS];
+	DWORD i, cReceived = 0;
+	WORD w;
+
+	HostTestRunFor(5);
+	StackGetHandlerStats(rgStats, TRUE);
+	for(i = 0; i < _dwDatagrams; i++)
+	{
+		w = bHits ? Random() % cOpen : 0;
+		HostTestPeerSendUdp(port, 5000, bHits ? DEMUX_PORT + w : DEMUX_CLOSED_PORT, rgbPayload, sizeof(rgbPayload));
+		StackTask();
+		if(bHits && UDPIsGetReady(_rghUDP[w]) == sizeof(rgbPayload))
+			cReceived++;
+	}
+	StackGetHandlerStats(rgStats, TRUE);
+
+	if(bHits)
+		HOST_TEST_CHECK(cReceived == _dwDatagrams);
+	if(!HOST_TEST_CHECK(rgStats[STACK_HANDLER_UDP].cFrames == _dwDatagrams))
+		return 0;
+	return (double)rgStats[STACK_HANDLER_UDP].qwTotalNs / rgStats[STACK_HANDLER_UDP].cFrames;
+}
+
+static double Quickest(BYTE port, WORD cOpen, BOOL bHits)
+{
+	double d, dMin = Run(port, cOpen, bHits);
+	WORD i;
+
+	for(i = 1; i < DEMUX_REPEATS; i++)
+	{
+		if((d = Run(port, cOpen, bHits)) < dMin)
+			dMin = d;
+	}
+
+	return dMin;
+}
+
+int main(int argc, char *argv[])
+{
+	static const WORD rgwOpen[] = {1, 16, DEMUX_SOCKETS};
+	double rgHit[sizeof(rgwOpen) / sizeof(rgwOpen[0])], rgMiss[sizeof(rgHit) / sizeof(rgHit[0])];
+	BYTE port;
+	WORD i, cOpen;
+	int j;
+
+	for(j = 1; j < argc; j++)
+	{
+		if(strcmp(argv[j], "-n") == 0 && j + 1 < argc)
+			_dwDatagrams = strtoul(argv[++j], NULL, 0);
+		else
+		{
+			fprintf(stderr, "usage: %s [-n datagrams]\n", argv[0]);
+			return 2;
+		}
+	}
+	#if defined(UDP_PORT_HASH_BUCKETS)
+	printf("udpdemux: %u sockets, UDP_PORT_HASH_BUCKETS %u\n", MAX_UDP_SOCKETS, UDP_PORT_HASH_BUCKETS);
+	#else
+	printf("udpdemux: %u sockets\n", MAX_UDP_SOCKETS);
+	#endif
+
+	HostTestBegin();
+	port = HostTestPeerAttach();
+	if(!HOST_TEST_CHECK(port != HOST_MAC_INVALID_PORT))
+		return HostTestEnd("udpdemux");
+
+	for(i = 0, cOpen = 0; i < sizeof(rgwOpen) / sizeof(rgwOpen[0]); i++)
+	{
+		for(; cOpen < rgwOpen[i]; cOpen++)
+		{
+			_rghUDP[cOpen] = UDPOpen(DEMUX_PORT + cOpen, NULL, 0);
+			if(!HOST_TEST_CHECK(_rghUDP[cOpen] != INVALID_UDP_SOCKET))
+				return HostTestEnd("udpdemux");
+		}
+
+		rgHit[i] = Quickest(port, cOpen, TRUE);
+		rgMiss[i] = Quickest(port, cOpen, FALSE);
+		printf("  %2u sockets open: hit %5.0f ns, miss %5.0f ns\n", cOpen, rgHit[i], rgMiss[i]);
+	}
+
+	// loose, a PC's timings wander; with the hash a chain has a few sockets
+	#if !defined(UDP_PORT_HASH_BUCKETS)
+	HOST_TEST_CHECK(rgHit[i - 1] < 2.0 * rgHit[0]);
+	HOST_TEST_CHECK(rgMiss[i - 1] < 2.0 * rgMiss[0]);
+	#endif
+
+	for(i = 0; i < cOpen; i++)
+		UDPClose(_rghUDP[i]);
+	HostMACDetach(port);
+	return HostTestEnd("udpdemux");
+}
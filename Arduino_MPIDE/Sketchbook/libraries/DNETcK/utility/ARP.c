@@ -76,7 +76,40 @@
 #endif
 
 #ifdef STACK_CLIENT_MODE
-static NODE_INFO Cache;						// Cache for one ARP response
+// Number of IP to MAC translations kept.  When all are in use, the 
+// least recently looked up one is reused.
+#ifndef ARP_CACHE_SIZE
+	#define ARP_CACHE_SIZE			8u
+#endif
+
+// Number of hash chains in ARPCache, must be a power of 2
+#ifndef ARP_HASH_BUCKETS
+	#define ARP_HASH_BUCKETS		8u
+#endif
+
+#ifndef ARP_CACHE_TIMEOUT
+	#define ARP_CACHE_TIMEOUT		(10ul*60ul*TICK_SECOND)	// Resolved entries are forgotten after this long
+#endif
+#define ARP_REQUEST_HOLDOFF		(TICK_SECOND/4ul)		// Repeated ARPResolve() calls for one IP send at most one request per this long
+
+#define ARP_ENTRY_FREE			0u		// Entry is unused
+#define ARP_ENTRY_INCOMPLETE	1u		// A request was sent, no response yet
+#define ARP_ENTRY_RESOLVED		2u		// MACAddr is valid
+
+typedef struct
+{
+	IP_ADDR		IPAddr;		// Address the request went to; the gateway's for off subnet hosts
+	MAC_ADDR	MACAddr;
+	BYTE		vState;		// One of the ARP_ENTRY_* states
+	BYTE		vNext;		// Next entry in the same hash chain, ARP_CACHE_SIZE ends the chain
+	DWORD		dwUpdated;	// Tick the request was sent or the response arrived
+	DWORD		dwUsed;		// Tick of the last lookup, for reuse
+} ARP_CACHE_ENTRY;
+
+static ARP_CACHE_ENTRY ARPCache[ARP_CACHE_SIZE];
+static BYTE ARPHashHeads[ARP_HASH_BUCKETS];
+
+#define ARPHash(dw)	((((BYTE*)&(dw))[3] ^ ((BYTE*)&(dw))[2]) & (ARP_HASH_BUCKETS-1u))
 #endif
 
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
@@ -107,6 +140,11 @@ typedef struct __attribute__((aligned(2), packed))
 
 static BOOL ARPPut(ARP_PACKET* packet);
 
+#ifdef STACK_CLIENT_MODE
+static ARP_CACHE_ENTRY* ARPFindEntry(DWORD dwIP);
+static ARP_CACHE_ENTRY* ARPNewEntry(DWORD dwIP);
+#endif
+
 
 /****************************************************************************
   Section:
@@ -354,7 +392,7 @@ static BOOL ARPPut(ARP_PACKET* packet)
 	
   Description:
   	Initializes the ARP module.  Call this function once at boot to 
-  	invalidate the cached lookup.
+  	invalidate the cached lookups.
 
   Precondition:
 	None
@@ -372,14 +410,126 @@ static BOOL ARPPut(ARP_PACKET* packet)
 #ifdef STACK_CLIENT_MODE
 void ARPInit(void)
 {
-    Cache.MACAddr.v[0] = 0xff;
-    Cache.MACAddr.v[1] = 0xff;
-    Cache.MACAddr.v[2] = 0xff;
-    Cache.MACAddr.v[3] = 0xff;
-    Cache.MACAddr.v[4] = 0xff;
-    Cache.MACAddr.v[5] = 0xff;
-
-	Cache.IPAddr.Val = 0x0;
+	BYTE i;
+
+	memset(ARPCache, 0x00, sizeof(ARPCache));
+	for(i = 0; i < ARP_CACHE_SIZE; i++)
+		ARPCache[i].vNext = ARP_CACHE_SIZE;
+	for(i = 0; i < ARP_HASH_BUCKETS; i++)
+		ARPHashHeads[i] = ARP_CACHE_SIZE;
+}
+
+
+
+/*****************************************************************************
+  Function:
+	static ARP_CACHE_ENTRY* ARPFindEntry(DWORD dwIP)
+
+  Summary:
+	Looks up an IP address in the ARP cache.
+	
+  Description:
+  	Walks the hash chain for dwIP, so the cost does not grow with 
+  	ARP_CACHE_SIZE.  Resolved entries older than ARP_CACHE_TIMEOUT are 
+  	freed on the way, so a host that changed its MAC address is asked 
+  	again.
+
+  Precondition:
+	None
+
+  Parameters:
+	dwIP - IP address, in network byte order
+
+  Returns:
+  	The incomplete or resolved entry for dwIP, or NULL if there is none.
+  ***************************************************************************/
+static ARP_CACHE_ENTRY* ARPFindEntry(DWORD dwIP)
+{
+	ARP_CACHE_ENTRY* e;
+	BYTE i;
+
+	for(i = ARPHashHeads[ARPHash(dwIP)]; i < ARP_CACHE_SIZE; i = e->vNext)
+	{
+		e = &ARPCache[i];
+		if(e->IPAddr.Val != dwIP || e->vState == ARP_ENTRY_FREE)
+			continue;
+
+		if(e->vState == ARP_ENTRY_RESOLVED && TickGet() - e->dwUpdated > ARP_CACHE_TIMEOUT)
+		{
+			e->vState = ARP_ENTRY_FREE;
+			continue;
+		}
+
+		return e;
+	}
+
+	return NULL;
+}
+
+
+
+/*****************************************************************************
+  Function:
+	static ARP_CACHE_ENTRY* ARPNewEntry(DWORD dwIP)
+
+  Summary:
+	Claims an ARP cache entry for an IP address.
+	
+  Description:
+  	Takes a free entry, or failing that the one least recently looked up,
+  	and moves it to dwIP's hash chain.  The caller sets the state.
+
+  Precondition:
+	dwIP is not already in the cache.
+
+  Parameters:
+	dwIP - IP address, in network byte order
+
+  Returns:
+  	The entry, marked ARP_ENTRY_INCOMPLETE.
+  ***************************************************************************/
+static ARP_CACHE_ENTRY* ARPNewEntry(DWORD dwIP)
+{
+	ARP_CACHE_ENTRY* e;
+	BYTE i, iVictim;
+	BYTE* pLink;
+	DWORD dwNow;
+
+	// Pick a free entry, or the least recently used one
+	dwNow = TickGet();
+	iVictim = 0;
+	for(i = 0; i < ARP_CACHE_SIZE; i++)
+	{
+		if(ARPCache[i].vState == ARP_ENTRY_FREE)
+		{
+			iVictim = i;
+			break;
+		}
+		if(dwNow - ARPCache[i].dwUsed > dwNow - ARPCache[iVictim].dwUsed)
+			iVictim = i;
+	}
+	e = &ARPCache[iVictim];
+
+	// Unlink it from the chain it is on now, if any
+	pLink = &ARPHashHeads[ARPHash(e->IPAddr.Val)];
+	while(*pLink < ARP_CACHE_SIZE)
+	{
+		if(*pLink == iVictim)
+		{
+			*pLink = e->vNext;
+			break;
+		}
+		pLink = &ARPCache[*pLink].vNext;
+	}
+
+	// Put it at the head of the new one
+	e->IPAddr.Val = dwIP;
+	e->vState = ARP_ENTRY_INCOMPLETE;
+	e->dwUsed = dwNow;
+	e->vNext = ARPHashHeads[ARPHash(dwIP)];
+	ARPHashHeads[ARPHash(dwIP)] = iVictim;
+
+	return e;
 }
 #endif
 
@@ -416,6 +566,9 @@ BOOL ARPProcess(void)
     #if defined(STACK_USE_AUTO_IP)
         BYTE i;
     #endif
+	#ifdef STACK_CLIENT_MODE
+		ARP_CACHE_ENTRY* e;
+	#endif
 	static enum
 	{
 	    SM_ARP_IDLE = 0,
@@ -450,8 +603,15 @@ BOOL ARPProcess(void)
                     if (AutoIPConfigIsInProgress(i))
                         AutoIPConflict(i);
                 #endif
-				Cache.MACAddr = packet.SenderMACAddr;
-				Cache.IPAddr = packet.SenderIPAddr;
+				// Only responses to our own requests are cached, so
+				// a chatty network cannot push out the hosts we use
+				e = ARPFindEntry(packet.SenderIPAddr.Val);
+				if(e)
+				{
+					e->MACAddr = packet.SenderMACAddr;
+					e->vState = ARP_ENTRY_RESOLVED;
+					e->dwUpdated = TickGet();
+				}
 				return TRUE;
 			}
 #endif
@@ -486,6 +646,18 @@ BOOL ARPProcess(void)
 				Target.IPAddr = packet.SenderIPAddr;
 				Target.MACAddr = packet.SenderMACAddr;
 
+#ifdef STACK_CLIENT_MODE
+				// A host asking for us tells us its own MAC; refresh 
+				// it if we already have it (RFC 826 merge)
+				e = ARPFindEntry(packet.SenderIPAddr.Val);
+				if(e)
+				{
+					e->MACAddr = packet.SenderMACAddr;
+					e->vState = ARP_ENTRY_RESOLVED;
+					e->dwUpdated = TickGet();
+				}
+#endif
+
 				smARP = SM_ARP_REPLY;
 			}
 			// Do not break.  If we get down here, we need to send a reply.	
@@ -537,6 +709,11 @@ BOOL ARPProcess(void)
   	This function transmits and ARP request to determine the hardware
   	address of a given IP address.
 
+	Nothing is sent if the address is already in the ARP cache, or if a 
+	request for it went out less than ARP_REQUEST_HOLDOFF ago, so any 
+	number of modules can resolve the same host without flooding the 
+	network.
+
   Precondition:
 	None
 
@@ -557,6 +734,7 @@ BOOL ARPProcess(void)
 void ARPResolve(IP_ADDR* IPAddr)
 {
     ARP_PACKET packet;
+	ARP_CACHE_ENTRY* e;
 
 #ifdef STACK_USE_ZEROCONF_LINK_LOCAL
 #define KS_ARP_IP_MULTICAST_HACK y
@@ -565,15 +743,19 @@ void ARPResolve(IP_ADDR* IPAddr)
     {
 		// "Resolve" the IP to MAC address mapping for
 		// IP multicast address range from 224.0.0.0 to 239.255.255.255
+		e = ARPFindEntry(IPAddr->Val);
+		if(e == NULL)
+			e = ARPNewEntry(IPAddr->Val);
 
-		Cache.MACAddr.v[0] = 0x01;
-		Cache.MACAddr.v[1] = 0x00;
-		Cache.MACAddr.v[2] = 0x5E;
-		Cache.MACAddr.v[3] = 0x7f & IPAddr->v[1];
-		Cache.MACAddr.v[4] = IPAddr->v[2];
-		Cache.MACAddr.v[5] = IPAddr->v[3];
+		e->MACAddr.v[0] = 0x01;
+		e->MACAddr.v[1] = 0x00;
+		e->MACAddr.v[2] = 0x5E;
+		e->MACAddr.v[3] = 0x7f & IPAddr->v[1];
+		e->MACAddr.v[4] = IPAddr->v[2];
+		e->MACAddr.v[5] = IPAddr->v[3];
 
-		Cache.IPAddr.Val = IPAddr->Val;
+		e->vState = ARP_ENTRY_RESOLVED;
+		e->dwUpdated = TickGet();
 
 		return;
 	}
@@ -595,6 +777,21 @@ void ARPResolve(IP_ADDR* IPAddr)
 	packet.SenderIPAddr			= AppConfig.MyIPAddr;
 #endif
 
+	// Already known, or already being asked for
+	e = ARPFindEntry(packet.TargetIPAddr.Val);
+	if(e)
+	{
+		if(e->vState == ARP_ENTRY_RESOLVED)
+			return;
+		if(TickGet() - e->dwUpdated < ARP_REQUEST_HOLDOFF)
+			return;
+	}
+	else
+	{
+		e = ARPNewEntry(packet.TargetIPAddr.Val);
+	}
+	e->dwUpdated = TickGet();
+
     ARPPut(&packet);
 }
 #endif
@@ -610,7 +807,8 @@ void ARPResolve(IP_ADDR* IPAddr)
 	
   Description:
   	This function checks if an ARP request has been resolved yet, and if
-  	so, stores the resolved MAC address in the pointer provided.
+  	so, stores the resolved MAC address in the pointer provided.  It is a
+  	hashed lookup in the ARP cache, which holds ARP_CACHE_SIZE hosts.
 
   Precondition:
 	ARP packet is ready in the MAC buffer.
@@ -639,10 +837,17 @@ void ARPResolve(IP_ADDR* IPAddr)
 #ifdef STACK_CLIENT_MODE
 BOOL ARPIsResolved(IP_ADDR* IPAddr, MAC_ADDR* MACAddr)
 {
-    if((Cache.IPAddr.Val == IPAddr->Val) || 
-	  ((Cache.IPAddr.Val == AppConfig.MyGateway.Val) && ((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val)))
+	ARP_CACHE_ENTRY* e;
+
+	// The host itself, or the gateway if it is off of our subnet
+	e = ARPFindEntry(IPAddr->Val);
+	if((e == NULL || e->vState != ARP_ENTRY_RESOLVED) && ((AppConfig.MyIPAddr.Val ^ IPAddr->Val) & AppConfig.MyMask.Val))
+		e = ARPFindEntry(AppConfig.MyGateway.Val);
+
+    if(e && e->vState == ARP_ENTRY_RESOLVED)
     {
-        *MACAddr = Cache.MACAddr;
+        *MACAddr = e->MACAddr;
+		e->dwUsed = TickGet();
         return TRUE;
     }
     return FALSE;
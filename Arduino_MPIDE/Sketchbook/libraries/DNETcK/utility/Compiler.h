@@ -109,6 +109,8 @@
     #define COMPILER_MPLAB_C32
 	#include <p32xxxx.h>
 	#include <plib.h>
+#elif defined(HOST_MAC)		// gcc on a Linux host, see HostMAC.h
+	#define COMPILER_HOST_GCC
 #else
 	#error Unknown processor or compiler.  See Compiler.h
 #endif
@@ -119,7 +121,7 @@
 
 
 // Base RAM and ROM pointer types for given architecture
-#if defined(__PIC32MX__)
+#if defined(__PIC32MX__) || defined(COMPILER_HOST_GCC)
 	#define PTR_BASE		unsigned long
 	#define ROM_PTR_BASE	unsigned long
 #elif defined(__C30__)
@@ -194,6 +196,16 @@
 			#define Nop()				asm("nop")
 		#endif
 	#endif
+
+	// Host build (HOST_MAC), nothing to map the PIC32 specifics to
+	#if defined(COMPILER_HOST_GCC)
+		#define persistent
+		#define far
+        #define FAR
+		#define Reset()				abort()
+		#define ClrWdt()
+		#define Nop()
+	#endif
 #endif
 
 
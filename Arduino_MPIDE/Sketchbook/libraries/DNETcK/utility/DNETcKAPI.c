@@ -82,16 +82,35 @@ APP_CONFIG AppConfig;
 // Here is where the chipKIT static variables and typedefs are implemented
 //***************************************************************************/
 
+// Most datagrams one socket cache will hold, no matter how small they are
+#ifndef UDP_CACHE_MAX_DATAGRAMS
+    #define UDP_CACHE_MAX_DATAGRAMS     8
+#endif
+
+#define UDP_CACHE_NO_ROOM       0xFFFFu
+
+// Each datagram is kept contiguous in the cache buffer; the descriptor says where
+typedef struct _UDPDataGram
+{
+    WORD    iStart;                 // first unread byte in rgbBuffer
+    WORD    cb;                     // unread bytes left in the datagram
+    IP_ADDR remoteIP;               // who sent it
+    WORD    remotePort;
+    DWORD   tReceived;              // TickGet() when it was cached
+} UDPDataGram;
+
 typedef struct _UDPCacheEntry
 {
     byte *  rgbBuffer;
     WORD    cbBuffer;
-    WORD    iStart;
-    WORD    cbInUse;                // total including headers
+    BYTE    iFirst;                 // oldest datagram in rgDataGram
+    BYTE    cDataGrams;
+    BOOL    fPartiallyRead;         // oldest datagram has been partly read, do not drop it
+    UDPDataGram rgDataGram[UDP_CACHE_MAX_DATAGRAMS];
 } UDPCacheEntry;
 
-#define NormalizeIndex(a, b) ((a) % (b))
-#define DataGramSize(a, b, c) (((WORD) a[NormalizeIndex(b, c)]) + (((WORD) a[NormalizeIndex(b+1, c)]) << 8))
+#define FirstDataGram(p) (&(p)->rgDataGram[(p)->iFirst])
+#define LastDataGram(p) (&(p)->rgDataGram[((p)->iFirst + (p)->cDataGrams - 1) % UDP_CACHE_MAX_DATAGRAMS])
 #define Min(a, b) ((a) < (b) ? (a) : (b))
 #define Max(a, b) ((a) > (b) ? (a) : (b))
 
@@ -99,9 +118,9 @@ static UDPCacheEntry UDPCache[MAX_UDP_SOCKETS];
 static const char * szDNSNameResolving = NULL;
 static STATUS statusDNS = DNSUninitialized;
 static IP_ADDR DNSLastResolvedHostIP;
+static DNS_HANDLE hDNSQuery = INVALID_DNS_HANDLE;
 
 static bool fIsEthernetEngineStopped = TRUE;
-static bool fDatagramPartiallyRead = FALSE;
 static bool fMacIsSet = FALSE;
 static bool fMACInitialized = FALSE;
 
@@ -317,7 +336,7 @@ void DNETcK_Init(void)
     szDNSNameResolving = NULL;
     DNSLastResolvedHostIP.Val = 0;
     statusDNS = DNSUninitialized;
-    fDatagramPartiallyRead = FALSE;
+    hDNSQuery = INVALID_DNS_HANDLE;
     fMACInitialized = FALSE;
 
     // Init the static memory in the stack subsytems
@@ -550,34 +569,95 @@ void EthernetPeriodicTasks(void)
 
 /*****************************************************************************
   Function:
-	void PutDataGramSize(WORD cbSize, WORD iSize, byte * rgbBuffer, WORD cbBuffer)
+	void DropFirstDataGram(UDPCacheEntry * pUDPE)
 
   Summary:
-	Puts the datagram size in the UDP Cache where the 2 byte size may wrap the cache
+	Removes the oldest datagram from a socket cache
 
   Description:
  
   Precondition:
+    The cache holds at least one datagram
 
   Parameters:
-	cbSize - The size of the following datagram, not including this 2 byte size field
-    iSize - index into the cache buffer to put the size, iSize only has to be the modulo of the index
-    rgbBuffer - the UDP cache buffer
-    cbBuffer - The size of the UDP cache
+    pUDPE - A pointer to the socket cache.
  
   Returns:
 	None
 
   Remarks:
-    This will nomalize iSize before indexing in the cache; the size can span the end
-    of the cache and wrap to the start.
+    Only the descriptor is released, the bytes are left where they are.
+
+ ***************************************************************************/
+static void DropFirstDataGram(UDPCacheEntry * pUDPE)
+{
+    pUDPE->iFirst = (pUDPE->iFirst + 1) % UDP_CACHE_MAX_DATAGRAMS;
+    pUDPE->cDataGrams--;
+
+    // we are clean to a new datagram
+    pUDPE->fPartiallyRead = FALSE;
+}
+
+/*****************************************************************************
+  Function:
+	WORD AllocDataGram(UDPCacheEntry * pUDPE, WORD cbDataGram)
+
+  Summary:
+	Finds a contiguous run in the socket cache for a new datagram
+
+  Description:
+    The cached datagrams sit back to back from the oldest to the newest,
+    wrapping to the start of the buffer when the newest does not fit at the end.
+    So the free space is either after the newest plus before the oldest, or
+    if we have already wrapped, the gap between the newest and the oldest.
+ 
+  Precondition:
+    There is a free descriptor
+
+  Parameters:
+    pUDPE - A pointer to the socket cache.
+    cbDataGram - the size of the datagram to store
+ 
+  Returns:
+	The index in the cache to put the datagram, or UDP_CACHE_NO_ROOM if
+    older datagrams must be dropped first
+
+  Remarks:
 
  ***************************************************************************/
-static void PutDataGramSize(WORD cbSize, WORD iSize, byte * rgbBuffer, WORD cbBuffer)
+static WORD AllocDataGram(UDPCacheEntry * pUDPE, WORD cbDataGram)
 {
-    rgbBuffer[NormalizeIndex(iSize, cbBuffer)] = (byte) (cbSize & 0x00FF);
-    iSize++;
-    rgbBuffer[NormalizeIndex(iSize, cbBuffer)] = (byte) ((cbSize & 0xFF00) >> 8);
+    WORD iHead = 0;
+    WORD iTail = 0;
+
+    if(pUDPE->cDataGrams == 0)
+    {
+        return(cbDataGram <= pUDPE->cbBuffer ? 0 : UDP_CACHE_NO_ROOM);
+    }
+
+    iHead = FirstDataGram(pUDPE)->iStart;
+    iTail = LastDataGram(pUDPE)->iStart + LastDataGram(pUDPE)->cb;
+
+    // not wrapped, room at the end or at the start
+    if(iTail > iHead)
+    {
+        if(pUDPE->cbBuffer - iTail >= cbDataGram)
+        {
+            return(iTail);
+        }
+        else if(iHead >= cbDataGram)
+        {
+            return(0);
+        }
+    }
+
+    // wrapped, only the gap up to the oldest datagram is free
+    else if(iHead - iTail >= cbDataGram)
+    {
+        return(iTail);
+    }
+
+    return(UDP_CACHE_NO_ROOM);
 }
 
 /*****************************************************************************
@@ -600,13 +680,14 @@ static void PutDataGramSize(WORD cbSize, WORD iSize, byte * rgbBuffer, WORD cbBu
 
   Remarks:
     This needs to be called with each pass of periodicTasks() to keep the socket caches up to date.
+    The oldest datagrams are dropped, a whole datagram at a time, to make room for the new one.
 
  ***************************************************************************/
 static void UpdateUDPEntryCache(UDP_SOCKET hUDP, UDPCacheEntry * pUDPE)
 {
     WORD cbReady = 0;
-    DWORD cbT = 0;
-    DWORD iEnd = 0;
+    WORD iStart = 0;
+    UDPDataGram * pDataGram = NULL;
 
     if(pUDPE->rgbBuffer == NULL)
     {
@@ -615,7 +696,6 @@ static void UpdateUDPEntryCache(UDP_SOCKET hUDP, UDPCacheEntry * pUDPE)
 
     // see what we need to read
     cbReady = UDPIsGetReady(hUDP);
-    cbT = cbReady + pUDPE->cbInUse + sizeof(WORD);
 
     // if there is nothing to read, we are done
     if(cbReady == 0) 
@@ -624,59 +704,35 @@ static void UpdateUDPEntryCache(UDP_SOCKET hUDP, UDPCacheEntry * pUDPE)
     }
 
     // too big for us to cache it, just dump it; but don't purge existing data in the cache
-    // or we have freezed the cache and we don't have room for this datagram
-    else if(cbReady + sizeof(WORD) > pUDPE->cbBuffer  || (fDatagramPartiallyRead && cbT > pUDPE->cbBuffer))
+    else if(cbReady > pUDPE->cbBuffer)
     {
-        void UDPDiscard();
+        UDPDiscard();
         return;
     }
 
-    // or we need to dump some old datagrams
-    else if(cbT > pUDPE->cbBuffer) 
+    // dump old datagrams until we have a descriptor and a run of the buffer for this one
+    while(pUDPE->cDataGrams == UDP_CACHE_MAX_DATAGRAMS || (iStart = AllocDataGram(pUDPE, cbReady)) == UDP_CACHE_NO_ROOM)
     {
-        DWORD iStart = pUDPE->iStart;
-        DWORD cbDump = cbT - pUDPE->cbBuffer;
-        DWORD cbDumped = 0;
-        DWORD cbDataGram = 0;
-
-        // we want to maintian the integrity of datagrams, do not chop them
-        // so when we dump, dump the whole datagram.            
-        do
+        // we have freezed the cache and we don't have room for this datagram
+        if(pUDPE->fPartiallyRead)
         {
-            cbDataGram = DataGramSize(pUDPE->rgbBuffer, iStart, pUDPE->cbBuffer) + sizeof(WORD);
-            cbDumped += cbDataGram;
-            iStart += cbDataGram;
-        } while(cbDump > cbDumped);
-        
-        pUDPE->iStart = NormalizeIndex(iStart, pUDPE->cbBuffer);          
-        pUDPE->cbInUse -= cbDumped;
-    }
-
-    // at this point we have the room in the cache, and we can save the whole datagram and header
-
-    // put the datagram length in, in two steps in case we are wrapping in the cache
-    iEnd = NormalizeIndex(pUDPE->iStart + pUDPE->cbInUse, pUDPE->cbBuffer);
-    PutDataGramSize(cbReady, iEnd, pUDPE->rgbBuffer, pUDPE->cbBuffer);
-    iEnd += sizeof(WORD);
-    pUDPE->cbInUse += sizeof(WORD);
+            UDPDiscard();
+            return;
+        }
 
-    // see how much we can read in the first pass.
-    iEnd = NormalizeIndex(iEnd, pUDPE->cbBuffer);
-    cbT = pUDPE->cbBuffer - iEnd;
-    cbT = Min(cbT, cbReady);
+        DropFirstDataGram(pUDPE);
+    }
 
-    // 1st pass read
-    UDPGetArray(&pUDPE->rgbBuffer[iEnd], cbT);
-    cbReady -= cbT;
-    pUDPE->cbInUse += cbT;
+    // at this point we have the room in the cache, and we can save the whole datagram
+    pDataGram = &pUDPE->rgDataGram[(pUDPE->iFirst + pUDPE->cDataGrams) % UDP_CACHE_MAX_DATAGRAMS];
+    pDataGram->iStart = iStart;
+    pDataGram->cb = cbReady;
+    pDataGram->remoteIP = UDPSocketInfo[hUDP].remoteNode.IPAddr;
+    pDataGram->remotePort = UDPSocketInfo[hUDP].remotePort;
+    pDataGram->tReceived = TickGet();
+    pUDPE->cDataGrams++;
 
-    // the rest of the bytes should be able to read in the 2nd pass
-    if(cbReady > 0)
-    {
-        iEnd = NormalizeIndex(iEnd + cbT, pUDPE->cbBuffer);
-        UDPGetArray(&pUDPE->rgbBuffer[iEnd], cbReady);
-        pUDPE->cbInUse += cbReady;
-    }  
+    UDPGetArray(&pUDPE->rgbBuffer[iStart], cbReady);
 }
 
 /*****************************************************************************
@@ -730,7 +786,7 @@ static void UpdateUDPCache(void)
 	The old socket cache buffer pointer
 
   Remarks:
-    This needs to be called with each pass of periodicTasks() to keep the socket caches up to date.
+    Datagrams that fit are packed to the start of the new cache in order, the rest are dropped.
 
  ***************************************************************************/
 byte * ExchangeCacheBuffer(byte hUDP, byte *rgbBufferNew, unsigned short cbBufferNew)
@@ -738,55 +794,53 @@ byte * ExchangeCacheBuffer(byte hUDP, byte *rgbBufferNew, unsigned short cbBuffe
     UDPCacheEntry * pUDPE = &UDPCache[hUDP];
 
     byte * rgbBuffOld = pUDPE->rgbBuffer;
-    WORD cbLeftToCheck = pUDPE->cbInUse;;
-    WORD iOldBuff = 0;
-
-    WORD cbInUseNew = 0;
+    BYTE cDataGramsNew = 0;
     WORD iNewBuff = 0;
-    WORD cbRemaining = cbBufferNew;
-
-    WORD cbDataGram = 0;
+    BYTE i = 0;
 
     // if nothing to copy or blanking out 
-    if(rgbBufferNew == NULL || pUDPE->rgbBuffer == NULL || pUDPE->cbInUse == 0  || pUDPE->cbBuffer == 0)
+    if(rgbBufferNew == NULL || pUDPE->rgbBuffer == NULL)
     {
-        pUDPE->cbInUse = 0; 
+        pUDPE->cDataGrams = 0;
     }
 
     else
     {
-
-        // copy over datagrams that fit
-        iOldBuff = NormalizeIndex(pUDPE->iStart, pUDPE->cbBuffer);
-        while(cbLeftToCheck > 0)
+        // copy over datagrams that fit, compacting the descriptors as we go
+        for(i = 0; i < pUDPE->cDataGrams; i++)
         {
-            cbDataGram = DataGramSize(pUDPE->rgbBuffer, iOldBuff, pUDPE->cbBuffer) + sizeof(WORD);
-            if(cbDataGram < cbRemaining)
+            UDPDataGram * pDataGram = &pUDPE->rgDataGram[(pUDPE->iFirst + i) % UDP_CACHE_MAX_DATAGRAMS];
+
+            if(pDataGram->cb <= cbBufferNew - iNewBuff)
             {
-                WORD i = 0;
+                UDPDataGram * pDataGramNew = &pUDPE->rgDataGram[(pUDPE->iFirst + cDataGramsNew) % UDP_CACHE_MAX_DATAGRAMS];
 
-                // copy the bytes
-                for(i = 0; i < cbDataGram; i++)
-                {
-                    rgbBufferNew[iNewBuff] = pUDPE->rgbBuffer[iOldBuff];
-                    iNewBuff++;
-                    iOldBuff = NormalizeIndex(iOldBuff+1, pUDPE->cbBuffer);
-                }
-          
-                cbInUseNew += cbDataGram;
-                cbRemaining -= cbDataGram;
+                memmove(&rgbBufferNew[iNewBuff], &pUDPE->rgbBuffer[pDataGram->iStart], pDataGram->cb);
+                *pDataGramNew = *pDataGram;
+                pDataGramNew->iStart = iNewBuff;
+
+                iNewBuff += pDataGram->cb;
+                cDataGramsNew++;
+            }
+
+            // the partly read datagram is gone
+            else if(i == 0)
+            {
+                pUDPE->fPartiallyRead = FALSE;
             }
-            cbLeftToCheck -= cbDataGram;
         }
 
-        // fix up the new pointers
-        pUDPE->cbInUse = cbInUseNew; 
+        pUDPE->cDataGrams = cDataGramsNew;
+    }
+
+    if(pUDPE->cDataGrams == 0)
+    {
+        pUDPE->iFirst = 0;
+        pUDPE->fPartiallyRead = FALSE;
     }
 
-    // everything is fixed up to the start of the cache
     pUDPE->rgbBuffer = rgbBufferNew;
     pUDPE->cbBuffer = cbBufferNew;
-    pUDPE->iStart = 0;
 
     return(rgbBuffOld);
 }
@@ -942,6 +996,7 @@ bool EthernetIsDNSResolved(const char * szHostName, byte * pIP, unsigned long ms
     DWORD tStart = 0;
     DWORD tWait = msBlockMax * TICKS_PER_MILSECOND;
     static bool fRecursive = FALSE;
+    IP_ADDR ipCached;
 
     EthernetPeriodicTasks();
 
@@ -963,6 +1018,17 @@ bool EthernetIsDNSResolved(const char * szHostName, byte * pIP, unsigned long ms
         return(FALSE);
     }
 
+    // a recent answer for this name needs neither a DNS query nor the network
+    if(DNSCacheLookup((BYTE *) szHostName, DNS_TYPE_A, &ipCached))
+    {
+        if(ipCached.Val != 0 && pIP != NULL)
+        {
+            *((IP_ADDR *) pIP) = ipCached;
+        }
+        if(pStatus != NULL) *pStatus = (ipCached.Val != 0) ? DNSLookupSuccess : DNSResolutionFailed;
+        return(ipCached.Val != 0);
+    }
+
     // FROM HERE ON THIS ROUTINE MUST EXIT AT THE END
     // SO THE RECURSION FLAG CAN BE RESET, NOT JUST RETURN
     fRecursive = TRUE;
@@ -993,21 +1059,18 @@ bool EthernetIsDNSResolved(const char * szHostName, byte * pIP, unsigned long ms
 
         case DNSIsBusy:
 
-            // someone else may be resolving a DNS lookup
-            // and this could be a stack application such as SNTP (in fact this is the case many times)
-            // we need to wait a while for it to clear, and we need to run EthernetPeriodicTasks(void)
-            // in order to make sure the DNS lock gets released; but EthernetPeriodicTasks(void) calls
+            // our query runs alongside the DNS lookups of stack applications
+            // such as SNTP, which use the DNSBeginUsage lock, so we are only
+            // busy if every query is taken; then we need to run EthernetPeriodicTasks(void)
+            // for one to be freed, but EthernetPeriodicTasks(void) calls
             // EthernetIsDNSResolved and that can call recursion, so we must block recursion in EthernetIsDNSResolved.
   
             // it is very important that once
-            // we aquire the DNS lock, that 
+            // we take a query, that 
             // statusDNS stays at DNSResolving
-            // until the DNS lock is released
-            // this tells me that my engine is attempting a resolve
-            // and not something else in the system trying to do a DNS lookup
-            if(DNSBeginUsage())
+            // until the query is ended
+            if((hDNSQuery = DNSQueryBegin((BYTE *) szHostName, DNS_TYPE_A)) != INVALID_DNS_HANDLE)
             {
-                DNSResolve((byte *) szHostName, DNS_TYPE_A);
                 statusDNS = DNSResolving;
             }
             else 
@@ -1019,9 +1082,12 @@ bool EthernetIsDNSResolved(const char * szHostName, byte * pIP, unsigned long ms
         // if we get here, we are resolving
         case DNSResolving:
 
-            if(DNSIsResolved(&DNSLastResolvedHostIP))
+            if(DNSQueryIsResolved(hDNSQuery, &DNSLastResolvedHostIP))
             {
-                if(DNSEndUsage())
+                BOOL fValid = DNSQueryEnd(hDNSQuery);
+
+                hDNSQuery = INVALID_DNS_HANDLE;
+                if(fValid)
                 {
                     statusDNS = DNSLookupSuccess;
                     if(pIP != NULL)
@@ -1139,7 +1205,7 @@ bool EthernetIsARPIpMacResolved(const byte * pIP, byte * pMAC, unsigned long msB
     void EthernetDNSTerminate(void)
 
   Description:
-    Forcefully teriminates a DNS resolution and frees the DNS lock
+    Forcefully teriminates a DNS resolution and frees its DNS query
 
   Precondition:
  
@@ -1153,13 +1219,14 @@ bool EthernetIsARPIpMacResolved(const byte * pIP, byte * pMAC, unsigned long msB
   ***************************************************************************/
 void EthernetDNSTerminate(void)
 {
-    // if we are the owner of the DNS engine, then
-    // we will have the DNS lock and that is identified
+    // if we are resolving, then
+    // we will have a DNS query and that is identified
     // by being in the DNSResolving state
     if(statusDNS == DNSResolving)
     {
-        // just blow the lock away
-        DNSEndUsage();
+        // just blow the query away
+        DNSQueryEnd(hDNSQuery);
+        hDNSQuery = INVALID_DNS_HANDLE;
         statusDNS = DNSUninitialized;
     }
     EthernetPeriodicTasks();
@@ -1186,7 +1253,7 @@ void EthernetDNSTerminate(void)
   ***************************************************************************/
 byte TcpClientConnectByName(const char * szHostName, unsigned short port)
 {
-    TCP_SOCKET hTCP = TCPOpen((DWORD) szHostName, TCP_OPEN_RAM_HOST, (WORD) port, TCP_PURPOSE_DEFAULT);
+    TCP_SOCKET hTCP = TCPOpen((PTR_BASE) szHostName, TCP_OPEN_RAM_HOST, (WORD) port, TCP_PURPOSE_DEFAULT);
     EthernetPeriodicTasks();
     return(hTCP);
 }
@@ -1332,6 +1399,35 @@ void GetUdpSocketEndPoints(UDP_SOCKET hUDP, IP_ADDR * pRemoteIP, MAC_ADDR * pRem
     *pLocalPort = UDPSocketInfo[hUDP].localPort;
 }
 
+/****************************************************************************
+  Function:
+    UDPCacheEntry * GetUDPCacheWithData(byte hUDP)
+
+  Description:
+    Gets the socket cache if it has a datagram in it
+
+  Precondition:
+ 
+  Parameters:
+    hUDP        - The socket to get the cache for
+
+  Returns:
+    The socket cache, or NULL if the socket is not valid or there are no datagrams
+
+  Remarks:  
+    None
+  ***************************************************************************/
+static UDPCacheEntry * GetUDPCacheWithData(byte hUDP)
+{
+    // not a valid request
+    if(hUDP >= MAX_UDP_SOCKETS || UDPCache[hUDP].rgbBuffer == NULL || UDPCache[hUDP].cDataGrams == 0)
+    {
+        return(NULL);
+    }
+
+    return(&UDPCache[hUDP]);
+}
+
 /****************************************************************************
   Function:
     unsigned short UdpClientAvailable(byte hUDP)
@@ -1352,16 +1448,17 @@ void GetUdpSocketEndPoints(UDP_SOCKET hUDP, IP_ADDR * pRemoteIP, MAC_ADDR * pRem
   ***************************************************************************/
 unsigned short UdpClientAvailable(byte hUDP)
 {
+    UDPCacheEntry * pUDPE = NULL;
+
     // run the the stack
     EthernetPeriodicTasks();
 
-    // not a valid request
-    if(hUDP >= MAX_UDP_SOCKETS || UDPCache[hUDP].rgbBuffer == NULL || UDPCache[hUDP].cbInUse == 0)
+    if((pUDPE = GetUDPCacheWithData(hUDP)) == NULL)
     {
         return(0);
     }
 
-    return(DataGramSize(UDPCache[hUDP].rgbBuffer, UDPCache[hUDP].iStart, UDPCache[hUDP].cbBuffer));
+    return(FirstDataGram(pUDPE)->cb);
 }
 
 /****************************************************************************
@@ -1384,23 +1481,14 @@ unsigned short UdpClientAvailable(byte hUDP)
   ***************************************************************************/
 void UdpClientEmptyNextDataGram(byte hUDP)
 {
-    WORD cbDataGram = 0;
+    UDPCacheEntry * pUDPE = NULL;
 
-    // not a valid request
-    if(hUDP >= MAX_UDP_SOCKETS || UDPCache[hUDP].rgbBuffer == NULL || UDPCache[hUDP].cbInUse == 0)
+    if((pUDPE = GetUDPCacheWithData(hUDP)) == NULL)
     {
         return;
     }
 
-    // get the length to the next datagarm
-    cbDataGram = DataGramSize(UDPCache[hUDP].rgbBuffer, UDPCache[hUDP].iStart, UDPCache[hUDP].cbBuffer) + sizeof(WORD);
-
-    // fixup the buffer to remove this data gram
-    UDPCache[hUDP].cbInUse -= cbDataGram;
-    UDPCache[hUDP].iStart = NormalizeIndex(UDPCache[hUDP].iStart + cbDataGram, UDPCache[hUDP].cbBuffer);
-
-    // we are clean to a new datagram
-    fDatagramPartiallyRead = FALSE;
+    DropFirstDataGram(pUDPE);
 }
 
 /****************************************************************************
@@ -1424,52 +1512,32 @@ void UdpClientEmptyNextDataGram(byte hUDP)
   ***************************************************************************/
 unsigned short UdpClientRemoveBytesFromDataGram(byte hUDP, unsigned short cbRemove)
 {
-    WORD cbDataGram = 0;
+    UDPCacheEntry * pUDPE = NULL;
+    UDPDataGram * pDataGram = NULL;
 
-    // not a valid request
-    if(hUDP >= MAX_UDP_SOCKETS || UDPCache[hUDP].rgbBuffer == NULL || UDPCache[hUDP].cbInUse == 0)
+    if((pUDPE = GetUDPCacheWithData(hUDP)) == NULL)
     {
-        return;
+        return(0);
     }
 
-    cbDataGram = DataGramSize(UDPCache[hUDP].rgbBuffer, UDPCache[hUDP].iStart, UDPCache[hUDP].cbBuffer);
-    cbRemove = Min(cbRemove, cbDataGram);
+    pDataGram = FirstDataGram(pUDPE);
 
     // we are removing the whole datagram
-    if(cbRemove == cbDataGram)
+    if(cbRemove >= pDataGram->cb)
     {
-        // we are removing the header, remove it as well
-        cbDataGram += sizeof(WORD);
-
-        // fixup the buffer to remove this data gram
-        UDPCache[hUDP].cbInUse -= cbDataGram;
-        UDPCache[hUDP].iStart = NormalizeIndex(UDPCache[hUDP].iStart + cbDataGram, UDPCache[hUDP].cbBuffer);
-
-        // we are clean to a new datagram
-        fDatagramPartiallyRead = FALSE;
-
+        DropFirstDataGram(pUDPE);
         return(0);
     }
 
-    // it is a partial datagram
-    else
-    {
-    WORD cbLeft = cbDataGram - cbRemove;
-
-    // fixup the buffer to remove this data gram
-    UDPCache[hUDP].cbInUse -= cbRemove;
-    UDPCache[hUDP].iStart = NormalizeIndex(UDPCache[hUDP].iStart + cbRemove, UDPCache[hUDP].cbBuffer);
-
-    // iStart points to were the size needs to be put, but we must write the updated size there.
-    PutDataGramSize(cbLeft, UDPCache[hUDP].iStart, UDPCache[hUDP].rgbBuffer, UDPCache[hUDP].cbBuffer);
-
+    // it is a partial datagram, just move the start up
+    pDataGram->iStart += cbRemove;
+    pDataGram->cb -= cbRemove;
 
     // partially read datagram, free the cache if we overflow
-    fDatagramPartiallyRead = TRUE;
+    pUDPE->fPartiallyRead = TRUE;
 
     // return how much is left in there
-    return(cbLeft);
-    }
+    return(pDataGram->cb);
 }
 
 /****************************************************************************
@@ -1495,47 +1563,137 @@ unsigned short UdpClientRemoveBytesFromDataGram(byte hUDP, unsigned short cbRemo
   ***************************************************************************/
 unsigned short UdpClientPeek(byte hUDP, byte *rgbPeek, unsigned short cbPeekMax, unsigned short iIndex)
 {
-    WORD cbDataGram = 0;
-    WORD iStart = 0;
-    WORD cbRead = 0;
+    UDPCacheEntry * pUDPE = NULL;
+    UDPDataGram * pDataGram = NULL;
 
-    // not a valid request
-    if(hUDP >= MAX_UDP_SOCKETS || UDPCache[hUDP].rgbBuffer == NULL || UDPCache[hUDP].cbInUse == 0)
+    if((pUDPE = GetUDPCacheWithData(hUDP)) == NULL)
     {
         return(0);
     }
 
-    cbDataGram = DataGramSize(UDPCache[hUDP].rgbBuffer, UDPCache[hUDP].iStart, UDPCache[hUDP].cbBuffer);
+    pDataGram = FirstDataGram(pUDPE);
  
     // see if we are peeking with an offset
-    if(iIndex >= cbDataGram)
+    if(iIndex >= pDataGram->cb)
     {
         return(0);
     }
-    else 
+
+    // the datagram is contiguous in the cache
+    cbPeekMax = Min(cbPeekMax, pDataGram->cb - iIndex);
+    memcpy(rgbPeek, &pUDPE->rgbBuffer[pDataGram->iStart + iIndex], cbPeekMax);
+
+    // return how many bytes read
+    return(cbPeekMax);
+}
+
+/****************************************************************************
+  Function:
+    const byte * UdpClientBorrowDataGram(byte hUDP, unsigned short * pcbDataGram)
+
+  Description:
+    Gets a pointer to the unread bytes of the next datagram right in the socket cache
+
+  Precondition:
+ 
+  Parameters:
+    hUDP        - The socket to get the cache for
+    pcbDataGram - receives the number of unread bytes at the returned pointer
+
+  Returns:
+    A pointer to the datagram bytes, or NULL if there is no datagram
+
+  Remarks:  
+    The datagram is contiguous so no copy is needed. The pointer is good until the
+    datagram is removed with UdpClientRemoveBytesFromDataGram or UdpClientEmptyNextDataGram,
+    or until the stack is run again and the datagram is dropped to make room for new ones.
+  ***************************************************************************/
+const byte * UdpClientBorrowDataGram(byte hUDP, unsigned short * pcbDataGram)
+{
+    UDPCacheEntry * pUDPE = NULL;
+    UDPDataGram * pDataGram = NULL;
+
+    *pcbDataGram = 0;
+
+    if((pUDPE = GetUDPCacheWithData(hUDP)) == NULL)
     {
-        cbDataGram -= iIndex;
+        return(NULL);
     }
-   cbPeekMax = Min(cbPeekMax, cbDataGram);
 
-    // Skip the size and get to the data
-    iStart = NormalizeIndex(UDPCache[hUDP].iStart + iIndex + sizeof(WORD), UDPCache[hUDP].cbBuffer);
+    pDataGram = FirstDataGram(pUDPE);
+    *pcbDataGram = pDataGram->cb;
+
+    return(&pUDPE->rgbBuffer[pDataGram->iStart]);
+}
+
+/****************************************************************************
+  Function:
+    bool UdpClientGetDataGramSource(byte hUDP, byte * pIP, unsigned short * pPort)
+
+  Description:
+    Gets the endpoint that sent the next datagram in the socket cache
 
-    // Read what I can until the end of the buffer
-    cbRead = Min(UDPCache[hUDP].cbBuffer - iStart, cbPeekMax);
-    memcpy(rgbPeek, &UDPCache[hUDP].rgbBuffer[iStart], cbRead);
+  Precondition:
+ 
+  Parameters:
+    hUDP        - The socket to get the cache for
+    pIP         - receives the 4 byte IP address of the sender
+    pPort       - receives the port the sender sent from
+
+  Returns:
+    TRUE if there is a datagram, FALSE if not
 
-    // and then from the start of the buffer read the rest
-    if(cbRead < cbPeekMax)
+  Remarks:  
+    
+  ***************************************************************************/
+bool UdpClientGetDataGramSource(byte hUDP, byte * pIP, unsigned short * pPort)
+{
+    UDPCacheEntry * pUDPE = NULL;
+    UDPDataGram * pDataGram = NULL;
+
+    if((pUDPE = GetUDPCacheWithData(hUDP)) == NULL)
     {
-        // this should calculate to zero; as we wrapping in the cache
-        iStart = NormalizeIndex(iStart + cbRead, UDPCache[hUDP].cbBuffer);
+        return(FALSE);
+    }
+
+    pDataGram = FirstDataGram(pUDPE);
+    memcpy(pIP, &pDataGram->remoteIP, sizeof(IP_ADDR));
+    *pPort = pDataGram->remotePort;
+
+    return(TRUE);
+}
 
-        // read the rest of the data
-        memcpy(&rgbPeek[cbRead], &UDPCache[hUDP].rgbBuffer[iStart], cbPeekMax - cbRead);
+/****************************************************************************
+  Function:
+    bool UdpClientGetDataGramAge(byte hUDP, unsigned long * pmsAge)
+
+  Description:
+    Gets how long ago the next datagram in the socket cache was received
+
+  Precondition:
+ 
+  Parameters:
+    hUDP        - The socket to get the cache for
+    pmsAge      - receives the milliseconds since the datagram was taken off the MAC
+
+  Returns:
+    TRUE if there is a datagram, FALSE if not
+
+  Remarks:  
+    The time is when EthernetPeriodicTasks copied the datagram into the cache,
+    so it is late by however long the sketch took to run the stack.
+  ***************************************************************************/
+bool UdpClientGetDataGramAge(byte hUDP, unsigned long * pmsAge)
+{
+    UDPCacheEntry * pUDPE = NULL;
+
+    if((pUDPE = GetUDPCacheWithData(hUDP)) == NULL)
+    {
+        return(FALSE);
     }
 
-    // return how many bytes read
-    return(cbPeekMax);
+    *pmsAge = (TickGet() - FirstDataGram(pUDPE)->tReceived) / TICKS_PER_MILSECOND;
+
+    return(TRUE);
 }
 
@@ -60,6 +60,10 @@ extern "C"
     unsigned short TCPIsPutReady(byte hTCP);
     void TCPFlush(byte hTCP);
     unsigned short TCPPutArray(byte hTCP, const byte * rgbData, unsigned short cbData);
+    void TCPSetCork(byte hTCP, bool fCork);
+    void TCPSetEventHandler(byte hTCP, void (* pfnHandler)(byte hTCP, byte events, void * pvContext), void * pvContext);
+    void TCPDispatchEvents(void);
+    bool TCPIsCorked(byte hTCP);
 
     unsigned short TCPIsGetReady(byte hTCP);
     void TCPDiscard(byte hTCP);
@@ -68,10 +72,12 @@ extern "C"
 
     byte TCPPeek(byte hTCP, unsigned short index);
     unsigned short TCPPeekArray(byte hTCP, byte *rgbPeek, unsigned short cbPeekRequest, unsigned short index);
+    unsigned short TCPConsume(byte hTCP, unsigned short cbConsume);
    
     unsigned long SNTPGetUTCSeconds(void);
 
     void GetTcpSocketEndPoints(byte hTCP, IPv4 * pRemoteIP, MAC * pRemoteMAC, unsigned short * pRemotePort, unsigned short * pLocalPort);
+    unsigned short GetTcpRxSpans(byte hTCP, const byte ** ppHead, unsigned short * pcbHead, const byte ** ppWrap, unsigned short * pcbWrap);
     void GetUdpSocketEndPoints(byte hUDP, IPv4 * pRemoteIP, MAC * pRemoteMAC, unsigned short * pRemotePort, unsigned short * pLocalPort);
 
     unsigned short UDPIsGetReady(byte hUDP);
@@ -81,6 +87,7 @@ extern "C"
     unsigned short UDPIsPutReady(byte hUDP);
     unsigned short UDPPutArray(const byte * rgbWrite, unsigned short cbWrite);
     void UDPFlush(void);
+    unsigned short UDPPutDatagrams(byte hUDP, const MALUdpDatagram * rgDatagrams, unsigned short cDatagrams);
 
     byte UDPOpen(unsigned short localPort, void * forServerIsNull, unsigned short remotePort); 
 
@@ -138,6 +145,9 @@ extern "C"
     void UdpClientEmptyNextDataGram(byte hUDP);
     unsigned short UdpClientRemoveBytesFromDataGram(byte hUDP, unsigned short cbRemove);
     unsigned short UdpClientPeek(byte hUDP, byte *rgbPeek, unsigned short cbPeekMax, unsigned short iIndex);
+    const byte * UdpClientBorrowDataGram(byte hUDP, unsigned short * pcbDataGram);
+    bool UdpClientGetDataGramSource(byte hUDP, byte * pIP, unsigned short * pPort);
+    bool UdpClientGetDataGramAge(byte hUDP, unsigned long * pmsAge);
 
     // this is a helper macro to insure that timers handle rollover conditions
     // this calcuates the difference of 32 bit counters with 
@@ -148,7 +158,9 @@ extern "C"
     // as long as they are consistant, and that they are at least 32 bits in value. Larger values
     // are fine with the restruction that the larges difference in time that this macro can handle is 0xFFFFFFFE ticks
     // a tWait value of 0xFFFFFFFF will wait forever as the > condition will never be satisfied.
-    #define hasTimeElapsed(tStart, tWait, tNow) ((((unsigned long) (tNow)) - ((unsigned long) (tStart))) > ((unsigned long) (tWait)))
+    // a tWait of 0 (msImmediate) has always elapsed, or a do-while loop on it would spin until
+    // the next tick and an "immediate" call could block for up to a millisecond.
+    #define hasTimeElapsed(tStart, tWait, tNow) (((unsigned long) (tWait)) == 0 || (((unsigned long) (tNow)) - ((unsigned long) (tStart))) > ((unsigned long) (tWait)))
 
 #ifdef __cplusplus
 }
@@ -67,37 +67,69 @@
 
 #define DNS_PORT		53u					// Default port for DNS resolutions
 #define DNS_TIMEOUT		(TICK_SECOND*1)		// Elapsed time after which a DNS resolution is considered to have timed out
+#define DNS_MAX_ATTEMPTS	3u					// Queries per resolution, alternating between the servers if there are two
+
+// Resolutions that may be in progress at once.  Query 0 is the one 
+// DNSBeginUsage() hands out to the stack's own modules; the rest go to 
+// DNSQueryBegin().  All of them share one UDP socket and each answer is 
+// matched to its query by transaction ID.
+#ifndef DNS_MAX_QUERIES
+	#define DNS_MAX_QUERIES		3u
+#endif
+#define DNS_USAGE_QUERY			0u
 
-static UDP_SOCKET MySocket = INVALID_UDP_SOCKET;	// UDP socket to use for DNS queries
-static BYTE *DNSHostName;							// Host name in RAM to look up
-static ROM BYTE *DNSHostNameROM;					// Host name in ROM to look up
-static BYTE RecordType;								// Record type being queried
-static NODE_INFO ResolvedInfo;						// Node information about the resolved node
+// Number of recent answers kept, so a host name looked up again is 
+// answered without going to the DNS server
+#ifndef DNS_CACHE_SIZE
+	#define DNS_CACHE_SIZE		4u
+#endif
+#define DNS_CACHE_NAME_LEN		40u					// Longer host names are not cached
+#define DNS_CACHE_MAX_TTL		(3600ul)			// Seconds; longer record TTLs are cut to this
+#define DNS_NEGATIVE_TTL		(30ul)				// Seconds to remember that a name does not exist
 
-// Semaphore flags for the DNS module
-static union
+typedef struct
 {
-	BYTE Val;
-	struct
-	{
-		unsigned char DNSInUse 		: 1;	// Indicates the DNS module is in use
-		unsigned char AddressValid	: 1;	// Indicates that the address resolution is valid and complete
-		unsigned char filler 		: 6;
-	} bits;
-} Flags = {0x00};
+	DWORD	dwExpires;						// Tick when this answer goes stale
+	IP_ADDR	IPAddr;							// 0.0.0.0 for a name that does not exist
+	BYTE	vType;							// DNS_TYPE_A or DNS_TYPE_MX
+	BYTE	szName[DNS_CACHE_NAME_LEN];		// Empty for an unused entry
+} DNS_CACHE_ENTRY;
+
+static DNS_CACHE_ENTRY DNSCache[DNS_CACHE_SIZE];
 
 // State machine for a DNS query
-static enum
+typedef enum
 {
-	DNS_START = 0, 				// Initial state to reset client state variables
+	DNS_FREE = 0,				// Query not in use
+	DNS_START, 					// Initial state to reset client state variables
 	DNS_ARP_START_RESOLVE,		// Send ARP resolution of DNS server or gateway MAC address
 	DNS_ARP_RESOLVE,			// Wait for response to ARP request
-	DNS_OPEN_SOCKET,			// Open UDP socket
 	DNS_QUERY,					// Send DNS query to DNS server
 	DNS_GET_RESULT,				// Wait for response from DNS server
 	DNS_FAIL,					// ARP or DNS server not responding
 	DNS_DONE					// DNS query is finished
-} smDNS = DNS_DONE;
+} SM_DNS;
+
+typedef struct
+{
+	BYTE *		Hostname;					// Host name in RAM to look up
+	ROM BYTE *	HostnameROM;				// Host name in ROM to look up
+	DWORD		StartTime;
+	NODE_INFO	Server;						// DNS server the query is sent to
+	IP_ADDR		IPAddr;						// The answer
+	WORD_VAL	TransactionID;				// ID of the query last sent
+	BYTE		vType;						// Record type being queried
+	BYTE		sm;							// SM_DNS
+	BYTE		vServer;					// 0 for the primary DNS server, 1 for the secondary
+	BYTE		vARPAttemptCount;
+	BYTE		vDNSAttemptCount;
+	BYTE		bAddressValid;				// The resolution is complete and IPAddr is valid
+} DNS_QUERY_INFO;
+
+static DNS_QUERY_INFO DNSQueries[DNS_MAX_QUERIES];
+static UDP_SOCKET MySocket = INVALID_UDP_SOCKET;	// UDP socket to use for DNS queries, open while any query is
+static WORD_VAL LastTransactionID;			// ID of the last query sent
+static BYTE vAnsweringServer;				// Server that answered last, asked first next time
 
 // Structure for the DNS header
 typedef struct
@@ -127,6 +159,11 @@ typedef struct
 
 static void DNSPutString(BYTE* String);
 static void DNSDiscardName(void);
+static DNS_CACHE_ENTRY* DNSCacheFind(BYTE* Hostname, BYTE Type);
+static void DNSCacheAdd(BYTE* Hostname, BYTE Type, DWORD dwIP, DWORD dwTTL);
+static void DNSQueryStart(DNS_QUERY_INFO* q, BYTE* Hostname, ROM BYTE* HostnameROM, BYTE Type);
+static void DNSQueryTask(DNS_QUERY_INFO* q);
+static void DNSGetAnswer(void);
 
 #if defined(__18CXX)
 	static void DNSPutROMString(ROM BYTE* String);
@@ -149,6 +186,9 @@ static void DNSDiscardName(void);
 	other DNS APIs.  Call DNSEndUsage when this application no longer 
 	needs the DNS module so that other applications may make use of it.
 
+	Resolutions started with DNSQueryBegin() do not hold this semaphore 
+	and run alongside the one it guards.
+
   Precondition:
 	Stack is initialized.
 
@@ -168,10 +208,13 @@ static void DNSDiscardName(void);
   ***************************************************************************/
 BOOL DNSBeginUsage(void)
 {
-	if(Flags.bits.DNSInUse)
+	DNS_QUERY_INFO* q = &DNSQueries[DNS_USAGE_QUERY];
+
+	if(q->sm != DNS_FREE)
 		return FALSE;
 
-	Flags.bits.DNSInUse = TRUE;
+	q->sm = DNS_DONE;
+	q->bAddressValid = FALSE;
 	return TRUE;
 }
 
@@ -205,15 +248,7 @@ BOOL DNSBeginUsage(void)
   ***************************************************************************/
 BOOL DNSEndUsage(void)
 {
-	if(MySocket != INVALID_UDP_SOCKET)
-	{
-		UDPClose(MySocket);
-		MySocket = INVALID_UDP_SOCKET;
-	}
-	smDNS = DNS_DONE;
-	Flags.bits.DNSInUse = FALSE;
-
-	return Flags.bits.AddressValid;
+	return DNSQueryEnd(DNS_USAGE_QUERY);
 }
 
 
@@ -229,8 +264,12 @@ BOOL DNSEndUsage(void)
 	called, it starts the DNS state machine.  Call DNSIsResolved repeatedly
 	to determine if the resolution is complete.
 	
-	Only one DNS resoultion may be executed at a time.  The Hostname must 
-	not be modified in memory until the resolution is complete.
+	Only one DNS resoultion may be executed at a time through this 
+	function; use DNSQueryBegin() for more.  The Hostname must not be 
+	modified in memory until the resolution is complete.
+
+	If Hostname was resolved recently, within the TTL of the answer, the 
+	cached answer is used and the DNS server is not asked again.
 
   Precondition:
 	DNSBeginUsage returned TRUE on a previous call.
@@ -250,19 +289,7 @@ BOOL DNSEndUsage(void)
   ***************************************************************************/
 void DNSResolve(BYTE* Hostname, BYTE Type)
 {
-	if(StringToIPAddress(Hostname, &ResolvedInfo.IPAddr))
-	{
-		Flags.bits.AddressValid = TRUE;
-		smDNS = DNS_DONE;
-	}
-	else
-	{	
-		DNSHostName = Hostname;
-		DNSHostNameROM = NULL;
-		smDNS = DNS_START;
-		RecordType = Type;
-		Flags.bits.AddressValid = FALSE;
-	}
+	DNSQueryStart(&DNSQueries[DNS_USAGE_QUERY], Hostname, NULL, Type);
 }
 
 
@@ -302,19 +329,7 @@ void DNSResolve(BYTE* Hostname, BYTE Type)
 #if defined(__18CXX)
 void DNSResolveROM(ROM BYTE* Hostname, BYTE Type)
 {
-	if(ROMStringToIPAddress(Hostname, &ResolvedInfo.IPAddr))
-	{
-		Flags.bits.AddressValid = TRUE;
-		smDNS = DNS_DONE;
-	}
-	else
-	{	
-		DNSHostName = NULL;
-		DNSHostNameROM = Hostname;
-		smDNS = DNS_START;
-		RecordType = Type;
-		Flags.bits.AddressValid = FALSE;
-	}
+	DNSQueryStart(&DNSQueries[DNS_USAGE_QUERY], NULL, Hostname, Type);
 }
 #endif
 
@@ -346,56 +361,277 @@ void DNSResolveROM(ROM BYTE* Hostname, BYTE Type)
   ***************************************************************************/
 BOOL DNSIsResolved(IP_ADDR* HostIP)
 {
-	static DWORD		StartTime;
-	static WORD_VAL		SentTransactionID __attribute__((persistent));
-	static BYTE			vARPAttemptCount;
-	static BYTE			vDNSAttemptCount;
-	BYTE 				i;
-	WORD_VAL			w;
-	DNS_HEADER			DNSHeader;
-	DNS_ANSWER_HEADER	DNSAnswerHeader;
+	return DNSQueryIsResolved(DNS_USAGE_QUERY, HostIP);
+}
+
+
+/*****************************************************************************
+  Function:
+	DNS_HANDLE DNSQueryBegin(BYTE* Hostname, BYTE Type)
+
+  Summary:
+	Begins a resolution that runs alongside any others.
+	
+  Description:
+	Takes one of the DNS_MAX_QUERIES - 1 queries that do not need 
+	DNSBeginUsage() and starts resolving Hostname with it, as 
+	DNSResolve() does.  Poll it with DNSQueryIsResolved() and free it 
+	with DNSQueryEnd().
+
+  Precondition:
+	Stack is initialized.
+
+  Parameters:
+	Hostname - A pointer to the null terminated string specifiying the
+		host for which to resolve an IP.  It must not be modified until 
+		DNSQueryEnd().
+	Type - DNS_TYPE_A or DNS_TYPE_MX
 
-	switch(smDNS)
+  Returns:
+  	A handle to the query, or INVALID_DNS_HANDLE if all are in use; yield 
+  	to the stack and try again later.
+  ***************************************************************************/
+DNS_HANDLE DNSQueryBegin(BYTE* Hostname, BYTE Type)
+{
+	DNS_HANDLE h;
+
+	for(h = DNS_USAGE_QUERY + 1; h < DNS_MAX_QUERIES; h++)
+	{
+		if(DNSQueries[h].sm == DNS_FREE)
+		{
+			DNSQueryStart(&DNSQueries[h], Hostname, NULL, Type);
+			return h;
+		}
+	}
+
+	return INVALID_DNS_HANDLE;
+}
+
+
+/*****************************************************************************
+  Function:
+	BOOL DNSQueryIsResolved(DNS_HANDLE hQuery, IP_ADDR* HostIP)
+
+  Summary:
+	Runs a query and tells if it is complete.
+	
+  Description:
+	An answer to any query in progress is taken off the shared socket, 
+	then this query is moved along.  A query whose server does not answer 
+	within DNS_TIMEOUT is sent again, to the secondary server if there is 
+	one, DNS_MAX_ATTEMPTS times in all.
+
+  Precondition:
+	hQuery came from DNSQueryBegin().
+
+  Parameters:
+	hQuery - The query
+	HostIP - Receives the address once the query is complete, 0.0.0.0 if 
+		it failed.
+
+  Return Values:
+  	TRUE - The query is complete, or hQuery is not a query in use.
+  	FALSE - The resolution process is still in progress.
+  ***************************************************************************/
+BOOL DNSQueryIsResolved(DNS_HANDLE hQuery, IP_ADDR* HostIP)
+{
+	DNS_QUERY_INFO* q;
+
+	HostIP->Val = 0x00000000;
+	if(hQuery >= DNS_MAX_QUERIES || DNSQueries[hQuery].sm == DNS_FREE)
+		return TRUE;
+	q = &DNSQueries[hQuery];
+
+	DNSGetAnswer();
+	DNSQueryTask(q);
+
+	if(q->sm != DNS_DONE)
+		return FALSE;
+
+	// Return 0.0.0.0 if DNS resolution failed, otherwise return the 
+	// resolved IP address
+	if(q->bAddressValid)
+		HostIP->Val = q->IPAddr.Val;
+	return TRUE;
+}
+
+
+/*****************************************************************************
+  Function:
+	BOOL DNSQueryEnd(DNS_HANDLE hQuery)
+
+  Summary:
+	Frees a query.
+	
+  Description:
+	The query may be complete or not; an answer that comes in for it later 
+	is thrown away.  The shared socket is closed with the last query.
+
+  Precondition:
+	None
+
+  Parameters:
+	hQuery - The query from DNSQueryBegin()
+
+  Return Values:
+  	TRUE - The address to the host name was successfully resolved.
+  	FALSE - The DNS failed or the address does not exist.
+  ***************************************************************************/
+BOOL DNSQueryEnd(DNS_HANDLE hQuery)
+{
+	BOOL bValid;
+	BYTE i;
+
+	if(hQuery >= DNS_MAX_QUERIES)
+		return FALSE;
+
+	bValid = (DNSQueries[hQuery].sm == DNS_DONE) && DNSQueries[hQuery].bAddressValid;
+	DNSQueries[hQuery].sm = DNS_FREE;
+
+	for(i = 0; i < DNS_MAX_QUERIES; i++)
+	{
+		if(DNSQueries[i].sm != DNS_FREE)
+			return bValid;
+	}
+
+	if(MySocket != INVALID_UDP_SOCKET)
+	{
+		UDPClose(MySocket);
+		MySocket = INVALID_UDP_SOCKET;
+	}
+
+	return bValid;
+}
+
+
+/*****************************************************************************
+  Function:
+	static void DNSQueryStart(DNS_QUERY_INFO* q, BYTE* Hostname, ROM BYTE* HostnameROM, BYTE Type)
+
+  Summary:
+	Starts a query, or answers it at once.
+	
+  Description:
+	An IP address written as a string, or a name in the cache, completes 
+	the query without going to the network.
+
+  Precondition:
+	None
+
+  Parameters:
+	q - The query
+	Hostname - Host name in RAM, or NULL
+	HostnameROM - Host name in ROM, or NULL
+	Type - DNS_TYPE_A or DNS_TYPE_MX
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void DNSQueryStart(DNS_QUERY_INFO* q, BYTE* Hostname, ROM BYTE* HostnameROM, BYTE Type)
+{
+	DNS_CACHE_ENTRY* e;
+
+	q->Hostname = Hostname;
+	q->HostnameROM = HostnameROM;
+	q->vType = Type;
+	q->bAddressValid = FALSE;
+
+	#if defined(__18CXX)
+	if(HostnameROM != NULL && ROMStringToIPAddress(HostnameROM, &q->IPAddr))
+	#else
+	if(HostnameROM != NULL && StringToIPAddress((BYTE*)HostnameROM, &q->IPAddr))
+	#endif
+	{
+		q->bAddressValid = TRUE;
+		q->sm = DNS_DONE;
+	}
+	else if(Hostname != NULL && StringToIPAddress(Hostname, &q->IPAddr))
+	{
+		q->bAddressValid = TRUE;
+		q->sm = DNS_DONE;
+	}
+	else if((e = DNSCacheFind(Hostname, Type)) != NULL)
+	{
+		q->IPAddr.Val = e->IPAddr.Val;
+		q->bAddressValid = (e->IPAddr.Val != 0x00000000ul);
+		q->sm = DNS_DONE;
+	}
+	else
+	{	
+		q->sm = DNS_START;
+	}
+}
+
+
+/*****************************************************************************
+  Function:
+	static void DNSQueryTask(DNS_QUERY_INFO* q)
+
+  Summary:
+	Moves a query's state machine along.
+	
+  Description:
+	Resolves the server's MAC address, sends the query and waits for 
+	DNSGetAnswer() to complete it.  When the server does not answer, the 
+	query fails over to the other server, or asks the same one again if 
+	there is only one.
+
+  Precondition:
+	None
+
+  Parameters:
+	q - The query
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void DNSQueryTask(DNS_QUERY_INFO* q)
+{
+	switch(q->sm)
 	{
 		case DNS_START:
-			vARPAttemptCount = 0;
-			vDNSAttemptCount = 0;
+			q->vARPAttemptCount = 0;
+			q->vDNSAttemptCount = 0;
+			q->vServer = AppConfig.SecondaryDNSServer.Val ? vAnsweringServer : 0;
 			// No break;
 
 		case DNS_ARP_START_RESOLVE:
-			ARPResolve(&AppConfig.PrimaryDNSServer);
-			vARPAttemptCount++;
-			StartTime = TickGet();
-			smDNS = DNS_ARP_RESOLVE;
+			q->Server.IPAddr.Val = q->vServer ? AppConfig.SecondaryDNSServer.Val : AppConfig.PrimaryDNSServer.Val;
+			ARPResolve(&q->Server.IPAddr);
+			q->vARPAttemptCount++;
+			q->StartTime = TickGet();
+			q->sm = DNS_ARP_RESOLVE;
 			break;
 
 		case DNS_ARP_RESOLVE:
-			if(!ARPIsResolved(&AppConfig.PrimaryDNSServer, &ResolvedInfo.MACAddr))
+			if(!ARPIsResolved(&q->Server.IPAddr, &q->Server.MACAddr))
 			{
-				if(TickGet() - StartTime > DNS_TIMEOUT)
-					smDNS = (vARPAttemptCount >= 3u) ? DNS_FAIL : DNS_ARP_START_RESOLVE;
+				if(TickGet() - q->StartTime > DNS_TIMEOUT)
+					q->sm = (q->vARPAttemptCount >= 3u) ? DNS_FAIL : DNS_ARP_START_RESOLVE;
 				break;
 			}
-			ResolvedInfo.IPAddr.Val = AppConfig.PrimaryDNSServer.Val;
-			smDNS = DNS_OPEN_SOCKET;
-			// No break: DNS_OPEN_SOCKET is the correct next state
-		
-		case DNS_OPEN_SOCKET:
-			MySocket = UDPOpen(0, &ResolvedInfo, DNS_PORT);
-			if(MySocket == INVALID_UDP_SOCKET)
-				break;
-
-			smDNS = DNS_QUERY;
-			// No need to break, we can immediately start resolution
+			q->sm = DNS_QUERY;
+			// No break: DNS_QUERY is the correct next state
 			
 		case DNS_QUERY:
+			if(MySocket == INVALID_UDP_SOCKET)
+			{
+				MySocket = UDPOpen(0, &q->Server, DNS_PORT);
+				if(MySocket == INVALID_UDP_SOCKET)
+					break;
+			}
+
 			if(!UDPIsPutReady(MySocket))
 				break;
-			
+
+			// The socket is shared, point it at this query's server
+			UDPSocketInfo[MySocket].remoteNode = q->Server;
+			UDPSocketInfo[MySocket].remotePort = DNS_PORT;
+
 			// Put DNS query here
-			SentTransactionID.Val++;
-			UDPPut(SentTransactionID.v[1]);// User chosen transaction ID
-			UDPPut(SentTransactionID.v[0]);
+			q->TransactionID.Val = ++LastTransactionID.Val;
+			UDPPut(q->TransactionID.v[1]);// User chosen transaction ID
+			UDPPut(q->TransactionID.v[0]);
 			UDPPut(0x01);		// Standard query with recursion
 			UDPPut(0x00);	
 			UDPPut(0x00);		// 0x0001 questions
@@ -408,222 +644,442 @@ BOOL DNSIsResolved(IP_ADDR* HostIP)
 			UDPPut(0x00);
 
 			// Put hostname string to resolve
-			if(DNSHostName)
-				DNSPutString(DNSHostName);
+			if(q->Hostname)
+				DNSPutString(q->Hostname);
 			else
-				DNSPutROMString(DNSHostNameROM);
+				DNSPutROMString(q->HostnameROM);
 
 			UDPPut(0x00);		// Type: DNS_TYPE_A A (host address) or DNS_TYPE_MX for mail exchange
-			UDPPut(RecordType);
+			UDPPut(q->vType);
 			UDPPut(0x00);		// Class: IN (Internet)
 			UDPPut(0x01);
 
 			UDPFlush();
-			StartTime = TickGet();
-			smDNS = DNS_GET_RESULT;
+			q->StartTime = TickGet();
+			q->sm = DNS_GET_RESULT;
 			break;
 
 		case DNS_GET_RESULT:
-			if(!UDPIsGetReady(MySocket))
+			// DNSGetAnswer() moves the query to DNS_DONE
+			if(TickGet() - q->StartTime > DNS_TIMEOUT)
+				q->sm = DNS_FAIL;
+			break;
+
+		case DNS_FAIL:
+			// If 3 attempts or more, quit and return an invalid IP 
+			// address 0.0.0.0
+			if(++q->vDNSAttemptCount >= DNS_MAX_ATTEMPTS)
 			{
-				if(TickGet() - StartTime > DNS_TIMEOUT)
-					smDNS = DNS_FAIL;
+				q->bAddressValid = FALSE;
+				q->sm = DNS_DONE;
 				break;
 			}
 
-			// Retrieve the DNS header and de-big-endian it
-			UDPGet(&DNSHeader.TransactionID.v[1]);
-			UDPGet(&DNSHeader.TransactionID.v[0]);
+			// Fail over to the secondary DNS server, or back, if there is 
+			// one, otherwise ask the same server again
+			if(AppConfig.SecondaryDNSServer.Val)
+				q->vServer ^= 1;
+			q->vARPAttemptCount = 0;
+			q->sm = DNS_ARP_START_RESOLVE;
+			break;
 
-			// Throw this packet away if it isn't in response to our last query
-			if(DNSHeader.TransactionID.Val != SentTransactionID.Val)
-			{
-				UDPDiscard();
-				break;
-			}
+		default:
+			break;
+	}
+}
+
+
+/*****************************************************************************
+  Function:
+	static void DNSGetAnswer(void)
 
-			UDPGet(&DNSHeader.Flags.v[1]);
-			UDPGet(&DNSHeader.Flags.v[0]);
-			UDPGet(&DNSHeader.Questions.v[1]);
-			UDPGet(&DNSHeader.Questions.v[0]);
-			UDPGet(&DNSHeader.Answers.v[1]);
-			UDPGet(&DNSHeader.Answers.v[0]);
-			UDPGet(&DNSHeader.AuthoritativeRecords.v[1]);
-			UDPGet(&DNSHeader.AuthoritativeRecords.v[0]);
-			UDPGet(&DNSHeader.AdditionalRecords.v[1]);
-			UDPGet(&DNSHeader.AdditionalRecords.v[0]);
-
-			// Remove all questions (queries)
-			while(DNSHeader.Questions.Val--)
+  Summary:
+	Takes an answer off the shared socket and completes its query.
+	
+  Description:
+	The answer goes to the query waiting with its transaction ID; an 
+	answer to a query that has since been sent again, failed or been 
+	freed is thrown away.  The first A record found is the address.  
+	Answers are cached for their TTL, and names the server says do not 
+	exist for DNS_NEGATIVE_TTL.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void DNSGetAnswer(void)
+{
+	DNS_QUERY_INFO*		q;
+	BYTE 				i;
+	WORD_VAL			w;
+	DWORD				dwTTL;
+	DNS_HEADER			DNSHeader;
+	DNS_ANSWER_HEADER	DNSAnswerHeader;
+
+	if(MySocket == INVALID_UDP_SOCKET || !UDPIsGetReady(MySocket))
+		return;
+
+	// Retrieve the DNS header and de-big-endian it
+	UDPGet(&DNSHeader.TransactionID.v[1]);
+	UDPGet(&DNSHeader.TransactionID.v[0]);
+
+	// Throw this packet away if it isn't in response to a query waiting 
+	// for one
+	for(i = 0; i < DNS_MAX_QUERIES; i++)
+	{
+		if(DNSQueries[i].sm == DNS_GET_RESULT && DNSQueries[i].TransactionID.Val == DNSHeader.TransactionID.Val)
+			break;
+	}
+	if(i == DNS_MAX_QUERIES)
+	{
+		UDPDiscard();
+		return;
+	}
+	q = &DNSQueries[i];
+
+	// The server is up, start with it next time
+	vAnsweringServer = q->vServer;
+
+	UDPGet(&DNSHeader.Flags.v[1]);
+	UDPGet(&DNSHeader.Flags.v[0]);
+	UDPGet(&DNSHeader.Questions.v[1]);
+	UDPGet(&DNSHeader.Questions.v[0]);
+	UDPGet(&DNSHeader.Answers.v[1]);
+	UDPGet(&DNSHeader.Answers.v[0]);
+	UDPGet(&DNSHeader.AuthoritativeRecords.v[1]);
+	UDPGet(&DNSHeader.AuthoritativeRecords.v[0]);
+	UDPGet(&DNSHeader.AdditionalRecords.v[1]);
+	UDPGet(&DNSHeader.AdditionalRecords.v[0]);
+
+	// Remove all questions (queries)
+	while(DNSHeader.Questions.Val--)
+	{
+		DNSDiscardName();
+		UDPGet(&w.v[1]);		// Question type
+		UDPGet(&w.v[0]);
+		UDPGet(&w.v[1]);		// Question class
+		UDPGet(&w.v[0]);
+	}
+	
+	// Scan through answers
+	while(DNSHeader.Answers.Val--)
+	{				
+		DNSDiscardName();					// Throw away response name
+		UDPGet(&DNSAnswerHeader.ResponseType.v[1]);		// Response type
+		UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseClass.v[1]);	// Response class
+		UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]);		// Time to live
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseLen.v[1]);		// Response length
+		UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
+
+		// Make sure that this is a 4 byte IP address, response type A or MX, class 1
+		// Check if this is Type A or MX
+		if( DNSAnswerHeader.ResponseType.Val	== 0x0001u &&
+			DNSAnswerHeader.ResponseClass.Val	== 0x0001u && // Internet class
+			DNSAnswerHeader.ResponseLen.Val		== 0x0004u)
+		{
+			q->bAddressValid = TRUE;
+			dwTTL = DNSAnswerHeader.ResponseTTL.Val;
+			UDPGet(&q->IPAddr.v[0]);
+			UDPGet(&q->IPAddr.v[1]);
+			UDPGet(&q->IPAddr.v[2]);
+			UDPGet(&q->IPAddr.v[3]);
+			goto DoneSearchingRecords;
+		}
+		else
+		{
+			while(DNSAnswerHeader.ResponseLen.Val--)
 			{
-				DNSDiscardName();
-				UDPGet(&w.v[1]);		// Question type
-				UDPGet(&w.v[0]);
-				UDPGet(&w.v[1]);		// Question class
-				UDPGet(&w.v[0]);
-			}
-			
-			// Scan through answers
-			while(DNSHeader.Answers.Val--)
-			{				
-				DNSDiscardName();					// Throw away response name
-				UDPGet(&DNSAnswerHeader.ResponseType.v[1]);		// Response type
-				UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseClass.v[1]);	// Response class
-				UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]);		// Time to live
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseLen.v[1]);		// Response length
-				UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
-
-				// Make sure that this is a 4 byte IP address, response type A or MX, class 1
-				// Check if this is Type A or MX
-				if( DNSAnswerHeader.ResponseType.Val	== 0x0001u &&
-					DNSAnswerHeader.ResponseClass.Val	== 0x0001u && // Internet class
-					DNSAnswerHeader.ResponseLen.Val		== 0x0004u)
-				{
-					Flags.bits.AddressValid = TRUE;
-					UDPGet(&ResolvedInfo.IPAddr.v[0]);
-					UDPGet(&ResolvedInfo.IPAddr.v[1]);
-					UDPGet(&ResolvedInfo.IPAddr.v[2]);
-					UDPGet(&ResolvedInfo.IPAddr.v[3]);
-					goto DoneSearchingRecords;
-				}
-				else
-				{
-					while(DNSAnswerHeader.ResponseLen.Val--)
-					{
-						UDPGet(&i);
-					}
-				}
+				UDPGet(&i);
 			}
+		}
+	}
 
-			// Remove all Authoritative Records
-			while(DNSHeader.AuthoritativeRecords.Val--)
+	// Remove all Authoritative Records
+	while(DNSHeader.AuthoritativeRecords.Val--)
+	{
+		DNSDiscardName();					// Throw away response name
+		UDPGet(&DNSAnswerHeader.ResponseType.v[1]);		// Response type
+		UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseClass.v[1]);	// Response class
+		UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]);		// Time to live
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseLen.v[1]);		// Response length
+		UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
+
+		// Make sure that this is a 4 byte IP address, response type A or MX, class 1
+		// Check if this is Type A
+		if( DNSAnswerHeader.ResponseType.Val	== 0x0001u &&
+			DNSAnswerHeader.ResponseClass.Val	== 0x0001u && // Internet class
+			DNSAnswerHeader.ResponseLen.Val		== 0x0004u)
+		{
+			q->bAddressValid = TRUE;
+			dwTTL = DNSAnswerHeader.ResponseTTL.Val;
+			UDPGet(&q->IPAddr.v[0]);
+			UDPGet(&q->IPAddr.v[1]);
+			UDPGet(&q->IPAddr.v[2]);
+			UDPGet(&q->IPAddr.v[3]);
+			goto DoneSearchingRecords;
+		}
+		else
+		{
+			while(DNSAnswerHeader.ResponseLen.Val--)
 			{
-				DNSDiscardName();					// Throw away response name
-				UDPGet(&DNSAnswerHeader.ResponseType.v[1]);		// Response type
-				UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseClass.v[1]);	// Response class
-				UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]);		// Time to live
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseLen.v[1]);		// Response length
-				UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
-
-				// Make sure that this is a 4 byte IP address, response type A or MX, class 1
-				// Check if this is Type A
-				if( DNSAnswerHeader.ResponseType.Val	== 0x0001u &&
-					DNSAnswerHeader.ResponseClass.Val	== 0x0001u && // Internet class
-					DNSAnswerHeader.ResponseLen.Val		== 0x0004u)
-				{
-					Flags.bits.AddressValid = TRUE;
-					UDPGet(&ResolvedInfo.IPAddr.v[0]);
-					UDPGet(&ResolvedInfo.IPAddr.v[1]);
-					UDPGet(&ResolvedInfo.IPAddr.v[2]);
-					UDPGet(&ResolvedInfo.IPAddr.v[3]);
-					goto DoneSearchingRecords;
-				}
-				else
-				{
-					while(DNSAnswerHeader.ResponseLen.Val--)
-					{
-						UDPGet(&i);
-					}
-				}
+				UDPGet(&i);
 			}
+		}
+	}
 
-			// Remove all Additional Records
-			while(DNSHeader.AdditionalRecords.Val--)
+	// Remove all Additional Records
+	while(DNSHeader.AdditionalRecords.Val--)
+	{
+		DNSDiscardName();					// Throw away response name
+		UDPGet(&DNSAnswerHeader.ResponseType.v[1]);		// Response type
+		UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseClass.v[1]);	// Response class
+		UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]);		// Time to live
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
+		UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
+		UDPGet(&DNSAnswerHeader.ResponseLen.v[1]);		// Response length
+		UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
+
+		// Make sure that this is a 4 byte IP address, response type A or MX, class 1
+		// Check if this is Type A
+		if( DNSAnswerHeader.ResponseType.Val	== 0x0001u &&
+			DNSAnswerHeader.ResponseClass.Val	== 0x0001u && // Internet class
+			DNSAnswerHeader.ResponseLen.Val		== 0x0004u)
+		{
+			q->bAddressValid = TRUE;
+			dwTTL = DNSAnswerHeader.ResponseTTL.Val;
+			UDPGet(&q->IPAddr.v[0]);
+			UDPGet(&q->IPAddr.v[1]);
+			UDPGet(&q->IPAddr.v[2]);
+			UDPGet(&q->IPAddr.v[3]);
+			goto DoneSearchingRecords;
+		}
+		else
+		{
+			while(DNSAnswerHeader.ResponseLen.Val--)
 			{
-				DNSDiscardName();					// Throw away response name
-				UDPGet(&DNSAnswerHeader.ResponseType.v[1]);		// Response type
-				UDPGet(&DNSAnswerHeader.ResponseType.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseClass.v[1]);	// Response class
-				UDPGet(&DNSAnswerHeader.ResponseClass.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[3]);		// Time to live
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[2]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[1]);
-				UDPGet(&DNSAnswerHeader.ResponseTTL.v[0]);
-				UDPGet(&DNSAnswerHeader.ResponseLen.v[1]);		// Response length
-				UDPGet(&DNSAnswerHeader.ResponseLen.v[0]);
-
-				// Make sure that this is a 4 byte IP address, response type A or MX, class 1
-				// Check if this is Type A
-				if( DNSAnswerHeader.ResponseType.Val	== 0x0001u &&
-					DNSAnswerHeader.ResponseClass.Val	== 0x0001u && // Internet class
-					DNSAnswerHeader.ResponseLen.Val		== 0x0004u)
-				{
-					Flags.bits.AddressValid = TRUE;
-					UDPGet(&ResolvedInfo.IPAddr.v[0]);
-					UDPGet(&ResolvedInfo.IPAddr.v[1]);
-					UDPGet(&ResolvedInfo.IPAddr.v[2]);
-					UDPGet(&ResolvedInfo.IPAddr.v[3]);
-					goto DoneSearchingRecords;
-				}
-				else
-				{
-					while(DNSAnswerHeader.ResponseLen.Val--)
-					{
-						UDPGet(&i);
-					}
-				}
+				UDPGet(&i);
 			}
+		}
+	}
+
+	// No address.  Remember that if the server says the name does 
+	// not exist (RCODE 3) or has no such record (RCODE 0), but 
+	// not for server failures, which may be gone on the next try.
+	if((DNSHeader.Flags.v[0] & 0x0Fu) == 0u || (DNSHeader.Flags.v[0] & 0x0Fu) == 3u)
+		DNSCacheAdd(q->Hostname, q->vType, 0x00000000ul, DNS_NEGATIVE_TTL);
+	goto DoneCaching;
 
 DoneSearchingRecords:
+	DNSCacheAdd(q->Hostname, q->vType, q->IPAddr.Val, dwTTL);
 
-			UDPDiscard();
-			UDPClose(MySocket);
-			MySocket = INVALID_UDP_SOCKET;
-			smDNS = DNS_DONE;
-			// No break, DNS_DONE is the correct step
+DoneCaching:
+	UDPDiscard();
+	q->sm = DNS_DONE;
+}
 
-		case DNS_DONE:
-			// Return 0.0.0.0 if DNS resolution failed, otherwise return the 
-			// resolved IP address
-			if(!Flags.bits.AddressValid)
-				ResolvedInfo.IPAddr.Val = 0;
-			HostIP->Val = ResolvedInfo.IPAddr.Val;
-			return TRUE;
+/*****************************************************************************
+  Function:
+	static DNS_CACHE_ENTRY* DNSCacheFind(BYTE* Hostname, BYTE Type)
 
-		case DNS_FAIL:
-			// If 3 attempts or more, quit
-			if(vDNSAttemptCount >= 2u)
-			{
-				// Return an invalid IP address 0.0.0.0 if we can't finish ARP or DNS query step
-				HostIP->Val = 0x00000000;
-				return TRUE;
-			}
-			vDNSAttemptCount++;
+  Summary:
+	Looks up a host name in the DNS cache.
 
-			// Swap primary and secondary DNS servers if there is a secondary DNS server programmed
-			if(AppConfig.SecondaryDNSServer.Val)
-			{
-				AppConfig.PrimaryDNSServer.Val ^= AppConfig.SecondaryDNSServer.Val;
-				AppConfig.SecondaryDNSServer.Val ^= AppConfig.PrimaryDNSServer.Val;
-				AppConfig.PrimaryDNSServer.Val ^= AppConfig.SecondaryDNSServer.Val;
-
-				// Start another ARP resolution for the secondary server (now primary)
-				vARPAttemptCount = 0;
-				if(MySocket != INVALID_UDP_SOCKET)
-				{
-					UDPClose(MySocket);
-					MySocket = INVALID_UDP_SOCKET;
-				}
-				smDNS = DNS_ARP_START_RESOLVE;
-			}
+  Description:
+	Host names are compared without regard to case, as DNS does.  Entries 
+	whose TTL has run out are freed on the way.
 
-			break;
+  Precondition:
+	None
+
+  Parameters:
+	Hostname - Host name to look for, or NULL
+	Type - DNS_TYPE_A or DNS_TYPE_MX
+
+  Returns:
+  	The unexpired entry, with IPAddr 0.0.0.0 if the name is known not to
+  	exist, or NULL if the name is not cached.
+  ***************************************************************************/
+static DNS_CACHE_ENTRY* DNSCacheFind(BYTE* Hostname, BYTE Type)
+{
+	DNS_CACHE_ENTRY* e;
+	BYTE i, j, c1, c2;
 
+	if(Hostname == NULL)
+		return NULL;
+
+	for(i = 0; i < DNS_CACHE_SIZE; i++)
+	{
+		e = &DNSCache[i];
+		if(e->szName[0] == 0u)
+			continue;
+
+		if((LONG)(e->dwExpires - TickGet()) <= 0)
+		{
+			e->szName[0] = 0;
+			continue;
+		}
+
+		if(e->vType != Type)
+			continue;
+
+		for(j = 0; j < DNS_CACHE_NAME_LEN; j++)
+		{
+			c1 = e->szName[j];
+			c2 = Hostname[j];
+			if(c1 >= 'A' && c1 <= 'Z')
+				c1 += 'a' - 'A';
+			if(c2 >= 'A' && c2 <= 'Z')
+				c2 += 'a' - 'A';
+			if(c1 != c2 || c1 == 0u)
+				break;
+		}
+		if(j < DNS_CACHE_NAME_LEN && c1 == c2)
+			return e;
 	}
-	
-	return FALSE;
+
+	return NULL;
 }
 
+
+/*****************************************************************************
+  Function:
+	static void DNSCacheAdd(BYTE* Hostname, BYTE Type, DWORD dwIP, DWORD dwTTL)
+
+  Summary:
+	Remembers a DNS answer for its time to live.
+
+  Description:
+	Replaces the entry for Hostname if there is one, otherwise an unused 
+	one, otherwise the one closest to expiring.  Host names in ROM 
+	(Hostname NULL) or too long for the cache are not cached.
+
+  Precondition:
+	None
+
+  Parameters:
+	Hostname - Host name that was looked up, or NULL
+	Type - DNS_TYPE_A or DNS_TYPE_MX
+	dwIP - Address from the answer, 0 if the name does not exist
+	dwTTL - Seconds the answer is good for
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void DNSCacheAdd(BYTE* Hostname, BYTE Type, DWORD dwIP, DWORD dwTTL)
+{
+	DNS_CACHE_ENTRY* e;
+	BYTE i;
+
+	if(Hostname == NULL || dwTTL == 0u || strlen((char*)Hostname) >= DNS_CACHE_NAME_LEN)
+		return;
+
+	e = DNSCacheFind(Hostname, Type);
+	for(i = 0; e == NULL && i < DNS_CACHE_SIZE; i++)
+	{
+		if(DNSCache[i].szName[0] == 0u)
+			e = &DNSCache[i];
+	}
+	if(e == NULL)
+	{
+		e = &DNSCache[0];
+		for(i = 1; i < DNS_CACHE_SIZE; i++)
+		{
+			if((LONG)(DNSCache[i].dwExpires - e->dwExpires) < 0)
+				e = &DNSCache[i];
+		}
+	}
+
+	if(dwTTL > DNS_CACHE_MAX_TTL)
+		dwTTL = DNS_CACHE_MAX_TTL;
+
+	strcpy((char*)e->szName, (char*)Hostname);
+	e->vType = Type;
+	e->IPAddr.Val = dwIP;
+	e->dwExpires = TickGet() + (DWORD)(dwTTL * TICK_SECOND);
+}
+
+
+/*****************************************************************************
+  Function:
+	BOOL DNSCacheLookup(BYTE* Hostname, BYTE Type, IP_ADDR* HostIP)
+
+  Summary:
+	Answers a lookup from the DNS cache only.
+
+  Description:
+	Lets a caller skip DNSBeginUsage() and the whole DNS state machine 
+	when the name was resolved recently.  Nothing is sent on the network.
+
+  Precondition:
+	None
+
+  Parameters:
+	Hostname - A pointer to the null terminated host name
+	Type - DNS_TYPE_A or DNS_TYPE_MX
+	HostIP - Receives the cached address, 0.0.0.0 if the name is known 
+		not to exist.
+
+  Return Values:
+  	TRUE - The name was in the cache and HostIP was filled in.
+  	FALSE - Not cached; resolve it with DNSResolve().
+  ***************************************************************************/
+BOOL DNSCacheLookup(BYTE* Hostname, BYTE Type, IP_ADDR* HostIP)
+{
+	DNS_CACHE_ENTRY* e;
+
+	e = DNSCacheFind(Hostname, Type);
+	if(e == NULL)
+		return FALSE;
+
+	HostIP->Val = e->IPAddr.Val;
+	return TRUE;
+}
+
+
+/*****************************************************************************
+  Function:
+	void DNSCacheFlush(void)
+
+  Summary:
+	Forgets all cached DNS answers.
+
+  Description:
+	Call this when the DNS servers change, for example on a new DHCP 
+	lease on another network.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+void DNSCacheFlush(void)
+{
+	memset(DNSCache, 0x00, sizeof(DNSCache));
+}
+
+
 /*****************************************************************************
   Function:
 	static void DNSPutString(BYTE* String)
@@ -801,13 +1257,10 @@ static void DNSDiscardName(void)
   ***************************************************************************/
 void InitDNSStaticMemory(void)
 {
-    Flags.Val = 0;
-    smDNS = DNS_DONE;
+    memset(DNSQueries, 0, sizeof(DNSQueries));
     MySocket = INVALID_UDP_SOCKET;	
-    DNSHostName = NULL;							
-    DNSHostNameROM = NULL;				
-    RecordType = 0;								
-    memset(&ResolvedInfo, 0, sizeof(ResolvedInfo));						
+    vAnsweringServer = 0;
+    DNSCacheFlush();
 }
 
 #endif	//#if defined(STACK_USE_DNS)
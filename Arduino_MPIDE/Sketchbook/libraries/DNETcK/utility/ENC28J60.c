@@ -73,6 +73,7 @@
 #if defined(ENC_CS_TRIS)
 
 #include "TCPIP Stack/TCPIP.h"
+#include "TCPIP Stack/ENC28J60SPI.h"
 
 /** D E F I N I T I O N S ****************************************************/
 // IMPORTANT SPI NOTE: The code in this file expects that the SPI interrupt
@@ -108,6 +109,11 @@
 #define ETHER_IP    (0x00u)
 #define ETHER_ARP   (0x06u)
 
+// PIC32 SPI module, which the simulated chip of HOST_ENC28J60 has too
+#if defined(__C32__) || defined(HOST_ENC28J60)
+    #define ENC_SPI_PIC32
+#endif
+
 // A header appended at the start of all RX frames by the hardware
 typedef struct  __attribute__((aligned(2), packed))
 {
@@ -132,7 +138,7 @@ typedef struct  __attribute__((aligned(2), packed))
     }
 
     #define SPI_ON_BIT          (ENC_SPISTATbits.SPIEN)
-#elif defined( __PIC32MX__ )
+#elif defined(ENC_SPI_PIC32)
     #define ClearSPIDoneFlag()
     static inline __attribute__((__always_inline__)) void WaitForDataByte( void )
     {
@@ -144,6 +150,14 @@ typedef struct  __attribute__((aligned(2), packed))
     #error Determine SPI flag mechanism
 #endif
 
+// A DMA write from MACPutArray() may still be going out; every access to
+// the chip finishes it before selecting the chip again.
+#if defined(ENC_SPI_DMA)
+    #define FinishSPIDMA()      ENCSPIWait()
+#else
+    #define FinishSPIDMA()
+#endif
+
 
 // Prototypes of functions intended for MAC layer use only.
 static void BankSel(WORD Register);
@@ -223,12 +237,15 @@ void MACInit(void)
     ENC_SPICON1bits.CKE = 1;
     ENC_SPICON1bits.MSTEN = 1;
     ENC_SPISTATbits.SPIEN = 1;
-#elif defined(__C32__)
+#elif defined(ENC_SPI_PIC32)
     ENC_SPIBRG = (GetPeripheralClock()-1ul)/2ul/ENC_MAX_SPI_FREQ;
 	ENC_SPICON1bits.SMP = 1;	// Delay SDI input sampling (PIC perspective) by 1/2 SPI clock
     ENC_SPICON1bits.CKE = 1;
     ENC_SPICON1bits.MSTEN = 1;
     ENC_SPICON1bits.ON = 1;
+    #if defined(ENC_SPI_DMA)
+    ENCSPIInit();
+    #endif
 #endif
 
     // RESET the entire ENC28J60, clearing all registers
@@ -1133,10 +1150,11 @@ BYTE MACGet()
 {
     BYTE Result;
 
+    FinishSPIDMA();
     ENC_CS_IO = 0;
 	ClearSPIDoneFlag();
 
-    #if defined(__C32__)
+    #if defined(ENC_SPI_PIC32)
     {
         // Send the opcode and read a byte in one 16-bit operation
         ENC_SPICON1bits.MODE16 = 1;
@@ -1195,7 +1213,8 @@ BYTE MACGet()
  *                  ERDPT is incremented after each byte, following the same
  *                  rules as MACGet().
  *
- * Note:            None
+ * Note:            With ENC_SPI_DMA, ENC_SPI_DMA_THRESHOLD bytes or more
+ *                  are read by DMA.
  *****************************************************************************/
 WORD MACGetArray(BYTE *val, WORD len)
 {
@@ -1243,7 +1262,13 @@ WORD MACGetArray(BYTE *val, WORD len)
     WORD i;
     volatile BYTE Dummy;
 
+    #if defined(ENC_SPI_DMA)
+    if(len >= ENC_SPI_DMA_THRESHOLD)
+        return ENCSPIRead(val, len);
+    #endif
+
     // Start the burst operation
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
     ENC_SSPBUF = RBM;       // Send the Read Buffer Memory opcode.
@@ -1253,7 +1278,7 @@ WORD MACGetArray(BYTE *val, WORD len)
     WaitForDataByte();      // Wait until opcode/address is transmitted.
     Dummy = ENC_SSPBUF;
 
-    #if defined(__C32__)
+    #if defined(ENC_SPI_PIC32)
     {
         DWORD_VAL dwv;
 
@@ -1359,10 +1384,11 @@ void MACPut(BYTE val)
 {
     volatile BYTE Dummy;
 
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
 
-    #if defined(__C32__)
+    #if defined(ENC_SPI_PIC32)
     {
         // Send the Write Buffer Memory and data, in on 16-bit write
         ENC_SPICON1bits.MODE16 = 1;
@@ -1414,7 +1440,8 @@ void MACPut(BYTE val)
  *                  ENC28J60 RAM.  It performs faster than multiple MACPut()
  *                  calls.  EWRPT is incremented by len.
  *
- * Note:            None
+ * Note:            With ENC_SPI_DMA, ENC_SPI_DMA_THRESHOLD bytes or more
+ *                  are written by DMA and may still be going out on return.
  *****************************************************************************/
 void MACPutArray(BYTE *val, WORD len)
 {
@@ -1453,14 +1480,23 @@ void MACPutArray(BYTE *val, WORD len)
 #else
     volatile BYTE Dummy;
 
+    #if defined(ENC_SPI_DMA)
+    if(len >= ENC_SPI_DMA_THRESHOLD)
+    {
+        ENCSPIWrite(val, len);
+        return;
+    }
+    #endif
+
     // Select the chip and send the proper opcode
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
     ENC_SSPBUF = WBM;       // Send the Write Buffer Memory opcode
     WaitForDataByte();      // Wait until opcode/constant is transmitted.
     Dummy = ENC_SSPBUF;
 
-    #if defined(__C32__)
+    #if defined(ENC_SPI_PIC32)
     {
         DWORD_VAL dwv;
 
@@ -1596,6 +1632,7 @@ void MACPutROMArray(ROM BYTE *val, WORD len)
     volatile BYTE Dummy;
 
     // Select the chip and send the proper opcode
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
     ENC_SSPBUF = WBM;       // Send the Write Buffer Memory opcode
@@ -1650,6 +1687,7 @@ static void SendSystemReset(void)
     DelayMs(1);
 
     // Execute the System Reset command
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
     ENC_SSPBUF = SR;
@@ -1689,6 +1727,7 @@ static REG ReadETHReg(BYTE Address)
     REG r;
 
     // Select the chip and send the Read Control Register opcode/address
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
     ENC_SSPBUF = RCR | Address;
@@ -1731,6 +1770,7 @@ static REG ReadMACReg(BYTE Address)
 {
     REG r;
 
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
     ENC_SSPBUF = RCR | Address; // Send the Read Control Register opcode and
@@ -1823,10 +1863,11 @@ static void WriteReg(BYTE Address, BYTE Data)
 {
     volatile BYTE Dummy;
 
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
 
-    #if defined(__C32__)
+    #if defined(ENC_SPI_PIC32)
     {
         // Send the Write Buffer Memory and data, in on 16-bit write
         ENC_SPICON1bits.MODE16 = 1;
@@ -1892,6 +1933,7 @@ static void BFCReg(BYTE Address, BYTE Data)
 {
     volatile BYTE Dummy;
 
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
     ENC_SSPBUF = BFC | Address; // Send the opcode and address.
@@ -1930,6 +1972,7 @@ static void BFSReg(BYTE Address, BYTE Data)
 {
     volatile BYTE Dummy;
 
+    FinishSPIDMA();
     ENC_CS_IO = 0;
     ClearSPIDoneFlag();
     ENC_SSPBUF = BFS | Address; // Send the opcode and address.
@@ -0,0 +1,246 @@
+/************************************************************************/
+/*																		*/
+/*	ENC28J60SPI.c	--  Bulk ENC28J60 buffer transfers over SPI DMA     */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Both channels step once per byte the SPI receives.  The RX channel  */
+/*	goes first and stores the byte, then the TX channel sends the next  */
+/*	one; the first is forced.  The RX channel drives the same buffer    */
+/*	the TX channel reads, always behind it, so a read clocks out stale  */
+/*	bytes the ENC28J60 ignores and a write needs no second buffer.      */
+/*	See ENC28J60SPI.h.                                                  */
+/*																		*/
+/************************************************************************/
+#define __ENC28J60SPI_C
+
+#include "HardwareProfile.h"
+
+#if defined(ENC_CS_TRIS) && defined(ENC_SPI_DMA) && defined(__PIC32MX__)
+
+#include "TCPIP Stack/TCPIP.h"
+#include "TCPIP Stack/ENC28J60SPI.h"
+
+#define RBM ((0x1<<5) | 0x1A)   // Read Buffer Memory command
+#define WBM ((0x3<<5) | 0x1A)   // Write Buffer Memory command
+
+static BYTE		_rgbBuffer[ENC_SPI_DMA_BUFFER_SIZE];	// writes are copied here, discarded reads land here
+static BOOL		_bBusy = FALSE;		// a burst is going, CS is low
+
+// Sends the opcode that starts a burst
+static void SendOpcode(BYTE bOpcode)
+{
+	volatile BYTE Dummy;
+
+	ENC_CS_IO = 0;
+	ENC_SSPBUF = bOpcode;
+	while(!ENC_SPISTATbits.SPITBE || !ENC_SPISTATbits.SPIRBF);
+	Dummy = ENC_SSPBUF;
+}
+
+// Starts one DMA block through pBuff, which is read for TX and written by RX
+static void StartBlock(BYTE *pBuff, WORD wLength)
+{
+	DmaChnClrEvFlags(ENC_SPI_DMA_RX_CHANNEL, DMA_EV_ALL_EVNTS);
+	DmaChnSetTxfer(ENC_SPI_DMA_RX_CHANNEL, (void*)&ENC_SSPBUF, pBuff, 1, wLength, 1);
+	DmaChnSetTxfer(ENC_SPI_DMA_TX_CHANNEL, pBuff, (void*)&ENC_SSPBUF, wLength, 1, 1);
+	DmaChnEnable(ENC_SPI_DMA_RX_CHANNEL);
+	DmaChnEnable(ENC_SPI_DMA_TX_CHANNEL);
+	DmaChnForceTxfer(ENC_SPI_DMA_TX_CHANNEL);
+}
+
+// The last byte of a block is in once the RX channel is done
+static BOOL IsBlockDone(void)
+{
+	return (DmaChnGetEvFlags(ENC_SPI_DMA_RX_CHANNEL) & DMA_EV_BLOCK_DONE) != 0;
+}
+
+/*****************************************************************************
+  Function:
+	void ENCSPIInit(void)
+
+  Summary:
+	Sets up the DMA channels
+
+  Description:
+	None
+
+  Precondition:
+	The SPI module is on, in 8 bit master mode
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ENCSPIInit(void)
+{
+	DmaChnOpen(ENC_SPI_DMA_RX_CHANNEL, DMA_CHN_PRI3, DMA_OPEN_DEFAULT);
+	DmaChnOpen(ENC_SPI_DMA_TX_CHANNEL, DMA_CHN_PRI2, DMA_OPEN_DEFAULT);
+	DmaChnSetEventControl(ENC_SPI_DMA_RX_CHANNEL, DMA_EV_START_IRQ_EN | DMA_EV_START_IRQ(ENC_SPI_RX_IRQ));
+	DmaChnSetEventControl(ENC_SPI_DMA_TX_CHANNEL, DMA_EV_START_IRQ_EN | DMA_EV_START_IRQ(ENC_SPI_RX_IRQ));
+	_bBusy = FALSE;
+}
+
+/*****************************************************************************
+  Function:
+	WORD ENCSPIRead(BYTE *val, WORD len)
+
+  Summary:
+	Reads the buffer memory at ERDPT
+
+  Description:
+	Same as MACGetArray(), the DMA blocks run in one burst.
+
+  Precondition:
+	ENCSPIInit() has been called
+
+  Parameters:
+	val - where to put the bytes, NULL to skip them
+	len - how many
+
+  Returns:
+  	len
+  ***************************************************************************/
+WORD ENCSPIRead(BYTE *val, WORD len)
+{
+	WORD wLeft = len;
+	WORD wBlock;
+
+	ENCSPIWait();
+	SendOpcode(RBM);
+
+	while(wLeft)
+	{
+		wBlock = wLeft < ENC_SPI_DMA_BUFFER_SIZE ? wLeft : ENC_SPI_DMA_BUFFER_SIZE;
+		StartBlock(val ? val : _rgbBuffer, wBlock);
+		while(!IsBlockDone());
+
+		if(val)
+			val += wBlock;
+		wLeft -= wBlock;
+	}
+
+	ENC_CS_IO = 1;
+	return len;
+}
+
+/*****************************************************************************
+  Function:
+	void ENCSPIWrite(BYTE *val, WORD len)
+
+  Summary:
+	Writes the buffer memory at EWRPT
+
+  Description:
+	Same as MACPutArray(), except that the last block may still be
+	going out when this returns.  val is free to reuse either way.
+
+  Precondition:
+	ENCSPIInit() has been called
+
+  Parameters:
+	val - the bytes
+	len - how many
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ENCSPIWrite(BYTE *val, WORD len)
+{
+	WORD wBlock;
+
+	ENCSPIWait();
+	SendOpcode(WBM);
+	_bBusy = TRUE;
+
+	while(1)
+	{
+		wBlock = len < ENC_SPI_DMA_BUFFER_SIZE ? len : ENC_SPI_DMA_BUFFER_SIZE;
+		memcpy(_rgbBuffer, val, wBlock);
+		StartBlock(_rgbBuffer, wBlock);
+
+		val += wBlock;
+		len -= wBlock;
+		if(len == 0u)
+			break;
+
+		while(!IsBlockDone());
+	}
+}
+
+/*****************************************************************************
+  Function:
+	BOOL ENCSPIIsDone(void)
+
+  Summary:
+	Checks whether the last ENCSPIWrite() has gone out
+
+  Description:
+	Once it has, the burst is ended.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	TRUE if the SPI is free for the next access
+  ***************************************************************************/
+BOOL ENCSPIIsDone(void)
+{
+	if(_bBusy && IsBlockDone())
+	{
+		ENC_CS_IO = 1;
+		_bBusy = FALSE;
+	}
+
+	return !_bBusy;
+}
+
+/*****************************************************************************
+  Function:
+	void ENCSPIWait(void)
+
+  Summary:
+	Finishes the last ENCSPIWrite()
+
+  Description:
+	ENC28J60.c calls this before every access to the chip.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ENCSPIWait(void)
+{
+	while(!ENCSPIIsDone());
+}
+
+#endif //#if defined(ENC_CS_TRIS) && defined(ENC_SPI_DMA) && defined(__PIC32MX__)
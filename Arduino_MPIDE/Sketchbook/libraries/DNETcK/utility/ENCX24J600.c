@@ -1123,6 +1123,74 @@ BOOL MACIsMemCopyDone(void)
 }
 
 
+/*****************************************************************************
+  Function:
+	void MACMemCopyChecksumAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
+
+  Summary:
+	Asynchronously copies data within the Ethernet memory and checksums it 
+	on the way.
+
+  Description:
+	Same as MACMemCopyAsync(), except that the DMA engine also calculates 
+	the IP checksum of the bytes it copies, at no extra cost.  The CPU is 
+	free to build headers while the copy runs; MACGetMemCopyChecksum() 
+	then gets the checksum.
+
+  Precondition:
+	SPI bus must be initialized (done in MACInit()).
+
+  Parameters:
+	destAddr - Destination address, or (PTR_BASE)-1 for EGPWRPT
+	sourceAddr - Source address, or (PTR_BASE)-1 for ERXRDPT
+	len - Number of bytes to copy, at least 1
+
+  Returns:
+	None
+
+  Remarks:
+	The checksum is only kept until the next DMA operation, so nothing 
+	else may use the DMA engine (MACMemCopyAsync(), CalcIPBufferChecksum(), 
+	MACCalcRxChecksum(), ...) before MACGetMemCopyChecksum() is called.
+ *****************************************************************************/
+void MACMemCopyChecksumAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
+{
+	// DMANOCS and DMACSSD are left as the last operation set them and are 
+	// read when the DMA starts, so clear them while the engine is idle
+	while(ReadReg(ECON1) & ECON1_DMAST);
+	BFCReg(ECON1, ECON1_DMANOCS | ECON1_DMACSSD);
+
+	MACMemCopyAsync(destAddr, sourceAddr, len);
+}
+
+/*****************************************************************************
+  Function:
+	WORD MACGetMemCopyChecksum(void)
+
+  Summary:
+	Waits for MACMemCopyChecksumAsync() and gets the checksum.
+
+  Description:
+	None
+
+  Precondition:
+	MACMemCopyChecksumAsync() has been called, with no other DMA operation 
+	since.
+
+  Parameters:
+	None
+
+  Returns:
+	The IP checksum of the bytes copied, in the same byte order as 
+	CalcIPChecksum() returns.
+ *****************************************************************************/
+WORD MACGetMemCopyChecksum(void)
+{
+	while(!MACIsMemCopyDone());
+	return ReadReg(EDMACS);
+}
+
+
 /******************************************************************************
  * Function:        BYTE MACGet()
  *
@@ -345,6 +345,14 @@ void MACInit(void)
 		break;
 	}
 
+	#if defined(STACK_USE_RX_INTERRUPT)
+	// Let the RX interrupt tell StackTask() when there is something to get
+	EthEventsClr(ETH_EV_RXDONE|ETH_EV_RXBUFNA|ETH_EV_RXOVFLOW);
+	EthEventsEnableSet(ETH_EV_RXDONE|ETH_EV_RXBUFNA|ETH_EV_RXOVFLOW);
+	IPC12bits.ETHIP = 2;	// Interrupt priority 2 (low), same as the tick
+	IFS1CLR = _IFS1_ETHIF_MASK;
+	IEC1SET = _IEC1_ETHIE_MASK;
+	#endif
 	
 //	return !initFail;	// at this point initFail gives some indication of any existent problems
 	
@@ -603,6 +611,9 @@ void MACFlush(void)
 {
 	if(_pTxCurrDcpt && _TxCurrSize)
 	{	// there is a buffer to transmit
+		#if defined(STACK_USE_PCAP_CAPTURE)
+		PcapCaptureFrame((BYTE*)_pTxCurrDcpt->dataBuff, _TxCurrSize);
+		#endif
 		_pTxCurrDcpt->txBusy=1;	
 		EthTxSendBuffer((void*)_pTxCurrDcpt->dataBuff, _TxCurrSize);
 		// res should be ETH_RES_OK since we made sure we had a descriptor available
@@ -733,6 +744,10 @@ BOOL MACGetHeader(MAC_ADDR *remote, BYTE* type)
 			{
 				*type=newType.v[1];
 			}
+
+			#if defined(STACK_USE_PCAP_CAPTURE)
+			PcapCaptureFrame(_pRxCurrBuff, _RxCurrSize);
+			#endif
 			
 			_stackMgrRxOkPkts++;
 		}
@@ -922,7 +937,9 @@ WORD MACGetFreeRxSize(void)
  *
  * Output:          None
  *
- * Side Effects:    None
+ * Side Effects:    A pointer given as -1 is left after the bytes copied, as the
+ *                  external MACs leave it; TCP.c copies a wrapping segment into
+ *                  a socket's FIFO with two calls that rely on this.
  *
  * Overview:        Copies data from one address to another within the Ethernet memory.
  *                  Overlapped memory regions are allowed only if the destination start address
@@ -938,6 +955,10 @@ void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
 
 		pDst=(destAddr==-1)?_CurrWrPtr:(unsigned char*)destAddr;
 		pSrc=(sourceAddr==-1)?_CurrRdPtr:(unsigned char*)sourceAddr;
+		if(destAddr==-1)
+			_CurrWrPtr+=len;
+		if(sourceAddr==-1)
+			_CurrRdPtr+=len;
 		
 		memcpy(pDst, pSrc, len);
 
@@ -1248,6 +1269,32 @@ static int _LinkReconfigure(void)
 }
 
 
+#if defined(STACK_USE_RX_INTERRUPT)
+/*********************************************************************
+ * Function:        void _EthInterrupt(void)
+ *
+ * PreCondition:    MACInit() enabled the RX events
+ * 
+ * Input:           None
+ * 
+ * Output:          None
+ * 
+ * Side Effects:    None
+ * 
+ * Overview:        Tells StackTask() a frame came in, or that the
+ *                  RX buffers filled up and need emptying.
+ * 
+ * Note:            The frames are left for StackTask() to get.
+ ********************************************************************/
+void __attribute((interrupt(ipl2), vector(_ETH_VECTOR), nomips16)) _EthInterrupt(void)
+{
+	EthEventsClr(ETH_EV_RXDONE|ETH_EV_RXBUFNA|ETH_EV_RXOVFLOW);
+	IFS1CLR = _IFS1_ETHIF_MASK;
+
+	StackRxSignal();
+}
+#endif
+
 
 #endif	// defined(__PIC32MX__) && defined(_ETH)
 
@@ -0,0 +1,729 @@
+/************************************************************************/
+/*																		*/
+/*	HostENC28J60.c	--  Simulated ENC28J60 for hosts                    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	The chip and SPI module of HostENC28J60.h.                          */
+/*																		*/
+/************************************************************************/
+
+#include <string.h>
+#include <time.h>
+
+#include "TCPIP Stack/TCPIP.h"
+
+#if defined(HOST_MAC) && defined(HOST_ENC28J60)
+
+#include "TCPIP Stack/ENC28J60SPI.h"
+#include "TCPIP Stack/HostENC28J60.h"
+
+// Commands, the top three bits of the first byte after chip select
+#define OP_RCR					(0u)
+#define OP_RBM					(1u)
+#define OP_WCR					(2u)
+#define OP_WBM					(3u)
+#define OP_BFS					(4u)
+#define OP_BFC					(5u)
+#define OP_SR					(7u)
+
+#define ENC_REVID				(0x06u)		// B7 silicon
+
+// A register by its ENC28J60.h name, the bank in the high byte; EIE
+// to ECON1 are in every bank and kept in bank 0's
+#define REG(r)					(_rgbRegs[((r) & 0x1Fu) >= (BYTE)EIE ? 0u : ((r) >> 8) & 3u][(r) & 0x1Fu])
+
+HOST_ENC_SPICON			HostENCSPICON;
+DWORD					HostENCSPIBRG;
+BYTE					HostENCCSTris;
+
+static BYTE				_rgbMemory[HOST_ENC_MEMORY_SIZE];
+static BYTE				_rgbRegs[4][32];
+static WORD				_rgwPhy[32];
+static BOOL				_bPowered;
+
+static BYTE				_bCS = 1;			// ENC_CS_IO as last written
+static DWORD			_dwSPIBuffer;		// ENC_SSPBUF
+static BOOL				_bSPIPending;		// ENC_SSPBUF touched since the last word
+static BOOL				_bInCommand;		// the opcode of this chip select is in
+static BYTE				_bOpcode;
+static WORD				_wArgBytes;			// bytes since the opcode
+
+static BYTE				_rgbTxFrame[1518];	// the last frame sent
+static WORD				_wTxFrame;
+
+static BOOL				_bBusy;				// a DMA write is on the wire
+static QWORD			_qwDoneNs;			// when it will be done
+static HOST_ENC_STATS	_Stats;
+
+static QWORD NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (QWORD)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Wire time of len bytes
+static QWORD WireNs(WORD len)
+{
+	return (QWORD)len * 8u * 1000000000ull / HOST_ENC_SPI_HZ;
+}
+
+static WORD GetReg16(WORD Register)
+{
+	return REG(Register) | ((WORD)REG(Register + 1u) << 8);
+}
+
+static void SetReg16(WORD Register, WORD wVal)
+{
+	REG(Register) = (BYTE)wVal;
+	REG(Register + 1u) = (BYTE)(wVal >> 8);
+}
+
+// Buffer memory address held by a register pair
+static WORD GetPtr(WORD Register)
+{
+	return GetReg16(Register) % HOST_ENC_MEMORY_SIZE;
+}
+
+// The address after w for ERDPT and the DMA source, which go from
+// ERXND back to ERXST
+static WORD NextInRx(WORD w)
+{
+	if(w == GetPtr(ERXNDL))
+		return GetPtr(ERXSTL);
+
+	return (w + 1u) % HOST_ENC_MEMORY_SIZE;
+}
+
+static void SystemReset(void)
+{
+	memset(_rgbRegs, 0, sizeof(_rgbRegs));
+	memset(_rgwPhy, 0, sizeof(_rgwPhy));
+
+	SetReg16(ERDPTL, 0x05FA);
+	SetReg16(ERXSTL, 0x05FA);
+	SetReg16(ERXNDL, HOST_ENC_MEMORY_SIZE - 1u);
+	SetReg16(ERXWRPTL, 0x05FA);
+	REG(ESTAT) = ESTAT_CLKRDY;
+	REG(ECON2) = ECON2_AUTOINC;
+	REG(EREVID) = ENC_REVID;
+
+	_rgwPhy[PHSTAT1] = PHSTAT1_PFDPX | PHSTAT1_PHDPX | PHSTAT1_LLSTAT;
+	_rgwPhy[PHID1] = 0x0083;
+	_rgwPhy[PHID2] = 0x1400;
+}
+
+// Copies EDMAST..EDMAND to EDMADST; checksums (ECON1.CSUMEN) are not
+// simulated, ENC28J60.c does them in software
+static void CopyDMA(void)
+{
+	WORD wSrc = GetPtr(EDMASTL);
+	WORD wEnd = GetPtr(EDMANDL);
+	WORD wDst = GetPtr(EDMADSTL);
+	WORD i;
+
+	for(i = 0; i < HOST_ENC_MEMORY_SIZE; i++)
+	{
+		_rgbMemory[wDst] = _rgbMemory[wSrc];
+		if(wSrc == wEnd)
+			break;
+		wSrc = NextInRx(wSrc);
+		wDst = (wDst + 1u) % HOST_ENC_MEMORY_SIZE;
+	}
+}
+
+// Sends ETXST+1..ETXND, the byte at ETXST being the per packet control byte
+static void Transmit(void)
+{
+	WORD w = (GetPtr(ETXSTL) + 1u) % HOST_ENC_MEMORY_SIZE;
+	WORD wEnd = GetPtr(ETXNDL);
+
+	for(_wTxFrame = 0; _wTxFrame < sizeof(_rgbTxFrame); )
+	{
+		_rgbTxFrame[_wTxFrame++] = _rgbMemory[w];
+		if(w == wEnd)
+			break;
+		w = (w + 1u) % HOST_ENC_MEMORY_SIZE;
+	}
+}
+
+// MAC and MII registers answer RCR after a dummy byte
+static BOOL IsMACMIIReg(BYTE Address)
+{
+	BYTE bBank = REG(ECON1) & (ECON1_BSEL1 | ECON1_BSEL0);
+
+	if(Address >= (BYTE)EIE)
+		return FALSE;
+
+	return bBank == 2u || (bBank == 3u && (Address <= (BYTE)MAADR2 || Address == (BYTE)MISTAT));
+}
+
+static void WriteControl(BYTE Address, BYTE Data)
+{
+	WORD Register = Address;
+
+	if(Address < (BYTE)EIE)
+		Register |= (WORD)(REG(ECON1) & (ECON1_BSEL1 | ECON1_BSEL0)) << 8;
+
+	// the high bytes of the buffer pointers have 5 bits
+	if(Register <= EDMADSTH && (Register & 1u))
+		Data &= 0x1Fu;
+	REG(Register) = Data;
+
+	switch(Register)
+	{
+		case ERXSTL:
+		case ERXSTH:
+			SetReg16(ERXWRPTL, GetReg16(ERXSTL));
+			break;
+
+		case MICMD:
+			if(Data & MICMD_MIIRD)
+				SetReg16(MIRDL, _rgwPhy[REG(MIREGADR) & 0x1Fu]);
+			break;
+
+		case MIWRH:
+			_rgwPhy[REG(MIREGADR) & 0x1Fu] = GetReg16(MIWRL);
+			break;
+
+		case ECON1:
+			// copies and transmissions are done as soon as started
+			if(Data & ECON1_DMAST)
+			{
+				CopyDMA();
+				REG(ECON1) &= ~ECON1_DMAST;
+				REG(EIR) |= EIR_DMAIF;
+			}
+			if(Data & ECON1_TXRTS)
+			{
+				Transmit();
+				REG(ECON1) &= ~ECON1_TXRTS;
+				REG(EIR) |= EIR_TXIF;
+			}
+			break;
+
+		case ECON2:
+			if(Data & ECON2_PKTDEC)
+			{
+				if(REG(EPKTCNT))
+					REG(EPKTCNT)--;
+				REG(ECON2) &= ~ECON2_PKTDEC;
+			}
+			break;
+	}
+}
+
+// One byte on the SPI while the chip is selected
+static BYTE ExchangeByte(BYTE b)
+{
+	BYTE bAddress = _bOpcode & 0x1Fu;
+	BYTE bResult = 0;
+	WORD w;
+
+	if(!_bInCommand)
+	{
+		_bInCommand = TRUE;
+		_bOpcode = b;
+		_wArgBytes = 0;
+		if((b >> 5) == OP_SR)
+			SystemReset();
+		return 0;
+	}
+
+	switch(_bOpcode >> 5)
+	{
+		case OP_RCR:
+			if(_wArgBytes != 0u || !IsMACMIIReg(bAddress))
+				bResult = REG(bAddress | ((WORD)(REG(ECON1) & (ECON1_BSEL1 | ECON1_BSEL0)) << 8));
+			break;
+
+		case OP_RBM:
+			w = GetPtr(ERDPTL);
+			bResult = _rgbMemory[w];
+			SetReg16(ERDPTL, NextInRx(w));
+			break;
+
+		case OP_WBM:
+			w = GetPtr(EWRPTL);
+			_rgbMemory[w] = b;
+			SetReg16(EWRPTL, (w + 1u) % HOST_ENC_MEMORY_SIZE);
+			break;
+
+		case OP_WCR:
+			if(_wArgBytes == 0u)
+				WriteControl(bAddress, b);
+			break;
+
+		// bit field commands only reach the ETH registers
+		case OP_BFS:
+			if(_wArgBytes == 0u)
+				WriteControl(bAddress, REG(bAddress | ((WORD)(REG(ECON1) & (ECON1_BSEL1 | ECON1_BSEL0)) << 8)) | b);
+			break;
+
+		case OP_BFC:
+			if(_wArgBytes == 0u)
+				WriteControl(bAddress, REG(bAddress | ((WORD)(REG(ECON1) & (ECON1_BSEL1 | ECON1_BSEL0)) << 8)) & ~b);
+			break;
+	}
+
+	_wArgBytes++;
+	return bResult;
+}
+
+// Shifts out ENC_SSPBUF, 8, 16 or 32 bits of it as the SPI module is set,
+// most significant byte first, and shifts the answer in
+static void Exchange(void)
+{
+	BYTE cBytes = HostENCSPICON.MODE32 ? 4u : HostENCSPICON.MODE16 ? 2u : 1u;
+	DWORD dwIn = 0;
+	QWORD qwStartNs = NowNs();
+	BYTE i;
+
+	for(i = cBytes; i-- > 0u; )
+	{
+		if(_bCS == 0u)
+			dwIn |= (DWORD)ExchangeByte((BYTE)(_dwSPIBuffer >> (8u * i))) << (8u * i);
+		else
+			dwIn |= 0xFFul << (8u * i);
+	}
+	_dwSPIBuffer = dwIn;
+
+	_Stats.dwBytes += cBytes;
+	_Stats.qwWireNs += WireNs(cBytes);
+
+	// the CPU waits out every word
+	while(NowNs() - qwStartNs < WireNs(cBytes));
+	_Stats.qwWaitNs += NowNs() - qwStartNs;
+}
+
+/*****************************************************************************
+  Function:
+	BYTE *HostENCChipSelect(void)
+
+  Summary:
+	ENC_CS_IO of Host-ENC28J60.x
+
+  Description:
+	The value written through the pointer is seen at the next access;
+	if it deselected the chip, the command it ended is over.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	Where ENC_CS_IO is kept
+  ***************************************************************************/
+BYTE *HostENCChipSelect(void)
+{
+	if(!_bPowered)
+	{
+		SystemReset();
+		_bPowered = TRUE;
+	}
+
+	if(_bCS)
+		_bInCommand = FALSE;
+
+	if(!ENCSPIIsDone())
+		_Stats.cOverlaps++;
+
+	return &_bCS;
+}
+
+/*****************************************************************************
+  Function:
+	DWORD *HostENCSPIBuffer(void)
+
+  Summary:
+	ENC_SSPBUF of Host-ENC28J60.x
+
+  Description:
+	What was written through the pointer goes out when ENC_SPISTATbits
+	is next looked at; what comes back replaces it.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	Where ENC_SSPBUF is kept
+  ***************************************************************************/
+DWORD *HostENCSPIBuffer(void)
+{
+	_bSPIPending = TRUE;
+	return &_dwSPIBuffer;
+}
+
+/*****************************************************************************
+  Function:
+	HOST_ENC_SPISTAT *HostENCSPIStatus(void)
+
+  Summary:
+	ENC_SPISTATbits of Host-ENC28J60.x
+
+  Description:
+	Exchanges the word in ENC_SSPBUF, if there is one, so the status
+	always shows it sent and the answer in.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	The status bits
+  ***************************************************************************/
+HOST_ENC_SPISTAT *HostENCSPIStatus(void)
+{
+	static HOST_ENC_SPISTAT Status = {1, 1};
+
+	if(_bSPIPending)
+	{
+		_bSPIPending = FALSE;
+		Exchange();
+	}
+
+	return &Status;
+}
+
+/*****************************************************************************
+  Function:
+	void ENCSPIInit(void)
+
+  Summary:
+	Readies the simulated DMA transport
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ENCSPIInit(void)
+{
+	_bBusy = FALSE;
+}
+
+/*****************************************************************************
+  Function:
+	WORD ENCSPIRead(BYTE *val, WORD len)
+
+  Summary:
+	Reads the simulated buffer memory at ERDPT
+
+  Description:
+	ERDPT goes from ERXND back to ERXST, as it does on the chip with
+	ECON2.AUTOINC set.  The call takes the wire time, all of it spent
+	waiting, as a read on the board does.
+
+  Precondition:
+	None
+
+  Parameters:
+	val - where to put the bytes, NULL to skip them
+	len - how many
+
+  Returns:
+  	len
+  ***************************************************************************/
+WORD ENCSPIRead(BYTE *val, WORD len)
+{
+	QWORD qwStartNs;
+	WORD w;
+	WORD i;
+
+	ENCSPIWait();
+
+	qwStartNs = NowNs();
+	w = GetPtr(ERDPTL);
+	for(i = 0; i < len; i++)
+	{
+		if(val)
+			*val++ = _rgbMemory[w];
+		w = NextInRx(w);
+	}
+	SetReg16(ERDPTL, w);
+
+	_Stats.cReads++;
+	_Stats.dwBytes += len + 1u;
+	_Stats.qwWireNs += WireNs(len + 1u);
+
+	// spin out the rest of the wire time
+	while(NowNs() - qwStartNs < WireNs(len + 1u));
+	_Stats.qwWaitNs += NowNs() - qwStartNs;
+
+	return len;
+}
+
+/*****************************************************************************
+  Function:
+	void ENCSPIWrite(BYTE *val, WORD len)
+
+  Summary:
+	Writes the simulated buffer memory at EWRPT
+
+  Description:
+	The memory is written at once but the transfer counts as busy for
+	its wire time, like a DMA write on the board.
+
+  Precondition:
+	None
+
+  Parameters:
+	val - the bytes
+	len - how many
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ENCSPIWrite(BYTE *val, WORD len)
+{
+	WORD w;
+	WORD i;
+
+	ENCSPIWait();
+
+	w = GetPtr(EWRPTL);
+	for(i = 0; i < len; i++)
+	{
+		_rgbMemory[w] = *val++;
+		w = (w + 1u) % HOST_ENC_MEMORY_SIZE;
+	}
+	SetReg16(EWRPTL, w);
+
+	_Stats.cWrites++;
+	_Stats.dwBytes += len + 1u;
+	_Stats.qwWireNs += WireNs(len + 1u);
+
+	_qwDoneNs = NowNs() + WireNs(len + 1u);
+	_bBusy = TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	BOOL ENCSPIIsDone(void)
+
+  Summary:
+	Checks whether the last ENCSPIWrite() would be off the wire
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	TRUE if the simulated SPI is free
+  ***************************************************************************/
+BOOL ENCSPIIsDone(void)
+{
+	if(_bBusy && NowNs() >= _qwDoneNs)
+		_bBusy = FALSE;
+
+	return !_bBusy;
+}
+
+/*****************************************************************************
+  Function:
+	void ENCSPIWait(void)
+
+  Summary:
+	Waits out the last ENCSPIWrite()
+
+  Description:
+	The time spent here is what the CPU still loses with DMA.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+void ENCSPIWait(void)
+{
+	QWORD qwStartNs;
+
+	if(ENCSPIIsDone())
+		return;
+
+	qwStartNs = NowNs();
+	while(!ENCSPIIsDone());
+	_Stats.qwWaitNs += NowNs() - qwStartNs;
+}
+
+/*****************************************************************************
+  Function:
+	BOOL HostENCReceive(BYTE *pFrame, WORD wLen)
+
+  Summary:
+	Receives a frame into the RX ring
+
+  Description:
+	The frame goes in at ERXWRPT behind the next packet pointer and a
+	receive status vector, followed by 4 CRC bytes, and EPKTCNT counts
+	it, as the chip does with a good frame off the wire.
+
+  Precondition:
+	MACInit() has been called
+
+  Parameters:
+	pFrame - the frame, Ethernet header on
+	wLen - its length, without CRC
+
+  Returns:
+  	TRUE if it fit, FALSE if reception is off or the ring is full
+  ***************************************************************************/
+BOOL HostENCReceive(BYTE *pFrame, WORD wLen)
+{
+	WORD wStart = GetPtr(ERXSTL);
+	WORD wWrite = GetPtr(ERXWRPTL);
+	WORD wRead = GetPtr(ERXRDPTL);
+	WORD wSize = GetPtr(ERXNDL) - wStart + 1u;
+	WORD wNeed = (6u + wLen + 4u + 1u) & ~1u;
+	WORD wFree;
+	WORD wNext;
+	BYTE rgbHeader[6];
+	WORD i;
+
+	if(!(REG(ECON1) & ECON1_RXEN) || REG(EPKTCNT) == 0xFFu)
+		return FALSE;
+
+	// as MACGetFreeRxSize() works it out
+	if(wWrite > wRead)
+		wFree = wSize - 1u - (wWrite - wRead);
+	else if(wWrite == wRead)
+		wFree = wSize - 1u;
+	else
+		wFree = wRead - wWrite - 1u;
+	if(wNeed > wFree)
+		return FALSE;
+
+	wNext = wWrite + wNeed;
+	if(wNext >= wStart + wSize)
+		wNext -= wSize;
+
+	rgbHeader[0] = (BYTE)wNext;
+	rgbHeader[1] = (BYTE)(wNext >> 8);
+	rgbHeader[2] = (BYTE)(wLen + 4u);
+	rgbHeader[3] = (BYTE)((wLen + 4u) >> 8);
+	rgbHeader[4] = 0x80;			// Received Ok
+	rgbHeader[5] = 0x00;
+
+	for(i = 0; i < wNeed; i++)
+	{
+		if(i < sizeof(rgbHeader))
+			_rgbMemory[wWrite] = rgbHeader[i];
+		else if(i < sizeof(rgbHeader) + wLen)
+			_rgbMemory[wWrite] = pFrame[i - sizeof(rgbHeader)];
+		else
+			_rgbMemory[wWrite] = 0x00;
+		wWrite = NextInRx(wWrite);
+	}
+
+	SetReg16(ERXWRPTL, wNext);
+	REG(EPKTCNT)++;
+	REG(EIR) |= EIR_PKTIF;
+
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	WORD HostENCGetTxFrame(BYTE *pFrame, WORD wSize)
+
+  Summary:
+	Gets the last frame ECON1.TXRTS sent
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	pFrame - receives the frame, without CRC
+	wSize - room at pFrame
+
+  Returns:
+  	The frame's length, 0 if none has been sent
+  ***************************************************************************/
+WORD HostENCGetTxFrame(BYTE *pFrame, WORD wSize)
+{
+	memcpy(pFrame, _rgbTxFrame, _wTxFrame < wSize ? _wTxFrame : wSize);
+	return _wTxFrame;
+}
+
+// The simulated buffer memory, HOST_ENC_MEMORY_SIZE bytes
+BYTE *HostENCMemory(void)
+{
+	return _rgbMemory;
+}
+
+/*****************************************************************************
+  Function:
+	void HostENCGetStats(HOST_ENC_STATS *pStats, BOOL bReset)
+
+  Summary:
+	Gets the transfer counts and times
+
+  Description:
+	1 - qwWaitNs/qwWireNs is the share of the SPI time the CPU got back.
+
+  Precondition:
+	None
+
+  Parameters:
+	pStats - receives the statistics
+	bReset - TRUE to start counting again
+
+  Returns:
+  	None
+  ***************************************************************************/
+void HostENCGetStats(HOST_ENC_STATS *pStats, BOOL bReset)
+{
+	*pStats = _Stats;
+
+	if(bReset)
+		memset(&_Stats, 0, sizeof(_Stats));
+}
+
+#endif //#if defined(HOST_MAC) && defined(HOST_ENC28J60)
@@ -0,0 +1,1043 @@
+/************************************************************************/
+/*																		*/
+/*	HostMAC.c	--  Host MAC for running the MAL on a Linux PC          */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Implements the MAC.h interface with plain RAM buffers, the same     */
+/*	way ETHPIC32IntMac.c does, so TCP.c, UDP.c, ARP.c and StackTask()   */
+/*	run unchanged on a host.  Frames the stack sends go to a virtual    */
+/*	switch that learns which port each MAC address is on, floods        */
+/*	broadcasts and loops frames addressed to the sender back to it.     */
+/*																		*/
+/*	Host code plays other nodes with HostMACAttach(), HostMACSend()     */
+/*	and HostMACReceive().  With HOST_MAC_TAP defined, a Linux TAP       */
+/*	device (HOST_MAC_TAP_NAME, created beforehand with ip tuntap) is    */
+/*	put on one more port.                                               */
+/*																		*/
+/*	With HOST_ENCX24J600, copies and checksums in the MAC memory take   */
+/*	as long as the ENCX24J600's DMA engine would and copies go on in    */
+/*	the background, see HostMAC.h.                                      */
+/*																		*/
+/************************************************************************/
+
+#include <string.h>
+#include <time.h>
+
+#include "TCPIP Stack/TCPIP.h"
+#include "TCPIP Stack/MAC.h"
+
+// with HOST_ENC28J60 the MAC is ENC28J60.c on HostENC28J60.c's chip
+#if defined(HOST_MAC) && !defined(HOST_ENC28J60)
+
+#if defined(HOST_MAC_TAP)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/ioctl.h>
+	#include <net/if.h>
+	#include <linux/if_tun.h>
+#endif
+
+#define ETHER_IP    (0x00u)
+#define ETHER_ARP   (0x06u)
+
+typedef struct
+{
+	WORD			wLength;
+	BYTE			rgbFrame[HOST_MAC_FRAME_SIZE];
+} HOST_MAC_FRAME;
+
+typedef struct
+{
+	BOOL			fAttached;
+	BOOL			fLearned;						// MACAddr has been seen as a source on this port
+	MAC_ADDR		MACAddr;
+	WORD			iHead;							// oldest frame in rgFrames
+	WORD			cFrames;
+	DWORD			dwDropped;						// frames lost because rgFrames was full
+	DWORD			dwLossEvery;					// every Nth frame is lost, 0 for none
+	DWORD			dwLossCount;					// frames since the last one lost
+	DWORD			dwLost;							// frames lost to dwLossEvery
+	HOST_MAC_FRAME	rgFrames[HOST_MAC_QUEUE_FRAMES];
+} HOST_MAC_PORT;
+
+// the virtual switch
+static HOST_MAC_PORT		_Ports[HOST_MAC_PORTS];
+
+// TX buffer, frames are copied out on MACFlush() so there is always one free
+static unsigned int			_TxBuffer[(MAC_TX_BUFFER_SIZE+sizeof(ETHER_HEADER)+sizeof(int)-1)/sizeof(int)];
+static WORD					_TxCurrSize=0;
+
+// RX frame handed to the stack by MACGetHeader(), still at the head of port 0
+static HOST_MAC_FRAME*		_pRxCurrFrame=0;
+
+// HTTP +SSL buffers
+static unsigned char		_HttpSSlBuffer[RESERVED_HTTP_MEMORY+RESERVED_SSL_MEMORY];
+
+// TCBs and FIFOs of the TCP_ETH_RAM sockets
+#if TCP_ETH_RAM_SIZE > 0
+static unsigned char		_TcbBuffer[TCP_ETH_RAM_SIZE];
+#endif
+
+static unsigned char*		_CurrWrPtr=0;
+static unsigned char*		_CurrRdPtr=0;
+
+#if defined(HOST_MAC_TAP)
+static int					_fdTap=-1;						// TAP device, -1 if not open
+static BYTE					_TapPort=HOST_MAC_INVALID_PORT;	// switch port the TAP device is on
+#endif
+
+#if defined(HOST_ENCX24J600)
+static QWORD				_qwDmaDoneNs;					// when the DMA engine goes idle
+static WORD					_wDmaChecksum;					// EDMACS
+static BYTE					_vDmaChecksumCopies;			// MACMemCopyChecksumAsync() calls for the frame being built
+static QWORD				_qwDmaStatsStartNs;
+static HOST_MAC_DMA_STATS	_DmaStats;
+
+static QWORD NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (QWORD)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Waits for the DMA engine to go idle
+static void DmaWait(void)
+{
+	QWORD qwNowNs = NowNs();
+
+	if(qwNowNs >= _qwDmaDoneNs)
+		return;
+
+	_DmaStats.qwWaitNs += _qwDmaDoneNs - qwNowNs;
+	while(NowNs() < _qwDmaDoneNs);
+}
+
+// Keeps the DMA engine busy for as long as len bytes take
+static void DmaStart(WORD len)
+{
+	QWORD qwBusyNs = (QWORD)len * 1000000000ull / HOST_ENCX24J600_DMA_BPS;
+
+	_DmaStats.dwBytes += len;
+	_DmaStats.qwBusyNs += qwBusyNs;
+	_qwDmaDoneNs = NowNs() + qwBusyNs;
+}
+
+// Copies the way the ENCX24J600 does, moving the pointers given as -1
+static void DmaCopy(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len, BOOL bChecksum)
+{
+	unsigned char	*pDst, *pSrc;
+
+	DmaWait();
+
+	pDst=(destAddr==(PTR_BASE)-1)?_CurrWrPtr:(unsigned char*)destAddr;
+	pSrc=(sourceAddr==(PTR_BASE)-1)?_CurrRdPtr:(unsigned char*)sourceAddr;
+	if(destAddr==(PTR_BASE)-1)
+		_CurrWrPtr+=len;
+	if(sourceAddr==(PTR_BASE)-1)
+		_CurrRdPtr+=len;
+
+	memmove(pDst, pSrc, len);
+	if(bChecksum)
+		_wDmaChecksum=CalcIPChecksum(pDst, len);
+
+	_DmaStats.cCopies++;
+	DmaStart(len);
+}
+
+// Checksums take the DMA engine too, and the caller waits for them
+static WORD DmaChecksum(BYTE *buffer, WORD len)
+{
+	DmaWait();
+	_DmaStats.cChecksums++;
+	DmaStart(len);
+	DmaWait();
+
+	return CalcIPChecksum(buffer, len);
+}
+
+// Sums a TCP or UDP frame over again in software, FALSE if its checksum is wrong
+static BOOL FrameChecksumCheck(const BYTE *pFrame, WORD wLength)
+{
+	const IP_HEADER *pIP = (const IP_HEADER*)(pFrame + sizeof(ETHER_HEADER));
+	const BYTE *pSegment;
+	PSEUDO_HEADER pseudo;
+	DWORD_VAL sum;
+	WORD wHeaderLen, wSegmentLen;
+
+	if(wLength < sizeof(ETHER_HEADER) + sizeof(IP_HEADER) || pFrame[12] != 0x08u || pFrame[13] != ETHER_IP)
+		return TRUE;
+	if(pIP->Protocol != IP_PROT_TCP && pIP->Protocol != IP_PROT_UDP)
+		return TRUE;
+
+	wHeaderLen = (pIP->VersionIHL & 0x0Fu) << 2;
+	wSegmentLen = swaps(pIP->TotalLength) - wHeaderLen;
+	pSegment = (const BYTE*)pIP + wHeaderLen;
+	if(sizeof(ETHER_HEADER) + wHeaderLen + wSegmentLen > wLength)
+		return FALSE;
+
+	// a UDP checksum of 0 is none
+	if(pIP->Protocol == IP_PROT_UDP && pSegment[6] == 0u && pSegment[7] == 0u)
+		return TRUE;
+
+	_DmaStats.cSummedFrames++;
+	pseudo.SourceAddress = pIP->SourceAddress;
+	pseudo.DestAddress = pIP->DestAddress;
+	pseudo.Zero = 0;
+	pseudo.Protocol = pIP->Protocol;
+	pseudo.Length = swaps(wSegmentLen);
+	sum.Val = (WORD)~CalcIPChecksum((BYTE*)&pseudo, sizeof(pseudo));
+	sum.Val += (WORD)~CalcIPChecksum((BYTE*)pSegment, wSegmentLen);
+	sum.Val = sum.w[0] + sum.w[1];
+	sum.Val = sum.w[0] + sum.w[1];
+
+	return sum.w[0] == 0xFFFFu;
+}
+#endif
+
+/*****************************************************************************
+  Function:
+	static void SwitchQueue(BYTE port, const BYTE *pFrame, WORD wLength)
+
+  Summary:
+	Hands a frame to one switch port
+
+  Description:
+	The TAP port writes the frame straight out, every other port queues it
+	until the stack or the host code reads it.
+
+  Precondition:
+	None
+
+  Parameters:
+	port - the port to deliver to
+	pFrame - the Ethernet frame
+	wLength - length of the frame
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void SwitchQueue(BYTE port, const BYTE *pFrame, WORD wLength)
+{
+	HOST_MAC_PORT *p = &_Ports[port];
+	HOST_MAC_FRAME *pF;
+
+	if(p->dwLossEvery != 0u && ++p->dwLossCount >= p->dwLossEvery)
+	{
+		p->dwLossCount = 0;
+		p->dwLost++;
+		return;
+	}
+
+	#if defined(HOST_MAC_TAP)
+	if(port == _TapPort)
+	{
+		if(write(_fdTap, pFrame, wLength) != wLength)
+			p->dwDropped++;
+		return;
+	}
+	#endif
+
+	if(p->cFrames == HOST_MAC_QUEUE_FRAMES)
+	{
+		p->dwDropped++;
+		return;
+	}
+
+	pF = &p->rgFrames[(p->iHead + p->cFrames) % HOST_MAC_QUEUE_FRAMES];
+	memcpy(pF->rgbFrame, pFrame, wLength);
+	pF->wLength = wLength;
+	p->cFrames++;
+
+	// stands in for the RX interrupt; frames waiting on the TAP device are
+	// only read by MACGetHeader(), so those wait for STACK_RX_POLL_INTERVAL
+	#if defined(STACK_USE_RX_INTERRUPT)
+	if(port == HOST_MAC_STACK_PORT)
+		StackRxSignal();
+	#endif
+}
+
+/*****************************************************************************
+  Function:
+	static void SwitchFrame(BYTE srcPort, const BYTE *pFrame, WORD wLength)
+
+  Summary:
+	Forwards a frame that came in on a switch port
+
+  Description:
+	Learns the source MAC for srcPort, then sends a unicast frame to the
+	port its destination was learned on, which may be srcPort itself.
+	Broadcast, multicast and unknown destinations go to every other port.
+
+  Precondition:
+	None
+
+  Parameters:
+	srcPort - the port the frame came in on
+	pFrame - the Ethernet frame
+	wLength - length of the frame
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void SwitchFrame(BYTE srcPort, const BYTE *pFrame, WORD wLength)
+{
+	const ETHER_HEADER *pHeader = (const ETHER_HEADER*)pFrame;
+	BYTE port;
+
+	if(wLength < sizeof(ETHER_HEADER) || wLength > HOST_MAC_FRAME_SIZE)
+		return;
+
+	_Ports[srcPort].MACAddr = pHeader->SourceMACAddr;
+	_Ports[srcPort].fLearned = TRUE;
+
+	if(!(pHeader->DestMACAddr.v[0] & 0x01))
+	{
+		for(port = 0; port < HOST_MAC_PORTS; port++)
+		{
+			if(_Ports[port].fAttached && _Ports[port].fLearned &&
+			   memcmp(&_Ports[port].MACAddr, &pHeader->DestMACAddr, sizeof(MAC_ADDR)) == 0)
+			{
+				SwitchQueue(port, pFrame, wLength);
+				return;
+			}
+		}
+	}
+
+	for(port = 0; port < HOST_MAC_PORTS; port++)
+	{
+		if(_Ports[port].fAttached && port != srcPort)
+			SwitchQueue(port, pFrame, wLength);
+	}
+}
+
+#if defined(HOST_MAC_TAP)
+/*****************************************************************************
+  Function:
+	static void TapPoll(void)
+
+  Summary:
+	Moves frames waiting on the TAP device onto the switch
+
+  Description:
+	At most one port queue's worth is read per call so a busy host
+	interface can not starve the stack.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void TapPoll(void)
+{
+	BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+	ssize_t cb;
+	WORD i;
+
+	if(_fdTap < 0)
+		return;
+
+	for(i = 0; i < HOST_MAC_QUEUE_FRAMES; i++)
+	{
+		if((cb = read(_fdTap, rgbFrame, sizeof(rgbFrame))) <= 0)
+			break;
+
+		SwitchFrame(_TapPort, rgbFrame, (WORD)cb);
+	}
+}
+
+/*****************************************************************************
+  Function:
+	static int TapOpen(const char *szName)
+
+  Summary:
+	Opens an existing TAP interface without packet info headers
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	szName - interface name
+
+  Returns:
+  	The non-blocking file descriptor, or -1 if it could not be opened.
+  ***************************************************************************/
+static int TapOpen(const char *szName)
+{
+	struct ifreq ifr;
+	int fd;
+
+	if((fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK)) < 0)
+		return -1;
+
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	strncpy(ifr.ifr_name, szName, IFNAMSIZ-1);
+
+	if(ioctl(fd, TUNSETIFF, (void*)&ifr) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+#endif
+
+/*
+ * interface functions
+ *
+*/
+
+/*****************************************************************************
+  Function:
+	void InitMACStaticMemory(void)
+
+  Summary:
+	Initializes all of MAC static memory to zero
+
+  Description:
+    Puts the MAC and the virtual switch back to their just
+    initalized state and closes the TAP device, if open.
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+void InitMACStaticMemory(void)
+{
+	memset(_Ports, 0, sizeof(_Ports));
+	_TxCurrSize=0;
+	_pRxCurrFrame=0;
+	memset(_HttpSSlBuffer, 0, sizeof(_HttpSSlBuffer));
+	#if TCP_ETH_RAM_SIZE > 0
+	memset(_TcbBuffer, 0, sizeof(_TcbBuffer));
+	#endif
+	_CurrWrPtr=0;
+	_CurrRdPtr=0;
+
+	#if defined(HOST_ENCX24J600)
+	_qwDmaDoneNs=0;
+	_wDmaChecksum=0;
+	_vDmaChecksumCopies=0;
+	memset(&_DmaStats, 0, sizeof(_DmaStats));
+	_qwDmaStatsStartNs=NowNs();
+	#endif
+
+	#if defined(HOST_MAC_TAP)
+	if(_fdTap >= 0)
+		close(_fdTap);
+	_fdTap=-1;
+	_TapPort=HOST_MAC_INVALID_PORT;
+	#endif
+}
+
+/****************************************************************************
+ * Function:        MACInit
+ *
+ * PreCondition:    AppConfig.MyMACAddr is set
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Puts the stack on port 0 of an empty switch and, with
+ *                  HOST_MAC_TAP, the TAP device on the next port.
+ *
+ * Note:            If the TAP device can not be opened the switch runs
+ *                  without it.
+ *****************************************************************************/
+void MACInit(void)
+{
+	InitMACStaticMemory();
+
+	_Ports[HOST_MAC_STACK_PORT].fAttached = TRUE;
+	_Ports[HOST_MAC_STACK_PORT].fLearned = TRUE;
+	_Ports[HOST_MAC_STACK_PORT].MACAddr = AppConfig.MyMACAddr;
+
+	#if defined(HOST_MAC_TAP)
+	if((_fdTap = TapOpen(HOST_MAC_TAP_NAME)) >= 0)
+		_TapPort = HostMACAttach();
+	#endif
+}
+
+BOOL MACIsLinked(void)
+{
+	return TRUE;
+}
+
+PTR_BASE MACGetTxBaseAddr(void)
+{
+	return (PTR_BASE)_TxBuffer;
+}
+
+PTR_BASE MACGetHttpBaseAddr(void)
+{
+	return (PTR_BASE)_HttpSSlBuffer;
+}
+
+PTR_BASE MACGetSslBaseAddr(void)
+{
+	return (PTR_BASE)(_HttpSSlBuffer+RESERVED_HTTP_MEMORY);
+}
+
+PTR_BASE MACGetTcbBaseAddr(void)
+{
+	#if TCP_ETH_RAM_SIZE > 0
+	return (PTR_BASE)_TcbBuffer;
+	#else
+	return 0;
+	#endif
+}
+
+
+/**************************
+ * TX functions
+ ***********************************************/
+
+PTR_BASE MACSetWritePtr(PTR_BASE address)
+{
+	unsigned char* oldPtr;
+
+	oldPtr=_CurrWrPtr;
+	_CurrWrPtr=(unsigned char*)address;
+	return (PTR_BASE)oldPtr;
+}
+
+// MACFlush() copies the frame out, so the one TX buffer is always free
+BOOL MACIsTxReady(void)
+{
+	return TRUE;
+}
+
+void MACPut(BYTE val)
+{
+	*_CurrWrPtr++=val;
+}
+
+void MACPutArray(BYTE *buff, WORD len)
+{
+	memcpy(_CurrWrPtr, buff, len);
+	_CurrWrPtr+=len;
+}
+
+void MACPutHeader(MAC_ADDR *remote, BYTE type, WORD dataLen)
+{
+	_TxCurrSize=dataLen+sizeof(ETHER_HEADER);
+	_CurrWrPtr=(unsigned char*)_TxBuffer;
+
+	memcpy(_CurrWrPtr, remote, sizeof(*remote));
+	_CurrWrPtr+=sizeof(*remote);
+	memcpy(_CurrWrPtr, &AppConfig.MyMACAddr, sizeof(AppConfig.MyMACAddr));
+	_CurrWrPtr+=sizeof(AppConfig.MyMACAddr);
+
+	*_CurrWrPtr++=0x08;
+	*_CurrWrPtr++=(type == MAC_IP) ? ETHER_IP : ETHER_ARP;
+}
+
+void MACFlush(void)
+{
+	if(_TxCurrSize)
+	{
+		#if defined(STACK_USE_PCAP_CAPTURE)
+		PcapCaptureFrame((BYTE*)_TxBuffer, _TxCurrSize);
+		#endif
+		#if defined(HOST_ENCX24J600)
+		_DmaStats.cFrames++;
+		if(_vDmaChecksumCopies >= 2u)
+			_DmaStats.cSplitFrames++;
+		_vDmaChecksumCopies = 0;
+		if(!FrameChecksumCheck((BYTE*)_TxBuffer, _TxCurrSize))
+			_DmaStats.cBadChecksums++;
+		#endif
+
+		SwitchFrame(HOST_MAC_STACK_PORT, (BYTE*)_TxBuffer, _TxCurrSize);
+		_TxCurrSize=0;
+	}
+}
+
+/**************************
+ * RX functions
+ ***********************************************/
+
+void MACDiscardRx(void)
+{
+	HOST_MAC_PORT *p = &_Ports[HOST_MAC_STACK_PORT];
+
+	if(_pRxCurrFrame)
+	{
+		p->iHead = (p->iHead + 1) % HOST_MAC_QUEUE_FRAMES;
+		p->cFrames--;
+		_pRxCurrFrame=0;
+	}
+}
+
+/******************************************************************************
+ * Function:        BOOL MACGetHeader(MAC_ADDR *remote, BYTE* type)
+ *
+ * PreCondition:    None
+ *
+ * Input:           *remote: Location to store the Source MAC address of the
+ *                           received frame.
+ *                  *type: Location of a BYTE to store the constant
+ *                         MAC_UNKNOWN, ETHER_IP, or ETHER_ARP, representing
+ *                         the contents of the Ethernet type field.
+ *
+ * Output:          TRUE: If a packet was waiting on the stack's switch port.
+ *                  FALSE: If a packet was not pending.  remote and type are
+ *                         not changed.
+ *
+ * Side Effects:    Last packet is discarded if MACDiscardRx() hasn't already
+ *                  been called.
+ *
+ * Overview:        None
+ *
+ * Note:            Sets the read pointer at the beginning of the new packet
+ *****************************************************************************/
+BOOL MACGetHeader(MAC_ADDR *remote, BYTE* type)
+{
+	HOST_MAC_PORT *p = &_Ports[HOST_MAC_STACK_PORT];
+	WORD_VAL newType;
+
+	MACDiscardRx();
+
+	#if defined(HOST_MAC_TAP)
+	TapPoll();
+	#endif
+
+	if(p->cFrames == 0)
+		return FALSE;
+
+	_pRxCurrFrame=&p->rgFrames[p->iHead];
+	_CurrRdPtr=_pRxCurrFrame->rgbFrame+sizeof(ETHER_HEADER);	// skip the packet header
+
+	memcpy(remote, &((ETHER_HEADER*)_pRxCurrFrame->rgbFrame)->SourceMACAddr, sizeof(*remote));
+	*type=MAC_UNKNOWN;
+	newType=((ETHER_HEADER*)_pRxCurrFrame->rgbFrame)->Type;
+	if( newType.v[0]==0x08 && (newType.v[1]==ETHER_IP || newType.v[1]==ETHER_ARP) )
+	{
+		*type=newType.v[1];
+	}
+
+	#if defined(STACK_USE_PCAP_CAPTURE)
+	PcapCaptureFrame(_pRxCurrFrame->rgbFrame, _pRxCurrFrame->wLength);
+	#endif
+
+	return TRUE;
+}
+
+void MACSetReadPtrInRx(WORD offset)
+{
+	_CurrRdPtr=_pRxCurrFrame->rgbFrame+sizeof(ETHER_HEADER)+offset;
+}
+
+PTR_BASE MACSetReadPtr(PTR_BASE address)
+{
+	unsigned char* oldPtr;
+
+	oldPtr=_CurrRdPtr;
+	_CurrRdPtr=(unsigned char*)address;
+	return (PTR_BASE)oldPtr;
+}
+
+BYTE MACGet(void)
+{
+	return *_CurrRdPtr++;
+}
+
+WORD MACGetArray(BYTE *address, WORD len)
+{
+	if(address)
+	{
+		memcpy(address, _CurrRdPtr, len);
+	}
+
+	_CurrRdPtr+=len;
+	return len;
+}
+
+WORD MACGetFreeRxSize(void)
+{
+	return (HOST_MAC_QUEUE_FRAMES - _Ports[HOST_MAC_STACK_PORT].cFrames) * HOST_MAC_FRAME_SIZE;
+}
+
+#if defined(HOST_ENCX24J600)
+// The bytes are in place at once, the engine stays busy for the copy time
+void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
+{
+	DmaCopy(destAddr, sourceAddr, len, FALSE);
+}
+
+BOOL MACIsMemCopyDone(void)
+{
+	return NowNs() >= _qwDmaDoneNs;
+}
+
+void MACMemCopyChecksumAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
+{
+	_vDmaChecksumCopies++;
+	DmaCopy(destAddr, sourceAddr, len, TRUE);
+}
+
+WORD MACGetMemCopyChecksum(void)
+{
+	DmaWait();
+	return _wDmaChecksum;
+}
+
+WORD CalcIPBufferChecksum(WORD len)
+{
+	return DmaChecksum(_CurrRdPtr, len);
+}
+
+WORD MACCalcRxChecksum(WORD offset, WORD len)
+{
+	return DmaChecksum(_pRxCurrFrame->rgbFrame+sizeof(ETHER_HEADER)+offset, len);
+}
+#else
+// Same as the PIC32 internal MAC, the copy is done before this returns
+void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len)
+{
+	if(len)
+	{
+		unsigned char	*pDst, *pSrc;
+
+		pDst=(destAddr==(PTR_BASE)-1)?_CurrWrPtr:(unsigned char*)destAddr;
+		pSrc=(sourceAddr==(PTR_BASE)-1)?_CurrRdPtr:(unsigned char*)sourceAddr;
+		if(destAddr==(PTR_BASE)-1)
+			_CurrWrPtr+=len;
+		if(sourceAddr==(PTR_BASE)-1)
+			_CurrRdPtr+=len;
+
+		memmove(pDst, pSrc, len);
+	}
+}
+
+BOOL MACIsMemCopyDone(void)
+{
+	return 1;
+}
+
+WORD CalcIPBufferChecksum(WORD len)
+{
+	return CalcIPChecksum(_CurrRdPtr, len);
+}
+
+WORD MACCalcRxChecksum(WORD offset, WORD len)
+{
+	return CalcIPChecksum(_pRxCurrFrame->rgbFrame+sizeof(ETHER_HEADER)+offset, len);
+}
+#endif
+
+#if defined(STACK_USE_ZEROCONF_MDNS_SD)
+// The switch floods every multicast frame, there is no filter to program
+void SetRXHashTableEntry(MAC_ADDR DestMACAddr)
+{
+}
+#endif
+
+/**************************
+ * Host side of the switch
+ ***********************************************/
+
+/*****************************************************************************
+  Function:
+	BYTE HostMACAttach(void)
+
+  Summary:
+	Adds a node to the virtual switch
+
+  Description:
+	The new port starts empty and learns its MAC address from the first
+	frame sent on it with HostMACSend().
+
+  Precondition:
+	MACInit() has been called
+
+  Parameters:
+	None
+
+  Returns:
+  	The port number, or HOST_MAC_INVALID_PORT if all ports are in use.
+  ***************************************************************************/
+BYTE HostMACAttach(void)
+{
+	BYTE port;
+
+	for(port = 0; port < HOST_MAC_PORTS; port++)
+	{
+		if(!_Ports[port].fAttached)
+		{
+			memset(&_Ports[port], 0, sizeof(_Ports[port]));
+			_Ports[port].fAttached = TRUE;
+			return port;
+		}
+	}
+
+	return HOST_MAC_INVALID_PORT;
+}
+
+/*****************************************************************************
+  Function:
+	void HostMACDetach(BYTE port)
+
+  Summary:
+	Takes a node off the virtual switch, dropping anything queued for it
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	port - A port from HostMACAttach()
+
+  Returns:
+  	None
+  ***************************************************************************/
+void HostMACDetach(BYTE port)
+{
+	if(port >= HOST_MAC_PORTS || port == HOST_MAC_STACK_PORT)
+		return;
+
+	_Ports[port].fAttached = FALSE;
+	_Ports[port].fLearned = FALSE;
+	_Ports[port].cFrames = 0;
+}
+
+/*****************************************************************************
+  Function:
+	BOOL HostMACSend(BYTE port, const BYTE *pFrame, WORD wLength)
+
+  Summary:
+	Sends a frame from a host node into the virtual switch
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	port - A port from HostMACAttach()
+	pFrame - A complete Ethernet frame starting with the destination MAC,
+		no CRC
+	wLength - Length of the frame
+
+  Returns:
+  	TRUE if the switch took the frame, FALSE if the port or frame is bad.
+  ***************************************************************************/
+BOOL HostMACSend(BYTE port, const BYTE *pFrame, WORD wLength)
+{
+	if(port >= HOST_MAC_PORTS || port == HOST_MAC_STACK_PORT || !_Ports[port].fAttached)
+		return FALSE;
+
+	if(wLength < sizeof(ETHER_HEADER) || wLength > HOST_MAC_FRAME_SIZE)
+		return FALSE;
+
+	SwitchFrame(port, pFrame, wLength);
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	WORD HostMACReceive(BYTE port, BYTE *pFrame, WORD wMax)
+
+  Summary:
+	Gets the next frame the switch delivered to a host node
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	port - A port from HostMACAttach()
+	pFrame - Buffer to receive the frame
+	wMax - Size of pFrame, a longer frame is cut short
+
+  Returns:
+  	The number of bytes copied to pFrame, 0 if nothing is waiting.
+  ***************************************************************************/
+WORD HostMACReceive(BYTE port, BYTE *pFrame, WORD wMax)
+{
+	HOST_MAC_PORT *p;
+	WORD wLength;
+
+	if(port >= HOST_MAC_PORTS || port == HOST_MAC_STACK_PORT)
+		return 0;
+
+	p = &_Ports[port];
+	if(!p->fAttached || p->cFrames == 0)
+		return 0;
+
+	wLength = p->rgFrames[p->iHead].wLength;
+	if(wLength > wMax)
+		wLength = wMax;
+	memcpy(pFrame, p->rgFrames[p->iHead].rgbFrame, wLength);
+
+	p->iHead = (p->iHead + 1) % HOST_MAC_QUEUE_FRAMES;
+	p->cFrames--;
+
+	return wLength;
+}
+
+/*****************************************************************************
+  Function:
+	DWORD HostMACDropped(BYTE port)
+
+  Summary:
+	Gets how many frames a port has lost because its queue was full
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	port - A switch port, HOST_MAC_STACK_PORT for the stack's own
+
+  Returns:
+  	The count since the port was attached.
+  ***************************************************************************/
+DWORD HostMACDropped(BYTE port)
+{
+	if(port >= HOST_MAC_PORTS)
+		return 0;
+
+	return _Ports[port].dwDropped;
+}
+
+/*****************************************************************************
+  Function:
+	void HostMACSetLoss(BYTE port, DWORD dwEvery)
+
+  Summary:
+	Makes the link to a port lose frames
+
+  Description:
+	Every dwEvery-th frame the switch delivers to the port is lost, 
+	counting from this call.  1 loses them all, 0 none.
+
+  Precondition:
+	None
+
+  Parameters:
+	port - A switch port, HOST_MAC_STACK_PORT for the stack's own
+	dwEvery - How often a frame is lost
+
+  Returns:
+  	None
+  ***************************************************************************/
+void HostMACSetLoss(BYTE port, DWORD dwEvery)
+{
+	if(port >= HOST_MAC_PORTS)
+		return;
+
+	_Ports[port].dwLossEvery = dwEvery;
+	_Ports[port].dwLossCount = 0;
+}
+
+/*****************************************************************************
+  Function:
+	DWORD HostMACLost(BYTE port)
+
+  Summary:
+	Gets how many frames HostMACSetLoss() has made a port lose
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	port - A switch port, HOST_MAC_STACK_PORT for the stack's own
+
+  Returns:
+  	The count since the port was attached.
+  ***************************************************************************/
+DWORD HostMACLost(BYTE port)
+{
+	if(port >= HOST_MAC_PORTS)
+		return 0;
+
+	return _Ports[port].dwLost;
+}
+
+#if defined(HOST_ENCX24J600)
+/*****************************************************************************
+  Function:
+	void HostMACGetDmaStats(HOST_MAC_DMA_STATS *pStats, BOOL bReset)
+
+  Summary:
+	Gets the DMA engine model's counters
+
+  Description:
+	cFrames * 1e9 / qwElapsedNs is the frames, mostly TCP segments in a 
+	TX test, sent per second; qwWaitNs against qwBusyNs is how much of 
+	the engine's time the stack spent waiting instead of working.
+
+  Precondition:
+	MACInit() has been called
+
+  Parameters:
+	pStats - receives the counters
+	bReset - TRUE to start counting again
+
+  Returns:
+  	None
+  ***************************************************************************/
+void HostMACGetDmaStats(HOST_MAC_DMA_STATS *pStats, BOOL bReset)
+{
+	QWORD qwNowNs = NowNs();
+
+	*pStats = _DmaStats;
+	pStats->qwElapsedNs = qwNowNs - _qwDmaStatsStartNs;
+
+	if(bReset)
+	{
+		memset(&_DmaStats, 0, sizeof(_DmaStats));
+		_qwDmaStatsStartNs = qwNowNs;
+	}
+}
+#endif
+
+#endif //#if defined(HOST_MAC) && !defined(HOST_ENC28J60)
@@ -0,0 +1,464 @@
+/************************************************************************/
+/*																		*/
+/*	HostPcap.c	--  pcap replay and recording for host builds           */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Drives StackTask() from a pcap file through a port on the host      */
+/*	MAC's virtual switch.  See HostPcap.h.                              */
+/*																		*/
+/************************************************************************/
+
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+
+#include "TCPIP Stack/TCPIP.h"
+
+#if defined(HOST_MAC)
+
+#include "TCPIP Stack/HostPcap.h"
+
+#define PCAP_MAGIC_US			(0xA1B2C3D4ul)	// microsecond timestamps
+#define PCAP_MAGIC_NS			(0xA1B23C4Dul)	// nanosecond timestamps
+#define PCAP_LINKTYPE_ETHERNET	(1ul)
+
+// How long to sleep between StackTask() calls while waiting for the next frame
+#define HOST_PCAP_IDLE_NS		(100000ul)
+
+#if defined(STACK_USE_PCAP_CAPTURE)
+static FILE *	_pfRecord = NULL;
+#endif
+
+static QWORD NowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (QWORD)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// The switch hands the stack's replies to the replay port, throw them away
+static void DrainPort(BYTE port)
+{
+	BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+
+	while(HostMACReceive(port, rgbFrame, sizeof(rgbFrame)));
+}
+
+/*****************************************************************************
+  Function:
+	static void RunStack(BYTE port, HOST_PCAP_STATS *pStats)
+
+  Summary:
+	Calls StackTask() until it has taken every queued frame
+
+  Description:
+	Each call is timed; how long the longest took is how long the
+	application would have waited for the stack.
+
+  Precondition:
+	None
+
+  Parameters:
+	port - the replay port, its replies are thrown away
+	pStats - gets the call times
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void RunStack(BYTE port, HOST_PCAP_STATS *pStats)
+{
+	QWORD qwStartNs;
+	QWORD qwElapsedNs;
+
+	do
+	{
+		qwStartNs = NowNs();
+		StackTask();
+		qwElapsedNs = NowNs() - qwStartNs;
+
+		DrainPort(port);
+
+		pStats->cCalls++;
+		pStats->qwTotalCallNs += qwElapsedNs;
+		if(qwElapsedNs > pStats->qwMaxCallNs)
+			pStats->qwMaxCallNs = qwElapsedNs;
+	} while(MACGetFreeRxSize() < HOST_MAC_QUEUE_FRAMES * HOST_MAC_FRAME_SIZE);
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL ReplayFile(FILE *pFile, BYTE port, BOOL fOriginalTiming, WORD wBurst, HOST_PCAP_STATS *pStats)
+
+  Summary:
+	Replays the records of an open pcap file
+
+  Description:
+	Each frame is sent on port and StackTask() is timed until it has
+	taken it, normally one call; the handler times are the stack's own.
+	With fOriginalTiming StackTask() keeps running between frames, as
+	it would on the board, until the frame is due; those calls are not
+	timed.  With wBurst above 1, that many frames are queued before the
+	stack runs.
+
+  Precondition:
+	pStats is zeroed
+
+  Parameters:
+	pFile - the file, at its start
+	port - switch port to send the frames on
+	fOriginalTiming - TRUE to keep the capture's spacing, FALSE to go
+		as fast as the stack takes them
+	wBurst - frames to queue before each run of the stack
+	pStats - gets the timings
+
+  Returns:
+  	FALSE if the file is not an Ethernet pcap file, otherwise TRUE.
+  	A truncated last record ends the replay.
+  ***************************************************************************/
+static BOOL ReplayFile(FILE *pFile, BYTE port, BOOL fOriginalTiming, WORD wBurst, HOST_PCAP_STATS *pStats)
+{
+	WORD wQueued = 0;
+	static BYTE rgbFrame[HOST_MAC_FRAME_SIZE];
+	DWORD rgdwFileHeader[6];
+	DWORD rgdwRecord[4];		// seconds, fraction, captured length, original length
+	DWORD dwMagic;
+	BOOL fSwapped;
+	BOOL fFirst = TRUE;
+	QWORD qwCaptureStartNs = 0;
+	QWORD qwReplayStartNs = 0;
+	BYTE i;
+
+	if(fread(rgdwFileHeader, sizeof(rgdwFileHeader), 1, pFile) != 1)
+		return FALSE;
+
+	fSwapped = (rgdwFileHeader[0] == swapl(PCAP_MAGIC_US) || rgdwFileHeader[0] == swapl(PCAP_MAGIC_NS));
+	dwMagic = fSwapped ? swapl(rgdwFileHeader[0]) : rgdwFileHeader[0];
+
+	if(dwMagic != PCAP_MAGIC_US && dwMagic != PCAP_MAGIC_NS)
+		return FALSE;
+
+	if((fSwapped ? swapl(rgdwFileHeader[5]) : rgdwFileHeader[5]) != PCAP_LINKTYPE_ETHERNET)
+		return FALSE;
+
+	while(fread(rgdwRecord, sizeof(rgdwRecord), 1, pFile) == 1)
+	{
+		QWORD qwStampNs;
+
+		if(fSwapped)
+		{
+			for(i = 0; i < sizeof(rgdwRecord)/sizeof(rgdwRecord[0]); i++)
+				rgdwRecord[i] = swapl(rgdwRecord[i]);
+		}
+
+		if(rgdwRecord[2] > sizeof(rgbFrame))
+		{
+			if(fseek(pFile, rgdwRecord[2], SEEK_CUR) != 0)
+				break;
+
+			pStats->cSkipped++;
+			continue;
+		}
+
+		if(fread(rgbFrame, 1, rgdwRecord[2], pFile) != rgdwRecord[2])
+			break;
+
+		// our own transmissions were the stack's answers at capture time
+		if(rgdwRecord[2] < sizeof(ETHER_HEADER) ||
+		   memcmp(rgbFrame + offsetof(ETHER_HEADER, SourceMACAddr), &AppConfig.MyMACAddr, sizeof(MAC_ADDR)) == 0)
+		{
+			pStats->cSkipped++;
+			continue;
+		}
+
+		if(fOriginalTiming)
+		{
+			qwStampNs = (QWORD)rgdwRecord[0] * 1000000000ull +
+						((dwMagic == PCAP_MAGIC_NS) ? rgdwRecord[1] : rgdwRecord[1] * 1000ull);
+
+			if(fFirst)
+			{
+				qwCaptureStartNs = qwStampNs;
+				qwReplayStartNs = NowNs();
+				fFirst = FALSE;
+			}
+
+			while(qwStampNs > qwCaptureStartNs &&
+				  NowNs() - qwReplayStartNs < qwStampNs - qwCaptureStartNs)
+			{
+				struct timespec ts = {0, HOST_PCAP_IDLE_NS};
+
+				StackTask();
+				DrainPort(port);
+				nanosleep(&ts, NULL);
+			}
+		}
+
+		HostMACSend(port, rgbFrame, (WORD)rgdwRecord[2]);
+		pStats->cFrames++;
+
+		if(++wQueued < wBurst)
+			continue;
+
+		RunStack(port, pStats);
+		wQueued = 0;
+	}
+
+	if(wQueued != 0u)
+		RunStack(port, pStats);
+
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL Replay(const char *szFile, BOOL fOriginalTiming, WORD wBurst, HOST_PCAP_STATS *pStats)
+
+  Summary:
+	Replays a pcap file on a port of its own
+
+  Description:
+	See ReplayFile().  The stack's RX counters, and its handler times
+	with STACK_USE_HANDLER_TIMING, are reset first and copied into
+	pStats at the end.
+
+  Precondition:
+	StackInit() has been called
+
+  Parameters:
+	szFile - the pcap file
+	fOriginalTiming - TRUE to keep the capture's spacing
+	wBurst - frames to queue before each run of the stack
+	pStats - gets the results
+
+  Returns:
+  	TRUE if the file was replayed
+  ***************************************************************************/
+static BOOL Replay(const char *szFile, BOOL fOriginalTiming, WORD wBurst, HOST_PCAP_STATS *pStats)
+{
+	FILE *pFile;
+	BYTE port;
+	BOOL fRet;
+
+	memset(pStats, 0, sizeof(*pStats));
+
+	if((pFile = fopen(szFile, "rb")) == NULL)
+		return FALSE;
+
+	if((port = HostMACAttach()) == HOST_MAC_INVALID_PORT)
+	{
+		fclose(pFile);
+		return FALSE;
+	}
+
+	StackGetRxStats(&pStats->RxStats, TRUE);
+	#if defined(STACK_USE_HANDLER_TIMING)
+	StackGetHandlerStats(pStats->rgHandler, TRUE);
+	#endif
+	fRet = ReplayFile(pFile, port, fOriginalTiming, wBurst, pStats);
+	StackGetRxStats(&pStats->RxStats, FALSE);
+	#if defined(STACK_USE_HANDLER_TIMING)
+	StackGetHandlerStats(pStats->rgHandler, FALSE);
+	#endif
+
+	HostMACDetach(port);
+	fclose(pFile);
+
+	return fRet;
+}
+
+/*****************************************************************************
+  Function:
+	BOOL HostPcapReplay(const char *szFile, BOOL fOriginalTiming, HOST_PCAP_STATS *pStats)
+
+  Summary:
+	Feeds a pcap file to the stack and times it
+
+  Description:
+	The frames come in on a port of their own, so the stack sees them
+	the way it would from the wire.
+
+  Precondition:
+	StackInit() has been called
+
+  Parameters:
+	szFile - the pcap file, either byte order, micro or nanosecond stamps
+	fOriginalTiming - TRUE to keep the capture's spacing, FALSE to go
+		as fast as the stack takes them
+	pStats - gets the frame counts, StackTask() times and, with
+		STACK_USE_HANDLER_TIMING, the handler times
+
+  Returns:
+  	TRUE if the file was replayed, FALSE if it could not be opened or
+  	read, or the switch had no free port.
+  ***************************************************************************/
+BOOL HostPcapReplay(const char *szFile, BOOL fOriginalTiming, HOST_PCAP_STATS *pStats)
+{
+	return Replay(szFile, fOriginalTiming, 1, pStats);
+}
+
+/*****************************************************************************
+  Function:
+	BOOL HostPcapReplayBurst(const char *szFile, WORD wBurst, HOST_PCAP_STATS *pStats)
+
+  Summary:
+	Feeds a pcap file to the stack in bursts, as a storm would arrive
+
+  Description:
+	wBurst frames at a time are queued on the stack's switch port, then
+	StackTask() is called until it has taken them all.  The longest
+	call shows how long a storm keeps the application waiting and the
+	RX counters show how the budgets split it up.  More than
+	HOST_MAC_QUEUE_FRAMES at once overflows the port, the way the MAC's
+	buffers would.
+
+  Precondition:
+	StackInit() has been called
+
+  Parameters:
+	szFile - the pcap file, e.g. a capture of broadcast traffic
+	wBurst - frames per burst
+	pStats - gets the frame counts, call times and RX counters
+
+  Returns:
+  	TRUE if the file was replayed, FALSE if it could not be opened or
+  	read, or the switch had no free port.
+  ***************************************************************************/
+BOOL HostPcapReplayBurst(const char *szFile, WORD wBurst, HOST_PCAP_STATS *pStats)
+{
+	return Replay(szFile, FALSE, wBurst ? wBurst : 1, pStats);
+}
+
+/*****************************************************************************
+  Function:
+	void HostPcapPrintStats(const HOST_PCAP_STATS *pStats, FILE *pFile)
+
+  Summary:
+	Prints a replay's timings, one line per handler
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	pStats - from HostPcapReplay() or HostPcapReplayBurst()
+	pFile - where to print, e.g. stdout
+
+  Returns:
+  	None
+  ***************************************************************************/
+void HostPcapPrintStats(const HOST_PCAP_STATS *pStats, FILE *pFile)
+{
+	#if defined(STACK_USE_HANDLER_TIMING)
+	static const char * const rgszHandler[STACK_HANDLERS] = {"ARP", "ICMP", "TCP", "UDP", "other"};
+	BYTE i;
+	#endif
+
+	fprintf(pFile, "%-8s %10s %12s %12s\n", "handler", "frames", "avg ns", "max ns");
+
+	#if defined(STACK_USE_HANDLER_TIMING)
+	for(i = 0; i < STACK_HANDLERS; i++)
+	{
+		const STACK_HANDLER_STATS *pHandler = &pStats->rgHandler[i];
+
+		fprintf(pFile, "%-8s %10lu %12llu %12lu\n", rgszHandler[i],
+				(unsigned long)pHandler->cFrames,
+				(unsigned long long)(pHandler->cFrames ? pHandler->qwTotalNs / pHandler->cFrames : 0),
+				(unsigned long)pHandler->dwMaxNs);
+	}
+	#endif
+
+	fprintf(pFile, "%-8s %10lu\n", "sent", (unsigned long)pStats->cFrames);
+	fprintf(pFile, "%-8s %10lu\n", "skipped", (unsigned long)pStats->cSkipped);
+	fprintf(pFile, "%-8s %10lu %12llu %12llu\n", "calls",
+			(unsigned long)pStats->cCalls,
+			(unsigned long long)(pStats->cCalls ? pStats->qwTotalCallNs / pStats->cCalls : 0),
+			(unsigned long long)pStats->qwMaxCallNs);
+	fprintf(pFile, "rx: max burst %u, frame budget hits %lu, time budget hits %lu, idle calls %lu, least free %u bytes\n",
+			pStats->RxStats.wMaxBurst,
+			(unsigned long)pStats->RxStats.dwFrameBudgetHits,
+			(unsigned long)pStats->RxStats.dwTimeBudgetHits,
+			(unsigned long)pStats->RxStats.dwIdleCalls,
+			pStats->RxStats.wMinFreeRx);
+}
+
+#if defined(STACK_USE_PCAP_CAPTURE)
+/*****************************************************************************
+  Function:
+	BOOL HostPcapRecordStart(const char *szFile)
+
+  Summary:
+	Starts writing the capture ring to a pcap file
+
+  Description:
+	Call HostPcapRecordFlush() often enough, e.g. after each
+	StackTask(), that the ring does not fill.
+
+  Precondition:
+	None
+
+  Parameters:
+	szFile - file to create
+
+  Returns:
+  	TRUE if the file was created
+  ***************************************************************************/
+BOOL HostPcapRecordStart(const char *szFile)
+{
+	BYTE rgbHeader[PCAP_FILE_HEADER_SIZE];
+
+	HostPcapRecordStop();
+
+	if((_pfRecord = fopen(szFile, "wb")) == NULL)
+		return FALSE;
+
+	fwrite(rgbHeader, 1, PcapCaptureFileHeader(rgbHeader), _pfRecord);
+	return TRUE;
+}
+
+void HostPcapRecordFlush(void)
+{
+	BYTE rgb[512];
+	WORD cb;
+
+	if(_pfRecord == NULL)
+		return;
+
+	while((cb = PcapCaptureRead(rgb, sizeof(rgb))) > 0)
+		fwrite(rgb, 1, cb, _pfRecord);
+}
+
+void HostPcapRecordStop(void)
+{
+	if(_pfRecord == NULL)
+		return;
+
+	HostPcapRecordFlush();
+	fclose(_pfRecord);
+	_pfRecord = NULL;
+}
+#endif //#if defined(STACK_USE_PCAP_CAPTURE)
+
+#endif //#if defined(HOST_MAC)
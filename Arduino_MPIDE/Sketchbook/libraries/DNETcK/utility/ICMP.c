@@ -150,13 +150,7 @@ void ICMPProcess(NODE_INFO *remote, WORD len)
 	
 		// Calculate new Type, Code, and Checksum values
 		dwVal.v[0] = 0x00;	// Type: 0 (ICMP echo/ping reply)
-		dwVal.v[2] += 8;	// Subtract 0x0800 from the checksum
-		if(dwVal.v[2] < 8u)
-		{
-			dwVal.v[3]++;
-			if(dwVal.v[3] == 0u)
-				dwVal.v[2]++;
-		}
+		dwVal.w[1] = UpdateIPChecksum(dwVal.w[1], 0x0008u, dwVal.w[0]);
 	
 	    // Wait for TX hardware to become available (finish transmitting 
 	    // any previous packet)
@@ -280,6 +280,83 @@ WORD IPPutHeader(NODE_INFO *remote,
 
 }
 
+/*********************************************************************
+ * Function: void IPInitHeaderTemplate(IP_HEADER *header,
+ *                                     NODE_INFO *remote,
+ *                                     BYTE protocol)
+ *
+ * PreCondition:    None
+ *
+ * Input:           *header     - Template to fill in
+ *                  *remote     - Destination node address
+ *                  protocol    - Packet protocol
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Note:            The template is in network order with a zero
+ *                  TotalLength and Identification, and its checksum
+ *                  covers just the fixed fields.  IPPutHeaderTemplate()
+ *                  patches the other two in without summing it again.
+ ********************************************************************/
+void IPInitHeaderTemplate(IP_HEADER *header,
+                          NODE_INFO *remote,
+                          BYTE protocol)
+{
+    header->VersionIHL       = IP_VERSION | IP_IHL;
+    header->TypeOfService    = IP_SERVICE;
+    header->TotalLength      = 0;
+    header->Identification   = 0;
+    header->FragmentInfo     = 0;
+    header->TimeToLive       = MY_IP_TTL;
+    header->Protocol         = protocol;
+    header->HeaderChecksum   = 0;
+	header->SourceAddress 	 = AppConfig.MyIPAddr;
+    header->DestAddress.Val  = remote->IPAddr.Val;
+
+    header->HeaderChecksum   = CalcIPChecksum((BYTE*)header, sizeof(*header));
+}
+
+/*********************************************************************
+ * Function: void IPPutHeaderTemplate(IP_HEADER *header,
+ *                                    NODE_INFO *remote,
+ *                                    WORD len)
+ *
+ * PreCondition:    IPIsTxReady() == TRUE
+ *                  IPInitHeaderTemplate() filled in *header
+ *
+ * Input:           *header     - Template from IPInitHeaderTemplate()
+ *                  *remote     - Destination node address
+ *                  len         - Current packet data length
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Note:            Does what IPPutHeader() does, but only the length
+ *                  and identifier are new so the checksum is updated
+ *                  rather than recomputed.
+ ********************************************************************/
+void IPPutHeaderTemplate(IP_HEADER *header,
+                         NODE_INFO *remote,
+                         WORD len)
+{
+    IP_HEADER   h;
+
+    IPHeaderLen = sizeof(IP_HEADER);
+
+    h = *header;
+    h.TotalLength       = swaps(sizeof(h) + len);
+    _Identifier++;
+    h.Identification    = swaps(_Identifier);
+    h.HeaderChecksum    = UpdateIPChecksum(h.HeaderChecksum, 0x0000, h.TotalLength);
+    h.HeaderChecksum    = UpdateIPChecksum(h.HeaderChecksum, 0x0000, h.Identification);
+
+    MACPutHeader(&remote->MACAddr, MAC_IP, (sizeof(h)+len));
+    MACPutArray((BYTE*)&h, sizeof(h));
+}
+
 /*********************************************************************
  * Function:        IPSetRxBuffer(WORD Offset)
  *
@@ -40,7 +40,16 @@
 #define _DNETcK_SMSC_8720
 
 // board specific stuff
-#if defined (_BOARD_CEREBOT_MX7CK_)
+#if defined (HOST_MAC)
+
+    // HostMAC.c stands in for the PHY and the MAC, nothing to power up;
+    // with HOST_ENC28J60, ENC28J60.c drives a simulated chip instead
+    #if defined (HOST_ENC28J60)
+        #include <Host-ENC28J60.x>
+    #endif
+    #define DNETcKInitNetworkHardware() {}
+
+#elif defined (_BOARD_CEREBOT_MX7CK_)
 
     #include <MX7cK-SMSC-8720.x>
     #define DNETcKInitNetworkHardware() {TRISAbits.TRISA6 = 0;LATAbits.LATA6 = 1;}
@@ -0,0 +1,242 @@
+/************************************************************************/
+/*																		*/
+/*	PcapCapture.c	--  Records MAC frames into a pcap ring             */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Single producer, single consumer ring of pcap records.  See         */
+/*	PcapCapture.h.                                                      */
+/*																		*/
+/************************************************************************/
+
+#include <string.h>
+
+#include "TCPIP Stack/TCPIP.h"
+
+#if defined(STACK_USE_PCAP_CAPTURE)
+
+#define PCAP_MAGIC				(0xA1B2C3D4ul)	// microsecond timestamps, written in our byte order
+#define PCAP_LINKTYPE_ETHERNET	(1ul)
+
+// Keeps the compiler from moving ring writes past the index update;
+// the PIC32 and the host both execute stores in order
+#define PCAP_BARRIER()			__asm__ __volatile__("" ::: "memory")
+
+typedef struct
+{
+	DWORD	dwSeconds;
+	DWORD	dwMicroseconds;
+	DWORD	cbCaptured;
+	DWORD	cbOriginal;
+} PCAP_RECORD_HEADER;
+
+static BYTE				_rgbRing[PCAP_CAPTURE_RING_SIZE];
+static volatile DWORD	_dwHead = 0;		// free running, only moved by PcapCaptureFrame()
+static volatile DWORD	_dwTail = 0;		// free running, only moved by PcapCaptureRead()
+static DWORD			_dwDropped = 0;
+
+/*****************************************************************************
+  Function:
+	static void RingPut(DWORD dwIndex, const BYTE *pData, WORD cb)
+
+  Summary:
+	Copies into the ring, wrapping at the end
+
+  Description:
+	None
+
+  Precondition:
+	There is room for cb bytes at dwIndex
+
+  Parameters:
+	dwIndex - free running ring index to start at
+	pData - bytes to copy
+	cb - number of bytes
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void RingPut(DWORD dwIndex, const BYTE *pData, WORD cb)
+{
+	WORD iStart = (WORD)(dwIndex & (PCAP_CAPTURE_RING_SIZE - 1));
+	WORD cbFirst = PCAP_CAPTURE_RING_SIZE - iStart;
+
+	if(cbFirst > cb)
+		cbFirst = cb;
+
+	memcpy(&_rgbRing[iStart], pData, cbFirst);
+	memcpy(_rgbRing, pData + cbFirst, cb - cbFirst);
+}
+
+/*****************************************************************************
+  Function:
+	void PcapCaptureFrame(const BYTE *pFrame, WORD wLength)
+
+  Summary:
+	Adds a frame to the capture ring
+
+  Description:
+	The first PCAP_CAPTURE_SNAPLEN bytes are kept.  The timestamp is
+	TickGet() since the stack started, so it wraps with the tick.
+
+  Precondition:
+	Only called by the stack, never from more than one context
+
+  Parameters:
+	pFrame - the frame, starting with the destination MAC
+	wLength - length of the whole frame
+
+  Returns:
+  	None
+
+  Remarks:
+	If the reader is behind and the record does not fit, the frame
+	is counted in PcapCaptureDropped() instead.
+  ***************************************************************************/
+void PcapCaptureFrame(const BYTE *pFrame, WORD wLength)
+{
+	PCAP_RECORD_HEADER hdr;
+	DWORD dwHead = _dwHead;
+	DWORD dwTick;
+	WORD cbSnap = (wLength < PCAP_CAPTURE_SNAPLEN) ? wLength : PCAP_CAPTURE_SNAPLEN;
+
+	if(PCAP_CAPTURE_RING_SIZE - (dwHead - _dwTail) < sizeof(hdr) + cbSnap)
+	{
+		_dwDropped++;
+		return;
+	}
+
+	dwTick = TickGet();
+	hdr.dwSeconds = dwTick / TICKS_PER_SECOND;
+	hdr.dwMicroseconds = (DWORD)((QWORD)(dwTick % TICKS_PER_SECOND) * 1000000ull / TICKS_PER_SECOND);
+	hdr.cbCaptured = cbSnap;
+	hdr.cbOriginal = wLength;
+
+	RingPut(dwHead, (BYTE*)&hdr, sizeof(hdr));
+	RingPut(dwHead + sizeof(hdr), pFrame, cbSnap);
+
+	// the record must be complete before the reader can see it
+	PCAP_BARRIER();
+	_dwHead = dwHead + sizeof(hdr) + cbSnap;
+}
+
+/*****************************************************************************
+  Function:
+	WORD PcapCaptureFileHeader(BYTE *pHeader)
+
+  Summary:
+	Gets the pcap global header that starts a file
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	pHeader - PCAP_FILE_HEADER_SIZE bytes to fill in
+
+  Returns:
+  	PCAP_FILE_HEADER_SIZE
+  ***************************************************************************/
+WORD PcapCaptureFileHeader(BYTE *pHeader)
+{
+	DWORD rgdw[] = {PCAP_MAGIC, 0x00040002ul, 0ul, 0ul, PCAP_CAPTURE_SNAPLEN, PCAP_LINKTYPE_ETHERNET};
+
+	// version 2.4 is two WORDs, major first, packed in the second DWORD
+	memcpy(pHeader, rgdw, PCAP_FILE_HEADER_SIZE);
+	return PCAP_FILE_HEADER_SIZE;
+}
+
+/*****************************************************************************
+  Function:
+	WORD PcapCaptureRead(BYTE *pBuff, WORD wMax)
+
+  Summary:
+	Takes captured bytes out of the ring
+
+  Description:
+	Records are only published whole, so the bytes read so far always
+	end on a record boundary or inside the next complete record;
+	appending them to a file after the header gives a valid capture.
+
+  Precondition:
+	Only called from one context, which may be an interrupt
+
+  Parameters:
+	pBuff - where to copy the bytes
+	wMax - size of pBuff
+
+  Returns:
+  	The number of bytes copied, 0 if the ring is empty.
+  ***************************************************************************/
+WORD PcapCaptureRead(BYTE *pBuff, WORD wMax)
+{
+	DWORD dwTail = _dwTail;
+	DWORD cbAvail = _dwHead - dwTail;
+	WORD iStart, cbFirst;
+
+	PCAP_BARRIER();
+
+	if(cbAvail < wMax)
+		wMax = (WORD)cbAvail;
+
+	iStart = (WORD)(dwTail & (PCAP_CAPTURE_RING_SIZE - 1));
+	cbFirst = PCAP_CAPTURE_RING_SIZE - iStart;
+	if(cbFirst > wMax)
+		cbFirst = wMax;
+
+	memcpy(pBuff, &_rgbRing[iStart], cbFirst);
+	memcpy(pBuff + cbFirst, _rgbRing, wMax - cbFirst);
+
+	// done with the bytes before handing the space back
+	PCAP_BARRIER();
+	_dwTail = dwTail + wMax;
+
+	return wMax;
+}
+
+/*****************************************************************************
+  Function:
+	DWORD PcapCaptureDropped(void)
+
+  Summary:
+	Gets the number of frames left out because the ring was full
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	None
+
+  Returns:
+  	The count since the stack started
+  ***************************************************************************/
+DWORD PcapCaptureDropped(void)
+{
+	return _dwDropped;
+}
+
+#endif //#if defined(STACK_USE_PCAP_CAPTURE)
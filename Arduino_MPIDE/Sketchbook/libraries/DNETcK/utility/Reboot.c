@@ -157,7 +157,9 @@ void RebootTask(void)
 		strcpypgm2ram((char*)LCDText, "Bootloader Reset");
 		LCDUpdate();
 	#endif
+	#if !defined(COMPILER_HOST_GCC)		// Reset() just ends a host build
 	RCONbits.POR = 0;
+	#endif
 	#if defined(__18CXX)
 	{
 		WORD_VAL wvPROD;
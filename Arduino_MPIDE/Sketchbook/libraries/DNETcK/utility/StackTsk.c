@@ -92,6 +92,54 @@ static SM_STACK smStack;
 
 NODE_INFO remoteNode;
 
+static STACK_RX_STATS _RxStats;
+
+#if defined(STACK_USE_HANDLER_TIMING)
+typedef struct
+{
+	DWORD	cFrames;
+	QWORD	qwTotal;				// in HandlerClock() counts
+	DWORD	dwMax;
+} HANDLER_TIME;
+
+static HANDLER_TIME _rgHandlerTime[STACK_HANDLERS];
+
+#if defined(HOST_MAC)
+	#include <time.h>
+
+	#define HANDLER_CLOCK_HZ	(1000000000ull)
+
+	// Wraps every 4 seconds, which only the differences need to survive
+	static DWORD HandlerClock(void)
+	{
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (DWORD)ts.tv_sec * 1000000000ul + (DWORD)ts.tv_nsec;
+	}
+#else
+	// The core timer counts at half the system clock
+	#define HANDLER_CLOCK_HZ	((QWORD)GetSystemClock()/2ull)
+	#define HandlerClock()		ReadCoreTimer()
+#endif
+
+static void HandlerDone(BYTE bHandler, DWORD dwStart)
+{
+	HANDLER_TIME *p = &_rgHandlerTime[bHandler];
+	DWORD dwTime = HandlerClock() - dwStart;
+
+	p->cFrames++;
+	p->qwTotal += dwTime;
+	if(dwTime > p->dwMax)
+		p->dwMax = dwTime;
+}
+#endif
+
+#if defined(STACK_USE_RX_INTERRUPT)
+static volatile BOOL _bRxSignaled;		// set by StackRxSignal(), cleared when StackTask() goes to the MAC
+static DWORD _dwLastRxPoll;
+#endif
+
 
 
 /*********************************************************************
@@ -113,6 +161,12 @@ void StackInit(void)
 {
     smStack                     = SM_STACK_IDLE;
 
+	memset(&_RxStats, 0, sizeof(_RxStats));
+	_RxStats.wMinFreeRx = 0xFFFF;
+	#if defined(STACK_USE_RX_INTERRUPT)
+	_bRxSignaled = TRUE;
+	#endif
+
 #if defined(STACK_USE_IP_GLEANING) || defined(STACK_USE_DHCP_CLIENT)
     /*
      * If DHCP or IP Gleaning is enabled,
@@ -205,6 +259,11 @@ void StackInit(void)
  *                  This function must be called periodically to
  *                  ensure timely responses.
  *
+ *                  If the board sets STACK_RX_FRAME_BUDGET or
+ *                  STACK_RX_TIME_BUDGET, at most that many frames,
+ *                  or ticks of them, are handled per call; the rest
+ *                  are left in the MAC for the next call.
+ *
  ********************************************************************/
 void StackTask(void)
 {
@@ -212,6 +271,12 @@ void StackTask(void)
     IP_ADDR tempLocalIP;
 	BYTE cFrameType;
 	BYTE cIPFrameType;
+	WORD wFrames = 0;
+	DWORD dwRxStart;
+	#if defined(STACK_USE_HANDLER_TIMING)
+	BYTE bHandler;
+	DWORD dwHandlerStart;
+	#endif
 
    
     #if defined( WF_CS_TRIS )
@@ -271,9 +336,43 @@ void StackTask(void)
 	UDPTask();
 	#endif
 
-	// Process as many incomming packets as we can
+	_RxStats.dwCalls++;
+
+	#if defined(STACK_USE_RX_INTERRUPT)
+	// Nothing has come in since the MAC was last emptied
+	if(!_bRxSignaled && TickGet() - _dwLastRxPoll < STACK_RX_POLL_INTERVAL)
+	{
+		_RxStats.dwIdleCalls++;
+		return;
+	}
+	_bRxSignaled = FALSE;
+	_dwLastRxPoll = TickGet();
+	#endif
+
+	dwRxStart = TickGet();
+
+	// Process as many incomming packets as the budget allows
 	while(1)
 	{
+		// Leave the rest for the next call, after the timers and the
+		// application have had a turn
+		if(STACK_RX_FRAME_BUDGET != 0u && wFrames >= STACK_RX_FRAME_BUDGET)
+		{
+			_RxStats.dwFrameBudgetHits++;
+			#if defined(STACK_USE_RX_INTERRUPT)
+			StackRxSignal();
+			#endif
+			break;
+		}
+		if(STACK_RX_TIME_BUDGET != 0u && wFrames != 0u && TickGet() - dwRxStart >= STACK_RX_TIME_BUDGET)
+		{
+			_RxStats.dwTimeBudgetHits++;
+			#if defined(STACK_USE_RX_INTERRUPT)
+			StackRxSignal();
+			#endif
+			break;
+		}
+
 		//if using the random module, generate entropy
 		#if defined(STACK_USE_RANDOM)
 			RandomAdd(remoteNode.MACAddr.v[5]);
@@ -291,6 +390,18 @@ void StackTask(void)
 		if(!MACGetHeader(&remoteNode.MACAddr, &cFrameType))
 			break;
 
+		// The queue is deepest as the burst starts
+		if(wFrames == 0u)
+		{
+			WORD wFree = MACGetFreeRxSize();
+
+			if(wFree < _RxStats.wMinFreeRx)
+				_RxStats.wMinFreeRx = wFree;
+		}
+		_RxStats.dwFrames++;
+		if(++wFrames > _RxStats.wMaxBurst)
+			_RxStats.wMaxBurst = wFrames;
+
 		// When using a WiFi module, filter out all incoming packets that have 
 		// the same source MAC address as our own MAC address.  This is to 
 		// prevent receiving and passing our own broadcast packets up to other 
@@ -301,10 +412,18 @@ void StackTask(void)
 				continue;
 		#endif
 
+		#if defined(STACK_USE_HANDLER_TIMING)
+		bHandler = STACK_HANDLER_OTHER;
+		dwHandlerStart = HandlerClock();
+		#endif
+
 		// Dispatch the packet to the appropriate handler
 		switch(cFrameType)
 		{
 			case MAC_ARP:
+				#if defined(STACK_USE_HANDLER_TIMING)
+				bHandler = STACK_HANDLER_ARP;
+				#endif
 				ARPProcess();
 				break;
 	
@@ -315,6 +434,10 @@ void StackTask(void)
 				#if defined(STACK_USE_ICMP_SERVER) || defined(STACK_USE_ICMP_CLIENT)
 				if(cIPFrameType == IP_PROT_ICMP)
 				{
+					#if defined(STACK_USE_HANDLER_TIMING)
+					bHandler = STACK_HANDLER_ICMP;
+					#endif
+
 					#if defined(STACK_USE_IP_GLEANING)
 					if(AppConfig.Flags.bInConfigMode && AppConfig.Flags.bIsDHCPEnabled)
 					{
@@ -349,6 +472,9 @@ void StackTask(void)
 				#if defined(STACK_USE_TCP)
 				if(cIPFrameType == IP_PROT_TCP)
 				{
+					#if defined(STACK_USE_HANDLER_TIMING)
+					bHandler = STACK_HANDLER_TCP;
+					#endif
 					TCPProcess(&remoteNode, &tempLocalIP, dataCount);
 					break;
 				}
@@ -357,17 +483,141 @@ void StackTask(void)
 				#if defined(STACK_USE_UDP)
 				if(cIPFrameType == IP_PROT_UDP)
 				{
+					#if defined(STACK_USE_HANDLER_TIMING)
+					bHandler = STACK_HANDLER_UDP;
+					#endif
+
 					// Stop processing packets if we came upon a UDP frame with application data in it
 					if(UDPProcess(&remoteNode, &tempLocalIP, dataCount))
+					{
+						#if defined(STACK_USE_HANDLER_TIMING)
+						HandlerDone(bHandler, dwHandlerStart);
+						#endif
+						#if defined(STACK_USE_RX_INTERRUPT)
+						StackRxSignal();
+						#endif
 						return;
+					}
 				}
 				#endif
 
 				break;
 		}
+
+		#if defined(STACK_USE_HANDLER_TIMING)
+		HandlerDone(bHandler, dwHandlerStart);
+		#endif
 	}
 }
 
+/*********************************************************************
+ * Function:        void StackGetRxStats(STACK_RX_STATS *pStats, BOOL bReset)
+ *
+ * PreCondition:    StackInit() is already called.
+ *
+ * Input:           pStats - receives the counts
+ *                  bReset - TRUE to start counting again
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Note:            Calls that hit a budget are the ones that left
+ *                  frames, or may have left frames, in the MAC.
+ *
+ ********************************************************************/
+void StackGetRxStats(STACK_RX_STATS *pStats, BOOL bReset)
+{
+	*pStats = _RxStats;
+
+	if(bReset)
+	{
+		memset(&_RxStats, 0, sizeof(_RxStats));
+		_RxStats.wMinFreeRx = 0xFFFF;
+	}
+}
+
+#if defined(STACK_USE_HANDLER_TIMING)
+/*********************************************************************
+ * Function:        void StackGetHandlerStats(STACK_HANDLER_STATS rgStats[STACK_HANDLERS], BOOL bReset)
+ *
+ * PreCondition:    None
+ *
+ * Input:           rgStats - receives the frame counts and times,
+ *                            indexed by STACK_HANDLER_ARP and the rest
+ *                  bReset - TRUE to start counting again
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Note:            The times are converted from the clock's counts
+ *                  here, not per frame, in two steps so hours of
+ *                  totals do not overflow.
+ *
+ ********************************************************************/
+void StackGetHandlerStats(STACK_HANDLER_STATS rgStats[STACK_HANDLERS], BOOL bReset)
+{
+	BYTE i;
+
+	for(i = 0; i < STACK_HANDLERS; i++)
+	{
+		rgStats[i].cFrames = _rgHandlerTime[i].cFrames;
+		rgStats[i].qwTotalNs = _rgHandlerTime[i].qwTotal / HANDLER_CLOCK_HZ * 1000000000ull +
+							   _rgHandlerTime[i].qwTotal % HANDLER_CLOCK_HZ * 1000000000ull / HANDLER_CLOCK_HZ;
+		rgStats[i].dwMaxNs = (DWORD)((QWORD)_rgHandlerTime[i].dwMax * 1000000000ull / HANDLER_CLOCK_HZ);
+	}
+
+	if(bReset)
+		memset(_rgHandlerTime, 0, sizeof(_rgHandlerTime));
+}
+#endif
+
+#if defined(STACK_USE_RX_INTERRUPT)
+/*********************************************************************
+ * Function:        void StackRxSignal(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    The next StackTask() asks the MAC for frames
+ *
+ * Note:            Safe to call from an interrupt; the PIC32 MAC
+ *                  calls it from its RX interrupt.
+ *
+ ********************************************************************/
+void StackRxSignal(void)
+{
+	_bRxSignaled = TRUE;
+}
+
+/*********************************************************************
+ * Function:        BOOL StackIsRxPending(void)
+ *
+ * PreCondition:    StackInit() is already called.
+ *
+ * Input:           None
+ *
+ * Output:          TRUE if the next StackTask() will ask the MAC
+ *                  for frames
+ *
+ * Side Effects:    None
+ *
+ * Note:            An application with nothing else to do can wait
+ *                  for this instead of calling StackTask() in a
+ *                  tight loop; TCP and UDP timers still need a call
+ *                  now and then.
+ *
+ ********************************************************************/
+BOOL StackIsRxPending(void)
+{
+	return _bRxSignaled || TickGet() - _dwLastRxPoll >= STACK_RX_POLL_INTERVAL;
+}
+#endif
+
 /*********************************************************************
  * Function:        void StackApplications(void)
  *
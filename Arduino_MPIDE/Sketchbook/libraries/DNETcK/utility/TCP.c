@@ -96,6 +96,20 @@
 	#undef TCP_OPTIMIZE_FOR_SIZE
 #endif
 
+// Normally only one TCB (MyTCB) is in PIC RAM and SyncTCB() copies it in 
+// and out of the socket's memory medium whenever the stack moves to a 
+// different socket.  If you define TCP_DIRECT_TCB, every TCB is kept in a 
+// PIC RAM array indexed by socket, MyTCB refers straight to the current 
+// socket's entry and SyncTCB() does nothing.  The sizeof(TCB) that would 
+// have been reserved ahead of each socket's FIFOs is no longer taken from 
+// the TCP_*_RAM_SIZE pools, but sizeof(TCB) of PIC RAM is spent on every 
+// socket, so a board turns it on in its TCPIPConfig.x.
+//
+// TCBs are not split further into hot and cold halves.  TCB_STUB already 
+// is the hot half: TCPTick() and FindMatchingSocket() only scan TCBStubs[], 
+// and the TCB is only touched for the one socket a segment or API call is 
+// for.
+
 // TCP Maximum Segment Size for TX.  The TX maximum segment size is actually 
 // govered by the remote node's MSS option advirtised during connection 
 // establishment.  However, if the remote node specifies an unhandlably large 
@@ -113,7 +127,9 @@
 #define TCP_MAX_SEG_SIZE_RX			(536u)
 
 // TCP Timeout and retransmit numbers
-#define TCP_START_TIMEOUT_VAL   	((DWORD)TICK_SECOND*1)	// Timeout to retransmit unacked data
+#define TCP_START_TIMEOUT_VAL   	((DWORD)TICK_SECOND*1)	// Timeout to retransmit unacked data, until the round trip time has been measured
+#define TCP_MIN_TIMEOUT_VAL			((DWORD)TICK_SECOND/5)	// Lower bound of the measured retransmission timeout
+#define TCP_MAX_TIMEOUT_VAL			((DWORD)TICK_SECOND*60)	// Upper bound of the measured retransmission timeout
 #define TCP_DELAYED_ACK_TIMEOUT		((DWORD)TICK_SECOND/10)	// Timeout for delayed-acknowledgement algorithm
 #define TCP_FIN_WAIT_2_TIMEOUT		((DWORD)TICK_SECOND*5)	// Timeout for FIN WAIT 2 state
 #define TCP_KEEP_ALIVE_TIMEOUT		((DWORD)TICK_SECOND*10)	// Timeout for keep-alive messages when no traffic is sent
@@ -123,11 +139,35 @@
 #define TCP_MAX_SYN_RETRIES			(2u)	// Smaller than all other retries to reduce SYN flood DoS duration
 
 #define TCP_AUTO_TRANSMIT_TIMEOUT_VAL	(TICK_SECOND/25ull)	// Timeout before automatically transmitting unflushed data
+#define TCP_CORK_TIMEOUT_VAL			(TICK_SECOND/5ull)	// Timeout before automatically transmitting a partial segment held back by TCPSetCork()
 #define TCP_WINDOW_UPDATE_TIMEOUT_VAL	(TICK_SECOND/5ull)	// Timeout before automatically transmitting a window update due to a TCPGet() or TCPGetArray() function call
 
-#define TCP_SYN_QUEUE_MAX_ENTRIES	(3u) 					// Number of TCP RX SYN packets to save if they cannot be serviced immediately
+#if !defined(TCP_SYN_QUEUE_MAX_ENTRIES)
+	#define TCP_SYN_QUEUE_MAX_ENTRIES	(3u) 					// Number of TCP RX SYN packets to save if they cannot be serviced immediately
+#endif
 #define TCP_SYN_QUEUE_TIMEOUT		((DWORD)TICK_SECOND*3)	// Timeout for when SYN queue entries are deleted if unserviceable
 
+// Number of buckets in the socket lookup index used by FindMatchingSocket.
+// Must be a power of 2.  Sockets are chained by their remoteHash, so
+// incoming segments only look at the sockets in one bucket instead of
+// syncing every TCB.
+#if !defined(TCP_SOCKET_HASH_BUCKETS)
+	#define TCP_SOCKET_HASH_BUCKETS	(16u)
+#endif
+
+// Longest TCPFindArrayEx() pattern whose skip table is kept between calls;
+// covers "\r\n--" plus the longest MIME boundary
+#if !defined(TCP_FIND_CACHE_LEN)
+	#define TCP_FIND_CACHE_LEN		(74u)
+#endif
+
+// TCPTick() only looks at sockets that were touched since the last call or
+// whose earliest timer has come due.  This often it looks at every socket
+// anyway, as a safety net for timers changed behind its back.
+#if !defined(TCP_FULL_SCAN_INTERVAL)
+	#define TCP_FULL_SCAN_INTERVAL	((DWORD)TICK_SECOND)
+#endif
+
 /****************************************************************************
   Section:
 	TCP Header Data Types
@@ -243,9 +283,38 @@ unsigned int MAX_TCP_SOCKETS = TCP_SOCKET_COUNT;
 	#endif
 #endif
 
-static TCB MyTCB;									// Currently loaded TCB
 static TCP_SOCKET hCurrentTCP = INVALID_SOCKET;		// Current TCP socket
-static TCP_SOCKET hLastTCB = INVALID_SOCKET;
+#if defined(TCP_DIRECT_TCB)
+	static TCB TCBs[TCP_SOCKET_COUNT];					// Every socket's TCB
+	#define MyTCB			TCBs[hCurrentTCP]			// Alias to current TCB
+	#define TCB_FIFO_SIZE	0u							// No TCB copy ahead of the FIFOs
+#else
+	static TCB MyTCB;									// Currently loaded TCB
+	static TCP_SOCKET hLastTCB = INVALID_SOCKET;
+	#define TCB_FIFO_SIZE	sizeof(TCB)					// TCB copy kept ahead of the FIFOs
+#endif
+
+// Socket lookup index.  Every socket whose remoteHash has been set is on
+// the chain of the bucket for that value: connected sockets by the hash of
+// remote IP, remote port and local port, listening sockets by local port.
+static TCP_SOCKET TCBHashHeads[TCP_SOCKET_HASH_BUCKETS];	// First socket in each bucket
+static TCP_SOCKET TCBHashNext[TCP_SOCKET_COUNT];			// Next socket in the same bucket
+#define TCP_HASH_BUCKET(w)	((BYTE)((w) ^ ((w) >> 8)) & (TCP_SOCKET_HASH_BUCKETS - 1))
+
+// Sockets TCPTick() has to look at, one bit per socket.  Anything that 
+// starts a timer, queues data or changes state sets the socket's bit; the
+// earliest deadline of all sleeping sockets is kept in dwNextTCPScan.
+static BYTE TCBWake[(TCP_SOCKET_COUNT + 7u) / 8u];
+static DWORD dwNextTCPScan;
+#define TCPWake(h)	(TCBWake[(h) >> 3] |= (BYTE)(1u << ((h) & 7u)))
+
+// Socket events (TCP_EVENT_*) waiting for TCPDispatchEvents(), and the 
+// handler each socket reports them to
+static BYTE TCBEvents[TCP_SOCKET_COUNT];
+static BOOL bTCPEventsPending;
+static TCP_EVENT_HANDLER TCBEventHandlers[TCP_SOCKET_COUNT];
+static void* TCBEventContexts[TCP_SOCKET_COUNT];
+#define TCPPostEvent(v)	(TCBEvents[hCurrentTCP] |= (v), bTCPEventsPending = TRUE)
 
 #if TCP_SYN_QUEUE_MAX_ENTRIES
 	#if defined(__18CXX) && !defined(HI_TECH_C)	
@@ -281,7 +350,13 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len);
 static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote);
 static void SwapTCPHeader(TCP_HEADER* header);
 static void CloseSocket(void);
+static void UpdateRTO(DWORD dwSample);
+static void TCPTickSocket(TCP_SOCKET hTCP);
+static void ScheduleSocket(TCP_SOCKET hTCP);
+#if !defined(TCP_DIRECT_TCB)
 static void SyncTCB(void);
+#endif
+static void SetRemoteHash(WORD wHash);
 
 // Indicates if this packet is a retransmission (no reset) or a new packet (reset required)
 #define SENDTCP_RESET_TIMERS	0x01
@@ -328,6 +403,10 @@ static void SyncTCB(void);
 
 
 
+#if defined(TCP_DIRECT_TCB)
+	// MyTCB already follows hCurrentTCP, there is nothing to load.
+	#define SyncTCB()
+#else
 // Flushes MyTCB cache and loads up the specified TCB.
 // Does nothing on cache hit.
 static void SyncTCB(void)
@@ -345,6 +424,29 @@ static void SyncTCB(void)
 	hLastTCB = hCurrentTCP;
 	TCPRAMCopy((PTR_BASE)&MyTCB, TCP_PIC_RAM, MyTCBStub.bufferTxStart - sizeof(MyTCB), MyTCBStub.vMemoryMedium, sizeof(MyTCB));
 }
+#endif
+
+// Sets MyTCBStub.remoteHash and moves the current socket to the matching
+// bucket of the lookup index.  All writes to remoteHash must go through
+// here so FindMatchingSocket can trust the index.
+static void SetRemoteHash(WORD wHash)
+{
+	TCP_SOCKET *phTCP;
+
+	// Unlink from the old bucket; not found if the hash was never set
+	for(phTCP = &TCBHashHeads[TCP_HASH_BUCKET(MyTCBStub.remoteHash.Val)]; *phTCP != INVALID_SOCKET; phTCP = &TCBHashNext[*phTCP])
+	{
+		if(*phTCP == hCurrentTCP)
+		{
+			*phTCP = TCBHashNext[hCurrentTCP];
+			break;
+		}
+	}
+
+	MyTCBStub.remoteHash.Val = wHash;
+	TCBHashNext[hCurrentTCP] = TCBHashHeads[TCP_HASH_BUCKET(wHash)];
+	TCBHashHeads[TCP_HASH_BUCKET(wHash)] = hCurrentTCP;
+}
 
 
 /*****************************************************************************
@@ -382,14 +484,25 @@ void TCPInit(void)
 
     // clear out module level statics
     hCurrentTCP = INVALID_SOCKET;
+#if defined(TCP_DIRECT_TCB)
+    memset(TCBs, 0, sizeof(TCBs));
+#else
     hLastTCB = INVALID_SOCKET;
     memset(&MyTCB, 0, sizeof(MyTCB));	
+#endif
     memset(TCBStubs, 0, sizeof(TCBStubs));
     memset(SYNQueue, 0, sizeof(SYNQueue));
     memset(&MyTCBStub, 0, sizeof(MyTCBStub));	
+    memset(TCBHashHeads, INVALID_SOCKET, sizeof(TCBHashHeads));
+    memset(TCBWake, 0xFF, sizeof(TCBWake));
+    dwNextTCPScan = TickGet();
+    memset(TCBEvents, 0, sizeof(TCBEvents));
+    memset(TCBEventHandlers, 0, sizeof(TCBEventHandlers));
+    memset(TCBEventContexts, 0, sizeof(TCBEventContexts));
+    bTCPEventsPending = FALSE;
 
 	#if TCP_ETH_RAM_SIZE > 0
-	WORD wCurrentETHAddress = TCP_ETH_RAM_BASE_ADDRESS;
+	PTR_BASE wCurrentETHAddress = TCP_ETH_RAM_BASE_ADDRESS;
 	#endif
 	#if TCP_PIC_RAM_SIZE > 0
 	PTR_BASE ptrCurrentPICAddress = TCP_PIC_RAM_BASE_ADDRESS;
@@ -430,7 +543,7 @@ void TCPInit(void)
 			#if TCP_ETH_RAM_SIZE > 0
 			case TCP_ETH_RAM:
 				ptrBaseAddress = wCurrentETHAddress;
-				wCurrentETHAddress += sizeof(TCB) + wTXSize+1 + wRXSize+1;
+				wCurrentETHAddress += TCB_FIFO_SIZE + wTXSize+1 + wRXSize+1;
 				// Do a sanity check to ensure that we aren't going to use memory that hasn't been allocated to us.
 				// If your code locks up right here, it means you've incorrectly allocated your TCP socket buffers in TCPIPConfig.h.  See the TCP memory allocation section.  More RAM needs to be allocated to the base memory mediums, or the individual sockets TX and RX FIFOS and socket quantiy needs to be shrunken.
 				while(wCurrentETHAddress > TCP_ETH_RAM_BASE_ADDRESS + TCP_ETH_RAM_SIZE);
@@ -440,7 +553,7 @@ void TCPInit(void)
 			#if TCP_PIC_RAM_SIZE > 0
 			case TCP_PIC_RAM:
 				ptrBaseAddress = ptrCurrentPICAddress;
-				ptrCurrentPICAddress += sizeof(TCB) + wTXSize+1 + wRXSize+1;
+				ptrCurrentPICAddress += TCB_FIFO_SIZE + wTXSize+1 + wRXSize+1;
 				// Do a sanity check to ensure that we aren't going to use memory that hasn't been allocated to us.
 				// If your code locks up right here, it means you've incorrectly allocated your TCP socket buffers in TCPIPConfig.h.  See the TCP memory allocation section.  More RAM needs to be allocated to the base memory mediums, or the individual sockets TX and RX FIFOS and socket quantiy needs to be shrunken.
 				while(ptrCurrentPICAddress > TCP_PIC_RAM_BASE_ADDRESS + TCP_PIC_RAM_SIZE);
@@ -450,7 +563,7 @@ void TCPInit(void)
 			#if TCP_SPI_RAM_SIZE > 0
 			case TCP_SPI_RAM:
 				ptrBaseAddress = wCurrentSPIAddress;
-				wCurrentSPIAddress += sizeof(TCB) + wTXSize+1 + wRXSize+1;
+				wCurrentSPIAddress += TCB_FIFO_SIZE + wTXSize+1 + wRXSize+1;
 				// Do a sanity check to ensure that we aren't going to use memory that hasn't been allocated to us.
 				// If your code locks up right here, it means you've incorrectly allocated your TCP socket buffers in TCPIPConfig.h.  See the TCP memory allocation section.  More RAM needs to be allocated to the base memory mediums, or the individual sockets TX and RX FIFOS and socket quantiy needs to be shrunken.
 				while(wCurrentSPIAddress > TCP_SPI_RAM_BASE_ADDRESS + TCP_SPI_RAM_SIZE);
@@ -462,7 +575,7 @@ void TCPInit(void)
 		}
 	
 		MyTCBStub.vMemoryMedium = vMedium;
-		MyTCBStub.bufferTxStart	= ptrBaseAddress + sizeof(TCB);
+		MyTCBStub.bufferTxStart	= ptrBaseAddress + TCB_FIFO_SIZE;
 		MyTCBStub.bufferRxStart	= MyTCBStub.bufferTxStart + wTXSize + 1;
 		MyTCBStub.bufferEnd		= MyTCBStub.bufferRxStart + wRXSize;
 		MyTCBStub.smState		= TCP_CLOSED;
@@ -485,7 +598,7 @@ void TCPInit(void)
 
 /*****************************************************************************
   Function:
-	TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose)
+	TCP_SOCKET TCPOpen(TCP_REMOTE_HOST dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose)
     
   Summary:
     Opens a TCP socket for listening or as a client.
@@ -589,16 +702,16 @@ void TCPInit(void)
     
     // Open a client socket to www.microchip.com
     // The double cast here prevents compiler warnings
-    skt = TCPOpen((DWORD)(PTR_BASE)"www.microchip.com",
+    skt = TCPOpen((PTR_BASE)"www.microchip.com",
                     TCP_OPEN_ROM_HOST, 80, TCP_PURPOSE_DEFAULT);
     
     // Reopen a client socket without repeating DNS or ARP
     SOCKET_INFO cache = TCPGetSocketInfo(skt);  // Call with the old socket
-    skt = TCPOpen((DWORD)(PTR_BASE)&amp;cache.remote, TCP_OPEN_NODE_INFO,
+    skt = TCPOpen((PTR_BASE)&amp;cache.remote, TCP_OPEN_NODE_INFO,
                     cache.remotePort.Val, TCP_PURPOSE_DEFAULT);
     </code>                                                    
   *****************************************************************************/
-TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose)
+TCP_SOCKET TCPOpen(TCP_REMOTE_HOST dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose)
 {
 	TCP_SOCKET hTCP;
 
@@ -621,13 +734,17 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 		// option is received from remote node)
 		MyTCB.wRemoteMSS = 536;
 
+		// Nothing from a previous user of this socket is reported
+		TCBEvents[hTCP] = 0x00;
+		TCBEventHandlers[hTCP] = NULL;
+
 		// See if this is a server socket
 		if(vRemoteHostType == TCP_OPEN_SERVER)
 		{
 			MyTCB.localPort.Val = wPort;
 			MyTCBStub.Flags.bServer = TRUE;
 			MyTCBStub.smState = TCP_LISTEN;
-			MyTCBStub.remoteHash.Val = wPort;
+			SetRemoteHash(wPort);
 			#if defined(STACK_USE_SSL_SERVER)
 			MyTCB.localSSLPort.Val = 0;
 			#endif
@@ -649,6 +766,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 				// Flag to start the DNS, ARP, SYN processes
 				MyTCBStub.eventTime = TickGet();
 				MyTCBStub.Flags.bTimerEnabled = 1;
+				TCPWake(hTCP);
 	
 				switch(vRemoteHostType)
 				{
@@ -665,7 +783,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 						// dwRemoteHost is a literal IP address.  This 
 						// doesn't need DNS and can skip directly to the 
 						// Gateway ARPing step.
-						MyTCBStub.remoteHash.Val = (((DWORD_VAL*)&dwRemoteHost)->w[1]+((DWORD_VAL*)&dwRemoteHost)->w[0] + wPort) ^ MyTCB.localPort.Val;
+						SetRemoteHash((((DWORD_VAL*)&dwRemoteHost)->w[1]+((DWORD_VAL*)&dwRemoteHost)->w[0] + wPort) ^ MyTCB.localPort.Val);
 						MyTCB.remote.niRemoteMACIP.IPAddr.Val = dwRemoteHost;
 						MyTCB.retryCount = 0;
 						MyTCB.retryInterval = (TICK_SECOND/4)/256;
@@ -673,7 +791,7 @@ TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vS
 						break;
 		
 					case TCP_OPEN_NODE_INFO:
-						MyTCBStub.remoteHash.Val = (((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[1]+((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[0] + wPort) ^ MyTCB.localPort.Val;
+						SetRemoteHash((((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[1]+((NODE_INFO*)(PTR_BASE)dwRemoteHost)->IPAddr.w[0] + wPort) ^ MyTCB.localPort.Val);
 						memcpy((void*)(BYTE*)&MyTCB.remote, (void*)(BYTE*)(PTR_BASE)dwRemoteHost, sizeof(NODE_INFO));
 						MyTCBStub.smState = TCP_SYN_SENT;
 						SendTCP(SYN, SENDTCP_RESET_TIMERS);
@@ -992,6 +1110,46 @@ SOCKET_INFO* TCPGetRemoteInfo(TCP_SOCKET hTCP)
 	return &RemoteInfo;
 }
 
+/*****************************************************************************
+  Function:
+	TCP_SOCKET_STATS* TCPGetSocketStats(TCP_SOCKET hTCP)
+
+  Summary:
+	Obtains round trip and retransmission statistics for a socket.
+
+  Description:
+	Returns the smoothed round trip time, its variation and the current
+	retransmission timeout (all in ticks), along with how many times data
+	was retransmitted because the retransmission timer expired and how 
+	many times three duplicate ACKs triggered a fast retransmit.  The 
+	values cover the socket since it was last closed.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to check.
+
+  Returns:
+	The TCP_SOCKET_STATS structure associated with this socket.  This 
+	structure is allocated statically by the function and is valid only 
+	until the next time TCPGetSocketStats() is called.
+  ***************************************************************************/
+TCP_SOCKET_STATS* TCPGetSocketStats(TCP_SOCKET hTCP)
+{
+	static TCP_SOCKET_STATS	Stats;
+
+	SyncTCBStub(hTCP);
+	SyncTCB();
+	Stats.dwSRTT = MyTCB.dwSRTT >> 3;
+	Stats.dwRTTVAR = MyTCB.dwRTTVAR >> 2;
+	Stats.dwRTO = MyTCB.dwRTO;
+	Stats.wRetransmits = MyTCB.wRetransmits;
+	Stats.wFastRetransmits = MyTCB.wFastRetransmits;
+
+	return &Stats;
+}
+
 
 
 /****************************************************************************
@@ -1012,6 +1170,11 @@ SOCKET_INFO* TCPGetRemoteInfo(TCP_SOCKET hTCP)
 	when either a) the TX buffer is half full or b) the 
 	TCP_AUTO_TRANSMIT_TIMEOUT_VAL (default: 40ms) has elapsed.
 
+	While the socket is corked with TCPSetCork(), only a full sized 
+	segment is sent, unless the TX buffer is full.  The rest waits for 
+	more data, TCPSetCork(hTCP, FALSE), or TCP_CORK_TIMEOUT_VAL (default:
+	200ms).
+
   Precondition:
 	TCP is initialized and the socket is connected.
 
@@ -1027,6 +1190,8 @@ SOCKET_INFO* TCPGetRemoteInfo(TCP_SOCKET hTCP)
   ***************************************************************************/
 void TCPFlush(TCP_SOCKET hTCP)
 {
+	WORD wUnsent;
+
 	SyncTCBStub(hTCP);
 	SyncTCB();
 
@@ -1034,12 +1199,165 @@ void TCPFlush(TCP_SOCKET hTCP)
 
 	if(MyTCBStub.txHead != MyTCB.txUnackedTail)
 	{
+		// Hold back a partial segment while corked
+		if(MyTCBStub.Flags.bCorked && (TCPIsPutReady(hTCP) != 0u))
+		{
+			wUnsent = MyTCBStub.txHead - MyTCB.txUnackedTail;
+			if(MyTCBStub.txHead < MyTCB.txUnackedTail)
+				wUnsent += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+			if(wUnsent < MyTCB.wRemoteMSS)
+				return;
+		}
+
 		// Send the TCP segment with all unacked bytes
 		SendTCP(ACK, SENDTCP_RESET_TIMERS);
 	}
 }
 
 
+/*****************************************************************************
+  Function:
+	void TCPSetCork(TCP_SOCKET hTCP, BOOL bCork)
+
+  Summary:
+	Holds back partial segments while a message is being written.
+
+  Description:
+	While corked, TCPFlush() only sends full sized segments and the 
+	automatic transmit timer runs for TCP_CORK_TIMEOUT_VAL instead of 
+	TCP_AUTO_TRANSMIT_TIMEOUT_VAL.  An application can cork the socket, 
+	write a message in pieces (flushing as often as it likes), and uncork
+	it to send the remainder in as few segments as possible.  Uncorking 
+	flushes whatever is pending.  Closing the socket uncorks it.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to cork or uncork.
+	bCork - TRUE to cork, FALSE to uncork and flush.
+
+  Returns:
+	None
+  ***************************************************************************/
+void TCPSetCork(TCP_SOCKET hTCP, BOOL bCork)
+{
+	SyncTCBStub(hTCP);
+	MyTCBStub.Flags.bCorked = bCork ? 1 : 0;
+	if(!bCork)
+		TCPFlush(hTCP);
+}
+
+/*****************************************************************************
+  Function:
+	BOOL TCPIsCorked(TCP_SOCKET hTCP)
+
+  Summary:
+	Determines if a socket is corked.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to check.
+
+  Return Values:
+	TRUE - The socket is corked with TCPSetCork().
+	FALSE - Partial segments are sent normally.
+  ***************************************************************************/
+BOOL TCPIsCorked(TCP_SOCKET hTCP)
+{
+	SyncTCBStub(hTCP);
+	return MyTCBStub.Flags.bCorked;
+}
+
+/*****************************************************************************
+  Function:
+	void TCPSetEventHandler(TCP_SOCKET hTCP, TCP_EVENT_HANDLER pfnHandler, void* pContext)
+
+  Summary:
+	Registers a function to be told about a socket's events.
+
+  Description:
+	Instead of polling TCPIsConnected(), TCPIsGetReady() and 
+	TCPIsPutReady() on every socket, an application can register a 
+	handler.  The stack notes TCP_EVENT_* flags on the socket as segments 
+	are processed, and TCPDispatchEvents() calls the handler once with all
+	the flags gathered since its last call.  Events noted before the 
+	handler was registered are dropped.
+
+	The handler is cleared when the socket is opened again with TCPOpen().
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to watch.
+	pfnHandler - Function to call, or NULL to stop reporting events.
+	pContext - Passed back to pfnHandler unchanged.
+
+  Returns:
+	None
+  ***************************************************************************/
+void TCPSetEventHandler(TCP_SOCKET hTCP, TCP_EVENT_HANDLER pfnHandler, void* pContext)
+{
+	if(hTCP >= TCP_SOCKET_COUNT)
+		return;
+
+	TCBEvents[hTCP] = 0x00;
+	TCBEventHandlers[hTCP] = pfnHandler;
+	TCBEventContexts[hTCP] = pContext;
+}
+
+/*****************************************************************************
+  Function:
+	void TCPDispatchEvents(void)
+
+  Summary:
+	Calls the event handlers of all sockets with new events.
+
+  Description:
+	Hands each socket's gathered TCP_EVENT_* flags to the handler 
+	registered with TCPSetEventHandler() and clears them.  Call this from 
+	the application's main loop after StackTask(), never from inside the 
+	stack.  Handlers may call any TCP API, including TCPDisconnect() and 
+	TCPSetEventHandler(); events they cause are reported on the next call.
+	A call made from inside a handler returns without doing anything.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	None
+
+  Returns:
+	None
+  ***************************************************************************/
+void TCPDispatchEvents(void)
+{
+	static BOOL bDispatching = FALSE;
+	TCP_SOCKET hTCP;
+	BYTE vEvents;
+
+	if(!bTCPEventsPending || bDispatching)
+		return;
+	bTCPEventsPending = FALSE;
+	bDispatching = TRUE;
+
+	for(hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++)
+	{
+		vEvents = TCBEvents[hTCP];
+		if(vEvents == 0u)
+			continue;
+		TCBEvents[hTCP] = 0x00;
+
+		if(TCBEventHandlers[hTCP])
+			TCBEventHandlers[hTCP](hTCP, vEvents, TCBEventContexts[hTCP]);
+	}
+
+	bDispatching = FALSE;
+}
+
 /*****************************************************************************
   Function:
 	WORD TCPIsPutReady(TCP_SOCKET hTCP)
@@ -1171,8 +1489,9 @@ BOOL TCPPut(TCP_SOCKET hTCP, BYTE byte)
 	else if(!MyTCBStub.Flags.bTimer2Enabled)
 	{
 		MyTCBStub.Flags.bTimer2Enabled = TRUE;
-		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull;
+		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + (MyTCBStub.Flags.bCorked ? TCP_CORK_TIMEOUT_VAL/256ull : TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull);
 	}
+	TCPWake(hTCP);
 
 	return TRUE;
 }
@@ -1281,12 +1600,52 @@ WORD TCPPutArray(TCP_SOCKET hTCP, BYTE* data, WORD len)
 	else if(!MyTCBStub.Flags.bTimer2Enabled)
 	{
 		MyTCBStub.Flags.bTimer2Enabled = TRUE;
-		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull;
+		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + (MyTCBStub.Flags.bCorked ? TCP_CORK_TIMEOUT_VAL/256ull : TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull);
 	}
+	TCPWake(hTCP);
 
 	return wActualLen + wRightLen;
 }
 
+/*****************************************************************************
+  Function:
+	WORD TCPPutArrayV(TCP_SOCKET hTCP, TCP_IOVEC* iov, BYTE vCount)
+
+  Description:
+	Writes several arrays from RAM to a TCP socket, in order, as if they 
+	were one array.  A header, payload and trailer kept in separate 
+	buffers end up back to back in the TX FIFO and go out in the same 
+	segment(s) instead of one small segment each.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to which data is to be written.
+	iov - Array of buffers to be written.
+	vCount - Number of entries in iov.
+
+  Returns:
+	The total number of bytes written to the socket.  If less than the 
+	sum of the lengths, the buffer became full or the socket is not 
+	conected; writing stops at the first buffer that did not fit.
+  ***************************************************************************/
+WORD TCPPutArrayV(TCP_SOCKET hTCP, TCP_IOVEC* iov, BYTE vCount)
+{
+	WORD wTotal = 0;
+	WORD w;
+
+	for(; vCount; vCount--, iov++)
+	{
+		w = TCPPutArray(hTCP, iov->pData, iov->wLen);
+		wTotal += w;
+		if(w < iov->wLen)
+			break;
+	}
+
+	return wTotal;
+}
+
 /*****************************************************************************
   Function:
 	WORD TCPPutROMArray(TCP_SOCKET hTCP, ROM BYTE* data, WORD len)
@@ -1395,8 +1754,9 @@ WORD TCPPutROMArray(TCP_SOCKET hTCP, ROM BYTE* data, WORD len)
 	else if(!MyTCBStub.Flags.bTimer2Enabled)
 	{
 		MyTCBStub.Flags.bTimer2Enabled = TRUE;
-		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull;
+		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + (MyTCBStub.Flags.bCorked ? TCP_CORK_TIMEOUT_VAL/256ull : TCP_AUTO_TRANSMIT_TIMEOUT_VAL/256ull);
 	}
+	TCPWake(hTCP);
 
 	return wActualLen + wRightLen;
 }
@@ -1619,6 +1979,7 @@ BOOL TCPGet(TCP_SOCKET hTCP, BYTE* byte)
 		MyTCBStub.Flags.bTimer2Enabled = TRUE;
 		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + TCP_WINDOW_UPDATE_TIMEOUT_VAL/256ull;
 	}
+	TCPWake(hTCP);
 
 
 	return TRUE;
@@ -1691,6 +2052,7 @@ WORD TCPGetArray(TCP_SOCKET hTCP, BYTE* buffer, WORD len)
 		MyTCBStub.Flags.bTimer2Enabled = TRUE;
 		MyTCBStub.eventTime2 = (WORD)TickGetDiv256() + TCP_WINDOW_UPDATE_TIMEOUT_VAL/256ull;
 	}
+	TCPWake(hTCP);
 
 	return len;
 }
@@ -1820,6 +2182,102 @@ WORD TCPPeekArray(TCP_SOCKET hTCP, BYTE *vBuffer, WORD wLen, WORD wStart)
 	return wLen;
 }
 
+/*****************************************************************************
+  Function:
+	WORD TCPBorrowRx(TCP_SOCKET hTCP, TCP_RX_SPANS* spans)
+
+  Summary:
+	Returns pointers to the data in the TCP RX FIFO without copying it.
+
+  Description:
+	Describes the bytes waiting in the RX FIFO as up to two contiguous 
+	spans: the one starting at the read position and, if the data wraps 
+	around the end of the circular FIFO, the one at its start.  The 
+	application may parse the bytes in place and then call TCPConsume() 
+	to remove however many it used.  Nothing is removed and no window 
+	update is sent by this function.
+
+	Only FIFOs in PIC RAM can be borrowed.  For sockets whose FIFOs live 
+	in Ethernet or SPI RAM, this returns 0 and the application must use 
+	TCPGetArray() or TCPPeekArray().
+  	
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to borrow from.
+	spans - Receives the two spans.  wWrapLen is 0 if the data does not 
+		wrap.
+
+  Return Values:
+	Total number of bytes described by the spans.
+
+  Remarks:
+	The spans are only valid until the next call that can change the RX 
+	FIFO: TCPConsume(), TCPGet(), TCPGetArray(), TCPDiscard(), or a return 
+	to StackTask().  Incoming data is only appended after the spans, so 
+	data that has been borrowed is never overwritten until it is consumed.
+  ***************************************************************************/
+WORD TCPBorrowRx(TCP_SOCKET hTCP, TCP_RX_SPANS* spans)
+{
+	WORD wGetReadyCount;
+
+	spans->pHead = NULL;
+	spans->wHeadLen = 0;
+	spans->pWrap = NULL;
+	spans->wWrapLen = 0;
+
+	wGetReadyCount = TCPIsGetReady(hTCP);
+	if(wGetReadyCount == 0u)
+		return 0u;
+
+	SyncTCBStub(hTCP);
+	if(MyTCBStub.vMemoryMedium != TCP_PIC_RAM)
+		return 0u;
+
+	spans->pHead = (BYTE*)MyTCBStub.rxTail;
+	if(MyTCBStub.rxTail + wGetReadyCount > MyTCBStub.bufferEnd)
+	{
+		spans->wHeadLen = MyTCBStub.bufferEnd - MyTCBStub.rxTail + 1;
+		spans->pWrap = (BYTE*)MyTCBStub.bufferRxStart;
+		spans->wWrapLen = wGetReadyCount - spans->wHeadLen;
+	}
+	else
+	{
+		spans->wHeadLen = wGetReadyCount;
+	}
+
+	return wGetReadyCount;
+}
+
+/*****************************************************************************
+  Function:
+	WORD TCPConsume(TCP_SOCKET hTCP, WORD len)
+
+  Summary:
+	Removes bytes from the TCP RX FIFO without copying them.
+
+  Description:
+	Advances the read position past len bytes, normally after they were 
+	parsed in place through TCPBorrowRx().  Window updates are sent exactly
+	as for TCPGetArray().
+  	
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to consume from.
+	len - Number of bytes to remove.
+
+  Return Values:
+	The number of bytes removed.  If less than len, the RX FIFO became 
+	empty or the socket is not conected.
+  ***************************************************************************/
+WORD TCPConsume(TCP_SOCKET hTCP, WORD len)
+{
+	return TCPGetArray(hTCP, NULL, len);
+}
+
 /*****************************************************************************
   Function:
 	BYTE TCPPeek(TCP_SOCKET hTCP, WORD wStart)
@@ -1862,62 +2320,202 @@ BYTE TCPPeek(TCP_SOCKET hTCP, WORD wStart)
 	Search Functions
   ***************************************************************************/
 
+// Converts a-z to A-Z when doing a text compare.  A function rather than a 
+// macro: the search passes it TCPFindByte() calls, which must run once.
+static BYTE TCPFindFold(BYTE c, BOOL bTextCompare)
+{
+	if(bTextCompare && c >= 'a' && c <= 'z')
+		return c + 'A' - 'a';
+	return c;
+}
+
+// The part of a socket's RX FIFO being searched.  Search position 0 is 
+// ptrFirst; after wFirstLen bytes the FIFO wraps to ptrSecond.
+typedef struct
+{
+	PTR_BASE	ptrFirst;
+	WORD		wFirstLen;
+	PTR_BASE	ptrSecond;
+	WORD		wDataLen;		// bytes in the search range
+	BYTE		vMedium;
+	WORD		wCacheStart;	// search position of rgbCache[0]
+	WORD		wCacheLen;		// valid bytes in rgbCache, 0 if empty
+	BYTE		rgbCache[32];	// for FIFOs not in PIC RAM
+} TCP_FIND_SPANS;
+
+// Skip table for the last pattern searched.  Callers tend to look for the
+// same "\r\n" or boundary string over and over, so the table is only
+// rebuilt when the pattern changes.
+static struct
+{
+	BYTE	rgbSkip[256];
+	BYTE	rgbPattern[TCP_FIND_CACHE_LEN];
+	WORD	wLen;			// 0 if the table is not for a cached pattern
+	BOOL	bTextCompare;
+} TCPFindTable;
+
 /*****************************************************************************
   Function:
-	WORD TCPFindArrayEx(TCP_SOCKET hTCP, BYTE* cFindArray, WORD wLen, 
-						WORD wStart, WORD wSearchLen, BOOL bTextCompare)
+	static void TCPFindPrepare(BYTE* cFindArray, WORD wLen, BOOL bTextCompare)
 
   Summary:
-  	Searches for a string in the TCP RX buffer.
+	Builds the Boyer-Moore-Horspool skip table for a pattern.
 
   Description:
-	This function finds the first occurrance of an array of bytes in the
-	TCP RX buffer.  It can be used by an application to abstract searches 
-	out of their own application code.  For increased efficiency, the 
-	function is capable of limiting the scope of search to a specific
-	range of bytes.  It can also perform a case-insensitive search if
-	required.
-	
-	For example, if the buffer contains "I love PIC MCUs!" and the search
-	array is "love" with a length of 4, a value of 2 will be returned.
+	For every byte value, the skip is how far the search window can 
+	slide when that byte is under the window's last position.  Bytes not 
+	in the pattern skip the whole pattern length.  Skips are capped at 
+	255, which only makes very long patterns slide less far.
 
   Precondition:
-	TCP is initialized.
+	wLen > 0
 
   Parameters:
-	hTCP - The socket to search within.
-	cFindArray - The array of bytes to find in the buffer.
-	wLen - Length of cFindArray.
-	wStart - Zero-indexed starting position within the buffer.
-	wSearchLen - Length from wStart to search in the buffer.
-	bTextCompare - TRUE for case-insensitive text search, FALSE for binary search
+	cFindArray - The pattern
+	wLen - Length of cFindArray
+	bTextCompare - TRUE to build the table for a case-insensitive search
 
-  Return Values:
-	0xFFFF - Search array not found
-	Otherwise - Zero-indexed position of the first occurrance
+  Returns:
+  	None
+  ***************************************************************************/
+static void TCPFindPrepare(BYTE* cFindArray, WORD wLen, BOOL bTextCompare)
+{
+	WORD i, wSkip;
 
-  Remarks:
-	Since this function usually must transfer data from external storage
-	to internal RAM for comparison, its performance degrades significantly
-	when the buffer is full and the array is not found.  For better 
-	performance, try to search for characters that are expected to exist or
-	limit the scope of the search as much as possible.  The HTTP2 module, 
-	for example, uses this function to parse headers.  However, it searches 
+	if(TCPFindTable.wLen == wLen && TCPFindTable.bTextCompare == bTextCompare &&
+	   memcmp(TCPFindTable.rgbPattern, cFindArray, wLen) == 0)
+		return;
+
+	memset(TCPFindTable.rgbSkip, (wLen > 0xFFu) ? 0xFF : (BYTE)wLen, sizeof(TCPFindTable.rgbSkip));
+	for(i = 0; i + 1 < wLen; i++)
+	{
+		wSkip = wLen - 1 - i;
+		TCPFindTable.rgbSkip[TCPFindFold(cFindArray[i], bTextCompare)] = (wSkip > 0xFFu) ? 0xFF : (BYTE)wSkip;
+	}
+
+	// Too long to remember, rebuild next time
+	TCPFindTable.wLen = 0;
+	if(wLen <= TCP_FIND_CACHE_LEN)
+	{
+		memcpy(TCPFindTable.rgbPattern, cFindArray, wLen);
+		TCPFindTable.wLen = wLen;
+		TCPFindTable.bTextCompare = bTextCompare;
+	}
+}
+
+/*****************************************************************************
+  Function:
+	static BYTE TCPFindByte(TCP_FIND_SPANS* pSpans, WORD wPos)
+
+  Summary:
+	Reads one byte of the search range.
+
+  Description:
+	FIFOs in PIC RAM are read in place.  Other memory mediums are read 
+	through rgbCache a block at a time, so the search does not go to 
+	external memory for every byte.
+
+  Precondition:
+	wPos < pSpans->wDataLen
+
+  Parameters:
+	pSpans - The search range
+	wPos - Position from the start of the search range
+
+  Returns:
+  	The byte
+  ***************************************************************************/
+static BYTE TCPFindByte(TCP_FIND_SPANS* pSpans, WORD wPos)
+{
+	WORD wBlock, wLen, wFirst;
+
+	if(pSpans->vMedium == TCP_PIC_RAM)
+	{
+		if(wPos < pSpans->wFirstLen)
+			return ((BYTE*)pSpans->ptrFirst)[wPos];
+		return ((BYTE*)pSpans->ptrSecond)[wPos - pSpans->wFirstLen];
+	}
+
+	if(wPos < pSpans->wCacheStart || wPos - pSpans->wCacheStart >= pSpans->wCacheLen)
+	{
+		wBlock = wPos & ~(WORD)(sizeof(pSpans->rgbCache) - 1);
+		wLen = pSpans->wDataLen - wBlock;
+		if(wLen > sizeof(pSpans->rgbCache))
+			wLen = sizeof(pSpans->rgbCache);
+
+		wFirst = 0;
+		if(wBlock < pSpans->wFirstLen)
+		{
+			wFirst = pSpans->wFirstLen - wBlock;
+			if(wFirst > wLen)
+				wFirst = wLen;
+			TCPRAMCopy((PTR_BASE)pSpans->rgbCache, TCP_PIC_RAM, pSpans->ptrFirst + wBlock, pSpans->vMedium, wFirst);
+		}
+		if(wLen > wFirst)
+			TCPRAMCopy((PTR_BASE)&pSpans->rgbCache[wFirst], TCP_PIC_RAM, pSpans->ptrSecond + wBlock + wFirst - pSpans->wFirstLen, pSpans->vMedium, wLen - wFirst);
+
+		pSpans->wCacheStart = wBlock;
+		pSpans->wCacheLen = wLen;
+	}
+
+	return pSpans->rgbCache[wPos - pSpans->wCacheStart];
+}
+
+/*****************************************************************************
+  Function:
+	WORD TCPFindArrayEx(TCP_SOCKET hTCP, BYTE* cFindArray, WORD wLen, 
+						WORD wStart, WORD wSearchLen, BOOL bTextCompare)
+
+  Summary:
+  	Searches for a string in the TCP RX buffer.
+
+  Description:
+	This function finds the first occurrance of an array of bytes in the
+	TCP RX buffer.  It can be used by an application to abstract searches 
+	out of their own application code.  For increased efficiency, the 
+	function is capable of limiting the scope of search to a specific
+	range of bytes.  It can also perform a case-insensitive search if
+	required.
+	
+	For example, if the buffer contains "I love PIC MCUs!" and the search
+	array is "love" with a length of 4, a value of 2 will be returned.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to search within.
+	cFindArray - The array of bytes to find in the buffer.
+	wLen - Length of cFindArray.
+	wStart - Zero-indexed starting position within the buffer.
+	wSearchLen - Length from wStart to search in the buffer.
+	bTextCompare - TRUE for case-insensitive text search, FALSE for binary search
+
+  Return Values:
+	0xFFFF - Search array not found
+	Otherwise - Zero-indexed position of the first occurrance
+
+  Remarks:
+	Since this function usually must transfer data from external storage
+	to internal RAM for comparison, its performance degrades significantly
+	when the buffer is full and the array is not found.  For better 
+	performance, try to search for characters that are expected to exist or
+	limit the scope of the search as much as possible.  The HTTP2 module, 
+	for example, uses this function to parse headers.  However, it searches 
 	for newlines, then the separating colon, then reads the header name to 
 	RAM for final comparison.  This has proven to be significantly faster  
 	than searching for full header name strings outright.
+
+	The search is Boyer-Moore-Horspool, so longer patterns are found 
+	faster; the skip table of the last pattern is kept for the next call.
   ***************************************************************************/
 WORD TCPFindArrayEx(TCP_SOCKET hTCP, BYTE* cFindArray, WORD wLen, WORD wStart, WORD wSearchLen, BOOL bTextCompare)
 {
-	PTR_BASE ptrRead;
+	TCP_FIND_SPANS Spans;
 	WORD wDataLen;
-	WORD wBytesUntilWrap;
-	PTR_BASE ptrLocation;
-	WORD wLenStart;
-	BYTE *cFindArrayStart;
-	BYTE i, j, k;
-	BOOL isFinding;
-	BYTE buffer[32];
+	WORD wPos;
+	WORD k;
+	BYTE c, cLast, cSkip;
 
 	if(wLen == 0u)
 		return 0u;
@@ -1926,110 +2524,50 @@ WORD TCPFindArrayEx(TCP_SOCKET hTCP, BYTE* cFindArray, WORD wLen, WORD wStart, W
 
 	// Find out how many bytes are in the RX FIFO and return 
 	// immediately if we won't possibly find a match
-	wDataLen = TCPIsGetReady(hTCP) - wStart;
-	if(wDataLen < wLen)
+	wDataLen = TCPIsGetReady(hTCP);
+	if(wStart >= wDataLen)
 		return 0xFFFFu;
+	wDataLen -= wStart;
 	if(wSearchLen && (wDataLen > wSearchLen))
 		wDataLen = wSearchLen;
+	if(wDataLen < wLen)
+		return 0xFFFFu;
 
-	ptrLocation = MyTCBStub.rxTail + wStart;
-	if(ptrLocation > MyTCBStub.bufferEnd)
-		ptrLocation -= MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart + 1;
-	ptrRead = ptrLocation;
-	wBytesUntilWrap = MyTCBStub.bufferEnd - ptrLocation + 1;
-	ptrLocation = wStart;
-	wLenStart = wLen;
-	cFindArrayStart = cFindArray;
-	j = *cFindArray++;
-	isFinding = FALSE;
-	if(bTextCompare)
-	{
-		if(j >= 'a' && j <= 'z')
-			j += 'A'-'a';
-	}
-
-	// Search for the array
+	// The search range is up to two runs of FIFO memory, the second 
+	// starting over at bufferRxStart
+	Spans.ptrFirst = MyTCBStub.rxTail + wStart;
+	if(Spans.ptrFirst > MyTCBStub.bufferEnd)
+		Spans.ptrFirst -= MyTCBStub.bufferEnd - MyTCBStub.bufferRxStart + 1;
+	Spans.wFirstLen = MyTCBStub.bufferEnd - Spans.ptrFirst + 1;
+	Spans.ptrSecond = MyTCBStub.bufferRxStart;
+	Spans.wDataLen = wDataLen;
+	Spans.vMedium = MyTCBStub.vMemoryMedium;
+	Spans.wCacheLen = 0;
+
+	TCPFindPrepare(cFindArray, wLen, bTextCompare);
+
+	// Boyer-Moore-Horspool: compare the window back to front starting 
+	// with its last byte, then slide it by the skip for that byte
+	cLast = TCPFindFold(cFindArray[wLen-1], bTextCompare);
+	wPos = wLen - 1;
 	while(1)
 	{
-		// Figure out how big of a chunk to read
-		k = sizeof(buffer);
-		if(k > wBytesUntilWrap)
-			k = wBytesUntilWrap;
-		if((WORD)k > wDataLen)
-			k = wDataLen;
-
-		// Read a chunk of data into the buffer
-		TCPRAMCopy((PTR_BASE)buffer, TCP_PIC_RAM, ptrRead, MyTCBStub.vMemoryMedium, (WORD)k);
-		ptrRead += k;
-		wBytesUntilWrap -= k;
-
-		if(wBytesUntilWrap == 0u)
-		{
-			ptrRead = MyTCBStub.bufferRxStart;
-			wBytesUntilWrap = 0xFFFFu;
-		}
-
-		// Convert everything to uppercase
-		if(bTextCompare)
-		{
-			for(i = 0; i < k; i++)
-			{
-				if(buffer[i] >= 'a' && buffer[i] <= 'z')
-					buffer[i] += 'A'-'a';
-
-				if(j == buffer[i])
-				{
-					if(--wLen == 0u)
-						return ptrLocation-wLenStart + i + 1;
-					j = *cFindArray++;
-					isFinding = TRUE;
-					if(j >= 'a' && j <= 'z')
-						j += 'A'-'a';
-				}
-				else
-				{
-					wLen = wLenStart;
-					if(isFinding)
-					{
-						cFindArray = cFindArrayStart;
-						j = *cFindArray++;
-						if(j >= 'a' && j <= 'z')
-							j += 'A'-'a';
-						isFinding = FALSE;
-					}
-				}
-			}
-		}
-		else	// Compare as is
+		c = TCPFindFold(TCPFindByte(&Spans, wPos), bTextCompare);
+		if(c == cLast)
 		{
-			for(i = 0; i < k; i++)
+			for(k = wLen - 1; k; k--)
 			{
-				if(j == buffer[i])
-				{
-					if(--wLen == 0u)
-						return ptrLocation-wLenStart + i + 1;
-					j = *cFindArray++;
-					isFinding = TRUE;
-				}
-				else
-				{
-					wLen = wLenStart;
-					if(isFinding)
-					{
-						cFindArray = cFindArrayStart;
-						j = *cFindArray++;
-						isFinding = FALSE;
-					}
-				}
+				if(TCPFindFold(TCPFindByte(&Spans, wPos - wLen + k), bTextCompare) != TCPFindFold(cFindArray[k-1], bTextCompare))
+					break;
 			}
+			if(k == 0u)
+				return wStart + wPos - (wLen - 1);
 		}
 
-		// Check to see if it is impossible to find a match
-		wDataLen -= k;
-		if(wDataLen < wLen)
+		cSkip = TCPFindTable.rgbSkip[c];
+		if(wDataLen - 1 - wPos < cSkip)
 			return 0xFFFFu;
-
-		ptrLocation += k;
+		wPos += cSkip;
 	}
 }
 
@@ -2273,9 +2811,11 @@ WORD TCPFindEx(TCP_SOCKET hTCP, BYTE cFind, WORD wStart, WORD wSearchLen, BOOL b
   	Performs periodic TCP tasks.
 
   Description:
-	This function performs any required periodic TCP tasks.  Each 
-	socket's state machine is checked, and any elapsed timeout periods
-	are handled.
+	This function performs any required periodic TCP tasks.  The state 
+	machine of each socket that has been woken (by new data, a received 
+	segment, a state change or a timer coming due) is checked, and any 
+	elapsed timeout periods are handled.  Sockets with nothing pending 
+	are skipped without loading their stubs.
 
   Precondition:
 	TCP is initialized.
@@ -2289,434 +2829,581 @@ WORD TCPFindEx(TCP_SOCKET hTCP, BYTE cFind, WORD wStart, WORD wSearchLen, BOOL b
 void TCPTick(void)
 {
 	TCP_SOCKET hTCP;
-	BOOL bRetransmit;
-	BOOL bCloseSocket;
-	BYTE vFlags;
+	BYTE i, vWake, vBit;
+	#if TCP_SYN_QUEUE_MAX_ENTRIES
 	WORD w;
+	#endif
 
-	// Periodically all "not closed" sockets must perform timed operations
-	for(hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++)
+	// Look at every socket when the earliest known deadline has come, and 
+	// while SYNs wait for a listening socket.  Otherwise only the sockets 
+	// that were woken need any attention; idle ones cost nothing here.
+	if(((LONG)(TickGet() - dwNextTCPScan) >= (LONG)0)
+	#if TCP_SYN_QUEUE_MAX_ENTRIES
+		|| (SYNQueue[0].wDestPort != 0u)
+	#endif
+	)
 	{
-		SyncTCBStub(hTCP);
-		
-		// Handle any SSL Processing and Message Transmission
-		#if defined(STACK_USE_SSL)
-		if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+		memset(TCBWake, 0xFF, sizeof(TCBWake));
+		dwNextTCPScan = TickGet() + TCP_FULL_SCAN_INTERVAL;
+	}
+
+	for(i = 0; i < sizeof(TCBWake); i++)
+	{
+		// Take this group's wake bits; sockets woken while being 
+		// processed are left for the next call
+		vWake = TCBWake[i];
+		if(vWake == 0u)
+			continue;
+		TCBWake[i] = 0x00;
+
+		for(vBit = 0; vBit < 8u; vBit++)
 		{
-			// Handle any periodic tasks, such as RSA operations
-			SSLPeriodic(hTCP, MyTCBStub.sslStubID);
-			
-			// If unsent data is waiting, transmit it as an application record
-			if(MyTCBStub.sslTxHead != MyTCBStub.txHead && TCPSSLGetPendingTxSize(hTCP) != 0u)
-				SSLTxRecord(hTCP, MyTCBStub.sslStubID, SSL_APPLICATION);
-			
-			// If an SSL message is requested, send it now
-			if(MyTCBStub.sslReqMessage != SSL_NO_MESSAGE)
-				SSLTxMessage(hTCP, MyTCBStub.sslStubID, MyTCBStub.sslReqMessage);
-		}
-		#endif
-		
-		vFlags = 0x00;
-		bRetransmit = FALSE;
-		bCloseSocket = FALSE;
+			if(!(vWake & (1u << vBit)))
+				continue;
+			hTCP = (i << 3) + vBit;
+			if(hTCP >= TCP_SOCKET_COUNT)
+				break;
 
-		// Transmit ASAP data if the medium is available
-		if(MyTCBStub.Flags.bTXASAP || MyTCBStub.Flags.bTXASAPWithoutTimerReset)
+			TCPTickSocket(hTCP);
+			ScheduleSocket(hTCP);
+		}
+	}
+	
+	
+	#if TCP_SYN_QUEUE_MAX_ENTRIES
+		// Process SYN Queue entry timeouts
+		for(w = 0; w < TCP_SYN_QUEUE_MAX_ENTRIES; w++)
 		{
-			if(MACIsTxReady())
+			// Abort search if there are no more valid records
+			if(SYNQueue[w].wDestPort == 0u)
+				break;
+			
+			// See if this SYN has timed out
+			if((WORD)TickGetDiv256() - SYNQueue[w].wTimestamp > (WORD)(TCP_SYN_QUEUE_TIMEOUT/256ull))
 			{
-				vFlags = ACK;
-				bRetransmit = MyTCBStub.Flags.bTXASAPWithoutTimerReset;
+				// Delete this SYN from the SYNQueue and compact the SYNQueue[] array
+				TCPRAMCopy((PTR_BASE)&SYNQueue[w], TCP_PIC_RAM, (PTR_BASE)&SYNQueue[w+1], TCP_PIC_RAM, (TCP_SYN_QUEUE_MAX_ENTRIES-1u-w)*sizeof(TCP_SYN_QUEUE));
+				SYNQueue[TCP_SYN_QUEUE_MAX_ENTRIES-1].wDestPort = 0u;
+	
+				// Since we deleted an entry, we need to roll back one 
+				// index so next loop will process the correct record
+				w--;	
 			}
 		}
+	#endif
+}
 
-		// Perform any needed window updates and data transmissions
-		if(MyTCBStub.Flags.bTimer2Enabled)
-		{
-			// See if the timeout has occured, and we need to send a new window update and pending data
-			if((SHORT)(MyTCBStub.eventTime2 - (WORD)TickGetDiv256()) <= (SHORT)0)
-				vFlags = ACK;
-		}
 
-		// Process Delayed ACKnowledgement timer
-		if(MyTCBStub.Flags.bDelayedACKTimerEnabled)
+/*****************************************************************************
+  Function:
+	static void TCPTickSocket(TCP_SOCKET hTCP)
+
+  Summary:
+	Performs the periodic tasks of one socket.
+
+  Description:
+	Checks the socket's state machine and handles any elapsed timeout 
+	periods: transmit ASAP data, window update and auto transmit, delayed 
+	ACK, CLOSE_WAIT, keep-alive and retransmission timers, and SYNs 
+	waiting in the SYNQueue[] for a listening socket.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to service
+
+  Returns:
+	None
+  ***************************************************************************/
+static void TCPTickSocket(TCP_SOCKET hTCP)
+{
+	BOOL bRetransmit;
+	BOOL bCloseSocket;
+	BYTE vFlags;
+	WORD w;
+
+	SyncTCBStub(hTCP);
+	
+	// Handle any SSL Processing and Message Transmission
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+	{
+		// Handle any periodic tasks, such as RSA operations
+		SSLPeriodic(hTCP, MyTCBStub.sslStubID);
+		
+		// If unsent data is waiting, transmit it as an application record
+		if(MyTCBStub.sslTxHead != MyTCBStub.txHead && TCPSSLGetPendingTxSize(hTCP) != 0u)
+			SSLTxRecord(hTCP, MyTCBStub.sslStubID, SSL_APPLICATION);
+		
+		// If an SSL message is requested, send it now
+		if(MyTCBStub.sslReqMessage != SSL_NO_MESSAGE)
+			SSLTxMessage(hTCP, MyTCBStub.sslStubID, MyTCBStub.sslReqMessage);
+	}
+	#endif
+	
+	vFlags = 0x00;
+	bRetransmit = FALSE;
+	bCloseSocket = FALSE;
+
+	// Transmit ASAP data if the medium is available
+	if(MyTCBStub.Flags.bTXASAP || MyTCBStub.Flags.bTXASAPWithoutTimerReset)
+	{
+		if(MACIsTxReady())
 		{
-			// See if the timeout has occured and delayed ACK needs to be sent
-			if((SHORT)(MyTCBStub.OverlappedTimers.delayedACKTime - (WORD)TickGetDiv256()) <= (SHORT)0)
-				vFlags = ACK;
+			vFlags = ACK;
+			bRetransmit = MyTCBStub.Flags.bTXASAPWithoutTimerReset;
 		}
-		
-		// Process TCP_CLOSE_WAIT timer
-		if(MyTCBStub.smState == TCP_CLOSE_WAIT)
+	}
+
+	// Perform any needed window updates and data transmissions
+	if(MyTCBStub.Flags.bTimer2Enabled)
+	{
+		// See if the timeout has occured, and we need to send a new window update and pending data
+		if((SHORT)(MyTCBStub.eventTime2 - (WORD)TickGetDiv256()) <= (SHORT)0)
+			vFlags = ACK;
+	}
+
+	// Process Delayed ACKnowledgement timer
+	if(MyTCBStub.Flags.bDelayedACKTimerEnabled)
+	{
+		// See if the timeout has occured and delayed ACK needs to be sent
+		if((SHORT)(MyTCBStub.OverlappedTimers.delayedACKTime - (WORD)TickGetDiv256()) <= (SHORT)0)
+			vFlags = ACK;
+	}
+	
+	// Process TCP_CLOSE_WAIT timer
+	if(MyTCBStub.smState == TCP_CLOSE_WAIT)
+	{
+		// Automatically close the socket on our end if the application 
+		// fails to call TCPDisconnect() is a reasonable amount of time.
+		if((SHORT)(MyTCBStub.OverlappedTimers.closeWaitTime - (WORD)TickGetDiv256()) <= (SHORT)0)
 		{
-			// Automatically close the socket on our end if the application 
-			// fails to call TCPDisconnect() is a reasonable amount of time.
-			if((SHORT)(MyTCBStub.OverlappedTimers.closeWaitTime - (WORD)TickGetDiv256()) <= (SHORT)0)
-			{
-				vFlags = FIN | ACK;
-				MyTCBStub.smState = TCP_LAST_ACK;
-			}
+			vFlags = FIN | ACK;
+			MyTCBStub.smState = TCP_LAST_ACK;
 		}
+	}
 
-		// Process listening server sockets that might have a SYN waiting in the SYNQueue[]
-		#if TCP_SYN_QUEUE_MAX_ENTRIES
-			if(MyTCBStub.smState == TCP_LISTEN)
+	// Process listening server sockets that might have a SYN waiting in the SYNQueue[]
+	#if TCP_SYN_QUEUE_MAX_ENTRIES
+		if(MyTCBStub.smState == TCP_LISTEN)
+		{
+			for(w = 0; w < TCP_SYN_QUEUE_MAX_ENTRIES; w++)
 			{
-				for(w = 0; w < TCP_SYN_QUEUE_MAX_ENTRIES; w++)
+				// Abort search if there are no more valid records
+				if(SYNQueue[w].wDestPort == 0u)
+					break;
+				
+				// Stop searching if this SYN queue entry can be used by this socket
+				#if defined(STACK_USE_SSL_SERVER)
+				if(SYNQueue[w].wDestPort == MyTCBStub.remoteHash.Val || SYNQueue[w].wDestPort == MyTCBStub.sslTxHead)
+				#else
+				if(SYNQueue[w].wDestPort == MyTCBStub.remoteHash.Val)
+				#endif
 				{
-					// Abort search if there are no more valid records
-					if(SYNQueue[w].wDestPort == 0u)
-						break;
+					// Set up our socket and generate a reponse SYN+ACK packet
+					SyncTCB();
 					
-					// Stop searching if this SYN queue entry can be used by this socket
 					#if defined(STACK_USE_SSL_SERVER)
-					if(SYNQueue[w].wDestPort == MyTCBStub.remoteHash.Val || SYNQueue[w].wDestPort == MyTCBStub.sslTxHead)
-					#else
-					if(SYNQueue[w].wDestPort == MyTCBStub.remoteHash.Val)
-					#endif
-					{
-						// Set up our socket and generate a reponse SYN+ACK packet
-						SyncTCB();
-						
-						#if defined(STACK_USE_SSL_SERVER)
-						// If this matches the SSL port, make sure that can be configured
-						// before continuing.  If not, break and leave this in the queue
-						if(SYNQueue[w].wDestPort == MyTCBStub.sslTxHead && !TCPStartSSLServer(hTCP))
-							break;
-						#endif
-						
-						memcpy((void*)&MyTCB.remote.niRemoteMACIP, (void*)&SYNQueue[w].niSourceAddress, sizeof(NODE_INFO));
-						MyTCB.remotePort.Val = SYNQueue[w].wSourcePort;
-						MyTCB.RemoteSEQ = SYNQueue[w].dwSourceSEQ + 1;
-						MyTCBStub.remoteHash.Val = (MyTCB.remote.niRemoteMACIP.IPAddr.w[1] + MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val;
-						vFlags = SYN | ACK;
-						MyTCBStub.smState = TCP_SYN_RECEIVED;
-						
-						// Delete this SYN from the SYNQueue and compact the SYNQueue[] array
-						TCPRAMCopy((PTR_BASE)&SYNQueue[w], TCP_PIC_RAM, (PTR_BASE)&SYNQueue[w+1], TCP_PIC_RAM, (TCP_SYN_QUEUE_MAX_ENTRIES-1u-w)*sizeof(TCP_SYN_QUEUE));
-						SYNQueue[TCP_SYN_QUEUE_MAX_ENTRIES-1].wDestPort = 0u;
-	
+					// If this matches the SSL port, make sure that can be configured
+					// before continuing.  If not, break and leave this in the queue
+					if(SYNQueue[w].wDestPort == MyTCBStub.sslTxHead && !TCPStartSSLServer(hTCP))
 						break;
-					}
+					#endif
+					
+					memcpy((void*)&MyTCB.remote.niRemoteMACIP, (void*)&SYNQueue[w].niSourceAddress, sizeof(NODE_INFO));
+					MyTCB.remotePort.Val = SYNQueue[w].wSourcePort;
+					MyTCB.RemoteSEQ = SYNQueue[w].dwSourceSEQ + 1;
+					SetRemoteHash((MyTCB.remote.niRemoteMACIP.IPAddr.w[1] + MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val);
+					vFlags = SYN | ACK;
+					MyTCBStub.smState = TCP_SYN_RECEIVED;
+					
+					// Delete this SYN from the SYNQueue and compact the SYNQueue[] array
+					TCPRAMCopy((PTR_BASE)&SYNQueue[w], TCP_PIC_RAM, (PTR_BASE)&SYNQueue[w+1], TCP_PIC_RAM, (TCP_SYN_QUEUE_MAX_ENTRIES-1u-w)*sizeof(TCP_SYN_QUEUE));
+					SYNQueue[TCP_SYN_QUEUE_MAX_ENTRIES-1].wDestPort = 0u;
+
+					break;
 				}
 			}
-		#endif
+		}
+	#endif
 
-		if(vFlags)
-			SendTCP(vFlags, bRetransmit ? 0 : SENDTCP_RESET_TIMERS);
+	if(vFlags)
+		SendTCP(vFlags, bRetransmit ? 0 : SENDTCP_RESET_TIMERS);
 
-		// The TCP_CLOSED, TCP_LISTEN, and sometimes the TCP_ESTABLISHED 
-		// state don't need any timeout events, so see if the timer is enabled
-		if(!MyTCBStub.Flags.bTimerEnabled)
-		{
-			#if defined(TCP_KEEP_ALIVE_TIMEOUT)
-				// Only the established state has any use for keep-alives
-				if(MyTCBStub.smState == TCP_ESTABLISHED)
+	// The TCP_CLOSED, TCP_LISTEN, and sometimes the TCP_ESTABLISHED 
+	// state don't need any timeout events, so see if the timer is enabled
+	if(!MyTCBStub.Flags.bTimerEnabled)
+	{
+		#if defined(TCP_KEEP_ALIVE_TIMEOUT)
+			// Only the established state has any use for keep-alives
+			if(MyTCBStub.smState == TCP_ESTABLISHED)
+			{
+				// If timeout has not occured, do not do anything.
+				if((LONG)(TickGet() - MyTCBStub.eventTime) < (LONG)0)
+					return;
+	
+				// If timeout has occured and the connection appears to be dead (no 
+				// responses from remote node at all), close the connection so the 
+				// application doesn't sit around indefinitely with a useless socket 
+				// that it thinks is still open
+				if(MyTCBStub.Flags.vUnackedKeepalives == TCP_MAX_UNACKED_KEEP_ALIVES)
 				{
-					// If timeout has not occured, do not do anything.
-					if((LONG)(TickGet() - MyTCBStub.eventTime) < (LONG)0)
-						continue;
-		
-					// If timeout has occured and the connection appears to be dead (no 
-					// responses from remote node at all), close the connection so the 
-					// application doesn't sit around indefinitely with a useless socket 
-					// that it thinks is still open
-					if(MyTCBStub.Flags.vUnackedKeepalives == TCP_MAX_UNACKED_KEEP_ALIVES)
-					{
-						vFlags = MyTCBStub.Flags.bServer;
+					vFlags = MyTCBStub.Flags.bServer;
 
-						// Force an immediate FIN and RST transmission
-						// Double calling TCPDisconnect() will also place us 
-						// back in the listening state immediately if a server socket.
-						TCPDisconnect(hTCP);
-						TCPDisconnect(hTCP);
-						
-						// Prevent client mode sockets from getting reused by other applications.  
-						// The application must call TCPDisconnect() with the handle to free this 
-						// socket (and the handle associated with it)
-						if(!vFlags)
-							MyTCBStub.smState = TCP_CLOSED_BUT_RESERVED;
-						
-						continue;
-					}
+					// Force an immediate FIN and RST transmission
+					// Double calling TCPDisconnect() will also place us 
+					// back in the listening state immediately if a server socket.
+					TCPDisconnect(hTCP);
+					TCPDisconnect(hTCP);
 					
-					// Otherwise, if a timeout occured, simply send a keep-alive packet
-					SyncTCB();
-					SendTCP(ACK, SENDTCP_KEEP_ALIVE);
-					MyTCBStub.eventTime = TickGet() + TCP_KEEP_ALIVE_TIMEOUT;
+					// Prevent client mode sockets from getting reused by other applications.  
+					// The application must call TCPDisconnect() with the handle to free this 
+					// socket (and the handle associated with it)
+					if(!vFlags)
+						MyTCBStub.smState = TCP_CLOSED_BUT_RESERVED;
+					
+					return;
 				}
-			#endif
-			continue;
-		}
+				
+				// Otherwise, if a timeout occured, simply send a keep-alive packet
+				SyncTCB();
+				SendTCP(ACK, SENDTCP_KEEP_ALIVE);
+				MyTCBStub.eventTime = TickGet() + TCP_KEEP_ALIVE_TIMEOUT;
+			}
+		#endif
+		return;
+	}
 
-		// If timeout has not occured, do not do anything.
-		if((LONG)(TickGet() - MyTCBStub.eventTime) < (LONG)0)
-			continue;
+	// If timeout has not occured, do not do anything.
+	if((LONG)(TickGet() - MyTCBStub.eventTime) < (LONG)0)
+		return;
 
-		// Load up extended TCB information
-		SyncTCB();
+	// Load up extended TCB information
+	SyncTCB();
 
-		// A timeout has occured.  Respond to this timeout condition
-		// depending on what state this socket is in.
-		switch(MyTCBStub.smState)
+	// A timeout has occured.  Respond to this timeout condition
+	// depending on what state this socket is in.
+	switch(MyTCBStub.smState)
+	{
+		#if defined(STACK_CLIENT_MODE)
+		#if defined(STACK_USE_DNS)
+		case TCP_GET_DNS_MODULE:
+			if(DNSBeginUsage())
+			{
+				MyTCBStub.smState = TCP_DNS_RESOLVE;
+				if(MyTCB.flags.bRemoteHostIsROM)
+					DNSResolveROM((ROM BYTE*)(ROM_PTR_BASE)MyTCB.remote.dwRemoteHost, DNS_TYPE_A);
+				else
+					DNSResolve((BYTE*)(PTR_BASE)MyTCB.remote.dwRemoteHost, DNS_TYPE_A);
+			}
+			break;
+			
+		case TCP_DNS_RESOLVE:
 		{
-			#if defined(STACK_CLIENT_MODE)
-			#if defined(STACK_USE_DNS)
-			case TCP_GET_DNS_MODULE:
-				if(DNSBeginUsage())
+			IP_ADDR ipResolvedDNSIP;
+
+			// See if DNS resolution has finished.  Note that if the DNS 
+			// fails, the &ipResolvedDNSIP will be written with 0x00000000. 
+			// MyTCB.remote.dwRemoteHost is unioned with 
+			// MyTCB.remote.niRemoteMACIP.IPAddr, so we can't directly write 
+			// the DNS result into MyTCB.remote.niRemoteMACIP.IPAddr.  We 
+			// must copy it over only if the DNS is resolution step was 
+			// successful.
+			if(DNSIsResolved(&ipResolvedDNSIP))
+			{
+				if(DNSEndUsage())
 				{
-					MyTCBStub.smState = TCP_DNS_RESOLVE;
-					if(MyTCB.flags.bRemoteHostIsROM)
-						DNSResolveROM((ROM BYTE*)(ROM_PTR_BASE)MyTCB.remote.dwRemoteHost, DNS_TYPE_A);
-					else
-						DNSResolve((BYTE*)(PTR_BASE)MyTCB.remote.dwRemoteHost, DNS_TYPE_A);
+					MyTCB.remote.niRemoteMACIP.IPAddr.Val = ipResolvedDNSIP.Val;
+					MyTCBStub.smState = TCP_GATEWAY_SEND_ARP;
+					SetRemoteHash((MyTCB.remote.niRemoteMACIP.IPAddr.w[1]+MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val);
+					MyTCB.retryCount = 0;
+					MyTCB.retryInterval = (TICK_SECOND/4)/256;
 				}
-				break;
-				
-			case TCP_DNS_RESOLVE:
-			{
-				IP_ADDR ipResolvedDNSIP;
-
-				// See if DNS resolution has finished.  Note that if the DNS 
-				// fails, the &ipResolvedDNSIP will be written with 0x00000000. 
-				// MyTCB.remote.dwRemoteHost is unioned with 
-				// MyTCB.remote.niRemoteMACIP.IPAddr, so we can't directly write 
-				// the DNS result into MyTCB.remote.niRemoteMACIP.IPAddr.  We 
-				// must copy it over only if the DNS is resolution step was 
-				// successful.
-				if(DNSIsResolved(&ipResolvedDNSIP))
+				else
 				{
-					if(DNSEndUsage())
-					{
-						MyTCB.remote.niRemoteMACIP.IPAddr.Val = ipResolvedDNSIP.Val;
-						MyTCBStub.smState = TCP_GATEWAY_SEND_ARP;
-						MyTCBStub.remoteHash.Val = (MyTCB.remote.niRemoteMACIP.IPAddr.w[1]+MyTCB.remote.niRemoteMACIP.IPAddr.w[0] + MyTCB.remotePort.Val) ^ MyTCB.localPort.Val;
-						MyTCB.retryCount = 0;
-						MyTCB.retryInterval = (TICK_SECOND/4)/256;
-					}
-					else
-					{
-						MyTCBStub.eventTime = TickGet() + 10*TICK_SECOND;
-						MyTCBStub.smState = TCP_GET_DNS_MODULE;
-					}
+					MyTCBStub.eventTime = TickGet() + 10*TICK_SECOND;
+					MyTCBStub.smState = TCP_GET_DNS_MODULE;
 				}
-				break;
 			}
-			#endif // #if defined(STACK_USE_DNS)
-				
-			case TCP_GATEWAY_SEND_ARP:
-				// Obtain the MAC address associated with the server's IP address (either direct MAC address on same subnet, or the MAC address of the Gateway machine)
-				MyTCBStub.eventTime2 = (WORD)TickGetDiv256();
-				ARPResolve(&MyTCB.remote.niRemoteMACIP.IPAddr);
-				MyTCBStub.smState = TCP_GATEWAY_GET_ARP;
-				break;
+			break;
+		}
+		#endif // #if defined(STACK_USE_DNS)
+			
+		case TCP_GATEWAY_SEND_ARP:
+			// Obtain the MAC address associated with the server's IP address (either direct MAC address on same subnet, or the MAC address of the Gateway machine)
+			MyTCBStub.eventTime2 = (WORD)TickGetDiv256();
+			ARPResolve(&MyTCB.remote.niRemoteMACIP.IPAddr);
+			MyTCBStub.smState = TCP_GATEWAY_GET_ARP;
+			break;
 
-			case TCP_GATEWAY_GET_ARP:
-				// Wait for the MAC address to finish being obtained
-				if(!ARPIsResolved(&MyTCB.remote.niRemoteMACIP.IPAddr, &MyTCB.remote.niRemoteMACIP.MACAddr))
+		case TCP_GATEWAY_GET_ARP:
+			// Wait for the MAC address to finish being obtained
+			if(!ARPIsResolved(&MyTCB.remote.niRemoteMACIP.IPAddr, &MyTCB.remote.niRemoteMACIP.MACAddr))
+			{
+				// Time out if too much time is spent in this state
+				// Note that this will continuously send out ARP 
+				// requests for an infinite time if the Gateway 
+				// never responds
+				if((WORD)TickGetDiv256() - MyTCBStub.eventTime2 > (WORD)MyTCB.retryInterval)
 				{
-					// Time out if too much time is spent in this state
-					// Note that this will continuously send out ARP 
-					// requests for an infinite time if the Gateway 
-					// never responds
-					if((WORD)TickGetDiv256() - MyTCBStub.eventTime2 > (WORD)MyTCB.retryInterval)
+					// Exponentially increase timeout until we reach 6 attempts then stay constant
+					if(MyTCB.retryCount < 6u)
 					{
-						// Exponentially increase timeout until we reach 6 attempts then stay constant
-						if(MyTCB.retryCount < 6u)
-						{
-							MyTCB.retryCount++;
-							MyTCB.retryInterval <<= 1;
-						}
-
-						// Retransmit ARP request
-						MyTCBStub.smState = TCP_GATEWAY_SEND_ARP;
+						MyTCB.retryCount++;
+						MyTCB.retryInterval <<= 1;
 					}
-					break;
+
+					// Retransmit ARP request
+					MyTCBStub.smState = TCP_GATEWAY_SEND_ARP;
 				}
-				
-				// Send out SYN connection request to remote node
-				// This automatically disables the Timer from 
-				// continuously firing for this socket
-				vFlags = SYN;
-				bRetransmit = FALSE;
-				MyTCBStub.smState = TCP_SYN_SENT;
 				break;
-			#endif // #if defined(STACK_CLIENT_MODE)
+			}
 			
-			case TCP_SYN_SENT:
-				// Keep sending SYN until we hear from remote node.
-				// This may be for infinite time, in that case
-				// caller must detect it and do something.
-				vFlags = SYN;
-				bRetransmit = TRUE;
+			// Send out SYN connection request to remote node
+			// This automatically disables the Timer from 
+			// continuously firing for this socket
+			vFlags = SYN;
+			bRetransmit = FALSE;
+			MyTCBStub.smState = TCP_SYN_SENT;
+			break;
+		#endif // #if defined(STACK_CLIENT_MODE)
+		
+		case TCP_SYN_SENT:
+			// Keep sending SYN until we hear from remote node.
+			// This may be for infinite time, in that case
+			// caller must detect it and do something.
+			vFlags = SYN;
+			bRetransmit = TRUE;
+
+			// Exponentially increase timeout until we reach TCP_MAX_RETRIES attempts then stay constant
+			if(MyTCB.retryCount >= (TCP_MAX_RETRIES - 1))
+			{
+				MyTCB.retryCount = TCP_MAX_RETRIES - 1;
+				MyTCB.retryInterval = TCP_START_TIMEOUT_VAL<<(TCP_MAX_RETRIES-1);
+			}
+			break;
 
-				// Exponentially increase timeout until we reach TCP_MAX_RETRIES attempts then stay constant
-				if(MyTCB.retryCount >= (TCP_MAX_RETRIES - 1))
-				{
-					MyTCB.retryCount = TCP_MAX_RETRIES - 1;
-					MyTCB.retryInterval = TCP_START_TIMEOUT_VAL<<(TCP_MAX_RETRIES-1);
-				}
-				break;
-	
-			case TCP_SYN_RECEIVED:
-				// We must receive ACK before timeout expires.
-				// If not, resend SYN+ACK.
-				// Abort, if maximum attempts counts are reached.
-				if(MyTCB.retryCount < TCP_MAX_SYN_RETRIES)
-				{
-					vFlags = SYN | ACK;
-					bRetransmit = TRUE;
-				}
-				else
-				{
-					if(MyTCBStub.Flags.bServer)
-					{
-						vFlags = RST | ACK;
-						bCloseSocket = TRUE;
-					}
-					else
-					{
-						vFlags = SYN;
-					}
-				}
-				break;
-	
-			case TCP_ESTABLISHED:
-			case TCP_CLOSE_WAIT:
-				// Retransmit any unacknowledged data
-				if(MyTCB.retryCount < TCP_MAX_RETRIES)
-				{
-					vFlags = ACK;
-					bRetransmit = TRUE;
-				}
-				else
-				{
-					// No response back for too long, close connection
-					// This could happen, for instance, if the communication 
-					// medium was lost
-					MyTCBStub.smState = TCP_FIN_WAIT_1;
-					vFlags = FIN | ACK;
-				}
-				break;
-	
-			case TCP_FIN_WAIT_1:
-				if(MyTCB.retryCount < TCP_MAX_RETRIES)
+		case TCP_SYN_RECEIVED:
+			// We must receive ACK before timeout expires.
+			// If not, resend SYN+ACK.
+			// Abort, if maximum attempts counts are reached.
+			if(MyTCB.retryCount < TCP_MAX_SYN_RETRIES)
+			{
+				vFlags = SYN | ACK;
+				bRetransmit = TRUE;
+			}
+			else
+			{
+				if(MyTCBStub.Flags.bServer)
 				{
-					// Send another FIN
-					vFlags = FIN | ACK;
-					bRetransmit = TRUE;
+					vFlags = RST | ACK;
+					bCloseSocket = TRUE;
 				}
 				else
 				{
-					// Close on our own, we can't seem to communicate 
-					// with the remote node anymore
-					vFlags = RST | ACK;
-					bCloseSocket = TRUE;
+					vFlags = SYN;
 				}
-				break;
-	
-			case TCP_FIN_WAIT_2:
+			}
+			break;
+
+		case TCP_ESTABLISHED:
+		case TCP_CLOSE_WAIT:
+			// Retransmit any unacknowledged data
+			if(MyTCB.retryCount < TCP_MAX_RETRIES)
+			{
+				vFlags = ACK;
+				bRetransmit = TRUE;
+			}
+			else
+			{
+				// No response back for too long, close connection
+				// This could happen, for instance, if the communication 
+				// medium was lost
+				MyTCBStub.smState = TCP_FIN_WAIT_1;
+				vFlags = FIN | ACK;
+			}
+			break;
+
+		case TCP_FIN_WAIT_1:
+			if(MyTCB.retryCount < TCP_MAX_RETRIES)
+			{
+				// Send another FIN
+				vFlags = FIN | ACK;
+				bRetransmit = TRUE;
+			}
+			else
+			{
 				// Close on our own, we can't seem to communicate 
 				// with the remote node anymore
 				vFlags = RST | ACK;
 				bCloseSocket = TRUE;
-				break;
+			}
+			break;
+
+		case TCP_FIN_WAIT_2:
+			// Close on our own, we can't seem to communicate 
+			// with the remote node anymore
+			vFlags = RST | ACK;
+			bCloseSocket = TRUE;
+			break;
+
+		case TCP_CLOSING:
+			if(MyTCB.retryCount < TCP_MAX_RETRIES)
+			{
+				// Send another ACK+FIN (the FIN is retransmitted 
+				// automatically since it hasn't been acknowledged by 
+				// the remote node yet)
+				vFlags = ACK;
+				bRetransmit = TRUE;
+			}
+			else
+			{
+				// Close on our own, we can't seem to communicate 
+				// with the remote node anymore
+				vFlags = RST | ACK;
+				bCloseSocket = TRUE;
+			}
+			break;
 
-			case TCP_CLOSING:
-				if(MyTCB.retryCount < TCP_MAX_RETRIES)
-				{
-					// Send another ACK+FIN (the FIN is retransmitted 
-					// automatically since it hasn't been acknowledged by 
-					// the remote node yet)
-					vFlags = ACK;
-					bRetransmit = TRUE;
-				}
-				else
-				{
-					// Close on our own, we can't seem to communicate 
-					// with the remote node anymore
-					vFlags = RST | ACK;
-					bCloseSocket = TRUE;
-				}
-				break;
-	
 //			case TCP_TIME_WAIT:
 //				// Wait around for a while (2MSL) and then goto closed state
 //				bCloseSocket = TRUE;
 //				break;
 //			
 
-			case TCP_LAST_ACK:
-				// Send some more FINs or close anyway
-				if(MyTCB.retryCount < TCP_MAX_RETRIES)
-				{
-					vFlags = FIN | ACK;
-					bRetransmit = TRUE;
-				}
-				else
-				{
-					vFlags = RST | ACK;
-					bCloseSocket = TRUE;
-				}
-				break;
-			
-			default:
-				break;
-		}
-
-		if(vFlags)
-		{
-			// Transmit all unacknowledged data over again
-			if(bRetransmit)
+		case TCP_LAST_ACK:
+			// Send some more FINs or close anyway
+			if(MyTCB.retryCount < TCP_MAX_RETRIES)
 			{
-				// Set the appropriate retry time
-				MyTCB.retryCount++;
-				MyTCB.retryInterval <<= 1;
-		
-				// Calculate how many bytes we have to roll back and retransmit
-				w = MyTCB.txUnackedTail - MyTCBStub.txTail;
-				if(MyTCB.txUnackedTail < MyTCBStub.txTail)
-					w += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
-				
-				// Perform roll back of local SEQuence counter, remote window 
-				// adjustment, and cause all unacknowledged data to be 
-				// retransmitted by moving the unacked tail pointer.
-				MyTCB.MySEQ -= w;
-				MyTCB.remoteWindow += w;
-				MyTCB.txUnackedTail = MyTCBStub.txTail;		
-				SendTCP(vFlags, 0);
+				vFlags = FIN | ACK;
+				bRetransmit = TRUE;
 			}
 			else
-				SendTCP(vFlags, SENDTCP_RESET_TIMERS);
-
-		}
+			{
+				vFlags = RST | ACK;
+				bCloseSocket = TRUE;
+			}
+			break;
 		
-		if(bCloseSocket)
-			CloseSocket();
+		default:
+			break;
 	}
-	
-	
-	#if TCP_SYN_QUEUE_MAX_ENTRIES
-		// Process SYN Queue entry timeouts
-		for(w = 0; w < TCP_SYN_QUEUE_MAX_ENTRIES; w++)
+
+	if(vFlags)
+	{
+		// Transmit all unacknowledged data over again
+		if(bRetransmit)
 		{
-			// Abort search if there are no more valid records
-			if(SYNQueue[w].wDestPort == 0u)
-				break;
-			
-			// See if this SYN has timed out
-			if((WORD)TickGetDiv256() - SYNQueue[w].wTimestamp > (WORD)(TCP_SYN_QUEUE_TIMEOUT/256ull))
-			{
-				// Delete this SYN from the SYNQueue and compact the SYNQueue[] array
-				TCPRAMCopy((PTR_BASE)&SYNQueue[w], TCP_PIC_RAM, (PTR_BASE)&SYNQueue[w+1], TCP_PIC_RAM, (TCP_SYN_QUEUE_MAX_ENTRIES-1u-w)*sizeof(TCP_SYN_QUEUE));
-				SYNQueue[TCP_SYN_QUEUE_MAX_ENTRIES-1].wDestPort = 0u;
+			// Set the appropriate retry time
+			MyTCB.retryCount++;
+			MyTCB.retryInterval <<= 1;
+			MyTCB.wRetransmits++;
+
+			// Karn's rule: ACKs for retransmitted data are ambiguous, 
+			// so no round trip time samples until they are all ACKed.
+			// Loss recovery by timeout also ends any fast recovery.
+			MyTCB.flags.bRTTTiming = 0;
+			MyTCB.flags.bRetransmitted = 1;
+			MyTCB.flags.bFastRecovery = 0;
+			MyTCB.flags.vDupACKs = 0;
 	
-				// Since we deleted an entry, we need to roll back one 
-				// index so next loop will process the correct record
-				w--;	
-			}
+			// Calculate how many bytes we have to roll back and retransmit
+			w = MyTCB.txUnackedTail - MyTCBStub.txTail;
+			if(MyTCB.txUnackedTail < MyTCBStub.txTail)
+				w += MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+			
+			// Perform roll back of local SEQuence counter, remote window 
+			// adjustment, and cause all unacknowledged data to be 
+			// retransmitted by moving the unacked tail pointer.
+			MyTCB.MySEQ -= w;
+			MyTCB.remoteWindow += w;
+			MyTCB.txUnackedTail = MyTCBStub.txTail;		
+			SendTCP(vFlags, 0);
 		}
+		else
+			SendTCP(vFlags, SENDTCP_RESET_TIMERS);
+
+	}
+	
+	if(bCloseSocket)
+		CloseSocket();
+}
+
+/*****************************************************************************
+  Function:
+	static void ScheduleSocket(TCP_SOCKET hTCP)
+
+  Summary:
+	Decides when TCPTick() next has to look at a socket.
+
+  Description:
+	Finds the earliest of the socket's running timers.  If it is already 
+	due, or the socket has data to transmit ASAP or an SSL session, the 
+	socket stays woken for the next TCPTick() call.  Otherwise 
+	dwNextTCPScan is moved up to the deadline if it is earlier.  A socket 
+	with no timers running sleeps until something wakes it.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to schedule
+
+  Returns:
+	None
+  ***************************************************************************/
+static void ScheduleSocket(TCP_SOCKET hTCP)
+{
+	DWORD dwNow;
+	LONG lDelay;
+	SHORT sDelay;
+
+	SyncTCBStub(hTCP);
+	dwNow = TickGet();
+	lDelay = (LONG)(dwNextTCPScan - dwNow);
+
+	#if defined(STACK_USE_SSL)
+	if(MyTCBStub.sslStubID != SSL_INVALID_ID)
+		lDelay = 0;
 	#endif
+	if(MyTCBStub.Flags.bTXASAP || MyTCBStub.Flags.bTXASAPWithoutTimerReset)
+		lDelay = 0;
+
+	// The short timers count in TickGetDiv256() units
+	if(MyTCBStub.Flags.bTimer2Enabled)
+	{
+		sDelay = (SHORT)(MyTCBStub.eventTime2 - (WORD)TickGetDiv256());
+		if((LONG)sDelay*256 < lDelay)
+			lDelay = (LONG)sDelay*256;
+	}
+	if(MyTCBStub.Flags.bDelayedACKTimerEnabled)
+	{
+		sDelay = (SHORT)(MyTCBStub.OverlappedTimers.delayedACKTime - (WORD)TickGetDiv256());
+		if((LONG)sDelay*256 < lDelay)
+			lDelay = (LONG)sDelay*256;
+	}
+	if(MyTCBStub.smState == TCP_CLOSE_WAIT)
+	{
+		sDelay = (SHORT)(MyTCBStub.OverlappedTimers.closeWaitTime - (WORD)TickGetDiv256());
+		if((LONG)sDelay*256 < lDelay)
+			lDelay = (LONG)sDelay*256;
+	}
+
+	#if defined(TCP_KEEP_ALIVE_TIMEOUT)
+	if(MyTCBStub.Flags.bTimerEnabled || (MyTCBStub.smState == TCP_ESTABLISHED))
+	#else
+	if(MyTCBStub.Flags.bTimerEnabled)
+	#endif
+	{
+		if((LONG)(MyTCBStub.eventTime - dwNow) < lDelay)
+			lDelay = (LONG)(MyTCBStub.eventTime - dwNow);
+	}
+
+	if(lDelay <= 0)
+		TCPWake(hTCP);
+	else
+		dwNextTCPScan = dwNow + lDelay;
 }
 
 
@@ -2868,8 +3555,15 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 	TCP_OPTIONS     options;
 	PSEUDO_HEADER   pseudoHeader;
 	WORD 			len;
+	WORD			wDataLen;
+	#if defined(MAC_COPY_CHECKSUM)
+	BYTE			vDMAPieces = 0;		// payload pieces the DMA engine is copying and summing
+	WORD			wFirstLen = 0;		// length of the first of two pieces
+	WORD			wFirstChecksum = 0;	// and its checksum
+	#endif
 
 	SyncTCB();
+	TCPWake(hCurrentTCP);
 
 	// FINs must be handled specially
 	if(vTCPFlags & FIN)
@@ -2944,7 +3638,17 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 				MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
 			}
 
-			// Copy application data into the raw TX buffer
+			// Copy application data into the raw TX buffer.  From Ethernet 
+			// RAM the DMA engine copies and sums it while the headers are 
+			// built below.
+			#if defined(MAC_COPY_CHECKSUM)
+			if(len && MyTCBStub.vMemoryMedium == TCP_ETH_RAM)
+			{
+				MACMemCopyChecksumAsync(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER), MyTCB.txUnackedTail, len);
+				vDMAPieces = 1;
+			}
+			else
+			#endif
 			TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER), TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, len);
 			MyTCB.txUnackedTail += len;
 		}
@@ -2965,14 +3669,34 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 			if(pseudoHeader.Length > len)
 				pseudoHeader.Length = len;
 
-			// Copy application data into the raw TX buffer
-			TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER), TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
-			pseudoHeader.Length = len - pseudoHeader.Length;
-	
-			// Copy any left over chunks of application data over
-			if(pseudoHeader.Length)
+			#if defined(MAC_COPY_CHECKSUM)
+			if(len && MyTCBStub.vMemoryMedium == TCP_ETH_RAM)
+			{
+				// Same as below on the DMA engine.  It keeps one checksum, 
+				// so the second piece can only start once the first is 
+				// done; the second then overlaps the header work.
+				wFirstLen = pseudoHeader.Length;
+				MACMemCopyChecksumAsync(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER), MyTCB.txUnackedTail, wFirstLen);
+				vDMAPieces = 1;
+				if(len - wFirstLen)
+				{
+					wFirstChecksum = MACGetMemCopyChecksum();
+					MACMemCopyChecksumAsync(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+wFirstLen, MyTCBStub.bufferTxStart, len - wFirstLen);
+					vDMAPieces = 2;
+				}
+			}
+			else
+			#endif
 			{
-				TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+(MyTCBStub.bufferRxStart-MyTCB.txUnackedTail), TCP_ETH_RAM, MyTCBStub.bufferTxStart, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
+				// Copy application data into the raw TX buffer
+				TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER), TCP_ETH_RAM, MyTCB.txUnackedTail, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
+				pseudoHeader.Length = len - pseudoHeader.Length;
+		
+				// Copy any left over chunks of application data over
+				if(pseudoHeader.Length)
+				{
+					TCPRAMCopy(BASE_TX_ADDR+sizeof(ETHER_HEADER)+sizeof(IP_HEADER)+sizeof(TCP_HEADER)+(MyTCBStub.bufferRxStart-MyTCB.txUnackedTail), TCP_ETH_RAM, MyTCBStub.bufferTxStart, MyTCBStub.vMemoryMedium, pseudoHeader.Length);
+				}
 			}
 
 			MyTCB.txUnackedTail += len;
@@ -3002,12 +3726,23 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 		if(len)
 			vTCPFlags |= PSH;
 
-		if(vSendFlags & SENDTCP_RESET_TIMERS)
+		// New data does not undo the backoff while retransmitted data is 
+		// still unACKed, or sending the rest of the window after a timeout 
+		// would start the next one from the RTO again
+		if((vSendFlags & SENDTCP_RESET_TIMERS) && !MyTCB.flags.bRetransmitted)
 		{
 			MyTCB.retryCount = 0;
-			MyTCB.retryInterval = TCP_START_TIMEOUT_VAL;
+			MyTCB.retryInterval = MyTCB.dwRTO;
 		}	
 
+		// Time one segment per round trip, never a retransmitted one
+		if(len && !MyTCB.flags.bRTTTiming && !MyTCB.flags.bRetransmitted)
+		{
+			MyTCB.dwRTTSEQ = MyTCB.MySEQ + len;
+			MyTCB.dwRTTStart = TickGet();
+			MyTCB.flags.bRTTTiming = 1;
+		}
+
 		MyTCBStub.eventTime = TickGet() + MyTCB.retryInterval;
 		MyTCBStub.Flags.bTimerEnabled = 1;
 	}
@@ -3020,12 +3755,14 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 		MyTCB.MySEQ -= 1;
 		len = 1;
 	}
-	else if(MyTCBStub.Flags.bTimerEnabled) 
+	else if(MyTCBStub.Flags.bTimerEnabled && (MyTCB.remoteWindow == 0u)) 
 	{
 		// If we have data to transmit, but the remote RX window is zero, 
 		// so we aren't transmitting any right now then make sure to not 
 		// extend the retry counter or timer.  This will stall our TX 
-		// with a periodic ACK sent to the remote node.
+		// with a periodic ACK sent to the remote node.  Any other pure 
+		// ACK, a delayed one or a window update, leaves the timer alone 
+		// or it would keep lost data from ever being retransmitted.
 		if(!(vSendFlags & SENDTCP_RESET_TIMERS))
 		{
 			// Roll back retry counters since we can't send anything, 
@@ -3040,6 +3777,8 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 		MyTCBStub.eventTime = TickGet() + MyTCB.retryInterval;
 	}
 	
+	// Bytes after the TCP header, keep-alive byte included
+	wDataLen = len;
 
 	header.SourcePort			= MyTCB.localPort.Val;
 	header.DestPort				= MyTCB.remotePort.Val;
@@ -3086,10 +3825,10 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 	else
 		header.Window = MyTCBStub.rxTail - MyTCBStub.rxHead - 1;
 
-	// Calculate the amount of free space in the MAC RX buffer area and adjust window if needed
-	wVal.Val = MACGetFreeRxSize()-64;
-	if((SHORT)wVal.Val < (SHORT)0)
-		wVal.Val = 0;
+	// Calculate the amount of free space in the MAC RX buffer area and adjust window if needed.
+	// Compared unsigned, a MAC with more than 32 KB free would otherwise close the window.
+	wVal.Val = MACGetFreeRxSize();
+	wVal.Val = (wVal.Val > 64u) ? wVal.Val - 64u : 0u;
 	// Force the remote node to throttle back if we are running low on general RX buffer space
 	if(header.Window > wVal.Val)
 		header.Window = wVal.Val;
@@ -3129,9 +3868,31 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 	if(vTCPFlags & SYN)
 		MACPutArray((BYTE*)&options, sizeof(options));
 
-	// Update the TCP checksum
-	MACSetReadPtr(BASE_TX_ADDR + sizeof(ETHER_HEADER) + sizeof(IP_HEADER));
-	wVal.Val = CalcIPBufferChecksum(len);
+	// Update the TCP checksum.  Without payload, or with the DMA engine 
+	// having summed it, the headers are summed in RAM rather than read 
+	// back from the MAC.
+	#if defined(MAC_COPY_CHECKSUM)
+	if(vDMAPieces || wDataLen == 0u)
+	#else
+	if(wDataLen == 0u)
+	#endif
+	{
+		wVal.Val = CalcIPChecksum((BYTE*)&header, sizeof(header));
+		if(vTCPFlags & SYN)
+			wVal.Val = AddIPChecksum(wVal.Val, CalcIPChecksum((BYTE*)&options, sizeof(options)), FALSE);
+
+		#if defined(MAC_COPY_CHECKSUM)
+		if(vDMAPieces == 2u)
+			wVal.Val = AddIPChecksum(wVal.Val, wFirstChecksum, FALSE);
+		if(vDMAPieces)
+			wVal.Val = AddIPChecksum(wVal.Val, MACGetMemCopyChecksum(), (vDMAPieces == 2u) && (wFirstLen & 0x1u));
+		#endif
+	}
+	else
+	{
+		MACSetReadPtr(BASE_TX_ADDR + sizeof(ETHER_HEADER) + sizeof(IP_HEADER));
+		wVal.Val = CalcIPBufferChecksum(len);
+	}
 #if defined(DEBUG_GENERATE_TX_LOSS)
 	// Damage TCP checksums on TX packets randomly
 	if(LFSRRand() > DEBUG_GENERATE_TX_LOSS)
@@ -3155,7 +3916,9 @@ static void SendTCP(BYTE vTCPFlags, BYTE vSendFlags)
 
   Description:
 	This function searches through the sockets and attempts to match one with
-	a given TCP header and NODE_INFO structure.  If a socket is found, its 
+	a given TCP header and NODE_INFO structure.  Only the sockets on the
+	lookup index bucket for the segment's hash (or, for listening sockets,
+	its destination port) are examined.  If a socket is found, its 
 	index is saved in hCurrentTCP and the associated MyTCBStub and MyTCB are
 	loaded. Otherwise, INVALID_SOCKET is placed in hCurrentTCP.
 	
@@ -3183,30 +3946,16 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 	partialMatch = INVALID_SOCKET;
 	hash = (remote->IPAddr.w[1]+remote->IPAddr.w[0] + h->SourcePort) ^ h->DestPort;
 
-	// Loop through all sockets looking for a socket that is expecting this 
-	// packet or can handle it.
-	for(hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++ )
+	// Look for a connected socket that is expecting this packet.  Only the
+	// sockets chained on this hash's bucket can match.
+	for(hTCP = TCBHashHeads[TCP_HASH_BUCKET(hash)]; hTCP != INVALID_SOCKET; hTCP = TCBHashNext[hTCP])
 	{
 		SyncTCBStub(hTCP);
 
-		if(MyTCBStub.smState == TCP_CLOSED)
+		if(MyTCBStub.smState == TCP_CLOSED || MyTCBStub.smState == TCP_LISTEN)
 		{
 			continue;
 		}
-		else if(MyTCBStub.smState == TCP_LISTEN)
-		{// For listening ports, check if this is the correct port
-			if(MyTCBStub.remoteHash.Val == h->DestPort)
-				partialMatch = hTCP;
-			
-			#if defined(STACK_USE_SSL_SERVER)
-			// Check the SSL port as well for SSL Servers
-			// 0 is defined as an invalid port number
-			if(MyTCBStub.sslTxHead == h->DestPort)
-				partialMatch = hTCP;
-			#endif
-			
-			continue;
-		}
 		else if(MyTCBStub.remoteHash.Val != hash)
 		{// Ignore if the hash doesn't match
 			continue;
@@ -3221,6 +3970,32 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 		}
 	}
 
+	// Listening sockets keep their local port in remoteHash, so they are
+	// chained on the port's bucket.
+	for(hTCP = TCBHashHeads[TCP_HASH_BUCKET(h->DestPort)]; hTCP != INVALID_SOCKET; hTCP = TCBHashNext[hTCP])
+	{
+		SyncTCBStub(hTCP);
+
+		if(MyTCBStub.smState == TCP_LISTEN && MyTCBStub.remoteHash.Val == h->DestPort)
+			partialMatch = hTCP;
+	}
+
+	#if defined(STACK_USE_SSL_SERVER)
+	// Check the SSL port as well for SSL Servers.  It is kept in sslTxHead,
+	// which is not indexed, so these still need a scan.
+	// 0 is defined as an invalid port number
+	if(partialMatch == INVALID_SOCKET)
+	{
+		for(hTCP = 0; hTCP < TCP_SOCKET_COUNT; hTCP++ )
+		{
+			SyncTCBStub(hTCP);
+
+			if(MyTCBStub.smState == TCP_LISTEN && MyTCBStub.sslTxHead == h->DestPort)
+				partialMatch = hTCP;
+		}
+	}
+	#endif
+
 
 	// If there is a partial match, then a listening socket is currently 
 	// available.  Set up the extended TCB with the info needed 
@@ -3247,7 +4022,7 @@ static BOOL FindMatchingSocket(TCP_HEADER* h, NODE_INFO* remote)
 		// and add to the SYN queue.
 		if(partialMatch != INVALID_SOCKET)
 		{
-			MyTCBStub.remoteHash.Val = hash;
+			SetRemoteHash(hash);
 		
 			memcpy((void*)&MyTCB.remote, (void*)remote, sizeof(NODE_INFO));
 			MyTCB.remotePort.Val = h->SourcePort;
@@ -3388,8 +4163,10 @@ static void SwapTCPHeader(TCP_HEADER* header)
 static void CloseSocket(void)
 {
 	SyncTCB();
+	TCPWake(hCurrentTCP);
+	TCPPostEvent(TCP_EVENT_CLOSED);
 
-	MyTCBStub.remoteHash.Val = MyTCB.localPort.Val;
+	SetRemoteHash(MyTCB.localPort.Val);
 	MyTCBStub.txHead = MyTCBStub.bufferTxStart;
 	MyTCBStub.txTail = MyTCBStub.bufferTxStart;
 	MyTCBStub.rxHead = MyTCBStub.bufferRxStart;
@@ -3403,6 +4180,7 @@ static void CloseSocket(void)
 	MyTCBStub.Flags.bHalfFullFlush = 0;
 	MyTCBStub.Flags.bTXASAP = 0;
 	MyTCBStub.Flags.bTXASAPWithoutTimerReset = 0;
+	MyTCBStub.Flags.bCorked = 0;
 	MyTCBStub.Flags.bTXFIN = 0;
 	MyTCBStub.Flags.bSocketReset = 1;
 
@@ -3414,7 +4192,7 @@ static void CloseSocket(void)
 		MyTCBStub.sslStubID = SSL_INVALID_ID;
 
 		// Swap the SSL port and local port back to proper values
-		MyTCBStub.remoteHash.Val = MyTCB.localSSLPort.Val;
+		SetRemoteHash(MyTCB.localSSLPort.Val);
 		MyTCB.localSSLPort.Val = MyTCB.localPort.Val;
 		MyTCB.localPort.Val = MyTCBStub.remoteHash.Val;
 	}
@@ -3430,8 +4208,15 @@ static void CloseSocket(void)
 
 	MyTCB.flags.bFINSent = 0;
 	MyTCB.flags.bSYNSent = 0;
-	MyTCB.flags.bRXNoneACKed1 = 0;
-	MyTCB.flags.bRXNoneACKed2 = 0;
+	MyTCB.flags.vDupACKs = 0;
+	MyTCB.flags.bFastRecovery = 0;
+	MyTCB.flags.bRTTTiming = 0;
+	MyTCB.flags.bRetransmitted = 0;
+	MyTCB.dwSRTT = 0;
+	MyTCB.dwRTTVAR = 0;
+	MyTCB.dwRTO = TCP_START_TIMEOUT_VAL;
+	MyTCB.wRetransmits = 0;
+	MyTCB.wFastRetransmits = 0;
 	MyTCB.txUnackedTail = MyTCBStub.bufferTxStart;
 	((DWORD_VAL*)(&MyTCB.MySEQ))->w[0] = LFSRRand();
 	((DWORD_VAL*)(&MyTCB.MySEQ))->w[1] = LFSRRand();
@@ -3440,6 +4225,58 @@ static void CloseSocket(void)
 }
 
 
+/*****************************************************************************
+  Function:
+	static void UpdateRTO(DWORD dwSample)
+
+  Summary:
+	Folds a round trip time sample into the retransmission timeout.
+
+  Description:
+	Jacobson/Karels estimator as given in RFC 6298.  dwSRTT is kept scaled 
+	by 8 and dwRTTVAR by 4 so the 1/8 and 1/4 gains are shifts:
+	RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R, and 
+	RTO = SRTT + 4 RTTVAR, clamped to TCP_MIN_TIMEOUT_VAL and 
+	TCP_MAX_TIMEOUT_VAL.
+
+  Precondition:
+	MyTCB is loaded.  The sample is for a segment that was not 
+	retransmitted (Karn's rule).
+
+  Parameters:
+	dwSample - Measured round trip time, in ticks
+
+  Returns:
+	None
+  ***************************************************************************/
+static void UpdateRTO(DWORD dwSample)
+{
+	LONG lErr;
+
+	if(MyTCB.dwSRTT == 0u)
+	{
+		// First measurement
+		MyTCB.dwSRTT = dwSample << 3;
+		MyTCB.dwRTTVAR = dwSample << 1;
+	}
+	else
+	{
+		lErr = (LONG)dwSample - (LONG)(MyTCB.dwSRTT >> 3);
+		MyTCB.dwSRTT += lErr;
+		if(lErr < 0)
+			lErr = -lErr;
+		lErr -= (LONG)(MyTCB.dwRTTVAR >> 2);
+		MyTCB.dwRTTVAR += lErr;
+	}
+
+	MyTCB.dwRTO = (MyTCB.dwSRTT >> 3) + MyTCB.dwRTTVAR;
+	if(MyTCB.dwRTO < TCP_MIN_TIMEOUT_VAL)
+		MyTCB.dwRTO = TCP_MIN_TIMEOUT_VAL;
+	else if(MyTCB.dwRTO > TCP_MAX_TIMEOUT_VAL)
+		MyTCB.dwRTO = TCP_MAX_TIMEOUT_VAL;
+}
+
+
 /*****************************************************************************
   Function:
 	static WORD GetMaxSegSizeOption(void)
@@ -3582,6 +4419,9 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 	localAckNumber = h->AckNumber;
 	localSeqNumber = h->SeqNumber;
 
+	// Timers and state may change below; have TCPTick() look at this socket
+	TCPWake(hCurrentTCP);
+
 	// We received a packet, reset the keep alive timer and count
 	#if defined(TCP_KEEP_ALIVE_TIMEOUT)
 		MyTCBStub.Flags.vUnackedKeepalives = 0;
@@ -3643,9 +4483,13 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 			// This is out of order because this stack has no API for 
 			// notifying the application that the connection seems to 
 			// be failing.  Instead, the application must time out and 
-			// the stack will just keep trying in the mean time.
+			// the stack will just keep trying in the mean time.  An 
+			// event handler is told, in case it wants to give up early.
 			if(localHeaderFlags & RST)
+			{
+				TCPPostEvent(TCP_EVENT_RESET);
 				return;
+			}
 
 			// First: check ACK bit
 			if(localHeaderFlags & ACK)
@@ -3679,6 +4523,7 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 				{
 					SendTCP(ACK, SENDTCP_RESET_TIMERS);
 					MyTCBStub.smState = TCP_ESTABLISHED;
+					TCPPostEvent(TCP_EVENT_CONNECTED);
 					// Set up keep-alive timer
 					#if defined(TCP_KEEP_ALIVE_TIMEOUT)
 						MyTCBStub.eventTime = TickGet() + TCP_KEEP_ALIVE_TIMEOUT;
@@ -3758,6 +4603,19 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 	
 	if(!bSegmentAcceptable)
 	{
+		// After a simultaneous close each end retransmits its FIN, now 
+		// behind the other's RCV.NXT, with an ACK of the other's FIN.  
+		// That ACK is all we are waiting for; answering the duplicate 
+		// with our own FIN again instead would have the two ends echo 
+		// FINs at each other for good.
+		if(((MyTCBStub.smState == TCP_CLOSING) || (MyTCBStub.smState == TCP_LAST_ACK)) &&
+			(localHeaderFlags & ACK) && (MyTCB.MySEQ == localAckNumber) &&
+			(lMissingBytes + (LONG)wSegmentLength <= (LONG)0))
+		{
+			CloseSocket();
+			return;
+		}
+
 		// Unacceptable segment, drop it and respond appropriately
 		if(!(localHeaderFlags & RST)) 
 			SendTCP(ACK, SENDTCP_RESET_TIMERS);
@@ -3775,6 +4633,7 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 	// combine this second and fourth step into a single operation.
 	if(localHeaderFlags & (RST | SYN))
 	{
+		TCPPostEvent(TCP_EVENT_RESET);
 		CloseSocket();
 		return;
 	}
@@ -3804,6 +4663,7 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 				return;
 			}
 			MyTCBStub.smState = TCP_ESTABLISHED;
+			TCPPostEvent(TCP_EVENT_CONNECTED);
 			// No break
 
 		case TCP_ESTABLISHED:
@@ -3834,9 +4694,27 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 			dwTemp = localAckNumber - dwTemp;
 			if(((LONG)(dwTemp) > (LONG)0) && (dwTemp <= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart))
 			{
-				MyTCB.flags.bRXNoneACKed1 = 0;
-				MyTCB.flags.bRXNoneACKed2 = 0;
+				MyTCB.flags.vDupACKs = 0;
 				MyTCBStub.Flags.bHalfFullFlush = FALSE;
+
+				// The link works, a loss that takes several timeouts to 
+				// recover from must not use up TCP_MAX_RETRIES
+				MyTCB.retryCount = 0;
+				MyTCB.retryInterval = MyTCB.dwRTO;
+
+				// Take a round trip time sample if the timed segment is now ACKed
+				if(MyTCB.flags.bRTTTiming && ((LONG)(localAckNumber - MyTCB.dwRTTSEQ) >= (LONG)0))
+				{
+					MyTCB.flags.bRTTTiming = 0;
+					UpdateRTO(TickGet() - MyTCB.dwRTTStart);
+				}
+
+				// Fast recovery ends once everything sent before the fast 
+				// retransmit is ACKed.  ACKs short of that point (partial 
+				// ACKs) are covered by the go-back-N resend already in 
+				// progress.
+				if(MyTCB.flags.bFastRecovery && ((LONG)(localAckNumber - MyTCB.dwRecoverSEQ) >= (LONG)0))
+					MyTCB.flags.bFastRecovery = 0;
 	
 				// Bytes ACKed, free up the TX FIFO space
 				wTemp = MyTCBStub.txTail;
@@ -3862,27 +4740,41 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 					MyTCBStub.txTail -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
 				if(MyTCB.txUnackedTail >= MyTCBStub.bufferRxStart)
 					MyTCB.txUnackedTail -= MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart;
+
+				// Once all retransmitted data is ACKed, new segments may be timed again
+				if(MyTCB.txUnackedTail == MyTCBStub.txTail)
+					MyTCB.flags.bRetransmitted = 0;
+
+				TCPPostEvent(TCP_EVENT_TX);
 			}
-			else
+			else if((dwTemp == 0u) && (wSegmentLength == 0u))
 			{
-				// See if we have outstanding TX data that is waiting for an ACK
+				// A duplicate ACK: nothing new ACKed and no data, SYN or FIN 
+				// carried, while we have outstanding TX data waiting for an ACK
 				if(MyTCBStub.txTail != MyTCB.txUnackedTail)
 				{
-					if(MyTCB.flags.bRXNoneACKed1)
+					if(MyTCB.flags.vDupACKs < 3u)
+						MyTCB.flags.vDupACKs++;
+
+					// Third duplicate ACK: the segment at txTail was most likely 
+					// lost.  Retransmit now instead of waiting for the timer.  
+					// Further duplicate ACKs for the same loss are ignored until 
+					// the recovery point is ACKed.
+					if((MyTCB.flags.vDupACKs == 3u) && !MyTCB.flags.bFastRecovery)
 					{
-						if(MyTCB.flags.bRXNoneACKed2)
-						{
-							// Set up to perform a fast retransmission
-							// Roll back unacknowledged TX tail pointer to cause retransmit to occur
-							MyTCB.MySEQ -= (LONG)(SHORT)(MyTCB.txUnackedTail - MyTCBStub.txTail);
-							if(MyTCB.txUnackedTail < MyTCBStub.txTail)
-								MyTCB.MySEQ -= (LONG)(SHORT)(MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart);
-							MyTCB.txUnackedTail = MyTCBStub.txTail;
-							MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
-						}
-						MyTCB.flags.bRXNoneACKed2 = 1;
+						MyTCB.flags.bFastRecovery = 1;
+						MyTCB.dwRecoverSEQ = MyTCB.MySEQ;
+						MyTCB.wFastRetransmits++;
+						MyTCB.flags.bRTTTiming = 0;
+						MyTCB.flags.bRetransmitted = 1;
+
+						// Roll back unacknowledged TX tail pointer to cause retransmit to occur
+						MyTCB.MySEQ -= (LONG)(SHORT)(MyTCB.txUnackedTail - MyTCBStub.txTail);
+						if(MyTCB.txUnackedTail < MyTCBStub.txTail)
+							MyTCB.MySEQ -= (LONG)(SHORT)(MyTCBStub.bufferRxStart - MyTCBStub.bufferTxStart);
+						MyTCB.txUnackedTail = MyTCBStub.txTail;
+						MyTCBStub.Flags.bTXASAPWithoutTimerReset = 1;
 					}
-					MyTCB.flags.bRXNoneACKed1 = 1;
 				}
 			}
 
@@ -4041,6 +4933,8 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 				TCPRAMCopy(MyTCBStub.rxHead, MyTCBStub.vMemoryMedium, (PTR_BASE)-1, TCP_ETH_RAM, len);
 				MyTCBStub.rxHead += len;
 			}
+			if(len)
+				TCPPostEvent(TCP_EVENT_RX);
 		
 			// See if we have a hole and other data waiting already in the RX FIFO
 			if(MyTCB.sHoleSize != -1)
@@ -4191,6 +5085,7 @@ static void HandleTCPSeg(TCP_HEADER* h, WORD len)
 				case TCP_ESTABLISHED:
 					// Go to TCP_CLOSE_WAIT state
 					MyTCBStub.smState = TCP_CLOSE_WAIT;
+					TCPPostEvent(TCP_EVENT_CLOSED);
 					
 					// For legacy applications that don't call 
 					// TCPDisconnect() as needed and expect the TCP/IP 
@@ -4723,6 +5618,7 @@ BOOL TCPStartSSLClient(TCP_SOCKET hTCP, BYTE* host)
 	
 	// Try to start the session
 	MyTCBStub.sslStubID = SSLStartSession(hTCP, NULL, 0);
+	TCPWake(hTCP);
 	
 	// Make sure a session stub was obtained
 	if(MyTCBStub.sslStubID == SSL_INVALID_ID)
@@ -4782,6 +5678,7 @@ BOOL TCPStartSSLClientEx(TCP_SOCKET hTCP, BYTE* host, void * buffer, BYTE suppDa
 	
 	// Try to start the session
 	MyTCBStub.sslStubID = SSLStartSession(hTCP, buffer, suppDataType);
+	TCPWake(hTCP);
 	
 	// Make sure a session stub was obtained
 	if(MyTCBStub.sslStubID == SSL_INVALID_ID)
@@ -4836,13 +5733,14 @@ BOOL TCPStartSSLServer(TCP_SOCKET hTCP)
 	
 	// Try to start the session
 	MyTCBStub.sslStubID = SSLStartSession(hTCP, NULL, 0);
+	TCPWake(hTCP);
 	
 	// Make sure a session stub was obtained
 	if(MyTCBStub.sslStubID == SSL_INVALID_ID)
 		return FALSE;
 
 	// Swap the localPort and localSSLPort
-	MyTCBStub.remoteHash.Val = MyTCB.localPort.Val;
+	SetRemoteHash(MyTCB.localPort.Val);
 	MyTCB.localPort.Val = MyTCB.localSSLPort.Val;
 	MyTCB.localSSLPort.Val = MyTCBStub.remoteHash.Val;	
 
@@ -5513,4 +6411,43 @@ void GetTcpSocketEndPoints(TCP_SOCKET hTCP, IP_ADDR * pRemoteIP, MAC_ADDR * pRem
     *pdwLocalPort = MyTCB.localPort.Val;
 }
 
+/*****************************************************************************
+  Function:
+	WORD GetTcpRxSpans(TCP_SOCKET hTCP, BYTE ** ppHead, WORD * pcbHead, BYTE ** ppWrap, WORD * pcbWrap)
+
+  Summary:
+	TCPBorrowRx() with the spans returned through pointers
+
+  Description:
+    The C++ classes don't see TCP_RX_SPANS, so this unpacks it for TcpClient::borrowStream.
+
+  Precondition:
+	TCP is initialized.
+
+  Parameters:
+	hTCP - The socket to borrow from
+    ppHead - receives a pointer to the next byte to read
+    pcbHead - receives the number of bytes at *ppHead
+    ppWrap - receives the start of the FIFO if the data wraps, NULL otherwise
+    pcbWrap - receives the number of bytes at *ppWrap
+
+  Returns:
+	Total number of bytes that were borrowed, 0 if none or the FIFO is not in PIC RAM
+
+ ***************************************************************************/
+WORD GetTcpRxSpans(TCP_SOCKET hTCP, BYTE ** ppHead, WORD * pcbHead, BYTE ** ppWrap, WORD * pcbWrap)
+{
+	TCP_RX_SPANS spans;
+	WORD cbReady;
+
+	cbReady = TCPBorrowRx(hTCP, &spans);
+
+    *ppHead = spans.pHead;
+    *pcbHead = spans.wHeadLen;
+    *ppWrap = spans.pWrap;
+    *pcbWrap = spans.wWrapLen;
+
+	return cbReady;
+}
+
 #endif //#if defined(STACK_USE_TCP)
@@ -62,6 +62,16 @@ void DNSResolve(BYTE* HostName, BYTE Type);
 BOOL DNSIsResolved(IP_ADDR* HostIP);
 BOOL DNSEndUsage(void);
 
+// Resolutions that run alongside the one DNSBeginUsage() guards
+typedef BYTE DNS_HANDLE;
+#define INVALID_DNS_HANDLE		(0xFFu)
+DNS_HANDLE DNSQueryBegin(BYTE* Hostname, BYTE Type);
+BOOL DNSQueryIsResolved(DNS_HANDLE hQuery, IP_ADDR* HostIP);
+BOOL DNSQueryEnd(DNS_HANDLE hQuery);
+
+BOOL DNSCacheLookup(BYTE* Hostname, BYTE Type, IP_ADDR* HostIP);
+void DNSCacheFlush(void);
+
 #if defined(__18CXX)
 	void DNSResolveROM(ROM BYTE* Hostname, BYTE Type);
 #else
@@ -0,0 +1,74 @@
+/************************************************************************/
+/*																		*/
+/*	ENC28J60SPI.h	--  Bulk ENC28J60 buffer transfers over SPI DMA     */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Define ENC_SPI_DMA in the hardware profile of a PIC32 with an       */
+/*	ENC28J60, along with ENC_SPI_RX_IRQ for its SPI module, for         */
+/*	example _SPI2_RX_IRQ.  MACGetArray() and MACPutArray() then move    */
+/*	ENC_SPI_DMA_THRESHOLD bytes or more with two DMA channels instead   */
+/*	of the CPU.  A read still returns once the data is in, but a write  */
+/*	is copied aside and returns at once; the next access to the chip,   */
+/*	MACFlush() included, finishes it first, so the stack can get on     */
+/*	with the next thing while the bytes go out.                         */
+/*																		*/
+/*	With HOST_MAC and HOST_ENC28J60, HostENC28J60.c implements the      */
+/*	same transport against a simulated ENC28J60, see HostENC28J60.h.    */
+/*																		*/
+/************************************************************************/
+
+#ifndef __ENC28J60_SPI_H
+#define __ENC28J60_SPI_H
+
+// Shortest MACGetArray() or MACPutArray() worth setting up DMA for
+#ifndef ENC_SPI_DMA_THRESHOLD
+	#define ENC_SPI_DMA_THRESHOLD		(32u)
+#endif
+
+// Bytes per DMA block, also the size of the buffer writes are copied to;
+// no more than 256 on parts with 8 bit DMA size registers
+#ifndef ENC_SPI_DMA_BUFFER_SIZE
+	#define ENC_SPI_DMA_BUFFER_SIZE		(256u)
+#endif
+
+// Channels used, the RX channel runs at the higher priority
+#ifndef ENC_SPI_DMA_TX_CHANNEL
+	#define ENC_SPI_DMA_TX_CHANNEL		(DMA_CHANNEL0)
+#endif
+#ifndef ENC_SPI_DMA_RX_CHANNEL
+	#define ENC_SPI_DMA_RX_CHANNEL		(DMA_CHANNEL1)
+#endif
+
+#if defined(ENC_SPI_DMA) && !defined(__PIC32MX__) && !defined(HOST_ENC28J60)
+	#error ENC_SPI_DMA is only implemented for PIC32
+#elif defined(ENC_SPI_DMA) && defined(__PIC32MX__) && !defined(ENC_SPI_RX_IRQ)
+	#error ENC_SPI_DMA needs ENC_SPI_RX_IRQ, the RX interrupt of the SPI module the ENC28J60 is on
+#endif
+
+void ENCSPIInit(void);
+WORD ENCSPIRead(BYTE *val, WORD len);
+void ENCSPIWrite(BYTE *val, WORD len);
+BOOL ENCSPIIsDone(void);
+void ENCSPIWait(void);
+
+#endif
@@ -106,6 +106,8 @@ WORD    swaps(WORD v);
 DWORD   swapl(DWORD v);
 
 WORD    CalcIPChecksum(BYTE* buffer, WORD len);
+WORD    UpdateIPChecksum(WORD wChecksum, WORD wOld, WORD wNew);
+WORD    AddIPChecksum(WORD wChecksum, WORD wMore, BOOL bOddOffset);
 WORD    CalcIPBufferChecksum(WORD len);
 
 #if defined(__18CXX)
@@ -0,0 +1,97 @@
+/************************************************************************/
+/*																		*/
+/*	HostENC28J60.h	--  Simulated ENC28J60 for hosts                    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	With HOST_MAC and HOST_ENC28J60, ENC28J60.c is the MAC and talks    */
+/*	to a simulated ENC28J60 through a simulated PIC32 SPI module;       */
+/*	Host-ENC28J60.x maps the ENC_* pins and registers of the hardware   */
+/*	profile onto the functions below.  The chip decodes the RCR, WCR,   */
+/*	BFS, BFC, RBM, WBM and SR commands, has its 8 KB of buffer memory   */
+/*	with ERDPT wrapping inside the RX window, the MII registers, the    */
+/*	DMA copy engine and the RX ring HostENCReceive() puts frames in.    */
+/*																		*/
+/*	Every SPI word takes the wire time HOST_ENC_SPI_HZ gives it, spent  */
+/*	waiting, as it is without DMA.  With ENC_SPI_DMA too, the ENCSPI    */
+/*	functions of ENC28J60SPI.h move the bursts instead: a write        */
+/*	finishes as far after it starts, by the host's clock, as it would   */
+/*	take on the wire, so code that overlaps its own work with          */
+/*	ENCSPIWrite() can be checked, and timed, without a board.           */
+/*																		*/
+/*	The statistics compare the wire time with the time the CPU spent    */
+/*	waiting for it, and count chip selects made while a DMA write was   */
+/*	still going out, which would corrupt it on the board.               */
+/*																		*/
+/************************************************************************/
+
+#ifndef __HOST_ENC28J60_H
+#define __HOST_ENC28J60_H
+
+// SPI clock of the simulated transfers
+#ifndef HOST_ENC_SPI_HZ
+	#define HOST_ENC_SPI_HZ			(10000000ul)
+#endif
+
+#define HOST_ENC_MEMORY_SIZE		(8192u)
+
+typedef struct
+{
+	DWORD	cReads;			// ENCSPIRead() bursts
+	DWORD	cWrites;		// ENCSPIWrite() bursts
+	DWORD	dwBytes;		// bytes on the SPI, commands included
+	QWORD	qwWireNs;		// time the transfers took on the SPI
+	QWORD	qwWaitNs;		// time the CPU spent waiting for them
+	DWORD	cOverlaps;		// chip selects during a DMA write
+} HOST_ENC_STATS;
+
+// The parts of the PIC32 SPI module ENC28J60.c uses
+typedef struct
+{
+	unsigned ON:1;
+	unsigned MSTEN:1;
+	unsigned CKE:1;
+	unsigned SMP:1;
+	unsigned MODE16:1;
+	unsigned MODE32:1;
+} HOST_ENC_SPICON;
+
+typedef struct
+{
+	unsigned SPITBE:1;
+	unsigned SPIRBF:1;
+} HOST_ENC_SPISTAT;
+
+extern HOST_ENC_SPICON	HostENCSPICON;
+extern DWORD			HostENCSPIBRG;
+extern BYTE				HostENCCSTris;
+
+BYTE *HostENCChipSelect(void);
+DWORD *HostENCSPIBuffer(void);
+HOST_ENC_SPISTAT *HostENCSPIStatus(void);
+
+BOOL HostENCReceive(BYTE *pFrame, WORD wLen);
+WORD HostENCGetTxFrame(BYTE *pFrame, WORD wSize);
+BYTE *HostENCMemory(void);
+void HostENCGetStats(HOST_ENC_STATS *pStats, BOOL bReset);
+
+#endif
@@ -0,0 +1,108 @@
+/************************************************************************/
+/*																		*/
+/*	HostMAC.h	--  Host MAC for running the MAL on a Linux PC          */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Define HOST_MAC to build the MAL with gcc on a Linux host in place  */
+/*	of the PIC32 internal MAC.  Frames go through an in-process         */
+/*	virtual switch; port 0 is this stack and host code can attach       */
+/*	more ports to play the other nodes on the segment.  Define          */
+/*	HOST_MAC_TAP as well to put a Linux TAP device on the switch, so    */
+/*	the stack can talk to the host's own network stack.                 */
+/*																		*/
+/*	TCP sockets can be put in TCP_ETH_RAM as on an ENCX24J600 board.    */
+/*	Define HOST_ENCX24J600 too and the MAC's DMA engine behaves like    */
+/*	the ENCX24J600's: copies and checksums run in the background at     */
+/*	HOST_ENCX24J600_DMA_BPS, copies can checksum what they move         */
+/*	(MAC_COPY_CHECKSUM) and HostMACGetDmaStats() tells how long the     */
+/*	stack waited on the engine and how many frames a second it sent.    */
+/*	MACFlush() also sums every TCP and UDP frame over again in          */
+/*	software, so a checksum put together from the engine's can be       */
+/*	checked.                                                            */
+/*																		*/
+/*	HostMACSetLoss() makes a port's link lossy: every Nth frame the     */
+/*	switch delivers to it is lost, so TCP's retransmissions can be      */
+/*	tested, and the stack's own port loses both directions of a         */
+/*	loopback connection.                                                */
+/*																		*/
+/************************************************************************/
+
+#ifndef __HOST_MAC_H
+#define __HOST_MAC_H
+
+// Number of ports on the virtual switch, including the stack's own
+#ifndef HOST_MAC_PORTS
+	#define HOST_MAC_PORTS			4u
+#endif
+
+// Frames each switch port can hold before it starts dropping
+#ifndef HOST_MAC_QUEUE_FRAMES
+	#define HOST_MAC_QUEUE_FRAMES	32u
+#endif
+
+// TAP interface to attach when HOST_MAC_TAP is defined
+#ifndef HOST_MAC_TAP_NAME
+	#define HOST_MAC_TAP_NAME		"tap0"
+#endif
+
+// Bytes a second the modeled ENCX24J600 DMA engine copies or checksums
+#ifndef HOST_ENCX24J600_DMA_BPS
+	#define HOST_ENCX24J600_DMA_BPS	(20000000ul)
+#endif
+
+#define HOST_MAC_FRAME_SIZE			(1514ul)	// Largest frame, not counting the CRC
+#define HOST_MAC_STACK_PORT			(0u)		// The port this stack's MAC is on
+#define HOST_MAC_INVALID_PORT		(0xFFu)
+
+// MACGetFreeRxSize() returns a WORD
+#if HOST_MAC_QUEUE_FRAMES * HOST_MAC_FRAME_SIZE > 0xFFFFul
+	#error HOST_MAC_QUEUE_FRAMES is too large, the RX queue must be under 64 KB
+#endif
+
+BYTE HostMACAttach(void);
+void HostMACDetach(BYTE port);
+BOOL HostMACSend(BYTE port, const BYTE *pFrame, WORD wLength);
+WORD HostMACReceive(BYTE port, BYTE *pFrame, WORD wMax);
+DWORD HostMACDropped(BYTE port);
+void HostMACSetLoss(BYTE port, DWORD dwEvery);
+DWORD HostMACLost(BYTE port);
+
+#if defined(HOST_ENCX24J600)
+typedef struct
+{
+	DWORD	cCopies;			// MACMemCopyAsync() and MACMemCopyChecksumAsync()
+	DWORD	cChecksums;			// CalcIPBufferChecksum() and MACCalcRxChecksum()
+	DWORD	dwBytes;			// bytes the engine went through
+	QWORD	qwBusyNs;			// time the engine was busy
+	QWORD	qwWaitNs;			// time the stack waited for it
+	DWORD	cFrames;			// frames sent by MACFlush()
+	DWORD	cSplitFrames;		// frames with a payload copied and summed in two pieces
+	DWORD	cSummedFrames;		// TCP and UDP frames MACFlush() summed again
+	DWORD	cBadChecksums;		// and found the checksum wrong in
+	QWORD	qwElapsedNs;		// since MACInit() or the last reset
+} HOST_MAC_DMA_STATS;
+
+void HostMACGetDmaStats(HOST_MAC_DMA_STATS *pStats, BOOL bReset);
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+/************************************************************************/
+/*																		*/
+/*	HostPcap.h	--  pcap replay and recording for host builds           */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	With HOST_MAC, HostPcapReplay() feeds a capture, for example one    */
+/*	taken on a board with STACK_USE_PCAP_CAPTURE, through the host      */
+/*	MAC into StackTask() one frame at a time and times each call.       */
+/*	Built with STACK_USE_HANDLER_TIMING, the stack's own times for      */
+/*	ARP, ICMP, TCP and UDP come back too.  Frames the capture shows     */
+/*	coming from AppConfig.MyMACAddr are the stack's own output and      */
+/*	are skipped, so give the host build the board's MAC and IP.  A      */
+/*	capture cut short by its snap length fails the IP and TCP           */
+/*	checksums; record with PCAP_CAPTURE_SNAPLEN 1514 to replay.         */
+/*																		*/
+/*	HostPcapReplayBurst() queues the frames several at a time instead,  */
+/*	to see how StackTask()'s RX budgets hold up under a storm.          */
+/*																		*/
+/*	With STACK_USE_PCAP_CAPTURE as well, HostPcapRecordStart() and      */
+/*	HostPcapRecordFlush() write the capture ring to a file.             */
+/*																		*/
+/************************************************************************/
+
+#ifndef __HOST_PCAP_H
+#define __HOST_PCAP_H
+
+#include <stdio.h>
+
+typedef struct
+{
+	DWORD					cFrames;		// sent to the stack
+	DWORD					cSkipped;		// the stack's own frames and frames too big for the MAC
+	#if defined(STACK_USE_HANDLER_TIMING)
+	STACK_HANDLER_STATS		rgHandler[STACK_HANDLERS];	// StackGetHandlerStats() over the replay
+	#endif
+	DWORD					cCalls;			// StackTask() calls timed
+	QWORD					qwTotalCallNs;
+	QWORD					qwMaxCallNs;	// longest the application waited
+	STACK_RX_STATS			RxStats;		// StackGetRxStats() over the replay
+} HOST_PCAP_STATS;
+
+BOOL HostPcapReplay(const char *szFile, BOOL fOriginalTiming, HOST_PCAP_STATS *pStats);
+BOOL HostPcapReplayBurst(const char *szFile, WORD wBurst, HOST_PCAP_STATS *pStats);
+void HostPcapPrintStats(const HOST_PCAP_STATS *pStats, FILE *pFile);
+
+#if defined(STACK_USE_PCAP_CAPTURE)
+BOOL HostPcapRecordStart(const char *szFile);
+void HostPcapRecordFlush(void);
+void HostPcapRecordStop(void);
+#endif
+
+#endif
@@ -155,6 +155,14 @@ WORD    IPPutHeader(NODE_INFO *remote,
                     BYTE protocol,
                     WORD len);
 
+// Header template for sending a run of packets to one node, see IP.c
+void    IPInitHeaderTemplate(IP_HEADER *header,
+                             NODE_INFO *remote,
+                             BYTE protocol);
+void    IPPutHeaderTemplate(IP_HEADER *header,
+                            NODE_INFO *remote,
+                            WORD len);
+
 
 /*********************************************************************
  * Function:        BOOL IPGetHeader( IP_ADDR    *localIP,
@@ -84,6 +84,8 @@
 #elif defined(ENC100_INTERFACE_MODE)
 	#include "TCPIP Stack/ENCX24J600.h"
 	#define PHYREG WORD
+#elif defined(HOST_MAC)
+	#include "TCPIP Stack/HostMAC.h"
 #elif defined(__PIC32MX__) && defined(_ETH)
 	// extra includes for PIC32MX with embedded ETH Controller
 #else
@@ -143,12 +145,17 @@ typedef struct  __attribute__((aligned(2), packed))
     #define BASE_TCB_ADDR	(BASE_TX_ADDR + ((MAX_PACKET_SIZE + 4ul)*2))
 	#define BASE_HTTPB_ADDR (BASE_TCB_ADDR + TCP_ETH_RAM_SIZE)
 	#define BASE_SSLB_ADDR	(BASE_HTTPB_ADDR + RESERVED_HTTP_MEMORY)
-#elif defined(__PIC32MX__) && defined(_ETH) && !defined(ENC_CS_TRIS)
+#elif ((defined(__PIC32MX__) && defined(_ETH)) || defined(HOST_MAC)) && !defined(ENC_CS_TRIS)
 	#define BASE_TX_ADDR	(MACGetTxBaseAddr())
 	#define BASE_HTTPB_ADDR	(MACGetHttpBaseAddr())
 	#define BASE_SSLB_ADDR	(MACGetSslBaseAddr())
-	#define RXSIZE			(EMAC_RX_BUFF_SIZE)
 	#define RAMSIZE			(2*RXSIZE)	// not used but silences the compiler
+	#if defined(HOST_MAC)
+		#define RXSIZE			(HOST_MAC_QUEUE_FRAMES*HOST_MAC_FRAME_SIZE)
+		#define BASE_TCB_ADDR	(MACGetTcbBaseAddr())
+	#else
+		#define RXSIZE			(EMAC_RX_BUFF_SIZE)
+	#endif
 #else	// ENC28J60 or PIC18F97J60 family internal Ethernet controller
 	#define RAMSIZE			(8*1024ul)
 	#define TXSTART 		(RAMSIZE - (1ul+1518ul+7ul) - TCP_ETH_RAM_SIZE - RESERVED_HTTP_MEMORY - RESERVED_SSL_MEMORY)
@@ -298,6 +305,14 @@ WORD MACGetFreeRxSize(void);
 void MACMemCopyAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len);
 BOOL MACIsMemCopyDone(void);
 
+// ENCX24J600 DMA copies that checksum what they copy, also modeled by the 
+// host MAC with HOST_ENCX24J600
+#if defined(ENC100_INTERFACE_MODE) || (defined(HOST_MAC) && defined(HOST_ENCX24J600))
+	#define MAC_COPY_CHECKSUM
+	void MACMemCopyChecksumAsync(PTR_BASE destAddr, PTR_BASE sourceAddr, WORD len);
+	WORD MACGetMemCopyChecksum(void);
+#endif
+
 void MACPutHeader(MAC_ADDR *remote, BYTE type, WORD dataLen);
 BOOL MACIsTxReady(void);
 void MACPut(BYTE val);
@@ -312,12 +327,15 @@ void MACFlush(void);
 	#define MACPutROMArray(a,b)	MACPutArray((BYTE*)a,b)
 #endif
 
-// PIC32MX with embedded ETHC functions
-#if defined(__PIC32MX__) && defined(_ETH)
+// PIC32MX with embedded ETHC functions, also provided by the host MAC
+#if (defined(__PIC32MX__) && defined(_ETH)) || defined(HOST_MAC)
 	PTR_BASE MACGetTxBaseAddr(void);
 	PTR_BASE MACGetHttpBaseAddr(void);
 	PTR_BASE MACGetSslBaseAddr(void);
 #endif
+#if defined(HOST_MAC)
+	PTR_BASE MACGetTcbBaseAddr(void);
+#endif
 
 	
 #endif
@@ -0,0 +1,62 @@
+/************************************************************************/
+/*																		*/
+/*	PcapCapture.h	--  Records MAC frames into a pcap ring             */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Define STACK_USE_PCAP_CAPTURE and the MAC puts every frame it       */
+/*	receives or sends into a RAM ring, already laid out as pcap         */
+/*	records stamped with TickGet().  The stack only ever moves the      */
+/*	head and the reader only the tail, so the reader can drain it from  */
+/*	the main loop or an interrupt without locks.  A frame that does     */
+/*	not fit is counted and dropped, the stack never waits.              */
+/*																		*/
+/*	To make a pcap file, write PcapCaptureFileHeader() once followed    */
+/*	by whatever PcapCaptureRead() returns.                              */
+/*																		*/
+/************************************************************************/
+
+#ifndef __PCAP_CAPTURE_H
+#define __PCAP_CAPTURE_H
+
+// Bytes of RAM for the ring, must be a power of 2
+#ifndef PCAP_CAPTURE_RING_SIZE
+	#define PCAP_CAPTURE_RING_SIZE		(4096u)
+#endif
+
+// Bytes of each frame kept; enough for the Ethernet, IP and TCP headers
+#ifndef PCAP_CAPTURE_SNAPLEN
+	#define PCAP_CAPTURE_SNAPLEN		(128u)
+#endif
+
+#if (PCAP_CAPTURE_RING_SIZE & (PCAP_CAPTURE_RING_SIZE - 1)) != 0
+	#error PCAP_CAPTURE_RING_SIZE must be a power of 2
+#endif
+
+#define PCAP_FILE_HEADER_SIZE			(24u)
+
+void PcapCaptureFrame(const BYTE *pFrame, WORD wLength);
+WORD PcapCaptureFileHeader(BYTE *pHeader);
+WORD PcapCaptureRead(BYTE *pBuff, WORD wMax);
+DWORD PcapCaptureDropped(void);
+
+#endif
@@ -139,9 +139,69 @@ typedef struct __attribute__((__packed__))
     extern APP_CONFIG AppConfig;
 #endif
 
+// Frames StackTask() hands to ARP, IP and the rest before it returns to
+// the application, the rest wait in the MAC for the next call.  The
+// default, 0, is no limit: every queued frame is handled, as before.  A
+// board's TCPIPConfig.x can set 8 or so to split a burst between the
+// timers, RX and the application; TCPTick() and UDPTask() run at the
+// start of every call.  tools/host/rxstorm.c measures the difference.
+#ifndef STACK_RX_FRAME_BUDGET
+	#define STACK_RX_FRAME_BUDGET	(0u)
+#endif
+
+// Ticks StackTask() may spend on RX in one call, 0 (the default) for no
+// limit; at least one frame is always handled
+#ifndef STACK_RX_TIME_BUDGET
+	#define STACK_RX_TIME_BUDGET	(0u)
+#endif
+
+// With STACK_USE_RX_INTERRUPT, StackTask() only asks the MAC for frames
+// after StackRxSignal(), normally from the MAC's RX interrupt, or when
+// this many ticks have gone by without one.  The poll keeps MACs that
+// do not signal working and lets the PIC32 MAC check its link.
+#ifndef STACK_RX_POLL_INTERVAL
+	#define STACK_RX_POLL_INTERVAL	(TICK_SECOND/10ull)
+#endif
+
+typedef struct
+{
+	DWORD	dwCalls;				// StackTask() calls
+	DWORD	dwFrames;				// frames handed up
+	DWORD	dwFrameBudgetHits;		// calls that used all of STACK_RX_FRAME_BUDGET
+	DWORD	dwTimeBudgetHits;		// calls that ran out of STACK_RX_TIME_BUDGET
+	DWORD	dwIdleCalls;			// STACK_USE_RX_INTERRUPT: calls that left the MAC alone
+	WORD	wMaxBurst;				// most frames handed up by one call
+	WORD	wMinFreeRx;				// least MACGetFreeRxSize() seen, how deep the RX queue got
+} STACK_RX_STATS;
+
+// With STACK_USE_HANDLER_TIMING, StackTask() times each frame it hands
+// up, from MACGetHeader() to the handler's return, IPGetHeader()
+// included, and charges it to the handler below.  The PIC32 uses the
+// core timer, host builds the monotonic clock.
+#define STACK_HANDLER_ARP		(0u)
+#define STACK_HANDLER_ICMP		(1u)
+#define STACK_HANDLER_TCP		(2u)
+#define STACK_HANDLER_UDP		(3u)
+#define STACK_HANDLER_OTHER		(4u)		// other protocols and frames IPGetHeader() rejects
+#define STACK_HANDLERS			(5u)
+
+typedef struct
+{
+	DWORD	cFrames;
+	QWORD	qwTotalNs;
+	DWORD	dwMaxNs;				// slowest single frame
+} STACK_HANDLER_STATS;
 
 void StackInit(void);
 void StackTask(void);
 void StackApplications(void);
+void StackGetRxStats(STACK_RX_STATS *pStats, BOOL bReset);
+#if defined(STACK_USE_HANDLER_TIMING)
+void StackGetHandlerStats(STACK_HANDLER_STATS rgStats[STACK_HANDLERS], BOOL bReset);
+#endif
+#if defined(STACK_USE_RX_INTERRUPT)
+void StackRxSignal(void);
+BOOL StackIsRxPending(void);
+#endif
 
 #endif
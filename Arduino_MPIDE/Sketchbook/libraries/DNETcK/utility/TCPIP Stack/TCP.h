@@ -137,7 +137,8 @@ typedef struct
 		unsigned char bTXFIN : 1;					// FIN needs to be transmitted
 		unsigned char bSocketReset : 1;				// Socket has been reset (self-clearing semaphore)
 		unsigned char bSSLHandshaking : 1;			// Socket is in an SSL handshake
-		unsigned char filler : 2;					// Future expansion
+		unsigned char bCorked : 1;					// Hold back partial segments until uncorked (see TCPSetCork())
+		unsigned char filler : 1;					// Future expansion
     } Flags;
 	WORD_VAL remoteHash;	// Consists of remoteIP, remotePort, localPort for connected sockets.  It is a localPort number only for listening server sockets.
 
@@ -153,9 +154,17 @@ typedef struct
 	
 } TCB_STUB;
 
+// Holds the dwRemoteHost of TCPOpen(), a RAM pointer for some host types, 
+// so it has to be pointer sized in a host build
+#if defined(COMPILER_HOST_GCC)
+	#define TCP_REMOTE_HOST		PTR_BASE
+#else
+	#define TCP_REMOTE_HOST		DWORD
+#endif
+
 // Remainder of TCP Control Block data.
 // The rest of the TCB is stored in Ethernet buffer RAM or elsewhere as defined by vMemoryMedium.
-// Current size is 41 (PIC18), 42 (PIC24/dsPIC), or 48 bytes (PIC32)
+// Current size is 69 (PIC18), 70 (PIC24/dsPIC), or 76 bytes (PIC32)
 typedef struct
 {
 	DWORD		retryInterval;			// How long to wait before retrying transmission
@@ -169,7 +178,7 @@ typedef struct
 	union
 	{
 		NODE_INFO	niRemoteMACIP;		// 10 bytes for MAC and IP address
-		DWORD		dwRemoteHost;		// RAM or ROM pointer to a hostname string (ex: "www.microchip.com")
+		TCP_REMOTE_HOST	dwRemoteHost;	// RAM or ROM pointer to a hostname string (ex: "www.microchip.com")
 	} remote;
 	SHORT		sHoleSize;				// Size of the hole, or -1 for none exists.  (0 indicates hole has just been filled)
     struct
@@ -177,11 +186,20 @@ typedef struct
         unsigned char bFINSent : 1;		// A FIN has been sent
 		unsigned char bSYNSent : 1;		// A SYN has been sent
 		unsigned char bRemoteHostIsROM : 1;	// Remote host is stored in ROM
-		unsigned char bRXNoneACKed1 : 1;	// A duplicate ACK was likely received
-		unsigned char bRXNoneACKed2 : 1;	// A second duplicate ACK was likely received
-		unsigned char filler : 3;		// future use
+		unsigned char vDupACKs : 2;			// Count of duplicate ACKs received in a row (saturates at 3)
+		unsigned char bFastRecovery : 1;	// A fast retransmit was done and dwRecoverSEQ is not yet ACKed
+		unsigned char bRTTTiming : 1;		// A segment ending at dwRTTSEQ is being timed
+		unsigned char bRetransmitted : 1;	// Retransmitted data is in flight, do not take RTT samples (Karn)
     } flags;
 	WORD		wRemoteMSS;				// Maximum Segment Size option advirtised by the remote node during initial handshaking
+	DWORD		dwSRTT;					// Smoothed round trip time, in ticks * 8
+	DWORD		dwRTTVAR;				// Round trip time variation, in ticks * 4
+	DWORD		dwRTO;					// Retransmission timeout computed from dwSRTT and dwRTTVAR, in ticks
+	DWORD		dwRTTSEQ;				// Sequence number that ends the segment being timed
+	DWORD		dwRTTStart;				// TickGet() when the timed segment was sent
+	DWORD		dwRecoverSEQ;			// Highest sequence number sent when fast recovery started
+	WORD		wRetransmits;			// Retransmissions because the retransmission timer expired
+	WORD		wFastRetransmits;		// Retransmissions triggered by three duplicate ACKs
     #if defined(STACK_USE_SSL)
     WORD_VAL	localSSLPort;			// Local SSL port number (for listening sockets)
     #endif
@@ -196,6 +214,42 @@ typedef struct
 	WORD_VAL remotePort;	// Port number associated with remote node
 } SOCKET_INFO;
 
+// Round trip and retransmission statistics of a socket
+typedef struct
+{
+	DWORD dwSRTT;			// Smoothed round trip time, in ticks (0 until the first sample)
+	DWORD dwRTTVAR;			// Round trip time variation, in ticks
+	DWORD dwRTO;			// Retransmission timeout used for the next new segment, in ticks
+	WORD wRetransmits;		// Retransmissions because the retransmission timer expired
+	WORD wFastRetransmits;	// Retransmissions triggered by three duplicate ACKs
+} TCP_SOCKET_STATS;
+
+// Data in a TCP RX FIFO, borrowed in place by TCPBorrowRx()
+typedef struct
+{
+	BYTE* pHead;			// First byte to be read
+	WORD wHeadLen;			// Bytes at pHead, up to the end of the FIFO
+	BYTE* pWrap;			// Start of the FIFO, if the data wraps around
+	WORD wWrapLen;			// Bytes at pWrap, 0 if the data does not wrap
+} TCP_RX_SPANS;
+
+// Socket events reported to the handler set with TCPSetEventHandler()
+#define TCP_EVENT_CONNECTED		(0x01u)		// Connection established (client or server side)
+#define TCP_EVENT_RX			(0x02u)		// New data arrived in the RX FIFO
+#define TCP_EVENT_TX			(0x04u)		// Sent data was ACKed, freeing TX FIFO space
+#define TCP_EVENT_CLOSED		(0x08u)		// Remote node sent a FIN, or the socket was closed
+#define TCP_EVENT_RESET			(0x10u)		// Connection was reset or refused
+
+// Called by TCPDispatchEvents() with the events gathered since the last call
+typedef void (*TCP_EVENT_HANDLER)(TCP_SOCKET hTCP, BYTE vEvents, void* pContext);
+
+// One buffer of a scatter-gather write by TCPPutArrayV()
+typedef struct
+{
+	BYTE* pData;			// Bytes to write
+	WORD wLen;				// Number of bytes at pData
+} TCP_IOVEC;
+
 /****************************************************************************
   Section:
 	Function Declarations
@@ -203,6 +257,7 @@ typedef struct
 
 void TCPInit(void);
 SOCKET_INFO* TCPGetRemoteInfo(TCP_SOCKET hTCP);
+TCP_SOCKET_STATS* TCPGetSocketStats(TCP_SOCKET hTCP);
 BOOL TCPWasReset(TCP_SOCKET hTCP);
 BOOL TCPIsConnected(TCP_SOCKET hTCP);
 void TCPDisconnect(TCP_SOCKET hTCP);
@@ -210,6 +265,7 @@ void TCPClose(TCP_SOCKET hTCP);
 WORD TCPIsPutReady(TCP_SOCKET hTCP);
 BOOL TCPPut(TCP_SOCKET hTCP, BYTE byte);
 WORD TCPPutArray(TCP_SOCKET hTCP, BYTE* Data, WORD Len);
+WORD TCPPutArrayV(TCP_SOCKET hTCP, TCP_IOVEC* iov, BYTE vCount);
 BYTE* TCPPutString(TCP_SOCKET hTCP, BYTE* Data);
 WORD TCPIsGetReady(TCP_SOCKET hTCP);
 WORD TCPGetRxFIFOFree(TCP_SOCKET hTCP);
@@ -217,12 +273,18 @@ BOOL TCPGet(TCP_SOCKET hTCP, BYTE* byte);
 WORD TCPGetArray(TCP_SOCKET hTCP, BYTE* buffer, WORD count);
 BYTE TCPPeek(TCP_SOCKET hTCP, WORD wStart);
 WORD TCPPeekArray(TCP_SOCKET hTCP, BYTE *vBuffer, WORD wLen, WORD wStart);
+WORD TCPBorrowRx(TCP_SOCKET hTCP, TCP_RX_SPANS* spans);
+WORD TCPConsume(TCP_SOCKET hTCP, WORD len);
 WORD TCPFindEx(TCP_SOCKET hTCP, BYTE cFind, WORD wStart, WORD wSearchLen, BOOL bTextCompare);
 WORD TCPFindArrayEx(TCP_SOCKET hTCP, BYTE* cFindArray, WORD wLen, WORD wStart, WORD wSearchLen, BOOL bTextCompare);
 void TCPDiscard(TCP_SOCKET hTCP);
 BOOL TCPProcess(NODE_INFO* remote, IP_ADDR* localIP, WORD len);
 void TCPTick(void);
 void TCPFlush(TCP_SOCKET hTCP);
+void TCPSetCork(TCP_SOCKET hTCP, BOOL bCork);
+void TCPSetEventHandler(TCP_SOCKET hTCP, TCP_EVENT_HANDLER pfnHandler, void* pContext);
+void TCPDispatchEvents(void);
+BOOL TCPIsCorked(TCP_SOCKET hTCP);
 
 // Create a server socket and ignore dwRemoteHost.
 #define TCP_OPEN_SERVER		0u
@@ -252,7 +314,7 @@ void TCPFlush(TCP_SOCKET hTCP);
 	// Emit an undeclared identifier diagnostic if code tries to use TCP_OPEN_NODE_INFO while STACK_CLIENT_MODE feature is not enabled. 
 	#define TCP_OPEN_NODE_INFO	You_need_to_enable_STACK_CLIENT_MODE_to_use_TCP_OPEN_NODE_INFO
 #endif
-TCP_SOCKET TCPOpen(DWORD dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose);
+TCP_SOCKET TCPOpen(TCP_REMOTE_HOST dwRemoteHost, BYTE vRemoteHostType, WORD wPort, BYTE vSocketPurpose);
 
 #if defined(__18CXX)
 	WORD TCPFindROMArrayEx(TCP_SOCKET hTCP, ROM BYTE* cFindArray, WORD wLen, WORD wStart, WORD wSearchLen, BOOL bTextCompare);
@@ -237,6 +237,7 @@
 		defined(STACK_USE_TFTP_CLIENT) || \
 		defined(STACK_USE_ANNOUNCE) || \
 		defined(STACK_USE_UDP_PERFORMANCE_TEST) || \
+		defined(STACK_USE_TCP_PERFORMANCE_TEST) || \
 		defined(STACK_USE_SNTP_CLIENT) || \
 		defined(STACK_USE_BERKELEY_API)
 	    #if !defined(STACK_USE_UDP)
@@ -332,6 +333,10 @@
 	#include "TCPIP Stack/TCP.h"
 #endif
 
+#if defined(STACK_USE_PCAP_CAPTURE)
+	#include "TCPIP Stack/PcapCapture.h"
+#endif
+
 #if defined(STACK_USE_BERKELEY_API)
 	#include "TCPIP Stack/BerkeleyAPI.h"
 #endif
@@ -91,8 +91,8 @@
 %STACK_USE_NBNS%#define STACK_USE_NBNS					// NetBIOS Name Service Server for repsonding to NBNS hostname broadcast queries
 %STACK_USE_REBOOT_SERVER%#define STACK_USE_REBOOT_SERVER			// Module for resetting this PIC remotely.  Primarily useful for a Bootloader.
 %STACK_USE_SNTP_CLIENT%#define STACK_USE_SNTP_CLIENT			// Simple Network Time Protocol for obtaining current date/time from Internet
-%STACK_USE_UDP_PERFORMANCE_TEST%#define STACK_USE_UDP_PERFORMANCE_TEST	// Module for testing UDP TX performance characteristics.  NOTE: Enabling this will cause a huge amount of UDP broadcast packets to flood your network on the discard port.  Use care when enabling this on production networks, especially with VPNs (could tunnel broadcast traffic across a limited bandwidth connection).
-%STACK_USE_TCP_PERFORMANCE_TEST%#define STACK_USE_TCP_PERFORMANCE_TEST	// Module for testing TCP TX performance characteristics
+%STACK_USE_UDP_PERFORMANCE_TEST%#define STACK_USE_UDP_PERFORMANCE_TEST	// UDP blast test with loss accounting, driven by tools/dnetckperf.c.  NOTE: a blast goes out as fast as the MAC takes it, use care on production networks and VPNs.
+%STACK_USE_TCP_PERFORMANCE_TEST%#define STACK_USE_TCP_PERFORMANCE_TEST	// TCP bulk TX, RX and request/response tests, driven by tools/dnetckperf.c
 %STACK_USE_DYNAMICDNS_CLIENT%#define STACK_USE_DYNAMICDNS_CLIENT		// Dynamic DNS client updater module
 %STACK_USE_BERKELEY_API%#define STACK_USE_BERKELEY_API			// Berekely Sockets APIs are available
 %STACK_USE_ZEROCONF_LINK_LOCAL%#define STACK_USE_ZEROCONF_LINK_LOCAL	// Zeroconf IPv4 Link-Local Addressing
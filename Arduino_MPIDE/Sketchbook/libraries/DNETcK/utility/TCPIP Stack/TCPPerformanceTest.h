@@ -51,6 +51,57 @@
 #ifndef __TCPPERFORMANCETEST_H
 #define __TCPPERFORMANCETEST_H
 
+// Three test servers, driven from a PC by tools/dnetckperf.c:
+//   TX - sends a pattern as fast as the client reads it
+//   RX - counts and discards whatever the client sends
+//   RR - echoes length-prefixed requests, for exchange latency
+// A session lasts until the client disconnects.  Its result is sent as a
+// line of text to UDP port TCP_PERF_STATS_PORT on the client.
+//
+// Sockets come from TCPSocketInitializer: TCP_PERF_SOCKETS each of
+// TCP_PURPOSE_TCP_PERFORMANCE_TX, TCP_PURPOSE_TCP_PERFORMANCE_RX and
+// TCP_PURPOSE_DEFAULT (RR).  The stats report needs a free UDP socket.
+
+#ifndef TCP_PERF_TX_PORT
+	#define TCP_PERF_TX_PORT		(9762u)
+#endif
+#ifndef TCP_PERF_RX_PORT
+	#define TCP_PERF_RX_PORT		(9763u)
+#endif
+#ifndef TCP_PERF_RR_PORT
+	#define TCP_PERF_RR_PORT		(9764u)
+#endif
+#ifndef TCP_PERF_STATS_PORT
+	#define TCP_PERF_STATS_PORT		(9765u)
+#endif
+
+// Clients each test can serve at once
+#ifndef TCP_PERF_SOCKETS
+	#define TCP_PERF_SOCKETS		(1u)
+#endif
+
+// Largest RR request, the echo buffer is this big
+#ifndef TCP_PERF_RR_MAX_SIZE
+	#define TCP_PERF_RR_MAX_SIZE	(256u)
+#endif
+
+#define TCP_PERF_TEST_TX			(0u)
+#define TCP_PERF_TEST_RX			(1u)
+#define TCP_PERF_TEST_RR			(2u)
+#define TCP_PERF_TESTS				(3u)
+
+typedef struct
+{
+	DWORD	dwBytes;			// bytes queued to send (TX), received (RX) or echoed (RR)
+	DWORD	dwMs;				// from connect to close
+	DWORD	dwExchanges;		// RR requests answered
+	DWORD	dwSRTTMs;			// smoothed round trip time when the session ended
+	WORD	wRetransmits;		// timer and fast retransmits together
+	IP_ADDR	RemoteIP;
+	DWORD	dwSessions;			// sessions of this test finished so far
+} TCP_PERF_RESULT;
+
 void TCPPerformanceTask(void);
+BOOL TCPPerformanceGetResult(BYTE vTest, TCP_PERF_RESULT *pResult);
 
 #endif
@@ -90,6 +90,14 @@ typedef struct
     WORD        Checksum;				// UDP checksum of the data
 } UDP_HEADER;
 
+// One datagram of a batch handed to UDPPutDatagrams()
+typedef struct
+{
+    const BYTE  *pData;					// Payload
+    WORD        wLength;				// Payload length in bytes
+    UDP_SOCKET  sRemote;				// Socket whose remote node and port it goes to, INVALID_UDP_SOCKET for the sending socket's
+} UDP_DATAGRAM;
+
 /****************************************************************************
   Section:
 	Function Prototypes
@@ -108,6 +116,7 @@ BOOL UDPPut(BYTE v);
 WORD UDPPutArray(BYTE *cData, WORD wDataLen);
 BYTE* UDPPutString(BYTE *strData);
 void UDPFlush(void);
+WORD UDPPutDatagrams(UDP_SOCKET s, const UDP_DATAGRAM *pDatagrams, WORD cDatagrams);
 
 // ROM function variants for PIC18
 #if defined(__18CXX)
@@ -51,6 +51,56 @@
 #ifndef __UDPPERFORMANCETEST_H
 #define __UDPPERFORMANCETEST_H
 
+// Blast test, driven from a PC by tools/dnetckperf.c.  UDP_PERF_SOCKETS
+// ports starting at UDP_PERF_PORT each answer whoever last sent to them:
+//   'T' 0 size(2) count(4) - we send count datagrams of size bytes back
+//   'D' 0 0 0 seq(4) ...   - one datagram of the client's blast to us
+//   'F'                    - the client's blast is over
+// Numbers are big endian and blast datagrams are numbered from 0.  After
+// each blast, either way, a line of text with the counts goes to the
+// client on the same port; datagrams never seen count as lost and ones
+// arriving behind a higher number count as reordered.
+
+#ifndef UDP_PERF_PORT
+	#define UDP_PERF_PORT			(9766u)
+#endif
+
+// Test ports, each needs a UDP socket
+#ifndef UDP_PERF_SOCKETS
+	#define UDP_PERF_SOCKETS		(1u)
+#endif
+
+// Largest datagram we send, the send buffer is this big
+#ifndef UDP_PERF_MAX_SIZE
+	#define UDP_PERF_MAX_SIZE		(1024u)
+#endif
+
+// Datagrams sent per call, before StackTask() gets to run again
+#ifndef UDP_PERF_BURST
+	#define UDP_PERF_BURST			(16u)
+#endif
+
+// A client blast that stops without an 'F' is reported after this long
+#ifndef UDP_PERF_IDLE_TIMEOUT
+	#define UDP_PERF_IDLE_TIMEOUT	(2ul*TICK_SECOND)
+#endif
+
+#define UDP_PERF_TEST_TX			(0u)
+#define UDP_PERF_TEST_RX			(1u)
+#define UDP_PERF_TESTS				(2u)
+
+typedef struct
+{
+	DWORD	dwDatagrams;		// sent (TX) or received (RX)
+	DWORD	dwBytes;
+	DWORD	dwLost;				// RX only, the client counts its own
+	DWORD	dwReordered;		// RX only
+	DWORD	dwMs;				// first to last datagram (RX), or whole blast (TX)
+	IP_ADDR	RemoteIP;
+	DWORD	dwSessions;			// sessions of this test finished so far
+} UDP_PERF_RESULT;
+
 void UDPPerformanceTask(void);
+BOOL UDPPerformanceGetResult(BYTE vTest, UDP_PERF_RESULT *pResult);
 
 #endif
@@ -36,7 +36,12 @@
 #ifndef DEFAULT_LAN_TCPIPConfig_X
 #define DEFAULT_LAN_TCPIPConfig_X
 
-#if defined (_BOARD_CEREBOT_MX7CK_)
+#if defined (HOST_MAC)
+
+    // the stack built with gcc on a PC, see tools/host/Makefile
+    #include <Host-TCPIPConfig.x>
+
+#elif defined (_BOARD_CEREBOT_MX7CK_)
 
     #include <MX7cK-SMSC-8720-TCPIPConfig.x>
 
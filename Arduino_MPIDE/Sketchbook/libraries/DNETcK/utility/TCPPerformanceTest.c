@@ -0,0 +1,424 @@
+/************************************************************************/
+/*																		*/
+/*	TCPPerformanceTest.c	--  TCP throughput and latency test servers */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Test servers for tools/dnetckperf.c, see TCPPerformanceTest.h.      */
+/*																		*/
+/************************************************************************/
+#define __TCPPERFORMANCETEST_C
+
+#include <stdio.h>
+
+#include "TCPIPConfig.h"
+
+#if defined(STACK_USE_TCP_PERFORMANCE_TEST)
+
+#include "TCPIP Stack/TCPIP.h"
+
+// One listening socket of one test
+typedef struct
+{
+	TCP_SOCKET	hTCP;
+	BYTE		vTest;			// TCP_PERF_TEST_*
+	BOOL		bActive;		// a client is connected
+	BOOL		bReport;		// a finished session still has to be reported
+	NODE_INFO	remote;			// the client, kept for the report
+	DWORD		dwStart;
+	DWORD		dwBytes;
+	DWORD		dwExchanges;
+	TCP_SOCKET_STATS stats;		// as of the last pass the client was connected
+	TCP_PERF_RESULT	result;		// the session being reported
+} TCP_PERF_SOCKET;
+
+static TCP_PERF_SOCKET	_rgSocket[TCP_PERF_TESTS * TCP_PERF_SOCKETS];
+static TCP_PERF_RESULT	_rgResult[TCP_PERF_TESTS];
+static BOOL				_bInitialized = FALSE;
+
+static BYTE				_rgbPattern[256];		// what the TX test sends, over and over
+static BYTE				_rgbExchange[TCP_PERF_RR_MAX_SIZE];
+
+static ROM WORD			_rgwPort[TCP_PERF_TESTS] = {TCP_PERF_TX_PORT, TCP_PERF_RX_PORT, TCP_PERF_RR_PORT};
+static ROM BYTE			_rgvPurpose[TCP_PERF_TESTS] = {TCP_PURPOSE_TCP_PERFORMANCE_TX, TCP_PURPOSE_TCP_PERFORMANCE_RX, TCP_PURPOSE_DEFAULT};
+static ROM char * ROM	_rgszName[TCP_PERF_TESTS] = {"tcp-tx", "tcp-rx", "tcp-rr"};
+
+/*****************************************************************************
+  Function:
+	static void StartSession(TCP_PERF_SOCKET *p)
+
+  Summary:
+	Starts counting for a client that just connected
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	p - the socket the client connected to
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void StartSession(TCP_PERF_SOCKET *p)
+{
+	p->bActive = TRUE;
+	p->dwStart = TickGet();
+	p->dwBytes = 0;
+	p->dwExchanges = 0;
+	p->stats = *TCPGetSocketStats(p->hTCP);
+	memcpy((void*)&p->remote, (void*)&TCPGetRemoteInfo(p->hTCP)->remote, sizeof(p->remote));
+}
+
+/*****************************************************************************
+  Function:
+	static void EndSession(TCP_PERF_SOCKET *p)
+
+  Summary:
+	Records the result of a session that just ended
+
+  Description:
+	The result becomes the test's last result and is queued to be sent
+	to the client's TCP_PERF_STATS_PORT.  The round trip time and
+	retransmissions come from p->stats: by now a reset may have closed
+	the socket, and closing clears them.
+
+  Precondition:
+	p->bActive
+
+  Parameters:
+	p - the socket whose client went away
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void EndSession(TCP_PERF_SOCKET *p)
+{
+	TCP_SOCKET_STATS *pStats = &p->stats;
+	TCP_PERF_RESULT *pResult = &p->result;
+
+	pResult->dwBytes = p->dwBytes;
+	pResult->dwMs = (DWORD)(((QWORD)(TickGet() - p->dwStart) * 1000ull) / TICK_SECOND);
+	pResult->dwExchanges = p->dwExchanges;
+	pResult->dwSRTTMs = (DWORD)(((QWORD)pStats->dwSRTT * 1000ull) / TICK_SECOND);
+	pResult->wRetransmits = pStats->wRetransmits + pStats->wFastRetransmits;
+	pResult->RemoteIP = p->remote.IPAddr;
+	pResult->dwSessions = _rgResult[p->vTest].dwSessions + 1;
+
+	_rgResult[p->vTest] = *pResult;
+
+	p->bActive = FALSE;
+	p->bReport = TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	static void SendReport(TCP_PERF_SOCKET *p)
+
+  Summary:
+	Sends a finished session's result to the client as a line of text
+
+  Description:
+	The line goes in one UDP datagram to TCP_PERF_STATS_PORT on the
+	client, for example
+	"tcp-rx bytes=1048576 ms=2290 kbps=3663 exchanges=0 srtt_ms=1 rexmit=0".
+	The client's MAC is already known from the TCP connection, so no
+	ARP is needed.
+
+  Precondition:
+	p->bReport
+
+  Parameters:
+	p - the socket whose result is waiting
+
+  Returns:
+  	None; if the MAC is busy the report is tried again on the next call
+  ***************************************************************************/
+static void SendReport(TCP_PERF_SOCKET *p)
+{
+	char szReport[120];
+	UDP_SOCKET s;
+	WORD wLength;
+	DWORD dwKbps;
+
+	s = UDPOpen(0, &p->remote, TCP_PERF_STATS_PORT);
+	if(s == INVALID_UDP_SOCKET)
+		return;
+
+	if(UDPIsPutReady(s) >= sizeof(szReport))
+	{
+		dwKbps = p->result.dwMs ? (DWORD)(((QWORD)p->result.dwBytes * 8ull) / p->result.dwMs) : 0;
+		wLength = sprintf(szReport, "%s bytes=%lu ms=%lu kbps=%lu exchanges=%lu srtt_ms=%lu rexmit=%u\n",
+			_rgszName[p->vTest], (unsigned long)p->result.dwBytes, (unsigned long)p->result.dwMs,
+			(unsigned long)dwKbps, (unsigned long)p->result.dwExchanges,
+			(unsigned long)p->result.dwSRTTMs, (unsigned int)p->result.wRetransmits);
+		UDPPutArray((BYTE*)szReport, wLength);
+		UDPFlush();
+		p->bReport = FALSE;
+	}
+
+	UDPClose(s);
+}
+
+/*****************************************************************************
+  Function:
+	static void ServeTX(TCP_PERF_SOCKET *p)
+
+  Summary:
+	Keeps the TX FIFO full of the test pattern
+
+  Description:
+	None
+
+  Precondition:
+	p->hTCP is connected
+
+  Parameters:
+	p - the socket to fill
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void ServeTX(TCP_PERF_SOCKET *p)
+{
+	WORD wReady, wPut;
+
+	// whatever the client sends is ignored
+	TCPDiscard(p->hTCP);
+
+	while((wReady = TCPIsPutReady(p->hTCP)) != 0u)
+	{
+		wPut = TCPPutArray(p->hTCP, _rgbPattern, wReady < sizeof(_rgbPattern) ? wReady : sizeof(_rgbPattern));
+		p->dwBytes += wPut;
+		if(wPut == 0u)
+			break;
+	}
+
+	TCPFlush(p->hTCP);
+}
+
+/*****************************************************************************
+  Function:
+	static void ServeRX(TCP_PERF_SOCKET *p)
+
+  Summary:
+	Counts and throws away whatever the client sends
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	p - the socket to drain
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void ServeRX(TCP_PERF_SOCKET *p)
+{
+	p->dwBytes += TCPIsGetReady(p->hTCP);
+	TCPDiscard(p->hTCP);
+}
+
+/*****************************************************************************
+  Function:
+	static BOOL ServeRR(TCP_PERF_SOCKET *p)
+
+  Summary:
+	Echoes each whole request back as its response
+
+  Description:
+	A request starts with its total length, 2 bytes big-endian and
+	counting the length itself.  Once all of it is in the RX FIFO and
+	there is room in the TX FIFO it is sent back unchanged, so the
+	client can time each exchange.
+
+  Precondition:
+	p->hTCP is connected
+
+  Parameters:
+	p - the socket to serve
+
+  Returns:
+  	FALSE if the client sent a length outside 2 to TCP_PERF_RR_MAX_SIZE
+  ***************************************************************************/
+static BOOL ServeRR(TCP_PERF_SOCKET *p)
+{
+	WORD wLength;
+
+	while(TCPIsGetReady(p->hTCP) >= 2u)
+	{
+		wLength = ((WORD)TCPPeek(p->hTCP, 0) << 8) | TCPPeek(p->hTCP, 1);
+		if(wLength < 2u || wLength > TCP_PERF_RR_MAX_SIZE)
+			return FALSE;
+
+		if(TCPIsGetReady(p->hTCP) < wLength || TCPIsPutReady(p->hTCP) < wLength)
+			break;
+
+		TCPGetArray(p->hTCP, _rgbExchange, wLength);
+		TCPPutArray(p->hTCP, _rgbExchange, wLength);
+		TCPFlush(p->hTCP);
+
+		p->dwBytes += wLength;
+		p->dwExchanges++;
+	}
+
+	return TRUE;
+}
+
+/*****************************************************************************
+  Function:
+	void TCPPerformanceTask(void)
+
+  Summary:
+	Runs the TCP test servers
+
+  Description:
+	Opens TCP_PERF_SOCKETS listening sockets for each test the first
+	time it can, then serves whichever have clients.  A session runs
+	from the client connecting until it closes or resets the
+	connection; its result is then kept for TCPPerformanceGetResult()
+	and sent to the client's TCP_PERF_STATS_PORT.
+
+  Precondition:
+	TCP and UDP are initialized
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+void TCPPerformanceTask(void)
+{
+	TCP_PERF_SOCKET *p;
+	WORD i;
+
+	if(!_bInitialized)
+	{
+		for(i = 0; i < sizeof(_rgbPattern); i++)
+			_rgbPattern[i] = (BYTE)i;
+
+		for(i = 0, p = _rgSocket; i < sizeof(_rgSocket) / sizeof(_rgSocket[0]); i++, p++)
+		{
+			p->hTCP = INVALID_SOCKET;
+			p->vTest = (BYTE)(i / TCP_PERF_SOCKETS);
+		}
+
+		_bInitialized = TRUE;
+	}
+
+	for(i = 0, p = _rgSocket; i < sizeof(_rgSocket) / sizeof(_rgSocket[0]); i++, p++)
+	{
+		if(p->hTCP == INVALID_SOCKET)
+		{
+			// there may not be a socket of this purpose free yet, try again next time
+			p->hTCP = TCPOpen(0, TCP_OPEN_SERVER, _rgwPort[p->vTest], _rgvPurpose[p->vTest]);
+			if(p->hTCP == INVALID_SOCKET)
+				continue;
+		}
+
+		if(p->bReport)
+			SendReport(p);
+
+		// a reset puts the server socket straight back to listening
+		if(TCPWasReset(p->hTCP))
+		{
+			if(p->bActive)
+				EndSession(p);
+			continue;
+		}
+
+		if(!TCPIsConnected(p->hTCP))
+		{
+			if(p->bActive)
+			{
+				// the client closed, count what it sent last, then close our side
+				if(p->vTest == TCP_PERF_TEST_RX)
+					ServeRX(p);
+				EndSession(p);
+				TCPDisconnect(p->hTCP);
+			}
+			continue;
+		}
+
+		if(!p->bActive)
+			StartSession(p);
+
+		switch(p->vTest)
+		{
+			case TCP_PERF_TEST_TX:
+				ServeTX(p);
+				break;
+
+			case TCP_PERF_TEST_RX:
+				ServeRX(p);
+				break;
+
+			case TCP_PERF_TEST_RR:
+				if(!ServeRR(p))
+				{
+					EndSession(p);
+					TCPDisconnect(p->hTCP);
+					continue;
+				}
+				break;
+		}
+
+		p->stats = *TCPGetSocketStats(p->hTCP);
+	}
+}
+
+/*****************************************************************************
+  Function:
+	BOOL TCPPerformanceGetResult(BYTE vTest, TCP_PERF_RESULT *pResult)
+
+  Summary:
+	Gets the result of the last finished session of a test
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	vTest - TCP_PERF_TEST_TX, TCP_PERF_TEST_RX or TCP_PERF_TEST_RR
+	pResult - receives the result
+
+  Returns:
+  	TRUE if a session of that test has finished, FALSE if not
+  ***************************************************************************/
+BOOL TCPPerformanceGetResult(BYTE vTest, TCP_PERF_RESULT *pResult)
+{
+	if(vTest >= TCP_PERF_TESTS || _rgResult[vTest].dwSessions == 0u)
+		return FALSE;
+
+	*pResult = _rgResult[vTest];
+	return TRUE;
+}
+
+#endif //#if defined(STACK_USE_TCP_PERFORMANCE_TEST)
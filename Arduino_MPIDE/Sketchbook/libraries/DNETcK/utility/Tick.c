@@ -57,6 +57,13 @@
 
 #include "TCPIP Stack/TCPIP.h"
 
+#if defined(HOST_MAC)
+	#include <time.h>
+
+	// Host builds count ticks from the monotonic clock, there is no Timer 1
+	static struct timespec tsTickStart;
+#endif
+
 // Internal counter to store Ticks.  This variable is incremented in an ISR and 
 // therefore must be marked volatile to prevent the compiler optimizer from 
 // reordering code to use this value in the main context while interrupts are 
@@ -107,6 +114,9 @@ void TickInit(void)
     // Timer0 on, 16-bit, internal timer, 1:256 prescalar
     T0CON = 0x87;
 
+#elif defined(HOST_MAC)
+	clock_gettime(CLOCK_MONOTONIC, &tsTickStart);
+
 #else
 	// Use Timer 1 for 16-bit and 32-bit processors
 	// 1:256 prescale
@@ -192,6 +202,19 @@ static void GetTickCopy(void)
 		vTickReading[5] = ((BYTE*)&dwTempTicks)[3];
 	} while(IFS0bits.T1IF);
 	IEC0bits.T1IE = 1;				// Enable interrupt
+#elif defined(HOST_MAC)
+	struct timespec ts;
+	QWORD qwTicks;
+
+	// Scale seconds and nanoseconds separately so nothing overflows
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	qwTicks = (QWORD)(ts.tv_sec - tsTickStart.tv_sec) * TICKS_PER_SECOND +
+			  (QWORD)ts.tv_nsec * TICKS_PER_SECOND / 1000000000ull -
+			  (QWORD)tsTickStart.tv_nsec * TICKS_PER_SECOND / 1000000000ull;
+
+	// Low 6 bytes, the host is little endian like the PIC
+	memcpy(vTickReading, &qwTicks, sizeof(vTickReading));
+
 #else	// PIC32
 	do
 	{
@@ -424,6 +447,8 @@ void __attribute((interrupt(ipl2), vector(_TIMER_1_VECTOR), nomips16)) _T1Interr
 	// Reset interrupt flag
 	IFS0CLR = _IFS0_T1IF_MASK;
 }
+#elif defined(HOST_MAC)
+	// No tick interrupt, GetTickCopy() reads the clock directly
 #else
 #if __C30_VERSION__ >= 300
 void _ISR __attribute__((__no_auto_psv__)) _T1Interrupt(void)
@@ -101,6 +101,12 @@
 // Last port number for randomized local port number selection
 #define LOCAL_UDP_PORT_END_NUMBER   (8192u)
 
+// Number of local port hash chains used to find the socket for a received 
+// segment, must be a power of 2
+#ifndef UDP_PORT_HASH_BUCKETS
+	#define UDP_PORT_HASH_BUCKETS	8u
+#endif
+
 /****************************************************************************
   Section:
 	UDP Global Variables
@@ -128,6 +134,12 @@ static struct
 // Indicates which socket has currently received data for this loop
 static UDP_SOCKET SocketWithRxData = INVALID_UDP_SOCKET;
 
+// Open sockets chained by local port, INVALID_UDP_SOCKET ends a chain
+static UDP_SOCKET UDPPortHashHeads[UDP_PORT_HASH_BUCKETS];
+static UDP_SOCKET UDPPortHashNext[MAX_UDP_SOCKETS];
+
+#define UDPPortHash(port)	(((port) ^ ((port) >> 8)) & (UDP_PORT_HASH_BUCKETS-1u))
+
 /****************************************************************************
   Section:
 	Function Prototypes
@@ -178,6 +190,7 @@ void UDPInit(void)
     UDPRxCount = 0;	
     wPutOffset = 0;
     wGetOffset = 0;
+    memset(UDPPortHashHeads, INVALID_UDP_SOCKET, sizeof(UDPPortHashHeads));
 
     for ( s = 0; s < MAX_UDP_SOCKETS; s++ )
     {
@@ -260,6 +273,7 @@ UDP_SOCKET UDPOpen(UDP_PORT localPort,
 {
     UDP_SOCKET s;
     UDP_SOCKET_INFO *p;
+	UDP_SOCKET *pLink;
 
 	// Local temp port numbers.
 	static WORD NextPort __attribute__((persistent));
@@ -295,6 +309,14 @@ UDP_SOCKET UDPOpen(UDP_PORT localPort,
 
             p->remotePort   = remotePort;
 
+			// Put it on its local port's hash chain so FindMatchingSocket() sees 
+			// it.  Chains are kept in socket order, the order the full scan used.
+			pLink = &UDPPortHashHeads[UDPPortHash(p->localPort)];
+			while(*pLink < s)
+				pLink = &UDPPortHashNext[*pLink];
+			UDPPortHashNext[s] = *pLink;
+			*pLink = s;
+
             // Mark this socket as active.
             // Once an active socket is set, subsequent operation can be
             // done without explicitely supply socket identifier.
@@ -336,9 +358,26 @@ UDP_SOCKET UDPOpen(UDP_PORT localPort,
   ***************************************************************************/
 void UDPClose(UDP_SOCKET s)
 {
+	UDP_SOCKET *pLink;
+
 	if(s >= MAX_UDP_SOCKETS)
 		return;
 
+	// Unlink it from its hash chain; a free socket is on no chain
+	if(UDPSocketInfo[s].localPort != INVALID_UDP_PORT)
+	{
+		pLink = &UDPPortHashHeads[UDPPortHash(UDPSocketInfo[s].localPort)];
+		while(*pLink != INVALID_UDP_SOCKET)
+		{
+			if(*pLink == s)
+			{
+				*pLink = UDPPortHashNext[s];
+				break;
+			}
+			pLink = &UDPPortHashNext[*pLink];
+		}
+	}
+
 	UDPSocketInfo[s].localPort = INVALID_UDP_PORT;
 	UDPSocketInfo[s].remoteNode.IPAddr.Val = 0x00000000;
 }
@@ -735,6 +774,129 @@ void UDPFlush(void)
 	LastPutSocket = INVALID_UDP_SOCKET;
 }
 
+/*****************************************************************************
+  Function:
+	WORD UDPPutDatagrams(UDP_SOCKET s, const UDP_DATAGRAM *pDatagrams, 
+							WORD cDatagrams)
+
+  Summary:
+	Sends a batch of datagrams from a socket, back to back.
+
+  Description:
+	Each datagram goes to the remote node and port of its sRemote socket, 
+	or of s if that is INVALID_UDP_SOCKET, one frame each, just as if it 
+	had been written with UDPPutArray() and sent with UDPFlush() from s.  
+	The IP and UDP headers are built once for each run of datagrams to 
+	the same destination; per datagram only the lengths and the IP 
+	identifier are patched in and the checksums are updated to match.  The UDP checksum of the payload 
+	is summed from the caller's buffer, not read back from the MAC.
+
+  Precondition:
+	UDPOpen() returned s and the sRemote sockets, and their remote nodes 
+	are resolved.
+
+  Parameters:
+	s - The socket to send from
+	pDatagrams - Array of datagrams to send
+	cDatagrams - Number of entries in pDatagrams
+
+  Returns:
+  	The number of datagrams sent.  This is less than cDatagrams if one 
+  	is too big to fit in the MAC TX buffer or its sRemote is not an open 
+  	socket; nothing after it is sent.
+  	
+  Remarks:
+	This waits for the MAC to finish with each frame before writing the 
+	next, like ARP does.  Anything written with UDPPut*() but not yet 
+	flushed is thrown away.
+  ***************************************************************************/
+WORD UDPPutDatagrams(UDP_SOCKET s, const UDP_DATAGRAM *pDatagrams, WORD cDatagrams)
+{
+    UDP_HEADER      h;
+    UDP_SOCKET_INFO *p;
+    UDP_SOCKET      r;
+    IP_HEADER       ipHeader;
+    WORD			wUDPLength;
+    WORD			i;
+	#if defined(UDP_USE_TX_CHECKSUM)
+    struct
+    {
+        PSEUDO_HEADER   pseudoHeader;
+        UDP_HEADER      h;
+    } sumHeader;
+    WORD			wHeaderChecksum = 0;
+	#endif
+
+	if(s >= MAX_UDP_SOCKETS || UDPSocketInfo[s].localPort == INVALID_UDP_PORT)
+		return 0;
+
+    h.SourcePort        = swaps(UDPSocketInfo[s].localPort);
+    p = NULL;
+
+	for(i = 0; i < cDatagrams; i++)
+	{
+		if(pDatagrams[i].wLength > MAC_TX_BUFFER_SIZE - sizeof(IP_HEADER) - sizeof(UDP_HEADER))
+			break;
+
+		r = (pDatagrams[i].sRemote == INVALID_UDP_SOCKET) ? s : pDatagrams[i].sRemote;
+		if(r >= MAX_UDP_SOCKETS || UDPSocketInfo[r].localPort == INVALID_UDP_PORT)
+			break;
+
+		// Headers that are the same up to the next change of 
+		// destination, lengths left 0
+		if(p != &UDPSocketInfo[r])
+		{
+		    p = &UDPSocketInfo[r];
+			IPInitHeaderTemplate(&ipHeader, &p->remoteNode, IP_PROT_UDP);
+
+		    h.DestinationPort   = swaps(p->remotePort);
+		    h.Length            = 0x0000;
+			h.Checksum 			= 0x0000;
+
+			#if defined(UDP_USE_TX_CHECKSUM)
+			{
+				sumHeader.pseudoHeader.SourceAddress	= AppConfig.MyIPAddr;
+				sumHeader.pseudoHeader.DestAddress		= p->remoteNode.IPAddr;
+				sumHeader.pseudoHeader.Zero				= 0x0;
+				sumHeader.pseudoHeader.Protocol			= IP_PROT_UDP;
+				sumHeader.pseudoHeader.Length			= 0x0000;
+				sumHeader.h								= h;
+				wHeaderChecksum = CalcIPChecksum((BYTE*)&sumHeader, sizeof(sumHeader));
+			}
+			#endif
+		}
+
+		wUDPLength = pDatagrams[i].wLength + sizeof(UDP_HEADER);
+		h.Length = swaps(wUDPLength);
+
+		// The length is in both the pseudo header and the UDP header, 
+		// then fold in the payload's own sum
+		#if defined(UDP_USE_TX_CHECKSUM)
+		{
+			h.Checksum = UpdateIPChecksum(wHeaderChecksum, 0x0000, h.Length);
+			h.Checksum = UpdateIPChecksum(h.Checksum, 0x0000, h.Length);
+			h.Checksum = UpdateIPChecksum(h.Checksum, 0x0000, (WORD)~CalcIPChecksum((BYTE*)pDatagrams[i].pData, pDatagrams[i].wLength));
+			if(h.Checksum == 0x0000u)
+				h.Checksum = 0xFFFF;
+		}
+		#endif
+
+		// The MAC may still be sending the last one
+		while(!MACIsTxReady());
+
+		IPPutHeaderTemplate(&ipHeader, &p->remoteNode, wUDPLength);
+		MACPutArray((BYTE*)&h, sizeof(h));
+		MACPutArray((BYTE*)pDatagrams[i].pData, pDatagrams[i].wLength);
+		MACFlush();
+	}
+
+	// The TX buffer was reused, start the next UDPPut*() over
+    UDPTxCount = 0;
+	LastPutSocket = INVALID_UDP_SOCKET;
+
+	return i;
+}
+
 
 
 /****************************************************************************
@@ -1003,7 +1165,10 @@ BOOL UDPProcess(NODE_INFO *remoteNode, IP_ADDR *localIP, WORD len)
 	
   Description:
 	This function attempts to match an incoming UDP segment to a currently
-	active socket for processing.
+	active socket for processing.  Only the sockets on the destination 
+	port's hash chain are checked, in socket order.  The first socket 
+	whose remote IP and port also match wins; otherwise the last socket on 
+	the port is bound to the sender.
 
   Precondition:
 	UDP segment header and IP header have both been retrieved.
@@ -1040,9 +1205,10 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
 
 	partialMatch = INVALID_UDP_SOCKET;
 
-	p = UDPSocketInfo;
-    for(s = 0; s < MAX_UDP_SOCKETS; s++)
+	for(s = UDPPortHashHeads[UDPPortHash(h->DestinationPort)]; s != INVALID_UDP_SOCKET; s = UDPPortHashNext[s])
 	{
+		p = &UDPSocketInfo[s];
+
 		// This packet is said to be matching with current socket:
 		// 1. If its destination port matches with our local port and
 		// 2. Packet source IP address matches with previously saved socket remote IP address and
@@ -1059,7 +1225,6 @@ static UDP_SOCKET FindMatchingSocket(UDP_HEADER *h,
 
 			partialMatch = s;
 		}
-		p++;
 	}
 
 	if(partialMatch != INVALID_UDP_SOCKET)
@@ -0,0 +1,365 @@
+/************************************************************************/
+/*																		*/
+/*	UDPPerformanceTest.c	--  UDP blast test with loss accounting     */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Test server for tools/dnetckperf.c, see UDPPerformanceTest.h.       */
+/*																		*/
+/************************************************************************/
+#define __UDPPERFORMANCETEST_C
+
+#include <stdio.h>
+
+#include "TCPIPConfig.h"
+
+#if defined(STACK_USE_UDP_PERFORMANCE_TEST)
+
+#include "TCPIP Stack/TCPIP.h"
+
+#define UDP_PERF_CMD_BLAST		'T'		// T 0 size(2) count(4): send count datagrams of size bytes
+#define UDP_PERF_CMD_DATA		'D'		// D 0 0 0 seq(4) ...: one datagram of a blast
+#define UDP_PERF_CMD_FINISH		'F'		// F: the blast to us is over, report
+#define UDP_PERF_HEADER_SIZE	(8u)
+
+// One test port
+typedef struct
+{
+	UDP_SOCKET	s;
+
+	// our blast to the client
+	BOOL		bBlasting;
+	DWORD		dwSeq;				// next sequence number to send
+	DWORD		dwCount;
+	WORD		wSize;
+	DWORD		dwTxStart;
+
+	// the client's blast to us
+	BOOL		bReceiving;
+	DWORD		dwReceived;
+	DWORD		dwBytes;
+	DWORD		dwNextSeq;			// one past the highest sequence number seen
+	DWORD		dwReordered;
+	DWORD		dwRxStart;
+	DWORD		dwRxLast;
+} UDP_PERF_PORT_STATE;
+
+static UDP_PERF_PORT_STATE	_rgPort[UDP_PERF_SOCKETS];
+static UDP_PERF_RESULT		_rgResult[UDP_PERF_TESTS];
+static BOOL					_bInitialized = FALSE;
+
+static BYTE					_rgbDatagram[UDP_PERF_MAX_SIZE];
+
+static DWORD GetBE32(const BYTE *p)
+{
+	return ((DWORD)p[0] << 24) | ((DWORD)p[1] << 16) | ((DWORD)p[2] << 8) | p[3];
+}
+
+static void PutBE32(BYTE *p, DWORD dw)
+{
+	p[0] = (BYTE)(dw >> 24);
+	p[1] = (BYTE)(dw >> 16);
+	p[2] = (BYTE)(dw >> 8);
+	p[3] = (BYTE)dw;
+}
+
+static DWORD TicksToMs(DWORD dwTicks)
+{
+	return (DWORD)(((QWORD)dwTicks * 1000ull) / TICK_SECOND);
+}
+
+/*****************************************************************************
+  Function:
+	static void SendReport(UDP_PERF_PORT_STATE *p, BYTE vTest)
+
+  Summary:
+	Records a finished session and sends it to the client as text
+
+  Description:
+	The line goes to the client's port on the test socket, for example
+	"udp-rx datagrams=9871 bytes=10107904 lost=129 reordered=0 ms=10004".
+	For a blast we sent, this line follows the last datagram and tells
+	the client how many went out; it counts its own losses.
+
+  Precondition:
+	The socket's remote node is the client
+
+  Parameters:
+	p - the test port
+	vTest - UDP_PERF_TEST_TX or UDP_PERF_TEST_RX
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void SendReport(UDP_PERF_PORT_STATE *p, BYTE vTest)
+{
+	UDP_PERF_RESULT *pResult = &_rgResult[vTest];
+	UDP_DATAGRAM dg;
+	char szReport[120];
+
+	if(vTest == UDP_PERF_TEST_TX)
+	{
+		pResult->dwDatagrams = p->dwSeq;
+		pResult->dwBytes = p->dwSeq * p->wSize;
+		pResult->dwLost = 0;
+		pResult->dwReordered = 0;
+		pResult->dwMs = TicksToMs(TickGet() - p->dwTxStart);
+	}
+	else
+	{
+		pResult->dwDatagrams = p->dwReceived;
+		pResult->dwBytes = p->dwBytes;
+		pResult->dwLost = p->dwNextSeq > p->dwReceived ? p->dwNextSeq - p->dwReceived : 0;
+		pResult->dwReordered = p->dwReordered;
+		pResult->dwMs = TicksToMs(p->dwRxLast - p->dwRxStart);
+	}
+	pResult->RemoteIP = UDPSocketInfo[p->s].remoteNode.IPAddr;
+	pResult->dwSessions++;
+
+	dg.pData = (const BYTE*)szReport;
+	dg.sRemote = INVALID_UDP_SOCKET;
+	dg.wLength = sprintf(szReport, "%s datagrams=%lu bytes=%lu lost=%lu reordered=%lu ms=%lu\n",
+		vTest == UDP_PERF_TEST_TX ? "udp-tx" : "udp-rx",
+		(unsigned long)pResult->dwDatagrams, (unsigned long)pResult->dwBytes,
+		(unsigned long)pResult->dwLost, (unsigned long)pResult->dwReordered,
+		(unsigned long)pResult->dwMs);
+	UDPPutDatagrams(p->s, &dg, 1);
+}
+
+/*****************************************************************************
+  Function:
+	static void Receive(UDP_PERF_PORT_STATE *p)
+
+  Summary:
+	Handles a datagram from the client
+
+  Description:
+	Data datagrams are counted; a sequence number below the highest
+	seen so far counts as reordered, and any numbers never seen by the
+	time the client says it is finished count as lost.
+
+  Precondition:
+	UDPIsGetReady(p->s) is not 0
+
+  Parameters:
+	p - the test port
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void Receive(UDP_PERF_PORT_STATE *p)
+{
+	BYTE rgbHeader[UDP_PERF_HEADER_SIZE];
+	WORD wLength = UDPIsGetReady(p->s);
+	DWORD dwSeq;
+
+	// only a finish fits in less than a header
+	if(UDPGetArray(rgbHeader, sizeof(rgbHeader)) < sizeof(rgbHeader) && rgbHeader[0] != UDP_PERF_CMD_FINISH)
+		rgbHeader[0] = 0;
+	UDPDiscard();
+
+	switch(rgbHeader[0])
+	{
+		case UDP_PERF_CMD_DATA:
+			dwSeq = GetBE32(&rgbHeader[4]);
+			if(!p->bReceiving)
+			{
+				p->bReceiving = TRUE;
+				p->dwReceived = 0;
+				p->dwBytes = 0;
+				p->dwNextSeq = 0;
+				p->dwReordered = 0;
+				p->dwRxStart = TickGet();
+			}
+			p->dwReceived++;
+			p->dwBytes += wLength;
+			p->dwRxLast = TickGet();
+			if(dwSeq < p->dwNextSeq)
+				p->dwReordered++;
+			else
+				p->dwNextSeq = dwSeq + 1;
+			break;
+
+		case UDP_PERF_CMD_FINISH:
+			if(p->bReceiving)
+			{
+				SendReport(p, UDP_PERF_TEST_RX);
+				p->bReceiving = FALSE;
+			}
+			break;
+
+		case UDP_PERF_CMD_BLAST:
+			p->wSize = ((WORD)rgbHeader[2] << 8) | rgbHeader[3];
+			if(p->wSize < UDP_PERF_HEADER_SIZE)
+				p->wSize = UDP_PERF_HEADER_SIZE;
+			if(p->wSize > UDP_PERF_MAX_SIZE)
+				p->wSize = UDP_PERF_MAX_SIZE;
+			p->dwCount = GetBE32(&rgbHeader[4]);
+			p->dwSeq = 0;
+			p->dwTxStart = TickGet();
+			p->bBlasting = TRUE;
+			break;
+	}
+}
+
+/*****************************************************************************
+  Function:
+	static void Blast(UDP_PERF_PORT_STATE *p)
+
+  Summary:
+	Sends the next burst of a blast to the client
+
+  Description:
+	Up to UDP_PERF_BURST datagrams go out back to back per call, each
+	carrying its sequence number.  After the last one the report is
+	sent.
+
+  Precondition:
+	p->bBlasting
+
+  Parameters:
+	p - the test port
+
+  Returns:
+  	None
+  ***************************************************************************/
+static void Blast(UDP_PERF_PORT_STATE *p)
+{
+	UDP_DATAGRAM dg;
+	WORD i;
+
+	dg.pData = _rgbDatagram;
+	dg.wLength = p->wSize;
+	dg.sRemote = INVALID_UDP_SOCKET;
+
+	_rgbDatagram[0] = UDP_PERF_CMD_DATA;
+	_rgbDatagram[1] = 0;
+	_rgbDatagram[2] = 0;
+	_rgbDatagram[3] = 0;
+
+	for(i = 0; i < UDP_PERF_BURST && p->dwSeq < p->dwCount; i++)
+	{
+		PutBE32(&_rgbDatagram[4], p->dwSeq);
+		if(UDPPutDatagrams(p->s, &dg, 1) == 0u)
+			break;
+		p->dwSeq++;
+	}
+
+	if(p->dwSeq >= p->dwCount)
+	{
+		SendReport(p, UDP_PERF_TEST_TX);
+		p->bBlasting = FALSE;
+	}
+}
+
+/*****************************************************************************
+  Function:
+	void UDPPerformanceTask(void)
+
+  Summary:
+	Runs the UDP test ports
+
+  Description:
+	Opens UDP_PERF_SOCKETS sockets on UDP_PERF_PORT and the ports after
+	it, then handles whatever the clients send and continues any blast
+	in progress.  Nothing is sent until a client asks; a client that
+	goes quiet for UDP_PERF_IDLE_TIMEOUT in the middle of its own blast
+	gets its report anyway.
+
+  Precondition:
+	UDP is initialized
+
+  Parameters:
+	None
+
+  Returns:
+  	None
+  ***************************************************************************/
+void UDPPerformanceTask(void)
+{
+	UDP_PERF_PORT_STATE *p;
+	WORD i;
+
+	if(!_bInitialized)
+	{
+		for(i = 0; i < sizeof(_rgbDatagram); i++)
+			_rgbDatagram[i] = (BYTE)i;
+
+		for(i = 0; i < UDP_PERF_SOCKETS; i++)
+			_rgPort[i].s = INVALID_UDP_SOCKET;
+
+		_bInitialized = TRUE;
+	}
+
+	for(i = 0, p = _rgPort; i < UDP_PERF_SOCKETS; i++, p++)
+	{
+		if(p->s == INVALID_UDP_SOCKET)
+		{
+			p->s = UDPOpen(UDP_PERF_PORT + i, NULL, INVALID_UDP_PORT);
+			if(p->s == INVALID_UDP_SOCKET)
+				continue;
+		}
+
+		while(UDPIsGetReady(p->s))
+			Receive(p);
+
+		if(p->bBlasting)
+			Blast(p);
+
+		if(p->bReceiving && TickGet() - p->dwRxLast > UDP_PERF_IDLE_TIMEOUT)
+		{
+			SendReport(p, UDP_PERF_TEST_RX);
+			p->bReceiving = FALSE;
+		}
+	}
+}
+
+/*****************************************************************************
+  Function:
+	BOOL UDPPerformanceGetResult(BYTE vTest, UDP_PERF_RESULT *pResult)
+
+  Summary:
+	Gets the result of the last finished session of a test
+
+  Description:
+	None
+
+  Precondition:
+	None
+
+  Parameters:
+	vTest - UDP_PERF_TEST_TX or UDP_PERF_TEST_RX
+	pResult - receives the result
+
+  Returns:
+  	TRUE if a session of that test has finished, FALSE if not
+  ***************************************************************************/
+BOOL UDPPerformanceGetResult(BYTE vTest, UDP_PERF_RESULT *pResult)
+{
+	if(vTest >= UDP_PERF_TESTS || _rgResult[vTest].dwSessions == 0u)
+		return FALSE;
+
+	*pResult = _rgResult[vTest];
+	return TRUE;
+}
+
+#endif //#if defined(STACK_USE_UDP_PERFORMANCE_TEST)
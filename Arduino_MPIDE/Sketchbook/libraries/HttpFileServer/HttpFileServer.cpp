@@ -0,0 +1,896 @@
+/************************************************************************/
+/*																		*/
+/*	HttpFileServer.cpp	--  Static file HTTP/1.1 server for DNETcK      */
+/*                          serving from the chipKIT MDD File System    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	This implements the HttpFileServer Class, see HttpFileServer.h      */
+/*																		*/
+/************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <chipKITUSBHost.h>
+#include <chipKITUSBMSDHost.h>
+#include <chipKITMDDFS.h>
+#include <DNETcK.h>
+#include "HttpFileServer.h"
+
+typedef struct
+{
+    const char *    szExt;
+    const char *    szType;
+} CONTENT_TYPE;
+
+static const CONTENT_TYPE rgContentType[] =
+{
+    {"HTM", "text/html"},
+    {"HTML","text/html"},
+    {"TXT", "text/plain"},
+    {"LOG", "text/plain"},
+    {"CSV", "text/csv"},
+    {"CSS", "text/css"},
+    {"JS",  "application/javascript"},
+    {"JSN", "application/json"},
+    {"XML", "text/xml"},
+    {"PNG", "image/png"},
+    {"JPG", "image/jpeg"},
+    {"GIF", "image/gif"},
+    {"ICO", "image/x-icon"},
+    {"PDF", "application/pdf"},
+};
+
+/***	bool startsWithNoCase(const char * sz, const char * szPrefix)
+**
+**	Synopsis:
+**      Case insensitive check that sz starts with szPrefix
+**
+*/
+static bool startsWithNoCase(const char * sz, const char * szPrefix)
+{
+    for( ; *szPrefix != '\0'; sz++, szPrefix++)
+    {
+        if(tolower(*sz) != tolower(*szPrefix))
+        {
+            return(false);
+        }
+    }
+    return(true);
+}
+
+/***	Prevent Copies
+**
+**  Notes:
+**
+**      These are private methods that prevent
+**      copying of the instance. They are
+**      dummy functions and are never used.
+**
+*/
+HttpFileServer&  HttpFileServer::operator=(HttpFileServer& httpFileServer){return(httpFileServer);}
+HttpFileServer::HttpFileServer(HttpFileServer& httpFileServer){};
+
+/***	HttpFileServer Constructor
+**
+**  Notes:
+**
+**      Every connection slot starts idle, nothing is listening
+**      until begin() is called.
+**
+*/
+HttpFileServer::HttpFileServer()
+{
+    _fStarted = false;
+    strcpy(_szIndex, "INDEX.HTM");
+
+    for(int i = 0; i < HTTP_MAX_CLIENTS; i++)
+    {
+        _rgConnection[i].state = stIdle;
+        _rgConnection[i].pFile = NULL;
+    }
+}
+
+/***	HttpFileServer Destructor
+**
+**  Notes:
+**
+**      Closes every client and stops listening
+**
+*/
+HttpFileServer::~HttpFileServer()
+{
+    end();
+}
+
+/***	bool HttpFileServer::begin(unsigned short localPort)
+**      bool HttpFileServer::begin(unsigned short localPort, const char * szIndex)
+**
+**	Synopsis:
+**      Starts listening for HTTP clients
+**
+**	Parameters:
+**      localPort   The port to listen on, usually 80
+**
+**      szIndex     The 8.3 file served for "/" and directory URLs, INDEX.HTM if not given
+**
+**	Return Values:
+**      true if the server is listening (or will be once the network is up), false otherwise
+**
+**	Errors:
+**      Anything TcpServer::startListening can fail with, or an index name that is not 8.3
+**
+**  Notes:
+**
+**      Call periodicTasks() every pass through loop() along with DNETcK::periodicTasks().
+**
+*/
+bool HttpFileServer::begin(unsigned short localPort)
+{
+    return(begin(localPort, "INDEX.HTM"));
+}
+bool HttpFileServer::begin(unsigned short localPort, const char * szIndex)
+{
+    if(_fStarted || strlen(szIndex) >= sizeof(_szIndex))
+    {
+        return(false);
+    }
+
+    strcpy(_szIndex, szIndex);
+    _fStarted = _tcpServer.startListening(localPort);
+
+    return(_fStarted);
+}
+
+/***	void HttpFileServer::end(void)
+**
+**	Synopsis:
+**      Drops every client, closes their files and stops listening
+**
+**	Parameters:
+**      None
+**
+**	Return Values:
+**      None
+**
+**	Errors:
+**      None
+**
+*/
+void HttpFileServer::end(void)
+{
+    for(int i = 0; i < HTTP_MAX_CLIENTS; i++)
+    {
+        closeConnection(&_rgConnection[i]);
+    }
+
+    _tcpServer.close();
+    _fStarted = false;
+}
+
+/***	int HttpFileServer::activeClients(void)
+**
+**	Synopsis:
+**      Gets the number of connection slots in use
+**
+**	Parameters:
+**      None
+**
+**	Return Values:
+**      Number of connected clients, 0 to HTTP_MAX_CLIENTS
+**
+**	Errors:
+**      None
+**
+*/
+int HttpFileServer::activeClients(void)
+{
+    int cActive = 0;
+
+    for(int i = 0; i < HTTP_MAX_CLIENTS; i++)
+    {
+        if(_rgConnection[i].state != stIdle)
+        {
+            cActive++;
+        }
+    }
+
+    return(cActive);
+}
+
+/***	void HttpFileServer::periodicTasks(void)
+**
+**	Synopsis:
+**      Runs every connection one step
+**
+**	Parameters:
+**      None
+**
+**	Return Values:
+**      None
+**
+**	Errors:
+**      None
+**
+**  Notes:
+**
+**      Never blocks: a connection that cannot move, because no request
+**      has arrived yet or its TX FIFO is full, is simply passed over
+**      until the next call.  Clients beyond HTTP_MAX_CLIENTS wait in the
+**      TcpServer accept queue until a slot frees up.
+**
+*/
+void HttpFileServer::periodicTasks(void)
+{
+    if(!_fStarted)
+    {
+        return;
+    }
+
+    acceptClients();
+
+    for(int i = 0; i < HTTP_MAX_CLIENTS; i++)
+    {
+        CONNECTION * pConnection = &_rgConnection[i];
+
+        switch(pConnection->state)
+        {
+            case stRequest:
+                readRequest(pConnection);
+                break;
+
+            case stHeader:
+                sendHeader(pConnection);
+                break;
+
+            case stBody:
+                sendBody(pConnection);
+                break;
+
+            case stIdle:
+            default:
+                break;
+        }
+    }
+}
+
+/***	void HttpFileServer::acceptClients(void)
+**
+**	Synopsis:
+**      Moves pending clients into free connection slots
+**
+*/
+void HttpFileServer::acceptClients(void)
+{
+    for(int i = 0; i < HTTP_MAX_CLIENTS && _tcpServer.availableClients() > 0; i++)
+    {
+        CONNECTION * pConnection = &_rgConnection[i];
+
+        if(pConnection->state != stIdle)
+        {
+            continue;
+        }
+
+        pConnection->tcpClient.close();
+        if(_tcpServer.acceptClient(&pConnection->tcpClient))
+        {
+            pConnection->state = stRequest;
+            pConnection->pFile = NULL;
+            pConnection->tLast = millis();
+        }
+    }
+}
+
+/***	void HttpFileServer::readRequest(CONNECTION * pConnection)
+**
+**	Synopsis:
+**      Waits for a whole request header and parses it
+**
+**  Notes:
+**
+**      The header is only peeked at until the blank line that ends it
+**      is in the RX FIFO, then it is consumed in one go.  Anything after
+**      it, a pipelined request, stays in the FIFO for the next round.
+**
+*/
+void HttpFileServer::readRequest(CONNECTION * pConnection)
+{
+    char szRequest[_cbRequestMax + 1];
+    char * pchEnd = NULL;
+    size_t cbRequest = 0;
+
+    if(pConnection->tcpClient.available() == 0)
+    {
+        if(!pConnection->tcpClient.isConnected(DNETcK::msImmediate) ||
+            (millis() - pConnection->tLast) > _msIdleTimeout)
+        {
+            closeConnection(pConnection);
+        }
+        return;
+    }
+
+    cbRequest = pConnection->tcpClient.peekStream((byte *) szRequest, _cbRequestMax);
+    szRequest[cbRequest] = '\0';
+
+    if((pchEnd = strstr(szRequest, "\r\n\r\n")) == NULL)
+    {
+        if(cbRequest == _cbRequestMax)
+        {
+            pConnection->fHead = false;
+            startError(pConnection, 431, "Request Header Fields Too Large", true);
+        }
+        else if((millis() - pConnection->tLast) > _msIdleTimeout)
+        {
+            closeConnection(pConnection);
+        }
+        return;
+    }
+
+    // keep the CRLF ending the last header line, drop the blank line
+    pchEnd[2] = '\0';
+    pConnection->tcpClient.consume((pchEnd - szRequest) + 4);
+    pConnection->tLast = millis();
+
+    parseRequest(pConnection, szRequest);
+}
+
+/***	void HttpFileServer::parseRequest(CONNECTION * pConnection, char * szRequest)
+**
+**	Synopsis:
+**      Works out the response to a request and opens the file
+**
+**	Parameters:
+**      pConnection     The connection the request came in on
+**
+**      szRequest       The request line and headers, each ending in CRLF; modified
+**
+**  Notes:
+**
+**      Only the Connection and Range headers are looked at.
+**      A single byte range gets a 206, an unsatisfiable one a 416,
+**      and several ranges are answered with the whole file.
+**
+*/
+void HttpFileServer::parseRequest(CONNECTION * pConnection, char * szRequest)
+{
+    char * szMethod = szRequest;
+    char * szPath = NULL;
+    char * szVersion = NULL;
+    char * szLine = NULL;
+    char * szRange = NULL;
+    char * pch = NULL;
+    char szFile[_cbPathMax];
+    unsigned long cbFile = 0;
+    unsigned long iFirst = 0;
+    unsigned long iLast = 0;
+    int range = 0;
+
+    pConnection->fKeepAlive = false;
+    pConnection->fHead = false;
+
+    // split up the request line
+    if((szLine = strstr(szRequest, "\r\n")) == NULL || (szPath = strchr(szMethod, ' ')) == NULL || szPath > szLine)
+    {
+        startError(pConnection, 400, "Bad Request", true);
+        return;
+    }
+    *szLine = '\0';
+    szLine += 2;
+    *szPath++ = '\0';
+
+    if((szVersion = strchr(szPath, ' ')) == NULL)
+    {
+        startError(pConnection, 400, "Bad Request", true);
+        return;
+    }
+    *szVersion++ = '\0';
+
+    // HTTP/1.1 defaults to keep-alive, HTTP/1.0 to close
+    pConnection->fKeepAlive = (strcmp(szVersion, "HTTP/1.1") == 0);
+    pConnection->fHead = (strcmp(szMethod, "HEAD") == 0);
+
+    // the headers we care about
+    while(*szLine != '\0')
+    {
+        char * szNext = strstr(szLine, "\r\n");
+
+        *szNext = '\0';
+
+        if(startsWithNoCase(szLine, "Connection:"))
+        {
+            for(pch = szLine + 11; *pch == ' '; pch++);
+            if(startsWithNoCase(pch, "close"))
+            {
+                pConnection->fKeepAlive = false;
+            }
+            else if(startsWithNoCase(pch, "keep-alive"))
+            {
+                pConnection->fKeepAlive = true;
+            }
+        }
+        else if(startsWithNoCase(szLine, "Range:"))
+        {
+            for(szRange = szLine + 6; *szRange == ' '; szRange++);
+        }
+
+        szLine = szNext + 2;
+    }
+
+    if(!pConnection->fHead && strcmp(szMethod, "GET") != 0)
+    {
+        startError(pConnection, 501, "Not Implemented", false);
+        return;
+    }
+
+    // anything after ? or # is not part of the file name
+    if((pch = strpbrk(szPath, "?#")) != NULL)
+    {
+        *pch = '\0';
+    }
+
+    if(szPath[0] != '/' || strstr(szPath, "..") != NULL || strchr(szPath, '\\') != NULL)
+    {
+        startError(pConnection, 400, "Bad Request", false);
+        return;
+    }
+
+    if(strlen(szPath) + strlen(_szIndex) >= _cbPathMax)
+    {
+        startError(pConnection, 414, "URI Too Long", false);
+        return;
+    }
+
+    strcpy(szFile, szPath + 1);
+    if(szFile[0] == '\0' || szFile[strlen(szFile) - 1] == '/')
+    {
+        strcat(szFile, _szIndex);
+    }
+
+    if((pConnection->pFile = openFile(szFile)) == NULL)
+    {
+        if(MDDFS.error() == CE_TOO_MANY_FILES_OPEN)
+        {
+            startError(pConnection, 503, "Service Unavailable", false);
+        }
+        else
+        {
+            startError(pConnection, 404, "Not Found", false);
+        }
+        return;
+    }
+
+    cbFile = pConnection->pFile->size;
+    if(szRange != NULL)
+    {
+        range = parseRange(szRange, cbFile, &iFirst, &iLast);
+    }
+
+    if(range < 0)
+    {
+        MDDFS.fclose(pConnection->pFile);
+        pConnection->pFile = NULL;
+        pConnection->cbHeader = sprintf(pConnection->szHeader,
+            "HTTP/1.1 416 Range Not Satisfiable\r\n"
+            "Content-Range: bytes */%lu\r\n"
+            "Content-Length: 0\r\n"
+            "Connection: %s\r\n\r\n",
+            cbFile, pConnection->fKeepAlive ? "keep-alive" : "close");
+        pConnection->cbBody = 0;
+    }
+    else if(range > 0 && MDDFS.fseek(pConnection->pFile, (long) iFirst, SEEK_SET) == 0)
+    {
+        pConnection->cbBody = iLast - iFirst + 1;
+        pConnection->cbHeader = sprintf(pConnection->szHeader,
+            "HTTP/1.1 206 Partial Content\r\n"
+            "Content-Type: %s\r\n"
+            "Content-Range: bytes %lu-%lu/%lu\r\n"
+            "Content-Length: %lu\r\n"
+            "Connection: %s\r\n\r\n",
+            contentType(szFile), iFirst, iLast, cbFile, pConnection->cbBody,
+            pConnection->fKeepAlive ? "keep-alive" : "close");
+    }
+    else
+    {
+        pConnection->cbBody = cbFile;
+        pConnection->cbHeader = sprintf(pConnection->szHeader,
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Type: %s\r\n"
+            "Accept-Ranges: bytes\r\n"
+            "Content-Length: %lu\r\n"
+            "Connection: %s\r\n\r\n",
+            contentType(szFile), cbFile, pConnection->fKeepAlive ? "keep-alive" : "close");
+    }
+
+    if(pConnection->fHead)
+    {
+        pConnection->cbBody = 0;
+    }
+
+    // hold back partial segments so the header goes out with the start of the body
+    pConnection->iHeader = 0;
+    pConnection->tcpClient.cork();
+    pConnection->state = stHeader;
+}
+
+/***	void HttpFileServer::startError(CONNECTION * pConnection, int status, const char * szReason, bool fClose)
+**
+**	Synopsis:
+**      Sets up a short text response for an error status
+**
+**	Parameters:
+**      pConnection     The connection to answer on
+**
+**      status          The HTTP status code
+**
+**      szReason        The reason phrase, also sent as the body
+**
+**      fClose          true to close the connection after the response
+**
+*/
+void HttpFileServer::startError(CONNECTION * pConnection, int status, const char * szReason, bool fClose)
+{
+    if(fClose)
+    {
+        pConnection->fKeepAlive = false;
+    }
+
+    pConnection->cbHeader = sprintf(pConnection->szHeader,
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: %u\r\n"
+        "Connection: %s\r\n\r\n",
+        status, szReason, (unsigned int) (strlen(szReason) + 2),
+        pConnection->fKeepAlive ? "keep-alive" : "close");
+
+    if(!pConnection->fHead)
+    {
+        pConnection->cbHeader += sprintf(&pConnection->szHeader[pConnection->cbHeader], "%s\r\n", szReason);
+    }
+
+    pConnection->cbBody = 0;
+    pConnection->iHeader = 0;
+    pConnection->tcpClient.cork();
+    pConnection->state = stHeader;
+}
+
+/***	void HttpFileServer::sendHeader(CONNECTION * pConnection)
+**
+**	Synopsis:
+**      Writes as much of the response header as the TX FIFO takes
+**
+*/
+void HttpFileServer::sendHeader(CONNECTION * pConnection)
+{
+    size_t cbWritten = 0;
+
+    cbWritten = pConnection->tcpClient.writeStream((const byte *) &pConnection->szHeader[pConnection->iHeader],
+                    pConnection->cbHeader - pConnection->iHeader, DNETcK::msImmediate);
+    pConnection->iHeader += cbWritten;
+
+    if(pConnection->iHeader < pConnection->cbHeader)
+    {
+        if(cbWritten > 0)
+        {
+            pConnection->tLast = millis();
+        }
+        else if(!pConnection->tcpClient.isConnected(DNETcK::msImmediate) ||
+                (millis() - pConnection->tLast) > _msIdleTimeout)
+        {
+            closeConnection(pConnection);
+        }
+    }
+    else if(pConnection->cbBody > 0)
+    {
+        pConnection->tLast = millis();
+        pConnection->state = stBody;
+        sendBody(pConnection);
+    }
+    else
+    {
+        endResponse(pConnection);
+    }
+}
+
+/***	void HttpFileServer::sendBody(CONNECTION * pConnection)
+**
+**	Synopsis:
+**      Moves file data into the socket until it is sent or the TX FIFO is full
+**
+**  Notes:
+**
+**      Each MDDFS.fborrow hands back what is left of the current sector
+**      in the file system's own buffer; it goes to TCPPutArray from there
+**      and only the bytes the socket took are consumed, so nothing is
+**      copied through a buffer of ours and nothing is read twice.
+**
+*/
+void HttpFileServer::sendBody(CONNECTION * pConnection)
+{
+    const uint8_t * pbData = NULL;
+    size_t cbData = 0;
+    size_t cbWritten = 0;
+
+    while(pConnection->cbBody > 0)
+    {
+        if((cbData = MDDFS.fborrow(pConnection->pFile, &pbData)) == 0)
+        {
+            // the file ended early or could not be read, the header already promised
+            // more so the only honest thing left is to drop the connection
+            closeConnection(pConnection);
+            return;
+        }
+
+        if(cbData > pConnection->cbBody)
+        {
+            cbData = pConnection->cbBody;
+        }
+
+        cbWritten = pConnection->tcpClient.writeStream(pbData, cbData, DNETcK::msImmediate);
+        MDDFS.fconsume(pConnection->pFile, cbWritten);
+        pConnection->cbBody -= cbWritten;
+
+        if(cbWritten > 0)
+        {
+            pConnection->tLast = millis();
+        }
+
+        // out of TX space, come back when the remote has acked some
+        if(cbWritten < cbData)
+        {
+            break;
+        }
+    }
+
+    if(pConnection->cbBody == 0)
+    {
+        endResponse(pConnection);
+    }
+    else if(!pConnection->tcpClient.isConnected(DNETcK::msImmediate) ||
+            (millis() - pConnection->tLast) > _msIdleTimeout)
+    {
+        closeConnection(pConnection);
+    }
+}
+
+/***	void HttpFileServer::endResponse(CONNECTION * pConnection)
+**
+**	Synopsis:
+**      Flushes the last of the response and waits for the next request, or closes
+**
+*/
+void HttpFileServer::endResponse(CONNECTION * pConnection)
+{
+    if(pConnection->pFile != NULL)
+    {
+        MDDFS.fclose(pConnection->pFile);
+        pConnection->pFile = NULL;
+    }
+
+    pConnection->tcpClient.uncork();
+    pConnection->tLast = millis();
+
+    if(pConnection->fKeepAlive)
+    {
+        pConnection->state = stRequest;
+    }
+    else
+    {
+        // the FIN goes out behind whatever is still in the TX FIFO
+        closeConnection(pConnection);
+    }
+}
+
+/***	void HttpFileServer::closeConnection(CONNECTION * pConnection)
+**
+**	Synopsis:
+**      Closes the file and the socket, freeing the slot
+**
+*/
+void HttpFileServer::closeConnection(CONNECTION * pConnection)
+{
+    if(pConnection->pFile != NULL)
+    {
+        MDDFS.fclose(pConnection->pFile);
+        pConnection->pFile = NULL;
+    }
+
+    pConnection->tcpClient.close();
+    pConnection->state = stIdle;
+}
+
+/***	FSFILE * HttpFileServer::openFile(const char * szPath)
+**
+**	Synopsis:
+**      Opens a file for reading by its URL path
+**
+**	Parameters:
+**      szPath      The path without the leading /, shorter than _cbPathMax
+**
+**	Return Values:
+**      The open file, or NULL; MDDFS.error() says why
+**
+**  Notes:
+**
+**      FSfopen only takes a name in the current directory, so for a
+**      path with directories in it we change into the directory, open
+**      the file and change back.  The sketch's current directory is
+**      the same afterwards either way.
+**
+*/
+FSFILE * HttpFileServer::openFile(const char * szPath)
+{
+    char szCwd[_cbPathMax];
+    char szDir[_cbPathMax];
+    char * szName = NULL;
+    FSFILE * pFile = NULL;
+
+    if(strchr(szPath, '/') == NULL)
+    {
+        return(MDDFS.fopen(szPath, "r"));
+    }
+
+    if(MDDFS.getcwd(szCwd, sizeof(szCwd)) == NULL)
+    {
+        return(NULL);
+    }
+
+    // split off the name and turn the rest into an MDDFS path
+    strcpy(szDir, szPath);
+    szName = strrchr(szDir, '/');
+    *szName++ = '\0';
+    for(char * pch = szDir; *pch != '\0'; pch++)
+    {
+        if(*pch == '/')
+        {
+            *pch = '\\';
+        }
+    }
+
+    if(MDDFS.chdir(szDir) == 0)
+    {
+        pFile = MDDFS.fopen(szName, "r");
+    }
+
+    MDDFS.chdir(szCwd);
+
+    return(pFile);
+}
+
+/***	const char * HttpFileServer::contentType(const char * szPath)
+**
+**	Synopsis:
+**      Picks the Content-Type from the file extension
+**
+**	Return Values:
+**      The MIME type, application/octet-stream if the extension is not known
+**
+*/
+const char * HttpFileServer::contentType(const char * szPath)
+{
+    const char * szExt = strrchr(szPath, '.');
+
+    if(szExt != NULL && strchr(szExt, '/') == NULL)
+    {
+        szExt++;
+        for(unsigned int i = 0; i < sizeof(rgContentType) / sizeof(rgContentType[0]); i++)
+        {
+            if(strlen(szExt) == strlen(rgContentType[i].szExt) && startsWithNoCase(szExt, rgContentType[i].szExt))
+            {
+                return(rgContentType[i].szType);
+            }
+        }
+    }
+
+    return("application/octet-stream");
+}
+
+/***	int HttpFileServer::parseRange(const char * szRange, unsigned long cbFile, unsigned long * piFirst, unsigned long * piLast)
+**
+**	Synopsis:
+**      Parses the value of a Range header
+**
+**	Parameters:
+**      szRange     The header value, such as "bytes=100-199", "bytes=100-" or "bytes=-100"
+**
+**      cbFile      The size of the file
+**
+**      piFirst     Receives the offset of the first byte to send
+**
+**      piLast      Receives the offset of the last byte to send
+**
+**	Return Values:
+**      1 for a usable range, 0 if the header should be ignored and the
+**      whole file sent, -1 if the range lies past the end of the file
+**
+**  Notes:
+**
+**      Ranges with several parts are ignored rather than answered
+**      with a multipart body.
+**
+*/
+int HttpFileServer::parseRange(const char * szRange, unsigned long cbFile, unsigned long * piFirst, unsigned long * piLast)
+{
+    char * pchEnd = NULL;
+
+    if(!startsWithNoCase(szRange, "bytes=") || strchr(szRange, ',') != NULL)
+    {
+        return(0);
+    }
+    szRange += 6;
+
+    // the last n bytes
+    if(*szRange == '-')
+    {
+        unsigned long cbSuffix = strtoul(szRange + 1, &pchEnd, 10);
+
+        if(pchEnd == szRange + 1 || *pchEnd != '\0')
+        {
+            return(0);
+        }
+        else if(cbSuffix == 0 || cbFile == 0)
+        {
+            return(-1);
+        }
+
+        *piFirst = cbSuffix < cbFile ? cbFile - cbSuffix : 0;
+        *piLast = cbFile - 1;
+        return(1);
+    }
+
+    if(!isdigit(*szRange))
+    {
+        return(0);
+    }
+
+    *piFirst = strtoul(szRange, &pchEnd, 10);
+    if(*pchEnd != '-')
+    {
+        return(0);
+    }
+    szRange = pchEnd + 1;
+
+    if(*szRange == '\0')
+    {
+        *piLast = cbFile - 1;
+    }
+    else
+    {
+        *piLast = strtoul(szRange, &pchEnd, 10);
+        if(pchEnd == szRange || *pchEnd != '\0' || *piLast < *piFirst)
+        {
+            return(0);
+        }
+    }
+
+    if(*piFirst >= cbFile)
+    {
+        return(-1);
+    }
+    else if(*piLast >= cbFile)
+    {
+        *piLast = cbFile - 1;
+    }
+
+    return(1);
+}
@@ -0,0 +1,124 @@
+/************************************************************************/
+/*																		*/
+/*	HttpFileServer.h	--  Static file HTTP/1.1 server for DNETcK      */
+/*                          serving from the chipKIT MDD File System    */
+/*																		*/
+/************************************************************************/
+/*	Copyright 2012, Digilent Inc.										*/
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+/*  Module Description: 												*/
+/*																		*/
+/*	Serves GET and HEAD for files on the current MDDFS volume, with     */
+/*	keep-alive and single byte ranges.  Every connection is a small     */
+/*	state machine run from periodicTasks(), so several clients are      */
+/*	served at once without blocking the sketch.  File data goes from    */
+/*	the MDDFS sector buffer (MDDFS.fborrow) straight into the socket    */
+/*	TX FIFO, only as much as TCPIsPutReady says will fit.               */
+/*																		*/
+/*	URLs are looked up from the MDDFS current directory, so a sketch   */
+/*	can chdir to a web root once the media is mounted.  "/" and paths   */
+/*	ending in "/" serve the index file, INDEX.HTM unless begin() was    */
+/*	given another name.  Names are 8.3, as everywhere in MDDFS.         */
+/*																		*/
+/*	Include chipKITUSBHost.h, chipKITUSBMSDHost.h, chipKITMDDFS.h and   */
+/*	DNETcK.h before this file.  Each client holds a file open while     */
+/*	it is being served, so FS_MAX_FILES_OPEN should be at least         */
+/*	HTTP_MAX_CLIENTS.                                                   */
+/*																		*/
+#ifndef _HTTPFILESERVER_H
+#define _HTTPFILESERVER_H
+
+#ifndef _DNETCK_H
+#error DNETcK.h must be included before HttpFileServer.h
+#endif
+
+#ifndef _CHIPKITUSBMDDFSCLASS_H
+#error chipKITMDDFS.h must be included before HttpFileServer.h
+#endif
+
+// Clients served at the same time, may be defined before HttpFileServer.h is included
+#ifndef HTTP_MAX_CLIENTS
+#define HTTP_MAX_CLIENTS 2
+#endif
+
+class HttpFileServer {
+private:
+    static const size_t         _cbRequestMax       = 512;      // request line and headers must fit
+    static const size_t         _cbHeaderMax        = 256;      // response header
+    static const size_t         _cbPathMax          = 64;
+    static const unsigned long  _msIdleTimeout      = 10000;
+
+    typedef enum
+    {
+        stIdle = 0,
+        stRequest,
+        stHeader,
+        stBody
+    } CSTATE;
+
+    typedef struct
+    {
+        TcpClient       tcpClient;
+        CSTATE          state;
+        FSFILE *        pFile;
+        unsigned long   cbBody;         // body bytes left to send
+        bool            fKeepAlive;
+        bool            fHead;          // HEAD request, no body
+        unsigned long   tLast;          // last time anything moved
+        size_t          cbHeader;
+        size_t          iHeader;        // header bytes already sent
+        char            szHeader[_cbHeaderMax];
+    } CONNECTION;
+
+    TcpServer       _tcpServer;
+    bool            _fStarted;
+    char            _szIndex[13];
+    CONNECTION      _rgConnection[HTTP_MAX_CLIENTS];
+
+    // to prevent copies
+    HttpFileServer&  operator=(HttpFileServer& httpFileServer);
+    HttpFileServer(HttpFileServer& httpFileServer);
+
+    void acceptClients(void);
+    void readRequest(CONNECTION * pConnection);
+    void parseRequest(CONNECTION * pConnection, char * szRequest);
+    void sendHeader(CONNECTION * pConnection);
+    void sendBody(CONNECTION * pConnection);
+    void endResponse(CONNECTION * pConnection);
+    void closeConnection(CONNECTION * pConnection);
+    void startError(CONNECTION * pConnection, int status, const char * szReason, bool fClose);
+
+    static const char * contentType(const char * szPath);
+    static int parseRange(const char * szRange, unsigned long cbFile, unsigned long * piFirst, unsigned long * piLast);
+    static FSFILE * openFile(const char * szPath);
+
+public:
+    HttpFileServer();
+    ~HttpFileServer();
+
+    bool begin(unsigned short localPort);
+    bool begin(unsigned short localPort, const char * szIndex);
+    void end(void);
+
+    void periodicTasks(void);
+
+    int activeClients(void);
+};
+
+#endif // _HTTPFILESERVER_H
@@ -0,0 +1,151 @@
+#include <chipKITUSBHost.h>
+#include <chipKITUSBMSDHost.h>
+#include <chipKITMDDFS.h>
+#include <DNETcK.h>
+#include <HttpFileServer.h>
+
+/************************************************************************/
+/*                                                                      */
+/*  HttpFileServer                                                      */
+/*                                                                      */
+/*  A chipKIT DNETcK web server that serves the files on a USB thumb    */
+/*  drive, to demonstrate how to use the HttpFileServer Class.          */
+/*  Put an INDEX.HTM in the root of the drive and browse to ipServer.   */
+/*                                                                      */
+/*    Works On:                                                         */
+/*      Cerebot MX7cK                                                   */
+/*      Cerebot 32MX7                                                   */
+/*                                                                      */
+/************************************************************************/
+/*  Copyright 2012, Digilent Inc.                                       */
+/************************************************************************/
+/*
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+/************************************************************************/
+
+/***********************************************************/
+/***********************************************************/
+/***********************************************************/
+//
+//          CHANGE THIS TO YOUR SERVER IP ADDRESS
+//
+IPv4 ipServer = {192,168,1,190};
+unsigned short portServer = 80;
+//
+//
+/***********************************************************/
+/***********************************************************/
+/***********************************************************/
+
+HttpFileServer httpFileServer;
+BOOL deviceAttached = FALSE;
+BOOL fServing = FALSE;
+
+/****************************************************************************
+  Function:
+    BOOL MyMSDEventHandler( uint8_t address, USB_EVENT event, void *data, DWORD size )
+
+  Description:
+    Handles all of the events for the MSD device
+
+  Return Values:
+    True if handled, false otherwise
+
+  Remarks:
+    We call the default one here so things like VBUS is automatically handled.
+
+***************************************************************************/
+BOOL MyMSDEventHandler( uint8_t address, USB_EVENT event, void *data, DWORD size )
+{
+    BOOL fRet = FALSE;
+
+    // call the default handler for common host controller stuff
+    fRet = USBHost.DefaultEventHandler(address, event, data, size);
+
+    switch( event )
+    {
+        case EVENT_VBUS_RELEASE_POWER:
+
+            // the thumb drive was removed
+            deviceAttached = FALSE;
+            return TRUE;
+            break;
+
+        default:
+            break;
+    }
+
+    return(fRet);
+}
+
+/***    void setup()
+ *
+ *    Description:
+ *
+ *      Arduino setup function.
+ *
+ *      Starts the USB host controller and the IP stack
+ *      with a static IP of ipServer.
+ *
+ * ------------------------------------------------------------ */
+void setup() {
+
+    Serial.begin(9600);
+    Serial.println("HttpFileServer 1.0");
+    Serial.println("Digilent, Copyright 2012");
+    Serial.println("");
+
+    USBHost.Begin(MyMSDEventHandler);
+    DNETcK::begin(ipServer);
+}
+
+/***    void loop()
+ *
+ *    Description:
+ *
+ *      Arduino loop function.
+ *
+ *      Once a thumb drive is mounted the server starts listening,
+ *      when it is pulled out the server drops its clients and stops.
+ *      Nothing here blocks, so keep the USB and IP stacks and the
+ *      server running every pass through loop().
+ *
+ * ------------------------------------------------------------ */
+void loop() {
+
+    USBHost.Tasks();
+    USBMSDHost.Tasks();
+
+    if(!deviceAttached && USBMSDHost.SCSIMediaDetect() && MDDFS.Init())
+    {
+        deviceAttached = TRUE;
+    }
+
+    if(deviceAttached && !fServing)
+    {
+        fServing = httpFileServer.begin(portServer);
+        Serial.println(fServing ? "Serving the thumb drive" : "Unable to listen");
+    }
+    else if(!deviceAttached && fServing)
+    {
+        httpFileServer.end();
+        fServing = FALSE;
+        Serial.println("Thumb drive removed");
+    }
+
+    httpFileServer.periodicTasks();
+    DNETcK::periodicTasks();
+}
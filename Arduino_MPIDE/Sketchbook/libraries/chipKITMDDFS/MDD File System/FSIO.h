@@ -348,6 +348,130 @@ typedef struct
 int FSInit(void);
 
 
+/*************************************************************************
+  Function:
+    int FSLockMedia (void)
+  Summary:
+    Hand the media over to another bus master
+  Conditions:
+    FSInit must have been called.
+  Input:
+    None
+  Return Values:
+    0 -   Any pending data was written and the media is locked
+    EOF - Pending data could not be written; the media is locked anyway
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Call this before something other than the file system (for example
+    a USB host through the MSD device function) starts to read and
+    write the media directly.  Cached data and FAT sectors are written
+    out, and until FSUnlockMedia is called every FSIO function that
+    would modify the media fails with CE_WRITE_PROTECTED.
+  Remarks:
+    Files open for write when the media is locked can only be closed;
+    their directory entries will not be updated.
+  *************************************************************************/
+
+int FSLockMedia (void);
+
+
+/*************************************************************************
+  Function:
+    void FSUnlockMedia (void)
+  Summary:
+    Take the media back after FSLockMedia
+  Conditions:
+    None
+  Input:
+    None
+  Return Values:
+    None
+  Side Effects:
+    The RAM sector caches are invalidated.
+  Description:
+    Ends the lock started by FSLockMedia.  The other bus master may have
+    rewritten any part of the media, so FSInit should be called again
+    before any file is opened.
+  Remarks:
+    None
+  *************************************************************************/
+
+void FSUnlockMedia (void);
+
+
+/*************************************************************************
+  Function:
+    BYTE FSIsMediaLocked (void)
+  Summary:
+    Report whether FSLockMedia is in effect
+  Conditions:
+    None
+  Input:
+    None
+  Return Values:
+    TRUE -  The media is owned by another bus master
+    FALSE - The file system owns the media
+  Side Effects:
+    None
+  Description:
+    Report whether FSLockMedia is in effect
+  Remarks:
+    None
+  *************************************************************************/
+
+BYTE FSIsMediaLocked (void);
+
+
+/*************************************************************************
+  Function:
+    int FSSelectVolume (BYTE volume)
+  Summary:
+    Choose the volume the FSIO functions work on
+  Conditions:
+    None
+  Input:
+    volume - Index of the volume, 0 to FS_MAX_VOLUMES - 1
+  Return Values:
+    TRUE -  The volume is selected
+    FALSE - There is no such volume
+  Side Effects:
+    The FSerrno variable will be changed on failure.
+  Description:
+    Each volume has its own disk structure, sector buffers, current
+    working directory and lock state.  Functions that take a name work
+    on the selected volume; functions that take an FSFILE pointer
+    switch to the volume the file was opened on.  Call FSInit once for
+    each volume after selecting it.
+  Remarks:
+    FS_MAX_VOLUMES is set in FSconfig.h and defaults to 1.
+  *************************************************************************/
+
+int FSSelectVolume (BYTE volume);
+
+
+/*************************************************************************
+  Function:
+    BYTE FSCurrentVolume (void)
+  Summary:
+    Report the volume chosen with FSSelectVolume
+  Conditions:
+    None
+  Input:
+    None
+  Return Values:
+    The index of the selected volume
+  Side Effects:
+    None
+  Description:
+    Report the volume chosen with FSSelectVolume
+  Remarks:
+    None
+  *************************************************************************/
+
+BYTE FSCurrentVolume (void);
+
+
 /*********************************************************************
   Function:
     FSFILE * FSfopen (const char * fileName, const char *mode)
@@ -673,6 +797,56 @@ void FSrewind (FSFILE *fo);
 size_t FSfread(void *ptr, size_t size, size_t n, FSFILE *stream);
 
 
+/**************************************************************************
+  Function:
+    size_t FSfborrow(FSFILE *stream, const BYTE **ppData)
+  Summary:
+    Get the next bytes of a file straight out of the sector buffer
+  Conditions:
+    File is opened in a read mode
+  Input:
+    stream -  File to be read from
+    ppData -  Receives a pointer to the bytes in the sector buffer
+  Return:
+    size_t - number of bytes at *ppData, 0 at the end of the file or on error
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Loads the sector holding the current position and returns a pointer
+    into the sector buffer rather than copying, up to the end of the
+    sector or the file.  Nothing moves until FSfconsume is called.
+  Remarks:
+    The pointer is only good until the next file system call on the
+    volume.
+  **************************************************************************/
+
+size_t FSfborrow(FSFILE *stream, const BYTE **ppData);
+
+
+/**************************************************************************
+  Function:
+    size_t FSfconsume(FSFILE *stream, size_t n)
+  Summary:
+    Move past bytes taken with FSfborrow
+  Conditions:
+    FSfborrow returned a span for this file
+  Input:
+    stream -  File that was borrowed from
+    n -       Number of bytes used
+  Return:
+    size_t - number of bytes the position moved
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Advances the file position by n bytes, clamped to the span FSfborrow
+    returned.
+  Remarks:
+    None.
+  **************************************************************************/
+
+size_t FSfconsume(FSFILE *stream, size_t n);
+
+
 /**********************************************************************
   Function:
     int FSfseek(FSFILE *stream, long offset, int whence)
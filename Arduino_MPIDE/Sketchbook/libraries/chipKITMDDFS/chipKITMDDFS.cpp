@@ -68,6 +68,17 @@ size_t ChipKITMDDFS::fread(void *ptr, size_t size, size_t n, FSFILE *stream)
     return(FSfread(ptr, size, n, stream));
 }
 
+// zero-copy read: borrow the bytes in the sector buffer, then consume what was used
+size_t ChipKITMDDFS::fborrow(FSFILE *stream, const uint8_t **ppData)
+{
+    return(FSfborrow(stream, ppData));
+}
+
+size_t ChipKITMDDFS::fconsume(FSFILE *stream, size_t n)
+{
+    return(FSfconsume(stream, n));
+}
+
 int ChipKITMDDFS::fseek(FSFILE *stream, long offset, int whence)
 {
     return(FSfseek(stream, offset, whence));
@@ -159,6 +170,33 @@ void ChipKITMDDFS::GetDiskProperties(FS_DISK_PROPERTIES* properties)
    FSGetDiskProperties(properties);
 }
 
+// used when another bus master, like the USB MSD device function, takes over the media
+int ChipKITMDDFS::LockMedia(void)
+{
+    return(FSLockMedia());
+}
+
+void ChipKITMDDFS::UnlockMedia(void)
+{
+    FSUnlockMedia();
+}
+
+unsigned char ChipKITMDDFS::IsMediaLocked(void)
+{
+    return(FSIsMediaLocked());
+}
+
+// FS_MAX_VOLUMES in FSconfig.h sets how many volumes can be mounted at once
+int ChipKITMDDFS::SelectVolume(unsigned char volume)
+{
+    return(FSSelectVolume(volume));
+}
+
+unsigned char ChipKITMDDFS::CurrentVolume(void)
+{
+    return(FSCurrentVolume());
+}
+
 //******************************************************************************
 //******************************************************************************
 // Instantiate the ChipKITMDDFS Class
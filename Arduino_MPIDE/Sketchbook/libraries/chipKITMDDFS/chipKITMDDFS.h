@@ -65,6 +65,8 @@
         int fclose(FSFILE *fo);
         void rewind(FSFILE *fo);
         size_t fread(void *ptr, size_t size, size_t n, FSFILE *stream);
+        size_t fborrow(FSFILE *stream, const uint8_t **ppData);
+        size_t fconsume(FSFILE *stream, size_t n);
         int fseek(FSFILE *stream, long offset, int whence);
         long ftell(FSFILE *fo);
         int fEOF(FSFILE * stream);
@@ -83,6 +85,11 @@
         int error(void);
         int CreateMBR(unsigned long firstSector, unsigned long numSectors);
         void GetDiskProperties(FS_DISK_PROPERTIES* properties);
+        int LockMedia(void);
+        void UnlockMedia(void);
+        unsigned char IsMediaLocked(void);
+        int SelectVolume(unsigned char volume);
+        unsigned char CurrentVolume(void);
     };
 
 // pre-instantiated class for sketches
@@ -123,18 +123,81 @@ WORD    gTimeWrtTime;   // Global time variable (for timestamps) used to indicat
 WORD    gTimeWrtDate;   // Global time variable (for timestamps) used to indicate last update date
 #endif
 
+#ifndef FS_MAX_VOLUMES
+    #define FS_MAX_VOLUMES  1
+#endif
+
+#if (FS_MAX_VOLUMES > 1)
+
+#ifdef __18CXX
+    #error Multiple volumes are not supported with the fixed PIC18 buffer sections
+#endif
+
+// Everything the file system caches about one mounted volume.
+// The disk structure must be the first member, see FSSelectFileVolume.
+typedef struct
+{
+    DISK        diskData;               // Device information
+    DWORD       lastFATSectorRead;      // Which FAT sector was read last
+    BYTE        needFATWrite;           // The FAT buffer needs to be written
+    FSFILE  *   bufferOwner;            // Which file is using the data buffer
+    DWORD       lastDataSectorRead;     // Which data sector was read last
+    BYTE        needDataWrite;          // The data buffer needs to be written
+    BYTE        bufferZeroed;           // The data buffer contains all zeros
+    BYTE        mediaLocked;            // Another bus master owns the media
+    DWORD       rootDirClusterValue;    // Cluster number of the root dir (0 for FAT12/16)
+#ifdef ALLOW_DIRS
+    FSFILE      cwd;                    // Current working directory
+#endif
+    BYTE __attribute__ ((aligned(4)))   dataBuffer[MEDIA_SECTOR_SIZE];  // Data sector buffer
+    BYTE __attribute__ ((aligned(4)))   fatBuffer[MEDIA_SECTOR_SIZE];   // FAT sector buffer
+} FS_VOLUME;
+
+FS_VOLUME   gVolume[FS_MAX_VOLUMES];    // One entry per volume, selected with FSSelectVolume
+BYTE        gCurrentVolume = 0;         // The volume the FSIO functions work on
+BYTE        gFileSlotsReady = FALSE;    // The file slots have been initialized once
+
+// The rest of this file keeps using the single volume names;
+// they resolve to the currently selected volume.
+#define gDiskData               (gVolume[gCurrentVolume].diskData)
+#define gLastFATSectorRead      (gVolume[gCurrentVolume].lastFATSectorRead)
+#define gNeedFATWrite           (gVolume[gCurrentVolume].needFATWrite)
+#define gBufferOwner            (gVolume[gCurrentVolume].bufferOwner)
+#define gLastDataSectorRead     (gVolume[gCurrentVolume].lastDataSectorRead)
+#define gNeedDataWrite          (gVolume[gCurrentVolume].needDataWrite)
+#define gBufferZeroed           (gVolume[gCurrentVolume].bufferZeroed)
+#define gMediaLocked            (gVolume[gCurrentVolume].mediaLocked)
+#define FatRootDirClusterValue  (gVolume[gCurrentVolume].rootDirClusterValue)
+#define gDataBuffer             (gVolume[gCurrentVolume].dataBuffer)
+#define gFATBuffer              (gVolume[gCurrentVolume].fatBuffer)
+#ifdef ALLOW_DIRS
+    #define cwdptr              (&gVolume[gCurrentVolume].cwd)
+#endif
+
+// Files remember their volume through fo->dsk, switch to it before using the file
+#define FSSelectFileVolume(fo)  FSSelectVolume((BYTE) ((FS_VOLUME *) (fo)->dsk - gVolume))
+
+#else   // FS_MAX_VOLUMES == 1
+
+#define FSSelectFileVolume(fo)
+
 DWORD       gLastFATSectorRead = 0xFFFFFFFF;    // Global variable indicating which FAT sector was read last
 BYTE        gNeedFATWrite = FALSE;              // Global variable indicating that there is information that needs to be written to the FAT
 FSFILE  *   gBufferOwner = NULL;                // Global variable indicating which file is using the data buffer
 DWORD       gLastDataSectorRead = 0xFFFFFFFF;   // Global variable indicating which data sector was read last
 BYTE        gNeedDataWrite = FALSE;             // Global variable indicating that there is information that needs to be written to the data section
-BYTE        nextClusterIsLast = FALSE;          // Global variable indicating that the entries in a directory align with a cluster boundary
 
 BYTE    gBufferZeroed = FALSE;      // Global variable indicating that the data buffer contains all zeros
 
+BYTE    gMediaLocked = FALSE;       // Global variable indicating that another bus master (i.e. a USB host through the MSD function) owns the media
+
 DWORD   FatRootDirClusterValue;     // Global variable containing the cluster number of the root dir (0 for FAT12/16)
 
-BYTE    FSerrno;                    // Global error variable.  Set to one of many error codes after each function call.
+#endif  // FS_MAX_VOLUMES
+
+BYTE        nextClusterIsLast = FALSE;          // Global variable indicating that the entries in a directory align with a cluster boundary
+
+BYTE    FSerrno;                   // Global error variable.  Set to one of many error codes after each function call.
 
 DWORD   TempClusterCalc;            // Global variable used to store the calculated value of the cluster of a specified sector.
 BYTE    dirCleared;                 // Global variable used by the "recursive" FSrmdir function to indicate that all subdirectories and files have been deleted from the target directory.
@@ -142,6 +205,8 @@ BYTE    recache = FALSE;            // Global variable used by the "recursive" F
 FSFILE  tempCWDobj;                 // Global variable used to preserve the current working directory information.
 FSFILE  gFileTemp;                  // Global variable used for file operations.
 
+#if (FS_MAX_VOLUMES == 1)
+
 #ifdef ALLOW_DIRS
     FSFILE   cwd;               // Global current working directory
     FSFILE * cwdptr = &cwd;     // Pointer to the current working directory
@@ -165,6 +230,8 @@ FSFILE  gFileTemp;                  // Global variable used for file operations.
 
 DISK gDiskData;         // Global structure containing device information.
 
+#endif  // FS_MAX_VOLUMES == 1
+
 
 
 /************************************************************************/
@@ -195,6 +262,10 @@ typedef _DIRENTRY * DIRENTRY;                   // A pointer to a directory entr
 
 #define DIRENTRIES_PER_SECTOR   (MEDIA_SECTOR_SIZE / 32)        // The number of directory entries in a sector
 
+// The write protect test used by every function that modifies the media.
+// While FSLockMedia is in effect the media is treated as write protected.
+#define FSWriteProtectState()   (gMediaLocked || MDD_WriteProtectState())
+
 // internal errors
 #define CE_FAT_EOF            60   // Error that indicates an attempt to read FAT entries beyond the end of the file
 #define CE_EOF                61   // Error that indicates that the end of the file has been reached
@@ -342,7 +413,14 @@ int FSInit(void)
     int fIndex;
 #ifndef FS_DYNAMIC_MEM
     for( fIndex = 0; fIndex < FS_MAX_FILES_OPEN; fIndex++ )
+#if (FS_MAX_VOLUMES > 1)
+        // files open on the other volumes stay open
+        if (!gFileSlotsReady || gFileArray[fIndex].dsk == &gDiskData)
+#endif
         gFileSlotOpen[fIndex] = TRUE;
+#if (FS_MAX_VOLUMES > 1)
+    gFileSlotsReady = TRUE;
+#endif
 #else
     #ifdef __18CXX
         SRAMInitHeap();
@@ -384,6 +462,202 @@ int FSInit(void)
     return FALSE;
 }
 
+/*************************************************************************
+  Function:
+    int FSLockMedia (void)
+  Summary:
+    Hand the media over to another bus master
+  Conditions:
+    FSInit must have been called.
+  Input:
+    None
+  Return Values:
+    0 -   Any pending data was written and the media is locked
+    EOF - Pending data could not be written; the media is locked anyway
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    Call this before something other than the file system (for example
+    a USB host through the MSD device function) starts to read and
+    write the media directly.  Data and FAT sectors still cached in
+    RAM are written out, and from then on every FSIO function that
+    would modify the media fails with CE_WRITE_PROTECTED, so the two
+    masters never write the media at the same time.
+  Remarks:
+    Files open for write when the media is locked can only be closed;
+    their directory entries will not be updated.
+  *************************************************************************/
+
+int FSLockMedia (void)
+{
+    int error = 0;
+
+    FSerrno = CE_GOOD;
+
+    if (gMediaLocked)
+        return 0;
+
+#ifdef ALLOW_WRITES
+    if (gNeedDataWrite)
+    {
+        if (flushData())
+        {
+            FSerrno = CE_WRITE_ERROR;
+            error = EOF;
+        }
+    }
+
+    if (gNeedFATWrite)
+    {
+        if (WriteFAT (&gDiskData, 0, 0, TRUE))
+        {
+            FSerrno = CE_WRITE_ERROR;
+            error = EOF;
+        }
+    }
+#endif
+
+    gMediaLocked = TRUE;
+
+    return error;
+}
+
+/*************************************************************************
+  Function:
+    void FSUnlockMedia (void)
+  Summary:
+    Take the media back after FSLockMedia
+  Conditions:
+    None
+  Input:
+    None
+  Return Values:
+    None
+  Side Effects:
+    The RAM sector caches are invalidated.
+  Description:
+    Ends the lock started by FSLockMedia.  The other bus master may have
+    rewritten any part of the media, so the cached data and FAT sectors
+    are dropped.  The directory structure may have changed as well, so
+    FSInit should be called again before any file is opened.
+  Remarks:
+    None
+  *************************************************************************/
+
+void FSUnlockMedia (void)
+{
+    gMediaLocked = FALSE;
+
+    gBufferOwner = NULL;
+    gBufferZeroed = FALSE;
+    gNeedDataWrite = FALSE;
+    gNeedFATWrite = FALSE;
+    gLastFATSectorRead = 0xFFFFFFFF;
+    gLastDataSectorRead = 0xFFFFFFFF;
+}
+
+/*************************************************************************
+  Function:
+    BYTE FSIsMediaLocked (void)
+  Summary:
+    Report whether FSLockMedia is in effect
+  Conditions:
+    None
+  Input:
+    None
+  Return Values:
+    TRUE -  The media is owned by another bus master
+    FALSE - The file system owns the media
+  Side Effects:
+    None
+  Description:
+    Report whether FSLockMedia is in effect
+  Remarks:
+    None
+  *************************************************************************/
+
+BYTE FSIsMediaLocked (void)
+{
+    return gMediaLocked;
+}
+
+/*************************************************************************
+  Function:
+    int FSSelectVolume (BYTE volume)
+  Summary:
+    Choose the volume the FSIO functions work on
+  Conditions:
+    None
+  Input:
+    volume - Index of the volume, 0 to FS_MAX_VOLUMES - 1
+  Return Values:
+    TRUE -  The volume is selected
+    FALSE - There is no such volume
+  Side Effects:
+    The FSerrno variable will be changed on failure.
+  Description:
+    Each volume has its own disk structure, sector buffers, current
+    working directory and lock state.  FSInit, FSfopen, FSformat,
+    FSchdir and the other functions that take a name work on the
+    selected volume; functions that take an FSFILE pointer switch to
+    the volume the file was opened on.  When the physical layer
+    defines MDD_SelectVolume (the USB MSD host maps each LUN of each
+    attached device to a volume) the media is switched as well.
+  Remarks:
+    FS_MAX_VOLUMES is set in FSconfig.h and defaults to 1.
+  *************************************************************************/
+
+int FSSelectVolume (BYTE volume)
+{
+    if (volume >= FS_MAX_VOLUMES)
+    {
+        FSerrno = CE_INVALID_ARGUMENT;
+        return FALSE;
+    }
+
+#ifdef MDD_SelectVolume
+    if (!MDD_SelectVolume (volume))
+    {
+        FSerrno = CE_INVALID_ARGUMENT;
+        return FALSE;
+    }
+#endif
+
+#if (FS_MAX_VOLUMES > 1)
+    gCurrentVolume = volume;
+#endif
+
+    return TRUE;
+}
+
+/*************************************************************************
+  Function:
+    BYTE FSCurrentVolume (void)
+  Summary:
+    Report the volume chosen with FSSelectVolume
+  Conditions:
+    None
+  Input:
+    None
+  Return Values:
+    The index of the selected volume
+  Side Effects:
+    None
+  Description:
+    Report the volume chosen with FSSelectVolume
+  Remarks:
+    None
+  *************************************************************************/
+
+BYTE FSCurrentVolume (void)
+{
+#if (FS_MAX_VOLUMES > 1)
+    return gCurrentVolume;
+#else
+    return 0;
+#endif
+}
+
 
 /********************************************************************************
   Function:
@@ -1372,6 +1646,12 @@ int FSCreateMBR (unsigned long firstSector, unsigned long numSectors)
     if (firstSector > (numSectors - 1))
         return EOF;
 
+    if (FSWriteProtectState())
+    {
+        FSerrno = CE_WRITE_PROTECTED;
+        return EOF;
+    }
+
     if (gNeedDataWrite)
         if (flushData())
             return EOF;
@@ -1508,6 +1788,12 @@ int FSformat (char mode, long int serialNumber, char * volumeID)
 
     FSerrno = CE_GOOD;
 
+    if (gMediaLocked)
+    {
+        FSerrno = CE_WRITE_PROTECTED;
+        return EOF;
+    }
+
     gBufferZeroed = FALSE;
     gNeedFATWrite = FALSE;             
     gLastFATSectorRead = 0xFFFFFFFF;       
@@ -1746,6 +2032,7 @@ int FSformat (char mode, long int serialNumber, char * volumeID)
 
             gDataBuffer[11] = 0x00;             //Sector size 
             gDataBuffer[12] = 0x02;
+            disk->sectorSize = MEDIA_SECTOR_SIZE;   // d is not loaded from a boot sector in this mode
 
             gDataBuffer[13] = disk->SecPerClus;   //Sectors per cluster
 
@@ -3375,9 +3662,19 @@ int FSfclose(FSFILE   *fo)
 #endif
 
     FSerrno = CE_GOOD;
+    FSSelectFileVolume(fo);
     fHandle = fo->entry;
 
 #ifdef ALLOW_WRITES
+    // The media was taken away while the file was open for write;
+    // the directory entry can not be updated, just release the file.
+    if(fo->flags.write && gMediaLocked)
+    {
+        FSerrno = CE_WRITE_PROTECTED;
+        error = EOF;
+        fo->flags.write = FALSE;
+    }
+
     if(fo->flags.write)
     {
         if (gNeedDataWrite)
@@ -3916,6 +4213,15 @@ int FSrename (const char * fileName, FSFILE * fo)
         FSerrno = CE_FILENOTOPENED;
         return -1;
     }
+
+    FSSelectFileVolume(fo);
+
+    if (FSWriteProtectState())
+    {
+        FSerrno = CE_WRITE_PROTECTED;
+        return -1;
+    }
+
     // If fo != NULL, rename the file
     if (FormatFileName (fileName, fo->name, 0) == FALSE)
     {
@@ -4285,7 +4591,7 @@ FSFILE * FSfopen( const char * fileName, const char *mode )
             final = CE_FILE_NOT_FOUND;
     }
 
-    if (MDD_WriteProtectState())
+    if (FSWriteProtectState())
     {
         filePtr->flags.write = 0;;
     }
@@ -4370,7 +4676,7 @@ int FSremove (const char * fileName)
 
     FSerrno = CE_GOOD;
 
-    if (MDD_WriteProtectState())
+    if (FSWriteProtectState())
     {
         FSerrno = CE_WRITE_PROTECTED;
         return (-1);
@@ -4451,6 +4757,8 @@ int FSremove (const char * fileName)
 
 void FSrewind (FSFILE * fo)
 {
+    FSSelectFileVolume(fo);
+
 #ifdef ALLOW_WRITES
     if (gNeedDataWrite)
         flushData();
@@ -5025,6 +5333,14 @@ int FSattrib (FSFILE * file, unsigned char attributes)
         return -1;
     }
 
+    FSSelectFileVolume(file);
+
+    if (FSWriteProtectState())
+    {
+        FSerrno = CE_WRITE_PROTECTED;
+        return -1;
+    }
+
     fHandle = file->entry;
 
     file->dirccls = file->dirclus;
@@ -5106,7 +5422,9 @@ size_t FSfwrite(const void *ptr, size_t size, size_t n, FSFILE *stream)
     WORD        pos;
     DWORD       l;                     // absolute lba of sector to load
     DWORD       seek, filesize;
-    WORD        writeCount = 0;
+    DWORD       writeCount = 0;
+
+    FSSelectFileVolume(stream);
 
     // see if the file was opened in a write mode
     if(!(stream->flags.write))
@@ -5119,7 +5437,7 @@ size_t FSfwrite(const void *ptr, size_t size, size_t n, FSFILE *stream)
     if (count == 0)
         return 0;
 
-    if (MDD_WriteProtectState())
+    if (FSWriteProtectState())
     {
         FSerrno = CE_WRITE_PROTECTED;
         error = CE_WRITE_PROTECTED;
@@ -5220,6 +5538,38 @@ size_t FSfwrite(const void *ptr, size_t size, size_t n, FSFILE *stream)
                 l = Cluster2Sector(dsk,stream->ccls);
                 l += (WORD)stream->sec;      // add the sector number to it
                 gBufferOwner = stream;
+
+#ifdef MDD_SectorWriteMulti
+                // Whole sectors go straight from the caller's buffer to the
+                // media, as many as are contiguous in this cluster, in one transfer
+                if (count >= dsk->sectorSize)
+                {
+                    DWORD run = dsk->SecPerClus - stream->sec;
+
+                    if (run > count / dsk->sectorSize)
+                        run = count / dsk->sectorSize;
+
+                    if (!MDD_SectorWriteMulti( l, src, (WORD) run, FALSE))
+                    {
+                        FSerrno = CE_WRITE_ERROR;
+                        return 0;
+                    }
+
+                    // the data buffer may hold a stale copy of one of these sectors
+                    gLastDataSectorRead = 0xFFFFFFFF;
+                    stream->sec += (WORD) (run - 1);
+                    run *= dsk->sectorSize;
+                    src += run;
+                    seek += run;
+                    count -= run;
+                    writeCount += run;
+                    if (seek > filesize)
+                        filesize = seek;
+                    pos = dsk->sectorSize;
+                    continue;
+                }
+#endif
+
                 // If we just allocated a new cluster, then the cluster will
                 // contain garbage data, so it doesn't matter what we write to it
                 // Whatever is in the buffer will work fine
@@ -5389,9 +5739,10 @@ size_t FSfread (void *ptr, size_t size, size_t n, FSFILE *stream)
     DWORD    seek, sec_sel;
     WORD    pos;       //position within sector
     CETYPE   error = CE_GOOD;
-    WORD    readCount = 0;
+    DWORD   readCount = 0;
 
     FSerrno = CE_GOOD;
+    FSSelectFileVolume(stream);
 
     dsk    = (DISK *)stream->dsk;
     pos    = stream->pos;
@@ -5461,6 +5812,37 @@ size_t FSfread (void *ptr, size_t size, size_t n, FSFILE *stream)
             sec_sel = Cluster2Sector(dsk,stream->ccls);
             sec_sel += (WORD)stream->sec;      // add the sector number to it
 
+#ifdef MDD_SectorReadMulti
+            // Whole sectors go straight from the media into the caller's
+            // buffer, as many as are contiguous in this cluster, in one transfer
+            if ((len >= dsk->sectorSize) && ((stream->size - seek) >= dsk->sectorSize))
+            {
+                DWORD run = dsk->SecPerClus - stream->sec;
+
+                if (run > len / dsk->sectorSize)
+                    run = len / dsk->sectorSize;
+                if (run > (stream->size - seek) / dsk->sectorSize)
+                    run = (stream->size - seek) / dsk->sectorSize;
+
+                if( !MDD_SectorReadMulti( sec_sel, pointer, (WORD) run) )
+                {
+                    FSerrno = CE_BAD_SECTOR_READ;
+                    error = CE_BAD_SECTOR_READ;
+                    break;
+                }
+
+                // leave the stream at the end of the last sector read,
+                // the data buffer still holds gLastDataSectorRead
+                stream->sec += (WORD) (run - 1);
+                run *= dsk->sectorSize;
+                pointer += run;
+                seek += run;
+                readCount += run;
+                len -= run;
+                pos = dsk->sectorSize;
+                continue;
+            }
+#endif
 
             gBufferOwner = stream;
             gBufferZeroed = FALSE;
@@ -5490,6 +5872,151 @@ size_t FSfread (void *ptr, size_t size, size_t n, FSFILE *stream)
 } // fread
 
 
+/**************************************************************************
+  Function:
+    size_t FSfborrow(FSFILE *stream, const BYTE **ppData)
+  Summary:
+    Get the next bytes of a file straight out of the sector buffer
+  Conditions:
+    File is opened in a read mode
+  Input:
+    stream -  File to be read from
+    ppData -  Receives a pointer to the bytes in the sector buffer
+  Return:
+    size_t - number of bytes at *ppData, 0 at the end of the file or on error
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    The FSfborrow function loads the sector holding the current file
+    position, the same way FSfread would, but instead of copying it
+    hands back a pointer into the volume's sector buffer.  The span runs
+    to the end of the sector or the end of the file, whichever is first.
+    The position does not move until FSfconsume is called, so calling
+    FSfborrow again returns the same bytes without touching the media.
+  Remarks:
+    The pointer is only good until the next call into the file system
+    for any file on the volume, since they share the sector buffer.
+  **************************************************************************/
+
+size_t FSfborrow (FSFILE *stream, const BYTE **ppData)
+{
+    DISK    *dsk;
+    DWORD   sec_sel;
+    DWORD   cb;
+
+    FSerrno = CE_GOOD;
+    *ppData = NULL;
+    FSSelectFileVolume(stream);
+
+    dsk = (DISK *)stream->dsk;
+
+    if( !stream->flags.read )
+    {
+        FSerrno = CE_WRITEONLY;
+        return 0;
+    }
+
+#ifdef ALLOW_WRITES
+    if (gNeedDataWrite)
+        if (flushData())
+        {
+            FSerrno = CE_WRITE_ERROR;
+            return 0;
+        }
+#endif
+
+    if( stream->seek == stream->size )
+    {
+        FSerrno = CE_EOF;
+        return 0;
+    }
+
+    // step on to the next sector, as FSfread does
+    if( stream->pos == dsk->sectorSize )
+    {
+        stream->pos = 0;
+        stream->sec++;
+
+        if( stream->sec == dsk->SecPerClus )
+        {
+            stream->sec = 0;
+            if( FILEget_next_cluster( stream, 1) != CE_GOOD )
+            {
+                FSerrno = CE_COULD_NOT_GET_CLUSTER;
+                return 0;
+            }
+        }
+    }
+
+    sec_sel = Cluster2Sector(dsk,stream->ccls);
+    sec_sel += (WORD)stream->sec;      // add the sector number to it
+
+    // only go to the media if the buffer holds something else
+    if( (gBufferOwner != stream) || (gLastDataSectorRead != sec_sel) )
+    {
+        gBufferOwner = stream;
+        gBufferZeroed = FALSE;
+        if( !MDD_SectorRead( sec_sel, dsk->buffer) )
+        {
+            gLastDataSectorRead = 0xFFFFFFFF;
+            FSerrno = CE_BAD_SECTOR_READ;
+            return 0;
+        }
+        gLastDataSectorRead = sec_sel;
+    }
+
+    cb = dsk->sectorSize - stream->pos;
+    if (cb > stream->size - stream->seek)
+        cb = stream->size - stream->seek;
+
+    *ppData = dsk->buffer + stream->pos;
+    return cb;
+} // fborrow
+
+
+/**************************************************************************
+  Function:
+    size_t FSfconsume(FSFILE *stream, size_t n)
+  Summary:
+    Move past bytes taken with FSfborrow
+  Conditions:
+    FSfborrow returned a span for this file and no other file system
+    call was made since
+  Input:
+    stream -  File that was borrowed from
+    n -       Number of bytes used
+  Return:
+    size_t - number of bytes the position moved
+  Side Effects:
+    The FSerrno variable will be changed.
+  Description:
+    The FSfconsume function advances the file position by n bytes, but
+    never past the span FSfborrow returned; the next FSfborrow continues
+    from there.
+  Remarks:
+    None.
+  **************************************************************************/
+
+size_t FSfconsume (FSFILE *stream, size_t n)
+{
+    DISK    *dsk = (DISK *)stream->dsk;
+    DWORD   cb;
+
+    FSerrno = CE_GOOD;
+
+    cb = dsk->sectorSize - stream->pos;
+    if (cb > stream->size - stream->seek)
+        cb = stream->size - stream->seek;
+    if (n > cb)
+        n = cb;
+
+    stream->pos += (WORD) n;
+    stream->seek += n;
+
+    return n;
+} // fconsume
+
+
 /***************************************************************************
   Function:
     BYTE FormatFileName( const char* fileName, char* fN2, BYTE mode )
@@ -5760,6 +6287,7 @@ int FSfseek(FSFILE *stream, long offset, int whence)
     BYTE   test;
     long offset2 = offset;
 
+    FSSelectFileVolume(stream);
     dsk = stream->dsk;
 
     switch(whence)
@@ -7403,7 +7931,7 @@ int mkdirhelper (BYTE mode, char * ramptr, char * romptr)
 
     FSerrno = CE_GOOD;
 
-    if (MDD_WriteProtectState())
+    if (FSWriteProtectState())
     {
         FSerrno = CE_WRITE_PROTECTED;
         return (-1);
@@ -8113,6 +8641,12 @@ int rmdirhelper (BYTE mode, char * ramptr, char * romptr, unsigned char rmsubdir
 
     FSerrno = CE_GOOD;
 
+    if (FSWriteProtectState())
+    {
+        FSerrno = CE_WRITE_PROTECTED;
+        return -1;
+    }
+
     // Back up the current working directory
     FileObjectCopy (tempCWD, cwdptr);
 
@@ -8447,7 +8981,7 @@ int eraseDir (char * path)
     BYTE Index;
     FSFILE tempCWDobj2;
 
-    if (MDD_WriteProtectState())
+    if (FSWriteProtectState())
     {
         return (-1);
     }
@@ -0,0 +1,170 @@
+/*******************************************************************************
+
+    USB Descriptor Builder (Header File)
+
+Summary:
+    Macros that lay out the standard USB descriptors as flat ROM byte
+    tables and check them at compile time.
+
+Description:
+    The descriptor tables in a sketch's usb_descriptors.c used to be
+    hand-written byte lists, with bLength, wTotalLength and the string
+    counts worked out by hand.  A wrong length is not caught until the
+    host retries or gives up on enumeration.
+
+    These macros emit the same flat byte layout USBStdGetDscHandler()
+    serves directly, so the device stack still does an O(1) index into
+    USB_CD_Ptr[]/USB_SD_Ptr[], but every length is computed by the
+    compiler and every count is checked by USB_DSC_STATIC_ASSERT.
+
+    Typical Usage:
+    <code>
+        #define CFG01_LENGTH    USB_DSC_CONFIG_LENGTH(1, 2, 0)
+
+        ROM BYTE configDescriptor1[] =
+        {
+            USB_DSC_CONFIGURATION(CFG01_LENGTH, 1, 1, 0, _DEFAULT | _SELF, 100),
+            USB_DSC_INTERFACE(0, 0, 2, 0xFF, 0xFF, 0xFF, 0),
+            USB_DSC_ENDPOINT(_EP01_OUT, _BULK, 64, 1),
+            USB_DSC_ENDPOINT(_EP01_IN, _BULK, 64, 1)
+        };
+        USB_DSC_STATIC_ASSERT(sizeof(configDescriptor1) == CFG01_LENGTH, cfg01_length);
+
+        USB_DSC_STRING(sd001, 'c','h','i','p','K','I','T');
+    </code>
+
+    The checks are C typedefs so they work with the C compiler that
+    builds the sketch's .c files, no C++11 constexpr is needed.
+*******************************************************************************/
+//DOM-IGNORE-BEGIN
+/*******************************************************************************
+
+* FileName:        usb_dsc_builder.h
+* Dependencies:    usb_ch9.h
+* Processor:       PIC32MX microcontrollers with USB module
+* Compiler:        C32
+* Company:         Digilent Inc.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+Change History:
+  Rev    Description
+  ----   -----------
+  1.0    Initial release
+*******************************************************************************/
+//DOM-IGNORE-END
+
+#ifndef _USB_DSC_BUILDER_H_
+#define _USB_DSC_BUILDER_H_
+
+// *****************************************************************************
+// Section: Descriptor lengths
+// *****************************************************************************
+
+#define USB_DSC_DEVICE_LEN          0x12    // sizeof(USB_DEVICE_DESCRIPTOR)
+#define USB_DSC_CONFIG_LEN          0x09    // sizeof(USB_CONFIGURATION_DESCRIPTOR)
+#define USB_DSC_INTERFACE_LEN       0x09    // sizeof(USB_INTERFACE_DESCRIPTOR)
+#define USB_DSC_ENDPOINT_LEN        0x07    // sizeof(USB_ENDPOINT_DESCRIPTOR)
+#define USB_DSC_HID_LEN             0x09    // HID class descriptor with one report descriptor
+
+// wTotalLength of a configuration with cIntf interfaces, cEP endpoints and
+// cbClass bytes of class specific descriptors
+#define USB_DSC_CONFIG_LENGTH(cIntf, cEP, cbClass) \
+    (USB_DSC_CONFIG_LEN + ((cIntf) * USB_DSC_INTERFACE_LEN) + ((cEP) * USB_DSC_ENDPOINT_LEN) + (cbClass))
+
+// *****************************************************************************
+// Section: Compile time checks
+// *****************************************************************************
+
+// A negative array size stops the build; name shows up in the error message
+#define USB_DSC_STATIC_ASSERT(cond, name) \
+    typedef char usb_dsc_assert_##name[(cond) ? 1 : -1]
+
+// Number of entries in a descriptor pointer table like USB_SD_Ptr[]
+#define USB_DSC_COUNT(table)        (sizeof(table) / sizeof((table)[0]))
+
+// *****************************************************************************
+// Section: Descriptor byte layouts
+// *****************************************************************************
+
+// Multi-byte fields are little endian and listed a byte at a time
+#define USB_DSC_WORD(w)             (BYTE) ((w) & 0xFF), (BYTE) (((w) >> 8) & 0xFF)
+
+/*******************************************************************************
+    Configuration descriptor.  maxPower is in mA and is halved here, the
+    descriptor counts it in 2mA units.
+*******************************************************************************/
+#define USB_DSC_CONFIGURATION(totalLength, cIntf, configValue, iConfig, attributes, maxPower) \
+    USB_DSC_CONFIG_LEN,                                                 \
+    USB_DESCRIPTOR_CONFIGURATION,                                       \
+    USB_DSC_WORD(totalLength),                                          \
+    (cIntf),                                                            \
+    (configValue),                                                      \
+    (iConfig),                                                          \
+    (attributes),                                                       \
+    (BYTE) ((maxPower) / 2)
+
+#define USB_DSC_INTERFACE(intf, altSetting, cEP, intfClass, subClass, protocol, iIntf) \
+    USB_DSC_INTERFACE_LEN,                                              \
+    USB_DESCRIPTOR_INTERFACE,                                           \
+    (intf),                                                             \
+    (altSetting),                                                       \
+    (cEP),                                                              \
+    (intfClass),                                                        \
+    (subClass),                                                         \
+    (protocol),                                                         \
+    (iIntf)
+
+#define USB_DSC_ENDPOINT(address, attributes, maxPacketSize, interval) \
+    USB_DSC_ENDPOINT_LEN,                                               \
+    USB_DESCRIPTOR_ENDPOINT,                                            \
+    (address),                                                          \
+    (attributes),                                                       \
+    USB_DSC_WORD(maxPacketSize),                                        \
+    (interval)
+
+// HID class descriptor followed by the type and length of its one report descriptor
+#define USB_DSC_HID(bcdHID, countryCode, reportLength)                  \
+    USB_DSC_HID_LEN,                                                    \
+    0x21,                                                               \
+    USB_DSC_WORD(bcdHID),                                               \
+    (countryCode),                                                      \
+    1,                                                                  \
+    0x22,                                                               \
+    USB_DSC_WORD(reportLength)
+
+/*******************************************************************************
+    String descriptor.  The characters are listed as WORDs; the array is
+    sized from the initializer and bLength from the finished object, so
+    nothing has to be counted by hand.
+*******************************************************************************/
+#define USB_DSC_STRING(name, ...)                                       \
+    ROM struct{BYTE bLength;BYTE bDscType;WORD string[sizeof((WORD[]){__VA_ARGS__}) / sizeof(WORD)];} name = \
+    {sizeof(name), USB_DESCRIPTOR_STRING, {__VA_ARGS__}}
+
+// *****************************************************************************
+// Section: Endpoint checks
+// *****************************************************************************
+
+// Full speed limits; bulk and control are 8, 16, 32 or 64, interrupt up to 64
+#define USB_DSC_EP_SIZE_OK(attributes, size)                            \
+    ((((attributes) & 0x03) == _ISO) ? ((size) <= 1023) :               \
+     (((attributes) & 0x03) == _INTERRUPT) ? ((size) > 0 && (size) <= 64) : \
+     ((size) == 8 || (size) == 16 || (size) == 32 || (size) == 64))
+
+// Endpoint numbers used by a configuration must be backed by the BDT
+#define USB_DSC_EP_NUMBER_OK(address)   (((address) & 0x0F) <= USB_MAX_EP_NUMBER)
+
+#endif //_USB_DSC_BUILDER_H_
@@ -173,6 +173,26 @@
 #define MSD_CSW_SIZE 0x0d	// 10 bytes CSW data
 #define MSD_CBW_SIZE 0x1f	// 31 bytes CBW data
 
+#define MSD_CBW_SIGNATURE   0x43425355ul    // "USBC"
+#define MSD_CSW_SIGNATURE   0x53425355ul    // "USBS"
+
+#define MSD_CSW_COMMAND_PASSED  0x00
+#define MSD_CSW_COMMAND_FAILED  0x01
+#define MSD_CSW_PHASE_ERROR     0x02
+
+//Number of sector buffers used to stream READ(10)/WRITE(10) data.  While
+//the endpoint moves one sector the media reads or writes the other.
+#define MSD_SECTOR_BUFFERS      2
+
+//Events sent to USER_USB_CALLBACK_EVENT_HANDLER when the host starts and
+//stops using a LUN.  The data pointer points to the LUN number (1 byte).
+//While a LUN is claimed nothing else (FSIO for instance) may write the media.
+#ifndef EVENT_MSD_OFFSET
+    #define EVENT_MSD_OFFSET    0
+#endif
+#define EVENT_MSD_MEDIA_CLAIMED     EVENT_MSD_BASE + EVENT_MSD_OFFSET + 16  // The host started to use the media
+#define EVENT_MSD_MEDIA_RELEASED    EVENT_MSD_BASE + EVENT_MSD_OFFSET + 17  // The host ejected the media or went away
+
 #define INVALID_CBW 1
 #define VALID_CBW !INVALID_CBW
 
@@ -498,6 +518,8 @@ extern volatile BYTE CtrlTrfData[USB_EP0_BUFF_SIZE];
 void USBCheckMSDRequest(void);
 BYTE MSDTasks(void);
 void USBMSDInit(void);
+BOOL MSDIsMediaClaimed(BYTE LUN);
+void MSDReleaseMedia(void);
 
 /**************************************************************************
     Function:
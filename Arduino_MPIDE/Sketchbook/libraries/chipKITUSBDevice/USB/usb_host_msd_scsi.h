@@ -22,12 +22,12 @@ Description:
     contains macros to allow the File System code to reference the functions in
     this file.
 
-    Currently, the file system layer above this interface layer is limited to
-    one LUN (Logical Unit Number) on a single mass storage device.  This layer
-    accepts and stores the max LUN from the USB MSD layer, but all sector reads
-    and writes are hard-coded to LUN 0, since the layer above does not specify
-    a LUN in the sector read and write commands.  Also, to interface with the
-    existing file system code, only one attached device is allowed.
+    Each LUN (Logical Unit Number) of each attached mass storage device is a
+    volume; up to USB_MAX_MSD_SCSI_VOLUMES volumes (by default
+    USB_MAX_MASS_STORAGE_DEVICES) are tracked.  The media functions work on
+    the volume selected with USBHostMSDSCSISelectVolume(), which is how the
+    file system mounts several LUNs, such as the slots of a card reader, at
+    the same time.
 
 Summary:
     This is the header file for a USB Embedded Host that is using a SCSI
@@ -68,6 +68,8 @@ Change History:
   ----  --------------------------------------
   2.6a- No change
    2.7
+
+  Digilent (KeithV) - Volume selection and multi-sector transfers
 *******************************************************************************/
 
 #ifndef __USBHOSTMSDSCSI_H__
@@ -75,7 +77,7 @@ Change History:
 //DOM-IGNORE-END
 
 #include "USB/usb.h"
-#include "FSConfig.h"
+#include "FSconfig.h"
 #include "MDD File System/FSDefs.h"
 
 // *****************************************************************************
@@ -297,6 +299,122 @@ BYTE    USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer );
 BYTE    USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allowWriteToZero);
 
 
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorReadMulti( DWORD sectorAddress, BYTE *dataBuffer,
+                        WORD sectorCount )
+
+  Summary:
+    This function reads consecutive sectors with one command.
+
+  Description:
+    This function uses a single SCSI READ10 command to read sectorCount
+    sectors starting at sectorAddress into the application buffer.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to read
+    BYTE    *dataBuffer     - buffer to store data, sectorCount sectors long
+    WORD    sectorCount     - number of sectors to read
+
+  Return Values:
+    TRUE    - read performed successfully
+    FALSE   - read was not successful
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSISectorReadMulti( DWORD sectorAddress, BYTE *dataBuffer, WORD sectorCount );
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorWriteMulti( DWORD sectorAddress, BYTE *dataBuffer,
+                        WORD sectorCount, BYTE allowWriteToZero )
+
+  Summary:
+    This function writes consecutive sectors with one command.
+
+  Description:
+    This function uses a single SCSI WRITE10 command to write sectorCount
+    sectors starting at sectorAddress from the application buffer.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to write
+    BYTE    *dataBuffer     - buffer with application data
+    WORD    sectorCount     - number of sectors to write
+    BYTE    allowWriteToZero- If a write to sector 0 is allowed.
+
+  Return Values:
+    TRUE    - write performed successfully
+    FALSE   - write was not successful
+
+  Remarks:
+    This function blocks until the write is complete.
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSISectorWriteMulti( DWORD sectorAddress, BYTE *dataBuffer, WORD sectorCount, BYTE allowWriteToZero );
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISelectVolume( BYTE volume )
+
+  Summary:
+    This function selects the volume the media functions work on.
+
+  Description:
+    Volumes are numbered in the order their device and LUN were reported,
+    starting at 0.  The media detect, initialize, reset, read and write
+    functions all work on the selected volume.
+
+  Precondition:
+    None
+
+  Parameters:
+    BYTE volume     - volume to select, 0 to USB_MAX_MSD_SCSI_VOLUMES - 1
+
+  Return Values:
+    TRUE    - the volume was selected
+    FALSE   - there is no such volume, the selection did not change
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSISelectVolume( BYTE volume );
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSICurrentVolume( void )
+
+  Description:
+    This function returns the volume selected by
+    USBHostMSDSCSISelectVolume().
+
+  Precondition:
+    None
+
+  Parameters:
+    None - None
+
+  Returns:
+    The selected volume
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSICurrentVolume( void );
+
+
 /****************************************************************************
   Function:
     BYTE USBHostMSDSCSIWriteProtectState( void )
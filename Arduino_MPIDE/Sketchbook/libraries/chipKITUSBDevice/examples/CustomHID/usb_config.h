@@ -139,6 +139,7 @@
 
 #define USB_SUPPORT_DEVICE
 
+#define USB_NUM_CONFIG_DESCRIPTORS 1
 #define USB_NUM_STRING_DESCRIPTORS 3
 
 //#define USB_INTERRUPT_LEGACY_CALLBACKS
@@ -130,6 +130,16 @@ USB_SD_Ptr[0], &sd001 must be in position USB_SD_Ptr[1] and so on.
 The look-up table USB_SD_Ptr is used by the get string handler
 function.
 
+-------------------------------------------------------------------
+Using the descriptor builder
+-------------------------------------------------------------------
+The macros in USB/usb_dsc_builder.h lay out the same byte arrays,
+but take the lengths, the packet sizes and the string lengths from
+the compiler.  USB_DSC_STATIC_ASSERT then stops the build if
+wTotalLength, USB_NUM_STRING_DESCRIPTORS or an endpoint does not
+match what was declared, rather than the host retrying enumeration.
+The descriptors below are written that way.
+
 -------------------------------------------------------------------
 
 The look-up table scheme also applies to the configuration
@@ -156,6 +166,7 @@ state according to the definition in the USB specification.
 /** INCLUDES *******************************************************/
 #include "./USB/usb.h"
 #include "./USB/usb_function_hid.h"
+#include "./USB/usb_dsc_builder.h"
 
 /** CONSTANTS ******************************************************/
 #if defined(__18CXX)
@@ -182,72 +193,41 @@ ROM USB_DEVICE_DESCRIPTOR device_dsc=
 };
 
 /* Configuration 1 Descriptor */
+#define CFG01_LENGTH    USB_DSC_CONFIG_LENGTH(1, 2, USB_DSC_HID_LEN)
+#define HID_EP_SIZE     64
+
 ROM BYTE configDescriptor1[]={
-    /* Configuration Descriptor */
-    0x09,//sizeof(USB_CFG_DSC),    // Size of this descriptor in bytes
-    USB_DESCRIPTOR_CONFIGURATION,                // CONFIGURATION descriptor type
-    0x29,0x00,            // Total length of data for this cfg
-    1,                      // Number of interfaces in this cfg
-    1,                      // Index value of this configuration
-    0,                      // Configuration string index
-    _DEFAULT | _SELF,               // Attributes, see usb_device.h
-    50,                     // Max power consumption (2X mA)
-							
-    /* Interface Descriptor */
-    0x09,//sizeof(USB_INTF_DSC),   // Size of this descriptor in bytes
-    USB_DESCRIPTOR_INTERFACE,               // INTERFACE descriptor type
-    0,                      // Interface Number
-    0,                      // Alternate Setting Number
-    2,                      // Number of endpoints in this intf
-    HID_INTF,               // Class code
-    0,     // Subclass code
-    0,     // Protocol code
-    0,                      // Interface string index
-
-    /* HID Class-Specific Descriptor */
-    0x09,//sizeof(USB_HID_DSC)+3,    // Size of this descriptor in bytes
-    DSC_HID,                // HID descriptor type
-    0x11,0x01,                 // HID Spec Release Number in BCD format (1.11)
-    0x00,                   // Country Code (0x00 for Not supported)
-    HID_NUM_OF_DSC,         // Number of class descriptors, see usbcfg.h
-    DSC_RPT,                // Report descriptor type
-    HID_RPT01_SIZE,0x00,//sizeof(hid_rpt01),      // Size of the report descriptor
-    
-    /* Endpoint Descriptor */
-    0x07,/*sizeof(USB_EP_DSC)*/
-    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
-    HID_EP | _EP_IN,                   //EndpointAddress
-    _INTERRUPT,                       //Attributes
-    0x40,0x00,                  //size
-    0x01,                        //Interval
+    //                    total length,  interfaces, value, string, attributes, mA
+    USB_DSC_CONFIGURATION(CFG01_LENGTH,  1,          1,     0,      _DEFAULT | _SELF, 100),
 
-    /* Endpoint Descriptor */
-    0x07,/*sizeof(USB_EP_DSC)*/
-    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
-    HID_EP | _EP_OUT,                   //EndpointAddress
-    _INTERRUPT,                       //Attributes
-    0x40,0x00,                  //size
-    0x01                        //Interval
+    //                intf, alt, endpoints, class,    subclass, protocol, string
+    USB_DSC_INTERFACE(0,    0,   2,         HID_INTF, 0,        0,        0),
+
+    //          bcdHID, country, report descriptor length
+    USB_DSC_HID(0x0111, 0x00,    HID_RPT01_SIZE),
+
+    //               address,          attributes, size,        interval
+    USB_DSC_ENDPOINT(HID_EP | _EP_IN,  _INTERRUPT, HID_EP_SIZE, 1),
+    USB_DSC_ENDPOINT(HID_EP | _EP_OUT, _INTERRUPT, HID_EP_SIZE, 1)
 };
 
+USB_DSC_STATIC_ASSERT(sizeof(configDescriptor1) == CFG01_LENGTH, cfg01_length);
+USB_DSC_STATIC_ASSERT(HID_NUM_OF_DSC == 1, hid_one_report_descriptor);
+USB_DSC_STATIC_ASSERT(USB_DSC_EP_SIZE_OK(_INTERRUPT, HID_EP_SIZE), hid_ep_size);
+USB_DSC_STATIC_ASSERT(USB_DSC_EP_NUMBER_OK(HID_EP), hid_ep_number);
+
 //Language code string descriptor
-ROM struct{BYTE bLength;BYTE bDscType;WORD string[1];}sd000={
-sizeof(sd000),USB_DESCRIPTOR_STRING,{0x0409
-}};
+USB_DSC_STRING(sd000, 0x0409);
 
 //Manufacturer string descriptor
-ROM struct{BYTE bLength;BYTE bDscType;WORD string[25];}sd001={
-sizeof(sd001),USB_DESCRIPTOR_STRING,
-{'M','i','c','r','o','c','h','i','p',' ',
-'T','e','c','h','n','o','l','o','g','y',' ','I','n','c','.'
-}};
+USB_DSC_STRING(sd001,
+'M','i','c','r','o','c','h','i','p',' ',
+'T','e','c','h','n','o','l','o','g','y',' ','I','n','c','.');
 
 //Product string descriptor
-ROM struct{BYTE bLength;BYTE bDscType;WORD string[22];}sd002={
-sizeof(sd002),USB_DESCRIPTOR_STRING,
-{'S','i','m','p','l','e',' ','H','I','D',' ',
-'D','e','v','i','c','e',' ','D','e','m','o'
-}};
+USB_DSC_STRING(sd002,
+'S','i','m','p','l','e',' ','H','I','D',' ',
+'D','e','v','i','c','e',' ','D','e','m','o');
 
 //Class specific descriptor - HID 
 ROM struct{BYTE report[HID_RPT01_SIZE];}hid_rpt01={
@@ -283,6 +263,9 @@ ROM BYTE *ROM USB_SD_Ptr[]=
     (ROM BYTE *ROM)&sd002
 };
 
+USB_DSC_STATIC_ASSERT(USB_DSC_COUNT(USB_CD_Ptr) == USB_NUM_CONFIG_DESCRIPTORS, config_count);
+USB_DSC_STATIC_ASSERT(USB_DSC_COUNT(USB_SD_Ptr) == USB_NUM_STRING_DESCRIPTORS, string_count);
+
 /** EOF usb_descriptors.c ***************************************************/
 
-#endif
+#endif
\ No newline at end of file
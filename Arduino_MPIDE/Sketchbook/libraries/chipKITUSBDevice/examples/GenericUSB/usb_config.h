@@ -139,7 +139,8 @@
 
 #define USB_SUPPORT_DEVICE
 
-#define USB_NUM_STRING_DESCRIPTORS 3
+#define USB_NUM_CONFIG_DESCRIPTORS 1
+#define USB_NUM_STRING_DESCRIPTORS 4
 
 //#define USB_INTERRUPT_LEGACY_CALLBACKS
 #define USB_ENABLE_ALL_HANDLERS
@@ -130,6 +130,16 @@ USB_SD_Ptr[0], &sd001 must be in position USB_SD_Ptr[1] and so on.
 The look-up table USB_SD_Ptr is used by the get string handler
 function.
 
+-------------------------------------------------------------------
+Using the descriptor builder
+-------------------------------------------------------------------
+The macros in USB/usb_dsc_builder.h lay out the same byte arrays,
+but take the lengths, the packet sizes and the string lengths from
+the compiler.  USB_DSC_STATIC_ASSERT then stops the build if
+wTotalLength, USB_NUM_STRING_DESCRIPTORS or an endpoint does not
+match what was declared, rather than the host retrying enumeration.
+The descriptors below are written that way.
+
 -------------------------------------------------------------------
 
 The look-up table scheme also applies to the configuration
@@ -155,6 +165,7 @@ state according to the definition in the USB specification.
  
 /** INCLUDES *******************************************************/
 #include "./USB/usb.h"
+#include "./USB/usb_dsc_builder.h"
 
 /** CONSTANTS ******************************************************/
 #if defined(__18CXX)
@@ -181,65 +192,40 @@ ROM USB_DEVICE_DESCRIPTOR device_dsc=
 };
 
 /* Configuration 1 Descriptor */
+#define CFG01_LENGTH    USB_DSC_CONFIG_LENGTH(1, 2, 0)
+
 ROM BYTE configDescriptor1[]={
-    /* Configuration Descriptor */
-    0x09,//sizeof(USB_CFG_DSC),    // Size of this descriptor in bytes
-    USB_DESCRIPTOR_CONFIGURATION,                // CONFIGURATION descriptor type
-    0x20,0x00,            // Total length of data for this cfg
-    1,                      // Number of interfaces in this cfg
-    1,                      // Index value of this configuration
-    0,                      // Configuration string index
-    _DEFAULT | _SELF,               // Attributes, see usb_device.h
-    50,                     // Max power consumption (2X mA)
-							
-    /* Interface Descriptor */
-    0x09,//sizeof(USB_INTF_DSC),   // Size of this descriptor in bytes
-    USB_DESCRIPTOR_INTERFACE,               // INTERFACE descriptor type
-    0,                      // Interface Number
-    0,                      // Alternate Setting Number
-    2,                      // Number of endpoints in this intf
-    0xFF,                   // Class code
-    0xFF,                   // Subclass code
-    0xFF,                   // Protocol code
-    0,                      // Interface string index
-    
-    /* Endpoint Descriptor */
-    0x07,                       /*sizeof(USB_EP_DSC)*/
-    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
-    _EP01_OUT,                  //EndpointAddress
-    _BULK,                       //Attributes
-    USBGEN_EP_SIZE,0x00,        //size
-    1,                         //Interval
-    
-    0x07,                       /*sizeof(USB_EP_DSC)*/
-    USB_DESCRIPTOR_ENDPOINT,    //Endpoint Descriptor
-    _EP01_IN,                   //EndpointAddress
-    _BULK,                       //Attributes
-    USBGEN_EP_SIZE,0x00,        //size
-    1                          //Interval
+    //                    total length,  interfaces, value, string, attributes, mA
+    USB_DSC_CONFIGURATION(CFG01_LENGTH,  1,          1,     0,      _DEFAULT | _SELF, 100),
+
+    //                intf, alt, endpoints, class, subclass, protocol, string
+    USB_DSC_INTERFACE(0,    0,   2,         0xFF,  0xFF,     0xFF,     0),
+
+    //               address,   attributes, size,           interval
+    USB_DSC_ENDPOINT(_EP01_OUT, _BULK,      USBGEN_EP_SIZE, 1),
+    USB_DSC_ENDPOINT(_EP01_IN,  _BULK,      USBGEN_EP_SIZE, 1)
 };
 
+USB_DSC_STATIC_ASSERT(sizeof(configDescriptor1) == CFG01_LENGTH, cfg01_length);
+USB_DSC_STATIC_ASSERT(USB_DSC_EP_SIZE_OK(_BULK, USBGEN_EP_SIZE), gen_ep_size);
+USB_DSC_STATIC_ASSERT(USB_DSC_EP_NUMBER_OK(USBGEN_EP_NUM), gen_ep_number);
+
 
 //Language code string descriptor
-ROM struct{BYTE bLength;BYTE bDscType;WORD string[1];}sd000={
-sizeof(sd000),USB_DESCRIPTOR_STRING,{0x0409}};
+USB_DSC_STRING(sd000, 0x0409);
 
 //Manufacturer string descriptor
-ROM struct{BYTE bLength;BYTE bDscType;WORD string[25];}sd001={
-sizeof(sd001),USB_DESCRIPTOR_STRING,
-{'M','i','c','r','o','c','h','i','p',' ',
-'T','e','c','h','n','o','l','o','g','y',' ','I','n','c','.'
-}};
+USB_DSC_STRING(sd001,
+'M','i','c','r','o','c','h','i','p',' ',
+'T','e','c','h','n','o','l','o','g','y',' ','I','n','c','.');
 
 //Product string descriptor
-ROM struct{BYTE bLength;BYTE bDscType;WORD string[31];}sd002={
-sizeof(sd002),USB_DESCRIPTOR_STRING,
-{'M','i','c','r','o','c','h','i','p',' ','W','i','n','U','S','B',
-' ','E','x','a','m','p','l','e',' ','D','e','v','i','c','e'}};
+USB_DSC_STRING(sd002,
+'M','i','c','r','o','c','h','i','p',' ','W','i','n','U','S','B',
+' ','E','x','a','m','p','l','e',' ','D','e','v','i','c','e');
 
-ROM struct{BYTE bLength;BYTE bDscType;WORD string[4];}sd003={
-sizeof(sd003),USB_DESCRIPTOR_STRING,
-{'0','1','2','3'}};
+//Serial number string descriptor
+USB_DSC_STRING(sd003, '0','1','2','3');
 
 //Array of configuration descriptors
 ROM BYTE *ROM USB_CD_Ptr[]=
@@ -255,6 +241,9 @@ ROM BYTE *ROM USB_SD_Ptr[]=
     (ROM BYTE *ROM)&sd003
 };
 
+USB_DSC_STATIC_ASSERT(USB_DSC_COUNT(USB_CD_Ptr) == USB_NUM_CONFIG_DESCRIPTORS, config_count);
+USB_DSC_STATIC_ASSERT(USB_DSC_COUNT(USB_SD_Ptr) == USB_NUM_STRING_DESCRIPTORS, string_count);
+
 /** EOF usb_descriptors.c ***************************************************/
 
-#endif
+#endif
\ No newline at end of file
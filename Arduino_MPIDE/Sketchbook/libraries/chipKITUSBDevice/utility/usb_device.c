@@ -1842,6 +1842,16 @@ static void USBStdGetDscHandler(void)
                 inPipes[0].wCount.Val = sizeof(device_dsc);
                 break;
             case USB_DESCRIPTOR_CONFIGURATION:
+                //USB_NUM_CONFIG_DESCRIPTORS is optional; when usb_config.h gives it, an
+                //  index past the end of the table is stalled instead of served from
+                //  whatever follows it in flash.
+                #if defined(USB_NUM_CONFIG_DESCRIPTORS)
+                if(SetupPkt.bDscIndex >= USB_NUM_CONFIG_DESCRIPTORS)
+                {
+                    inPipes[0].info.Val = 0;
+                    break;
+                }
+                #endif
                 #if !defined(USB_USER_CONFIG_DESCRIPTOR)
                     inPipes[0].pSrc.bRom = *(USB_CD_Ptr+SetupPkt.bDscIndex);
                 #else
@@ -0,0 +1,832 @@
+/********************************************************************
+ FileName:      usb_function_msd.c
+ Dependencies:  See INCLUDES section
+ Processor:     PIC32 USB Microcontrollers
+ Hardware:      chipKIT boards with the USB device port
+ Complier:      Microchip C32 (for PIC32)
+ Company:       Digilent Inc.
+
+ Software License Agreement:
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+********************************************************************
+ File Description:
+
+    Mass Storage Device function driver, Bulk-Only Transport with the
+    SCSI transparent command set.  The media behind each LUN is reached
+    through the LUN_FUNCTIONS table supplied by the application, the
+    same MDD media interface the MDD File System uses.
+
+    READ(10) and WRITE(10) are streamed: one CBW moves all of its
+    sectors, MSD_SECTOR_BUFFERS sector buffers alternate between the
+    media and the endpoint, and both ping-pong buffers of the data
+    endpoint are kept armed.  While the SIE moves one sector on the bus
+    the media reads or writes the other one.
+
+    The sketch must define USB_USE_MSD, MSD_INTF_ID, MSD_DATA_IN_EP,
+    MSD_DATA_OUT_EP, MSD_IN_EP_SIZE, MSD_OUT_EP_SIZE and MAX_LUN in
+    usb_config.h, provide LUN_FUNCTIONS LUN[MAX_LUN + 1], and use
+    USB_PING_PONG__FULL_PING_PONG.
+
+ Change History:
+  Rev   Description
+  ----  -----------------------------------------
+  1.0   Initial release
+********************************************************************/
+
+/** INCLUDES *******************************************************/
+#include "USB/usb.h"
+#include "HardwareProfile.h"
+
+#if defined(USB_USE_MSD)
+
+#include "USB/usb_function_msd.h"
+
+#if (USB_PING_PONG_MODE != USB_PING_PONG__FULL_PING_PONG)
+    #error The MSD function streams through both ping-pong buffers, use USB_PING_PONG__FULL_PING_PONG
+#endif
+
+#if ((BLOCKLEN_512 % MSD_IN_EP_SIZE) != 0) || ((BLOCKLEN_512 % MSD_OUT_EP_SIZE) != 0)
+    #error The MSD endpoint sizes must divide the sector size
+#endif
+
+/** DEFINITIONS ****************************************************/
+#define MSD_SECTOR_SIZE         BLOCKLEN_512
+
+// MSDCommandState values; what MSD_DATA_IN/MSD_DATA_OUT are moving
+#define MSD_XFER_RESPONSE       0x00    // a short response out of msd_buffer
+#define MSD_XFER_READ10         0x01    // READ(10) sector stream
+#define MSD_XFER_WRITE10        0x02    // WRITE(10) sector stream
+
+/** VARIABLES ******************************************************/
+extern LUN_FUNCTIONS LUN[MAX_LUN + 1];
+extern volatile BDT_ENTRY *pBDTEntryOut[USB_MAX_EP_NUMBER+1];
+BOOL USER_USB_CALLBACK_EVENT_HANDLER(USB_EVENT event, void *pdata, WORD size);
+
+BOOL SoftDetach[MAX_LUN + 1];
+
+static BYTE MSD_State;                  // MSD_WAIT, MSD_DATA_IN, MSD_DATA_OUT, MSD_SEND_CSW
+static BYTE MSDCommandState;            // MSD_XFER_xxx
+static BOOL fStallIn;                   // stall the IN endpoint before the CSW is sent
+static BOOL fStallOut;                  // stall the OUT endpoint before the CSW is sent
+static BOOL fArmCBW;                    // arm the OUT endpoint for the next CBW once it is free
+static BOOL fResetRecovery;             // an invalid CBW came, stay stalled until the host's reset
+static USB_HANDLE USBMSDOutHandle;
+static USB_HANDLE USBMSDInHandle;
+
+static BOOL fMediaClaimed[MAX_LUN + 1];
+static RequestSenseResponse gblSenseData[MAX_LUN + 1];
+
+static BYTE __attribute__ ((aligned(4))) msdSector[MSD_SECTOR_BUFFERS][MSD_SECTOR_SIZE];
+
+// Sector stream state for READ(10)/WRITE(10)
+static struct
+{
+    DWORD       lba;                            // next sector the media side reads or writes
+    WORD        cMediaSectors;                  // sectors the media side still has to move
+    WORD        cUSBSectors;                    // sectors the USB side still has to move
+    BYTE        iMedia;                         // sector buffer the media side uses next
+    BYTE        iUSB;                           // sector buffer the USB side uses next
+    WORD        ibUSB;                          // offset of the next packet in msdSector[iUSB]
+    BOOL        fFull[MSD_SECTOR_BUFFERS];      // the buffer holds a sector waiting for its consumer
+    USB_HANDLE  hLast[MSD_SECTOR_BUFFERS];      // handle of the last packet armed on the buffer
+} stream;
+
+// Short responses are sent out of msd_buffer
+static WORD cbResponse;
+
+static ROM InquiryResponse inq_resp =
+{
+    0x00,       // peripheral device is connected, direct access block device
+    0x80,       // removable
+    0x04,       // version = 00=> does not conform to any standard, 4=> SPC-2
+    0x02,       // response is in format specified by SPC-2
+    0x20,       // n-4 = 36-4=32= 0x20
+    0x00,       // sccs etc.
+    0x00,       // bque=1 and cmdque=0,indicates simple queueing 00 is obsolete,
+                // but as in case of other device, we are just using 00
+    0x00,       // 00 obsolete, 0x80 for basic task queueing
+    {'D','i','g','i','l','e','n','t'},
+    {'c','h','i','p','K','I','T',' ','M','S','D',' ',' ',' ',' ',' '},
+    {'0','0','0','1'}
+};
+
+/** PRIVATE PROTOTYPES *********************************************/
+static void MSDProcessCommand(void);
+static void MSDStartStream(BYTE command);
+static BOOL MSDReadStream(void);
+static BOOL MSDWriteStream(void);
+static BOOL MSDStreamBufferFree(BYTE i);
+static void MSDSetSense(BYTE LUN, BYTE key, BYTE asc, BYTE ascq);
+static void MSDClaimMedia(BYTE LUN);
+static void MSDReleaseLUN(BYTE LUN);
+static BOOL MSDMediaReady(BYTE LUN);
+
+/** DECLARATIONS ***************************************************/
+
+/******************************************************************************
+ * Function:        void USBMSDInit(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Call from the EVENT_CONFIGURED handler after the MSD
+ *                  endpoint has been enabled.  Arms the OUT endpoint for
+ *                  the first CBW and returns any claimed media.
+ *
+ * Note:            None
+ *****************************************************************************/
+void USBMSDInit(void)
+{
+    BYTE i;
+
+    MSDReleaseMedia();
+
+    MSD_State = MSD_WAIT;
+    MSDCommandState = MSD_XFER_RESPONSE;
+    fStallIn = FALSE;
+    fStallOut = FALSE;
+    fArmCBW = FALSE;
+    fResetRecovery = FALSE;
+    USBMSDInHandle = 0;
+
+    for(i = 0; i <= MAX_LUN; i++)
+    {
+        SoftDetach[i] = FALSE;
+        MSDSetSense(i, S_NO_SENSE, ASC_NO_ADDITIONAL_SENSE_INFORMATION, ASCQ_NO_ADDITIONAL_SENSE_INFORMATION);
+    }
+
+    USBMSDOutHandle = USBRxOnePacket(MSD_DATA_OUT_EP, (BYTE*)&msd_cbw, sizeof(msd_cbw));
+}
+
+/******************************************************************************
+ * Function:        void USBCheckMSDRequest(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    None
+ *
+ * Overview:        Handles the MSD class requests on EP0, Bulk-Only
+ *                  Mass Storage Reset and Get Max LUN.  Call from the
+ *                  EVENT_EP0_REQUEST handler.
+ *
+ * Note:            None
+ *****************************************************************************/
+void USBCheckMSDRequest(void)
+{
+    static BYTE maxLUN = MAX_LUN;
+
+    if(SetupPkt.Recipient != USB_SETUP_RECIPIENT_INTERFACE_BITFIELD) return;
+    if(SetupPkt.bIntfID != MSD_INTF_ID) return;
+
+    switch(SetupPkt.bRequest)
+    {
+        case MSD_RESET:
+            // Abandon whatever the state machine was doing and wait for
+            // a new CBW.  The host clears both endpoint halts next, which
+            // also takes back anything still armed, so the CBW buffer is
+            // armed by MSDTasks once the OUT endpoint is free again.
+            MSD_State = MSD_WAIT;
+            MSDCommandState = MSD_XFER_RESPONSE;
+            fStallIn = FALSE;
+            fStallOut = FALSE;
+            fResetRecovery = FALSE;
+            fArmCBW = TRUE;
+            USBEP0Transmit(USB_EP0_NO_DATA);
+            break;
+
+        case GET_MAX_LUN:
+            USBEP0SendRAMPtr(&maxLUN, 1, USB_EP0_INCLUDE_ZERO);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/******************************************************************************
+ * Function:        BYTE MSDTasks(void)
+ *
+ * PreCondition:    USBMSDInit has been called
+ *
+ * Input:           None
+ *
+ * Output:          The MSD state: MSD_WAIT, MSD_DATA_IN, MSD_DATA_OUT
+ *                  or MSD_SEND_CSW
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The Bulk-Only Transport state machine.  Call from the
+ *                  sketch loop as often as possible; READ(10)/WRITE(10)
+ *                  only make progress while this is being called.
+ *
+ * Note:            None
+ *****************************************************************************/
+BYTE MSDTasks(void)
+{
+    BYTE i;
+
+    if((USBDeviceState < CONFIGURED_STATE) || (USBSuspendControl == 1))
+    {
+        return(MSD_WAIT);
+    }
+
+    // the sketch soft detached a LUN, give it back
+    for(i = 0; i <= MAX_LUN; i++)
+    {
+        if(SoftDetach[i] && fMediaClaimed[i])
+        {
+            MSDReleaseLUN(i);
+        }
+    }
+
+    switch(MSD_State)
+    {
+        case MSD_WAIT:
+            if(fResetRecovery)
+            {
+                // both endpoints stay stalled until the Bulk-Only Mass
+                // Storage Reset, even if the host clears a halt before it
+                if(!USBHandleBusy(pBDTEntryIn[MSD_DATA_IN_EP]))
+                {
+                    USBStallEndpoint(MSD_DATA_IN_EP, IN_TO_HOST);
+                }
+                if(!USBHandleBusy(pBDTEntryOut[MSD_DATA_OUT_EP]))
+                {
+                    USBStallEndpoint(MSD_DATA_OUT_EP, OUT_FROM_HOST);
+                }
+                break;
+            }
+
+            if(fArmCBW)
+            {
+                // a stalled endpoint owns both its buffers until the host
+                // clears the halt
+                if(USBHandleBusy(USBMSDOutHandle) || USBHandleBusy(pBDTEntryOut[MSD_DATA_OUT_EP]))
+                {
+                    break;
+                }
+                USBMSDOutHandle = USBRxOnePacket(MSD_DATA_OUT_EP, (BYTE*)&msd_cbw, sizeof(msd_cbw));
+                fArmCBW = FALSE;
+                break;
+            }
+
+            if(USBHandleBusy(USBMSDOutHandle))
+            {
+                break;
+            }
+
+            // the CBW must be exactly 31 bytes and carry the signature
+            if(USBHandleGetLength(USBMSDOutHandle) != MSD_CBW_SIZE || msd_cbw.dCBWSignature != MSD_CBW_SIGNATURE)
+            {
+                // not a CBW, stall both endpoints until a reset recovery
+                USBStallEndpoint(MSD_DATA_IN_EP, IN_TO_HOST);
+                USBStallEndpoint(MSD_DATA_OUT_EP, OUT_FROM_HOST);
+                fResetRecovery = TRUE;
+                break;
+            }
+
+            msd_csw.dCSWSignature = MSD_CSW_SIGNATURE;
+            msd_csw.dCSWTag = msd_cbw.dCBWTag;
+            msd_csw.dCSWDataResidue = msd_cbw.dCBWDataTransferLength;
+            msd_csw.bCSWStatus = MSD_CSW_COMMAND_PASSED;
+            fStallIn = FALSE;
+            fStallOut = FALSE;
+
+            if(msd_cbw.bCBWLUN > MAX_LUN || msd_cbw.bCBWCBLength == 0 || msd_cbw.bCBWCBLength > 16)
+            {
+                msd_csw.bCSWStatus = MSD_CSW_COMMAND_FAILED;
+                fStallIn = (msd_cbw.dCBWDataTransferLength != 0) && (msd_cbw.bCBWFlags & 0x80);
+                fStallOut = (msd_cbw.dCBWDataTransferLength != 0) && !(msd_cbw.bCBWFlags & 0x80);
+                MSD_State = MSD_SEND_CSW;
+                break;
+            }
+
+            MSDProcessCommand();
+            break;
+
+        case MSD_DATA_IN:
+            if(MSDCommandState == MSD_XFER_READ10)
+            {
+                if(!MSDReadStream())
+                {
+                    break;
+                }
+            }
+            else if(cbResponse > 0)
+            {
+                if(USBHandleBusy(USBMSDInHandle))
+                {
+                    break;
+                }
+                USBMSDInHandle = USBTxOnePacket(MSD_DATA_IN_EP, (BYTE*)&msd_buffer[0], cbResponse);
+                msd_csw.dCSWDataResidue -= cbResponse;
+                cbResponse = 0;
+                break;
+            }
+
+            // the host asked for more than we had, it gets a stall for the rest
+            if(msd_csw.dCSWDataResidue != 0)
+            {
+                fStallIn = TRUE;
+            }
+            MSD_State = MSD_SEND_CSW;
+            break;
+
+        case MSD_DATA_OUT:
+            if(!MSDWriteStream())
+            {
+                break;
+            }
+
+            if(msd_csw.dCSWDataResidue != 0)
+            {
+                fStallOut = TRUE;
+            }
+            MSD_State = MSD_SEND_CSW;
+            break;
+
+        case MSD_SEND_CSW:
+            if(fStallIn)
+            {
+                // the stall would take back data the host has not read yet
+                if(USBHandleBusy(USBMSDInHandle))
+                {
+                    break;
+                }
+                USBStallEndpoint(MSD_DATA_IN_EP, IN_TO_HOST);
+                fStallIn = FALSE;
+            }
+            if(fStallOut)
+            {
+                USBStallEndpoint(MSD_DATA_OUT_EP, OUT_FROM_HOST);
+                fStallOut = FALSE;
+            }
+
+            // wait until the last data packet went out, or the host
+            // cleared the halt on the IN endpoint
+            if(USBHandleBusy(pBDTEntryIn[MSD_DATA_IN_EP]))
+            {
+                break;
+            }
+
+            USBMSDInHandle = USBTxOnePacket(MSD_DATA_IN_EP, (BYTE*)&msd_csw, MSD_CSW_SIZE);
+
+            // the next CBW; a stalled OUT endpoint is armed once cleared
+            fArmCBW = TRUE;
+            MSD_State = MSD_WAIT;
+            break;
+
+        default:
+            MSD_State = MSD_WAIT;
+            break;
+    }
+
+    return(MSD_State);
+}
+
+/******************************************************************************
+ * Function:        BOOL MSDIsMediaClaimed(BYTE LUN)
+ *
+ * PreCondition:    None
+ *
+ * Input:           LUN - the logical unit to check
+ *
+ * Output:          TRUE if the host is currently using the media
+ *
+ * Side Effects:    None
+ *
+ * Overview:        The media is claimed from the first command that touches
+ *                  it until the host ejects it, the LUN is soft detached,
+ *                  or the device is reconfigured.
+ *
+ * Note:            None
+ *****************************************************************************/
+BOOL MSDIsMediaClaimed(BYTE LUN)
+{
+    return(LUN <= MAX_LUN && fMediaClaimed[LUN]);
+}
+
+/******************************************************************************
+ * Function:        void MSDReleaseMedia(void)
+ *
+ * PreCondition:    None
+ *
+ * Input:           None
+ *
+ * Output:          None
+ *
+ * Side Effects:    EVENT_MSD_MEDIA_RELEASED is sent for every claimed LUN
+ *
+ * Overview:        Returns all media to the application, call when the
+ *                  USB cable is pulled or the bus is suspended.
+ *
+ * Note:            None
+ *****************************************************************************/
+void MSDReleaseMedia(void)
+{
+    BYTE i;
+
+    for(i = 0; i <= MAX_LUN; i++)
+    {
+        if(fMediaClaimed[i])
+        {
+            MSDReleaseLUN(i);
+        }
+    }
+}
+
+/** PRIVATE FUNCTIONS **********************************************/
+
+static void MSDProcessCommand(void)
+{
+    BYTE    lun = msd_cbw.bCBWLUN;
+    BOOL    fToHost = (msd_cbw.bCBWFlags & 0x80) != 0;
+    DWORD   capacity;
+    BYTE    i;
+
+    cbResponse = 0;
+    MSDCommandState = MSD_XFER_RESPONSE;
+
+    switch(msd_cbw.CBWCB[0])
+    {
+        case MSD_INQUIRY:
+            memcpypgm2ram((void *)&msd_buffer[0], (ROM void *)&inq_resp, sizeof(InquiryResponse));
+            cbResponse = sizeof(InquiryResponse);
+            break;
+
+        case MSD_READ_CAPACITY:
+            if(!MSDMediaReady(lun))
+            {
+                break;
+            }
+            // last LBA and block length, big endian
+            capacity = LUN[lun].ReadCapacity();
+            msd_buffer[0] = (BYTE) (capacity >> 24);
+            msd_buffer[1] = (BYTE) (capacity >> 16);
+            msd_buffer[2] = (BYTE) (capacity >> 8);
+            msd_buffer[3] = (BYTE) capacity;
+            msd_buffer[4] = 0;
+            msd_buffer[5] = 0;
+            msd_buffer[6] = (BYTE) (MSD_SECTOR_SIZE >> 8);
+            msd_buffer[7] = (BYTE) MSD_SECTOR_SIZE;
+            cbResponse = 8;
+            break;
+
+        case MSD_READ_FORMAT_CAPACITY:
+            if(!MSDMediaReady(lun))
+            {
+                break;
+            }
+            capacity = LUN[lun].ReadCapacity() + 1;
+            msd_buffer[0] = 0;
+            msd_buffer[1] = 0;
+            msd_buffer[2] = 0;
+            msd_buffer[3] = 8;                  // capacity list length
+            msd_buffer[4] = (BYTE) (capacity >> 24);
+            msd_buffer[5] = (BYTE) (capacity >> 16);
+            msd_buffer[6] = (BYTE) (capacity >> 8);
+            msd_buffer[7] = (BYTE) capacity;
+            msd_buffer[8] = 0x02;               // formatted media
+            msd_buffer[9] = 0;
+            msd_buffer[10] = (BYTE) (MSD_SECTOR_SIZE >> 8);
+            msd_buffer[11] = (BYTE) MSD_SECTOR_SIZE;
+            cbResponse = 12;
+            break;
+
+        case MSD_REQUEST_SENSE:
+            for(i = 0; i < sizeof(RequestSenseResponse); i++)
+            {
+                msd_buffer[i] = gblSenseData[lun]._byte[i];
+            }
+            cbResponse = sizeof(RequestSenseResponse);
+            MSDSetSense(lun, S_NO_SENSE, ASC_NO_ADDITIONAL_SENSE_INFORMATION, ASCQ_NO_ADDITIONAL_SENSE_INFORMATION);
+            break;
+
+        case MSD_MODE_SENSE:
+            msd_buffer[0] = 0x03;               // mode data length
+            msd_buffer[1] = 0x00;               // medium type
+            msd_buffer[2] = LUN[lun].WriteProtectState() ? 0x80 : 0x00;
+            msd_buffer[3] = 0x00;               // no block descriptors
+            cbResponse = 4;
+            break;
+
+        case MSD_TEST_UNIT_READY:
+            if(MSDMediaReady(lun))
+            {
+                MSDClaimMedia(lun);
+            }
+            break;
+
+        case MSD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+            // removal can not be prevented, the card is in a socket
+            MSDSetSense(lun, S_ILLEGAL_REQUEST, ASC_INVALID_COMMAND_OPCODE, ASCQ_INVALID_COMMAND_OPCODE);
+            msd_csw.bCSWStatus = MSD_CSW_COMMAND_FAILED;
+            break;
+
+        case MSD_VERIFY:
+            break;
+
+        case MSD_STOP_START:
+            // LOEJ with START clear is an eject; hand the media back
+            if((msd_cbw.CBWCB[4] & 0x03) == 0x02)
+            {
+                SoftDetach[lun] = TRUE;
+                MSDReleaseLUN(lun);
+            }
+            break;
+
+        case MSD_READ_10:
+        case MSD_WRITE_10:
+            MSDStartStream(msd_cbw.CBWCB[0]);
+            return;
+
+        default:
+            MSDSetSense(lun, S_ILLEGAL_REQUEST, ASC_INVALID_COMMAND_OPCODE, ASCQ_INVALID_COMMAND_OPCODE);
+            msd_csw.bCSWStatus = MSD_CSW_COMMAND_FAILED;
+            break;
+    }
+
+    // commands with a short response or no data phase at all
+    if(msd_csw.bCSWStatus != MSD_CSW_COMMAND_PASSED)
+    {
+        cbResponse = 0;
+    }
+
+    if(msd_cbw.dCBWDataTransferLength == 0)
+    {
+        // the host expects nothing; a response we wanted to send is a phase error
+        if(cbResponse != 0)
+        {
+            msd_csw.bCSWStatus = MSD_CSW_PHASE_ERROR;
+        }
+        MSD_State = MSD_SEND_CSW;
+    }
+    else if(!fToHost)
+    {
+        // the host wants to send data we do not want
+        fStallOut = TRUE;
+        if(cbResponse != 0)
+        {
+            msd_csw.bCSWStatus = MSD_CSW_PHASE_ERROR;
+        }
+        MSD_State = MSD_SEND_CSW;
+    }
+    else
+    {
+        if(cbResponse > msd_cbw.dCBWDataTransferLength)
+        {
+            cbResponse = msd_cbw.dCBWDataTransferLength;
+        }
+        MSD_State = MSD_DATA_IN;
+    }
+}
+
+static void MSDStartStream(BYTE command)
+{
+    BYTE    lun = msd_cbw.bCBWLUN;
+    BOOL    fToHost = (msd_cbw.bCBWFlags & 0x80) != 0;
+    BOOL    fRead = (command == MSD_READ_10);
+    DWORD   cbCommand;
+    DWORD   lba;
+    WORD    cSectors;
+    BYTE    i;
+
+    lba =   ((DWORD) msd_cbw.CBWCB[2] << 24) | ((DWORD) msd_cbw.CBWCB[3] << 16) |
+            ((DWORD) msd_cbw.CBWCB[4] << 8) | (DWORD) msd_cbw.CBWCB[5];
+    cSectors = ((WORD) msd_cbw.CBWCB[7] << 8) | (WORD) msd_cbw.CBWCB[8];
+    cbCommand = (DWORD) cSectors * MSD_SECTOR_SIZE;
+
+    MSD_State = MSD_SEND_CSW;
+
+    // direction or length disagree with the command: phase error
+    if(cbCommand > msd_cbw.dCBWDataTransferLength || (cbCommand != 0 && fToHost != fRead))
+    {
+        msd_csw.bCSWStatus = MSD_CSW_PHASE_ERROR;
+        fStallIn = fToHost && msd_cbw.dCBWDataTransferLength != 0;
+        fStallOut = !fToHost && msd_cbw.dCBWDataTransferLength != 0;
+        return;
+    }
+
+    if(!MSDMediaReady(lun))
+    {
+        fStallIn = fToHost && msd_cbw.dCBWDataTransferLength != 0;
+        fStallOut = !fToHost && msd_cbw.dCBWDataTransferLength != 0;
+        return;
+    }
+
+    if(lba + cSectors < lba || lba + cSectors > LUN[lun].ReadCapacity() + 1)
+    {
+        MSDSetSense(lun, S_ILLEGAL_REQUEST, ASC_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE, ASCQ_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE);
+        msd_csw.bCSWStatus = MSD_CSW_COMMAND_FAILED;
+        fStallIn = fToHost && msd_cbw.dCBWDataTransferLength != 0;
+        fStallOut = !fToHost && msd_cbw.dCBWDataTransferLength != 0;
+        return;
+    }
+
+    if(!fRead && LUN[lun].WriteProtectState())
+    {
+        MSDSetSense(lun, S_DATA_PROTECT, ASC_WRITE_PROTECTED, ASCQ_WRITE_PROTECTED);
+        msd_csw.bCSWStatus = MSD_CSW_COMMAND_FAILED;
+        fStallOut = msd_cbw.dCBWDataTransferLength != 0;
+        return;
+    }
+
+    MSDClaimMedia(lun);
+
+    stream.lba = lba;
+    stream.cMediaSectors = cSectors;
+    stream.cUSBSectors = cSectors;
+    stream.iMedia = 0;
+    stream.iUSB = 0;
+    stream.ibUSB = 0;
+    for(i = 0; i < MSD_SECTOR_BUFFERS; i++)
+    {
+        stream.fFull[i] = FALSE;
+        stream.hLast[i] = 0;
+    }
+
+    if(fRead)
+    {
+        MSDCommandState = MSD_XFER_READ10;
+        MSD_State = MSD_DATA_IN;
+    }
+    else
+    {
+        MSDCommandState = MSD_XFER_WRITE10;
+        MSD_State = MSD_DATA_OUT;
+    }
+}
+
+// The endpoint may still be reading from or writing into a sector buffer
+// after its last packet has been armed.  The BDT behind that packet may
+// already have been re-armed for a later packet; packets complete in order
+// so waiting on the later one is only conservative.
+static BOOL MSDStreamBufferFree(BYTE i)
+{
+    return(!stream.fFull[i] && !USBHandleBusy(stream.hLast[i]));
+}
+
+// Returns TRUE once the READ(10) data phase is over
+static BOOL MSDReadStream(void)
+{
+    BYTE lun = msd_cbw.bCBWLUN;
+    BYTE pass;
+
+    // Arm packets, read one sector while they drain, arm again
+    for(pass = 0; pass < 2; pass++)
+    {
+        // USB side; keep both ping-pong buffers busy
+        while(stream.fFull[stream.iUSB] && !USBHandleBusy(pBDTEntryIn[MSD_DATA_IN_EP]))
+        {
+            USBMSDInHandle = USBTxOnePacket(MSD_DATA_IN_EP, &msdSector[stream.iUSB][stream.ibUSB], MSD_IN_EP_SIZE);
+            msd_csw.dCSWDataResidue -= MSD_IN_EP_SIZE;
+            stream.ibUSB += MSD_IN_EP_SIZE;
+
+            if(stream.ibUSB == MSD_SECTOR_SIZE)
+            {
+                stream.hLast[stream.iUSB] = USBMSDInHandle;
+                stream.fFull[stream.iUSB] = FALSE;
+                stream.iUSB = (stream.iUSB + 1) % MSD_SECTOR_BUFFERS;
+                stream.ibUSB = 0;
+                stream.cUSBSectors--;
+            }
+        }
+
+        // media side; fill the next free buffer
+        if(pass == 0 && stream.cMediaSectors > 0 && MSDStreamBufferFree(stream.iMedia))
+        {
+            if(!LUN[lun].SectorRead(stream.lba, &msdSector[stream.iMedia][0]))
+            {
+                MSDSetSense(lun, S_MEDIUM_ERROR, ASC_NO_ADDITIONAL_SENSE_INFORMATION, ASCQ_NO_ADDITIONAL_SENSE_INFORMATION);
+                msd_csw.bCSWStatus = MSD_CSW_COMMAND_FAILED;
+                return(TRUE);
+            }
+
+            stream.fFull[stream.iMedia] = TRUE;
+            stream.iMedia = (stream.iMedia + 1) % MSD_SECTOR_BUFFERS;
+            stream.lba++;
+            stream.cMediaSectors--;
+        }
+    }
+
+    return(stream.cUSBSectors == 0);
+}
+
+// Returns TRUE once the WRITE(10) data phase is over
+static BOOL MSDWriteStream(void)
+{
+    BYTE lun = msd_cbw.bCBWLUN;
+    BYTE pass;
+
+    for(pass = 0; pass < 2; pass++)
+    {
+        // USB side; keep both ping-pong buffers armed for the host
+        while(stream.cUSBSectors > 0 && MSDStreamBufferFree(stream.iUSB) && !USBHandleBusy(pBDTEntryOut[MSD_DATA_OUT_EP]))
+        {
+            USBMSDOutHandle = USBRxOnePacket(MSD_DATA_OUT_EP, &msdSector[stream.iUSB][stream.ibUSB], MSD_OUT_EP_SIZE);
+            stream.ibUSB += MSD_OUT_EP_SIZE;
+
+            if(stream.ibUSB == MSD_SECTOR_SIZE)
+            {
+                // the sector is complete once its last packet is
+                stream.hLast[stream.iUSB] = USBMSDOutHandle;
+                stream.fFull[stream.iUSB] = TRUE;
+                stream.iUSB = (stream.iUSB + 1) % MSD_SECTOR_BUFFERS;
+                stream.ibUSB = 0;
+                stream.cUSBSectors--;
+            }
+        }
+
+        // media side; write the oldest received sector
+        if(pass == 0 && stream.cMediaSectors > 0 && stream.fFull[stream.iMedia] && !USBHandleBusy(stream.hLast[stream.iMedia]))
+        {
+            if(!LUN[lun].SectorWrite(stream.lba, &msdSector[stream.iMedia][0], stream.lba == 0))
+            {
+                MSDSetSense(lun, S_MEDIUM_ERROR, ASC_NO_ADDITIONAL_SENSE_INFORMATION, ASCQ_NO_ADDITIONAL_SENSE_INFORMATION);
+                msd_csw.bCSWStatus = MSD_CSW_COMMAND_FAILED;
+            }
+
+            // keep draining even after an error, the host is still sending
+            msd_csw.dCSWDataResidue -= MSD_SECTOR_SIZE;
+            stream.fFull[stream.iMedia] = FALSE;
+            stream.hLast[stream.iMedia] = 0;
+            stream.iMedia = (stream.iMedia + 1) % MSD_SECTOR_BUFFERS;
+            stream.lba++;
+            stream.cMediaSectors--;
+        }
+    }
+
+    return(stream.cMediaSectors == 0);
+}
+
+static BOOL MSDMediaReady(BYTE LUN_)
+{
+    if(SoftDetach[LUN_] || !LUN[LUN_].MediaDetect())
+    {
+        MSDSetSense(LUN_, S_NOT_READY, ASC_MEDIUM_NOT_PRESENT, ASCQ_MEDIUM_NOT_PRESENT);
+        msd_csw.bCSWStatus = MSD_CSW_COMMAND_FAILED;
+        return(FALSE);
+    }
+
+    return(TRUE);
+}
+
+static void MSDSetSense(BYTE LUN_, BYTE key, BYTE asc, BYTE ascq)
+{
+    BYTE i;
+
+    for(i = 0; i < sizeof(RequestSenseResponse); i++)
+    {
+        gblSenseData[LUN_]._byte[i] = 0;
+    }
+
+    gblSenseData[LUN_].ResponseCode = S_CURRENT;
+    gblSenseData[LUN_].VALID = 0;
+    gblSenseData[LUN_].SenseKey = key;
+    gblSenseData[LUN_].AddSenseLen = 0x0a;
+    gblSenseData[LUN_].ASC = asc;
+    gblSenseData[LUN_].ASCQ = ascq;
+}
+
+static void MSDClaimMedia(BYTE LUN_)
+{
+    if(!fMediaClaimed[LUN_])
+    {
+        // tell the sketch first so FSIO flushes and stops writing
+        USER_USB_CALLBACK_EVENT_HANDLER(EVENT_MSD_MEDIA_CLAIMED, &LUN_, 1);
+        fMediaClaimed[LUN_] = TRUE;
+    }
+}
+
+static void MSDReleaseLUN(BYTE LUN_)
+{
+    fMediaClaimed[LUN_] = FALSE;
+    USER_USB_CALLBACK_EVENT_HANDLER(EVENT_MSD_MEDIA_RELEASED, &LUN_, 1);
+}
+
+#endif // USB_USE_MSD
+
+/** EOF usb_function_msd.c *************************************************/
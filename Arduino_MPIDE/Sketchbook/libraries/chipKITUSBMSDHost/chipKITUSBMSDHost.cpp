@@ -133,6 +133,26 @@ uint8_t ChipKITUSBMSDHost::SCSIMediaDetect(void)
     return(USBHostMSDSCSIMediaDetect());
 }
 
+uint8_t ChipKITUSBMSDHost::SCSISectorReadMulti(DWORD sectorAddress, uint8_t * dataBuffer, WORD sectorCount)
+{
+    return(USBHostMSDSCSISectorReadMulti(sectorAddress, dataBuffer, sectorCount));
+}
+
+uint8_t ChipKITUSBMSDHost::SCSISectorWriteMulti(DWORD sectorAddress, uint8_t * dataBuffer, WORD sectorCount, uint8_t allowWriteToZero)
+{
+    return(USBHostMSDSCSISectorWriteMulti(sectorAddress, dataBuffer, sectorCount, allowWriteToZero));
+}
+
+uint8_t ChipKITUSBMSDHost::SCSISelectVolume(uint8_t volume)
+{
+    return(USBHostMSDSCSISelectVolume(volume));
+}
+
+uint8_t ChipKITUSBMSDHost::SCSICurrentVolume(void)
+{
+    return(USBHostMSDSCSICurrentVolume());
+}
+
 //******************************************************************************
 //******************************************************************************
 // Instantiate the MSD Class for the sketches
@@ -80,6 +80,12 @@
         uint8_t SCSIWriteProtectState(void);
         MEDIA_INFORMATION * SCSIMediaInitialize(void);
         uint8_t SCSIMediaDetect(void);
+
+        // multi-sector transfers and one volume per attached LUN
+        uint8_t SCSISectorReadMulti(DWORD sectorAddress, uint8_t * dataBuffer, WORD sectorCount);
+        uint8_t SCSISectorWriteMulti(DWORD sectorAddress, uint8_t * dataBuffer, WORD sectorCount, uint8_t allowWriteToZero);
+        uint8_t SCSISelectVolume(uint8_t volume);
+        uint8_t SCSICurrentVolume(void);
     };
 
 // the pre-instantiated Class for the sketches
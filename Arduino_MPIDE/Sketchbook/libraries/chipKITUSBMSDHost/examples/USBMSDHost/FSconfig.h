@@ -59,6 +59,13 @@
 #define MEDIA_SECTOR_SIZE 		512
 /************************************************************************/
 
+// The number of volumes that can be mounted at the same time, each
+// LUN of an attached USB drive (or card reader slot) is one volume.
+// Every volume takes 2 * MEDIA_SECTOR_SIZE bytes of buffers plus
+// its FAT state; select one with FSSelectVolume before FSInit.
+#define FS_MAX_VOLUMES          1
+/************************************************************************/
+
 /* *******************************************************************************************************/
 /************** Compiler options to enable/Disable Features based on user's application ******************/
 /* *******************************************************************************************************/
@@ -212,6 +219,9 @@
         #define MDD_InitIO();              
         #define MDD_ShutdownMedia       USBMSDHost.SCSIMediaReset
         #define MDD_WriteProtectState   USBMSDHost.SCSIWriteProtectState
+        #define MDD_SectorReadMulti     USBMSDHost.SCSISectorReadMulti
+        #define MDD_SectorWriteMulti    USBMSDHost.SCSISectorWriteMulti
+        #define MDD_SelectVolume        USBMSDHost.SCSISelectVolume
     #else
         #define MDD_MediaInitialize     USBHostMSDSCSIMediaInitialize
         #define MDD_MediaDetect         USBHostMSDSCSIMediaDetect
@@ -220,6 +230,9 @@
         #define MDD_InitIO();              
         #define MDD_ShutdownMedia       USBHostMSDSCSIMediaReset
         #define MDD_WriteProtectState   USBHostMSDSCSIWriteProtectState
+        #define MDD_SectorReadMulti     USBHostMSDSCSISectorReadMulti
+        #define MDD_SectorWriteMulti    USBHostMSDSCSISectorWriteMulti
+        #define MDD_SelectVolume        USBHostMSDSCSISelectVolume
     #endif
 #endif
 
@@ -13,12 +13,12 @@ Storage Class, allowing a PIC application to utilize mass storage devices such
 as USB flash drives.  For ease of integration, this file contains macros to
 allow the File System code to reference the functions in this file.
 
-Currently, the file system layer above this interface layer is limited to one
-LUN (Logical Unit Number) on a single mass storage device.  This layer accepts
-and stores the max LUN from the USB MSD layer, but all sector reads and writes
-are hard-coded to LUN 0, since the layer above does not specify a LUN in the
-sector read and write commands.  Also, to interface with the existing file
-system code, only one attached device is allowed.
+Each LUN (Logical Unit Number) of each attached mass storage device is a
+volume.  Up to USB_MAX_MSD_SCSI_VOLUMES volumes are tracked, each with its own
+device address, LUN and media information.  The media functions the file
+system calls work on the current volume, set with
+USBHostMSDSCSISelectVolume(), so a multi-slot card reader, or more than one
+device, can be mounted at the same time.
 
 FileName:        usb_host_msd_scsi.c
 Dependencies:    Microchip Memory Disk Drive File System v1.01
@@ -51,6 +51,10 @@ Change History:
   ----------  ----------------------------------------------------------
   2.6 - 2.7a  No change
 
+  Digilent (KeithV) - Volume table for multiple LUNs and devices, and the
+              multi-sector USBHostMSDSCSISectorReadMulti() and
+              USBHostMSDSCSISectorWriteMulti() transfers
+
 *******************************************************************************/
 
 #include <stdlib.h>
@@ -84,6 +88,13 @@ Change History:
 #define INITIALIZATION_ATTEMPTS     100         // How many times to try to initialize the media before failing
 #define RDPROTECT_NORMAL            0x00        // Normal Read Protect behavior.
 #define WRPROTECT_NORMAL            0x00        // Normal Write Protect behavior.
+#define SCSI_READ_10                0x28        // READ 10 operation code
+#define SCSI_WRITE_10               0x2A        // WRITE 10 operation code
+
+// One volume per LUN; by default enough for one LUN on every device
+#ifndef USB_MAX_MSD_SCSI_VOLUMES
+    #define USB_MAX_MSD_SCSI_VOLUMES    USB_MAX_MASS_STORAGE_DEVICES
+#endif
 
 
 //******************************************************************************
@@ -104,6 +115,9 @@ Change History:
     BOOL    _USBHostMSDSCSI_TestUnitReady( void );
 #endif
 
+static BYTE _USBHostMSDSCSI_ReadWrite10( BYTE operationCode, DWORD sectorAddress, BYTE *dataBuffer, WORD sectorCount );
+static BYTE _USBHostMSDSCSI_AddVolume( BYTE address, BYTE LUN );
+
 
 //******************************************************************************
 //******************************************************************************
@@ -115,8 +129,20 @@ Change History:
 // Section: Internal Global Variables
 //******************************************************************************
 
-static BYTE                deviceAddress = 0;  // USB address of the attached device.
-static MEDIA_INFORMATION   mediaInformation;   // Information about the attached media.
+typedef struct
+{
+    BYTE                address;            // USB address of the device, 0 if the volume is free.
+    BYTE                LUN;                // Logical unit on that device.
+    MEDIA_INFORMATION   media;              // Information about the media in that LUN.
+} SCSI_VOLUME_INFO;
+
+static SCSI_VOLUME_INFO    volumeInfo[USB_MAX_MSD_SCSI_VOLUMES];   // Attached volumes.
+static BYTE                currentVolume = 0;                      // Volume the media functions work on.
+
+// The device address, LUN and media information of the current volume
+#define deviceAddress       (volumeInfo[currentVolume].address)
+#define deviceLUN           (volumeInfo[currentVolume].LUN)
+#define mediaInformation    (volumeInfo[currentVolume].media)
 
 // *****************************************************************************
 // *****************************************************************************
@@ -154,17 +180,8 @@ BOOL USBHostMSDSCSIInitialize( BYTE address, DWORD flags, BYTE clientDriverID )
         UART2PrintString( "SCSI: Device attached.\r\n" );
     #endif
 
-    if (deviceAddress == 0)
-    {
-        // Save the address of the new device.
-        deviceAddress = address;
-        return TRUE;
-    }
-    else
-    {
-        // We can currently only handle one device.
-        return FALSE;
-    }
+    // LUN 0 always exists; the other LUNs are added when the max LUN is known.
+    return _USBHostMSDSCSI_AddVolume( address, 0 );
 }
 
 
@@ -196,7 +213,18 @@ BOOL USBHostMSDSCSIInitialize( BYTE address, DWORD flags, BYTE clientDriverID )
 
 BOOL USBHostMSDSCSIEventHandler( BYTE address, USB_EVENT event, void *data, DWORD size )
 {
-    if (deviceAddress == address)
+    BYTE    i;
+    WORD    LUN;
+
+    for (i = 0; i < USB_MAX_MSD_SCSI_VOLUMES; i++)
+    {
+        if (volumeInfo[i].address == address)
+        {
+            break;
+        }
+    }
+
+    if ((address != 0) && (i < USB_MAX_MSD_SCSI_VOLUMES))
     {
         switch( event )
         {
@@ -216,8 +244,17 @@ BOOL USBHostMSDSCSIEventHandler( BYTE address, USB_EVENT event, void *data, DWOR
                 #ifdef DEBUG_MODE
                     UART2PrintString( "SCSI: Max LUN set.\r\n" );
                 #endif
-                mediaInformation.maxLUN                     = *((BYTE *)data);
-                mediaInformation.validityFlags.bits.maxLUN  = 1;
+                volumeInfo[i].media.maxLUN                     = *((BYTE *)data);
+                volumeInfo[i].media.validityFlags.bits.maxLUN  = 1;
+
+                // Every LUN of a multi-slot reader is a volume of its own, as far as there is room.
+                for (LUN = 1; LUN <= volumeInfo[i].media.maxLUN; LUN++)
+                {
+                    if (!_USBHostMSDSCSI_AddVolume( address, (BYTE) LUN ))
+                    {
+                        break;
+                    }
+                }
                 return TRUE;
                 break;
 
@@ -225,8 +262,14 @@ BOOL USBHostMSDSCSIEventHandler( BYTE address, USB_EVENT event, void *data, DWOR
                 #ifdef DEBUG_MODE
                     UART2PrintString( "SCSI: Device detached.\r\n" );
                 #endif
-                deviceAddress                           = 0;
-                mediaInformation.validityFlags.value    = 0;
+                for (; i < USB_MAX_MSD_SCSI_VOLUMES; i++)
+                {
+                    if (volumeInfo[i].address == address)
+                    {
+                        volumeInfo[i].address                   = 0;
+                        volumeInfo[i].media.validityFlags.value = 0;
+                    }
+                }
                 return TRUE;
                 break;
 
@@ -371,7 +414,7 @@ MEDIA_INFORMATION * USBHostMSDSCSIMediaInitialize( void )
         commandBlock[8] = 0;        //
         commandBlock[9] = 0x00;     // Control
 
-        errorCode = USBHostMSDRead( deviceAddress, 0, commandBlock, 10, inquiryData, 8 );
+        errorCode = USBHostMSDRead( deviceAddress, deviceLUN, commandBlock, 10, inquiryData, 8 );
         #ifdef DEBUG_MODE
             UART2PutHex( errorCode ) ;
             UART2PutChar( ' ' );
@@ -401,7 +444,8 @@ MEDIA_INFORMATION * USBHostMSDSCSIMediaInitialize( void )
                 UART2PutChar( inquiryData[4] + '0' );
                 UART2PrintString( "\r\n" );
             #endif
-            mediaInformation.sectorSize                     = (inquiryData[7] << 12) + (inquiryData[6] << 8) + (inquiryData[5] << 4) + (inquiryData[4]);
+            // The block length is a big endian DWORD following the last LBA.
+            mediaInformation.sectorSize                     = ((WORD) inquiryData[6] << 8) + inquiryData[7];
             mediaInformation.validityFlags.bits.sectorSize  = 1;
 
             mediaInformation.errorCode = MEDIA_NO_ERROR;
@@ -422,7 +466,7 @@ MEDIA_INFORMATION * USBHostMSDSCSIMediaInitialize( void )
             commandBlock[4] = 18;       // Allocation length
             commandBlock[5] = 0;        // Control
 
-            errorCode = USBHostMSDRead( deviceAddress, 0, commandBlock, 6, inquiryData, 18 );
+            errorCode = USBHostMSDRead( deviceAddress, deviceLUN, commandBlock, 6, inquiryData, 18 );
             #ifdef DEBUG_MODE
                 UART2PutHex( errorCode ) ;
                 UART2PutChar( ' ' );
@@ -541,69 +585,7 @@ BYTE USBHostMSDSCSIMediaReset( void  )
 
 BYTE USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer )
 {
-    DWORD   byteCount;
-    BYTE    commandBlock[10];
-    BYTE    errorCode;
-
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Reading sector " );
-        UART2PutHex(sectorAddress >> 24);
-        UART2PutHex(sectorAddress >> 16);
-        UART2PutHex(sectorAddress >> 8);
-        UART2PutHex(sectorAddress);
-        UART2PrintString( " Device " );
-        UART2PutHex(deviceAddress);
-        UART2PrintString( "\r\n" );
-    #endif
-
-    if (deviceAddress == 0)
-    {
-        return FALSE;       // USB_MSD_DEVICE_NOT_FOUND;
-    }
-
-    // Fill in the command block with the READ10 parameters.
-    commandBlock[0] = 0x28;     // Operation code
-    commandBlock[1] = RDPROTECT_NORMAL | FUA_ALLOW_CACHE;
-    commandBlock[2] = (BYTE) (sectorAddress >> 24);     // Big endian!
-    commandBlock[3] = (BYTE) (sectorAddress >> 16);
-    commandBlock[4] = (BYTE) (sectorAddress >> 8);
-    commandBlock[5] = (BYTE) (sectorAddress);
-    commandBlock[6] = 0x00;     // Group Number
-    commandBlock[7] = 0x00;     // Number of blocks - Big endian!
-    commandBlock[8] = 0x01;
-    commandBlock[9] = 0x00;     // Control
-
-    // Currently using LUN=0.  When the File System supports multiple LUN's, this will change.
-    errorCode = USBHostMSDRead( deviceAddress, 0, commandBlock, 10, dataBuffer, mediaInformation.sectorSize );
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Read sector init error " );
-        UART2PutHex( errorCode );
-        UART2PrintString( "\r\n" );
-    #endif
-
-    if (!errorCode)
-    {
-        while (!USBHostMSDTransferIsComplete( deviceAddress, &errorCode, &byteCount ))
-        {
-            USBTasks();
-        }
-    }
-
-    #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Read sector error " );
-        UART2PutHex( errorCode );
-        UART2PrintString( "\r\n" );
-    #endif
-
-    if (!errorCode)
-    {
-        return TRUE;
-    }
-    else
-    {
-//        USBHostMSDSCSIMediaReset();
-        return FALSE;
-    }
+    return _USBHostMSDSCSI_ReadWrite10( SCSI_READ_10, sectorAddress, dataBuffer, 1 );
 }
 
 /****************************************************************************
@@ -651,17 +633,286 @@ BYTE USBHostMSDSCSISectorRead( DWORD sectorAddress, BYTE *dataBuffer )
   ***************************************************************************/
 
 BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allowWriteToZero )
+{
+    if ((sectorAddress == 0) && (allowWriteToZero == FALSE))
+    {
+        return FALSE;
+    }
+
+    return _USBHostMSDSCSI_ReadWrite10( SCSI_WRITE_10, sectorAddress, dataBuffer, 1 );
+}
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorReadMulti( DWORD sectorAddress, BYTE *dataBuffer,
+                        WORD sectorCount )
+
+  Summary:
+    This function reads consecutive sectors with one command.
+
+  Description:
+    This function uses a single SCSI READ10 command to read sectorCount
+    sectors starting at sectorAddress.  One command with one status phase
+    replaces sectorCount round trips through the MSD transport, which is
+    what makes bulk file copies fast.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to read
+    BYTE    *dataBuffer     - buffer to store data, sectorCount sectors long
+    WORD    sectorCount     - number of sectors to read
+
+  Return Values:
+    TRUE    - read performed successfully
+    FALSE   - read was not successful
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSISectorReadMulti( DWORD sectorAddress, BYTE *dataBuffer, WORD sectorCount )
+{
+    return _USBHostMSDSCSI_ReadWrite10( SCSI_READ_10, sectorAddress, dataBuffer, sectorCount );
+}
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISectorWriteMulti( DWORD sectorAddress, BYTE *dataBuffer,
+                        WORD sectorCount, BYTE allowWriteToZero )
+
+  Summary:
+    This function writes consecutive sectors with one command.
+
+  Description:
+    This function uses a single SCSI WRITE10 command to write sectorCount
+    sectors starting at sectorAddress.
+
+  Precondition:
+    None
+
+  Parameters:
+    DWORD   sectorAddress   - address of the first sector to write
+    BYTE    *dataBuffer     - buffer with application data
+    WORD    sectorCount     - number of sectors to write
+    BYTE    allowWriteToZero- If a write to sector 0 is allowed.
+
+  Return Values:
+    TRUE    - write performed successfully
+    FALSE   - write was not successful
+
+  Remarks:
+    This function blocks until the write is complete.
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSISectorWriteMulti( DWORD sectorAddress, BYTE *dataBuffer, WORD sectorCount, BYTE allowWriteToZero )
+{
+    if ((sectorAddress == 0) && (allowWriteToZero == FALSE))
+    {
+        return FALSE;
+    }
+
+    return _USBHostMSDSCSI_ReadWrite10( SCSI_WRITE_10, sectorAddress, dataBuffer, sectorCount );
+}
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSIWriteProtectState( void )
+
+  Description:
+    This function returns the write protect status of the device.
+
+  Precondition:
+    None
+
+  Parameters:
+    None - None
+
+  Return Values:
+    0 - not write protected
+
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE    USBHostMSDSCSIWriteProtectState( void )
+{
+    return 0;
+}
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSISelectVolume( BYTE volume )
+
+  Summary:
+    This function selects the volume the media functions work on.
+
+  Description:
+    Volumes are numbered in the order their device and LUN were reported,
+    starting at 0.  USBHostMSDSCSIMediaDetect(), MediaInitialize(),
+    MediaReset(), SectorRead() and SectorWrite() all work on the selected
+    volume, so the file system selects a volume before it mounts or uses it.
+
+  Precondition:
+    None
+
+  Parameters:
+    BYTE volume     - volume to select, 0 to USB_MAX_MSD_SCSI_VOLUMES - 1
+
+  Return Values:
+    TRUE    - the volume was selected
+    FALSE   - there is no such volume, the selection did not change
+
+  Remarks:
+    A volume can be selected before its device is attached;
+    USBHostMSDSCSIMediaDetect() then returns FALSE.
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSISelectVolume( BYTE volume )
+{
+    if (volume >= USB_MAX_MSD_SCSI_VOLUMES)
+    {
+        return FALSE;
+    }
+
+    currentVolume = volume;
+    return TRUE;
+}
+
+
+/****************************************************************************
+  Function:
+    BYTE USBHostMSDSCSICurrentVolume( void )
+
+  Description:
+    This function returns the volume selected by
+    USBHostMSDSCSISelectVolume().
+
+  Precondition:
+    None
+
+  Parameters:
+    None - None
+
+  Returns:
+    The selected volume
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+BYTE USBHostMSDSCSICurrentVolume( void )
+{
+    return currentVolume;
+}
+
+
+// *****************************************************************************
+// *****************************************************************************
+// Section: Internal Functions
+// *****************************************************************************
+// *****************************************************************************
+
+
+/*******************************************************************************
+  Function:
+    BYTE _USBHostMSDSCSI_AddVolume( BYTE address, BYTE LUN )
+
+  Precondition:
+    None
+
+  Overview:
+    This function puts a LUN of a device in the first free volume.
+
+  Parameters:
+    BYTE address    - USB address of the device
+    BYTE LUN        - Logical unit on the device
+
+  Return Values:
+    TRUE    - The LUN has a volume
+    FALSE   - All volumes are in use
+
+  Remarks:
+    None
+  ***************************************************************************/
+
+static BYTE _USBHostMSDSCSI_AddVolume( BYTE address, BYTE LUN )
+{
+    BYTE    i;
+
+    // The max LUN can be reported again after a reset.
+    for (i = 0; i < USB_MAX_MSD_SCSI_VOLUMES; i++)
+    {
+        if ((volumeInfo[i].address == address) && (volumeInfo[i].LUN == LUN))
+        {
+            return TRUE;
+        }
+    }
+
+    for (i = 0; i < USB_MAX_MSD_SCSI_VOLUMES; i++)
+    {
+        if (volumeInfo[i].address == 0)
+        {
+            volumeInfo[i].address                   = address;
+            volumeInfo[i].LUN                       = LUN;
+            volumeInfo[i].media.validityFlags.value = 0;
+            return TRUE;
+        }
+    }
+
+    // No room for another LUN or device.
+    return FALSE;
+}
+
+
+/*******************************************************************************
+  Function:
+    BYTE _USBHostMSDSCSI_ReadWrite10( BYTE operationCode, DWORD sectorAddress,
+                        BYTE *dataBuffer, WORD sectorCount )
+
+  Precondition:
+    None
+
+  Overview:
+    This function sends a READ10 or WRITE10 SCSI command for sectorCount
+    sectors to the current volume and waits for it to complete.
+
+  Parameters:
+    BYTE    operationCode   - SCSI_READ_10 or SCSI_WRITE_10
+    DWORD   sectorAddress   - address of the first sector
+    BYTE    *dataBuffer     - sectorCount sectors of data
+    WORD    sectorCount     - number of sectors
+
+  Return Values:
+    TRUE    - transfer performed successfully
+    FALSE   - transfer was not successful
+
+  Remarks:
+    The command block layout is shown with USBHostMSDSCSISectorRead() and
+    USBHostMSDSCSISectorWrite().
+  ***************************************************************************/
+
+static BYTE _USBHostMSDSCSI_ReadWrite10( BYTE operationCode, DWORD sectorAddress, BYTE *dataBuffer, WORD sectorCount )
 {
     DWORD   byteCount;
     BYTE    commandBlock[10];
     BYTE    errorCode;
 
     #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Writing sector " );
+        UART2PrintString( (operationCode == SCSI_READ_10) ? "SCSI: Reading sector " : "SCSI: Writing sector " );
         UART2PutHex(sectorAddress >> 24);
         UART2PutHex(sectorAddress >> 16);
         UART2PutHex(sectorAddress >> 8);
         UART2PutHex(sectorAddress);
+        UART2PrintString( " Count " );
+        UART2PutHex(sectorCount >> 8);
+        UART2PutHex(sectorCount);
         UART2PrintString( " Device " );
         UART2PutHex(deviceAddress);
         UART2PrintString( "\r\n" );
@@ -669,30 +920,37 @@ BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allo
 
     if (deviceAddress == 0)
     {
-        return FALSE;   //USB_MSD_DEVICE_NOT_FOUND;
+        return FALSE;       // USB_MSD_DEVICE_NOT_FOUND;
     }
 
-    if ((sectorAddress == 0) && (allowWriteToZero == FALSE))
+    if (sectorCount == 0)
     {
-        return FALSE;
+        return TRUE;
     }
 
-    // Fill in the command block with the WRITE 10 parameters.
-    commandBlock[0] = 0x2A;     // Operation code
-    commandBlock[1] = WRPROTECT_NORMAL | FUA_ALLOW_CACHE;
+    // Fill in the command block with the READ10/WRITE10 parameters.
+    commandBlock[0] = operationCode;
+    commandBlock[1] = (operationCode == SCSI_READ_10) ? (RDPROTECT_NORMAL | FUA_ALLOW_CACHE) : (WRPROTECT_NORMAL | FUA_ALLOW_CACHE);
     commandBlock[2] = (BYTE) (sectorAddress >> 24);     // Big endian!
     commandBlock[3] = (BYTE) (sectorAddress >> 16);
     commandBlock[4] = (BYTE) (sectorAddress >> 8);
     commandBlock[5] = (BYTE) (sectorAddress);
     commandBlock[6] = 0x00;     // Group Number
-    commandBlock[7] = 0x00;     // Number of blocks - Big endian!
-    commandBlock[8] = 0x01;
+    commandBlock[7] = (BYTE) (sectorCount >> 8);        // Number of blocks - Big endian!
+    commandBlock[8] = (BYTE) (sectorCount);
     commandBlock[9] = 0x00;     // Control
 
-    // Currently using LUN=0.  When the File System supports multiple LUN's, this will change.
-    errorCode = USBHostMSDWrite( deviceAddress, 0, commandBlock, 10, dataBuffer, mediaInformation.sectorSize );
+    if (operationCode == SCSI_READ_10)
+    {
+        errorCode = USBHostMSDRead( deviceAddress, deviceLUN, commandBlock, 10, dataBuffer, (DWORD) mediaInformation.sectorSize * sectorCount );
+    }
+    else
+    {
+        errorCode = USBHostMSDWrite( deviceAddress, deviceLUN, commandBlock, 10, dataBuffer, (DWORD) mediaInformation.sectorSize * sectorCount );
+    }
+
     #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Write sector init error " );
+        UART2PrintString( "SCSI: Read/Write10 init error " );
         UART2PutHex( errorCode );
         UART2PrintString( "\r\n" );
     #endif
@@ -706,7 +964,7 @@ BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allo
     }
 
     #ifdef DEBUG_MODE
-        UART2PrintString( "SCSI: Write sector error " );
+        UART2PrintString( "SCSI: Read/Write10 error " );
         UART2PutHex( errorCode );
         UART2PrintString( "\r\n" );
     #endif
@@ -723,40 +981,6 @@ BYTE USBHostMSDSCSISectorWrite( DWORD sectorAddress, BYTE *dataBuffer, BYTE allo
 }
 
 
-/****************************************************************************
-  Function:
-    BYTE USBHostMSDSCSIWriteProtectState( void )
-
-  Description:
-    This function returns the write protect status of the device.
-
-  Precondition:
-    None
-
-  Parameters:
-    None - None
-
-  Return Values:
-    0 - not write protected
-
-
-  Remarks:
-    None
-  ***************************************************************************/
-
-BYTE    USBHostMSDSCSIWriteProtectState( void )
-{
-    return 0;
-}
-
-
-// *****************************************************************************
-// *****************************************************************************
-// Section: Internal Functions
-// *****************************************************************************
-// *****************************************************************************
-
-
 /*******************************************************************************
   Function:
     BOOL _USBHostMSDSCSI_TestUnitReady( void )
@@ -815,7 +1039,7 @@ BOOL _USBHostMSDSCSI_TestUnitReady( void )
         commandBlock[4] = 0;        // Reserved
         commandBlock[5] = 0x00;     // Control
 
-        errorCode = USBHostMSDRead( deviceAddress, 0, commandBlock, 6, inquiryData, 0 );
+        errorCode = USBHostMSDRead( deviceAddress, deviceLUN, commandBlock, 6, inquiryData, 0 );
         #ifdef DEBUG_MODE
             UART2PutHex( errorCode ) ;
             UART2PutChar( ' ' );